@@ -0,0 +1,136 @@
+/*
+ * Copyright 2020 Aaron Barany
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <DeepSea/Core/Config.h>
+#include <DeepSea/Core/Export.h>
+#include <DeepSea/Core/Containers/Types.h>
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+/**
+ * @file
+ * @brief Functions for manipulating flat hash maps.
+ *
+ * Keys may either be stored inline by providing a non-zero key size, or the key pointers
+ * themselves may be stored by providing a key size of 0. In the first case, the key parameters are
+ * pointers to the key data, which will be copied into the map. In the second case, the key
+ * parameters are the pointers that are stored and passed to the hash and equality functions, the
+ * same as dsHashTable.
+ *
+ * Inserting elements may re-allocate the internal arrays, so pointers to values are only valid
+ * until the next insertion or removal. Values are aligned to the largest power of two up to 8
+ * that evenly divides the value size.
+ *
+ * Inline 64-bit keys with NULL hash and equality functions are hashed and compared directly
+ * without calling through function pointers. Even so, the map is currently only faster than
+ * dsHashTable for lookups in large maps that don't fit in cache, so it isn't a drop-in
+ * replacement for dsHashTable in performance sensitive code.
+ *
+ * @see dsFlatHashMap
+ */
+
+/**
+ * @brief Initializes a flat hash map.
+ * @remark errno will be set on failure.
+ * @param[out] hashMap The hash map to initialize.
+ * @param allocator The allocator for the hash map. This must support freeing memory.
+ * @param keySize The size of the keys to store inline, or 0 to store key pointers.
+ * @param valueSize The size of each value. This may be 0 to use the map as a set.
+ * @param hashFunc The hashing function. This may be NULL to hash the bytes of inline keys.
+ * @param keysEqualFunc The function to determine if two keys are equal. This may be NULL to
+ *     compare the bytes of inline keys.
+ * @return False if the parameters are invalid.
+ */
+DS_CORE_EXPORT bool dsFlatHashMap_initialize(dsFlatHashMap* hashMap, dsAllocator* allocator,
+	uint32_t keySize, uint32_t valueSize, dsHashFunction hashFunc,
+	dsKeysEqualFunction keysEqualFunc);
+
+/**
+ * @brief Reserves space for a number of elements without re-allocating.
+ * @remark errno will be set on failure.
+ * @param hashMap The hash map.
+ * @param elementCount The number of elements to reserve space for.
+ * @return False if the memory couldn't be allocated.
+ */
+DS_CORE_EXPORT bool dsFlatHashMap_reserve(dsFlatHashMap* hashMap, uint32_t elementCount);
+
+/**
+ * @brief Inserts an element into the hash map.
+ * @remark errno will be set on failure, with EPERM if the key is already present.
+ * @param hashMap The hash map.
+ * @param key The key for the element.
+ * @param value The value to copy, or NULL to zero-initialize the value.
+ * @return The inserted value or NULL if the element couldn't be inserted.
+ */
+DS_CORE_EXPORT void* dsFlatHashMap_insert(dsFlatHashMap* hashMap, const void* key,
+	const void* value);
+
+/**
+ * @brief Finds the value for a key.
+ * @param hashMap The hash map.
+ * @param key The key to find the value for.
+ * @return The value or NULL if not found. If the value size is 0, this will still be a non-NULL
+ *     pointer when the key is present.
+ */
+DS_CORE_EXPORT void* dsFlatHashMap_find(const dsFlatHashMap* hashMap, const void* key);
+
+/**
+ * @brief Removes an element from the hash map.
+ * @remark errno will be set on failure.
+ * @param hashMap The hash map.
+ * @param key The key for the element to remove.
+ * @return False if the key wasn't present.
+ */
+DS_CORE_EXPORT bool dsFlatHashMap_remove(dsFlatHashMap* hashMap, const void* key);
+
+/**
+ * @brief Iterates over the elements in the hash map.
+ *
+ * The hash map may not be modified while iterating.
+ *
+ * @param[inout] index The iteration index. Set to 0 to start iteration.
+ * @param[out] outKey The key for the element. For inline keys, this is a pointer to the key data.
+ *     This may be NULL.
+ * @param[out] outValue The value for the element. This may be NULL.
+ * @param hashMap The hash map.
+ * @return False if there are no more elements.
+ */
+DS_CORE_EXPORT bool dsFlatHashMap_next(uint32_t* index, const void** outKey, void** outValue,
+	const dsFlatHashMap* hashMap);
+
+/**
+ * @brief Removes all elements from the hash map.
+ *
+ * This keeps the memory to re-use when adding new elements.
+ *
+ * @param hashMap The hash map.
+ */
+DS_CORE_EXPORT void dsFlatHashMap_clear(dsFlatHashMap* hashMap);
+
+/**
+ * @brief Shuts down a hash map, freeing the internal memory.
+ * @param hashMap The hash map.
+ */
+DS_CORE_EXPORT void dsFlatHashMap_shutdown(dsFlatHashMap* hashMap);
+
+#ifdef __cplusplus
+}
+#endif
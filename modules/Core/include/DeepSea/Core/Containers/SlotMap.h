@@ -0,0 +1,143 @@
+/*
+ * Copyright 2020 Aaron Barany
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <DeepSea/Core/Config.h>
+#include <DeepSea/Core/Export.h>
+#include <DeepSea/Core/Containers/Types.h>
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+/**
+ * @file
+ * @brief Functions for manipulating slot maps.
+ *
+ * Usage is typically as follows:
+ * 1. Initialize the slot map with dsSlotMap_initialize().
+ * 2. Add an element with dsSlotMap_add(), which returns the handle for the element. The element
+ *    should then be added to the end of the caller's arrays.
+ * 3. Look up the index for a handle with dsSlotMap_getIndex().
+ * 4. Remove an element with dsSlotMap_remove(). If the returned index is less than the new element
+ *    count, the last element must be moved to that index in the caller's arrays.
+ * 5. When the memory is no longer needed, call dsSlotMap_shutdown().
+ *
+ * @see dsSlotMap
+ */
+
+/**
+ * @brief Value for an invalid slot map index.
+ */
+#define DS_INVALID_SLOT_INDEX (uint32_t)-1
+
+/**
+ * @brief Initializes a slot map.
+ * @remark errno will be set on failure.
+ * @param[out] slotMap The slot map to initialize.
+ * @param allocator The allocator for the slot map. This must support freeing memory.
+ * @return False if the parameters are invalid.
+ */
+DS_CORE_EXPORT bool dsSlotMap_initialize(dsSlotMap* slotMap, dsAllocator* allocator);
+
+/**
+ * @brief Adds an element to a slot map.
+ *
+ * The index of the new element will be the previous element count.
+ *
+ * @remark errno will be set on failure.
+ * @param slotMap The slot map.
+ * @return The handle for the element, or DS_INVALID_SLOT_HANDLE if it couldn't be added.
+ */
+DS_CORE_EXPORT uint64_t dsSlotMap_add(dsSlotMap* slotMap);
+
+/**
+ * @brief Gets the index of the element for a handle.
+ * @param slotMap The slot map.
+ * @param handle The handle of the element.
+ * @return The index of the element, or DS_INVALID_SLOT_INDEX if the handle isn't valid.
+ */
+DS_CORE_EXPORT inline uint32_t dsSlotMap_getIndex(const dsSlotMap* slotMap, uint64_t handle);
+
+/**
+ * @brief Gets the handle for the element at an index.
+ * @param slotMap The slot map.
+ * @param index The index of the element.
+ * @return The handle of the element, or DS_INVALID_SLOT_HANDLE if the index is out of range.
+ */
+DS_CORE_EXPORT inline uint64_t dsSlotMap_getHandle(const dsSlotMap* slotMap, uint32_t index);
+
+/**
+ * @brief Removes an element from a slot map.
+ *
+ * The last element is moved into the place of the removed element to keep the elements densely
+ * packed. If the returned index is less than the element count after removal, the caller must move
+ * the element at index elementCount to the returned index.
+ *
+ * @remark errno will be set on failure.
+ * @param slotMap The slot map.
+ * @param handle The handle of the element to remove.
+ * @return The index of the removed element, or DS_INVALID_SLOT_INDEX if the handle isn't valid.
+ */
+DS_CORE_EXPORT uint32_t dsSlotMap_remove(dsSlotMap* slotMap, uint64_t handle);
+
+/**
+ * @brief Removes all elements from a slot map.
+ *
+ * Any existing handles will no longer be valid. Internal memory will remain allocated to re-use
+ * for future elements.
+ *
+ * @param slotMap The slot map.
+ */
+DS_CORE_EXPORT void dsSlotMap_clear(dsSlotMap* slotMap);
+
+/**
+ * @brief Shuts down a slot map, freeing the internal memory.
+ * @param slotMap The slot map.
+ */
+DS_CORE_EXPORT void dsSlotMap_shutdown(dsSlotMap* slotMap);
+
+inline uint32_t dsSlotMap_getIndex(const dsSlotMap* slotMap, uint64_t handle)
+{
+	uint32_t slot = (uint32_t)handle;
+	if (!slotMap || slot >= slotMap->slotCount)
+		return DS_INVALID_SLOT_INDEX;
+
+	const dsSlotMapSlot* slotInfo = slotMap->slots + slot;
+	if (slotInfo->generation != (uint32_t)(handle >> 32) ||
+		slotInfo->index >= slotMap->elementCount ||
+		slotMap->elementSlots[slotInfo->index] != slot)
+	{
+		return DS_INVALID_SLOT_INDEX;
+	}
+
+	return slotInfo->index;
+}
+
+inline uint64_t dsSlotMap_getHandle(const dsSlotMap* slotMap, uint32_t index)
+{
+	if (!slotMap || index >= slotMap->elementCount)
+		return DS_INVALID_SLOT_HANDLE;
+
+	uint32_t slot = slotMap->elementSlots[index];
+	return ((uint64_t)slotMap->slots[slot].generation << 32) | slot;
+}
+
+#ifdef __cplusplus
+}
+#endif
@@ -226,6 +226,157 @@ typedef struct dsStringPool
 	size_t reservedSize;
 } dsStringPool;
 
+/**
+ * @brief Value for an invalid slot map handle.
+ */
+#define DS_INVALID_SLOT_HANDLE (uint64_t)-1
+
+/**
+ * @brief Struct for a slot in a slot map.
+ * @see dsSlotMap
+ */
+typedef struct dsSlotMapSlot
+{
+	/**
+	 * @brief The index of the element when in use, or the next free slot when not.
+	 */
+	uint32_t index;
+
+	/**
+	 * @brief The generation of the slot, incremented each time the slot is freed.
+	 */
+	uint32_t generation;
+} dsSlotMapSlot;
+
+/**
+ * @brief Struct mapping stable handles to indices in a densely packed array.
+ *
+ * The slot map doesn't hold the elements itself. Instead, the elements are kept in one or more
+ * arrays managed by the caller, and the slot map provides the index into those arrays for each
+ * handle. Elements are removed by moving the last element into the removed element's place, and
+ * the slot map keeps track of the moved element so its handle stays valid.
+ *
+ * Handles contain the generation of the slot, so handles to removed elements won't find elements
+ * that are later added in the same slot.
+ *
+ * All operations are constant time, other than when growing the internal arrays.
+ *
+ * @see SlotMap.h
+ */
+typedef struct dsSlotMap
+{
+	/**
+	 * @brief The allocator for the slot map.
+	 */
+	dsAllocator* allocator;
+
+	/**
+	 * @brief The slots that handles refer to.
+	 */
+	dsSlotMapSlot* slots;
+
+	/**
+	 * @brief The slot for each element.
+	 */
+	uint32_t* elementSlots;
+
+	/**
+	 * @brief The number of slots.
+	 */
+	uint32_t slotCount;
+
+	/**
+	 * @brief The maximum number of slots before re-allocating.
+	 */
+	uint32_t maxSlots;
+
+	/**
+	 * @brief The number of elements.
+	 */
+	uint32_t elementCount;
+
+	/**
+	 * @brief The maximum number of elements before re-allocating.
+	 */
+	uint32_t maxElements;
+
+	/**
+	 * @brief The first free slot.
+	 */
+	uint32_t freeSlot;
+} dsSlotMap;
+
+/**
+ * @brief Struct for a hash map using open addressing.
+ *
+ * Unlike dsHashTable, the keys and values are stored inline in a flat array owned by the map along
+ * with the hash, so probing typically touches a single cache line. Keys and values have a fixed
+ * size set when initializing the map. Collisions are resolved with Robin
+ * Hood linear probing, and removal shifts the following elements back rather than leaving
+ * tombstones.
+ *
+ * @see FlatHashMap.h
+ */
+typedef struct dsFlatHashMap
+{
+	/**
+	 * @brief The allocator for the hash map.
+	 */
+	dsAllocator* allocator;
+
+	/**
+	 * @brief The hash function for the keys.
+	 */
+	dsHashFunction hashFunc;
+
+	/**
+	 * @brief The function for comparing two keys.
+	 */
+	dsKeysEqualFunction keysEqualFunc;
+
+	/**
+	 * @brief The size of the keys stored inline, or 0 if key pointers are stored.
+	 */
+	uint32_t keySize;
+
+	/**
+	 * @brief The size of each value.
+	 */
+	uint32_t valueSize;
+
+	/**
+	 * @brief The offset of the key within each entry.
+	 */
+	uint32_t keyOffset;
+
+	/**
+	 * @brief The offset of the value within each entry.
+	 */
+	uint32_t valueOffset;
+
+	/**
+	 * @brief The size of each entry.
+	 */
+	uint32_t entrySize;
+
+	/**
+	 * @brief The number of elements.
+	 */
+	uint32_t length;
+
+	/**
+	 * @brief The number of slots. This is always 0 or a power of two.
+	 */
+	uint32_t capacity;
+
+	/**
+	 * @brief The entries for each slot.
+	 *
+	 * Each entry starts with the hash, which is 0 for empty slots, followed by the key and value.
+	 */
+	uint8_t* entries;
+} dsFlatHashMap;
+
 #ifdef __cplusplus
 }
 #endif
@@ -0,0 +1,115 @@
+/*
+ * Copyright 2020 Aaron Barany
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <DeepSea/Core/Config.h>
+#include <DeepSea/Core/Export.h>
+#include <DeepSea/Core/Memory/Types.h>
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+/**
+ * @file
+ * @brief Implementation of dsAllocator for transient memory that's recycled every few frames.
+ *
+ * Memory is allocated linearly from chunks, and each thread allocates from its own chunk so
+ * multiple threads may allocate without locking. A lock is only taken when a thread needs a new
+ * chunk. Individual allocations can't be freed. Instead, the chunks allocated during a frame are
+ * recycled once dsFrameAllocator_beginFrame() has been called for frameCount more frames.
+ *
+ * The size member of dsAllocator is the total size of the chunks used by the frames that are
+ * still alive. The allocation counts aren't tracked to avoid synchronization between threads.
+ *
+ * @see dsFrameAllocator
+ */
+
+/**
+ * @brief The maximum number of frames memory may be kept alive for.
+ */
+#define DS_MAX_FRAME_ALLOCATOR_FRAMES 4
+
+/**
+ * @brief The default size of each chunk to allocate from.
+ */
+#define DS_DEFAULT_FRAME_ALLOCATOR_CHUNK_SIZE 65536
+
+/**
+ * @brief Creates a frame allocator.
+ * @remark errno will be set on failure.
+ * @param allocator The allocator to create the frame allocator and its chunks with. This must
+ *     support freeing memory.
+ * @param frameCount The number of frames memory stays alive for. This must be between 1 and
+ *     DS_MAX_FRAME_ALLOCATOR_FRAMES.
+ * @param chunkSize The size of each chunk to allocate from. Allocations larger than this will have
+ *     their own chunk. Set to 0 to use DS_DEFAULT_FRAME_ALLOCATOR_CHUNK_SIZE.
+ * @return The frame allocator or NULL if it couldn't be created.
+ */
+DS_CORE_EXPORT dsFrameAllocator* dsFrameAllocator_create(dsAllocator* allocator,
+	uint32_t frameCount, size_t chunkSize);
+
+/**
+ * @brief Allocates memory from the frame allocator.
+ *
+ * This may be called from any thread. The memory will remain valid until
+ * dsFrameAllocator_beginFrame() has been called frameCount more times.
+ *
+ * @remark errno will be set on failure.
+ * @param allocator The allocator to allocate from.
+ * @param size The size to allocate.
+ * @param alignment The minimum alignment for the allocation.
+ * @return The allocated memory or NULL if an error occured.
+ */
+DS_CORE_EXPORT void* dsFrameAllocator_alloc(dsFrameAllocator* allocator, size_t size,
+	unsigned int alignment);
+
+/**
+ * @brief Gets the current frame number for the frame allocator.
+ * @param allocator The allocator.
+ * @return The frame number.
+ */
+DS_CORE_EXPORT uint64_t dsFrameAllocator_getFrameNumber(const dsFrameAllocator* allocator);
+
+/**
+ * @brief Begins a new frame, recycling the memory from frameCount frames earlier.
+ *
+ * This is called automatically for the frame allocator of dsRenderer. No other threads may
+ * allocate from the allocator at the same time.
+ *
+ * @remark errno will be set on failure.
+ * @param allocator The allocator.
+ * @param frameNumber The number of the new frame. This must be larger than the current frame
+ *     number.
+ * @return False if the frame couldn't be started.
+ */
+DS_CORE_EXPORT bool dsFrameAllocator_beginFrame(dsFrameAllocator* allocator, uint64_t frameNumber);
+
+/**
+ * @brief Destroys a frame allocator.
+ *
+ * All memory allocated from the frame allocator will be freed. No other threads may use the
+ * allocator at the same time.
+ *
+ * @param allocator The allocator to destroy.
+ */
+DS_CORE_EXPORT void dsFrameAllocator_destroy(dsFrameAllocator* allocator);
+
+#ifdef __cplusplus
+}
+#endif
@@ -31,6 +31,11 @@ extern "C"
  *
  * The pool of memory is pre-allocated and all allocations are the same size.
  *
+ * By default allocations are protected by a spinlock. Pools initialized with
+ * dsPoolAllocator_initializeLockFree() instead use a lock-free free list, and may optionally cache
+ * chunks for each thread in "magazines" that are moved to and from the shared free list in
+ * batches. This allows allocation throughput to scale with the number of threads.
+ *
  * @see dsPoolAllocator
  */
 
@@ -56,6 +61,29 @@ DS_CORE_EXPORT size_t dsPoolAllocator_bufferSize(size_t chunkSize, size_t chunkC
 DS_CORE_EXPORT bool dsPoolAllocator_initialize(dsPoolAllocator* allocator, size_t chunkSize,
 	size_t chunkCount, void* buffer, size_t bufferSize);
 
+/**
+ * @brief Initializes the pool allocator to allocate without locking.
+ *
+ * When magazineSize is non-zero, one chunk is used to store the magazine for each thread that
+ * allocates or frees from the pool. Chunks cached in magazines are considered allocated for the
+ * size, allocation counts, and freeCount, which are only updated when chunks are moved to or from
+ * the shared free list. Threads should call dsPoolAllocator_flushThread() before exiting to return
+ * their chunks to the pool.
+ *
+ * @remark errno will be set on failure.
+ * @param allocator The allcoator to initialize.
+ * @param chunkSize The size of each chunk.
+ * @param chunkCount The number of chunks to have available. This must be less than 2^32 - 1.
+ * @param buffer The buffer of memory to allocate from. This must be aligned by DS_ALLOC_ALIGNMENT.
+ * @param bufferSize The size of the buffer. This must be the same size as calling
+ *     dsPoolAllocator_bufferSize().
+ * @param magazineSize The number of chunks to move between the magazine for each thread and the
+ *     shared free list at once. Set to 0 to disable the magazines.
+ * @return False if any of the parameters are invalid.
+ */
+DS_CORE_EXPORT bool dsPoolAllocator_initializeLockFree(dsPoolAllocator* allocator,
+	size_t chunkSize, size_t chunkCount, void* buffer, size_t bufferSize, uint32_t magazineSize);
+
 /**
  * @brief Allocates memory from the pool allocator.
  * @remark errno will be set on failure.
@@ -77,6 +105,18 @@ DS_CORE_EXPORT void* dsPoolAllocator_alloc(dsPoolAllocator* allocator, size_t si
  */
 DS_CORE_EXPORT bool dsPoolAllocator_free(dsPoolAllocator* allocator, void* ptr);
 
+/**
+ * @brief Returns the chunks cached for the current thread to the pool.
+ *
+ * This should be called before a thread that used a lock-free pool with magazines exits. This does
+ * nothing for other pools.
+ *
+ * @remark errno will be set on failure.
+ * @param allocator The allocator.
+ * @return False if allocator is invalid.
+ */
+DS_CORE_EXPORT bool dsPoolAllocator_flushThread(dsPoolAllocator* allocator);
+
 /**
  * @brief Resets the pool allocator to be empty.
  *
@@ -91,7 +131,8 @@ DS_CORE_EXPORT bool dsPoolAllocator_reset(dsPoolAllocator* allocator);
 /**
  * @brief Validates the consistency of the allocator.
  *
- * This can help make sure that there were no buffer overruns
+ * This can help make sure that there were no buffer overruns. For lock-free pools, this may not be
+ * called while other threads are using the pool.
  *
  * @param allocator The allocator to validate.
  * @return True if the allocator is valid. This will not set errno.
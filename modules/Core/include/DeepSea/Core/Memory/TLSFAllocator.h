@@ -0,0 +1,145 @@
+/*
+ * Copyright 2020 Aaron Barany
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <DeepSea/Core/Config.h>
+#include <DeepSea/Core/Export.h>
+#include <DeepSea/Core/Memory/Types.h>
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+/**
+ * @file
+ * @brief Implementation of dsAllocator using a two-level segregated fit (TLSF) algorithm.
+ *
+ * Variable-sized allocations are taken from a pre-allocated buffer. Free blocks are kept in lists
+ * segregated by size, with bitmasks to find a suitable list, so allocating and freeing take
+ * constant time regardless of the number of allocations. Adjacent free blocks are merged when
+ * freeing, and realloc will shrink or grow the allocation in place when possible.
+ *
+ * Each allocation has a header of DS_TLSF_BLOCK_HEADER_SIZE bytes. Allocations are protected by a
+ * spinlock.
+ *
+ * @see dsTLSFAllocator
+ */
+
+/**
+ * @brief The size of the header for each allocation.
+ */
+#define DS_TLSF_BLOCK_HEADER_SIZE 16
+
+/**
+ * @brief The minimum buffer size for a TLSF allocator.
+ */
+#define DS_TLSF_MIN_BUFFER_SIZE (DS_TLSF_BLOCK_HEADER_SIZE*3)
+
+/**
+ * @brief Initializes the TLSF allocator.
+ * @remark errno will be set on failure.
+ * @param allocator The allocator to initialize.
+ * @param buffer The buffer of memory to allocate from. This must be aligned by DS_ALLOC_ALIGNMENT.
+ * @param bufferSize The size of the buffer. This must be at least DS_TLSF_MIN_BUFFER_SIZE and no
+ *     larger than DS_TLSF_MAX_SIZE.
+ * @return False if any of the parameters are invalid.
+ */
+DS_CORE_EXPORT bool dsTLSFAllocator_initialize(dsTLSFAllocator* allocator, void* buffer,
+	size_t bufferSize);
+
+/**
+ * @brief Allocates memory from the TLSF allocator.
+ * @remark errno will be set on failure.
+ * @param allocator The allocator to allocate from.
+ * @param size The size to allocate.
+ * @param alignment The minimum alignment of the allocation. This must be a power of two.
+ * @return The allocated memory or NULL if an error occured.
+ */
+DS_CORE_EXPORT void* dsTLSFAllocator_alloc(dsTLSFAllocator* allocator, size_t size,
+	unsigned int alignment);
+
+/**
+ * @brief Reallocates memory from the TLSF allocator.
+ *
+ * The memory will be resized in place when shrinking or when the block following the allocation is
+ * free and large enough. Otherwise new memory will be allocated and the contents copied.
+ *
+ * @remark errno will be set on failure.
+ * @param allocator The allocator to allocate from.
+ * @param ptr The memory to reallocate. If NULL, this is equivalent to dsTLSFAllocator_alloc().
+ * @param size The new size. If 0, ptr will be freed and NULL returned.
+ * @param alignment The minimum alignment of the allocation. This must be a power of two.
+ * @return The reallocated memory or NULL if an error occured.
+ */
+DS_CORE_EXPORT void* dsTLSFAllocator_realloc(dsTLSFAllocator* allocator, void* ptr, size_t size,
+	unsigned int alignment);
+
+/**
+ * @brief Frees memory from the TLSF allocator.
+ * @remark errno will be set on failure.
+ * @param allocator The allocator to free from.
+ * @param ptr The memory pointer to free.
+ * @return True if the memory could be freed.
+ */
+DS_CORE_EXPORT bool dsTLSFAllocator_free(dsTLSFAllocator* allocator, void* ptr);
+
+/**
+ * @brief Gets statistics for the free memory.
+ *
+ * This is intended for monitoring fragmentation, and scales with the number of free blocks in the
+ * free list with the largest sizes.
+ *
+ * @remark errno will be set on failure.
+ * @param[out] outStats The free statistics.
+ * @param allocator The allocator.
+ * @return False if the parameters are invalid.
+ */
+DS_CORE_EXPORT bool dsTLSFAllocator_getFreeStats(dsTLSFFreeStats* outStats,
+	dsTLSFAllocator* allocator);
+
+/**
+ * @brief Resets the TLSF allocator to be empty.
+ *
+ * This should only be used when no destruction is needed for the contents.
+ *
+ * @remark errno will be set on failure.
+ * @param allocator The allocator to reset.
+ * @return True if the allocator is valid.
+ */
+DS_CORE_EXPORT bool dsTLSFAllocator_reset(dsTLSFAllocator* allocator);
+
+/**
+ * @brief Validates the consistency of the allocator.
+ *
+ * This walks all blocks, and can help make sure that there were no buffer overruns.
+ *
+ * @param allocator The allocator to validate.
+ * @return True if the allocator is valid. This will not set errno.
+ */
+DS_CORE_EXPORT bool dsTLSFAllocator_validate(dsTLSFAllocator* allocator);
+
+/**
+ * @brief Shuts down the TLSF allocator.
+ * @remark The buffer itself will not be freed.
+ * @param allocator The allocator to shut down. This will be cleared.
+ */
+DS_CORE_EXPORT void dsTLSFAllocator_shutdown(dsTLSFAllocator* allocator);
+
+#ifdef __cplusplus
+}
+#endif
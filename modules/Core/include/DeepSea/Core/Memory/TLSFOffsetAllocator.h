@@ -0,0 +1,147 @@
+/*
+ * Copyright 2020 Aaron Barany
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <DeepSea/Core/Config.h>
+#include <DeepSea/Core/Export.h>
+#include <DeepSea/Core/Memory/Types.h>
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+/**
+ * @file
+ * @brief Functions for sub-allocating ranges with a TLSF allocator that only manages offsets.
+ *
+ * This uses the same algorithm as dsTLSFAllocator, but the bookkeeping for each block is stored
+ * outside of the memory being managed. This makes it suitable for sub-allocating memory that
+ * can't be directly accessed by the CPU, such as GPU buffers or heaps. Allocations are referred to
+ * by handle and take constant time.
+ *
+ * Offsets and sizes are multiples of 16 bytes. Functions on the same allocator aren't thread-safe.
+ *
+ * @see dsTLSFOffsetAllocator
+ */
+
+/**
+ * @brief Value for an invalid allocation handle.
+ */
+#define DS_INVALID_TLSF_HANDLE ((uint32_t)-1)
+
+/**
+ * @brief Creates a TLSF offset allocator.
+ * @remark errno will be set on failure.
+ * @param allocator The allocator to create the offset allocator with.
+ * @param size The size of the range to sub-allocate. This will be rounded down to a multiple of
+ *     16.
+ * @param maxAllocations The maximum number of allocations that may be active at once.
+ * @return The offset allocator or NULL if it couldn't be created.
+ */
+DS_CORE_EXPORT dsTLSFOffsetAllocator* dsTLSFOffsetAllocator_create(dsAllocator* allocator,
+	size_t size, uint32_t maxAllocations);
+
+/**
+ * @brief Allocates a range from the offset allocator.
+ * @remark errno will be set on failure.
+ * @param[out] outOffset The offset of the allocated range.
+ * @param allocator The allocator to allocate from.
+ * @param size The size to allocate.
+ * @param alignment The minimum alignment of the offset. This must be a power of two.
+ * @return The handle for the allocation or DS_INVALID_TLSF_HANDLE if it couldn't be allocated.
+ */
+DS_CORE_EXPORT uint32_t dsTLSFOffsetAllocator_alloc(size_t* outOffset,
+	dsTLSFOffsetAllocator* allocator, size_t size, size_t alignment);
+
+/**
+ * @brief Resizes an allocation in place.
+ *
+ * Shrinking will always succeed. Growing will only succeed when the range following the
+ * allocation is free and large enough.
+ *
+ * @remark errno will be set on failure.
+ * @param allocator The allocator the range was allocated from.
+ * @param handle The handle for the allocation.
+ * @param size The new size for the allocation.
+ * @return False if the allocation couldn't be resized.
+ */
+DS_CORE_EXPORT bool dsTLSFOffsetAllocator_resize(dsTLSFOffsetAllocator* allocator,
+	uint32_t handle, size_t size);
+
+/**
+ * @brief Frees an allocation.
+ * @remark errno will be set on failure.
+ * @param allocator The allocator the range was allocated from.
+ * @param handle The handle for the allocation.
+ * @return False if the handle is invalid.
+ */
+DS_CORE_EXPORT bool dsTLSFOffsetAllocator_free(dsTLSFOffsetAllocator* allocator, uint32_t handle);
+
+/**
+ * @brief Gets the offset of an allocation.
+ * @param allocator The allocator the range was allocated from.
+ * @param handle The handle for the allocation.
+ * @return The offset of the allocation.
+ */
+DS_CORE_EXPORT size_t dsTLSFOffsetAllocator_getOffset(const dsTLSFOffsetAllocator* allocator,
+	uint32_t handle);
+
+/**
+ * @brief Gets the size of an allocation.
+ *
+ * This may be larger than the requested size.
+ *
+ * @param allocator The allocator the range was allocated from.
+ * @param handle The handle for the allocation.
+ * @return The size of the allocation or 0 if the handle is invalid.
+ */
+DS_CORE_EXPORT size_t dsTLSFOffsetAllocator_getSize(const dsTLSFOffsetAllocator* allocator,
+	uint32_t handle);
+
+/**
+ * @brief Gets statistics for the free ranges.
+ * @remark errno will be set on failure.
+ * @param[out] outStats The free statistics.
+ * @param allocator The allocator.
+ * @return False if the parameters are invalid.
+ */
+DS_CORE_EXPORT bool dsTLSFOffsetAllocator_getFreeStats(dsTLSFFreeStats* outStats,
+	const dsTLSFOffsetAllocator* allocator);
+
+/**
+ * @brief Frees all allocations.
+ * @param allocator The allocator to reset.
+ */
+DS_CORE_EXPORT void dsTLSFOffsetAllocator_reset(dsTLSFOffsetAllocator* allocator);
+
+/**
+ * @brief Validates the consistency of the allocator.
+ * @param allocator The allocator to validate.
+ * @return True if the allocator is valid. This will not set errno.
+ */
+DS_CORE_EXPORT bool dsTLSFOffsetAllocator_validate(const dsTLSFOffsetAllocator* allocator);
+
+/**
+ * @brief Destroys a TLSF offset allocator.
+ * @param allocator The allocator to destroy.
+ */
+DS_CORE_EXPORT void dsTLSFOffsetAllocator_destroy(dsTLSFOffsetAllocator* allocator);
+
+#ifdef __cplusplus
+}
+#endif
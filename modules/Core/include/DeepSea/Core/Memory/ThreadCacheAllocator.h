@@ -0,0 +1,137 @@
+/*
+ * Copyright 2020 Aaron Barany
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <DeepSea/Core/Config.h>
+#include <DeepSea/Core/Export.h>
+#include <DeepSea/Core/Memory/Types.h>
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+/**
+ * @file
+ * @brief Implementation of dsAllocator that keeps a cache of free memory for each thread.
+ *
+ * Small allocations are grouped into size classes. Each thread keeps a free list for each size
+ * class, which is refilled from and returned to a shared free list in batches. This means most
+ * allocations and frees don't touch any memory shared with other threads, avoiding contention
+ * when allocating from many threads at once. Memory is taken from an internal system allocator in
+ * large spans, which is also used directly for large allocations.
+ *
+ * The statistics for the allocator are kept separately for each thread and are only combined into
+ * the dsAllocator members when calling dsThreadCacheAllocator_updateStats(). The limit is applied
+ * to the memory taken from the system allocator, which includes memory cached by each thread.
+ *
+ * Threads should call dsThreadCacheAllocator_flushThread() before they exit to return their free
+ * memory so it may be used by other threads.
+ *
+ * @see dsThreadCacheAllocator
+ */
+
+/**
+ * @brief The maximum size of an allocation that will use the thread caches.
+ *
+ * Larger allocations will be taken directly from the system allocator.
+ */
+#define DS_THREAD_CACHE_MAX_SIZE 32752
+
+/**
+ * @brief Initializes a thread cache allocator.
+ * @remark errno will be set on failure.
+ * @param[out] allocator The allocator to initialize.
+ * @param limit The limit for the allocator. Set to DS_ALLOCATOR_NO_LIMIT to have no limit.
+ * @return False if the allocator couldn't be initialized.
+ */
+DS_CORE_EXPORT bool dsThreadCacheAllocator_initialize(dsThreadCacheAllocator* allocator,
+	size_t limit);
+
+/**
+ * @brief Allocates memory from the thread cache allocator.
+ * @remark errno will be set on failure.
+ * @param allocator The allocator to allocate from.
+ * @param size The size to allocate.
+ * @param alignment The minimum alignment for the allocation. Alignments larger than
+ *     DS_ALLOC_ALIGNMENT will be allocated directly from the system allocator.
+ * @return The allocated memory or NULL if an error occured.
+ */
+DS_CORE_EXPORT void* dsThreadCacheAllocator_alloc(dsThreadCacheAllocator* allocator, size_t size,
+	unsigned int alignment);
+
+/**
+ * @brief Re-allocates memory from the thread cache allocator.
+ * @remark errno will be set on failure.
+ * @param allocator The allocator to allocate from.
+ * @param ptr The original pointer to reallocate.
+ * @param size The size to allocate.
+ * @param alignment The minimum alignment for the allocation.
+ * @return The allocated memory or NULL. If NULL and size isn't 0, an error occurred.
+ */
+DS_CORE_EXPORT void* dsThreadCacheAllocator_realloc(dsThreadCacheAllocator* allocator, void* ptr,
+	size_t size, unsigned int alignment);
+
+/**
+ * @brief Frees memory from the thread cache allocator.
+ *
+ * The memory may be freed from a different thread than it was allocated from.
+ *
+ * @remark errno will be set on failure.
+ * @param allocator The allocator to free from.
+ * @param ptr The memory pointer to free.
+ * @return True if the memory could be freed.
+ */
+DS_CORE_EXPORT bool dsThreadCacheAllocator_free(dsThreadCacheAllocator* allocator, void* ptr);
+
+/**
+ * @brief Returns the free memory cached for the current thread so it may be used by other threads.
+ *
+ * This should be called before a thread that allocated from the allocator exits. The current
+ * thread may continue to allocate from the allocator afterward.
+ *
+ * @remark errno will be set on failure.
+ * @param allocator The allocator.
+ * @return False if allocator is NULL.
+ */
+DS_CORE_EXPORT bool dsThreadCacheAllocator_flushThread(dsThreadCacheAllocator* allocator);
+
+/**
+ * @brief Updates the size and allocation counts of the dsAllocator members.
+ *
+ * This combines the statistics from each thread. The results may be out of date if other threads
+ * are allocating at the same time.
+ *
+ * @remark errno will be set on failure.
+ * @param allocator The allocator.
+ * @return False if allocator is NULL.
+ */
+DS_CORE_EXPORT bool dsThreadCacheAllocator_updateStats(dsThreadCacheAllocator* allocator);
+
+/**
+ * @brief Shuts down the thread cache allocator.
+ *
+ * This frees all memory held by the allocator. All memory allocated from it must have been freed
+ * and no other threads may use the allocator at the same time.
+ *
+ * @param allocator The allocator to shut down.
+ */
+DS_CORE_EXPORT void dsThreadCacheAllocator_shutdown(dsThreadCacheAllocator* allocator);
+
+#ifdef __cplusplus
+}
+#endif
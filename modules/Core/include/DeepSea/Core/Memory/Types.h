@@ -268,8 +268,221 @@ typedef struct dsPoolAllocator
 	 * @brief Lock used to protect allocation.
 	 */
 	dsSpinlock lock;
+
+	/**
+	 * @brief The head of the free list when lock-free.
+	 *
+	 * The lower 32 bits are the index of the head chunk, while the upper 32 bits are a tag that's
+	 * incremented with each change to avoid the ABA problem.
+	 */
+	uint64_t taggedHead;
+
+	/**
+	 * @brief The number of chunks cached for each thread when lock-free, or 0 if chunks aren't
+	 *     cached.
+	 */
+	uint32_t magazineSize;
+
+	/**
+	 * @brief Whether or not the allocator is lock-free.
+	 */
+	bool lockFree;
+
+	/**
+	 * @brief Thread storage for the chunks cached for each thread.
+	 */
+	dsThreadStorage magazineStorage;
 } dsPoolAllocator;
 
+/**
+ * @brief Struct for the cache of free memory for a single thread in a dsThreadCacheAllocator.
+ * @see ThreadCacheAllocator.h
+ */
+typedef struct dsThreadCache dsThreadCache;
+
+/**
+ * @brief Struct for the free lists shared between threads in a dsThreadCacheAllocator.
+ * @see ThreadCacheAllocator.h
+ */
+typedef struct dsThreadCacheCentralList dsThreadCacheCentralList;
+
+/**
+ * @brief Structure for a thread cache allocator, which keeps a cache of free memory for each
+ *     thread in front of a system allocator.
+ *
+ * This is effectively a subclass of dsAllocator and a pointer to dsThreadCacheAllocator can be
+ * freely cast between the two types.
+ *
+ * The members of dsAllocator are only updated when calling dsThreadCacheAllocator_updateStats().
+ *
+ * @remark Manually changing the values in this structure can cause bad memory access.
+ *
+ * @see ThreadCacheAllocator.h
+ */
+typedef struct dsThreadCacheAllocator
+{
+	/**
+	 * @brief The base allocator.
+	 */
+	dsAllocator allocator;
+
+	/**
+	 * @brief The system allocator that memory is taken from.
+	 *
+	 * The size of this allocator includes the memory cached by each thread, and is used to enforce
+	 * the limit.
+	 */
+	dsSystemAllocator systemAllocator;
+
+	/**
+	 * @brief Thread storage for the cache of the current thread.
+	 */
+	dsThreadStorage threadStorage;
+
+	/**
+	 * @brief Lock used to protect the list of thread caches.
+	 */
+	dsSpinlock cacheLock;
+
+	/**
+	 * @brief The caches for each thread that has allocated from this allocator.
+	 */
+	dsThreadCache* caches;
+
+	/**
+	 * @brief The free lists for each size class that are shared between threads.
+	 */
+	dsThreadCacheCentralList* centralLists;
+} dsThreadCacheAllocator;
+
+/**
+ * @brief Struct for an allocator of transient memory that is recycled after a number of frames.
+ *
+ * This is effectively a subclass of dsAllocator and a pointer to dsFrameAllocator can be freely
+ * cast between the two types.
+ *
+ * @see FrameAllocator.h
+ */
+typedef struct dsFrameAllocator dsFrameAllocator;
+
+/**
+ * @brief The number of first-level free lists for TLSF allocators.
+ */
+#define DS_TLSF_FIRST_LEVEL_COUNT 32
+
+/**
+ * @brief The number of second-level free lists for each first level for TLSF allocators.
+ */
+#define DS_TLSF_SECOND_LEVEL_COUNT 16
+
+/**
+ * @brief The maximum size that may be managed by TLSF allocators.
+ */
+#if DS_64BIT
+#define DS_TLSF_MAX_SIZE (((size_t)1 << 39) - 1)
+#else
+#define DS_TLSF_MAX_SIZE ((size_t)-1)
+#endif
+
+/**
+ * @brief Structure for a two-level segregated fit (TLSF) allocator.
+ *
+ * This is effectively a subclass of dsAllocator and a pointer to dsTLSFAllocator can be freely
+ * cast between the two types.
+ *
+ * Variable-sized allocations are taken from a pre-allocated buffer, with allocations and frees
+ * taking constant time. The size member of dsAllocator includes the headers for each allocation.
+ *
+ * @remark Manually changing the values in this structure can cause bad memory access.
+ *
+ * @see TLSFAllocator.h
+ */
+typedef struct dsTLSFAllocator
+{
+	/**
+	 * @brief The base allocator.
+	 */
+	dsAllocator allocator;
+
+	/**
+	 * @brief The buffer that memory is taken from.
+	 */
+	void* buffer;
+
+	/**
+	 * @brief The full size of the buffer.
+	 */
+	size_t bufferSize;
+
+	/**
+	 * @brief The total size of the free blocks.
+	 */
+	size_t freeSize;
+
+	/**
+	 * @brief The number of free blocks.
+	 */
+	uint32_t freeBlockCount;
+
+	/**
+	 * @brief Bitmask for which first-level free lists have any free blocks.
+	 */
+	uint32_t firstLevelBitmap;
+
+	/**
+	 * @brief Bitmasks for which second-level free lists have any free blocks.
+	 */
+	uint32_t secondLevelBitmaps[DS_TLSF_FIRST_LEVEL_COUNT];
+
+	/**
+	 * @brief The heads of the free lists.
+	 */
+	void* freeLists[DS_TLSF_FIRST_LEVEL_COUNT][DS_TLSF_SECOND_LEVEL_COUNT];
+
+	/**
+	 * @brief Lock used to protect allocation.
+	 */
+	dsSpinlock lock;
+} dsTLSFAllocator;
+
+/**
+ * @brief Struct for a TLSF allocator that only manages offsets within a range.
+ *
+ * This is used to sub-allocate memory that isn't directly accessible, such as GPU buffers.
+ *
+ * @see TLSFOffsetAllocator.h
+ */
+typedef struct dsTLSFOffsetAllocator dsTLSFOffsetAllocator;
+
+/**
+ * @brief Statistics for the free memory within a TLSF allocator.
+ */
+typedef struct dsTLSFFreeStats
+{
+	/**
+	 * @brief The total size of the free blocks.
+	 */
+	size_t freeSize;
+
+	/**
+	 * @brief The size of the largest free block.
+	 */
+	size_t largestFreeBlock;
+
+	/**
+	 * @brief The number of free blocks.
+	 */
+	uint32_t freeBlockCount;
+
+	/**
+	 * @brief The fragmentation of the free memory.
+	 *
+	 * This is 0 when all free memory is in a single block, and approaches 1 as the free memory is
+	 * split into smaller blocks.
+	 */
+	float fragmentation;
+} dsTLSFFreeStats;
+
 /**
  * @brief Structure to determine if an object is still alive.
  * @see Lifetime.h
@@ -0,0 +1,143 @@
+/*
+ * Copyright 2020 Aaron Barany
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <DeepSea/Core/Config.h>
+#include <DeepSea/Core/Export.h>
+#include <DeepSea/Core/Types.h>
+
+#if DS_X86_32 || DS_X86_64
+#include <immintrin.h>
+#elif DS_ARM_64 || (DS_ARM_32 && defined(__ARM_NEON))
+#include <arm_neon.h>
+#endif
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+/**
+ * @file
+ * @brief Macros and functions for using SIMD instructions.
+ *
+ * The DS_SIMD_ALWAYS_* macros are set to 1 when the instructions are guaranteed to be available
+ * based on the compiler flags. Otherwise, the instructions may still be used when
+ * dsSIMD_getHostFeatures() reports they are available. Functions that use these instructions
+ * without them being guaranteed must be declared with the matching DS_SIMD_FUNC_* macro, and must
+ * only be called once the features have been checked.
+ *
+ * The intrinsics for the current platform are also included.
+ */
+
+/**
+ * @brief Define for whether or not SIMD instructions may be used on the current platform.
+ */
+#if DS_X86_32 || DS_X86_64 || DS_ARM_64 || (DS_ARM_32 && defined(__ARM_NEON))
+#define DS_HAS_SIMD 1
+#else
+#define DS_HAS_SIMD 0
+#endif
+
+/**
+ * @brief Define for whether or not dsSIMDFeatures_Float4 is always available.
+ */
+#if DS_X86_64 || defined(__SSE__) || (defined(_M_IX86_FP) && _M_IX86_FP >= 1) || \
+	DS_ARM_64 || (DS_ARM_32 && defined(__ARM_NEON))
+#define DS_SIMD_ALWAYS_FLOAT4 1
+#else
+#define DS_SIMD_ALWAYS_FLOAT4 0
+#endif
+
+/**
+ * @brief Define for whether or not dsSIMDFeatures_HAdd is always available.
+ */
+#if defined(__SSE3__) || defined(__AVX__) || DS_ARM_64
+#define DS_SIMD_ALWAYS_HADD 1
+#else
+#define DS_SIMD_ALWAYS_HADD 0
+#endif
+
+/**
+ * @brief Define for whether or not dsSIMDFeatures_FMA is always available.
+ */
+#if defined(__FMA__) || DS_ARM_64
+#define DS_SIMD_ALWAYS_FMA 1
+#else
+#define DS_SIMD_ALWAYS_FMA 0
+#endif
+
+/**
+ * @brief Define for whether or not dsSIMDFeatures_Float8 is always available.
+ */
+#if defined(__AVX__)
+#define DS_SIMD_ALWAYS_FLOAT8 1
+#else
+#define DS_SIMD_ALWAYS_FLOAT8 0
+#endif
+
+/**
+ * @brief Marks a function as using dsSIMDFeatures_Float4 instructions.
+ */
+#if (DS_GCC || DS_CLANG) && (DS_X86_32 || DS_X86_64)
+#define DS_SIMD_FUNC_FLOAT4 __attribute__((target("sse")))
+#else
+#define DS_SIMD_FUNC_FLOAT4
+#endif
+
+/**
+ * @brief Marks a function as using dsSIMDFeatures_HAdd instructions.
+ */
+#if (DS_GCC || DS_CLANG) && (DS_X86_32 || DS_X86_64)
+#define DS_SIMD_FUNC_HADD __attribute__((target("sse3")))
+#else
+#define DS_SIMD_FUNC_HADD
+#endif
+
+/**
+ * @brief Marks a function as using dsSIMDFeatures_FMA instructions.
+ *
+ * On x86 this also allows dsSIMDFeatures_Float8 instructions since FMA requires AVX.
+ */
+#if (DS_GCC || DS_CLANG) && (DS_X86_32 || DS_X86_64)
+#define DS_SIMD_FUNC_FMA __attribute__((target("avx,fma")))
+#else
+#define DS_SIMD_FUNC_FMA
+#endif
+
+/**
+ * @brief Marks a function as using dsSIMDFeatures_Float8 instructions.
+ */
+#if (DS_GCC || DS_CLANG) && (DS_X86_32 || DS_X86_64)
+#define DS_SIMD_FUNC_FLOAT8 __attribute__((target("avx")))
+#else
+#define DS_SIMD_FUNC_FLOAT8
+#endif
+
+/**
+ * @brief Gets the SIMD features available on the host CPU.
+ *
+ * The features are only queried the first time this is called, so it's cheap to call before
+ * choosing which implementation to use.
+ *
+ * @return The available SIMD features.
+ */
+DS_CORE_EXPORT dsSIMDFeatures dsSIMD_getHostFeatures(void);
+
+#ifdef __cplusplus
+}
+#endif
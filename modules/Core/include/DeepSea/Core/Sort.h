@@ -18,6 +18,8 @@
 
 #include <DeepSea/Core/Config.h>
 #include <DeepSea/Core/Export.h>
+#include <DeepSea/Core/Memory/Types.h>
+#include <DeepSea/Core/Thread/Types.h>
 #include <DeepSea/Core/Types.h>
 
 #ifdef __cplusplus
@@ -28,6 +30,11 @@ extern "C"
 /**
  * @file
  * @brief Functions for sorting and working with sortad array.
+ *
+ * dsSort() is a general purpose sort through a comparison function. To avoid the indirect call
+ * per comparison for a known type, see DS_DEFINE_TYPED_SORT() in TypedSort.h. Integer and float
+ * arrays may be sorted in linear time with the radix sort functions, and large arrays may be
+ * sorted across threads with dsParallelSort().
  */
 
 /**
@@ -45,6 +52,115 @@ extern "C"
 DS_CORE_EXPORT void dsSort(void* array, size_t memberCount, size_t memberSize,
 	dsSortCompareFunction compareFunc, void* context);
 
+/**
+ * @brief Sorts an array of sort keys with a radix sort.
+ *
+ * This performs a least significant digit radix sort with 8 bits per pass. Passes where every key
+ * has the same digit are skipped, so keys that only use some of the bits are faster to sort.
+ *
+ * The sort is stable, so keys that are equal will keep the same relative order.
+ *
+ * @param keys The keys to sort.
+ * @param tempKeys Temporary keys to use during sorting. This must have at least keyCount elements.
+ * @param keyCount The number of keys.
+ * @return Either keys or tempKeys, whichever contains the sorted result, or NULL if keys or
+ *     tempKeys is NULL.
+ */
+DS_CORE_EXPORT dsSortKey* dsRadixSortKeys(dsSortKey* keys, dsSortKey* tempKeys, size_t keyCount);
+
+/**
+ * @brief Sorts an array of 32-bit unsigned integers with a radix sort.
+ *
+ * This has the same behavior as dsRadixSortKeys(), skipping passes where all values have the same
+ * digit.
+ *
+ * @param values The values to sort.
+ * @param tempValues Temporary values to use during sorting. This must have at least valueCount
+ *     elements.
+ * @param valueCount The number of values.
+ * @return Either values or tempValues, whichever contains the sorted result, or NULL if values or
+ *     tempValues is NULL.
+ */
+DS_CORE_EXPORT uint32_t* dsRadixSortUInt32(uint32_t* values, uint32_t* tempValues,
+	size_t valueCount);
+
+/**
+ * @brief Sorts an array of 64-bit unsigned integers with a radix sort.
+ * @param values The values to sort.
+ * @param tempValues Temporary values to use during sorting. This must have at least valueCount
+ *     elements.
+ * @param valueCount The number of values.
+ * @return Either values or tempValues, whichever contains the sorted result, or NULL if values or
+ *     tempValues is NULL.
+ */
+DS_CORE_EXPORT uint64_t* dsRadixSortUInt64(uint64_t* values, uint64_t* tempValues,
+	size_t valueCount);
+
+/**
+ * @brief Sorts an array of floats with a radix sort.
+ *
+ * Values are ordered the same as dsSortKeyFromFloat(), so negative values are sorted before
+ * positive values and -0 is sorted before 0. NaN values are sorted at the start or end based on
+ * their sign bit.
+ *
+ * @param values The values to sort.
+ * @param tempValues Temporary values to use during sorting. This must have at least valueCount
+ *     elements.
+ * @param valueCount The number of values.
+ * @return Either values or tempValues, whichever contains the sorted result, or NULL if values or
+ *     tempValues is NULL.
+ */
+DS_CORE_EXPORT float* dsRadixSortFloat(float* values, float* tempValues, size_t valueCount);
+
+/**
+ * @brief Sorts an array across the threads of a thread pool.
+ *
+ * The array is split into chunks that are sorted in parallel with dsSort(), then merged together.
+ * Each merge is also split across the threads so the final merges don't run on a single thread.
+ * Small arrays, or a NULL thread pool, will fall back to dsSort() on the current thread.
+ *
+ * The sort isn't stable. This may be called from within a thread pool task.
+ *
+ * @remark errno will be set on failure.
+ * @param array The array to sort.
+ * @param memberCount The number of members.
+ * @param memberSize The size of each member.
+ * @param compareFunc The comparison function. This will be called from multiple threads.
+ * @param context The context to provide with the comapre function.
+ * @param allocator The allocator to use for the temporary memory. This must support freeing
+ *     memory.
+ * @param threadPool The thread pool to sort with. This may be NULL to sort on the current thread.
+ * @return False if the temporary memory couldn't be allocated.
+ */
+DS_CORE_EXPORT bool dsParallelSort(void* array, size_t memberCount, size_t memberSize,
+	dsSortCompareFunction compareFunc, void* context, dsAllocator* allocator,
+	dsThreadPool* threadPool);
+
+/**
+ * @brief Sorts an array of sort keys with an insertion sort, stopping if it's too far from sorted.
+ *
+ * This is intended for keys that are expected to be almost sorted already, such as when re-using
+ * the order from a previous sort. The sort is stable.
+ *
+ * @param keys The keys to sort.
+ * @param keyCount The number of keys.
+ * @param maxMoves The maximum number of times a key may be moved by a single position.
+ * @return False if the keys couldn't be sorted within maxMoves. In this case the keys will be
+ *     partially sorted, but will still contain the same set of keys.
+ */
+DS_CORE_EXPORT bool dsInsertionSortKeys(dsSortKey* keys, size_t keyCount, size_t maxMoves);
+
+/**
+ * @brief Converts a float to a 32-bit value that may be used in a sort key.
+ *
+ * Comparing the results as unsigned integers gives the same order as comparing the original
+ * floats, with negative values before positive values.
+ *
+ * @param value The value to convert.
+ * @return The value to use in a sort key.
+ */
+DS_CORE_EXPORT inline uint32_t dsSortKeyFromFloat(float value);
+
 /**
  * @brief Performs a binary search on a sorted array.
  * @param key The key to search for.
@@ -86,6 +202,21 @@ DS_CORE_EXPORT void* dsBinarySearchLowerBound(const void* key, const void* array
 DS_CORE_EXPORT void* dsBinarySearchUpperBound(const void* key, const void* array,
 	size_t memberCount, size_t memberSize, dsSortCompareFunction compareFunc, void* context);
 
+DS_CORE_EXPORT inline uint32_t dsSortKeyFromFloat(float value)
+{
+	union
+	{
+		float f;
+		uint32_t i;
+	} bits;
+	bits.f = value;
+
+	// Flip all bits for negative values so larger magnitudes come first, and only the sign bit for
+	// positive values so they come after negative values.
+	uint32_t mask = (uint32_t)-(int32_t)(bits.i >> 31) | 0x80000000;
+	return bits.i ^ mask;
+}
+
 #ifdef __cplusplus
 }
 #endif
@@ -0,0 +1,117 @@
+/*
+ * Copyright 2020 Aaron Barany
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <DeepSea/Core/Config.h>
+#include <DeepSea/Core/Export.h>
+#include <DeepSea/Core/Streams/Types.h>
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+/**
+ * @file
+ * @brief Functions for performing file reads asynchronously.
+ *
+ * Read requests are placed on a queue ordered by priority, and serviced by a set of I/O threads
+ * with positional reads. This allows reads to be issued ahead of time, such as when loading assets,
+ * without blocking the calling thread. A completion function is called for each request once it
+ * finishes, fails, or is canceled.
+ *
+ * All functions are thread-safe.
+ *
+ * @see dsAsyncIO
+ */
+
+/**
+ * @brief Creates an asynchronous I/O service.
+ * @remark errno will be set on failure.
+ * @param allocator The allocator to create the service with. This must support freeing memory.
+ * @param threadCount The number of I/O threads to create. This must be at least 1.
+ * @param stackSize The size of the stack for each thread. Set to 0 for the default size.
+ * @return The asynchronous I/O service or NULL if it couldn't be created.
+ */
+DS_CORE_EXPORT dsAsyncIO* dsAsyncIO_create(dsAllocator* allocator, unsigned int threadCount,
+	unsigned int stackSize);
+
+/**
+ * @brief Gets the number of I/O threads.
+ * @param asyncIO The asynchronous I/O service.
+ * @return The number of threads.
+ */
+DS_CORE_EXPORT unsigned int dsAsyncIO_getThreadCount(const dsAsyncIO* asyncIO);
+
+/**
+ * @brief Queues a read request.
+ * @remark errno will be set on failure.
+ * @param asyncIO The asynchronous I/O service.
+ * @param request The request to queue.
+ * @return The ID of the request, or DS_NO_ASYNC_IO_REQUEST if it couldn't be queued.
+ */
+DS_CORE_EXPORT uint64_t dsAsyncIO_queueRead(dsAsyncIO* asyncIO, const dsAsyncIORequest* request);
+
+/**
+ * @brief Cancels a read request.
+ *
+ * Only requests that haven't been started may be canceled. The completion function will be called
+ * with dsAsyncIOResult_Canceled on the current thread before this returns.
+ *
+ * @remark errno will be set on failure.
+ * @param asyncIO The asynchronous I/O service.
+ * @param requestID The ID of the request to cancel.
+ * @return False if the request couldn't be canceled. errno will be set to ENOTFOUND if the request
+ *     was already started or completed.
+ */
+DS_CORE_EXPORT bool dsAsyncIO_cancel(dsAsyncIO* asyncIO, uint64_t requestID);
+
+/**
+ * @brief Waits for a read request to complete.
+ *
+ * When this returns the completion function for the request will have finished.
+ *
+ * @remark This must not be called within a completion function.
+ * @remark errno will be set on failure.
+ * @param asyncIO The asynchronous I/O service.
+ * @param requestID The ID of the request to wait for.
+ * @return False if the parameters are invalid.
+ */
+DS_CORE_EXPORT bool dsAsyncIO_waitForRequest(dsAsyncIO* asyncIO, uint64_t requestID);
+
+/**
+ * @brief Waits for all queued read requests to complete.
+ * @remark This must not be called within a completion function.
+ * @remark errno will be set on failure.
+ * @param asyncIO The asynchronous I/O service.
+ * @return False if the parameters are invalid.
+ */
+DS_CORE_EXPORT bool dsAsyncIO_waitUntilIdle(dsAsyncIO* asyncIO);
+
+/**
+ * @brief Destroys an asynchronous I/O service.
+ *
+ * Any requests that haven't been started will be canceled, and requests currently being executed
+ * will be completed before this returns.
+ *
+ * @param asyncIO The asynchronous I/O service to destroy.
+ */
+DS_CORE_EXPORT void dsAsyncIO_destroy(dsAsyncIO* asyncIO);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,114 @@
+/*
+ * Copyright 2020 Aaron Barany
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <DeepSea/Core/Config.h>
+#include <DeepSea/Core/Export.h>
+#include <DeepSea/Core/Streams/Types.h>
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+/**
+ * @file
+ * @brief Functions for operating on buffered streams.
+ *
+ * A buffered stream wraps another stream, reading ahead into a buffer so that many small reads,
+ * such as individual header fields, are served with a memory copy rather than a call to the base
+ * stream for each read. Reads at least as large as the buffer bypass it and go directly to the base
+ * stream.
+ *
+ * Buffered streams are read-only. The buffer memory is provided by the caller, and may be on the
+ * stack for temporary use.
+ *
+ * @see dsBufferedStream
+ */
+
+/**
+ * @brief The default size of the buffer for a buffered stream.
+ */
+#define DS_DEFAULT_STREAM_BUFFER_SIZE 4096
+
+/**
+ * @brief Opens a buffered stream.
+ *
+ * The buffered stream will be seekable and tellable if the base stream is.
+ *
+ * @remark errno will be set on failure.
+ * @param stream The stream to open.
+ * @param baseStream The stream to read from. This must remain valid until the buffered stream is
+ *     closed, and shouldn't be accessed directly in the meantime.
+ * @param buffer The memory to buffer reads with. This must remain valid until the buffered stream
+ *     is closed.
+ * @param bufferSize The size of the buffer.
+ * @return False if the parameters are invalid.
+ */
+DS_CORE_EXPORT bool dsBufferedStream_open(dsBufferedStream* stream, dsStream* baseStream,
+	void* buffer, size_t bufferSize);
+
+/**
+ * @brief Reads from a buffered stream.
+ * @remark errno will be set on failure.
+ * @param stream The stream to read from.
+ * @param data The data pointer to hold the data that was read.
+ * @param size The number of bytes to read.
+ * @return The number of bytes read from the stream.
+ */
+DS_CORE_EXPORT size_t dsBufferedStream_read(dsBufferedStream* stream, void* data, size_t size);
+
+/**
+ * @brief Seeks in a buffered stream.
+ *
+ * Seeking relative to the current position within the buffered data doesn't access the base
+ * stream.
+ *
+ * @remark errno will be set on failure.
+ * @param stream The stream to seek in.
+ * @param offset The offset from way.
+ * @param way The position in the stream to take the offset from.
+ * @return False if the seek was invalid.
+ */
+DS_CORE_EXPORT bool dsBufferedStream_seek(dsBufferedStream* stream, int64_t offset,
+	dsStreamSeekWay way);
+
+/**
+ * @brief Tells the current position in a buffered stream.
+ * @remark errno will be set on failure.
+ * @param stream The stream to get the position from.
+ * @return The position in the stream, or DS_STREAM_INVALID_POS if the position cannot be
+ *     determined.
+ */
+DS_CORE_EXPORT uint64_t dsBufferedStream_tell(dsBufferedStream* stream);
+
+/**
+ * @brief Closes a buffered stream.
+ *
+ * The base stream isn't closed. If the base stream is seekable, it will be moved back to the
+ * position of the buffered stream so any data that was read ahead but not consumed may be read
+ * again from the base stream.
+ *
+ * @remark errno will be set on failure.
+ * @param stream The stream to close.
+ * @return False if the stream cannot be closed.
+ */
+DS_CORE_EXPORT bool dsBufferedStream_close(dsBufferedStream* stream);
+
+#ifdef __cplusplus
+}
+#endif
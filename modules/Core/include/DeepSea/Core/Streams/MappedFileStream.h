@@ -0,0 +1,102 @@
+/*
+ * Copyright 2020 Aaron Barany
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <DeepSea/Core/Config.h>
+#include <DeepSea/Core/Export.h>
+#include <DeepSea/Core/Streams/Types.h>
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+/**
+ * @file
+ * @brief Functions for operating on memory mapped file streams.
+ *
+ * The file is mapped read-only into the address space with mmap() or MapViewOfFile(). Reading
+ * copies from the mapping, but dsStream_getContents() may be used to access the contents directly
+ * without copying, such as for parsing flatbuffer data in place.
+ *
+ * @see dsMappedFileStream
+ */
+
+/**
+ * @brief Opens a memory mapped file stream with a file path.
+ * @remark errno will be set on failure.
+ * @param stream The stream to open.
+ * @param filePath The file path to open.
+ * @return False if the file couldn't be opened or mapped.
+ */
+DS_CORE_EXPORT bool dsMappedFileStream_openPath(dsMappedFileStream* stream, const char* filePath);
+
+/**
+ * @brief Reads from a memory mapped file stream.
+ * @remark errno will be set on failure.
+ * @param stream The stream to read from.
+ * @param data The data pointer to hold the data that was read.
+ * @param size The number of bytes to read.
+ * @return The number of bytes read from the stream.
+ */
+DS_CORE_EXPORT size_t dsMappedFileStream_read(dsMappedFileStream* stream, void* data, size_t size);
+
+/**
+ * @brief Seeks in a memory mapped file stream.
+ * @remark errno will be set on failure.
+ * @param stream The stream to seek in.
+ * @param offset The offset from way.
+ * @param way The position in the stream to take the offset from.
+ * @return False if the seek was invalid.
+ */
+DS_CORE_EXPORT bool dsMappedFileStream_seek(dsMappedFileStream* stream, int64_t offset,
+	dsStreamSeekWay way);
+
+/**
+ * @brief Tells the current position in a memory mapped file stream.
+ * @remark errno will be set on failure.
+ * @param stream The stream to get the position from.
+ * @return The position in the stream, or DS_STREAM_INVALID_POS if the position cannot be
+ *     determined.
+ */
+DS_CORE_EXPORT uint64_t dsMappedFileStream_tell(dsMappedFileStream* stream);
+
+/**
+ * @brief Gets a pointer to the mapped contents of the file from the current position.
+ *
+ * The position will be moved to the end of the stream.
+ *
+ * @remark errno will be set on failure.
+ * @param[out] outSize The number of bytes from the current position to the end.
+ * @param stream The stream to get the contents from.
+ * @return A pointer to the contents, or NULL if the stream isn't open. This remains valid until
+ *     the stream is closed.
+ */
+DS_CORE_EXPORT const void* dsMappedFileStream_getContents(size_t* outSize,
+	dsMappedFileStream* stream);
+
+/**
+ * @brief Closes a memory mapped file stream, unmapping the file.
+ * @remark errno will be set on failure.
+ * @param stream The stream to close.
+ * @return False if the stream cannot be closed.
+ */
+DS_CORE_EXPORT bool dsMappedFileStream_close(dsMappedFileStream* stream);
+
+#ifdef __cplusplus
+}
+#endif
@@ -79,6 +79,18 @@ DS_CORE_EXPORT bool dsMemoryStream_seek(dsMemoryStream* stream, int64_t offset,
  */
 DS_CORE_EXPORT uint64_t dsMemoryStream_tell(dsMemoryStream* stream);
 
+/**
+ * @brief Gets a pointer to the contents of a memory stream from the current position.
+ *
+ * The position will be moved to the end of the stream.
+ *
+ * @remark errno will be set on failure.
+ * @param[out] outSize The number of bytes from the current position to the end.
+ * @param stream The stream to get the contents from.
+ * @return A pointer to the contents, or NULL if the stream isn't open.
+ */
+DS_CORE_EXPORT const void* dsMemoryStream_getContents(size_t* outSize, dsMemoryStream* stream);
+
 /**
  * @brief Closes a memory stream.
  * @remark errno will be set on failure.
@@ -42,6 +42,21 @@ extern "C"
  */
 DS_CORE_EXPORT inline size_t dsStream_read(dsStream* stream, void* data, size_t size);
 
+/**
+ * @brief Reads from a stream into multiple buffers.
+ *
+ * This fills each buffer in order, stopping at the first short read. This is most efficient when
+ * used with a dsBufferedStream, where each buffer is filled with a copy from the read-ahead buffer.
+ *
+ * @remark errno will be set on failure.
+ * @param stream The stream to read from.
+ * @param buffers The buffers to read into.
+ * @param bufferCount The number of buffers.
+ * @return The total number of bytes read from the stream.
+ */
+DS_CORE_EXPORT size_t dsStream_readv(dsStream* stream, const dsStreamBuffer* buffers,
+	uint32_t bufferCount);
+
 /**
  * @brief Reads from the current position in the stream until the end.
  * @remark errno will be set on failure.
@@ -70,6 +85,21 @@ DS_CORE_EXPORT void* dsStream_readUntilEnd(size_t* outSize, dsStream* stream,
 DS_CORE_EXPORT bool dsStream_readUntilEndReuse(void** buffer, size_t* size, size_t* capacity,
 	dsStream* stream, dsAllocator* allocator);
 
+/**
+ * @brief Gets a pointer to the contents of the stream from the current position until the end.
+ *
+ * This allows the contents to be used directly without copying when the stream is backed by
+ * memory, such as a dsMemoryStream or dsMappedFileStream. The position will be moved to the end of
+ * the stream, the same as dsStream_readUntilEnd().
+ *
+ * @remark errno will be set on failure.
+ * @param[out] outSize The number of bytes that may be accessed.
+ * @param stream The stream to get the contents from.
+ * @return A pointer to the contents, or NULL if the stream doesn't support direct access. The
+ *     pointer will remain valid until the stream is closed.
+ */
+DS_CORE_EXPORT inline const void* dsStream_getContents(size_t* outSize, dsStream* stream);
+
 /**
  * @brief Writes to a stream.
  * @remark errno will be set on failure.
@@ -137,6 +167,17 @@ inline size_t dsStream_read(dsStream* stream, void* data, size_t size)
 	return stream->readFunc(stream, data, size);
 }
 
+inline const void* dsStream_getContents(size_t* outSize, dsStream* stream)
+{
+	if (!outSize || !stream || !stream->getContentsFunc)
+	{
+		errno = EINVAL;
+		return NULL;
+	}
+
+	return stream->getContentsFunc(outSize, stream);
+}
+
 inline size_t dsStream_write(dsStream* stream, const void* data, size_t size)
 {
 	if (!stream || !stream->writeFunc || !data)
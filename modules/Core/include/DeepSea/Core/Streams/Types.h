@@ -123,6 +123,124 @@ typedef enum dsFileStatus
 	dsFileStatus_ExistsDirectory ///< File exists as a directory.
 } dsFileStatus;
 
+/**
+ * @brief Constant for an invalid asynchronous I/O request.
+ * @see AsyncIO.h
+ */
+#define DS_NO_ASYNC_IO_REQUEST (uint64_t)0
+
+/**
+ * @brief Enum for the priority of an asynchronous I/O request.
+ *
+ * Requests with a higher priority are started first. Requests with the same priority are started
+ * in the order they were queued.
+ *
+ * @see AsyncIO.h
+ */
+typedef enum dsAsyncIOPriority
+{
+	dsAsyncIOPriority_Low,    ///< Low priority, such as for streaming in data ahead of time.
+	dsAsyncIOPriority_Normal, ///< Normal priority.
+	dsAsyncIOPriority_High    ///< High priority, such as for data needed immediately.
+} dsAsyncIOPriority;
+
+/**
+ * @brief Enum for the result of an asynchronous I/O request.
+ * @see AsyncIO.h
+ */
+typedef enum dsAsyncIOResult
+{
+	dsAsyncIOResult_Success,  ///< The request completed successfully.
+	dsAsyncIOResult_Failed,   ///< The request failed. errno will be set with the reason.
+	dsAsyncIOResult_Canceled  ///< The request was canceled before it was started.
+} dsAsyncIOResult;
+
+/**
+ * @brief Struct for a service that performs file reads asynchronously.
+ * @see AsyncIO.h
+ */
+typedef struct dsAsyncIO dsAsyncIO;
+
+/**
+ * @brief Function called when an asynchronous I/O request completes.
+ *
+ * This is called on one of the I/O threads, or on the thread that canceled the request.
+ *
+ * @param userData The user data for the request.
+ * @param requestID The ID of the request that completed.
+ * @param result The result of the request. errno will be set when the result is
+ *     dsAsyncIOResult_Failed.
+ * @param readSize The number of bytes that were read. This may be less than the requested size if
+ *     the end of the file was reached.
+ */
+typedef void (*dsAsyncIOCompleteFunction)(void* userData, uint64_t requestID,
+	dsAsyncIOResult result, size_t readSize);
+
+/**
+ * @brief Struct describing an asynchronous read request.
+ * @see AsyncIO.h
+ */
+typedef struct dsAsyncIORequest
+{
+	/**
+	 * @brief The path to the file to read from.
+	 *
+	 * This is copied when the request is queued.
+	 */
+	const char* filePath;
+
+	/**
+	 * @brief The offset in bytes within the file to start reading from.
+	 */
+	uint64_t offset;
+
+	/**
+	 * @brief The number of bytes to read.
+	 */
+	size_t size;
+
+	/**
+	 * @brief The destination for the data.
+	 *
+	 * This must hold at least size bytes and remain valid until the request completes.
+	 */
+	void* destination;
+
+	/**
+	 * @brief The priority of the request.
+	 */
+	dsAsyncIOPriority priority;
+
+	/**
+	 * @brief The function to call when the request completes.
+	 *
+	 * This may be NULL if the request will be waited on with dsAsyncIO_waitForRequest().
+	 */
+	dsAsyncIOCompleteFunction completeFunc;
+
+	/**
+	 * @brief The user data to pass to completeFunc.
+	 */
+	void* userData;
+} dsAsyncIORequest;
+
+/**
+ * @brief Struct describing a region of memory for a vectored read.
+ * @see Stream.h
+ */
+typedef struct dsStreamBuffer
+{
+	/**
+	 * @brief The memory to read into.
+	 */
+	void* data;
+
+	/**
+	 * @brief The number of bytes to read.
+	 */
+	size_t size;
+} dsStreamBuffer;
+
 /**
  * @brief Function for reading from a stream.
  * @param stream The stream to read from.
@@ -171,6 +289,18 @@ typedef void (*dsStreamFlushFunction)(dsStream* stream);
  */
 typedef bool (*dsStreamCloseFunction)(dsStream* stream);
 
+/**
+ * @brief Function for getting a pointer to the remaining contents of a stream.
+ *
+ * The stream position will be moved to the end of the stream.
+ *
+ * @param[out] outSize The number of bytes from the current position to the end of the stream.
+ * @param stream The stream to get the contents from.
+ * @return A pointer to the contents at the current position, or NULL if it couldn't be accessed.
+ *     This will remain valid until the stream is closed.
+ */
+typedef const void* (*dsStreamGetContentsFunction)(size_t* outSize, dsStream* stream);
+
 /** @copydoc dsStream */
 struct dsStream
 {
@@ -215,6 +345,14 @@ struct dsStream
 	 * This may be NULL if the stream cannot be closed.
 	 */
 	dsStreamCloseFunction closeFunc;
+
+	/**
+	 * @brief The function to directly access the contents of the stream.
+	 *
+	 * This may be NULL if the contents can't be accessed without reading. This is implemented for
+	 * streams that are backed by memory, such as memory and memory mapped file streams.
+	 */
+	dsStreamGetContentsFunction getContentsFunc;
 };
 
 /**
@@ -269,6 +407,78 @@ typedef struct dsMemoryStream
 	size_t position;
 } dsMemoryStream;
 
+/**
+ * @brief Structure that defines a read-only stream for a memory mapped file.
+ *
+ * This is effectively a subclass of dsStream and a pointer to dsMappedFileStream can be freely
+ * cast between the two types.
+ *
+ * @see MappedFileStream.h
+ */
+typedef struct dsMappedFileStream
+{
+	/**
+	 * @brief The base stream.
+	 */
+	dsStream stream;
+
+	/**
+	 * @brief The mapped contents of the file.
+	 */
+	const void* data;
+
+	/**
+	 * @brief The size of the file.
+	 */
+	size_t size;
+
+	/**
+	 * @brief The current position in the file.
+	 */
+	size_t position;
+} dsMappedFileStream;
+
+/**
+ * @brief Structure that defines a stream that buffers reads from another stream.
+ *
+ * This is effectively a subclass of dsStream and a pointer to dsBufferedStream can be freely
+ * cast between the two types.
+ *
+ * @see BufferedStream.h
+ */
+typedef struct dsBufferedStream
+{
+	/**
+	 * @brief The base stream.
+	 */
+	dsStream stream;
+
+	/**
+	 * @brief The stream that reads are buffered from.
+	 */
+	dsStream* baseStream;
+
+	/**
+	 * @brief The buffer holding data read ahead from the base stream.
+	 */
+	uint8_t* buffer;
+
+	/**
+	 * @brief The size of the buffer.
+	 */
+	size_t bufferSize;
+
+	/**
+	 * @brief The current read position within the buffer.
+	 */
+	size_t bufferPosition;
+
+	/**
+	 * @brief The end of the valid data within the buffer.
+	 */
+	size_t bufferEnd;
+} dsBufferedStream;
+
 /**
  * @brief Structure that defines a generic stream.
  *
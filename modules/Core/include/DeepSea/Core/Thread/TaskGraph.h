@@ -0,0 +1,117 @@
+/*
+ * Copyright 2020 Aaron Barany
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <DeepSea/Core/Config.h>
+#include <DeepSea/Core/Export.h>
+#include <DeepSea/Core/Thread/Types.h>
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+/**
+ * @file
+ * @brief Functions for creating and executing graphs of tasks.
+ *
+ * A task graph holds a list of tasks along with the dependencies between them. When executed, all
+ * tasks without dependencies are queued on the thread pool, and each remaining task is queued as
+ * a continuation once the last of its dependencies has finished.
+ *
+ * The thread that executes the graph will help execute tasks from the pool while it waits. This
+ * makes it safe to execute a task graph from within a task of another graph on the same pool.
+ *
+ * The tasks and dependencies are kept after execution, so the same graph may be executed multiple
+ * times, such as once per frame.
+ *
+ * @see dsTaskGraph
+ */
+
+/**
+ * @brief Creates a task graph.
+ * @remark errno will be set on failure.
+ * @param allocator The allocator to create the task graph with. This must support freeing memory.
+ * @param threadPool The thread pool to execute the tasks on.
+ * @return The task graph or NULL if it couldn't be created.
+ */
+DS_CORE_EXPORT dsTaskGraph* dsTaskGraph_create(dsAllocator* allocator, dsThreadPool* threadPool);
+
+/**
+ * @brief Gets the number of tasks in the task graph.
+ * @param taskGraph The task graph.
+ * @return The number of tasks.
+ */
+DS_CORE_EXPORT uint32_t dsTaskGraph_getTaskCount(const dsTaskGraph* taskGraph);
+
+/**
+ * @brief Adds a task to the task graph.
+ * @remark errno will be set on failure.
+ * @param taskGraph The task graph to add the task to. This may not be currently executing.
+ * @param function The function to execute for the task.
+ * @param userData The user data to pass to the function.
+ * @return The index of the task or DS_NO_TASK if the task couldn't be added.
+ */
+DS_CORE_EXPORT uint32_t dsTaskGraph_addTask(dsTaskGraph* taskGraph, dsThreadTaskFunction function,
+	void* userData);
+
+/**
+ * @brief Adds a dependency between two tasks.
+ *
+ * The task won't start until the dependency has finished executing.
+ *
+ * @remark errno will be set on failure.
+ * @param taskGraph The task graph. This may not be currently executing.
+ * @param task The index of the task that depends on the other task.
+ * @param dependency The index of the task to wait on.
+ * @return False if the dependency couldn't be added.
+ */
+DS_CORE_EXPORT bool dsTaskGraph_addDependency(dsTaskGraph* taskGraph, uint32_t task,
+	uint32_t dependency);
+
+/**
+ * @brief Executes the tasks in the task graph.
+ *
+ * This will block until all tasks have finished. The current thread will execute tasks from the
+ * thread pool while waiting.
+ *
+ * The first execution after tasks or dependencies are added will also validate that there are no
+ * cycles in the dependencies, failing with errno set to EINVAL if there are.
+ *
+ * @remark errno will be set on failure.
+ * @param taskGraph The task graph to execute.
+ * @return False if the task graph couldn't be executed.
+ */
+DS_CORE_EXPORT bool dsTaskGraph_execute(dsTaskGraph* taskGraph);
+
+/**
+ * @brief Removes all tasks and dependencies from the task graph.
+ * @remark errno will be set on failure.
+ * @param taskGraph The task graph to clear. This may not be currently executing.
+ * @return False if the task graph is invalid.
+ */
+DS_CORE_EXPORT bool dsTaskGraph_clear(dsTaskGraph* taskGraph);
+
+/**
+ * @brief Destroys a task graph.
+ * @param taskGraph The task graph to destroy. This may not be currently executing.
+ */
+DS_CORE_EXPORT void dsTaskGraph_destroy(dsTaskGraph* taskGraph);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,97 @@
+/*
+ * Copyright 2020 Aaron Barany
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <DeepSea/Core/Config.h>
+#include <DeepSea/Core/Export.h>
+#include <DeepSea/Core/Thread/Types.h>
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+/**
+ * @file
+ * @brief Functions for creating and manipulating thread pools.
+ *
+ * Each worker thread owns a lock-free double-ended queue of tasks. Tasks queued from a worker
+ * thread are pushed to the end of its own queue, while idle workers steal from the front of the
+ * other queues. Tasks queued from threads outside of the pool are placed on a shared queue.
+ *
+ * Tasks are submitted to the pool through a dsTaskGraph.
+ *
+ * @see dsThreadPool
+ */
+
+/**
+ * @brief The maximum number of tasks that may be held in a single worker's queue.
+ *
+ * Tasks beyond this amount will be placed on the shared queue.
+ */
+#define DS_THREAD_POOL_MAX_WORKER_TASKS 1024
+
+/**
+ * @brief Creates a thread pool.
+ * @remark errno will be set on failure.
+ * @param allocator The allocator to create the thread pool with. This must support freeing memory.
+ * @param threadCount The number of worker threads to create. This may be 0, in which case all tasks
+ *     will be executed by threads waiting on a task graph.
+ * @param stackSize The size of the stack for each thread. Set to 0 for the default size.
+ * @return The thread pool or NULL if it couldn't be created.
+ */
+DS_CORE_EXPORT dsThreadPool* dsThreadPool_create(dsAllocator* allocator, unsigned int threadCount,
+	unsigned int stackSize);
+
+/**
+ * @brief Gets the number of worker threads in the thread pool.
+ * @param threadPool The thread pool.
+ * @return The number of threads.
+ */
+DS_CORE_EXPORT unsigned int dsThreadPool_getThreadCount(const dsThreadPool* threadPool);
+
+/**
+ * @brief Checks whether or not the current thread is a worker thread for the thread pool.
+ * @param threadPool The thread pool.
+ * @return True if the current thread belongs to the thread pool.
+ */
+DS_CORE_EXPORT bool dsThreadPool_isWorkerThread(const dsThreadPool* threadPool);
+
+/**
+ * @brief Executes a single pending task from the thread pool on the current thread.
+ *
+ * This can be used to have external threads help with the work in the pool while they would
+ * otherwise be idle.
+ *
+ * @param threadPool The thread pool.
+ * @return True if a task was executed, false if no task was available.
+ */
+DS_CORE_EXPORT bool dsThreadPool_executeTask(dsThreadPool* threadPool);
+
+/**
+ * @brief Destroys a thread pool.
+ *
+ * This will wait for all of the worker threads to finish. No task graphs may be executing when the
+ * thread pool is destroyed.
+ *
+ * @param threadPool The thread pool to destroy.
+ */
+DS_CORE_EXPORT void dsThreadPool_destroy(dsThreadPool* threadPool);
+
+#ifdef __cplusplus
+}
+#endif
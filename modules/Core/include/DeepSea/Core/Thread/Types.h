@@ -154,6 +154,35 @@ typedef struct dsThread
 	int32_t started;
 } dsThread;
 
+/**
+ * @brief Constant for an invalid task index within a task graph.
+ * @see TaskGraph.h
+ */
+#define DS_NO_TASK (uint32_t)-1
+
+/**
+ * @brief Function called to execute a task.
+ * @see TaskGraph.h
+ * @param userData The user data for the task.
+ */
+typedef void (*dsThreadTaskFunction)(void* userData);
+
+/**
+ * @brief Struct for a pool of threads that execute tasks.
+ *
+ * Each thread in the pool has its own queue of tasks. Threads that run out of work will steal tasks
+ * from the other threads.
+ *
+ * @see ThreadPool.h
+ */
+typedef struct dsThreadPool dsThreadPool;
+
+/**
+ * @brief Struct for a graph of tasks with dependencies between them, executed on a thread pool.
+ * @see TaskGraph.h
+ */
+typedef struct dsTaskGraph dsTaskGraph;
+
 /**
  * @brief Structure that holds thread-local storage.
  * @see ThreadStorage.h
@@ -0,0 +1,186 @@
+/*
+ * Copyright 2020 Aaron Barany
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <DeepSea/Core/Config.h>
+#include <stddef.h>
+
+/**
+ * @file
+ * @brief Macro to define a sort function specialized for a type.
+ *
+ * dsSort() calls the comparison function through a pointer for every comparison, and works on
+ * members of any size. When sorting a known type in a hot path, DS_DEFINE_TYPED_SORT() may be used
+ * to define a sort function with the comparison inlined and members copied as the actual type.
+ *
+ * For example:
+ *
+ * ```
+ * #define FOO_LESS(left, right, context) ((left)->value < (right)->value)
+ * DS_DEFINE_TYPED_SORT(sortFoos, Foo, FOO_LESS)
+ * ...
+ * sortFoos(foos, fooCount, NULL);
+ * ```
+ */
+
+/**
+ * @brief Defines a static sort function for a type.
+ *
+ * The defined function has the signature void name(Type* array, size_t count, void* context).
+ * This uses an introsort: a quicksort with a median of three pivot, switching to insertion sort for
+ * small ranges and to heapsort if the recursion gets too deep, guaranteeing O(n log n). The sort
+ * isn't stable.
+ *
+ * @param name The name of the function to define. Helper functions will also be defined with this
+ *     as a prefix.
+ * @param Type The type of the elements to sort.
+ * @param lessThan A function or macro taking (const Type* left, const Type* right, void* context)
+ *     that returns true if left should be sorted before right.
+ */
+#define DS_DEFINE_TYPED_SORT(name, Type, lessThan) \
+	static inline void name##_insertionSort(Type* array, size_t count, void* context) \
+	{ \
+		(void)context; \
+		for (size_t i = 1; i < count; ++i) \
+		{ \
+			if (!(lessThan(array + i, array + i - 1, context))) \
+				continue; \
+			\
+			Type value = array[i]; \
+			size_t j = i; \
+			do \
+			{ \
+				array[j] = array[j - 1]; \
+				--j; \
+			} while (j > 0 && (lessThan(&value, array + j - 1, context))); \
+			array[j] = value; \
+		} \
+	} \
+	\
+	static inline void name##_siftDown(Type* array, size_t root, size_t count, void* context) \
+	{ \
+		(void)context; \
+		Type value = array[root]; \
+		for (;;) \
+		{ \
+			size_t child = root*2 + 1; \
+			if (child >= count) \
+				break; \
+			if (child + 1 < count && (lessThan(array + child, array + child + 1, context))) \
+				++child; \
+			if (!(lessThan(&value, array + child, context))) \
+				break; \
+			array[root] = array[child]; \
+			root = child; \
+		} \
+		array[root] = value; \
+	} \
+	\
+	static inline void name##_heapSort(Type* array, size_t count, void* context) \
+	{ \
+		for (size_t i = count/2; i-- > 0;) \
+			name##_siftDown(array, i, count, context); \
+		for (size_t i = count; i-- > 1;) \
+		{ \
+			Type temp = array[0]; \
+			array[0] = array[i]; \
+			array[i] = temp; \
+			name##_siftDown(array, 0, i, context); \
+		} \
+	} \
+	\
+	static inline void name##_introSort(Type* array, size_t count, unsigned int depthLimit, \
+		void* context) \
+	{ \
+		(void)context; \
+		while (count > 16) \
+		{ \
+			if (depthLimit == 0) \
+			{ \
+				name##_heapSort(array, count, context); \
+				return; \
+			} \
+			--depthLimit; \
+			\
+			/* Median of three for the pivot. */ \
+			size_t middle = count/2; \
+			Type temp; \
+			if (lessThan(array + middle, array, context)) \
+			{ \
+				temp = array[middle]; \
+				array[middle] = array[0]; \
+				array[0] = temp; \
+			} \
+			if (lessThan(array + count - 1, array + middle, context)) \
+			{ \
+				temp = array[middle]; \
+				array[middle] = array[count - 1]; \
+				array[count - 1] = temp; \
+				if (lessThan(array + middle, array, context)) \
+				{ \
+					temp = array[middle]; \
+					array[middle] = array[0]; \
+					array[0] = temp; \
+				} \
+			} \
+			\
+			/* Hoare partition. The first and last elements act as sentinels. */ \
+			Type pivot = array[middle]; \
+			size_t i = 0; \
+			size_t j = count - 1; \
+			for (;;) \
+			{ \
+				while (lessThan(array + i, &pivot, context)) \
+					++i; \
+				while (lessThan(&pivot, array + j, context)) \
+					--j; \
+				if (i >= j) \
+					break; \
+				\
+				temp = array[i]; \
+				array[i] = array[j]; \
+				array[j] = temp; \
+				++i; \
+				--j; \
+			} \
+			\
+			/* Recurse into the smaller side to limit the stack depth. */ \
+			size_t leftCount = j + 1; \
+			size_t rightCount = count - leftCount; \
+			if (leftCount < rightCount) \
+			{ \
+				name##_introSort(array, leftCount, depthLimit, context); \
+				array += leftCount; \
+				count = rightCount; \
+			} \
+			else \
+			{ \
+				name##_introSort(array + leftCount, rightCount, depthLimit, context); \
+				count = leftCount; \
+			} \
+		} \
+		\
+		name##_insertionSort(array, count, context); \
+	} \
+	\
+	static inline void name(Type* array, size_t count, void* context) \
+	{ \
+		unsigned int depthLimit = 0; \
+		for (size_t i = count; i > 1; i >>= 1) \
+			depthLimit += 2; \
+		name##_introSort(array, count, depthLimit, context); \
+	}
@@ -62,6 +62,22 @@ typedef enum dsProfileType
 	dsProfileType_Lock      ///< Locked, such as with a mutex.
 } dsProfileType;
 
+/**
+ * @brief Enum for SIMD instruction features that may be available.
+ *
+ * Multiple features may be combined as a bitmask.
+ *
+ * @see SIMD.h
+ */
+typedef enum dsSIMDFeatures
+{
+	dsSIMDFeatures_None = 0,      ///< No SIMD features are available.
+	dsSIMDFeatures_Float4 = 0x1,  ///< Operations on 4 floats. (SSE or NEON)
+	dsSIMDFeatures_HAdd = 0x2,    ///< Horizontal adds. (SSE3 or NEON on 64-bit ARM)
+	dsSIMDFeatures_FMA = 0x4,     ///< Fused multiply-add. (FMA3 or NEON on 64-bit ARM)
+	dsSIMDFeatures_Float8 = 0x8   ///< Operations on 8 floats. (AVX)
+} dsSIMDFeatures;
+
 /**
  * @brief Struct containing a range of indices.
  */
@@ -87,6 +103,26 @@ typedef struct dsIndexRange
  */
 typedef int (*dsSortCompareFunction)(const void* left, const void* right, void* context);
 
+/**
+ * @brief Structure for a sort key paired with the index of the item it was created from.
+ *
+ * This is used to sort items by an integer key without moving the items themselves.
+ *
+ * @see Sort.h
+ */
+typedef struct dsSortKey
+{
+	/**
+	 * @brief The key to sort by.
+	 */
+	uint64_t key;
+
+	/**
+	 * @brief The index of the item the key was created from.
+	 */
+	uint32_t index;
+} dsSortKey;
+
 /**
  * @brief Type of the logging function.
  * @remark This may be called across multiple threads.
@@ -255,3 +291,8 @@ typedef struct dsDynamicLib
 #ifdef __cplusplus
 }
 #endif
+
+// Needs to be after the extern "C" block.
+/// @cond
+DS_ENUM_BITMASK_OPERATORS(dsSIMDFeatures);
+/// @endcond
@@ -20,3 +20,4 @@ uint32_t dsClz(uint32_t x);
 uint32_t dsCtz(uint32_t x);
 uint32_t dsBitmaskIndex(uint32_t x);
 uint32_t dsRemoveLastBit(uint32_t x);
+uint32_t dsCountBits(uint32_t x);
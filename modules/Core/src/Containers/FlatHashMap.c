@@ -0,0 +1,465 @@
+/*
+ * Copyright 2020 Aaron Barany
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <DeepSea/Core/Containers/FlatHashMap.h>
+
+#include <DeepSea/Core/Containers/Hash.h>
+#include <DeepSea/Core/Memory/Allocator.h>
+#include <DeepSea/Core/Assert.h>
+#include <DeepSea/Core/Error.h>
+#include <string.h>
+
+// The high bit is always set for stored hashes so 0 can mark empty slots.
+#define USED_HASH_BIT 0x80000000U
+#define MIN_CAPACITY 16U
+#define MAX_CAPACITY 0x80000000U
+#define NOT_FOUND MAX_CAPACITY
+// Maximum load factor of 7/8.
+#define MAX_LENGTH(capacity) ((capacity) - (capacity)/8)
+
+#define ENTRY(hashMap, index) ((hashMap)->entries + (size_t)(index)*(hashMap)->entrySize)
+#define ENTRY_HASH(entry) (*(uint32_t*)(entry))
+// Two extra entries past the end are used as scratch space when displacing entries.
+#define SCRATCH_ENTRY(hashMap, index) ENTRY(hashMap, (hashMap)->capacity + (index))
+#define PROBE_DISTANCE(hashMap, hash, index) \
+	(((index) - (hash)) & ((hashMap)->capacity - 1))
+
+static uint32_t alignmentForSize(uint32_t size)
+{
+	if (size % 8 == 0)
+		return 8;
+	else if (size % 4 == 0)
+		return 4;
+	else if (size % 2 == 0)
+		return 2;
+	return 1;
+}
+
+static inline bool isInlineUInt64(const dsFlatHashMap* hashMap)
+{
+	return !hashMap->hashFunc && !hashMap->keysEqualFunc && hashMap->keySize == sizeof(uint64_t);
+}
+
+static inline uint64_t loadUInt64(const void* data)
+{
+	uint64_t value;
+	memcpy(&value, data, sizeof(uint64_t));
+	return value;
+}
+
+static inline uint32_t hashUInt64(uint64_t key)
+{
+	// Finalizer from MurmurHash3, which mixes all of the bits into the low bits used for the slot.
+	key ^= key >> 33;
+	key *= 0xff51afd7ed558ccdULL;
+	key ^= key >> 33;
+	key *= 0xc4ceb9fe1a85ec53ULL;
+	key ^= key >> 33;
+	return (uint32_t)key | USED_HASH_BIT;
+}
+
+static uint32_t hashKey(const dsFlatHashMap* hashMap, const void* key)
+{
+	if (isInlineUInt64(hashMap))
+		return hashUInt64(loadUInt64(key));
+
+	uint32_t hash = hashMap->hashFunc ? hashMap->hashFunc(key) :
+		dsHashBytes(key, hashMap->keySize);
+
+	// Mix the bits since the slot is chosen from the low bits. This protects against hash
+	// functions with poor distribution in the low bits, such as for pointers.
+	hash ^= hash >> 16;
+	hash *= 0x85ebca6b;
+	hash ^= hash >> 13;
+	hash *= 0xc2b2ae35;
+	hash ^= hash >> 16;
+	return hash | USED_HASH_BIT;
+}
+
+static const void* entryKey(const dsFlatHashMap* hashMap, const uint8_t* entry)
+{
+	if (hashMap->keySize)
+		return entry + hashMap->keyOffset;
+	return *(const void* const*)(entry + hashMap->keyOffset);
+}
+
+static bool keysEqual(const dsFlatHashMap* hashMap, const uint8_t* entry, const void* key)
+{
+	if (hashMap->keysEqualFunc)
+		return hashMap->keysEqualFunc(entryKey(hashMap, entry), key);
+
+	// Compare common key sizes directly rather than calling into memcmp.
+	const uint8_t* entryKeyData = entry + hashMap->keyOffset;
+	switch (hashMap->keySize)
+	{
+		case sizeof(uint32_t):
+		{
+			uint32_t first, second;
+			memcpy(&first, entryKeyData, sizeof(uint32_t));
+			memcpy(&second, key, sizeof(uint32_t));
+			return first == second;
+		}
+		case sizeof(uint64_t):
+		{
+			uint64_t first, second;
+			memcpy(&first, entryKeyData, sizeof(uint64_t));
+			memcpy(&second, key, sizeof(uint64_t));
+			return first == second;
+		}
+		default:
+			return memcmp(entryKeyData, key, hashMap->keySize) == 0;
+	}
+}
+
+// Specialize the copies for common sizes to avoid calling into memcpy.
+static inline void copyEntry(uint8_t* dst, const uint8_t* src, uint32_t size)
+{
+	switch (size)
+	{
+		case 8:
+			memcpy(dst, src, 8);
+			break;
+		case 12:
+			memcpy(dst, src, 12);
+			break;
+		case 16:
+			memcpy(dst, src, 16);
+			break;
+		case 24:
+			memcpy(dst, src, 24);
+			break;
+		default:
+			memcpy(dst, src, size);
+			break;
+	}
+}
+
+// Specialized search for 64-bit keys without hash or equality functions, which compares the keys
+// directly.
+static uint32_t findIndexUInt64(const dsFlatHashMap* hashMap, uint64_t key, uint32_t hash)
+{
+	uint32_t mask = hashMap->capacity - 1;
+	uint32_t keyOffset = hashMap->keyOffset;
+	uint32_t index = hash & mask;
+	for (uint32_t distance = 0;; ++distance, index = (index + 1) & mask)
+	{
+		const uint8_t* entry = ENTRY(hashMap, index);
+		uint32_t curHash = ENTRY_HASH(entry);
+		if (!curHash || PROBE_DISTANCE(hashMap, curHash, index) < distance)
+			return NOT_FOUND;
+
+		if (curHash == hash && loadUInt64(entry + keyOffset) == key)
+			return index;
+	}
+}
+
+static uint32_t findIndex(const dsFlatHashMap* hashMap, const void* key, uint32_t hash)
+{
+	if (hashMap->length == 0)
+		return NOT_FOUND;
+
+	if (isInlineUInt64(hashMap))
+		return findIndexUInt64(hashMap, loadUInt64(key), hash);
+
+	uint32_t mask = hashMap->capacity - 1;
+	uint32_t index = hash & mask;
+	for (uint32_t distance = 0;; ++distance, index = (index + 1) & mask)
+	{
+		const uint8_t* entry = ENTRY(hashMap, index);
+		uint32_t curHash = ENTRY_HASH(entry);
+		// Robin Hood ordering guarantees the key can't be past an element closer to its slot.
+		if (!curHash || PROBE_DISTANCE(hashMap, curHash, index) < distance)
+			return NOT_FOUND;
+
+		if (curHash == hash && keysEqual(hashMap, entry, key))
+			return index;
+	}
+}
+
+// Places the first scratch entry starting at index, displacing entries that are closer to their
+// ideal slot.
+static void placeEntry(dsFlatHashMap* hashMap, uint32_t index, uint32_t distance)
+{
+	uint32_t mask = hashMap->capacity - 1;
+	uint32_t entrySize = hashMap->entrySize;
+	uint8_t* carried = SCRATCH_ENTRY(hashMap, 0);
+	uint8_t* displaced = SCRATCH_ENTRY(hashMap, 1);
+	for (;; ++distance, index = (index + 1) & mask)
+	{
+		uint8_t* entry = ENTRY(hashMap, index);
+		uint32_t curHash = ENTRY_HASH(entry);
+		if (!curHash)
+		{
+			copyEntry(entry, carried, entrySize);
+			return;
+		}
+
+		uint32_t curDistance = PROBE_DISTANCE(hashMap, curHash, index);
+		if (curDistance < distance)
+		{
+			copyEntry(displaced, entry, entrySize);
+			copyEntry(entry, carried, entrySize);
+
+			uint8_t* temp = carried;
+			carried = displaced;
+			displaced = temp;
+			distance = curDistance;
+		}
+	}
+}
+
+static bool setCapacity(dsFlatHashMap* hashMap, uint32_t capacity)
+{
+	DS_ASSERT(capacity >= MIN_CAPACITY && capacity <= MAX_CAPACITY &&
+		(capacity & (capacity - 1)) == 0);
+	uint8_t* entries = (uint8_t*)dsAllocator_alloc(hashMap->allocator,
+		(size_t)(capacity + 2)*hashMap->entrySize);
+	if (!entries)
+		return false;
+
+	uint8_t* oldEntries = hashMap->entries;
+	uint32_t oldCapacity = hashMap->capacity;
+
+	hashMap->entries = entries;
+	hashMap->capacity = capacity;
+	for (uint32_t i = 0; i < capacity; ++i)
+		ENTRY_HASH(ENTRY(hashMap, i)) = 0;
+
+	uint32_t mask = capacity - 1;
+	uint8_t* scratch = SCRATCH_ENTRY(hashMap, 0);
+	for (uint32_t i = 0; i < oldCapacity; ++i)
+	{
+		const uint8_t* entry = oldEntries + (size_t)i*hashMap->entrySize;
+		uint32_t hash = ENTRY_HASH(entry);
+		if (!hash)
+			continue;
+
+		copyEntry(scratch, entry, hashMap->entrySize);
+		placeEntry(hashMap, hash & mask, 0);
+	}
+
+	DS_VERIFY(dsAllocator_free(hashMap->allocator, oldEntries));
+	return true;
+}
+
+static uint32_t capacityForLength(uint32_t length)
+{
+	uint32_t capacity = MIN_CAPACITY;
+	while (MAX_LENGTH(capacity) < length)
+	{
+		if (capacity == MAX_CAPACITY)
+			return 0;
+		capacity *= 2;
+	}
+	return capacity;
+}
+
+bool dsFlatHashMap_initialize(dsFlatHashMap* hashMap, dsAllocator* allocator, uint32_t keySize,
+	uint32_t valueSize, dsHashFunction hashFunc, dsKeysEqualFunction keysEqualFunc)
+{
+	if (!hashMap || !allocator || !allocator->freeFunc ||
+		(keySize == 0 && (!hashFunc || !keysEqualFunc)))
+	{
+		errno = EINVAL;
+		return false;
+	}
+
+	uint32_t keyStorageSize = keySize ? keySize : (uint32_t)sizeof(void*);
+	uint32_t keyAlignment = alignmentForSize(keyStorageSize);
+	uint32_t valueAlignment = valueSize ? alignmentForSize(valueSize) : 1;
+	uint32_t entryAlignment = (uint32_t)sizeof(uint32_t);
+	if (keyAlignment > entryAlignment)
+		entryAlignment = keyAlignment;
+	if (valueAlignment > entryAlignment)
+		entryAlignment = valueAlignment;
+
+	memset(hashMap, 0, sizeof(*hashMap));
+	hashMap->allocator = allocator;
+	hashMap->hashFunc = hashFunc;
+	hashMap->keysEqualFunc = keysEqualFunc;
+	hashMap->keySize = keySize;
+	hashMap->valueSize = valueSize;
+	hashMap->keyOffset = DS_CUSTOM_ALIGNED_SIZE((uint32_t)sizeof(uint32_t), keyAlignment);
+	hashMap->valueOffset = DS_CUSTOM_ALIGNED_SIZE(hashMap->keyOffset + keyStorageSize,
+		valueAlignment);
+	hashMap->entrySize = DS_CUSTOM_ALIGNED_SIZE(hashMap->valueOffset + valueSize, entryAlignment);
+	return true;
+}
+
+bool dsFlatHashMap_reserve(dsFlatHashMap* hashMap, uint32_t elementCount)
+{
+	if (!hashMap || !hashMap->allocator)
+	{
+		errno = EINVAL;
+		return false;
+	}
+
+	if (elementCount <= MAX_LENGTH(hashMap->capacity))
+		return true;
+
+	uint32_t capacity = capacityForLength(elementCount);
+	if (!capacity)
+	{
+		errno = ENOMEM;
+		return false;
+	}
+
+	return setCapacity(hashMap, capacity);
+}
+
+void* dsFlatHashMap_insert(dsFlatHashMap* hashMap, const void* key, const void* value)
+{
+	if (!hashMap || !hashMap->allocator)
+	{
+		errno = EINVAL;
+		return NULL;
+	}
+
+	if (hashMap->length + 1 > MAX_LENGTH(hashMap->capacity) &&
+		!dsFlatHashMap_reserve(hashMap, hashMap->length + 1))
+	{
+		return NULL;
+	}
+
+	// Probe until finding the key or the slot the key would be placed in.
+	uint32_t hash = hashKey(hashMap, key);
+	uint32_t mask = hashMap->capacity - 1;
+	uint32_t index = hash & mask;
+	uint32_t distance = 0;
+	for (;; ++distance, index = (index + 1) & mask)
+	{
+		const uint8_t* entry = ENTRY(hashMap, index);
+		uint32_t curHash = ENTRY_HASH(entry);
+		if (!curHash || PROBE_DISTANCE(hashMap, curHash, index) < distance)
+			break;
+
+		if (curHash == hash && keysEqual(hashMap, entry, key))
+		{
+			errno = EPERM;
+			return NULL;
+		}
+	}
+
+	uint8_t* entry = ENTRY(hashMap, index);
+	uint8_t* newEntry = ENTRY_HASH(entry) ? SCRATCH_ENTRY(hashMap, 0) : entry;
+	ENTRY_HASH(newEntry) = hash;
+	if (hashMap->keySize)
+		memcpy(newEntry + hashMap->keyOffset, key, hashMap->keySize);
+	else
+		memcpy(newEntry + hashMap->keyOffset, &key, sizeof(void*));
+
+	if (value)
+		memcpy(newEntry + hashMap->valueOffset, value, hashMap->valueSize);
+	else
+		memset(newEntry + hashMap->valueOffset, 0, hashMap->valueSize);
+
+	if (newEntry != entry)
+		placeEntry(hashMap, index, distance);
+
+	++hashMap->length;
+	return entry + hashMap->valueOffset;
+}
+
+void* dsFlatHashMap_find(const dsFlatHashMap* hashMap, const void* key)
+{
+	if (!hashMap)
+		return NULL;
+
+	uint32_t index = findIndex(hashMap, key, hashKey(hashMap, key));
+	if (index == NOT_FOUND)
+		return NULL;
+
+	return ENTRY(hashMap, index) + hashMap->valueOffset;
+}
+
+bool dsFlatHashMap_remove(dsFlatHashMap* hashMap, const void* key)
+{
+	if (!hashMap)
+	{
+		errno = EINVAL;
+		return false;
+	}
+
+	uint32_t index = findIndex(hashMap, key, hashKey(hashMap, key));
+	if (index == NOT_FOUND)
+	{
+		errno = ENOTFOUND;
+		return false;
+	}
+
+	// Shift the following entries back until reaching an empty slot or an entry that's already
+	// in its ideal slot, which avoids the need for tombstones.
+	uint32_t mask = hashMap->capacity - 1;
+	uint32_t nextIndex = (index + 1) & mask;
+	while (true)
+	{
+		const uint8_t* nextEntry = ENTRY(hashMap, nextIndex);
+		uint32_t nextHash = ENTRY_HASH(nextEntry);
+		if (!nextHash || PROBE_DISTANCE(hashMap, nextHash, nextIndex) == 0)
+			break;
+
+		copyEntry(ENTRY(hashMap, index), nextEntry, hashMap->entrySize);
+		index = nextIndex;
+		nextIndex = (nextIndex + 1) & mask;
+	}
+
+	ENTRY_HASH(ENTRY(hashMap, index)) = 0;
+	--hashMap->length;
+	return true;
+}
+
+bool dsFlatHashMap_next(uint32_t* index, const void** outKey, void** outValue,
+	const dsFlatHashMap* hashMap)
+{
+	if (!index || !hashMap)
+		return false;
+
+	for (uint32_t i = *index; i < hashMap->capacity; ++i)
+	{
+		uint8_t* entry = ENTRY(hashMap, i);
+		if (!ENTRY_HASH(entry))
+			continue;
+
+		if (outKey)
+			*outKey = entryKey(hashMap, entry);
+		if (outValue)
+			*outValue = entry + hashMap->valueOffset;
+		*index = i + 1;
+		return true;
+	}
+
+	*index = hashMap->capacity;
+	return false;
+}
+
+void dsFlatHashMap_clear(dsFlatHashMap* hashMap)
+{
+	if (!hashMap)
+		return;
+
+	for (uint32_t i = 0; i < hashMap->capacity; ++i)
+		ENTRY_HASH(ENTRY(hashMap, i)) = 0;
+	hashMap->length = 0;
+}
+
+void dsFlatHashMap_shutdown(dsFlatHashMap* hashMap)
+{
+	if (!hashMap || !hashMap->allocator)
+		return;
+
+	DS_VERIFY(dsAllocator_free(hashMap->allocator, hashMap->entries));
+	memset(hashMap, 0, sizeof(*hashMap));
+}
@@ -18,6 +18,10 @@
 #include <DeepSea/Core/Assert.h>
 #include <string.h>
 
+#if DS_MSC
+#include <intrin.h>
+#endif
+
 #define DEFAULT_SEED 0xc70f6907U
 
 inline static uint32_t rotl32(uint32_t x, int8_t r)
@@ -56,6 +60,59 @@ inline static uint64_t fmix64(uint64_t k)
 
 #endif
 
+// Constants from wyhash.
+// https://github.com/wangyi-fudan/wyhash/blob/master/wyhash.h
+#define WY_SECRET0 0xa0761d6478bd642fULL
+#define WY_SECRET1 0xe7037ed1a0b428dbULL
+#define WY_SECRET2 0x8ebc6af09c88c6e3ULL
+#define WY_SECRET3 0x589965cc75374cc3ULL
+#define DEFAULT_SEED64 0
+
+inline static void wymum(uint64_t* a, uint64_t* b)
+{
+#if defined(__SIZEOF_INT128__)
+	__uint128_t r = (__uint128_t)*a*(*b);
+	*a = (uint64_t)r;
+	*b = (uint64_t)(r >> 64);
+#elif DS_MSC && DS_X86_64
+	*a = _umul128(*a, *b, b);
+#else
+	uint64_t ha = *a >> 32, hb = *b >> 32, la = (uint32_t)*a, lb = (uint32_t)*b;
+	uint64_t rh = ha*hb, rm0 = ha*lb, rm1 = hb*la, rl = la*lb, t = rl + (rm0 << 32);
+	uint64_t c = t < rl;
+	uint64_t lo = t + (rm1 << 32);
+	c += lo < t;
+	uint64_t hi = rh + (rm0 >> 32) + (rm1 >> 32) + c;
+	*a = lo;
+	*b = hi;
+#endif
+}
+
+inline static uint64_t wymix(uint64_t a, uint64_t b)
+{
+	wymum(&a, &b);
+	return a ^ b;
+}
+
+inline static uint64_t wyr8(const uint8_t* p)
+{
+	uint64_t v;
+	memcpy(&v, p, sizeof(uint64_t));
+	return v;
+}
+
+inline static uint64_t wyr4(const uint8_t* p)
+{
+	uint32_t v;
+	memcpy(&v, p, sizeof(uint32_t));
+	return v;
+}
+
+inline static uint64_t wyr3(const uint8_t* p, size_t k)
+{
+	return ((uint64_t)p[0] << 16) | ((uint64_t)p[k >> 1] << 8) | p[k - 1];
+}
+
 static uint32_t hashBytesSmall(uint32_t seed, const void* buffer, size_t size)
 {
 	// Just the tail portion of dsHashCombineBytes().
@@ -492,6 +549,69 @@ void dsHashCombineBytes128(void* outResult, const void* seed, const void* buffer
 }
 #endif
 
+uint64_t dsHashBytes64(const void* buffer, size_t size)
+{
+	return dsHashCombineBytes64(DEFAULT_SEED64, buffer, size);
+}
+
+uint64_t dsHashCombineBytes64(uint64_t seed, const void* buffer, size_t size)
+{
+	// https://github.com/wangyi-fudan/wyhash/blob/master/wyhash.h
+	DS_ASSERT(buffer || size == 0);
+	const uint8_t* p = (const uint8_t*)buffer;
+	seed ^= wymix(seed ^ WY_SECRET0, WY_SECRET1);
+	uint64_t a, b;
+	if (size <= 16)
+	{
+		if (size >= 4)
+		{
+			size_t offset = (size >> 3) << 2;
+			a = (wyr4(p) << 32) | wyr4(p + offset);
+			b = (wyr4(p + size - 4) << 32) | wyr4(p + size - 4 - offset);
+		}
+		else if (size > 0)
+		{
+			a = wyr3(p, size);
+			b = 0;
+		}
+		else
+			a = b = 0;
+	}
+	else
+	{
+		size_t i = size;
+		if (i > 48)
+		{
+			// Three independent lanes to allow the multiplies to execute in parallel.
+			uint64_t seed1 = seed, seed2 = seed;
+			do
+			{
+				seed = wymix(wyr8(p) ^ WY_SECRET1, wyr8(p + 8) ^ seed);
+				seed1 = wymix(wyr8(p + 16) ^ WY_SECRET2, wyr8(p + 24) ^ seed1);
+				seed2 = wymix(wyr8(p + 32) ^ WY_SECRET3, wyr8(p + 40) ^ seed2);
+				p += 48;
+				i -= 48;
+			} while (i > 48);
+			seed ^= seed1 ^ seed2;
+		}
+
+		while (i > 16)
+		{
+			seed = wymix(wyr8(p) ^ WY_SECRET1, wyr8(p + 8) ^ seed);
+			i -= 16;
+			p += 16;
+		}
+
+		a = wyr8(p + i - 16);
+		b = wyr8(p + i - 8);
+	}
+
+	a ^= WY_SECRET1;
+	b ^= seed;
+	wymum(&a, &b);
+	return wymix(a ^ WY_SECRET0 ^ size, b ^ WY_SECRET1);
+}
+
 uint32_t dsHashCombine(uint32_t first, uint32_t second)
 {
 	// Uses the same algorithm as boost::hash_combine()
@@ -514,6 +634,22 @@ uint32_t dsHashCombineString(uint32_t seed, const void* string)
 	return dsHashCombineBytes(seed, string, strlen((const char*)string));
 }
 
+uint64_t dsHashString64(const void* string)
+{
+	if (!string)
+		return DEFAULT_SEED64;
+
+	return dsHashBytes64(string, strlen((const char*)string));
+}
+
+uint64_t dsHashCombineString64(uint64_t seed, const void* string)
+{
+	if (!string)
+		return seed;
+
+	return dsHashCombineBytes64(seed, string, strlen((const char*)string));
+}
+
 bool dsHashStringEqual(const void* first, const void* second)
 {
 	if (first == second)
@@ -0,0 +1,138 @@
+/*
+ * Copyright 2020 Aaron Barany
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <DeepSea/Core/Containers/SlotMap.h>
+
+#include <DeepSea/Core/Containers/ResizeableArray.h>
+#include <DeepSea/Core/Memory/Allocator.h>
+#include <DeepSea/Core/Assert.h>
+#include <DeepSea/Core/Error.h>
+#include <string.h>
+
+#define NO_FREE_SLOT (uint32_t)-1
+
+bool dsSlotMap_initialize(dsSlotMap* slotMap, dsAllocator* allocator)
+{
+	if (!slotMap || !allocator || !allocator->freeFunc)
+	{
+		errno = EINVAL;
+		return false;
+	}
+
+	memset(slotMap, 0, sizeof(*slotMap));
+	slotMap->allocator = allocator;
+	slotMap->freeSlot = NO_FREE_SLOT;
+	return true;
+}
+
+uint64_t dsSlotMap_add(dsSlotMap* slotMap)
+{
+	if (!slotMap || !slotMap->allocator)
+	{
+		errno = EINVAL;
+		return DS_INVALID_SLOT_HANDLE;
+	}
+
+	uint32_t index = slotMap->elementCount;
+	if (!DS_RESIZEABLE_ARRAY_ADD(slotMap->allocator, slotMap->elementSlots, slotMap->elementCount,
+			slotMap->maxElements, 1))
+	{
+		return DS_INVALID_SLOT_HANDLE;
+	}
+
+	uint32_t slot = slotMap->freeSlot;
+	if (slot == NO_FREE_SLOT)
+	{
+		// The maximum slot index is reserved for invalid handles.
+		slot = slotMap->slotCount;
+		if (slot == NO_FREE_SLOT)
+		{
+			--slotMap->elementCount;
+			errno = ENOMEM;
+			return DS_INVALID_SLOT_HANDLE;
+		}
+
+		if (!DS_RESIZEABLE_ARRAY_ADD(slotMap->allocator, slotMap->slots, slotMap->slotCount,
+				slotMap->maxSlots, 1))
+		{
+			--slotMap->elementCount;
+			return DS_INVALID_SLOT_HANDLE;
+		}
+
+		slotMap->slots[slot].generation = 0;
+	}
+	else
+		slotMap->freeSlot = slotMap->slots[slot].index;
+
+	dsSlotMapSlot* slotInfo = slotMap->slots + slot;
+	slotInfo->index = index;
+	slotMap->elementSlots[index] = slot;
+	return ((uint64_t)slotInfo->generation << 32) | slot;
+}
+
+uint32_t dsSlotMap_remove(dsSlotMap* slotMap, uint64_t handle)
+{
+	uint32_t index = dsSlotMap_getIndex(slotMap, handle);
+	if (index == DS_INVALID_SLOT_INDEX)
+	{
+		errno = ENOTFOUND;
+		return DS_INVALID_SLOT_INDEX;
+	}
+
+	uint32_t slot = (uint32_t)handle;
+	uint32_t lastIndex = --slotMap->elementCount;
+	if (index != lastIndex)
+	{
+		uint32_t movedSlot = slotMap->elementSlots[lastIndex];
+		slotMap->elementSlots[index] = movedSlot;
+		slotMap->slots[movedSlot].index = index;
+	}
+
+	dsSlotMapSlot* slotInfo = slotMap->slots + slot;
+	++slotInfo->generation;
+	slotInfo->index = slotMap->freeSlot;
+	slotMap->freeSlot = slot;
+	return index;
+}
+
+void dsSlotMap_clear(dsSlotMap* slotMap)
+{
+	if (!slotMap)
+		return;
+
+	for (uint32_t i = 0; i < slotMap->elementCount; ++i)
+	{
+		uint32_t slot = slotMap->elementSlots[i];
+		dsSlotMapSlot* slotInfo = slotMap->slots + slot;
+		++slotInfo->generation;
+		slotInfo->index = slotMap->freeSlot;
+		slotMap->freeSlot = slot;
+	}
+	slotMap->elementCount = 0;
+}
+
+void dsSlotMap_shutdown(dsSlotMap* slotMap)
+{
+	if (!slotMap || !slotMap->allocator)
+		return;
+
+	DS_VERIFY(dsAllocator_free(slotMap->allocator, slotMap->slots));
+	DS_VERIFY(dsAllocator_free(slotMap->allocator, slotMap->elementSlots));
+	memset(slotMap, 0, sizeof(*slotMap));
+}
+
+uint32_t dsSlotMap_getIndex(const dsSlotMap* slotMap, uint64_t handle);
+uint64_t dsSlotMap_getHandle(const dsSlotMap* slotMap, uint32_t index);
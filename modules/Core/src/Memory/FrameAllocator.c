@@ -0,0 +1,308 @@
+/*
+ * Copyright 2020 Aaron Barany
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <DeepSea/Core/Memory/FrameAllocator.h>
+#include <DeepSea/Core/Memory/Allocator.h>
+#include <DeepSea/Core/Memory/Memory.h>
+#include <DeepSea/Core/Thread/Spinlock.h>
+#include <DeepSea/Core/Thread/ThreadStorage.h>
+#include <DeepSea/Core/Assert.h>
+#include <DeepSea/Core/Error.h>
+#include <DeepSea/Core/Log.h>
+
+typedef struct Chunk
+{
+	struct Chunk* next;
+	size_t size;
+	// Only accessed by the thread that acquired the chunk.
+	size_t offset;
+} Chunk;
+
+#define CHUNK_HEADER_SIZE DS_ALIGNED_SIZE(sizeof(Chunk))
+#define CHUNK_DATA(chunk) ((uint8_t*)(chunk) + CHUNK_HEADER_SIZE)
+
+typedef struct ThreadState
+{
+	struct ThreadState* next;
+	uint64_t frameNumber;
+	Chunk* chunk;
+} ThreadState;
+
+struct dsFrameAllocator
+{
+	dsAllocator allocator;
+	dsAllocator* parentAllocator;
+	uint32_t frameCount;
+	size_t chunkSize;
+	uint64_t frameNumber;
+
+	dsThreadStorage threadStorage;
+	dsSpinlock lock;
+	Chunk* frameChunks[DS_MAX_FRAME_ALLOCATOR_FRAMES];
+	Chunk* freeChunks;
+	ThreadState* threadStates;
+};
+
+static ThreadState* getThreadState(dsFrameAllocator* allocator)
+{
+	ThreadState* state = (ThreadState*)dsThreadStorage_get(allocator->threadStorage);
+	if (state)
+		return state;
+
+	state = DS_ALLOCATE_OBJECT(allocator->parentAllocator, ThreadState);
+	if (!state)
+		return NULL;
+
+	state->frameNumber = allocator->frameNumber;
+	state->chunk = NULL;
+	if (!dsThreadStorage_set(allocator->threadStorage, state))
+	{
+		DS_VERIFY(dsAllocator_free(allocator->parentAllocator, state));
+		return NULL;
+	}
+
+	DS_VERIFY(dsSpinlock_lock(&allocator->lock));
+	state->next = allocator->threadStates;
+	allocator->threadStates = state;
+	DS_VERIFY(dsSpinlock_unlock(&allocator->lock));
+	return state;
+}
+
+static Chunk* acquireChunk(dsFrameAllocator* allocator, size_t size)
+{
+	Chunk* chunk = NULL;
+	DS_VERIFY(dsSpinlock_lock(&allocator->lock));
+	if (size <= allocator->chunkSize && allocator->freeChunks)
+	{
+		chunk = allocator->freeChunks;
+		allocator->freeChunks = chunk->next;
+	}
+	DS_VERIFY(dsSpinlock_unlock(&allocator->lock));
+
+	if (!chunk)
+	{
+		// Allocate outside of the lock, since it may be slow.
+		size_t chunkSize = size > allocator->chunkSize ? size : allocator->chunkSize;
+		chunk = (Chunk*)dsAllocator_alloc(allocator->parentAllocator,
+			CHUNK_HEADER_SIZE + chunkSize);
+		if (!chunk)
+			return NULL;
+
+		chunk->size = chunkSize;
+	}
+
+	chunk->offset = 0;
+
+	DS_VERIFY(dsSpinlock_lock(&allocator->lock));
+	Chunk** frameChunks = allocator->frameChunks + allocator->frameNumber % allocator->frameCount;
+	chunk->next = *frameChunks;
+	*frameChunks = chunk;
+	((dsAllocator*)allocator)->size += CHUNK_HEADER_SIZE + chunk->size;
+	DS_VERIFY(dsSpinlock_unlock(&allocator->lock));
+	return chunk;
+}
+
+static void* allocFromChunk(Chunk* chunk, size_t size, unsigned int alignment)
+{
+	uint8_t* data = CHUNK_DATA(chunk);
+	uintptr_t start = (uintptr_t)(data + chunk->offset);
+	size_t offset = (size_t)((start + alignment - 1) & ~(uintptr_t)(alignment - 1)) -
+		(size_t)(uintptr_t)data;
+	if (offset > chunk->size || size > chunk->size - offset)
+		return NULL;
+
+	chunk->offset = offset + size;
+	return data + offset;
+}
+
+static void freeChunkList(dsAllocator* allocator, Chunk* chunk)
+{
+	while (chunk)
+	{
+		Chunk* next = chunk->next;
+		DS_VERIFY(dsAllocator_free(allocator, chunk));
+		chunk = next;
+	}
+}
+
+dsFrameAllocator* dsFrameAllocator_create(dsAllocator* allocator, uint32_t frameCount,
+	size_t chunkSize)
+{
+	if (!allocator || frameCount == 0 || frameCount > DS_MAX_FRAME_ALLOCATOR_FRAMES)
+	{
+		errno = EINVAL;
+		return NULL;
+	}
+
+	if (!allocator->freeFunc)
+	{
+		errno = EINVAL;
+		DS_LOG_ERROR(DS_CORE_LOG_TAG, "Frame allocator allocator must support freeing memory.");
+		return NULL;
+	}
+
+	dsFrameAllocator* frameAllocator = DS_ALLOCATE_OBJECT(allocator, dsFrameAllocator);
+	if (!frameAllocator)
+		return NULL;
+
+	if (!dsThreadStorage_initialize(&frameAllocator->threadStorage))
+	{
+		DS_VERIFY(dsAllocator_free(allocator, frameAllocator));
+		return NULL;
+	}
+
+	if (!dsSpinlock_initialize(&frameAllocator->lock))
+	{
+		dsThreadStorage_shutdown(&frameAllocator->threadStorage);
+		DS_VERIFY(dsAllocator_free(allocator, frameAllocator));
+		return NULL;
+	}
+
+	dsAllocator* baseAllocator = (dsAllocator*)frameAllocator;
+	baseAllocator->size = 0;
+	baseAllocator->totalAllocations = 0;
+	baseAllocator->currentAllocations = 0;
+	baseAllocator->allocFunc = (dsAllocatorAllocFunction)&dsFrameAllocator_alloc;
+	baseAllocator->reallocFunc = NULL;
+	baseAllocator->freeFunc = NULL;
+
+	frameAllocator->parentAllocator = dsAllocator_keepPointer(allocator);
+	frameAllocator->frameCount = frameCount;
+	frameAllocator->chunkSize =
+		chunkSize ? DS_ALIGNED_SIZE(chunkSize) : DS_DEFAULT_FRAME_ALLOCATOR_CHUNK_SIZE;
+	frameAllocator->frameNumber = 0;
+	for (uint32_t i = 0; i < DS_MAX_FRAME_ALLOCATOR_FRAMES; ++i)
+		frameAllocator->frameChunks[i] = NULL;
+	frameAllocator->freeChunks = NULL;
+	frameAllocator->threadStates = NULL;
+	return frameAllocator;
+}
+
+void* dsFrameAllocator_alloc(dsFrameAllocator* allocator, size_t size, unsigned int alignment)
+{
+	if (!allocator || !size || alignment == 0 || (alignment & (alignment - 1)) != 0)
+	{
+		errno = EINVAL;
+		return NULL;
+	}
+
+	ThreadState* state = getThreadState(allocator);
+	if (!state)
+		return NULL;
+
+	// The chunk for the thread is only valid for the frame it was acquired in.
+	if (state->frameNumber != allocator->frameNumber)
+	{
+		state->frameNumber = allocator->frameNumber;
+		state->chunk = NULL;
+	}
+
+	if (state->chunk)
+	{
+		void* ptr = allocFromChunk(state->chunk, size, alignment);
+		if (ptr)
+			return ptr;
+	}
+
+	// Chunk data is always aligned to DS_ALLOC_ALIGNMENT, so only need extra space for larger
+	// alignments.
+	size_t requiredSize = size;
+	if (alignment > DS_ALLOC_ALIGNMENT)
+		requiredSize += alignment;
+
+	Chunk* chunk = acquireChunk(allocator, requiredSize);
+	if (!chunk)
+		return NULL;
+
+	// Keep allocating from the current chunk when the allocation needs its own chunk.
+	if (requiredSize <= allocator->chunkSize || !state->chunk)
+		state->chunk = chunk;
+
+	void* ptr = allocFromChunk(chunk, size, alignment);
+	DS_ASSERT(ptr);
+	return ptr;
+}
+
+uint64_t dsFrameAllocator_getFrameNumber(const dsFrameAllocator* allocator)
+{
+	if (!allocator)
+		return 0;
+
+	return allocator->frameNumber;
+}
+
+bool dsFrameAllocator_beginFrame(dsFrameAllocator* allocator, uint64_t frameNumber)
+{
+	if (!allocator || frameNumber <= allocator->frameNumber)
+	{
+		errno = EINVAL;
+		return false;
+	}
+
+	// Recycle the chunks for each frame that's being re-used. This is usually a single frame, but
+	// may be more if frames were skipped.
+	uint64_t frameCount = frameNumber - allocator->frameNumber;
+	if (frameCount > allocator->frameCount)
+		frameCount = allocator->frameCount;
+
+	DS_VERIFY(dsSpinlock_lock(&allocator->lock));
+	for (uint64_t i = 0; i < frameCount; ++i)
+	{
+		Chunk** frameChunks = allocator->frameChunks + (frameNumber - i) % allocator->frameCount;
+		Chunk* chunk = *frameChunks;
+		while (chunk)
+		{
+			Chunk* next = chunk->next;
+			((dsAllocator*)allocator)->size -= CHUNK_HEADER_SIZE + chunk->size;
+			// Only keep the chunks with the standard size.
+			if (chunk->size == allocator->chunkSize)
+			{
+				chunk->next = allocator->freeChunks;
+				allocator->freeChunks = chunk;
+			}
+			else
+				DS_VERIFY(dsAllocator_free(allocator->parentAllocator, chunk));
+			chunk = next;
+		}
+		*frameChunks = NULL;
+	}
+	allocator->frameNumber = frameNumber;
+	DS_VERIFY(dsSpinlock_unlock(&allocator->lock));
+	return true;
+}
+
+void dsFrameAllocator_destroy(dsFrameAllocator* allocator)
+{
+	if (!allocator)
+		return;
+
+	dsAllocator* parentAllocator = allocator->parentAllocator;
+	for (uint32_t i = 0; i < DS_MAX_FRAME_ALLOCATOR_FRAMES; ++i)
+		freeChunkList(parentAllocator, allocator->frameChunks[i]);
+	freeChunkList(parentAllocator, allocator->freeChunks);
+
+	ThreadState* state = allocator->threadStates;
+	while (state)
+	{
+		ThreadState* next = state->next;
+		DS_VERIFY(dsAllocator_free(parentAllocator, state));
+		state = next;
+	}
+
+	dsSpinlock_shutdown(&allocator->lock);
+	dsThreadStorage_shutdown(&allocator->threadStorage);
+	DS_VERIFY(dsAllocator_free(parentAllocator, allocator));
+}
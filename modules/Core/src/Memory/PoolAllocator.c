@@ -18,13 +18,173 @@
 #include <DeepSea/Core/Memory/Allocator.h>
 #include <DeepSea/Core/Memory/Memory.h>
 #include <DeepSea/Core/Thread/Spinlock.h>
+#include <DeepSea/Core/Thread/ThreadStorage.h>
 #include <DeepSea/Core/Assert.h>
+#include <DeepSea/Core/Atomic.h>
 #include <DeepSea/Core/Error.h>
 
 #define DS_NONE ((size_t)-1)
 #define DS_BASE_PTR(allocator, index) \
 	((uint8_t*)(allocator)->buffer + (index)*(allocator)->chunkSize)
 
+#define DS_TAGGED_NONE 0xFFFFFFFFU
+#define DS_TAGGED_INDEX(head) ((uint32_t)(head))
+#define DS_TAGGED_TAG(head) ((uint32_t)((head) >> 32))
+#define DS_MAKE_TAGGED(index, tag) (((uint64_t)(tag) << 32) | (uint64_t)(index))
+#define DS_NEXT_INDEX(allocator, index) (*(size_t*)DS_BASE_PTR(allocator, index))
+
+// Stored in a chunk taken from the pool for each thread.
+typedef struct Magazine
+{
+	size_t head;
+	size_t count;
+} Magazine;
+
+_Static_assert(sizeof(Magazine) <= DS_ALLOC_ALIGNMENT, "Magazine doesn't fit in a chunk.");
+
+static void linkLockFreeChunks(dsPoolAllocator* allocator)
+{
+	for (size_t i = 0; i < allocator->chunkCount - 1; ++i)
+		DS_NEXT_INDEX(allocator, i) = i + 1;
+	DS_NEXT_INDEX(allocator, allocator->chunkCount - 1) = DS_NONE;
+	allocator->head = 0;
+	allocator->initializedCount = allocator->chunkCount;
+	allocator->taggedHead = DS_MAKE_TAGGED(0, 0);
+}
+
+static size_t popShared(dsPoolAllocator* allocator, size_t maxCount, size_t* outFirst)
+{
+	uint64_t head, newHead;
+	size_t first, last, count;
+	DS_ATOMIC_LOAD64(&allocator->taggedHead, &head);
+	do
+	{
+		if (DS_TAGGED_INDEX(head) == DS_TAGGED_NONE)
+			return 0;
+
+		/*
+		 * Other threads may allocate and write over the chunks while walking the list, so the
+		 * next indices may be garbage. This is safe since the chunks are always within the buffer,
+		 * and any change to the list changes the tag so the exchange will fail.
+		 */
+		first = DS_TAGGED_INDEX(head);
+		last = first;
+		count = 1;
+		size_t next = DS_NEXT_INDEX(allocator, last);
+		while (count < maxCount && next < allocator->chunkCount)
+		{
+			last = next;
+			++count;
+			next = DS_NEXT_INDEX(allocator, last);
+		}
+
+		uint32_t nextIndex = next < allocator->chunkCount ? (uint32_t)next : DS_TAGGED_NONE;
+		newHead = DS_MAKE_TAGGED(nextIndex, DS_TAGGED_TAG(head) + 1);
+	} while (!DS_ATOMIC_COMPARE_EXCHANGE64(&allocator->taggedHead, &head, &newHead, true));
+
+	DS_NEXT_INDEX(allocator, last) = DS_NONE;
+	DS_ATOMIC_FETCH_ADD_SIZE(&allocator->freeCount, -count);
+	DS_ATOMIC_FETCH_ADD_SIZE(&((dsAllocator*)allocator)->size, count*allocator->chunkSize);
+	DS_ATOMIC_FETCH_ADD32(&((dsAllocator*)allocator)->totalAllocations, count);
+	DS_ATOMIC_FETCH_ADD32(&((dsAllocator*)allocator)->currentAllocations, count);
+
+	*outFirst = first;
+	return count;
+}
+
+static void pushShared(dsPoolAllocator* allocator, size_t first, size_t last, size_t count)
+{
+	uint64_t head, newHead;
+	DS_ATOMIC_LOAD64(&allocator->taggedHead, &head);
+	do
+	{
+		uint32_t headIndex = DS_TAGGED_INDEX(head);
+		DS_NEXT_INDEX(allocator, last) = headIndex == DS_TAGGED_NONE ? DS_NONE : headIndex;
+		newHead = DS_MAKE_TAGGED(first, DS_TAGGED_TAG(head) + 1);
+	} while (!DS_ATOMIC_COMPARE_EXCHANGE64(&allocator->taggedHead, &head, &newHead, true));
+
+	DS_ATOMIC_FETCH_ADD_SIZE(&allocator->freeCount, count);
+	DS_ATOMIC_FETCH_ADD_SIZE(&((dsAllocator*)allocator)->size, -(count*allocator->chunkSize));
+	DS_ATOMIC_FETCH_ADD32(&((dsAllocator*)allocator)->currentAllocations, -(int32_t)count);
+}
+
+static Magazine* getMagazine(dsPoolAllocator* allocator)
+{
+	Magazine* magazine = (Magazine*)dsThreadStorage_get(allocator->magazineStorage);
+	if (magazine)
+		return magazine;
+
+	size_t index;
+	if (!popShared(allocator, 1, &index))
+		return NULL;
+
+	magazine = (Magazine*)DS_BASE_PTR(allocator, index);
+	magazine->head = DS_NONE;
+	magazine->count = 0;
+	if (!dsThreadStorage_set(allocator->magazineStorage, magazine))
+	{
+		pushShared(allocator, index, index, 1);
+		return NULL;
+	}
+
+	return magazine;
+}
+
+static void* allocLockFree(dsPoolAllocator* allocator)
+{
+	size_t index;
+	Magazine* magazine = allocator->magazineSize > 0 ? getMagazine(allocator) : NULL;
+	if (!magazine)
+	{
+		if (!popShared(allocator, 1, &index))
+		{
+			errno = ENOMEM;
+			return NULL;
+		}
+		return DS_BASE_PTR(allocator, index);
+	}
+
+	if (magazine->count == 0)
+	{
+		magazine->count = popShared(allocator, allocator->magazineSize, &magazine->head);
+		if (magazine->count == 0)
+		{
+			errno = ENOMEM;
+			return NULL;
+		}
+	}
+
+	index = magazine->head;
+	magazine->head = DS_NEXT_INDEX(allocator, index);
+	--magazine->count;
+	return DS_BASE_PTR(allocator, index);
+}
+
+static void freeLockFree(dsPoolAllocator* allocator, size_t index)
+{
+	Magazine* magazine = allocator->magazineSize > 0 ? getMagazine(allocator) : NULL;
+	if (!magazine)
+	{
+		pushShared(allocator, index, index, 1);
+		return;
+	}
+
+	DS_NEXT_INDEX(allocator, index) = magazine->head;
+	magazine->head = index;
+
+	// Return a batch to the shared list once there are two batches worth cached.
+	if (++magazine->count > allocator->magazineSize*2)
+	{
+		size_t first = magazine->head;
+		size_t last = first;
+		for (uint32_t i = 1; i < allocator->magazineSize; ++i)
+			last = DS_NEXT_INDEX(allocator, last);
+		magazine->head = DS_NEXT_INDEX(allocator, last);
+		magazine->count -= allocator->magazineSize;
+		pushShared(allocator, first, last, allocator->magazineSize);
+	}
+}
+
 size_t dsPoolAllocator_bufferSize(size_t chunkSize, size_t chunkCount)
 {
 	return DS_ALIGNED_SIZE(chunkSize)*chunkCount;
@@ -63,6 +223,36 @@ bool dsPoolAllocator_initialize(dsPoolAllocator* allocator, size_t chunkSize, si
 	allocator->freeCount = chunkCount;
 	allocator->initializedCount = 0;
 	*(size_t*)allocator->buffer = DS_NONE;
+	allocator->taggedHead = DS_MAKE_TAGGED(DS_TAGGED_NONE, 0);
+	allocator->magazineSize = 0;
+	allocator->lockFree = false;
+	return true;
+}
+
+bool dsPoolAllocator_initializeLockFree(dsPoolAllocator* allocator, size_t chunkSize,
+	size_t chunkCount, void* buffer, size_t bufferSize, uint32_t magazineSize)
+{
+	if (chunkCount >= DS_TAGGED_NONE)
+	{
+		errno = EINVAL;
+		if (allocator)
+			allocator->buffer = NULL;
+		return false;
+	}
+
+	if (!dsPoolAllocator_initialize(allocator, chunkSize, chunkCount, buffer, bufferSize))
+		return false;
+
+	if (magazineSize > 0 && !dsThreadStorage_initialize(&allocator->magazineStorage))
+	{
+		dsPoolAllocator_shutdown(allocator);
+		return false;
+	}
+
+	// The free list can't be lazily initialized without a lock.
+	linkLockFreeChunks(allocator);
+	allocator->magazineSize = magazineSize;
+	allocator->lockFree = true;
 	return true;
 }
 
@@ -86,6 +276,9 @@ void* dsPoolAllocator_alloc(dsPoolAllocator* allocator, size_t size, unsigned in
 		return NULL;
 	}
 
+	if (allocator->lockFree)
+		return allocLockFree(allocator);
+
 	if (!dsSpinlock_lock(&allocator->lock))
 		return NULL;
 
@@ -172,6 +365,12 @@ bool dsPoolAllocator_free(dsPoolAllocator* allocator, void* ptr)
 		return false;
 	}
 
+	if (allocator->lockFree)
+	{
+		freeLockFree(allocator, index);
+		return true;
+	}
+
 	if (!dsSpinlock_lock(&allocator->lock))
 		return false;
 
@@ -190,6 +389,34 @@ bool dsPoolAllocator_free(dsPoolAllocator* allocator, void* ptr)
 	return true;
 }
 
+bool dsPoolAllocator_flushThread(dsPoolAllocator* allocator)
+{
+	if (!allocator || !allocator->buffer)
+	{
+		errno = EINVAL;
+		return false;
+	}
+
+	if (!allocator->lockFree || allocator->magazineSize == 0)
+		return true;
+
+	Magazine* magazine = (Magazine*)dsThreadStorage_get(allocator->magazineStorage);
+	if (!magazine)
+		return true;
+
+	if (magazine->count > 0)
+	{
+		size_t last = magazine->head;
+		for (size_t i = 1; i < magazine->count; ++i)
+			last = DS_NEXT_INDEX(allocator, last);
+		pushShared(allocator, magazine->head, last, magazine->count);
+	}
+
+	size_t index = ((uint8_t*)magazine - (uint8_t*)allocator->buffer)/allocator->chunkSize;
+	pushShared(allocator, index, index, 1);
+	return dsThreadStorage_set(allocator->magazineStorage, NULL);
+}
+
 bool dsPoolAllocator_reset(dsPoolAllocator* allocator)
 {
 	if (!allocator || !allocator->buffer || !allocator->chunkCount ||
@@ -207,6 +434,21 @@ bool dsPoolAllocator_reset(dsPoolAllocator* allocator)
 	allocator->freeCount = allocator->chunkCount;
 	allocator->initializedCount = 0;
 	*(size_t*)allocator->buffer = DS_NONE;
+
+	if (allocator->lockFree)
+	{
+		// Re-create the thread storage to clear the magazines for all threads.
+		if (allocator->magazineSize > 0)
+		{
+			dsThreadStorage_shutdown(&allocator->magazineStorage);
+			if (!dsThreadStorage_initialize(&allocator->magazineStorage))
+			{
+				allocator->magazineSize = 0;
+				return false;
+			}
+		}
+		linkLockFreeChunks(allocator);
+	}
 	return true;
 }
 
@@ -222,6 +464,24 @@ bool dsPoolAllocator_validate(dsPoolAllocator* allocator)
 		return false;
 	}
 
+	if (allocator->lockFree)
+	{
+		if (allocator->freeCount > allocator->chunkCount)
+			return false;
+
+		size_t foundNodes = 0;
+		for (uint32_t next = DS_TAGGED_INDEX(allocator->taggedHead); next != DS_TAGGED_NONE;)
+		{
+			if (next >= allocator->chunkCount || foundNodes >= allocator->freeCount)
+				return false;
+
+			++foundNodes;
+			size_t nextIndex = DS_NEXT_INDEX(allocator, next);
+			next = nextIndex == DS_NONE ? DS_TAGGED_NONE : (uint32_t)nextIndex;
+		}
+		return foundNodes == allocator->freeCount;
+	}
+
 	if (!dsSpinlock_lock(&allocator->lock))
 		return false;
 
@@ -287,4 +547,8 @@ void dsPoolAllocator_shutdown(dsPoolAllocator* allocator)
 	allocator->freeCount = 0;
 	allocator->initializedCount = 0;
 	dsSpinlock_shutdown(&allocator->lock);
+	if (allocator->lockFree && allocator->magazineSize > 0)
+		dsThreadStorage_shutdown(&allocator->magazineStorage);
+	allocator->magazineSize = 0;
+	allocator->lockFree = false;
 }
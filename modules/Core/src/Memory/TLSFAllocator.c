@@ -0,0 +1,584 @@
+/*
+ * Copyright 2020 Aaron Barany
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <DeepSea/Core/Memory/TLSFAllocator.h>
+
+#include "TLSFMapping.h"
+#include <DeepSea/Core/Memory/Memory.h>
+#include <DeepSea/Core/Thread/Spinlock.h>
+#include <DeepSea/Core/Assert.h>
+#include <DeepSea/Core/Error.h>
+#include <string.h>
+
+// Blocks are laid out sequentially in the buffer, each with a header followed by the data. The
+// sizes stored in the headers are for the data, excluding the header. The end of the buffer has a
+// used sentinel block with a size of 0 so the last block doesn't need to be special-cased.
+typedef struct BlockHeader
+{
+	size_t prevSize;
+	size_t size;
+} BlockHeader;
+
+// Stored in the data of free blocks.
+typedef struct FreeLinks
+{
+	BlockHeader* next;
+	BlockHeader* prev;
+} FreeLinks;
+
+_Static_assert(sizeof(BlockHeader) <= DS_TLSF_BLOCK_HEADER_SIZE, "Unexpected header size.");
+_Static_assert(DS_TLSF_BLOCK_HEADER_SIZE == DS_TLSF_GRANULARITY, "Unexpected header size.");
+_Static_assert(sizeof(FreeLinks) <= DS_TLSF_GRANULARITY, "Unexpected free links size.");
+
+#define FREE_BIT 0x1
+#define MIN_DATA_SIZE ((size_t)DS_TLSF_GRANULARITY)
+#define MIN_BLOCK_SIZE (DS_TLSF_BLOCK_HEADER_SIZE + MIN_DATA_SIZE)
+#define BLOCK_SIZE(block) ((block)->size & ~(size_t)FREE_BIT)
+#define BLOCK_IS_FREE(block) (((block)->size & FREE_BIT) != 0)
+#define BLOCK_DATA(block) ((uint8_t*)(block) + DS_TLSF_BLOCK_HEADER_SIZE)
+#define BLOCK_FROM_DATA(ptr) ((BlockHeader*)((uint8_t*)(ptr) - DS_TLSF_BLOCK_HEADER_SIZE))
+#define NEXT_BLOCK(block) ((BlockHeader*)(BLOCK_DATA(block) + BLOCK_SIZE(block)))
+#define PREV_BLOCK(block) \
+	((BlockHeader*)((uint8_t*)(block) - (block)->prevSize - DS_TLSF_BLOCK_HEADER_SIZE))
+#define FREE_LINKS(block) ((FreeLinks*)BLOCK_DATA(block))
+
+static void insertFreeBlock(dsTLSFAllocator* allocator, BlockHeader* block)
+{
+	size_t size = BLOCK_SIZE(block);
+	uint32_t first, second;
+	dsTLSF_mapping(&first, &second, size);
+
+	BlockHeader** head = (BlockHeader**)allocator->freeLists[first] + second;
+	FreeLinks* links = FREE_LINKS(block);
+	links->next = *head;
+	links->prev = NULL;
+	if (*head)
+		FREE_LINKS(*head)->prev = block;
+	*head = block;
+
+	allocator->firstLevelBitmap |= 1U << first;
+	allocator->secondLevelBitmaps[first] |= 1U << second;
+	allocator->freeSize += size;
+	++allocator->freeBlockCount;
+	block->size = size | FREE_BIT;
+}
+
+static void removeFreeBlock(dsTLSFAllocator* allocator, BlockHeader* block)
+{
+	DS_ASSERT(BLOCK_IS_FREE(block));
+	size_t size = BLOCK_SIZE(block);
+	uint32_t first, second;
+	dsTLSF_mapping(&first, &second, size);
+
+	FreeLinks* links = FREE_LINKS(block);
+	if (links->next)
+		FREE_LINKS(links->next)->prev = links->prev;
+	if (links->prev)
+		FREE_LINKS(links->prev)->next = links->next;
+	else
+	{
+		BlockHeader** head = (BlockHeader**)allocator->freeLists[first] + second;
+		DS_ASSERT(*head == block);
+		*head = links->next;
+		if (!*head)
+		{
+			allocator->secondLevelBitmaps[first] &= ~(1U << second);
+			if (!allocator->secondLevelBitmaps[first])
+				allocator->firstLevelBitmap &= ~(1U << first);
+		}
+	}
+
+	DS_ASSERT(allocator->freeSize >= size && allocator->freeBlockCount > 0);
+	allocator->freeSize -= size;
+	--allocator->freeBlockCount;
+	block->size = size;
+}
+
+// Splits the end of a used block into a free block if the remaining space is large enough.
+static void trimBlock(dsTLSFAllocator* allocator, BlockHeader* block, size_t size)
+{
+	DS_ASSERT(!BLOCK_IS_FREE(block));
+	size_t blockSize = BLOCK_SIZE(block);
+	DS_ASSERT(blockSize >= size);
+	if (blockSize - size < MIN_BLOCK_SIZE)
+		return;
+
+	BlockHeader* next = NEXT_BLOCK(block);
+	block->size = size;
+	BlockHeader* remaining = NEXT_BLOCK(block);
+	remaining->prevSize = size;
+	remaining->size = blockSize - size - DS_TLSF_BLOCK_HEADER_SIZE;
+
+	// Merge with the following block to keep all free blocks coalesced.
+	if (BLOCK_IS_FREE(next))
+	{
+		removeFreeBlock(allocator, next);
+		remaining->size += DS_TLSF_BLOCK_HEADER_SIZE + BLOCK_SIZE(next);
+		next = NEXT_BLOCK(remaining);
+	}
+
+	next->prevSize = remaining->size;
+	insertFreeBlock(allocator, remaining);
+}
+
+static size_t adjustSize(size_t size)
+{
+	if (size < MIN_DATA_SIZE)
+		return MIN_DATA_SIZE;
+	return DS_ALIGNED_SIZE(size);
+}
+
+static void initializeBlocks(dsTLSFAllocator* allocator)
+{
+	allocator->freeSize = 0;
+	allocator->freeBlockCount = 0;
+	allocator->firstLevelBitmap = 0;
+	memset(allocator->secondLevelBitmaps, 0, sizeof(allocator->secondLevelBitmaps));
+	memset(allocator->freeLists, 0, sizeof(allocator->freeLists));
+
+	size_t bufferSize = allocator->bufferSize & ~(size_t)(DS_TLSF_GRANULARITY - 1);
+	BlockHeader* block = (BlockHeader*)allocator->buffer;
+	block->prevSize = 0;
+	block->size = bufferSize - DS_TLSF_BLOCK_HEADER_SIZE*2;
+
+	BlockHeader* sentinel = NEXT_BLOCK(block);
+	sentinel->prevSize = block->size;
+	sentinel->size = 0;
+
+	insertFreeBlock(allocator, block);
+}
+
+static void* allocImpl(dsTLSFAllocator* allocator, size_t size, unsigned int alignment)
+{
+	// Extra space is needed when the alignment is larger than the natural alignment of blocks. The
+	// space before the aligned address must be large enough for a free block.
+	size_t searchSize = size;
+	if (alignment > DS_TLSF_GRANULARITY)
+		searchSize += alignment + MIN_BLOCK_SIZE;
+
+	uint32_t first, second;
+	if (searchSize < size || !dsTLSF_searchMapping(&first, &second, searchSize) ||
+		!dsTLSF_findFreeList(&first, &second, allocator->firstLevelBitmap,
+			allocator->secondLevelBitmaps))
+	{
+		errno = ENOMEM;
+		return NULL;
+	}
+
+	BlockHeader* block = ((BlockHeader**)allocator->freeLists[first])[second];
+	DS_ASSERT(block && BLOCK_SIZE(block) >= searchSize);
+	removeFreeBlock(allocator, block);
+
+	uintptr_t data = (uintptr_t)BLOCK_DATA(block);
+	if (data % alignment != 0)
+	{
+		uintptr_t alignedData =
+			(data + MIN_BLOCK_SIZE + alignment - 1) & ~(uintptr_t)(alignment - 1);
+		size_t offset = (size_t)(alignedData - data);
+		size_t blockSize = BLOCK_SIZE(block);
+		DS_ASSERT(offset >= MIN_BLOCK_SIZE && blockSize - offset >= size);
+
+		// The previous block is never free since free blocks are always merged.
+		BlockHeader* alignedBlock = BLOCK_FROM_DATA(alignedData);
+		block->size = offset - DS_TLSF_BLOCK_HEADER_SIZE;
+		alignedBlock->prevSize = block->size;
+		alignedBlock->size = blockSize - offset;
+		NEXT_BLOCK(alignedBlock)->prevSize = alignedBlock->size;
+		insertFreeBlock(allocator, block);
+		block = alignedBlock;
+	}
+
+	trimBlock(allocator, block, size);
+
+	dsAllocator* baseAllocator = (dsAllocator*)allocator;
+	baseAllocator->size += DS_TLSF_BLOCK_HEADER_SIZE + BLOCK_SIZE(block);
+	++baseAllocator->totalAllocations;
+	++baseAllocator->currentAllocations;
+	return BLOCK_DATA(block);
+}
+
+static void freeImpl(dsTLSFAllocator* allocator, BlockHeader* block)
+{
+	dsAllocator* baseAllocator = (dsAllocator*)allocator;
+	size_t size = BLOCK_SIZE(block);
+	DS_ASSERT(baseAllocator->size >= DS_TLSF_BLOCK_HEADER_SIZE + size &&
+		baseAllocator->currentAllocations > 0);
+	baseAllocator->size -= DS_TLSF_BLOCK_HEADER_SIZE + size;
+	--baseAllocator->currentAllocations;
+
+	BlockHeader* next = NEXT_BLOCK(block);
+	if (BLOCK_IS_FREE(next))
+	{
+		removeFreeBlock(allocator, next);
+		size += DS_TLSF_BLOCK_HEADER_SIZE + BLOCK_SIZE(next);
+		block->size = size;
+	}
+
+	if (block != allocator->buffer)
+	{
+		BlockHeader* prev = PREV_BLOCK(block);
+		if (BLOCK_IS_FREE(prev))
+		{
+			removeFreeBlock(allocator, prev);
+			size += DS_TLSF_BLOCK_HEADER_SIZE + BLOCK_SIZE(prev);
+			block = prev;
+			block->size = size;
+		}
+	}
+
+	NEXT_BLOCK(block)->prevSize = size;
+	insertFreeBlock(allocator, block);
+}
+
+static bool isAllocatedBlock(const dsTLSFAllocator* allocator, const void* ptr)
+{
+	uintptr_t begin = (uintptr_t)allocator->buffer + DS_TLSF_BLOCK_HEADER_SIZE;
+	uintptr_t end = (uintptr_t)allocator->buffer + allocator->bufferSize;
+	if ((uintptr_t)ptr < begin || (uintptr_t)ptr >= end ||
+		(uintptr_t)ptr % DS_TLSF_GRANULARITY != 0)
+	{
+		return false;
+	}
+
+	const BlockHeader* block = BLOCK_FROM_DATA(ptr);
+	return !BLOCK_IS_FREE(block) && BLOCK_SIZE(block) > 0;
+}
+
+bool dsTLSFAllocator_initialize(dsTLSFAllocator* allocator, void* buffer, size_t bufferSize)
+{
+	if (!allocator || !buffer || bufferSize < DS_TLSF_MIN_BUFFER_SIZE ||
+		bufferSize > DS_TLSF_MAX_SIZE || (uintptr_t)buffer % DS_ALLOC_ALIGNMENT != 0)
+	{
+		errno = EINVAL;
+		return false;
+	}
+
+	if (!dsSpinlock_initialize(&allocator->lock))
+		return false;
+
+	dsAllocator* baseAllocator = (dsAllocator*)allocator;
+	baseAllocator->size = 0;
+	baseAllocator->totalAllocations = 0;
+	baseAllocator->currentAllocations = 0;
+	baseAllocator->allocFunc = (dsAllocatorAllocFunction)&dsTLSFAllocator_alloc;
+	baseAllocator->reallocFunc = (dsAllocatorReallocFunction)&dsTLSFAllocator_realloc;
+	baseAllocator->freeFunc = (dsAllocatorFreeFunction)&dsTLSFAllocator_free;
+
+	allocator->buffer = buffer;
+	allocator->bufferSize = bufferSize;
+	initializeBlocks(allocator);
+	return true;
+}
+
+void* dsTLSFAllocator_alloc(dsTLSFAllocator* allocator, size_t size, unsigned int alignment)
+{
+	if (!allocator || !allocator->buffer || !size || alignment == 0 ||
+		(alignment & (alignment - 1)) != 0)
+	{
+		errno = EINVAL;
+		return NULL;
+	}
+
+	if (size > DS_TLSF_MAX_SIZE)
+	{
+		errno = ENOMEM;
+		return NULL;
+	}
+
+	size = adjustSize(size);
+	DS_VERIFY(dsSpinlock_lock(&allocator->lock));
+	void* ptr = allocImpl(allocator, size, alignment);
+	DS_VERIFY(dsSpinlock_unlock(&allocator->lock));
+	return ptr;
+}
+
+void* dsTLSFAllocator_realloc(dsTLSFAllocator* allocator, void* ptr, size_t size,
+	unsigned int alignment)
+{
+	if (!allocator || !allocator->buffer || alignment == 0 || (alignment & (alignment - 1)) != 0)
+	{
+		errno = EINVAL;
+		return NULL;
+	}
+
+	if (!ptr)
+		return size ? dsTLSFAllocator_alloc(allocator, size, alignment) : NULL;
+
+	if (!size)
+	{
+		dsTLSFAllocator_free(allocator, ptr);
+		return NULL;
+	}
+
+	if (size > DS_TLSF_MAX_SIZE)
+	{
+		errno = ENOMEM;
+		return NULL;
+	}
+
+	size = adjustSize(size);
+	dsAllocator* baseAllocator = (dsAllocator*)allocator;
+	DS_VERIFY(dsSpinlock_lock(&allocator->lock));
+	if (!isAllocatedBlock(allocator, ptr))
+	{
+		DS_VERIFY(dsSpinlock_unlock(&allocator->lock));
+		errno = EINVAL;
+		return NULL;
+	}
+
+	// Resize in place if the alignment is compatible.
+	BlockHeader* block = BLOCK_FROM_DATA(ptr);
+	size_t origSize = BLOCK_SIZE(block);
+	if ((uintptr_t)ptr % alignment == 0)
+	{
+		if (origSize < size)
+		{
+			// Try to grow into the following block.
+			BlockHeader* next = NEXT_BLOCK(block);
+			size_t combinedSize = origSize + DS_TLSF_BLOCK_HEADER_SIZE + BLOCK_SIZE(next);
+			if (BLOCK_IS_FREE(next) && combinedSize >= size)
+			{
+				removeFreeBlock(allocator, next);
+				block->size = combinedSize;
+				NEXT_BLOCK(block)->prevSize = combinedSize;
+			}
+		}
+
+		if (BLOCK_SIZE(block) >= size)
+		{
+			trimBlock(allocator, block, size);
+			baseAllocator->size += BLOCK_SIZE(block);
+			baseAllocator->size -= origSize;
+			DS_VERIFY(dsSpinlock_unlock(&allocator->lock));
+			return ptr;
+		}
+	}
+
+	void* newPtr = allocImpl(allocator, size, alignment);
+	if (newPtr)
+	{
+		memcpy(newPtr, ptr, origSize < size ? origSize : size);
+		freeImpl(allocator, block);
+	}
+	DS_VERIFY(dsSpinlock_unlock(&allocator->lock));
+	return newPtr;
+}
+
+bool dsTLSFAllocator_free(dsTLSFAllocator* allocator, void* ptr)
+{
+	if (!allocator || !allocator->buffer)
+	{
+		errno = EINVAL;
+		return false;
+	}
+
+	if (!ptr)
+		return true;
+
+	DS_VERIFY(dsSpinlock_lock(&allocator->lock));
+	if (!isAllocatedBlock(allocator, ptr))
+	{
+		DS_VERIFY(dsSpinlock_unlock(&allocator->lock));
+		errno = EINVAL;
+		return false;
+	}
+
+	freeImpl(allocator, BLOCK_FROM_DATA(ptr));
+	DS_VERIFY(dsSpinlock_unlock(&allocator->lock));
+	return true;
+}
+
+bool dsTLSFAllocator_getFreeStats(dsTLSFFreeStats* outStats, dsTLSFAllocator* allocator)
+{
+	if (!outStats || !allocator || !allocator->buffer)
+	{
+		errno = EINVAL;
+		return false;
+	}
+
+	DS_VERIFY(dsSpinlock_lock(&allocator->lock));
+	outStats->freeSize = allocator->freeSize;
+	outStats->freeBlockCount = allocator->freeBlockCount;
+	outStats->largestFreeBlock = 0;
+
+	uint32_t first, second;
+	if (dsTLSF_findLargestFreeList(&first, &second, allocator->firstLevelBitmap,
+			allocator->secondLevelBitmaps))
+	{
+		// Blocks within the same list may have different sizes.
+		for (BlockHeader* block = ((BlockHeader**)allocator->freeLists[first])[second]; block;
+			block = FREE_LINKS(block)->next)
+		{
+			size_t size = BLOCK_SIZE(block);
+			if (size > outStats->largestFreeBlock)
+				outStats->largestFreeBlock = size;
+		}
+	}
+	DS_VERIFY(dsSpinlock_unlock(&allocator->lock));
+
+	if (outStats->freeSize > 0)
+	{
+		outStats->fragmentation =
+			1.0f - (float)((double)outStats->largestFreeBlock/(double)outStats->freeSize);
+	}
+	else
+		outStats->fragmentation = 0.0f;
+	return true;
+}
+
+bool dsTLSFAllocator_reset(dsTLSFAllocator* allocator)
+{
+	if (!allocator || !allocator->buffer)
+	{
+		errno = EINVAL;
+		return false;
+	}
+
+	DS_VERIFY(dsSpinlock_lock(&allocator->lock));
+	dsAllocator* baseAllocator = (dsAllocator*)allocator;
+	baseAllocator->size = 0;
+	baseAllocator->totalAllocations = 0;
+	baseAllocator->currentAllocations = 0;
+	initializeBlocks(allocator);
+	DS_VERIFY(dsSpinlock_unlock(&allocator->lock));
+	return true;
+}
+
+bool dsTLSFAllocator_validate(dsTLSFAllocator* allocator)
+{
+	if (!allocator || !allocator->buffer)
+		return false;
+
+	DS_VERIFY(dsSpinlock_lock(&allocator->lock));
+	bool valid = true;
+	size_t usedSize = 0, freeSize = 0;
+	uint32_t usedCount = 0, freeCount = 0;
+
+	// Walk the blocks in the buffer.
+	uint8_t* end = (uint8_t*)allocator->buffer +
+		(allocator->bufferSize & ~(size_t)(DS_TLSF_GRANULARITY - 1));
+	BlockHeader* block = (BlockHeader*)allocator->buffer;
+	size_t prevSize = 0;
+	bool prevFree = false;
+	while (true)
+	{
+		if ((uint8_t*)block + DS_TLSF_BLOCK_HEADER_SIZE > end || block->prevSize != prevSize)
+		{
+			valid = false;
+			break;
+		}
+
+		size_t size = BLOCK_SIZE(block);
+		if (size == 0)
+		{
+			// Sentinel
+			valid = (uint8_t*)block + DS_TLSF_BLOCK_HEADER_SIZE == end && !BLOCK_IS_FREE(block);
+			break;
+		}
+
+		if (size % DS_TLSF_GRANULARITY != 0 || size > (size_t)(end - BLOCK_DATA(block)))
+		{
+			valid = false;
+			break;
+		}
+
+		if (BLOCK_IS_FREE(block))
+		{
+			if (prevFree)
+			{
+				valid = false;
+				break;
+			}
+
+			freeSize += size;
+			++freeCount;
+			prevFree = true;
+		}
+		else
+		{
+			usedSize += DS_TLSF_BLOCK_HEADER_SIZE + size;
+			++usedCount;
+			prevFree = false;
+		}
+
+		prevSize = size;
+		block = NEXT_BLOCK(block);
+	}
+
+	valid = valid && freeSize == allocator->freeSize && freeCount == allocator->freeBlockCount &&
+		usedSize == ((dsAllocator*)allocator)->size &&
+		usedCount == ((dsAllocator*)allocator)->currentAllocations;
+
+	// Check the free lists.
+	uint32_t listCount = 0;
+	for (uint32_t first = 0; valid && first < DS_TLSF_FIRST_LEVEL_COUNT; ++first)
+	{
+		bool hasFirst = (allocator->firstLevelBitmap & (1U << first)) != 0;
+		if (hasFirst != (allocator->secondLevelBitmaps[first] != 0))
+		{
+			valid = false;
+			break;
+		}
+
+		for (uint32_t second = 0; second < DS_TLSF_SECOND_LEVEL_COUNT; ++second)
+		{
+			BlockHeader* head = ((BlockHeader**)allocator->freeLists[first])[second];
+			bool hasSecond = (allocator->secondLevelBitmaps[first] & (1U << second)) != 0;
+			if (hasSecond != (head != NULL))
+			{
+				valid = false;
+				break;
+			}
+
+			BlockHeader* prev = NULL;
+			for (BlockHeader* curBlock = head; curBlock; curBlock = FREE_LINKS(curBlock)->next)
+			{
+				uint32_t blockFirst, blockSecond;
+				if ((uint8_t*)curBlock < (uint8_t*)allocator->buffer || (uint8_t*)curBlock >= end ||
+					!BLOCK_IS_FREE(curBlock) || FREE_LINKS(curBlock)->prev != prev ||
+					++listCount > freeCount)
+				{
+					valid = false;
+					break;
+				}
+
+				dsTLSF_mapping(&blockFirst, &blockSecond, BLOCK_SIZE(curBlock));
+				if (blockFirst != first || blockSecond != second)
+				{
+					valid = false;
+					break;
+				}
+				prev = curBlock;
+			}
+
+			if (!valid)
+				break;
+		}
+	}
+
+	valid = valid && listCount == freeCount;
+	DS_VERIFY(dsSpinlock_unlock(&allocator->lock));
+	return valid;
+}
+
+void dsTLSFAllocator_shutdown(dsTLSFAllocator* allocator)
+{
+	if (!allocator)
+		return;
+
+	dsSpinlock_shutdown(&allocator->lock);
+	memset(allocator, 0, sizeof(dsTLSFAllocator));
+}
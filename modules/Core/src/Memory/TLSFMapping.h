@@ -0,0 +1,119 @@
+/*
+ * Copyright 2020 Aaron Barany
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <DeepSea/Core/Config.h>
+#include <DeepSea/Core/Memory/Types.h>
+#include <DeepSea/Core/Assert.h>
+#include <DeepSea/Core/Bits.h>
+
+// Mapping from sizes to the two levels of free lists shared between the TLSF allocators.
+// Sizes below DS_TLSF_SMALL_SIZE are spaced linearly by DS_TLSF_GRANULARITY in the first level,
+// while larger sizes have a level for each power of two subdivided into
+// DS_TLSF_SECOND_LEVEL_COUNT ranges.
+
+#define DS_TLSF_GRANULARITY_LOG2 4
+#define DS_TLSF_GRANULARITY (1U << DS_TLSF_GRANULARITY_LOG2)
+#define DS_TLSF_SECOND_LEVEL_LOG2 4
+#define DS_TLSF_FIRST_LEVEL_SHIFT (DS_TLSF_SECOND_LEVEL_LOG2 + DS_TLSF_GRANULARITY_LOG2)
+#define DS_TLSF_SMALL_SIZE ((size_t)1 << DS_TLSF_FIRST_LEVEL_SHIFT)
+
+_Static_assert(DS_TLSF_SECOND_LEVEL_COUNT == 1 << DS_TLSF_SECOND_LEVEL_LOG2,
+	"Unexpected TLSF second level count.");
+
+inline static uint32_t dsTLSF_highestBit(size_t x)
+{
+	DS_ASSERT(x != 0);
+#if DS_64BIT
+	uint32_t high = (uint32_t)(x >> 32);
+	if (high)
+		return 63 - dsClz(high);
+#endif
+	return 31 - dsClz((uint32_t)x);
+}
+
+inline static void dsTLSF_mapping(uint32_t* outFirst, uint32_t* outSecond, size_t size)
+{
+	DS_ASSERT(size <= DS_TLSF_MAX_SIZE);
+	if (size < DS_TLSF_SMALL_SIZE)
+	{
+		*outFirst = 0;
+		*outSecond = (uint32_t)(size >> DS_TLSF_GRANULARITY_LOG2);
+	}
+	else
+	{
+		uint32_t highestBit = dsTLSF_highestBit(size);
+		*outSecond = (uint32_t)(size >> (highestBit - DS_TLSF_SECOND_LEVEL_LOG2)) ^
+			(1U << DS_TLSF_SECOND_LEVEL_LOG2);
+		*outFirst = highestBit - (DS_TLSF_FIRST_LEVEL_SHIFT - 1);
+	}
+}
+
+// Rounds up the size so any block in the mapped free list is large enough. Small sizes don't need
+// to be rounded since each list only contains a single size, assuming sizes are multiples of
+// DS_TLSF_GRANULARITY.
+inline static bool dsTLSF_searchMapping(uint32_t* outFirst, uint32_t* outSecond, size_t size)
+{
+	if (size > DS_TLSF_MAX_SIZE)
+		return false;
+
+	if (size >= DS_TLSF_SMALL_SIZE)
+	{
+		size_t round = ((size_t)1 << (dsTLSF_highestBit(size) - DS_TLSF_SECOND_LEVEL_LOG2)) - 1;
+		if (size > DS_TLSF_MAX_SIZE - round)
+			return false;
+		size += round;
+	}
+
+	dsTLSF_mapping(outFirst, outSecond, size);
+	return true;
+}
+
+// Finds the first non-empty free list at least as large as the mapped list.
+inline static bool dsTLSF_findFreeList(uint32_t* first, uint32_t* second, uint32_t firstBitmap,
+	const uint32_t* secondBitmaps)
+{
+	uint32_t secondBitmap = secondBitmaps[*first] & (~0U << *second);
+	if (!secondBitmap)
+	{
+		if (*first + 1 >= DS_TLSF_FIRST_LEVEL_COUNT)
+			return false;
+
+		uint32_t firstMask = firstBitmap & (~0U << (*first + 1));
+		if (!firstMask)
+			return false;
+
+		*first = dsCtz(firstMask);
+		secondBitmap = secondBitmaps[*first];
+		DS_ASSERT(secondBitmap);
+	}
+
+	*second = dsCtz(secondBitmap);
+	return true;
+}
+
+// Finds the non-empty free list with the largest sizes.
+inline static bool dsTLSF_findLargestFreeList(uint32_t* outFirst, uint32_t* outSecond,
+	uint32_t firstBitmap, const uint32_t* secondBitmaps)
+{
+	if (!firstBitmap)
+		return false;
+
+	*outFirst = 31 - dsClz(firstBitmap);
+	*outSecond = 31 - dsClz(secondBitmaps[*outFirst]);
+	return true;
+}
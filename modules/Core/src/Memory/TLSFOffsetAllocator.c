@@ -0,0 +1,530 @@
+/*
+ * Copyright 2020 Aaron Barany
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <DeepSea/Core/Memory/TLSFOffsetAllocator.h>
+
+#include "TLSFMapping.h"
+#include <DeepSea/Core/Memory/Allocator.h>
+#include <DeepSea/Core/Memory/BufferAllocator.h>
+#include <DeepSea/Core/Memory/Memory.h>
+#include <DeepSea/Core/Assert.h>
+#include <DeepSea/Core/Error.h>
+#include <DeepSea/Core/Log.h>
+#include <string.h>
+
+#define NO_NODE DS_INVALID_TLSF_HANDLE
+
+typedef enum NodeState
+{
+	NodeState_Unused,
+	NodeState_Free,
+	NodeState_Used
+} NodeState;
+
+// Nodes for the blocks are stored separately from the memory being managed. Unused nodes are
+// linked through nextFree.
+typedef struct Node
+{
+	size_t offset;
+	size_t size;
+	uint32_t prevPhys;
+	uint32_t nextPhys;
+	uint32_t prevFree;
+	uint32_t nextFree;
+	NodeState state;
+} Node;
+
+struct dsTLSFOffsetAllocator
+{
+	dsAllocator* allocator;
+	size_t size;
+	size_t freeSize;
+	uint32_t freeBlockCount;
+	uint32_t allocationCount;
+	uint32_t maxAllocations;
+	uint32_t nodeCount;
+	uint32_t unusedNodes;
+
+	uint32_t firstLevelBitmap;
+	uint32_t secondLevelBitmaps[DS_TLSF_FIRST_LEVEL_COUNT];
+	uint32_t freeLists[DS_TLSF_FIRST_LEVEL_COUNT][DS_TLSF_SECOND_LEVEL_COUNT];
+
+	Node* nodes;
+};
+
+static uint32_t newNode(dsTLSFOffsetAllocator* allocator)
+{
+	uint32_t index = allocator->unusedNodes;
+	DS_ASSERT(index != NO_NODE);
+	allocator->unusedNodes = allocator->nodes[index].nextFree;
+	return index;
+}
+
+static void deleteNode(dsTLSFOffsetAllocator* allocator, uint32_t index)
+{
+	Node* node = allocator->nodes + index;
+	node->state = NodeState_Unused;
+	node->nextFree = allocator->unusedNodes;
+	allocator->unusedNodes = index;
+}
+
+static void insertFreeNode(dsTLSFOffsetAllocator* allocator, uint32_t index)
+{
+	Node* node = allocator->nodes + index;
+	uint32_t first, second;
+	dsTLSF_mapping(&first, &second, node->size);
+
+	uint32_t* head = allocator->freeLists[first] + second;
+	node->state = NodeState_Free;
+	node->prevFree = NO_NODE;
+	node->nextFree = *head;
+	if (*head != NO_NODE)
+		allocator->nodes[*head].prevFree = index;
+	*head = index;
+
+	allocator->firstLevelBitmap |= 1U << first;
+	allocator->secondLevelBitmaps[first] |= 1U << second;
+	allocator->freeSize += node->size;
+	++allocator->freeBlockCount;
+}
+
+static void removeFreeNode(dsTLSFOffsetAllocator* allocator, uint32_t index)
+{
+	Node* node = allocator->nodes + index;
+	DS_ASSERT(node->state == NodeState_Free);
+	uint32_t first, second;
+	dsTLSF_mapping(&first, &second, node->size);
+
+	if (node->nextFree != NO_NODE)
+		allocator->nodes[node->nextFree].prevFree = node->prevFree;
+	if (node->prevFree != NO_NODE)
+		allocator->nodes[node->prevFree].nextFree = node->nextFree;
+	else
+	{
+		uint32_t* head = allocator->freeLists[first] + second;
+		DS_ASSERT(*head == index);
+		*head = node->nextFree;
+		if (*head == NO_NODE)
+		{
+			allocator->secondLevelBitmaps[first] &= ~(1U << second);
+			if (!allocator->secondLevelBitmaps[first])
+				allocator->firstLevelBitmap &= ~(1U << first);
+		}
+	}
+
+	DS_ASSERT(allocator->freeSize >= node->size && allocator->freeBlockCount > 0);
+	allocator->freeSize -= node->size;
+	--allocator->freeBlockCount;
+	node->state = NodeState_Used;
+}
+
+// Creates a new node after the node for the index, taking the space at the end of the node.
+static uint32_t splitNode(dsTLSFOffsetAllocator* allocator, uint32_t index, size_t size)
+{
+	uint32_t splitIndex = newNode(allocator);
+	Node* node = allocator->nodes + index;
+	Node* splitNode = allocator->nodes + splitIndex;
+	DS_ASSERT(node->size > size);
+
+	splitNode->offset = node->offset + size;
+	splitNode->size = node->size - size;
+	splitNode->prevPhys = index;
+	splitNode->nextPhys = node->nextPhys;
+	if (node->nextPhys != NO_NODE)
+		allocator->nodes[node->nextPhys].prevPhys = splitIndex;
+	node->nextPhys = splitIndex;
+	node->size = size;
+	return splitIndex;
+}
+
+// Merges the node after the index into the node for the index.
+static void mergeNext(dsTLSFOffsetAllocator* allocator, uint32_t index)
+{
+	Node* node = allocator->nodes + index;
+	uint32_t nextIndex = node->nextPhys;
+	Node* next = allocator->nodes + nextIndex;
+	node->size += next->size;
+	node->nextPhys = next->nextPhys;
+	if (next->nextPhys != NO_NODE)
+		allocator->nodes[next->nextPhys].prevPhys = index;
+	deleteNode(allocator, nextIndex);
+}
+
+// Splits the end of a used node into a free node, merging with any following free node.
+static void trimNode(dsTLSFOffsetAllocator* allocator, uint32_t index, size_t size)
+{
+	Node* node = allocator->nodes + index;
+	DS_ASSERT(node->state == NodeState_Used && node->size >= size);
+	if (node->size == size)
+		return;
+
+	uint32_t nextIndex = node->nextPhys;
+	if (nextIndex != NO_NODE && allocator->nodes[nextIndex].state == NodeState_Free)
+	{
+		// Give the space to the following free node rather than creating a new one.
+		removeFreeNode(allocator, nextIndex);
+		Node* next = allocator->nodes + nextIndex;
+		size_t difference = node->size - size;
+		next->offset -= difference;
+		next->size += difference;
+		node->size = size;
+		insertFreeNode(allocator, nextIndex);
+		return;
+	}
+
+	insertFreeNode(allocator, splitNode(allocator, index, size));
+}
+
+static void initializeNodes(dsTLSFOffsetAllocator* allocator)
+{
+	allocator->freeSize = 0;
+	allocator->freeBlockCount = 0;
+	allocator->allocationCount = 0;
+	allocator->firstLevelBitmap = 0;
+	memset(allocator->secondLevelBitmaps, 0, sizeof(allocator->secondLevelBitmaps));
+	memset(allocator->freeLists, 0xFF, sizeof(allocator->freeLists));
+
+	for (uint32_t i = 0; i < allocator->nodeCount; ++i)
+	{
+		allocator->nodes[i].state = NodeState_Unused;
+		allocator->nodes[i].nextFree = i + 1 < allocator->nodeCount ? i + 1 : NO_NODE;
+	}
+	allocator->unusedNodes = 0;
+
+	uint32_t index = newNode(allocator);
+	Node* node = allocator->nodes + index;
+	node->offset = 0;
+	node->size = allocator->size;
+	node->prevPhys = NO_NODE;
+	node->nextPhys = NO_NODE;
+	insertFreeNode(allocator, index);
+}
+
+static bool isAllocated(const dsTLSFOffsetAllocator* allocator, uint32_t handle)
+{
+	return handle < allocator->nodeCount && allocator->nodes[handle].state == NodeState_Used;
+}
+
+dsTLSFOffsetAllocator* dsTLSFOffsetAllocator_create(dsAllocator* allocator, size_t size,
+	uint32_t maxAllocations)
+{
+	size &= ~(size_t)(DS_TLSF_GRANULARITY - 1);
+	if (!allocator || !size || size > DS_TLSF_MAX_SIZE || maxAllocations == 0 ||
+		maxAllocations > (DS_INVALID_TLSF_HANDLE - 1)/2)
+	{
+		errno = EINVAL;
+		return NULL;
+	}
+
+	// With all free blocks merged, there can be at most one more free block than used blocks.
+	uint32_t nodeCount = maxAllocations*2 + 1;
+	size_t fullSize = DS_ALIGNED_SIZE(sizeof(dsTLSFOffsetAllocator)) +
+		DS_ALIGNED_SIZE(sizeof(Node)*nodeCount);
+	void* buffer = dsAllocator_alloc(allocator, fullSize);
+	if (!buffer)
+		return NULL;
+
+	dsBufferAllocator bufferAlloc;
+	DS_VERIFY(dsBufferAllocator_initialize(&bufferAlloc, buffer, fullSize));
+
+	dsTLSFOffsetAllocator* offsetAllocator =
+		DS_ALLOCATE_OBJECT(&bufferAlloc, dsTLSFOffsetAllocator);
+	DS_ASSERT(offsetAllocator);
+	offsetAllocator->allocator = dsAllocator_keepPointer(allocator);
+	offsetAllocator->size = size;
+	offsetAllocator->maxAllocations = maxAllocations;
+	offsetAllocator->nodeCount = nodeCount;
+	offsetAllocator->nodes = DS_ALLOCATE_OBJECT_ARRAY(&bufferAlloc, Node, nodeCount);
+	DS_ASSERT(offsetAllocator->nodes);
+
+	initializeNodes(offsetAllocator);
+	return offsetAllocator;
+}
+
+uint32_t dsTLSFOffsetAllocator_alloc(size_t* outOffset, dsTLSFOffsetAllocator* allocator,
+	size_t size, size_t alignment)
+{
+	if (!outOffset || !allocator || !size || alignment == 0 || (alignment & (alignment - 1)) != 0)
+	{
+		errno = EINVAL;
+		return DS_INVALID_TLSF_HANDLE;
+	}
+
+	if (allocator->allocationCount >= allocator->maxAllocations || size > DS_TLSF_MAX_SIZE)
+	{
+		errno = ENOMEM;
+		return DS_INVALID_TLSF_HANDLE;
+	}
+
+	size = DS_CUSTOM_ALIGNED_SIZE(size, DS_TLSF_GRANULARITY);
+	size_t searchSize = size;
+	if (alignment > DS_TLSF_GRANULARITY)
+		searchSize += alignment - DS_TLSF_GRANULARITY;
+
+	uint32_t first, second;
+	if (searchSize < size || !dsTLSF_searchMapping(&first, &second, searchSize) ||
+		!dsTLSF_findFreeList(&first, &second, allocator->firstLevelBitmap,
+			allocator->secondLevelBitmaps))
+	{
+		errno = ENOMEM;
+		return DS_INVALID_TLSF_HANDLE;
+	}
+
+	uint32_t index = allocator->freeLists[first][second];
+	DS_ASSERT(index != NO_NODE && allocator->nodes[index].size >= searchSize);
+	removeFreeNode(allocator, index);
+
+	// The space before the aligned offset remains free. The previous node is never free since free
+	// nodes are always merged.
+	Node* node = allocator->nodes + index;
+	size_t alignedOffset = (node->offset + alignment - 1) & ~(alignment - 1);
+	if (alignedOffset != node->offset)
+	{
+		uint32_t alignedIndex = splitNode(allocator, index, alignedOffset - node->offset);
+		allocator->nodes[alignedIndex].state = NodeState_Used;
+		insertFreeNode(allocator, index);
+		index = alignedIndex;
+		node = allocator->nodes + index;
+	}
+
+	trimNode(allocator, index, size);
+	++allocator->allocationCount;
+	*outOffset = node->offset;
+	return index;
+}
+
+bool dsTLSFOffsetAllocator_resize(dsTLSFOffsetAllocator* allocator, uint32_t handle, size_t size)
+{
+	if (!allocator || !isAllocated(allocator, handle) || !size)
+	{
+		errno = EINVAL;
+		return false;
+	}
+
+	if (size > DS_TLSF_MAX_SIZE)
+	{
+		errno = ENOMEM;
+		return false;
+	}
+
+	size = DS_CUSTOM_ALIGNED_SIZE(size, DS_TLSF_GRANULARITY);
+	Node* node = allocator->nodes + handle;
+	if (size > node->size)
+	{
+		uint32_t nextIndex = node->nextPhys;
+		if (nextIndex == NO_NODE || allocator->nodes[nextIndex].state != NodeState_Free ||
+			node->size + allocator->nodes[nextIndex].size < size)
+		{
+			errno = ENOMEM;
+			return false;
+		}
+
+		removeFreeNode(allocator, nextIndex);
+		mergeNext(allocator, handle);
+	}
+
+	trimNode(allocator, handle, size);
+	return true;
+}
+
+bool dsTLSFOffsetAllocator_free(dsTLSFOffsetAllocator* allocator, uint32_t handle)
+{
+	if (!allocator || !isAllocated(allocator, handle))
+	{
+		errno = EINVAL;
+		return false;
+	}
+
+	uint32_t index = handle;
+	Node* node = allocator->nodes + index;
+	if (node->nextPhys != NO_NODE && allocator->nodes[node->nextPhys].state == NodeState_Free)
+	{
+		removeFreeNode(allocator, node->nextPhys);
+		mergeNext(allocator, index);
+	}
+
+	if (node->prevPhys != NO_NODE && allocator->nodes[node->prevPhys].state == NodeState_Free)
+	{
+		index = node->prevPhys;
+		removeFreeNode(allocator, index);
+		mergeNext(allocator, index);
+	}
+
+	insertFreeNode(allocator, index);
+	DS_ASSERT(allocator->allocationCount > 0);
+	--allocator->allocationCount;
+	return true;
+}
+
+size_t dsTLSFOffsetAllocator_getOffset(const dsTLSFOffsetAllocator* allocator, uint32_t handle)
+{
+	if (!allocator || !isAllocated(allocator, handle))
+		return 0;
+
+	return allocator->nodes[handle].offset;
+}
+
+size_t dsTLSFOffsetAllocator_getSize(const dsTLSFOffsetAllocator* allocator, uint32_t handle)
+{
+	if (!allocator || !isAllocated(allocator, handle))
+		return 0;
+
+	return allocator->nodes[handle].size;
+}
+
+bool dsTLSFOffsetAllocator_getFreeStats(dsTLSFFreeStats* outStats,
+	const dsTLSFOffsetAllocator* allocator)
+{
+	if (!outStats || !allocator)
+	{
+		errno = EINVAL;
+		return false;
+	}
+
+	outStats->freeSize = allocator->freeSize;
+	outStats->freeBlockCount = allocator->freeBlockCount;
+	outStats->largestFreeBlock = 0;
+
+	uint32_t first, second;
+	if (dsTLSF_findLargestFreeList(&first, &second, allocator->firstLevelBitmap,
+			allocator->secondLevelBitmaps))
+	{
+		for (uint32_t index = allocator->freeLists[first][second]; index != NO_NODE;
+			index = allocator->nodes[index].nextFree)
+		{
+			size_t size = allocator->nodes[index].size;
+			if (size > outStats->largestFreeBlock)
+				outStats->largestFreeBlock = size;
+		}
+	}
+
+	if (outStats->freeSize > 0)
+	{
+		outStats->fragmentation =
+			1.0f - (float)((double)outStats->largestFreeBlock/(double)outStats->freeSize);
+	}
+	else
+		outStats->fragmentation = 0.0f;
+	return true;
+}
+
+void dsTLSFOffsetAllocator_reset(dsTLSFOffsetAllocator* allocator)
+{
+	if (allocator)
+		initializeNodes(allocator);
+}
+
+bool dsTLSFOffsetAllocator_validate(const dsTLSFOffsetAllocator* allocator)
+{
+	if (!allocator)
+		return false;
+
+	// Find the first node, then walk the nodes in order.
+	uint32_t index = NO_NODE;
+	for (uint32_t i = 0; i < allocator->nodeCount; ++i)
+	{
+		const Node* node = allocator->nodes + i;
+		if (node->state != NodeState_Unused && node->offset == 0)
+		{
+			index = i;
+			break;
+		}
+	}
+
+	if (index == NO_NODE || allocator->nodes[index].prevPhys != NO_NODE)
+		return false;
+
+	size_t offset = 0, freeSize = 0;
+	uint32_t usedCount = 0, freeCount = 0, nodeCount = 0;
+	uint32_t prevIndex = NO_NODE;
+	bool prevFree = false;
+	while (index != NO_NODE)
+	{
+		const Node* node = allocator->nodes + index;
+		if (++nodeCount > allocator->nodeCount || node->state == NodeState_Unused ||
+			node->prevPhys != prevIndex || node->offset != offset || node->size == 0 ||
+			node->size % DS_TLSF_GRANULARITY != 0)
+		{
+			return false;
+		}
+
+		if (node->state == NodeState_Free)
+		{
+			if (prevFree)
+				return false;
+
+			uint32_t first, second;
+			dsTLSF_mapping(&first, &second, node->size);
+			if (!(allocator->secondLevelBitmaps[first] & (1U << second)))
+				return false;
+
+			freeSize += node->size;
+			++freeCount;
+			prevFree = true;
+		}
+		else
+		{
+			++usedCount;
+			prevFree = false;
+		}
+
+		offset += node->size;
+		prevIndex = index;
+		index = node->nextPhys;
+	}
+
+	if (offset != allocator->size || freeSize != allocator->freeSize ||
+		freeCount != allocator->freeBlockCount || usedCount != allocator->allocationCount)
+	{
+		return false;
+	}
+
+	// Check the free lists.
+	uint32_t listCount = 0;
+	for (uint32_t first = 0; first < DS_TLSF_FIRST_LEVEL_COUNT; ++first)
+	{
+		for (uint32_t second = 0; second < DS_TLSF_SECOND_LEVEL_COUNT; ++second)
+		{
+			uint32_t prevFreeIndex = NO_NODE;
+			for (uint32_t freeIndex = allocator->freeLists[first][second]; freeIndex != NO_NODE;
+				freeIndex = allocator->nodes[freeIndex].nextFree)
+			{
+				if (freeIndex >= allocator->nodeCount || ++listCount > freeCount)
+					return false;
+
+				const Node* node = allocator->nodes + freeIndex;
+				uint32_t nodeFirst, nodeSecond;
+				dsTLSF_mapping(&nodeFirst, &nodeSecond, node->size);
+				if (node->state != NodeState_Free || node->prevFree != prevFreeIndex ||
+					nodeFirst != first || nodeSecond != second)
+				{
+					return false;
+				}
+				prevFreeIndex = freeIndex;
+			}
+		}
+	}
+
+	return listCount == freeCount;
+}
+
+void dsTLSFOffsetAllocator_destroy(dsTLSFOffsetAllocator* allocator)
+{
+	if (!allocator || !allocator->allocator)
+		return;
+
+	DS_VERIFY(dsAllocator_free(allocator->allocator, allocator));
+}
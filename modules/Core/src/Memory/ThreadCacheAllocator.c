@@ -0,0 +1,568 @@
+/*
+ * Copyright 2020 Aaron Barany
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <DeepSea/Core/Memory/ThreadCacheAllocator.h>
+#include <DeepSea/Core/Memory/Memory.h>
+#include <DeepSea/Core/Memory/SystemAllocator.h>
+#include <DeepSea/Core/Thread/Spinlock.h>
+#include <DeepSea/Core/Thread/ThreadStorage.h>
+#include <DeepSea/Core/Assert.h>
+#include <DeepSea/Core/Bits.h>
+#include <DeepSea/Core/Error.h>
+#include <string.h>
+
+// Each block has a header before the returned pointer. This keeps the returned pointer aligned.
+#define HEADER_SIZE DS_ALLOC_ALIGNMENT
+#define MAX_BLOCK_SIZE (DS_THREAD_CACHE_MAX_SIZE + HEADER_SIZE)
+
+// Size classes are spaced by 16 bytes up to 128 bytes, then 4 classes for each power of two up to
+// MAX_BLOCK_SIZE. This keeps the wasted space for each allocation below 25%.
+#define LINEAR_CLASS_COUNT 8
+#define LINEAR_CLASS_MAX 128
+#define CLASS_COUNT 40
+#define LARGE_CLASS 0xFFFFFFFF
+
+#define SPAN_SIZE 65536
+#define MIN_SPAN_BLOCKS 4
+#define BATCH_SIZE 16384
+#define MIN_BATCH_COUNT 2
+#define MAX_BATCH_COUNT 64
+#define CACHE_LINE_SIZE 64
+
+typedef struct BlockHeader
+{
+	uint32_t sizeClass;
+	// Offset from the start of the system allocation and allocation size for large allocations.
+	uint32_t offset;
+	uint64_t size;
+} BlockHeader;
+
+_Static_assert(sizeof(BlockHeader) == HEADER_SIZE, "Unexpected BlockHeader size.");
+
+typedef struct FreeBlock
+{
+	struct FreeBlock* next;
+} FreeBlock;
+
+typedef struct CentralListData
+{
+	dsSpinlock lock;
+	FreeBlock* freeList;
+	// Spans are linked by the first pointer in each span.
+	void* spans;
+} CentralListData;
+
+// Pad to a cache line to avoid contention between size classes.
+struct dsThreadCacheCentralList
+{
+	CentralListData data;
+	uint8_t padding[CACHE_LINE_SIZE - sizeof(CentralListData)];
+};
+
+struct dsThreadCache
+{
+	dsThreadCache* next;
+	bool active;
+
+	// Statistics for allocations on this thread. These may wrap around when freeing memory that was
+	// allocated on other threads, but will be correct when combined.
+	size_t size;
+	uint32_t totalAllocations;
+	uint32_t currentAllocations;
+
+	FreeBlock* freeLists[CLASS_COUNT];
+	uint32_t freeCounts[CLASS_COUNT];
+};
+
+#define THREAD_CACHE_SIZE \
+	((sizeof(dsThreadCache) + CACHE_LINE_SIZE - 1)/CACHE_LINE_SIZE*CACHE_LINE_SIZE)
+
+static uint32_t getSizeClass(size_t blockSize)
+{
+	DS_ASSERT(blockSize > HEADER_SIZE && blockSize <= MAX_BLOCK_SIZE);
+	if (blockSize <= LINEAR_CLASS_MAX)
+		return (uint32_t)((blockSize + 15)/16) - 1;
+
+	uint32_t value = (uint32_t)(blockSize - 1);
+	uint32_t shift = 31 - dsClz(value);
+	return LINEAR_CLASS_COUNT + (shift - 7)*4 + (value >> (shift - 2)) - 4;
+}
+
+static size_t getClassSize(uint32_t sizeClass)
+{
+	DS_ASSERT(sizeClass < CLASS_COUNT);
+	if (sizeClass < LINEAR_CLASS_COUNT)
+		return (sizeClass + 1)*16;
+
+	uint32_t group = (sizeClass - LINEAR_CLASS_COUNT)/4;
+	uint32_t subClass = (sizeClass - LINEAR_CLASS_COUNT) % 4;
+	return (size_t)(32U << group)*(5 + subClass);
+}
+
+static uint32_t getBatchCount(uint32_t sizeClass)
+{
+	size_t count = BATCH_SIZE/getClassSize(sizeClass);
+	if (count < MIN_BATCH_COUNT)
+		return MIN_BATCH_COUNT;
+	else if (count > MAX_BATCH_COUNT)
+		return MAX_BATCH_COUNT;
+	return (uint32_t)count;
+}
+
+static dsThreadCache* getThreadCache(dsThreadCacheAllocator* allocator)
+{
+	dsThreadCache* cache = (dsThreadCache*)dsThreadStorage_get(allocator->threadStorage);
+	if (cache)
+		return cache;
+
+	// Re-use the cache from a thread that has been flushed if possible.
+	DS_VERIFY(dsSpinlock_lock(&allocator->cacheLock));
+	for (cache = allocator->caches; cache && cache->active; cache = cache->next)
+		/* empty */;
+	if (cache)
+		cache->active = true;
+	DS_VERIFY(dsSpinlock_unlock(&allocator->cacheLock));
+
+	if (!cache)
+	{
+		cache = (dsThreadCache*)dsSystemAllocator_alloc(&allocator->systemAllocator,
+			THREAD_CACHE_SIZE, CACHE_LINE_SIZE);
+		if (!cache)
+			return NULL;
+
+		memset(cache, 0, sizeof(dsThreadCache));
+		cache->active = true;
+
+		DS_VERIFY(dsSpinlock_lock(&allocator->cacheLock));
+		cache->next = allocator->caches;
+		allocator->caches = cache;
+		DS_VERIFY(dsSpinlock_unlock(&allocator->cacheLock));
+	}
+
+	if (!dsThreadStorage_set(allocator->threadStorage, cache))
+	{
+		DS_VERIFY(dsSpinlock_lock(&allocator->cacheLock));
+		cache->active = false;
+		DS_VERIFY(dsSpinlock_unlock(&allocator->cacheLock));
+		return NULL;
+	}
+
+	return cache;
+}
+
+static FreeBlock* allocateSpan(dsThreadCacheAllocator* allocator, uint32_t sizeClass,
+	void** outSpan, FreeBlock** outLastBlock)
+{
+	size_t classSize = getClassSize(sizeClass);
+	size_t blockCount = (SPAN_SIZE - HEADER_SIZE)/classSize;
+	if (blockCount < MIN_SPAN_BLOCKS)
+		blockCount = MIN_SPAN_BLOCKS;
+
+	uint8_t* span = (uint8_t*)dsSystemAllocator_alloc(&allocator->systemAllocator,
+		HEADER_SIZE + blockCount*classSize, DS_ALLOC_ALIGNMENT);
+	if (!span)
+		return NULL;
+
+	uint8_t* blocks = span + HEADER_SIZE;
+	for (size_t i = 0; i < blockCount - 1; ++i)
+		((FreeBlock*)(blocks + i*classSize))->next = (FreeBlock*)(blocks + (i + 1)*classSize);
+
+	*outSpan = span;
+	*outLastBlock = (FreeBlock*)(blocks + (blockCount - 1)*classSize);
+	(*outLastBlock)->next = NULL;
+	return (FreeBlock*)blocks;
+}
+
+static bool refillCache(dsThreadCacheAllocator* allocator, dsThreadCache* cache,
+	uint32_t sizeClass)
+{
+	DS_ASSERT(!cache->freeLists[sizeClass]);
+	CentralListData* central = &allocator->centralLists[sizeClass].data;
+	DS_VERIFY(dsSpinlock_lock(&central->lock));
+	if (!central->freeList)
+	{
+		// Allocate the span outside of the lock, since it may be slow.
+		DS_VERIFY(dsSpinlock_unlock(&central->lock));
+
+		void* span;
+		FreeBlock* lastBlock;
+		FreeBlock* firstBlock = allocateSpan(allocator, sizeClass, &span, &lastBlock);
+		if (!firstBlock)
+			return false;
+
+		DS_VERIFY(dsSpinlock_lock(&central->lock));
+		*(void**)span = central->spans;
+		central->spans = span;
+		lastBlock->next = central->freeList;
+		central->freeList = firstBlock;
+	}
+
+	uint32_t batchCount = getBatchCount(sizeClass);
+	FreeBlock* first = central->freeList;
+	FreeBlock* last = first;
+	uint32_t count = 1;
+	for (; count < batchCount && last->next; ++count)
+		last = last->next;
+	central->freeList = last->next;
+	DS_VERIFY(dsSpinlock_unlock(&central->lock));
+
+	last->next = NULL;
+	cache->freeLists[sizeClass] = first;
+	cache->freeCounts[sizeClass] = count;
+	return true;
+}
+
+static void releaseBlocks(dsThreadCacheAllocator* allocator, dsThreadCache* cache,
+	uint32_t sizeClass, uint32_t count)
+{
+	DS_ASSERT(count > 0 && count <= cache->freeCounts[sizeClass]);
+	FreeBlock* first = cache->freeLists[sizeClass];
+	FreeBlock* last = first;
+	for (uint32_t i = 1; i < count; ++i)
+		last = last->next;
+	cache->freeLists[sizeClass] = last->next;
+	cache->freeCounts[sizeClass] -= count;
+
+	CentralListData* central = &allocator->centralLists[sizeClass].data;
+	DS_VERIFY(dsSpinlock_lock(&central->lock));
+	last->next = central->freeList;
+	central->freeList = first;
+	DS_VERIFY(dsSpinlock_unlock(&central->lock));
+}
+
+static void* allocateLarge(dsThreadCacheAllocator* allocator, dsThreadCache* cache, size_t size,
+	unsigned int alignment)
+{
+	// Pad by the alignment so the header can be placed before the returned pointer.
+	unsigned int padding = alignment > HEADER_SIZE ? alignment : HEADER_SIZE;
+	if (size > (size_t)-1 - padding)
+	{
+		errno = ENOMEM;
+		return NULL;
+	}
+
+	uint8_t* base = (uint8_t*)dsSystemAllocator_alloc(&allocator->systemAllocator, size + padding,
+		padding);
+	if (!base)
+		return NULL;
+
+	uint8_t* ptr = base + padding;
+	BlockHeader* header = (BlockHeader*)(ptr - HEADER_SIZE);
+	header->sizeClass = LARGE_CLASS;
+	header->offset = padding;
+	header->size = size;
+
+	cache->size += size;
+	++cache->totalAllocations;
+	++cache->currentAllocations;
+	return ptr;
+}
+
+bool dsThreadCacheAllocator_initialize(dsThreadCacheAllocator* allocator, size_t limit)
+{
+	if (!allocator)
+	{
+		errno = EINVAL;
+		return false;
+	}
+
+	// Set so shutdown can be called after failing to initialize.
+	allocator->centralLists = NULL;
+	if (!dsSystemAllocator_initialize(&allocator->systemAllocator, limit))
+		return false;
+
+	if (!dsSpinlock_initialize(&allocator->cacheLock))
+		return false;
+
+	if (!dsThreadStorage_initialize(&allocator->threadStorage))
+	{
+		dsSpinlock_shutdown(&allocator->cacheLock);
+		return false;
+	}
+
+	dsThreadCacheCentralList* centralLists = (dsThreadCacheCentralList*)dsSystemAllocator_alloc(
+		&allocator->systemAllocator, sizeof(dsThreadCacheCentralList)*CLASS_COUNT,
+		CACHE_LINE_SIZE);
+	if (!centralLists)
+	{
+		dsThreadStorage_shutdown(&allocator->threadStorage);
+		dsSpinlock_shutdown(&allocator->cacheLock);
+		return false;
+	}
+
+	for (uint32_t i = 0; i < CLASS_COUNT; ++i)
+	{
+		CentralListData* central = &centralLists[i].data;
+		if (!dsSpinlock_initialize(&central->lock))
+		{
+			for (uint32_t j = 0; j < i; ++j)
+				dsSpinlock_shutdown(&centralLists[j].data.lock);
+			DS_VERIFY(dsSystemAllocator_free(&allocator->systemAllocator, centralLists));
+			dsThreadStorage_shutdown(&allocator->threadStorage);
+			dsSpinlock_shutdown(&allocator->cacheLock);
+			return false;
+		}
+
+		central->freeList = NULL;
+		central->spans = NULL;
+	}
+
+	((dsAllocator*)allocator)->size = 0;
+	((dsAllocator*)allocator)->totalAllocations = 0;
+	((dsAllocator*)allocator)->currentAllocations = 0;
+	((dsAllocator*)allocator)->allocFunc = (dsAllocatorAllocFunction)&dsThreadCacheAllocator_alloc;
+	((dsAllocator*)allocator)->reallocFunc =
+		(dsAllocatorReallocFunction)&dsThreadCacheAllocator_realloc;
+	((dsAllocator*)allocator)->freeFunc = (dsAllocatorFreeFunction)&dsThreadCacheAllocator_free;
+	allocator->caches = NULL;
+	allocator->centralLists = centralLists;
+	return true;
+}
+
+void* dsThreadCacheAllocator_alloc(dsThreadCacheAllocator* allocator, size_t size,
+	unsigned int alignment)
+{
+	if (!allocator || !allocator->centralLists)
+	{
+		errno = EINVAL;
+		return NULL;
+	}
+
+	if (size == 0)
+		return NULL;
+
+	dsThreadCache* cache = getThreadCache(allocator);
+	if (!cache)
+		return NULL;
+
+	if (size > DS_THREAD_CACHE_MAX_SIZE || alignment > DS_ALLOC_ALIGNMENT)
+		return allocateLarge(allocator, cache, size, alignment);
+
+	uint32_t sizeClass = getSizeClass(size + HEADER_SIZE);
+	FreeBlock* block = cache->freeLists[sizeClass];
+	if (!block)
+	{
+		if (!refillCache(allocator, cache, sizeClass))
+			return NULL;
+		block = cache->freeLists[sizeClass];
+	}
+
+	cache->freeLists[sizeClass] = block->next;
+	--cache->freeCounts[sizeClass];
+
+	BlockHeader* header = (BlockHeader*)block;
+	header->sizeClass = sizeClass;
+	header->offset = 0;
+	header->size = 0;
+
+	cache->size += getClassSize(sizeClass) - HEADER_SIZE;
+	++cache->totalAllocations;
+	++cache->currentAllocations;
+	return (uint8_t*)block + HEADER_SIZE;
+}
+
+void* dsThreadCacheAllocator_realloc(dsThreadCacheAllocator* allocator, void* ptr, size_t size,
+	unsigned int alignment)
+{
+	if (!allocator || !allocator->centralLists)
+	{
+		errno = EINVAL;
+		return NULL;
+	}
+
+	if (!ptr)
+		return dsThreadCacheAllocator_alloc(allocator, size, alignment);
+
+	if (size == 0)
+	{
+		dsThreadCacheAllocator_free(allocator, ptr);
+		return NULL;
+	}
+
+	dsThreadCache* cache = getThreadCache(allocator);
+	if (!cache)
+		return NULL;
+
+	BlockHeader* header = (BlockHeader*)((uint8_t*)ptr - HEADER_SIZE);
+	size_t origSize;
+	if (header->sizeClass == LARGE_CLASS)
+	{
+		origSize = (size_t)header->size;
+
+		// Re-allocate in place when staying a large allocation with the same alignment.
+		if (size > DS_THREAD_CACHE_MAX_SIZE && alignment <= header->offset &&
+			size <= (size_t)-1 - header->offset)
+		{
+			unsigned int padding = header->offset;
+			uint8_t* base = (uint8_t*)dsSystemAllocator_realloc(&allocator->systemAllocator,
+				(uint8_t*)ptr - padding, size + padding, padding);
+			if (!base)
+				return NULL;
+
+			ptr = base + padding;
+			header = (BlockHeader*)(base + padding - HEADER_SIZE);
+			header->size = size;
+			cache->size += size - origSize;
+			++cache->totalAllocations;
+			return ptr;
+		}
+	}
+	else
+	{
+		origSize = getClassSize(header->sizeClass) - HEADER_SIZE;
+
+		// Keep the same block if it's the same size class.
+		if (size <= DS_THREAD_CACHE_MAX_SIZE && alignment <= DS_ALLOC_ALIGNMENT &&
+			getSizeClass(size + HEADER_SIZE) == header->sizeClass)
+		{
+			++cache->totalAllocations;
+			return ptr;
+		}
+	}
+
+	void* newPtr = dsThreadCacheAllocator_alloc(allocator, size, alignment);
+	if (!newPtr)
+		return NULL;
+
+	memcpy(newPtr, ptr, size < origSize ? size : origSize);
+	DS_VERIFY(dsThreadCacheAllocator_free(allocator, ptr));
+	return newPtr;
+}
+
+bool dsThreadCacheAllocator_free(dsThreadCacheAllocator* allocator, void* ptr)
+{
+	if (!allocator || !allocator->centralLists)
+	{
+		errno = EINVAL;
+		return false;
+	}
+
+	if (!ptr)
+		return true;
+
+	dsThreadCache* cache = getThreadCache(allocator);
+	if (!cache)
+		return false;
+
+	BlockHeader* header = (BlockHeader*)((uint8_t*)ptr - HEADER_SIZE);
+	uint32_t sizeClass = header->sizeClass;
+	if (sizeClass == LARGE_CLASS)
+	{
+		cache->size -= (size_t)header->size;
+		--cache->currentAllocations;
+		return dsSystemAllocator_free(&allocator->systemAllocator,
+			(uint8_t*)ptr - header->offset);
+	}
+
+	DS_ASSERT(sizeClass < CLASS_COUNT);
+	cache->size -= getClassSize(sizeClass) - HEADER_SIZE;
+	--cache->currentAllocations;
+
+	FreeBlock* block = (FreeBlock*)header;
+	block->next = cache->freeLists[sizeClass];
+	cache->freeLists[sizeClass] = block;
+
+	// Return a batch to the central list once there are two batches worth cached.
+	uint32_t batchCount = getBatchCount(sizeClass);
+	if (++cache->freeCounts[sizeClass] > batchCount*2)
+		releaseBlocks(allocator, cache, sizeClass, batchCount);
+	return true;
+}
+
+bool dsThreadCacheAllocator_flushThread(dsThreadCacheAllocator* allocator)
+{
+	if (!allocator || !allocator->centralLists)
+	{
+		errno = EINVAL;
+		return false;
+	}
+
+	dsThreadCache* cache = (dsThreadCache*)dsThreadStorage_get(allocator->threadStorage);
+	if (!cache)
+		return true;
+
+	for (uint32_t i = 0; i < CLASS_COUNT; ++i)
+	{
+		if (cache->freeCounts[i] > 0)
+			releaseBlocks(allocator, cache, i, cache->freeCounts[i]);
+		DS_ASSERT(!cache->freeLists[i]);
+	}
+
+	// The statistics are kept with the cache so they will still be correct when it's re-used.
+	DS_VERIFY(dsSpinlock_lock(&allocator->cacheLock));
+	cache->active = false;
+	DS_VERIFY(dsSpinlock_unlock(&allocator->cacheLock));
+	return dsThreadStorage_set(allocator->threadStorage, NULL);
+}
+
+bool dsThreadCacheAllocator_updateStats(dsThreadCacheAllocator* allocator)
+{
+	if (!allocator || !allocator->centralLists)
+	{
+		errno = EINVAL;
+		return false;
+	}
+
+	size_t size = 0;
+	uint32_t totalAllocations = 0;
+	uint32_t currentAllocations = 0;
+	DS_VERIFY(dsSpinlock_lock(&allocator->cacheLock));
+	for (const dsThreadCache* cache = allocator->caches; cache; cache = cache->next)
+	{
+		size += cache->size;
+		totalAllocations += cache->totalAllocations;
+		currentAllocations += cache->currentAllocations;
+	}
+	DS_VERIFY(dsSpinlock_unlock(&allocator->cacheLock));
+
+	((dsAllocator*)allocator)->size = size;
+	((dsAllocator*)allocator)->totalAllocations = totalAllocations;
+	((dsAllocator*)allocator)->currentAllocations = currentAllocations;
+	return true;
+}
+
+void dsThreadCacheAllocator_shutdown(dsThreadCacheAllocator* allocator)
+{
+	if (!allocator || !allocator->centralLists)
+		return;
+
+	for (uint32_t i = 0; i < CLASS_COUNT; ++i)
+	{
+		CentralListData* central = &allocator->centralLists[i].data;
+		void* span = central->spans;
+		while (span)
+		{
+			void* nextSpan = *(void**)span;
+			DS_VERIFY(dsSystemAllocator_free(&allocator->systemAllocator, span));
+			span = nextSpan;
+		}
+		dsSpinlock_shutdown(&central->lock);
+	}
+
+	dsThreadCache* cache = allocator->caches;
+	while (cache)
+	{
+		dsThreadCache* nextCache = cache->next;
+		DS_VERIFY(dsSystemAllocator_free(&allocator->systemAllocator, cache));
+		cache = nextCache;
+	}
+
+	DS_VERIFY(dsSystemAllocator_free(&allocator->systemAllocator, allocator->centralLists));
+	dsThreadStorage_shutdown(&allocator->threadStorage);
+	dsSpinlock_shutdown(&allocator->cacheLock);
+	allocator->caches = NULL;
+	allocator->centralLists = NULL;
+}
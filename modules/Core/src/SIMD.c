@@ -0,0 +1,82 @@
+/*
+ * Copyright 2020 Aaron Barany
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <DeepSea/Core/SIMD.h>
+#include <DeepSea/Core/Atomic.h>
+
+#if DS_MSC && (DS_X86_32 || DS_X86_64)
+#include <intrin.h>
+#endif
+
+#define UNKNOWN_FEATURES -1
+
+static int32_t hostFeatures = UNKNOWN_FEATURES;
+
+static dsSIMDFeatures queryFeatures(void)
+{
+	dsSIMDFeatures features = dsSIMDFeatures_None;
+#if DS_X86_32 || DS_X86_64
+#if DS_MSC
+	int cpuInfo[4];
+	__cpuid(cpuInfo, 1);
+	int ecx = cpuInfo[2];
+	int edx = cpuInfo[3];
+	if (edx & (1 << 25))
+		features |= dsSIMDFeatures_Float4;
+	if (ecx & 1)
+		features |= dsSIMDFeatures_HAdd;
+
+	// AVX registers must also be saved by the OS.
+	if ((ecx & (1 << 27)) && (ecx & (1 << 28)) && (_xgetbv(0) & 0x6) == 0x6)
+	{
+		features |= dsSIMDFeatures_Float8;
+		if (ecx & (1 << 12))
+			features |= dsSIMDFeatures_FMA;
+	}
+#else
+	__builtin_cpu_init();
+	if (__builtin_cpu_supports("sse"))
+		features |= dsSIMDFeatures_Float4;
+	if (__builtin_cpu_supports("sse3"))
+		features |= dsSIMDFeatures_HAdd;
+	if (__builtin_cpu_supports("avx"))
+	{
+		features |= dsSIMDFeatures_Float8;
+		if (__builtin_cpu_supports("fma"))
+			features |= dsSIMDFeatures_FMA;
+	}
+#endif
+#elif DS_ARM_64
+	features = dsSIMDFeatures_Float4 | dsSIMDFeatures_HAdd | dsSIMDFeatures_FMA;
+#elif DS_ARM_32 && defined(__ARM_NEON)
+	features = dsSIMDFeatures_Float4;
+#endif
+	return features;
+}
+
+dsSIMDFeatures dsSIMD_getHostFeatures(void)
+{
+	int32_t features;
+	DS_ATOMIC_LOAD32(&hostFeatures, &features);
+	if (features == UNKNOWN_FEATURES)
+	{
+		// Multiple threads may query at the same time, but they will get the same result.
+		features = queryFeatures();
+		DS_ATOMIC_STORE32(&hostFeatures, &features);
+	}
+
+	return (dsSIMDFeatures)features;
+}
@@ -16,7 +16,15 @@
 
 #define _GNU_SOURCE
 #include <DeepSea/Core/Sort.h>
+
+#include <DeepSea/Core/Memory/Allocator.h>
+#include <DeepSea/Core/Memory/BufferAllocator.h>
+#include <DeepSea/Core/Thread/TaskGraph.h>
+#include <DeepSea/Core/Thread/ThreadPool.h>
+#include <DeepSea/Core/Assert.h>
+#include <DeepSea/Core/Error.h>
 #include <stdlib.h>
+#include <string.h>
 #if DS_WINDOWS
 #include <search.h>
 #elif DS_ANDROID
@@ -61,6 +69,110 @@ static void qsort_r_workaround(void* array, size_t memberCount, size_t memberSiz
 }
 #endif
 
+#define MIN_PARALLEL_SORT_CHUNK 2048
+
+typedef struct ParallelSortInfo
+{
+	uint8_t* array;
+	uint8_t* tempArray;
+	size_t memberCount;
+	size_t memberSize;
+	uint32_t chunkCount;
+	dsSortCompareFunction compareFunc;
+	void* context;
+} ParallelSortInfo;
+
+typedef struct ParallelSortTask
+{
+	const ParallelSortInfo* info;
+	uint32_t level;
+	uint32_t index;
+} ParallelSortTask;
+
+static size_t chunkStart(const ParallelSortInfo* info, uint32_t chunk)
+{
+	return (size_t)((uint64_t)info->memberCount*chunk/info->chunkCount);
+}
+
+static void sortChunkTask(void* userData)
+{
+	const ParallelSortTask* task = (const ParallelSortTask*)userData;
+	const ParallelSortInfo* info = task->info;
+	size_t start = chunkStart(info, task->index);
+	size_t end = chunkStart(info, task->index + 1);
+	dsSort(info->array + start*info->memberSize, end - start, info->memberSize,
+		info->compareFunc, info->context);
+}
+
+// Finds how many elements from the left range are in the first outIndex elements of the merged
+// result. Elements from the left range are taken first when equal.
+static size_t findMergeSplit(const uint8_t* left, size_t leftCount, const uint8_t* right,
+	size_t rightCount, size_t outIndex, const ParallelSortInfo* info)
+{
+	size_t memberSize = info->memberSize;
+	size_t low = outIndex > rightCount ? outIndex - rightCount : 0;
+	size_t high = outIndex < leftCount ? outIndex : leftCount;
+	while (low < high)
+	{
+		size_t middle = low + (high - low)/2;
+		if (info->compareFunc(left + middle*memberSize,
+				right + (outIndex - middle - 1)*memberSize, info->context) <= 0)
+		{
+			low = middle + 1;
+		}
+		else
+			high = middle;
+	}
+
+	return low;
+}
+
+static void mergeTask(void* userData)
+{
+	const ParallelSortTask* task = (const ParallelSortTask*)userData;
+	const ParallelSortInfo* info = task->info;
+	size_t memberSize = info->memberSize;
+
+	// Level 1 merges from the original array, then alternates with the temporary array.
+	const uint8_t* src = task->level & 1 ? info->array : info->tempArray;
+	uint8_t* dst = task->level & 1 ? info->tempArray : info->array;
+
+	uint32_t pieceCount = 1U << task->level;
+	uint32_t merge = task->index/pieceCount;
+	uint32_t piece = task->index - merge*pieceCount;
+	size_t start = chunkStart(info, merge*pieceCount);
+	size_t middle = chunkStart(info, merge*pieceCount + pieceCount/2);
+	size_t end = chunkStart(info, (merge + 1)*pieceCount);
+
+	const uint8_t* left = src + start*memberSize;
+	size_t leftCount = middle - start;
+	const uint8_t* right = src + middle*memberSize;
+	size_t rightCount = end - middle;
+
+	// Split the output evenly between the pieces.
+	size_t totalCount = end - start;
+	size_t outBegin = (size_t)((uint64_t)totalCount*piece/pieceCount);
+	size_t outEnd = (size_t)((uint64_t)totalCount*(piece + 1)/pieceCount);
+	size_t i = findMergeSplit(left, leftCount, right, rightCount, outBegin, info);
+	size_t j = outBegin - i;
+
+	uint8_t* out = dst + (start + outBegin)*memberSize;
+	for (size_t k = outBegin; k < outEnd; ++k, out += memberSize)
+	{
+		if (j >= rightCount || (i < leftCount && info->compareFunc(left + i*memberSize,
+				right + j*memberSize, info->context) <= 0))
+		{
+			memcpy(out, left + i*memberSize, memberSize);
+			++i;
+		}
+		else
+		{
+			memcpy(out, right + j*memberSize, memberSize);
+			++j;
+		}
+	}
+}
+
 void dsSort(void* array, size_t memberCount, size_t memberSize, dsSortCompareFunction compareFunc,
 	void* context)
 {
@@ -77,6 +189,210 @@ void dsSort(void* array, size_t memberCount, size_t memberSize, dsSortCompareFun
 #endif
 }
 
+// Shared implementation for the radix sorts. Histograms for all digits are computed at once to
+// avoid extra passes over the values.
+#define DEFINE_RADIX_SORT(name, Type, KeyType, getKey) \
+	Type* name(Type* values, Type* tempValues, size_t valueCount) \
+	{ \
+		if (!values || !tempValues) \
+			return NULL; \
+		\
+		enum {digitBits = 8, digitCount = 1 << digitBits, \
+			passCount = sizeof(KeyType)*8/digitBits}; \
+		size_t histograms[passCount][digitCount]; \
+		memset(histograms, 0, sizeof(histograms)); \
+		for (size_t i = 0; i < valueCount; ++i) \
+		{ \
+			KeyType key = getKey(values[i]); \
+			for (unsigned int j = 0; j < passCount; ++j) \
+				++histograms[j][(key >> (j*digitBits)) & (digitCount - 1)]; \
+		} \
+		\
+		Type* src = values; \
+		Type* dst = tempValues; \
+		for (unsigned int i = 0; i < passCount; ++i) \
+		{ \
+			size_t* histogram = histograms[i]; \
+			unsigned int shift = i*digitBits; \
+			\
+			/* Skip the pass if all values have the same digit, since the order wouldn't change. */ \
+			if (valueCount == 0 || \
+				histogram[(getKey(src[0]) >> shift) & (digitCount - 1)] == valueCount) \
+			{ \
+				continue; \
+			} \
+			\
+			/* Convert the counts to the starting offsets. */ \
+			size_t offset = 0; \
+			for (unsigned int j = 0; j < digitCount; ++j) \
+			{ \
+				size_t count = histogram[j]; \
+				histogram[j] = offset; \
+				offset += count; \
+			} \
+			\
+			for (size_t j = 0; j < valueCount; ++j) \
+			{ \
+				const Type* value = src + j; \
+				dst[histogram[(getKey(*value) >> shift) & (digitCount - 1)]++] = *value; \
+			} \
+			\
+			Type* temp = src; \
+			src = dst; \
+			dst = temp; \
+		} \
+		\
+		return src; \
+	}
+
+#define SORT_KEY_KEY(value) ((value).key)
+#define IDENTITY_KEY(value) (value)
+#define FLOAT_KEY(value) dsSortKeyFromFloat(value)
+
+DEFINE_RADIX_SORT(dsRadixSortKeys, dsSortKey, uint64_t, SORT_KEY_KEY)
+DEFINE_RADIX_SORT(dsRadixSortUInt32, uint32_t, uint32_t, IDENTITY_KEY)
+DEFINE_RADIX_SORT(dsRadixSortUInt64, uint64_t, uint64_t, IDENTITY_KEY)
+DEFINE_RADIX_SORT(dsRadixSortFloat, float, uint32_t, FLOAT_KEY)
+
+bool dsParallelSort(void* array, size_t memberCount, size_t memberSize,
+	dsSortCompareFunction compareFunc, void* context, dsAllocator* allocator,
+	dsThreadPool* threadPool)
+{
+	if ((!array && memberCount > 0) || memberSize == 0 || !compareFunc || !allocator ||
+		!allocator->freeFunc)
+	{
+		errno = EINVAL;
+		return false;
+	}
+
+	// Use a power of two number of chunks so they can be merged in pairs, with at least as many
+	// chunks as threads. (including the current thread)
+	uint32_t chunkCount = 1;
+	if (threadPool)
+	{
+		uint32_t threadCount = dsThreadPool_getThreadCount(threadPool) + 1;
+		while (chunkCount < threadCount && memberCount/(chunkCount*2) >= MIN_PARALLEL_SORT_CHUNK)
+			chunkCount *= 2;
+	}
+
+	if (chunkCount == 1)
+	{
+		dsSort(array, memberCount, memberSize, compareFunc, context);
+		return true;
+	}
+
+	uint32_t levelCount = 0;
+	while ((1U << levelCount) < chunkCount)
+		++levelCount;
+
+	size_t taskCount = chunkCount*(levelCount + 1);
+	size_t fullSize = DS_ALIGNED_SIZE(memberCount*memberSize) +
+		DS_ALIGNED_SIZE(sizeof(ParallelSortTask)*taskCount);
+	void* buffer = dsAllocator_alloc(allocator, fullSize);
+	if (!buffer)
+		return false;
+
+	dsBufferAllocator bufferAlloc;
+	DS_VERIFY(dsBufferAllocator_initialize(&bufferAlloc, buffer, fullSize));
+
+	ParallelSortInfo info = {(uint8_t*)array,
+		(uint8_t*)dsAllocator_alloc((dsAllocator*)&bufferAlloc, memberCount*memberSize),
+		memberCount, memberSize, chunkCount, compareFunc, context};
+	DS_ASSERT(info.tempArray);
+
+	ParallelSortTask* tasks = DS_ALLOCATE_OBJECT_ARRAY(&bufferAlloc, ParallelSortTask, taskCount);
+	DS_ASSERT(tasks);
+
+	dsTaskGraph* taskGraph = dsTaskGraph_create(allocator, threadPool);
+	if (!taskGraph)
+	{
+		DS_VERIFY(dsAllocator_free(allocator, buffer));
+		return false;
+	}
+
+	// Each level has chunkCount tasks: first sorting each chunk, then for each level of merging
+	// the merges are split into enough pieces to have one task per chunk.
+	bool success = true;
+	for (uint32_t level = 0; level <= levelCount && success; ++level)
+	{
+		for (uint32_t i = 0; i < chunkCount; ++i)
+		{
+			ParallelSortTask* task = tasks + level*chunkCount + i;
+			task->info = &info;
+			task->level = level;
+			task->index = i;
+			uint32_t taskIndex = dsTaskGraph_addTask(taskGraph,
+				level == 0 ? &sortChunkTask : &mergeTask, task);
+			if (taskIndex == DS_NO_TASK)
+			{
+				success = false;
+				break;
+			}
+			DS_ASSERT(taskIndex == level*chunkCount + i);
+
+			if (level == 0)
+				continue;
+
+			// Depends on all the pieces of the two merges from the previous level that are the
+			// inputs.
+			uint32_t pieceCount = 1U << level;
+			uint32_t firstDependency = (level - 1)*chunkCount + i/pieceCount*pieceCount;
+			for (uint32_t j = 0; j < pieceCount; ++j)
+			{
+				if (!dsTaskGraph_addDependency(taskGraph, taskIndex, firstDependency + j))
+				{
+					success = false;
+					break;
+				}
+			}
+
+			if (!success)
+				break;
+		}
+	}
+
+	if (success)
+		success = dsTaskGraph_execute(taskGraph);
+
+	// Odd number of merge levels leaves the final result in the temporary array.
+	if (success && (levelCount & 1))
+		memcpy(array, info.tempArray, memberCount*memberSize);
+
+	dsTaskGraph_destroy(taskGraph);
+	DS_VERIFY(dsAllocator_free(allocator, buffer));
+	return success;
+}
+
+bool dsInsertionSortKeys(dsSortKey* keys, size_t keyCount, size_t maxMoves)
+{
+	if (!keys)
+		return keyCount == 0;
+
+	size_t moves = 0;
+	for (size_t i = 1; i < keyCount; ++i)
+	{
+		if (keys[i - 1].key <= keys[i].key)
+			continue;
+
+		dsSortKey key = keys[i];
+		size_t j = i;
+		do
+		{
+			if (moves++ >= maxMoves)
+			{
+				keys[j] = key;
+				return false;
+			}
+
+			keys[j] = keys[j - 1];
+			--j;
+		} while (j > 0 && keys[j - 1].key > key.key);
+		keys[j] = key;
+	}
+
+	return true;
+}
+
 void* dsBinarySearch(const void* key, const void* array, size_t memberCount,
 	size_t memberSize, dsSortCompareFunction compareFunc, void* context)
 {
@@ -212,3 +528,5 @@ void* dsBinarySearchUpperBound(const void* key, const void* array, size_t member
 		return NULL;
 	return arrayBytes + start*memberSize;
 }
+
+uint32_t dsSortKeyFromFloat(float value);
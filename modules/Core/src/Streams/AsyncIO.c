@@ -0,0 +1,522 @@
+/*
+ * Copyright 2020 Aaron Barany
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <DeepSea/Core/Streams/AsyncIO.h>
+
+#include <DeepSea/Core/Containers/ResizeableArray.h>
+#include <DeepSea/Core/Memory/Allocator.h>
+#include <DeepSea/Core/Memory/BufferAllocator.h>
+#include <DeepSea/Core/Thread/ConditionVariable.h>
+#include <DeepSea/Core/Thread/Mutex.h>
+#include <DeepSea/Core/Thread/Thread.h>
+#include <DeepSea/Core/Assert.h>
+#include <DeepSea/Core/Error.h>
+#include <DeepSea/Core/Log.h>
+#include <DeepSea/Core/Profile.h>
+#include <string.h>
+
+#if DS_WINDOWS
+#define WIN32_LEAN_AND_MEAN
+#include <Windows.h>
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+typedef struct Request
+{
+	dsAsyncIORequest request;
+	uint64_t id;
+} Request;
+
+typedef struct Worker
+{
+	dsThread thread;
+	dsAsyncIO* asyncIO;
+	uint64_t currentRequest;
+	bool started;
+} Worker;
+
+struct dsAsyncIO
+{
+	dsAllocator* allocator;
+	Worker* workers;
+	uint32_t threadCount;
+
+	dsMutex* mutex;
+	dsConditionVariable* queueCondition;
+	dsConditionVariable* completeCondition;
+
+	// Binary heap of pending requests, with the next request to execute at the front.
+	Request** requests;
+	uint32_t requestCount;
+	uint32_t maxRequests;
+
+	uint64_t nextID;
+	bool stop;
+};
+
+static bool runsBefore(const Request* left, const Request* right)
+{
+	if (left->request.priority != right->request.priority)
+		return left->request.priority > right->request.priority;
+	return left->id < right->id;
+}
+
+static void siftUp(Request** requests, uint32_t index)
+{
+	Request* request = requests[index];
+	while (index > 0)
+	{
+		uint32_t parent = (index - 1)/2;
+		if (!runsBefore(request, requests[parent]))
+			break;
+
+		requests[index] = requests[parent];
+		index = parent;
+	}
+	requests[index] = request;
+}
+
+static void siftDown(Request** requests, uint32_t count, uint32_t index)
+{
+	Request* request = requests[index];
+	for (;;)
+	{
+		uint32_t child = index*2 + 1;
+		if (child >= count)
+			break;
+
+		if (child + 1 < count && runsBefore(requests[child + 1], requests[child]))
+			++child;
+		if (!runsBefore(requests[child], request))
+			break;
+
+		requests[index] = requests[child];
+		index = child;
+	}
+	requests[index] = request;
+}
+
+static Request* removeRequest(dsAsyncIO* asyncIO, uint32_t index)
+{
+	DS_ASSERT(index < asyncIO->requestCount);
+	Request* request = asyncIO->requests[index];
+	uint32_t last = --asyncIO->requestCount;
+	if (index == last)
+		return request;
+
+	asyncIO->requests[index] = asyncIO->requests[last];
+	if (index > 0 && runsBefore(asyncIO->requests[index], asyncIO->requests[(index - 1)/2]))
+		siftUp(asyncIO->requests, index);
+	else
+		siftDown(asyncIO->requests, asyncIO->requestCount, index);
+	return request;
+}
+
+static bool isRequestActive(const dsAsyncIO* asyncIO, uint64_t requestID)
+{
+	for (uint32_t i = 0; i < asyncIO->requestCount; ++i)
+	{
+		if (asyncIO->requests[i]->id == requestID)
+			return true;
+	}
+
+	for (uint32_t i = 0; i < asyncIO->threadCount; ++i)
+	{
+		if (asyncIO->workers[i].currentRequest == requestID)
+			return true;
+	}
+
+	return false;
+}
+
+static bool isIdle(const dsAsyncIO* asyncIO)
+{
+	if (asyncIO->requestCount > 0)
+		return false;
+
+	for (uint32_t i = 0; i < asyncIO->threadCount; ++i)
+	{
+		if (asyncIO->workers[i].currentRequest != DS_NO_ASYNC_IO_REQUEST)
+			return false;
+	}
+
+	return true;
+}
+
+static bool readFile(size_t* outReadSize, const dsAsyncIORequest* request)
+{
+	*outReadSize = 0;
+	uint8_t* destination = (uint8_t*)request->destination;
+#if DS_WINDOWS
+	HANDLE file = CreateFileA(request->filePath, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING,
+		FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+	if (file == INVALID_HANDLE_VALUE)
+	{
+		errno = GetLastError() == ERROR_FILE_NOT_FOUND ? ENOENT : EIO;
+		return false;
+	}
+
+	uint64_t offset = request->offset;
+	while (*outReadSize < request->size)
+	{
+		size_t remaining = request->size - *outReadSize;
+		DWORD readSize = remaining > 0x80000000 ? 0x80000000 : (DWORD)remaining;
+
+		// Passing the offset with an OVERLAPPED structure performs a positional read.
+		OVERLAPPED overlapped;
+		memset(&overlapped, 0, sizeof(overlapped));
+		overlapped.Offset = (DWORD)offset;
+		overlapped.OffsetHigh = (DWORD)(offset >> 32);
+
+		DWORD bytesRead = 0;
+		if (!ReadFile(file, destination + *outReadSize, readSize, &bytesRead, &overlapped))
+		{
+			if (GetLastError() == ERROR_HANDLE_EOF)
+				break;
+
+			CloseHandle(file);
+			errno = EIO;
+			return false;
+		}
+
+		if (bytesRead == 0)
+			break;
+
+		*outReadSize += bytesRead;
+		offset += bytesRead;
+	}
+
+	CloseHandle(file);
+	return true;
+#else
+	int file = open(request->filePath, O_RDONLY);
+	if (file < 0)
+		return false;
+
+	if ((uint64_t)(off_t)request->offset != request->offset || (off_t)request->offset < 0)
+	{
+		close(file);
+		errno = ESIZE;
+		return false;
+	}
+
+	off_t offset = (off_t)request->offset;
+	while (*outReadSize < request->size)
+	{
+		ssize_t bytesRead = pread(file, destination + *outReadSize,
+			request->size - *outReadSize, offset);
+		if (bytesRead < 0)
+		{
+			if (errno == EINTR)
+				continue;
+
+			int error = errno;
+			close(file);
+			errno = error;
+			return false;
+		}
+
+		if (bytesRead == 0)
+			break;
+
+		*outReadSize += (size_t)bytesRead;
+		offset += bytesRead;
+	}
+
+	close(file);
+	return true;
+#endif
+}
+
+static void executeRequest(Request* request)
+{
+	DS_PROFILE_SCOPE_START("Async Read");
+
+	size_t readSize;
+	dsAsyncIOResult result = readFile(&readSize, &request->request) ? dsAsyncIOResult_Success :
+		dsAsyncIOResult_Failed;
+	if (result == dsAsyncIOResult_Failed)
+	{
+		int error = errno;
+		DS_LOG_ERROR_F(DS_CORE_LOG_TAG, "Couldn't read file '%s': %s",
+			request->request.filePath, dsErrorString(error));
+		errno = error;
+	}
+
+	if (request->request.completeFunc)
+	{
+		request->request.completeFunc(request->request.userData, request->id, result,
+			readSize);
+	}
+
+	DS_PROFILE_SCOPE_END();
+}
+
+static void cancelRequest(Request* request)
+{
+	if (request->request.completeFunc)
+	{
+		request->request.completeFunc(request->request.userData, request->id,
+			dsAsyncIOResult_Canceled, 0);
+	}
+}
+
+static dsThreadReturnType workerThreadFunc(void* userData)
+{
+	Worker* worker = (Worker*)userData;
+	dsAsyncIO* asyncIO = worker->asyncIO;
+
+	DS_VERIFY(dsMutex_lock(asyncIO->mutex));
+	do
+	{
+		while (!asyncIO->stop && asyncIO->requestCount == 0)
+			dsConditionVariable_wait(asyncIO->queueCondition, asyncIO->mutex);
+
+		if (asyncIO->stop)
+			break;
+
+		Request* request = removeRequest(asyncIO, 0);
+		worker->currentRequest = request->id;
+		DS_VERIFY(dsMutex_unlock(asyncIO->mutex));
+
+		executeRequest(request);
+		DS_VERIFY(dsAllocator_free(asyncIO->allocator, request));
+
+		DS_VERIFY(dsMutex_lock(asyncIO->mutex));
+		worker->currentRequest = DS_NO_ASYNC_IO_REQUEST;
+		DS_VERIFY(dsConditionVariable_notifyAll(asyncIO->completeCondition));
+	} while (true);
+	DS_VERIFY(dsMutex_unlock(asyncIO->mutex));
+
+	return 0;
+}
+
+dsAsyncIO* dsAsyncIO_create(dsAllocator* allocator, unsigned int threadCount,
+	unsigned int stackSize)
+{
+	if (!allocator || threadCount == 0)
+	{
+		errno = EINVAL;
+		return NULL;
+	}
+
+	if (!allocator->freeFunc)
+	{
+		errno = EINVAL;
+		DS_LOG_ERROR(DS_CORE_LOG_TAG, "Async IO allocator must support freeing memory.");
+		return NULL;
+	}
+
+	size_t fullSize = DS_ALIGNED_SIZE(sizeof(dsAsyncIO)) + dsMutex_fullAllocSize() +
+		dsConditionVariable_fullAllocSize()*2 + DS_ALIGNED_SIZE(sizeof(Worker)*threadCount);
+	void* buffer = dsAllocator_alloc(allocator, fullSize);
+	if (!buffer)
+		return NULL;
+
+	memset(buffer, 0, fullSize);
+	dsBufferAllocator bufferAlloc;
+	DS_VERIFY(dsBufferAllocator_initialize(&bufferAlloc, buffer, fullSize));
+
+	dsAsyncIO* asyncIO = DS_ALLOCATE_OBJECT(&bufferAlloc, dsAsyncIO);
+	DS_ASSERT(asyncIO);
+	asyncIO->allocator = allocator;
+	asyncIO->nextID = DS_NO_ASYNC_IO_REQUEST + 1;
+
+	asyncIO->mutex = dsMutex_create((dsAllocator*)&bufferAlloc, "Async IO");
+	DS_ASSERT(asyncIO->mutex);
+	asyncIO->queueCondition = dsConditionVariable_create((dsAllocator*)&bufferAlloc,
+		"Async IO Queue");
+	DS_ASSERT(asyncIO->queueCondition);
+	asyncIO->completeCondition = dsConditionVariable_create((dsAllocator*)&bufferAlloc,
+		"Async IO Complete");
+	DS_ASSERT(asyncIO->completeCondition);
+
+	asyncIO->workers = DS_ALLOCATE_OBJECT_ARRAY(&bufferAlloc, Worker, threadCount);
+	DS_ASSERT(asyncIO->workers);
+	asyncIO->threadCount = threadCount;
+
+	for (uint32_t i = 0; i < threadCount; ++i)
+	{
+		Worker* worker = asyncIO->workers + i;
+		worker->asyncIO = asyncIO;
+		if (!dsThread_create(&worker->thread, &workerThreadFunc, worker, stackSize,
+				"Async IO Worker"))
+		{
+			dsAsyncIO_destroy(asyncIO);
+			return NULL;
+		}
+		worker->started = true;
+	}
+
+	return asyncIO;
+}
+
+unsigned int dsAsyncIO_getThreadCount(const dsAsyncIO* asyncIO)
+{
+	if (!asyncIO)
+		return 0;
+
+	return asyncIO->threadCount;
+}
+
+uint64_t dsAsyncIO_queueRead(dsAsyncIO* asyncIO, const dsAsyncIORequest* request)
+{
+	if (!asyncIO || !request || !request->filePath || (!request->destination && request->size > 0))
+	{
+		errno = EINVAL;
+		return DS_NO_ASYNC_IO_REQUEST;
+	}
+
+	size_t pathLen = strlen(request->filePath) + 1;
+	size_t fullSize = DS_ALIGNED_SIZE(sizeof(Request)) + DS_ALIGNED_SIZE(pathLen);
+	void* buffer = dsAllocator_alloc(asyncIO->allocator, fullSize);
+	if (!buffer)
+		return DS_NO_ASYNC_IO_REQUEST;
+
+	dsBufferAllocator bufferAlloc;
+	DS_VERIFY(dsBufferAllocator_initialize(&bufferAlloc, buffer, fullSize));
+	Request* queuedRequest = DS_ALLOCATE_OBJECT(&bufferAlloc, Request);
+	DS_ASSERT(queuedRequest);
+	queuedRequest->request = *request;
+
+	char* filePath = DS_ALLOCATE_OBJECT_ARRAY(&bufferAlloc, char, pathLen);
+	DS_ASSERT(filePath);
+	memcpy(filePath, request->filePath, pathLen);
+	queuedRequest->request.filePath = filePath;
+
+	DS_VERIFY(dsMutex_lock(asyncIO->mutex));
+
+	uint32_t index = asyncIO->requestCount;
+	if (!DS_RESIZEABLE_ARRAY_ADD(asyncIO->allocator, asyncIO->requests, asyncIO->requestCount,
+			asyncIO->maxRequests, 1))
+	{
+		DS_VERIFY(dsMutex_unlock(asyncIO->mutex));
+		DS_VERIFY(dsAllocator_free(asyncIO->allocator, queuedRequest));
+		return DS_NO_ASYNC_IO_REQUEST;
+	}
+
+	uint64_t id = queuedRequest->id = asyncIO->nextID++;
+	asyncIO->requests[index] = queuedRequest;
+	siftUp(asyncIO->requests, index);
+	DS_VERIFY(dsConditionVariable_notifyOne(asyncIO->queueCondition));
+
+	DS_VERIFY(dsMutex_unlock(asyncIO->mutex));
+	return id;
+}
+
+bool dsAsyncIO_cancel(dsAsyncIO* asyncIO, uint64_t requestID)
+{
+	if (!asyncIO || requestID == DS_NO_ASYNC_IO_REQUEST)
+	{
+		errno = EINVAL;
+		return false;
+	}
+
+	Request* request = NULL;
+	DS_VERIFY(dsMutex_lock(asyncIO->mutex));
+	for (uint32_t i = 0; i < asyncIO->requestCount; ++i)
+	{
+		if (asyncIO->requests[i]->id == requestID)
+		{
+			request = removeRequest(asyncIO, i);
+			break;
+		}
+	}
+	DS_VERIFY(dsMutex_unlock(asyncIO->mutex));
+
+	if (!request)
+	{
+		errno = ENOTFOUND;
+		return false;
+	}
+
+	cancelRequest(request);
+	DS_VERIFY(dsAllocator_free(asyncIO->allocator, request));
+
+	// Wake up anything waiting on the canceled request.
+	DS_VERIFY(dsMutex_lock(asyncIO->mutex));
+	DS_VERIFY(dsConditionVariable_notifyAll(asyncIO->completeCondition));
+	DS_VERIFY(dsMutex_unlock(asyncIO->mutex));
+	return true;
+}
+
+bool dsAsyncIO_waitForRequest(dsAsyncIO* asyncIO, uint64_t requestID)
+{
+	if (!asyncIO || requestID == DS_NO_ASYNC_IO_REQUEST)
+	{
+		errno = EINVAL;
+		return false;
+	}
+
+	DS_PROFILE_WAIT_START("Async IO Wait");
+	DS_VERIFY(dsMutex_lock(asyncIO->mutex));
+	while (isRequestActive(asyncIO, requestID))
+		dsConditionVariable_wait(asyncIO->completeCondition, asyncIO->mutex);
+	DS_VERIFY(dsMutex_unlock(asyncIO->mutex));
+	DS_PROFILE_WAIT_END();
+	return true;
+}
+
+bool dsAsyncIO_waitUntilIdle(dsAsyncIO* asyncIO)
+{
+	if (!asyncIO)
+	{
+		errno = EINVAL;
+		return false;
+	}
+
+	DS_PROFILE_WAIT_START("Async IO Wait");
+	DS_VERIFY(dsMutex_lock(asyncIO->mutex));
+	while (!isIdle(asyncIO))
+		dsConditionVariable_wait(asyncIO->completeCondition, asyncIO->mutex);
+	DS_VERIFY(dsMutex_unlock(asyncIO->mutex));
+	DS_PROFILE_WAIT_END();
+	return true;
+}
+
+void dsAsyncIO_destroy(dsAsyncIO* asyncIO)
+{
+	if (!asyncIO)
+		return;
+
+	DS_VERIFY(dsMutex_lock(asyncIO->mutex));
+	asyncIO->stop = true;
+	DS_VERIFY(dsConditionVariable_notifyAll(asyncIO->queueCondition));
+	DS_VERIFY(dsMutex_unlock(asyncIO->mutex));
+
+	for (uint32_t i = 0; i < asyncIO->threadCount; ++i)
+	{
+		Worker* worker = asyncIO->workers + i;
+		if (worker->started)
+			DS_VERIFY(dsThread_join(&worker->thread, NULL));
+	}
+
+	// Cancel requests that were never started in the order they would have been executed.
+	while (asyncIO->requestCount > 0)
+	{
+		Request* request = removeRequest(asyncIO, 0);
+		cancelRequest(request);
+		DS_VERIFY(dsAllocator_free(asyncIO->allocator, request));
+	}
+
+	dsMutex_destroy(asyncIO->mutex);
+	dsConditionVariable_destroy(asyncIO->queueCondition);
+	dsConditionVariable_destroy(asyncIO->completeCondition);
+	DS_VERIFY(dsAllocator_free(asyncIO->allocator, asyncIO->requests));
+	DS_VERIFY(dsAllocator_free(asyncIO->allocator, asyncIO));
+}
@@ -0,0 +1,157 @@
+/*
+ * Copyright 2020 Aaron Barany
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <DeepSea/Core/Streams/BufferedStream.h>
+#include <DeepSea/Core/Streams/Stream.h>
+#include <DeepSea/Core/Assert.h>
+#include <DeepSea/Core/Error.h>
+#include <string.h>
+
+static void discardBuffer(dsBufferedStream* stream)
+{
+	stream->bufferPosition = 0;
+	stream->bufferEnd = 0;
+}
+
+bool dsBufferedStream_open(dsBufferedStream* stream, dsStream* baseStream, void* buffer,
+	size_t bufferSize)
+{
+	if (!stream || !baseStream || !baseStream->readFunc || !buffer || bufferSize == 0)
+	{
+		errno = EINVAL;
+		return false;
+	}
+
+	((dsStream*)stream)->readFunc = (dsStreamReadFunction)&dsBufferedStream_read;
+	((dsStream*)stream)->writeFunc = NULL;
+	((dsStream*)stream)->seekFunc = baseStream->seekFunc ?
+		(dsStreamSeekFunction)&dsBufferedStream_seek : NULL;
+	((dsStream*)stream)->tellFunc = baseStream->tellFunc ?
+		(dsStreamTellFunction)&dsBufferedStream_tell : NULL;
+	((dsStream*)stream)->flushFunc = NULL;
+	((dsStream*)stream)->closeFunc = (dsStreamCloseFunction)&dsBufferedStream_close;
+	((dsStream*)stream)->getContentsFunc = NULL;
+	stream->baseStream = baseStream;
+	stream->buffer = (uint8_t*)buffer;
+	stream->bufferSize = bufferSize;
+	discardBuffer(stream);
+	return true;
+}
+
+size_t dsBufferedStream_read(dsBufferedStream* stream, void* data, size_t size)
+{
+	if (!stream || !stream->baseStream || !data)
+	{
+		errno = EINVAL;
+		return 0;
+	}
+
+	DS_ASSERT(stream->bufferPosition <= stream->bufferEnd);
+	uint8_t* dataBytes = (uint8_t*)data;
+	size_t readSize = stream->bufferEnd - stream->bufferPosition;
+	if (readSize >= size)
+	{
+		// Common case: fully served from the buffer.
+		memcpy(dataBytes, stream->buffer + stream->bufferPosition, size);
+		stream->bufferPosition += size;
+		return size;
+	}
+
+	memcpy(dataBytes, stream->buffer + stream->bufferPosition, readSize);
+	discardBuffer(stream);
+
+	size_t remaining = size - readSize;
+	if (remaining >= stream->bufferSize)
+	{
+		// Large reads would only be copied again, so read directly.
+		return readSize + dsStream_read(stream->baseStream, dataBytes + readSize, remaining);
+	}
+
+	stream->bufferEnd = dsStream_read(stream->baseStream, stream->buffer, stream->bufferSize);
+	if (remaining > stream->bufferEnd)
+		remaining = stream->bufferEnd;
+	memcpy(dataBytes + readSize, stream->buffer, remaining);
+	stream->bufferPosition = remaining;
+	return readSize + remaining;
+}
+
+bool dsBufferedStream_seek(dsBufferedStream* stream, int64_t offset, dsStreamSeekWay way)
+{
+	if (!stream || !stream->baseStream)
+	{
+		errno = EINVAL;
+		return false;
+	}
+
+	DS_ASSERT(stream->bufferPosition <= stream->bufferEnd);
+	size_t readAhead = stream->bufferEnd - stream->bufferPosition;
+	if (way == dsStreamSeekWay_Current)
+	{
+		if ((offset >= 0 && (uint64_t)offset <= readAhead) ||
+			(offset < 0 && (uint64_t)-offset <= stream->bufferPosition))
+		{
+			stream->bufferPosition = (size_t)((int64_t)stream->bufferPosition + offset);
+			return true;
+		}
+
+		// The base stream is ahead of this stream by the read ahead amount.
+		offset -= (int64_t)readAhead;
+	}
+
+	if (!dsStream_seek(stream->baseStream, offset, way))
+		return false;
+
+	discardBuffer(stream);
+	return true;
+}
+
+uint64_t dsBufferedStream_tell(dsBufferedStream* stream)
+{
+	if (!stream || !stream->baseStream)
+	{
+		errno = EINVAL;
+		return DS_STREAM_INVALID_POS;
+	}
+
+	uint64_t position = dsStream_tell(stream->baseStream);
+	if (position == DS_STREAM_INVALID_POS)
+		return position;
+
+	DS_ASSERT(stream->bufferPosition <= stream->bufferEnd);
+	return position - (stream->bufferEnd - stream->bufferPosition);
+}
+
+bool dsBufferedStream_close(dsBufferedStream* stream)
+{
+	if (!stream || !stream->baseStream)
+	{
+		errno = EINVAL;
+		return false;
+	}
+
+	// Give back any data that was read ahead.
+	DS_ASSERT(stream->bufferPosition <= stream->bufferEnd);
+	size_t readAhead = stream->bufferEnd - stream->bufferPosition;
+	bool success = true;
+	if (readAhead > 0 && stream->baseStream->seekFunc)
+		success = dsStream_seek(stream->baseStream, -(int64_t)readAhead, dsStreamSeekWay_Current);
+
+	stream->baseStream = NULL;
+	stream->buffer = NULL;
+	stream->bufferSize = 0;
+	discardBuffer(stream);
+	return success;
+}
@@ -26,6 +26,7 @@ static void initFileStream(dsFileStream* stream, FILE* file)
 	((dsStream*)stream)->tellFunc = (dsStreamTellFunction)&dsFileStream_tell;
 	((dsStream*)stream)->flushFunc = (dsStreamFlushFunction)&dsFileStream_flush;
 	((dsStream*)stream)->closeFunc = (dsStreamCloseFunction)&dsFileStream_close;
+	((dsStream*)stream)->getContentsFunc = NULL;
 	stream->file = file;
 }
 
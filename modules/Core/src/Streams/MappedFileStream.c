@@ -0,0 +1,262 @@
+/*
+ * Copyright 2020 Aaron Barany
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <DeepSea/Core/Streams/MappedFileStream.h>
+#include <DeepSea/Core/Assert.h>
+#include <DeepSea/Core/Error.h>
+#include <string.h>
+
+#if DS_WINDOWS
+#define WIN32_LEAN_AND_MEAN
+#include <Windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+// Empty files can't be mapped, so point to this instead to distinguish from a closed stream.
+static const uint8_t emptyData[1] = {0};
+
+static bool mapFile(dsMappedFileStream* stream, const char* filePath)
+{
+#if DS_WINDOWS
+	HANDLE file = CreateFileA(filePath, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING,
+		FILE_ATTRIBUTE_NORMAL, NULL);
+	if (file == INVALID_HANDLE_VALUE)
+	{
+		errno = GetLastError() == ERROR_FILE_NOT_FOUND ? ENOENT : EIO;
+		return false;
+	}
+
+	LARGE_INTEGER fileSize;
+	if (!GetFileSizeEx(file, &fileSize))
+	{
+		CloseHandle(file);
+		errno = EIO;
+		return false;
+	}
+
+	if ((uint64_t)fileSize.QuadPart > (uint64_t)(size_t)-1)
+	{
+		CloseHandle(file);
+		errno = ESIZE;
+		return false;
+	}
+
+	if (fileSize.QuadPart == 0)
+	{
+		CloseHandle(file);
+		stream->data = emptyData;
+		stream->size = 0;
+		return true;
+	}
+
+	// The view keeps a reference to the mapping and file, so the handles can be closed.
+	HANDLE mapping = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+	CloseHandle(file);
+	if (!mapping)
+	{
+		errno = EIO;
+		return false;
+	}
+
+	void* data = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+	CloseHandle(mapping);
+	if (!data)
+	{
+		errno = ENOMEM;
+		return false;
+	}
+
+	stream->data = data;
+	stream->size = (size_t)fileSize.QuadPart;
+	return true;
+#else
+	int file = open(filePath, O_RDONLY);
+	if (file < 0)
+		return false;
+
+	struct stat fileInfo;
+	if (fstat(file, &fileInfo) != 0)
+	{
+		int error = errno;
+		close(file);
+		errno = error;
+		return false;
+	}
+
+	if (!S_ISREG(fileInfo.st_mode))
+	{
+		close(file);
+		errno = EINVAL;
+		return false;
+	}
+
+	if ((uint64_t)fileInfo.st_size > (uint64_t)(size_t)-1)
+	{
+		close(file);
+		errno = ESIZE;
+		return false;
+	}
+
+	if (fileInfo.st_size == 0)
+	{
+		close(file);
+		stream->data = emptyData;
+		stream->size = 0;
+		return true;
+	}
+
+	// The mapping keeps a reference to the file, so it may be closed immediately.
+	size_t size = (size_t)fileInfo.st_size;
+	void* data = mmap(NULL, size, PROT_READ, MAP_PRIVATE, file, 0);
+	close(file);
+	if (data == MAP_FAILED)
+		return false;
+
+	stream->data = data;
+	stream->size = size;
+	return true;
+#endif
+}
+
+bool dsMappedFileStream_openPath(dsMappedFileStream* stream, const char* filePath)
+{
+	if (!stream || !filePath)
+	{
+		errno = EINVAL;
+		return false;
+	}
+
+	if (!mapFile(stream, filePath))
+		return false;
+
+	((dsStream*)stream)->readFunc = (dsStreamReadFunction)&dsMappedFileStream_read;
+	((dsStream*)stream)->writeFunc = NULL;
+	((dsStream*)stream)->seekFunc = (dsStreamSeekFunction)&dsMappedFileStream_seek;
+	((dsStream*)stream)->tellFunc = (dsStreamTellFunction)&dsMappedFileStream_tell;
+	((dsStream*)stream)->flushFunc = NULL;
+	((dsStream*)stream)->closeFunc = (dsStreamCloseFunction)&dsMappedFileStream_close;
+	((dsStream*)stream)->getContentsFunc =
+		(dsStreamGetContentsFunction)&dsMappedFileStream_getContents;
+	stream->position = 0;
+	return true;
+}
+
+size_t dsMappedFileStream_read(dsMappedFileStream* stream, void* data, size_t size)
+{
+	if (!stream || !stream->data || !data)
+	{
+		errno = EINVAL;
+		return 0;
+	}
+
+	DS_ASSERT(stream->position <= stream->size);
+	size_t remaining = stream->size - stream->position;
+	if (size > remaining)
+		size = remaining;
+
+	memcpy(data, (const uint8_t*)stream->data + stream->position, size);
+	stream->position += size;
+	return size;
+}
+
+bool dsMappedFileStream_seek(dsMappedFileStream* stream, int64_t offset, dsStreamSeekWay way)
+{
+	if (!stream || !stream->data)
+	{
+		errno = EINVAL;
+		return false;
+	}
+
+	int64_t position;
+	switch (way)
+	{
+		case dsStreamSeekWay_Beginning:
+			position = offset;
+			break;
+		case dsStreamSeekWay_Current:
+			position = (int64_t)stream->position + offset;
+			break;
+		case dsStreamSeekWay_End:
+			position = (int64_t)stream->size + offset;
+			break;
+		default:
+			DS_ASSERT(false);
+			errno = EINVAL;
+			return false;
+	}
+
+	if (position < 0 || (uint64_t)position > stream->size)
+	{
+		errno = EINVAL;
+		return false;
+	}
+
+	stream->position = (size_t)position;
+	return true;
+}
+
+uint64_t dsMappedFileStream_tell(dsMappedFileStream* stream)
+{
+	if (!stream || !stream->data)
+	{
+		errno = EINVAL;
+		return DS_STREAM_INVALID_POS;
+	}
+
+	return stream->position;
+}
+
+const void* dsMappedFileStream_getContents(size_t* outSize, dsMappedFileStream* stream)
+{
+	if (!outSize || !stream || !stream->data)
+	{
+		errno = EINVAL;
+		return NULL;
+	}
+
+	DS_ASSERT(stream->position <= stream->size);
+	const void* contents = (const uint8_t*)stream->data + stream->position;
+	*outSize = stream->size - stream->position;
+	stream->position = stream->size;
+	return contents;
+}
+
+bool dsMappedFileStream_close(dsMappedFileStream* stream)
+{
+	if (!stream || !stream->data)
+	{
+		errno = EINVAL;
+		return false;
+	}
+
+	if (stream->data != emptyData)
+	{
+#if DS_WINDOWS
+		UnmapViewOfFile(stream->data);
+#else
+		munmap((void*)stream->data, stream->size);
+#endif
+	}
+
+	stream->data = NULL;
+	stream->size = 0;
+	stream->position = 0;
+	return true;
+}
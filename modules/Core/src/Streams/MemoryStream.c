@@ -33,6 +33,7 @@ bool dsMemoryStream_open(dsMemoryStream* stream, void* buffer, size_t size)
 	((dsStream*)stream)->tellFunc = (dsStreamTellFunction)&dsMemoryStream_tell;
 	((dsStream*)stream)->flushFunc = NULL;
 	((dsStream*)stream)->closeFunc = (dsStreamCloseFunction)&dsMemoryStream_close;
+	((dsStream*)stream)->getContentsFunc = (dsStreamGetContentsFunction)&dsMemoryStream_getContents;
 	stream->buffer = buffer;
 	stream->size = size;
 	stream->position = 0;
@@ -123,6 +124,21 @@ uint64_t dsMemoryStream_tell(dsMemoryStream* stream)
 	return stream->position;
 }
 
+const void* dsMemoryStream_getContents(size_t* outSize, dsMemoryStream* stream)
+{
+	if (!outSize || !stream || !stream->buffer)
+	{
+		errno = EINVAL;
+		return NULL;
+	}
+
+	DS_ASSERT(stream->position <= stream->size);
+	const void* contents = (const uint8_t*)stream->buffer + stream->position;
+	*outSize = stream->size - stream->position;
+	stream->position = stream->size;
+	return contents;
+}
+
 bool dsMemoryStream_close(dsMemoryStream* stream)
 {
 	if (!stream || !stream->buffer)
@@ -106,6 +106,30 @@ static uint64_t assetTell(dsGenericStream* stream)
 	return position;
 }
 
+static const void* assetGetContents(size_t* outSize, dsGenericStream* stream)
+{
+	if (!outSize || !stream || !stream->userData)
+	{
+		errno = EINVAL;
+		return NULL;
+	}
+
+	// Uncompressed assets can be accessed directly, otherwise this will decompress the full asset
+	// to memory owned by the asset.
+	AAsset* asset = (AAsset*)stream->userData;
+	const uint8_t* buffer = (const uint8_t*)AAsset_getBuffer(asset);
+	off64_t position = AAsset_seek64(asset, 0, SEEK_CUR);
+	off64_t length = AAsset_getLength64(asset);
+	if (!buffer || position < 0 || AAsset_seek64(asset, 0, SEEK_END) < 0)
+	{
+		errno = EIO;
+		return NULL;
+	}
+
+	*outSize = (size_t)(length - position);
+	return buffer + position;
+}
+
 static bool assetClose(dsGenericStream* stream)
 {
 	if (!stream || !stream->userData)
@@ -322,6 +346,7 @@ bool dsResourceStream_open(dsResourceStream* stream, dsFileResourceType type, co
 			((dsStream*)stream)->tellFunc = (dsStreamTellFunction)&assetTell;
 			((dsStream*)stream)->flushFunc = NULL;
 			((dsStream*)stream)->closeFunc = (dsStreamCloseFunction)&assetClose;
+			((dsStream*)stream)->getContentsFunc = (dsStreamGetContentsFunction)&assetGetContents;
 			((dsGenericStream*)stream)->userData = asset;
 			stream->isFile = false;
 			return true;
@@ -23,6 +23,36 @@
 size_t dsStream_read(dsStream* stream, void* data, size_t size);
 
 
+size_t dsStream_readv(dsStream* stream, const dsStreamBuffer* buffers, uint32_t bufferCount)
+{
+	if (!stream || !stream->readFunc || (!buffers && bufferCount > 0))
+	{
+		errno = EINVAL;
+		return 0;
+	}
+
+	size_t totalSize = 0;
+	for (uint32_t i = 0; i < bufferCount; ++i)
+	{
+		const dsStreamBuffer* buffer = buffers + i;
+		if (buffer->size == 0)
+			continue;
+
+		if (!buffer->data)
+		{
+			errno = EINVAL;
+			return totalSize;
+		}
+
+		size_t readSize = stream->readFunc(stream, buffer->data, buffer->size);
+		totalSize += readSize;
+		if (readSize != buffer->size)
+			break;
+	}
+
+	return totalSize;
+}
+
 void* dsStream_readUntilEnd(size_t* outSize, dsStream* stream, dsAllocator* allocator)
 {
 	void* buffer = NULL;
@@ -118,6 +148,7 @@ bool dsStream_readUntilEndReuse(void** buffer, size_t* size, size_t* capacity, d
 	return true;
 }
 
+const void* dsStream_getContents(size_t* outSize, dsStream* stream);
 size_t dsStream_write(dsStream* stream, const void* data, size_t size);
 
 bool dsStream_seek(dsStream* stream, int64_t offset, dsStreamSeekWay way);
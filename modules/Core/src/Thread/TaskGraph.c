@@ -0,0 +1,328 @@
+/*
+ * Copyright 2020 Aaron Barany
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <DeepSea/Core/Thread/TaskGraph.h>
+
+#include "ThreadPoolInternal.h"
+#include <DeepSea/Core/Containers/ResizeableArray.h>
+#include <DeepSea/Core/Memory/Allocator.h>
+#include <DeepSea/Core/Assert.h>
+#include <DeepSea/Core/Atomic.h>
+#include <DeepSea/Core/Error.h>
+#include <DeepSea/Core/Log.h>
+#include <DeepSea/Core/Profile.h>
+#include <DeepSea/Core/Types.h>
+#include <string.h>
+
+typedef struct TaskDependency
+{
+	uint32_t task;
+	uint32_t dependency;
+} TaskDependency;
+
+struct dsTaskGraph
+{
+	dsAllocator* allocator;
+	dsThreadPool* threadPool;
+
+	dsTaskGraphNode* tasks;
+	uint32_t taskCount;
+	uint32_t maxTasks;
+
+	TaskDependency* dependencies;
+	uint32_t dependencyCount;
+	uint32_t maxDependencies;
+
+	// Dependent task indices for each task, followed by scratch space for validation.
+	uint32_t* dependents;
+	uint32_t maxDependents;
+
+	int32_t remainingTasks;
+	bool dirty;
+	bool executing;
+};
+
+static bool setupDependents(dsTaskGraph* taskGraph)
+{
+	uint32_t requiredDependents = taskGraph->dependencyCount + taskGraph->taskCount;
+	if (requiredDependents > taskGraph->maxDependents)
+	{
+		DS_VERIFY(dsAllocator_free(taskGraph->allocator, taskGraph->dependents));
+		taskGraph->maxDependents = 0;
+		taskGraph->dependents = DS_ALLOCATE_OBJECT_ARRAY(taskGraph->allocator, uint32_t,
+			requiredDependents);
+		if (!taskGraph->dependents)
+			return false;
+		taskGraph->maxDependents = requiredDependents;
+	}
+
+	for (uint32_t i = 0; i < taskGraph->taskCount; ++i)
+	{
+		dsTaskGraphNode* task = taskGraph->tasks + i;
+		task->dependentCount = 0;
+		task->dependencyCount = 0;
+	}
+
+	for (uint32_t i = 0; i < taskGraph->dependencyCount; ++i)
+	{
+		const TaskDependency* dependency = taskGraph->dependencies + i;
+		++taskGraph->tasks[dependency->dependency].dependentCount;
+		++taskGraph->tasks[dependency->task].dependencyCount;
+	}
+
+	uint32_t offset = 0;
+	for (uint32_t i = 0; i < taskGraph->taskCount; ++i)
+	{
+		dsTaskGraphNode* task = taskGraph->tasks + i;
+		task->firstDependent = offset;
+		offset += task->dependentCount;
+		task->dependentCount = 0;
+	}
+	DS_ASSERT(offset == taskGraph->dependencyCount);
+
+	for (uint32_t i = 0; i < taskGraph->dependencyCount; ++i)
+	{
+		const TaskDependency* dependency = taskGraph->dependencies + i;
+		dsTaskGraphNode* task = taskGraph->tasks + dependency->dependency;
+		taskGraph->dependents[task->firstDependent + task->dependentCount++] = dependency->task;
+	}
+
+	// Topological sort to guarantee there are no cycles, which would otherwise never finish.
+	uint32_t* readyTasks = taskGraph->dependents + taskGraph->dependencyCount;
+	uint32_t readyCount = 0;
+	for (uint32_t i = 0; i < taskGraph->taskCount; ++i)
+	{
+		dsTaskGraphNode* task = taskGraph->tasks + i;
+		task->remainingDependencies = task->dependencyCount;
+		if (task->dependencyCount == 0)
+			readyTasks[readyCount++] = i;
+	}
+
+	for (uint32_t i = 0; i < readyCount; ++i)
+	{
+		const dsTaskGraphNode* task = taskGraph->tasks + readyTasks[i];
+		const uint32_t* dependents = taskGraph->dependents + task->firstDependent;
+		for (uint32_t j = 0; j < task->dependentCount; ++j)
+		{
+			if (--taskGraph->tasks[dependents[j]].remainingDependencies == 0)
+				readyTasks[readyCount++] = dependents[j];
+		}
+	}
+
+	if (readyCount != taskGraph->taskCount)
+	{
+		errno = EINVAL;
+		DS_LOG_ERROR(DS_CORE_LOG_TAG, "Task graph dependencies contain a cycle.");
+		return false;
+	}
+
+	taskGraph->dirty = false;
+	return true;
+}
+
+dsTaskGraph* dsTaskGraph_create(dsAllocator* allocator, dsThreadPool* threadPool)
+{
+	if (!allocator || !threadPool)
+	{
+		errno = EINVAL;
+		return NULL;
+	}
+
+	if (!allocator->freeFunc)
+	{
+		errno = EINVAL;
+		DS_LOG_ERROR(DS_CORE_LOG_TAG, "Task graph allocator must support freeing memory.");
+		return NULL;
+	}
+
+	dsTaskGraph* taskGraph = DS_ALLOCATE_OBJECT(allocator, dsTaskGraph);
+	if (!taskGraph)
+		return NULL;
+
+	memset(taskGraph, 0, sizeof(dsTaskGraph));
+	taskGraph->allocator = allocator;
+	taskGraph->threadPool = threadPool;
+	return taskGraph;
+}
+
+uint32_t dsTaskGraph_getTaskCount(const dsTaskGraph* taskGraph)
+{
+	if (!taskGraph)
+		return 0;
+
+	return taskGraph->taskCount;
+}
+
+uint32_t dsTaskGraph_addTask(dsTaskGraph* taskGraph, dsThreadTaskFunction function,
+	void* userData)
+{
+	if (!taskGraph || !function)
+	{
+		errno = EINVAL;
+		return DS_NO_TASK;
+	}
+
+	if (taskGraph->executing)
+	{
+		errno = EPERM;
+		DS_LOG_ERROR(DS_CORE_LOG_TAG, "Cannot add tasks to a task graph while it's executing.");
+		return DS_NO_TASK;
+	}
+
+	uint32_t index = taskGraph->taskCount;
+	if (!DS_RESIZEABLE_ARRAY_ADD(taskGraph->allocator, taskGraph->tasks, taskGraph->taskCount,
+			taskGraph->maxTasks, 1))
+	{
+		return DS_NO_TASK;
+	}
+
+	dsTaskGraphNode* task = taskGraph->tasks + index;
+	memset(task, 0, sizeof(dsTaskGraphNode));
+	task->function = function;
+	task->userData = userData;
+	task->taskGraph = taskGraph;
+	taskGraph->dirty = true;
+	return index;
+}
+
+bool dsTaskGraph_addDependency(dsTaskGraph* taskGraph, uint32_t task, uint32_t dependency)
+{
+	if (!taskGraph || task >= taskGraph->taskCount || dependency >= taskGraph->taskCount ||
+		task == dependency)
+	{
+		errno = EINVAL;
+		return false;
+	}
+
+	if (taskGraph->executing)
+	{
+		errno = EPERM;
+		DS_LOG_ERROR(DS_CORE_LOG_TAG,
+			"Cannot add dependencies to a task graph while it's executing.");
+		return false;
+	}
+
+	uint32_t index = taskGraph->dependencyCount;
+	if (!DS_RESIZEABLE_ARRAY_ADD(taskGraph->allocator, taskGraph->dependencies,
+			taskGraph->dependencyCount, taskGraph->maxDependencies, 1))
+	{
+		return false;
+	}
+
+	TaskDependency* taskDependency = taskGraph->dependencies + index;
+	taskDependency->task = task;
+	taskDependency->dependency = dependency;
+	taskGraph->dirty = true;
+	return true;
+}
+
+bool dsTaskGraph_execute(dsTaskGraph* taskGraph)
+{
+	if (!taskGraph)
+	{
+		errno = EINVAL;
+		return false;
+	}
+
+	if (taskGraph->executing)
+	{
+		errno = EPERM;
+		DS_LOG_ERROR(DS_CORE_LOG_TAG, "Task graph is already executing.");
+		return false;
+	}
+
+	if (taskGraph->taskCount == 0)
+		return true;
+
+	DS_PROFILE_FUNC_START();
+
+	if (taskGraph->dirty && !setupDependents(taskGraph))
+		DS_PROFILE_FUNC_RETURN(false);
+
+	taskGraph->executing = true;
+	int32_t remainingTasks = (int32_t)taskGraph->taskCount;
+	DS_ATOMIC_STORE32(&taskGraph->remainingTasks, &remainingTasks);
+
+	// Reset all dependency counts before queueing any tasks since they may start executing
+	// immediately.
+	for (uint32_t i = 0; i < taskGraph->taskCount; ++i)
+	{
+		dsTaskGraphNode* task = taskGraph->tasks + i;
+		task->remainingDependencies = task->dependencyCount;
+	}
+
+	for (uint32_t i = 0; i < taskGraph->taskCount; ++i)
+	{
+		dsTaskGraphNode* task = taskGraph->tasks + i;
+		if (task->dependencyCount == 0)
+			dsThreadPool_queueTask(taskGraph->threadPool, task);
+	}
+
+	dsThreadPool_waitForCounter(taskGraph->threadPool, &taskGraph->remainingTasks);
+	taskGraph->executing = false;
+	DS_PROFILE_FUNC_RETURN(true);
+}
+
+bool dsTaskGraph_clear(dsTaskGraph* taskGraph)
+{
+	if (!taskGraph)
+	{
+		errno = EINVAL;
+		return false;
+	}
+
+	if (taskGraph->executing)
+	{
+		errno = EPERM;
+		DS_LOG_ERROR(DS_CORE_LOG_TAG, "Cannot clear a task graph while it's executing.");
+		return false;
+	}
+
+	taskGraph->taskCount = 0;
+	taskGraph->dependencyCount = 0;
+	taskGraph->dirty = true;
+	return true;
+}
+
+void dsTaskGraph_destroy(dsTaskGraph* taskGraph)
+{
+	if (!taskGraph)
+		return;
+
+	DS_ASSERT(!taskGraph->executing);
+	DS_VERIFY(dsAllocator_free(taskGraph->allocator, taskGraph->tasks));
+	DS_VERIFY(dsAllocator_free(taskGraph->allocator, taskGraph->dependencies));
+	DS_VERIFY(dsAllocator_free(taskGraph->allocator, taskGraph->dependents));
+	DS_VERIFY(dsAllocator_free(taskGraph->allocator, taskGraph));
+}
+
+void dsTaskGraph_finishTask(dsTaskGraphNode* task)
+{
+	// Don't access the task graph after the final task has finished since the executing thread
+	// may return immediately.
+	dsTaskGraph* taskGraph = task->taskGraph;
+	dsThreadPool* threadPool = taskGraph->threadPool;
+	const uint32_t* dependents = taskGraph->dependents + task->firstDependent;
+	for (uint32_t i = 0; i < task->dependentCount; ++i)
+	{
+		dsTaskGraphNode* dependent = taskGraph->tasks + dependents[i];
+		if (DS_ATOMIC_FETCH_ADD32(&dependent->remainingDependencies, -1) == 1)
+			dsThreadPool_queueTask(threadPool, dependent);
+	}
+
+	if (DS_ATOMIC_FETCH_ADD32(&taskGraph->remainingTasks, -1) == 1)
+		dsThreadPool_notifyCounter(threadPool);
+}
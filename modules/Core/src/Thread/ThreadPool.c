@@ -0,0 +1,480 @@
+/*
+ * Copyright 2020 Aaron Barany
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <DeepSea/Core/Thread/ThreadPool.h>
+
+#include "ThreadPoolInternal.h"
+#include <DeepSea/Core/Containers/ResizeableArray.h>
+#include <DeepSea/Core/Memory/Allocator.h>
+#include <DeepSea/Core/Memory/BufferAllocator.h>
+#include <DeepSea/Core/Thread/ConditionVariable.h>
+#include <DeepSea/Core/Thread/Mutex.h>
+#include <DeepSea/Core/Thread/Spinlock.h>
+#include <DeepSea/Core/Thread/Thread.h>
+#include <DeepSea/Core/Thread/ThreadStorage.h>
+#include <DeepSea/Core/Assert.h>
+#include <DeepSea/Core/Atomic.h>
+#include <DeepSea/Core/Error.h>
+#include <DeepSea/Core/Log.h>
+#include <DeepSea/Core/Profile.h>
+#include <DeepSea/Core/Types.h>
+#include <string.h>
+
+#define CACHE_LINE_SIZE 64
+#define SPIN_COUNT 32
+#define TASK_MASK (DS_THREAD_POOL_MAX_WORKER_TASKS - 1)
+
+_Static_assert((DS_THREAD_POOL_MAX_WORKER_TASKS & TASK_MASK) == 0,
+	"DS_THREAD_POOL_MAX_WORKER_TASKS must be a power of two.");
+
+// Chase-Lev work stealing queue. The owning thread pushes and pops from the bottom, while other
+// threads steal from the top. Top and bottom are kept on separate cache lines to avoid false
+// sharing between the owner and thieves.
+typedef struct TaskQueue
+{
+	int64_t top;
+	uint8_t topPadding[CACHE_LINE_SIZE - sizeof(int64_t)];
+	int64_t bottom;
+	uint8_t bottomPadding[CACHE_LINE_SIZE - sizeof(int64_t)];
+	dsTaskGraphNode* tasks[DS_THREAD_POOL_MAX_WORKER_TASKS];
+} TaskQueue;
+
+typedef struct Worker
+{
+	TaskQueue queue;
+	dsThread thread;
+	dsThreadPool* threadPool;
+	uint32_t randomState;
+	bool started;
+} Worker;
+
+struct dsThreadPool
+{
+	dsAllocator* allocator;
+	Worker* workers;
+	uint32_t threadCount;
+
+	dsSpinlock sharedLock;
+	dsTaskGraphNode** sharedTasks;
+	uint32_t sharedTaskCount;
+	uint32_t maxSharedTasks;
+
+	dsMutex* waitMutex;
+	dsConditionVariable* waitCondition;
+	dsThreadStorage currentWorker;
+
+	int32_t queuedTasks;
+	int32_t waitingThreads;
+	int32_t stop;
+};
+
+static bool pushTask(TaskQueue* queue, dsTaskGraphNode* task)
+{
+	int64_t bottom, top;
+	DS_ATOMIC_LOAD64(&queue->bottom, &bottom);
+	DS_ATOMIC_LOAD64(&queue->top, &top);
+	if (bottom - top >= DS_THREAD_POOL_MAX_WORKER_TASKS)
+		return false;
+
+	DS_ATOMIC_STORE_PTR(queue->tasks + (bottom & TASK_MASK), &task);
+	++bottom;
+	DS_ATOMIC_STORE64(&queue->bottom, &bottom);
+	return true;
+}
+
+static dsTaskGraphNode* popTask(TaskQueue* queue)
+{
+	int64_t bottom, top;
+	DS_ATOMIC_LOAD64(&queue->bottom, &bottom);
+	--bottom;
+	DS_ATOMIC_STORE64(&queue->bottom, &bottom);
+	DS_ATOMIC_LOAD64(&queue->top, &top);
+
+	if (top > bottom)
+	{
+		// Empty, restore the original bottom.
+		++bottom;
+		DS_ATOMIC_STORE64(&queue->bottom, &bottom);
+		return NULL;
+	}
+
+	dsTaskGraphNode* task;
+	DS_ATOMIC_LOAD_PTR(queue->tasks + (bottom & TASK_MASK), &task);
+	if (top == bottom)
+	{
+		// Last task in the queue, so need to guard against other threads stealing it.
+		int64_t nextTop = top + 1;
+		if (!DS_ATOMIC_COMPARE_EXCHANGE64(&queue->top, &top, &nextTop, false))
+			task = NULL;
+		++bottom;
+		DS_ATOMIC_STORE64(&queue->bottom, &bottom);
+	}
+
+	return task;
+}
+
+static dsTaskGraphNode* stealTask(TaskQueue* queue)
+{
+	int64_t top, bottom;
+	DS_ATOMIC_LOAD64(&queue->top, &top);
+	DS_ATOMIC_LOAD64(&queue->bottom, &bottom);
+	if (top >= bottom)
+		return NULL;
+
+	dsTaskGraphNode* task;
+	DS_ATOMIC_LOAD_PTR(queue->tasks + (top & TASK_MASK), &task);
+	int64_t nextTop = top + 1;
+	if (!DS_ATOMIC_COMPARE_EXCHANGE64(&queue->top, &top, &nextTop, false))
+		return NULL;
+
+	return task;
+}
+
+static bool pushSharedTask(dsThreadPool* threadPool, dsTaskGraphNode* task)
+{
+	DS_VERIFY(dsSpinlock_lock(&threadPool->sharedLock));
+	uint32_t index = threadPool->sharedTaskCount;
+	bool success = DS_RESIZEABLE_ARRAY_ADD(threadPool->allocator, threadPool->sharedTasks,
+		threadPool->sharedTaskCount, threadPool->maxSharedTasks, 1);
+	if (success)
+		threadPool->sharedTasks[index] = task;
+	DS_VERIFY(dsSpinlock_unlock(&threadPool->sharedLock));
+	return success;
+}
+
+static dsTaskGraphNode* popSharedTask(dsThreadPool* threadPool)
+{
+	dsTaskGraphNode* task = NULL;
+	DS_VERIFY(dsSpinlock_lock(&threadPool->sharedLock));
+	if (threadPool->sharedTaskCount > 0)
+		task = threadPool->sharedTasks[--threadPool->sharedTaskCount];
+	DS_VERIFY(dsSpinlock_unlock(&threadPool->sharedLock));
+	return task;
+}
+
+static uint32_t nextRandom(uint32_t* state)
+{
+	// xorshift32
+	uint32_t x = *state;
+	x ^= x << 13;
+	x ^= x >> 17;
+	x ^= x << 5;
+	*state = x;
+	return x;
+}
+
+static dsTaskGraphNode* findTask(dsThreadPool* threadPool, Worker* worker)
+{
+	int32_t queuedTasks;
+	DS_ATOMIC_LOAD32(&threadPool->queuedTasks, &queuedTasks);
+	if (queuedTasks <= 0)
+		return NULL;
+
+	dsTaskGraphNode* task = NULL;
+	if (worker)
+		task = popTask(&worker->queue);
+
+	if (!task)
+		task = popSharedTask(threadPool);
+
+	if (!task && threadPool->threadCount > 0)
+	{
+		uint32_t start = worker ? nextRandom(&worker->randomState) : 0;
+		for (uint32_t i = 0; i < threadPool->threadCount && !task; ++i)
+		{
+			Worker* victim = threadPool->workers + (start + i) % threadPool->threadCount;
+			if (victim != worker)
+				task = stealTask(&victim->queue);
+		}
+	}
+
+	if (task)
+		DS_ATOMIC_FETCH_ADD32(&threadPool->queuedTasks, -1);
+	return task;
+}
+
+static void runTask(dsTaskGraphNode* task)
+{
+	task->function(task->userData);
+	dsTaskGraph_finishTask(task);
+}
+
+static bool hasWork(dsThreadPool* threadPool, const int32_t* counter)
+{
+	int32_t value;
+	DS_ATOMIC_LOAD32(&threadPool->queuedTasks, &value);
+	if (value > 0)
+		return true;
+
+	DS_ATOMIC_LOAD32(&threadPool->stop, &value);
+	if (value)
+		return true;
+
+	if (counter)
+	{
+		DS_ATOMIC_LOAD32(counter, &value);
+		if (value <= 0)
+			return true;
+	}
+
+	return false;
+}
+
+static void waitForWork(dsThreadPool* threadPool, const int32_t* counter)
+{
+	DS_PROFILE_WAIT_START("Thread Pool Idle");
+	DS_VERIFY(dsMutex_lock(threadPool->waitMutex));
+	DS_ATOMIC_FETCH_ADD32(&threadPool->waitingThreads, 1);
+	while (!hasWork(threadPool, counter))
+		dsConditionVariable_wait(threadPool->waitCondition, threadPool->waitMutex);
+	DS_ATOMIC_FETCH_ADD32(&threadPool->waitingThreads, -1);
+	DS_VERIFY(dsMutex_unlock(threadPool->waitMutex));
+	DS_PROFILE_WAIT_END();
+}
+
+static void notifyWaiting(dsThreadPool* threadPool, bool all)
+{
+	int32_t waitingThreads;
+	DS_ATOMIC_LOAD32(&threadPool->waitingThreads, &waitingThreads);
+	if (waitingThreads <= 0)
+		return;
+
+	DS_VERIFY(dsMutex_lock(threadPool->waitMutex));
+	if (all)
+		DS_VERIFY(dsConditionVariable_notifyAll(threadPool->waitCondition));
+	else
+		DS_VERIFY(dsConditionVariable_notifyOne(threadPool->waitCondition));
+	DS_VERIFY(dsMutex_unlock(threadPool->waitMutex));
+}
+
+static dsThreadReturnType workerThreadFunc(void* userData)
+{
+	Worker* worker = (Worker*)userData;
+	dsThreadPool* threadPool = worker->threadPool;
+	DS_VERIFY(dsThreadStorage_set(threadPool->currentWorker, worker));
+
+	unsigned int spinCount = 0;
+	do
+	{
+		dsTaskGraphNode* task = findTask(threadPool, worker);
+		if (task)
+		{
+			runTask(task);
+			spinCount = 0;
+			continue;
+		}
+
+		int32_t stop;
+		DS_ATOMIC_LOAD32(&threadPool->stop, &stop);
+		if (stop)
+			break;
+
+		// Spin for a short while before going to sleep since new tasks are often queued quickly.
+		if (spinCount < SPIN_COUNT)
+		{
+			++spinCount;
+			dsThread_yield();
+			continue;
+		}
+
+		waitForWork(threadPool, NULL);
+		spinCount = 0;
+	} while (true);
+
+	return 0;
+}
+
+static void stopThreads(dsThreadPool* threadPool)
+{
+	int32_t stop = true;
+	DS_ATOMIC_STORE32(&threadPool->stop, &stop);
+	DS_VERIFY(dsMutex_lock(threadPool->waitMutex));
+	DS_VERIFY(dsConditionVariable_notifyAll(threadPool->waitCondition));
+	DS_VERIFY(dsMutex_unlock(threadPool->waitMutex));
+
+	for (uint32_t i = 0; i < threadPool->threadCount; ++i)
+	{
+		Worker* worker = threadPool->workers + i;
+		if (worker->started)
+			DS_VERIFY(dsThread_join(&worker->thread, NULL));
+	}
+}
+
+dsThreadPool* dsThreadPool_create(dsAllocator* allocator, unsigned int threadCount,
+	unsigned int stackSize)
+{
+	if (!allocator)
+	{
+		errno = EINVAL;
+		return NULL;
+	}
+
+	if (!allocator->freeFunc)
+	{
+		errno = EINVAL;
+		DS_LOG_ERROR(DS_CORE_LOG_TAG, "Thread pool allocator must support freeing memory.");
+		return NULL;
+	}
+
+	size_t fullSize = DS_ALIGNED_SIZE(sizeof(dsThreadPool)) + dsMutex_fullAllocSize() +
+		dsConditionVariable_fullAllocSize() + DS_ALIGNED_SIZE(sizeof(Worker)*threadCount);
+	void* buffer = dsAllocator_alloc(allocator, fullSize);
+	if (!buffer)
+		return NULL;
+
+	// Zero the full buffer up front, which also covers the workers.
+	memset(buffer, 0, fullSize);
+	dsBufferAllocator bufferAlloc;
+	DS_VERIFY(dsBufferAllocator_initialize(&bufferAlloc, buffer, fullSize));
+
+	dsThreadPool* threadPool = DS_ALLOCATE_OBJECT(&bufferAlloc, dsThreadPool);
+	DS_ASSERT(threadPool);
+	threadPool->allocator = allocator;
+
+	if (!dsThreadStorage_initialize(&threadPool->currentWorker))
+	{
+		DS_VERIFY(dsAllocator_free(allocator, buffer));
+		return NULL;
+	}
+
+	DS_VERIFY(dsSpinlock_initialize(&threadPool->sharedLock));
+	threadPool->waitMutex = dsMutex_create((dsAllocator*)&bufferAlloc, "Thread Pool");
+	DS_ASSERT(threadPool->waitMutex);
+	threadPool->waitCondition = dsConditionVariable_create((dsAllocator*)&bufferAlloc,
+		"Thread Pool");
+	DS_ASSERT(threadPool->waitCondition);
+
+	if (threadCount > 0)
+	{
+		threadPool->workers = DS_ALLOCATE_OBJECT_ARRAY(&bufferAlloc, Worker, threadCount);
+		DS_ASSERT(threadPool->workers);
+	}
+	threadPool->threadCount = threadCount;
+
+	for (uint32_t i = 0; i < threadCount; ++i)
+	{
+		Worker* worker = threadPool->workers + i;
+		worker->threadPool = threadPool;
+		// xorshift requires a non-zero seed.
+		worker->randomState = i + 1;
+		if (!dsThread_create(&worker->thread, &workerThreadFunc, worker, stackSize,
+				"Thread Pool Worker"))
+		{
+			dsThreadPool_destroy(threadPool);
+			return NULL;
+		}
+		worker->started = true;
+	}
+
+	return threadPool;
+}
+
+unsigned int dsThreadPool_getThreadCount(const dsThreadPool* threadPool)
+{
+	if (!threadPool)
+		return 0;
+
+	return threadPool->threadCount;
+}
+
+bool dsThreadPool_isWorkerThread(const dsThreadPool* threadPool)
+{
+	if (!threadPool)
+		return false;
+
+	return dsThreadStorage_get(threadPool->currentWorker) != NULL;
+}
+
+bool dsThreadPool_executeTask(dsThreadPool* threadPool)
+{
+	if (!threadPool)
+		return false;
+
+	dsTaskGraphNode* task = findTask(threadPool,
+		(Worker*)dsThreadStorage_get(threadPool->currentWorker));
+	if (!task)
+		return false;
+
+	runTask(task);
+	return true;
+}
+
+void dsThreadPool_destroy(dsThreadPool* threadPool)
+{
+	if (!threadPool)
+		return;
+
+	stopThreads(threadPool);
+	DS_ASSERT(threadPool->sharedTaskCount == 0);
+
+	dsMutex_destroy(threadPool->waitMutex);
+	dsConditionVariable_destroy(threadPool->waitCondition);
+	dsSpinlock_shutdown(&threadPool->sharedLock);
+	dsThreadStorage_shutdown(&threadPool->currentWorker);
+	DS_VERIFY(dsAllocator_free(threadPool->allocator, threadPool->sharedTasks));
+	DS_VERIFY(dsAllocator_free(threadPool->allocator, threadPool));
+}
+
+void dsThreadPool_queueTask(dsThreadPool* threadPool, dsTaskGraphNode* task)
+{
+	Worker* worker = (Worker*)dsThreadStorage_get(threadPool->currentWorker);
+	if (!(worker && pushTask(&worker->queue, task)) && !pushSharedTask(threadPool, task))
+	{
+		// Nowhere to put the task, so execute it immediately.
+		runTask(task);
+		return;
+	}
+
+	DS_ATOMIC_FETCH_ADD32(&threadPool->queuedTasks, 1);
+	notifyWaiting(threadPool, false);
+}
+
+void dsThreadPool_waitForCounter(dsThreadPool* threadPool, const int32_t* counter)
+{
+	Worker* worker = (Worker*)dsThreadStorage_get(threadPool->currentWorker);
+	unsigned int spinCount = 0;
+	do
+	{
+		int32_t value;
+		DS_ATOMIC_LOAD32(counter, &value);
+		if (value <= 0)
+			return;
+
+		// Help execute tasks while waiting. These may be from other task graphs.
+		dsTaskGraphNode* task = findTask(threadPool, worker);
+		if (task)
+		{
+			runTask(task);
+			spinCount = 0;
+			continue;
+		}
+
+		if (spinCount < SPIN_COUNT)
+		{
+			++spinCount;
+			dsThread_yield();
+			continue;
+		}
+
+		waitForWork(threadPool, counter);
+		spinCount = 0;
+	} while (true);
+}
+
+void dsThreadPool_notifyCounter(dsThreadPool* threadPool)
+{
+	notifyWaiting(threadPool, true);
+}
@@ -0,0 +1,45 @@
+/*
+ * Copyright 2020 Aaron Barany
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <DeepSea/Core/Config.h>
+#include <DeepSea/Core/Thread/Types.h>
+
+typedef struct dsTaskGraphNode
+{
+	dsThreadTaskFunction function;
+	void* userData;
+	dsTaskGraph* taskGraph;
+
+	uint32_t firstDependent;
+	uint32_t dependentCount;
+	uint32_t dependencyCount;
+	int32_t remainingDependencies;
+} dsTaskGraphNode;
+
+// Queues a task that is ready to run. If the queue can't hold the task it will be executed
+// immediately.
+void dsThreadPool_queueTask(dsThreadPool* threadPool, dsTaskGraphNode* task);
+
+// Executes tasks until the counter reaches 0.
+void dsThreadPool_waitForCounter(dsThreadPool* threadPool, const int32_t* counter);
+
+// Wakes up any threads waiting on a counter after it has reached 0.
+void dsThreadPool_notifyCounter(dsThreadPool* threadPool);
+
+// Called after a task finished executing to queue any dependent tasks.
+void dsTaskGraph_finishTask(dsTaskGraphNode* task);
@@ -0,0 +1,294 @@
+/*
+ * Copyright 2020 Aaron Barany
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "Helpers.h"
+#include <DeepSea/Core/Memory/SystemAllocator.h>
+#include <DeepSea/Core/Streams/AsyncIO.h>
+#include <DeepSea/Core/Streams/FileStream.h>
+#include <DeepSea/Core/Streams/Path.h>
+#include <DeepSea/Core/Streams/ResourceStream.h>
+#include <DeepSea/Core/Thread/Thread.h>
+#include <DeepSea/Core/Atomic.h>
+#include <gtest/gtest.h>
+#include <stdio.h>
+#include <vector>
+
+namespace
+{
+
+struct Completion
+{
+	int32_t order;
+	dsAsyncIOResult result;
+	size_t readSize;
+	int errorCode;
+};
+
+struct CompletionData
+{
+	int32_t nextOrder;
+	int32_t release;
+	std::vector<Completion> completions;
+};
+
+struct CompletionRequest
+{
+	CompletionData* data;
+	uint32_t index;
+};
+
+void recordCompletion(void* userData, uint64_t, dsAsyncIOResult result, size_t readSize)
+{
+	CompletionRequest* request = (CompletionRequest*)userData;
+	Completion& completion = request->data->completions[request->index];
+	completion.errorCode = result == dsAsyncIOResult_Failed ? errno : 0;
+	completion.order = DS_ATOMIC_FETCH_ADD32(&request->data->nextOrder, 1);
+	completion.result = result;
+	completion.readSize = readSize;
+}
+
+void blockUntilReleased(void* userData, uint64_t requestID, dsAsyncIOResult result,
+	size_t readSize)
+{
+	CompletionRequest* request = (CompletionRequest*)userData;
+	int32_t release;
+	do
+	{
+		dsThread_yield();
+		DS_ATOMIC_LOAD32(&request->data->release, &release);
+	} while (!release);
+	recordCompletion(userData, requestID, result, readSize);
+}
+
+} // namespace
+
+class AsyncIOTest : public testing::Test
+{
+public:
+	void SetUp() override
+	{
+		ASSERT_TRUE(dsSystemAllocator_initialize(&allocator, DS_ALLOCATOR_NO_LIMIT));
+		ASSERT_TRUE(dsPath_combine(path, sizeof(path),
+			dsResourceStream_getDirectory(dsFileResourceType_Dynamic), "asyncIO"));
+
+		for (uint32_t i = 0; i < DS_ARRAY_SIZE(values); ++i)
+			values[i] = (int32_t)i;
+
+		dsFileStream stream;
+		ASSERT_TRUE(dsFileStream_openPath(&stream, path, "wb"));
+		EXPECT_EQ(sizeof(values), dsFileStream_write(&stream, values, sizeof(values)));
+		EXPECT_TRUE(dsFileStream_close(&stream));
+	}
+
+	void TearDown() override
+	{
+		EXPECT_EQ(0, remove(path));
+		EXPECT_EQ(0U, ((dsAllocator*)&allocator)->size);
+	}
+
+	dsAsyncIORequest createRequest(void* destination, uint32_t first, uint32_t count,
+		CompletionRequest* completion)
+	{
+		dsAsyncIORequest request = {};
+		request.filePath = path;
+		request.offset = first*sizeof(int32_t);
+		request.size = count*sizeof(int32_t);
+		request.destination = destination;
+		request.priority = dsAsyncIOPriority_Normal;
+		request.completeFunc = &recordCompletion;
+		request.userData = completion;
+		return request;
+	}
+
+	dsSystemAllocator allocator;
+	char path[DS_PATH_MAX];
+	int32_t values[1024];
+};
+
+TEST_F(AsyncIOTest, Create)
+{
+	EXPECT_NULL_ERRNO(EINVAL, dsAsyncIO_create(NULL, 1, 0));
+	EXPECT_NULL_ERRNO(EINVAL, dsAsyncIO_create((dsAllocator*)&allocator, 0, 0));
+
+	dsAsyncIO* asyncIO = dsAsyncIO_create((dsAllocator*)&allocator, 2, 0);
+	ASSERT_TRUE(asyncIO);
+	EXPECT_EQ(2U, dsAsyncIO_getThreadCount(asyncIO));
+	EXPECT_TRUE(dsAsyncIO_waitUntilIdle(asyncIO));
+	dsAsyncIO_destroy(asyncIO);
+}
+
+TEST_F(AsyncIOTest, ReadFile)
+{
+	dsAsyncIO* asyncIO = dsAsyncIO_create((dsAllocator*)&allocator, 4, 0);
+	ASSERT_TRUE(asyncIO);
+
+	const uint32_t requestCount = 16;
+	const uint32_t valuesPerRequest = DS_ARRAY_SIZE(values)/requestCount;
+	CompletionData data = {};
+	data.completions.resize(requestCount + 2);
+	CompletionRequest completions[requestCount + 2];
+	int32_t readValues[DS_ARRAY_SIZE(values)] = {};
+
+	EXPECT_EQ_ERRNO(EINVAL, DS_NO_ASYNC_IO_REQUEST, dsAsyncIO_queueRead(asyncIO, NULL));
+	dsAsyncIORequest request = createRequest(readValues, 0, 1, NULL);
+	request.filePath = NULL;
+	EXPECT_EQ_ERRNO(EINVAL, DS_NO_ASYNC_IO_REQUEST, dsAsyncIO_queueRead(asyncIO, &request));
+
+	for (uint32_t i = 0; i < requestCount; ++i)
+	{
+		completions[i].data = &data;
+		completions[i].index = i;
+		request = createRequest(readValues + i*valuesPerRequest, i*valuesPerRequest,
+			valuesPerRequest, completions + i);
+		EXPECT_NE(DS_NO_ASYNC_IO_REQUEST, dsAsyncIO_queueRead(asyncIO, &request));
+	}
+
+	// Read past the end of the file.
+	int32_t lastValues[4] = {};
+	completions[requestCount].data = &data;
+	completions[requestCount].index = requestCount;
+	request = createRequest(lastValues, DS_ARRAY_SIZE(values) - 2, DS_ARRAY_SIZE(lastValues),
+		completions + requestCount);
+	uint64_t lastRequest = dsAsyncIO_queueRead(asyncIO, &request);
+	EXPECT_NE(DS_NO_ASYNC_IO_REQUEST, lastRequest);
+
+	// Missing file.
+	char missingPath[DS_PATH_MAX];
+	ASSERT_TRUE(dsPath_combine(missingPath, sizeof(missingPath),
+		dsResourceStream_getDirectory(dsFileResourceType_Dynamic), "doesNotExist"));
+	completions[requestCount + 1].data = &data;
+	completions[requestCount + 1].index = requestCount + 1;
+	request = createRequest(lastValues, 0, 1, completions + requestCount + 1);
+	request.filePath = missingPath;
+	uint64_t missingRequest = dsAsyncIO_queueRead(asyncIO, &request);
+	EXPECT_NE(DS_NO_ASYNC_IO_REQUEST, missingRequest);
+
+	EXPECT_TRUE(dsAsyncIO_waitForRequest(asyncIO, lastRequest));
+	EXPECT_EQ(dsAsyncIOResult_Success, data.completions[requestCount].result);
+	EXPECT_EQ(2*sizeof(int32_t), data.completions[requestCount].readSize);
+	EXPECT_EQ(values[DS_ARRAY_SIZE(values) - 2], lastValues[0]);
+	EXPECT_EQ(values[DS_ARRAY_SIZE(values) - 1], lastValues[1]);
+
+	EXPECT_TRUE(dsAsyncIO_waitUntilIdle(asyncIO));
+	for (uint32_t i = 0; i < requestCount; ++i)
+	{
+		EXPECT_EQ(dsAsyncIOResult_Success, data.completions[i].result);
+		EXPECT_EQ(valuesPerRequest*sizeof(int32_t), data.completions[i].readSize);
+	}
+	for (uint32_t i = 0; i < DS_ARRAY_SIZE(values); ++i)
+		EXPECT_EQ(values[i], readValues[i]);
+
+	EXPECT_EQ(dsAsyncIOResult_Failed, data.completions[requestCount + 1].result);
+	EXPECT_EQ(ENOENT, data.completions[requestCount + 1].errorCode);
+	EXPECT_FALSE_ERRNO(ENOTFOUND, dsAsyncIO_cancel(asyncIO, missingRequest));
+	EXPECT_EQ(requestCount + 2, (uint32_t)data.nextOrder);
+
+	dsAsyncIO_destroy(asyncIO);
+}
+
+TEST_F(AsyncIOTest, Priority)
+{
+	dsAsyncIO* asyncIO = dsAsyncIO_create((dsAllocator*)&allocator, 1, 0);
+	ASSERT_TRUE(asyncIO);
+
+	const dsAsyncIOPriority priorities[] =
+	{
+		dsAsyncIOPriority_Normal, dsAsyncIOPriority_Low, dsAsyncIOPriority_High,
+		dsAsyncIOPriority_Normal, dsAsyncIOPriority_High, dsAsyncIOPriority_Low
+	};
+	const int32_t expectedOrder[] = {3, 5, 1, 4, 2, 6};
+	const uint32_t requestCount = DS_ARRAY_SIZE(priorities);
+
+	CompletionData data = {};
+	data.completions.resize(requestCount + 1);
+	CompletionRequest completions[requestCount + 1];
+	int32_t readValues[requestCount + 1];
+
+	// Block the only thread so that the rest of the requests are queued together. This is high
+	// priority so it's guaranteed to be executed first even if the thread hasn't woken up yet.
+	completions[0].data = &data;
+	completions[0].index = 0;
+	dsAsyncIORequest request = createRequest(readValues, 0, 1, completions);
+	request.priority = dsAsyncIOPriority_High;
+	request.completeFunc = &blockUntilReleased;
+	EXPECT_NE(DS_NO_ASYNC_IO_REQUEST, dsAsyncIO_queueRead(asyncIO, &request));
+
+	for (uint32_t i = 0; i < requestCount; ++i)
+	{
+		completions[i + 1].data = &data;
+		completions[i + 1].index = i + 1;
+		request = createRequest(readValues + i + 1, i + 1, 1, completions + i + 1);
+		request.priority = priorities[i];
+		EXPECT_NE(DS_NO_ASYNC_IO_REQUEST, dsAsyncIO_queueRead(asyncIO, &request));
+	}
+
+	int32_t release = true;
+	DS_ATOMIC_STORE32(&data.release, &release);
+	EXPECT_TRUE(dsAsyncIO_waitUntilIdle(asyncIO));
+
+	EXPECT_EQ(0, data.completions[0].order);
+	for (uint32_t i = 0; i < requestCount; ++i)
+	{
+		EXPECT_EQ(expectedOrder[i], data.completions[i + 1].order) << i;
+		EXPECT_EQ(values[i + 1], readValues[i + 1]);
+	}
+
+	dsAsyncIO_destroy(asyncIO);
+}
+
+TEST_F(AsyncIOTest, Cancel)
+{
+	dsAsyncIO* asyncIO = dsAsyncIO_create((dsAllocator*)&allocator, 1, 0);
+	ASSERT_TRUE(asyncIO);
+
+	const uint32_t requestCount = 4;
+	CompletionData data = {};
+	data.completions.resize(requestCount);
+	CompletionRequest completions[requestCount];
+	int32_t readValues[requestCount];
+	uint64_t requestIDs[requestCount];
+
+	for (uint32_t i = 0; i < requestCount; ++i)
+	{
+		completions[i].data = &data;
+		completions[i].index = i;
+		dsAsyncIORequest request = createRequest(readValues + i, i, 1, completions + i);
+		if (i == 0)
+			request.completeFunc = &blockUntilReleased;
+		requestIDs[i] = dsAsyncIO_queueRead(asyncIO, &request);
+		EXPECT_NE(DS_NO_ASYNC_IO_REQUEST, requestIDs[i]);
+	}
+
+	EXPECT_FALSE_ERRNO(EINVAL, dsAsyncIO_cancel(asyncIO, DS_NO_ASYNC_IO_REQUEST));
+	EXPECT_TRUE(dsAsyncIO_cancel(asyncIO, requestIDs[2]));
+	EXPECT_EQ(dsAsyncIOResult_Canceled, data.completions[2].result);
+	EXPECT_FALSE_ERRNO(ENOTFOUND, dsAsyncIO_cancel(asyncIO, requestIDs[2]));
+
+	// Waiting on a canceled request returns immediately.
+	EXPECT_TRUE(dsAsyncIO_waitForRequest(asyncIO, requestIDs[2]));
+
+	// Destroying cancels the remaining requests that haven't started.
+	int32_t release = true;
+	DS_ATOMIC_STORE32(&data.release, &release);
+	EXPECT_TRUE(dsAsyncIO_waitForRequest(asyncIO, requestIDs[0]));
+	EXPECT_EQ(dsAsyncIOResult_Success, data.completions[0].result);
+	EXPECT_EQ(values[0], readValues[0]);
+	dsAsyncIO_destroy(asyncIO);
+
+	EXPECT_EQ(requestCount, (uint32_t)data.nextOrder);
+	EXPECT_NE(dsAsyncIOResult_Failed, data.completions[1].result);
+	EXPECT_NE(dsAsyncIOResult_Failed, data.completions[3].result);
+}
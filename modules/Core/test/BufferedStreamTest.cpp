@@ -0,0 +1,232 @@
+/*
+ * Copyright 2020 Aaron Barany
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "Helpers.h"
+#include <DeepSea/Core/Streams/BufferedStream.h>
+#include <DeepSea/Core/Streams/MemoryStream.h>
+#include <DeepSea/Core/Streams/Stream.h>
+#include <gtest/gtest.h>
+
+namespace
+{
+
+// Memory stream that counts the number of reads made to it.
+struct CountingStream
+{
+	dsMemoryStream memoryStream;
+	unsigned int readCount;
+};
+
+size_t countingRead(dsStream* stream, void* data, size_t size)
+{
+	++((CountingStream*)stream)->readCount;
+	return dsMemoryStream_read((dsMemoryStream*)stream, data, size);
+}
+
+void openCountingStream(CountingStream* stream, void* buffer, size_t size)
+{
+	ASSERT_TRUE(dsMemoryStream_open(&stream->memoryStream, buffer, size));
+	((dsStream*)stream)->readFunc = &countingRead;
+	stream->readCount = 0;
+}
+
+} // namespace
+
+TEST(BufferedStream, Null)
+{
+	int32_t dummyData;
+	EXPECT_EQ_ERRNO(EINVAL, 0U, dsBufferedStream_read(NULL, &dummyData, sizeof(dummyData)));
+	EXPECT_FALSE_ERRNO(EINVAL, dsBufferedStream_seek(NULL, 0, dsStreamSeekWay_Beginning));
+	EXPECT_EQ_ERRNO(EINVAL, DS_STREAM_INVALID_POS, dsBufferedStream_tell(NULL));
+	EXPECT_FALSE_ERRNO(EINVAL, dsBufferedStream_close(NULL));
+}
+
+TEST(BufferedStream, InvalidOpen)
+{
+	dsBufferedStream stream = {};
+	dsMemoryStream baseStream;
+	int32_t values[4];
+	uint8_t buffer[16];
+	ASSERT_TRUE(dsMemoryStream_open(&baseStream, values, sizeof(values)));
+
+	EXPECT_FALSE_ERRNO(EINVAL, dsBufferedStream_open(NULL, (dsStream*)&baseStream, buffer,
+		sizeof(buffer)));
+	EXPECT_FALSE_ERRNO(EINVAL, dsBufferedStream_open(&stream, NULL, buffer, sizeof(buffer)));
+	EXPECT_FALSE_ERRNO(EINVAL, dsBufferedStream_open(&stream, (dsStream*)&baseStream, NULL,
+		sizeof(buffer)));
+	EXPECT_FALSE_ERRNO(EINVAL, dsBufferedStream_open(&stream, (dsStream*)&baseStream, buffer, 0));
+}
+
+TEST(BufferedStream, SmallReads)
+{
+	int32_t values[100];
+	for (unsigned int i = 0; i < DS_ARRAY_SIZE(values); ++i)
+		values[i] = (int32_t)i;
+
+	CountingStream baseStream;
+	openCountingStream(&baseStream, values, sizeof(values));
+
+	dsBufferedStream stream;
+	uint8_t buffer[64];
+	ASSERT_TRUE(dsBufferedStream_open(&stream, (dsStream*)&baseStream, buffer, sizeof(buffer)));
+	EXPECT_FALSE(((dsStream*)&stream)->writeFunc);
+
+	for (unsigned int i = 0; i < DS_ARRAY_SIZE(values); ++i)
+	{
+		int32_t value;
+		ASSERT_EQ(sizeof(value), dsStream_read((dsStream*)&stream, &value, sizeof(value)));
+		EXPECT_EQ(values[i], value);
+		EXPECT_EQ((i + 1)*sizeof(value), dsStream_tell((dsStream*)&stream));
+	}
+
+	int32_t value;
+	EXPECT_EQ(0U, dsStream_read((dsStream*)&stream, &value, sizeof(value)));
+
+	// Each read from the base stream fills the full buffer.
+	EXPECT_EQ((sizeof(values) + sizeof(buffer) - 1)/sizeof(buffer) + 1, baseStream.readCount);
+	EXPECT_TRUE(dsStream_close((dsStream*)&stream));
+}
+
+TEST(BufferedStream, LargeReads)
+{
+	int32_t values[100];
+	for (unsigned int i = 0; i < DS_ARRAY_SIZE(values); ++i)
+		values[i] = (int32_t)i;
+
+	CountingStream baseStream;
+	openCountingStream(&baseStream, values, sizeof(values));
+
+	dsBufferedStream stream;
+	uint8_t buffer[16];
+	ASSERT_TRUE(dsBufferedStream_open(&stream, (dsStream*)&baseStream, buffer, sizeof(buffer)));
+
+	int32_t value;
+	EXPECT_EQ(sizeof(value), dsStream_read((dsStream*)&stream, &value, sizeof(value)));
+	EXPECT_EQ(0, value);
+	EXPECT_EQ(1U, baseStream.readCount);
+
+	// Drains the buffer, then reads the rest directly.
+	int32_t readValues[50];
+	EXPECT_EQ(sizeof(readValues), dsStream_read((dsStream*)&stream, readValues,
+		sizeof(readValues)));
+	EXPECT_EQ(2U, baseStream.readCount);
+	for (unsigned int i = 0; i < DS_ARRAY_SIZE(readValues); ++i)
+		EXPECT_EQ(values[i + 1], readValues[i]);
+
+	// Reads past the end.
+	EXPECT_EQ(sizeof(values) - sizeof(readValues) - sizeof(value), dsStream_read(
+		(dsStream*)&stream, readValues, sizeof(readValues)));
+	EXPECT_EQ(values[DS_ARRAY_SIZE(values) - 1],
+		readValues[DS_ARRAY_SIZE(values) - DS_ARRAY_SIZE(readValues) - 2]);
+	EXPECT_TRUE(dsStream_close((dsStream*)&stream));
+}
+
+TEST(BufferedStream, Seek)
+{
+	int32_t values[100];
+	for (unsigned int i = 0; i < DS_ARRAY_SIZE(values); ++i)
+		values[i] = (int32_t)i;
+
+	CountingStream baseStream;
+	openCountingStream(&baseStream, values, sizeof(values));
+
+	dsBufferedStream stream;
+	uint8_t buffer[32];
+	ASSERT_TRUE(dsBufferedStream_open(&stream, (dsStream*)&baseStream, buffer, sizeof(buffer)));
+
+	int32_t value;
+	EXPECT_EQ(sizeof(value), dsStream_read((dsStream*)&stream, &value, sizeof(value)));
+	EXPECT_EQ(0, value);
+
+	// Seeking within the buffer doesn't touch the base stream.
+	EXPECT_EQ(sizeof(int32_t)*2, dsStream_skip((dsStream*)&stream, sizeof(int32_t)*2));
+	EXPECT_EQ(sizeof(value), dsStream_read((dsStream*)&stream, &value, sizeof(value)));
+	EXPECT_EQ(3, value);
+	EXPECT_TRUE(dsStream_seek((dsStream*)&stream, -(int64_t)sizeof(int32_t)*3,
+		dsStreamSeekWay_Current));
+	EXPECT_EQ(sizeof(value), dsStream_read((dsStream*)&stream, &value, sizeof(value)));
+	EXPECT_EQ(1, value);
+	EXPECT_EQ(1U, baseStream.readCount);
+
+	// Seeking past the buffer.
+	EXPECT_TRUE(dsStream_seek((dsStream*)&stream, sizeof(int32_t)*20, dsStreamSeekWay_Current));
+	EXPECT_EQ(22*sizeof(int32_t), dsStream_tell((dsStream*)&stream));
+	EXPECT_EQ(sizeof(value), dsStream_read((dsStream*)&stream, &value, sizeof(value)));
+	EXPECT_EQ(22, value);
+
+	EXPECT_TRUE(dsStream_seek((dsStream*)&stream, sizeof(int32_t)*5, dsStreamSeekWay_Beginning));
+	EXPECT_EQ(sizeof(value), dsStream_read((dsStream*)&stream, &value, sizeof(value)));
+	EXPECT_EQ(5, value);
+
+	EXPECT_TRUE(dsStream_seek((dsStream*)&stream, -(int64_t)sizeof(int32_t), dsStreamSeekWay_End));
+	EXPECT_EQ(sizeof(value), dsStream_read((dsStream*)&stream, &value, sizeof(value)));
+	EXPECT_EQ(99, value);
+	EXPECT_FALSE(dsStream_seek((dsStream*)&stream, -1, dsStreamSeekWay_Beginning));
+
+	// Closing moves the base stream back to the buffered position.
+	EXPECT_TRUE(dsStream_seek((dsStream*)&stream, sizeof(int32_t)*10, dsStreamSeekWay_Beginning));
+	EXPECT_EQ(sizeof(value), dsStream_read((dsStream*)&stream, &value, sizeof(value)));
+	EXPECT_EQ(10, value);
+	EXPECT_LT(11*sizeof(int32_t), dsStream_tell((dsStream*)&baseStream));
+	EXPECT_TRUE(dsStream_close((dsStream*)&stream));
+	EXPECT_EQ(11*sizeof(int32_t), dsStream_tell((dsStream*)&baseStream));
+	EXPECT_FALSE_ERRNO(EINVAL, dsBufferedStream_close(&stream));
+}
+
+TEST(BufferedStream, Readv)
+{
+	int32_t values[100];
+	for (unsigned int i = 0; i < DS_ARRAY_SIZE(values); ++i)
+		values[i] = (int32_t)i;
+
+	CountingStream baseStream;
+	openCountingStream(&baseStream, values, sizeof(values));
+
+	dsBufferedStream stream;
+	uint8_t buffer[DS_DEFAULT_STREAM_BUFFER_SIZE];
+	ASSERT_TRUE(dsBufferedStream_open(&stream, (dsStream*)&baseStream, buffer, sizeof(buffer)));
+
+	int32_t first, second[3], third[2];
+	dsStreamBuffer buffers[] =
+	{
+		{&first, sizeof(first)},
+		{NULL, 0},
+		{second, sizeof(second)},
+		{third, sizeof(third)}
+	};
+	EXPECT_EQ_ERRNO(EINVAL, 0U, dsStream_readv(NULL, buffers, DS_ARRAY_SIZE(buffers)));
+	EXPECT_EQ_ERRNO(EINVAL, 0U, dsStream_readv((dsStream*)&stream, NULL, 1));
+	EXPECT_EQ(0U, dsStream_readv((dsStream*)&stream, NULL, 0));
+
+	EXPECT_EQ(sizeof(int32_t)*6, dsStream_readv((dsStream*)&stream, buffers,
+		DS_ARRAY_SIZE(buffers)));
+	EXPECT_EQ(0, first);
+	EXPECT_EQ(1, second[0]);
+	EXPECT_EQ(2, second[1]);
+	EXPECT_EQ(3, second[2]);
+	EXPECT_EQ(4, third[0]);
+	EXPECT_EQ(5, third[1]);
+	EXPECT_EQ(1U, baseStream.readCount);
+
+	// Stops at the end of the stream.
+	EXPECT_TRUE(dsStream_seek((dsStream*)&stream, -(int64_t)sizeof(int32_t)*2,
+		dsStreamSeekWay_End));
+	EXPECT_EQ(sizeof(int32_t)*2, dsStream_readv((dsStream*)&stream, buffers,
+		DS_ARRAY_SIZE(buffers)));
+	EXPECT_EQ(98, first);
+	EXPECT_EQ(99, second[0]);
+	EXPECT_TRUE(dsStream_close((dsStream*)&stream));
+}
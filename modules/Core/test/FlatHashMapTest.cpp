@@ -0,0 +1,373 @@
+/*
+ * Copyright 2020 Aaron Barany
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "Helpers.h"
+#include <DeepSea/Core/Containers/FlatHashMap.h>
+#include <DeepSea/Core/Containers/Hash.h>
+#include <DeepSea/Core/Containers/HashTable.h>
+#include <DeepSea/Core/Memory/Allocator.h>
+#include <DeepSea/Core/Memory/SystemAllocator.h>
+#include <DeepSea/Core/Timer.h>
+#include <gtest/gtest.h>
+#include <algorithm>
+#include <random>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace
+{
+
+struct HashTableNode
+{
+	dsHashTableNode node;
+	uint64_t key;
+	uint64_t value;
+};
+
+} // namespace
+
+class FlatHashMapTest : public testing::Test
+{
+public:
+	void SetUp() override
+	{
+		ASSERT_TRUE(dsSystemAllocator_initialize(&allocator, DS_ALLOCATOR_NO_LIMIT));
+	}
+
+	void TearDown() override
+	{
+		EXPECT_EQ(0U, ((dsAllocator*)&allocator)->size);
+	}
+
+	dsSystemAllocator allocator;
+};
+
+TEST_F(FlatHashMapTest, Initialize)
+{
+	dsFlatHashMap hashMap;
+	EXPECT_FALSE_ERRNO(EINVAL, dsFlatHashMap_initialize(nullptr, (dsAllocator*)&allocator,
+		sizeof(uint32_t), sizeof(uint32_t), nullptr, nullptr));
+	EXPECT_FALSE_ERRNO(EINVAL, dsFlatHashMap_initialize(&hashMap, nullptr, sizeof(uint32_t),
+		sizeof(uint32_t), nullptr, nullptr));
+	EXPECT_FALSE_ERRNO(EINVAL, dsFlatHashMap_initialize(&hashMap, (dsAllocator*)&allocator, 0,
+		sizeof(uint32_t), nullptr, nullptr));
+
+	EXPECT_TRUE(dsFlatHashMap_initialize(&hashMap, (dsAllocator*)&allocator, sizeof(uint32_t),
+		sizeof(uint32_t), nullptr, nullptr));
+	EXPECT_EQ(4U, hashMap.keyOffset);
+	EXPECT_EQ(8U, hashMap.valueOffset);
+	EXPECT_EQ(12U, hashMap.entrySize);
+	dsFlatHashMap_shutdown(&hashMap);
+
+	EXPECT_TRUE(dsFlatHashMap_initialize(&hashMap, (dsAllocator*)&allocator, 0, 3,
+		&dsHashString, &dsHashStringEqual));
+	EXPECT_EQ(sizeof(void*), hashMap.keyOffset);
+	EXPECT_EQ(sizeof(void*)*2, hashMap.valueOffset);
+	EXPECT_EQ(sizeof(void*)*3, hashMap.entrySize);
+	dsFlatHashMap_shutdown(&hashMap);
+}
+
+TEST_F(FlatHashMapTest, InsertFindRemove)
+{
+	dsFlatHashMap hashMap;
+	ASSERT_TRUE(dsFlatHashMap_initialize(&hashMap, (dsAllocator*)&allocator, sizeof(uint32_t),
+		sizeof(uint64_t), &dsHash32, &dsHash32Equal));
+
+	uint32_t key = 1;
+	EXPECT_EQ(nullptr, dsFlatHashMap_find(&hashMap, &key));
+
+	const uint32_t count = 1000;
+	for (uint32_t i = 0; i < count; ++i)
+	{
+		uint64_t value = i*10;
+		auto insertedValue = reinterpret_cast<uint64_t*>(dsFlatHashMap_insert(&hashMap, &i,
+			&value));
+		ASSERT_NE(nullptr, insertedValue);
+		EXPECT_EQ(0U, (uintptr_t)insertedValue % sizeof(uint64_t));
+		EXPECT_EQ(value, *insertedValue);
+	}
+	EXPECT_EQ(count, hashMap.length);
+
+	key = 10;
+	EXPECT_NULL_ERRNO(EPERM, dsFlatHashMap_insert(&hashMap, &key, nullptr));
+
+	for (uint32_t i = 0; i < count; ++i)
+	{
+		auto value = reinterpret_cast<uint64_t*>(dsFlatHashMap_find(&hashMap, &i));
+		ASSERT_NE(nullptr, value);
+		EXPECT_EQ(i*10, *value);
+	}
+
+	key = count;
+	EXPECT_EQ(nullptr, dsFlatHashMap_find(&hashMap, &key));
+	EXPECT_FALSE_ERRNO(ENOTFOUND, dsFlatHashMap_remove(&hashMap, &key));
+
+	for (uint32_t i = 0; i < count; i += 2)
+		EXPECT_TRUE(dsFlatHashMap_remove(&hashMap, &i));
+	EXPECT_EQ(count/2, hashMap.length);
+
+	for (uint32_t i = 0; i < count; ++i)
+	{
+		auto value = reinterpret_cast<uint64_t*>(dsFlatHashMap_find(&hashMap, &i));
+		if (i % 2 == 0)
+			EXPECT_EQ(nullptr, value);
+		else
+		{
+			ASSERT_NE(nullptr, value);
+			EXPECT_EQ(i*10, *value);
+		}
+	}
+
+	// Value is zero-initialized when not provided.
+	key = 0;
+	auto value = reinterpret_cast<uint64_t*>(dsFlatHashMap_insert(&hashMap, &key, nullptr));
+	ASSERT_NE(nullptr, value);
+	EXPECT_EQ(0U, *value);
+
+	dsFlatHashMap_clear(&hashMap);
+	EXPECT_EQ(0U, hashMap.length);
+	key = 1;
+	EXPECT_EQ(nullptr, dsFlatHashMap_find(&hashMap, &key));
+
+	dsFlatHashMap_shutdown(&hashMap);
+}
+
+TEST_F(FlatHashMapTest, PointerKeys)
+{
+	dsFlatHashMap hashMap;
+	ASSERT_TRUE(dsFlatHashMap_initialize(&hashMap, (dsAllocator*)&allocator, 0, sizeof(int),
+		&dsHashString, &dsHashStringEqual));
+
+	int value = 1;
+	EXPECT_TRUE(dsFlatHashMap_insert(&hashMap, "one", &value));
+	value = 2;
+	EXPECT_TRUE(dsFlatHashMap_insert(&hashMap, "two", &value));
+	EXPECT_NULL_ERRNO(EPERM, dsFlatHashMap_insert(&hashMap, "two", &value));
+
+	// Looked up with a different pointer to the same string.
+	char key[] = "one";
+	auto foundValue = reinterpret_cast<int*>(dsFlatHashMap_find(&hashMap, key));
+	ASSERT_NE(nullptr, foundValue);
+	EXPECT_EQ(1, *foundValue);
+
+	EXPECT_TRUE(dsFlatHashMap_remove(&hashMap, key));
+	EXPECT_EQ(nullptr, dsFlatHashMap_find(&hashMap, "one"));
+	EXPECT_TRUE(dsFlatHashMap_find(&hashMap, "two"));
+
+	dsFlatHashMap_shutdown(&hashMap);
+}
+
+TEST_F(FlatHashMapTest, Iterate)
+{
+	dsFlatHashMap hashMap;
+	ASSERT_TRUE(dsFlatHashMap_initialize(&hashMap, (dsAllocator*)&allocator, sizeof(uint16_t), 0,
+		nullptr, nullptr));
+	EXPECT_TRUE(dsFlatHashMap_reserve(&hashMap, 100));
+
+	uint32_t index = 0;
+	EXPECT_FALSE(dsFlatHashMap_next(&index, nullptr, nullptr, &hashMap));
+
+	for (uint16_t i = 0; i < 50; ++i)
+		EXPECT_TRUE(dsFlatHashMap_insert(&hashMap, &i, nullptr));
+
+	bool found[50] = {};
+	unsigned int foundCount = 0;
+	const void* key;
+	index = 0;
+	while (dsFlatHashMap_next(&index, &key, nullptr, &hashMap))
+	{
+		uint16_t keyValue = *reinterpret_cast<const uint16_t*>(key);
+		ASSERT_LT(keyValue, 50U);
+		EXPECT_FALSE(found[keyValue]);
+		found[keyValue] = true;
+		++foundCount;
+	}
+	EXPECT_EQ(50U, foundCount);
+
+	dsFlatHashMap_shutdown(&hashMap);
+}
+
+TEST_F(FlatHashMapTest, RandomOperations)
+{
+	dsFlatHashMap hashMap;
+	ASSERT_TRUE(dsFlatHashMap_initialize(&hashMap, (dsAllocator*)&allocator, sizeof(uint32_t),
+		sizeof(uint32_t), nullptr, nullptr));
+
+	std::mt19937 random(789);
+	std::unordered_map<uint32_t, uint32_t> expected;
+	for (unsigned int i = 0; i < 20000; ++i)
+	{
+		uint32_t key = (uint32_t)(random() % 2000);
+		uint32_t value = (uint32_t)random();
+		if (random() % 3 == 0)
+			EXPECT_EQ(expected.erase(key) != 0, dsFlatHashMap_remove(&hashMap, &key));
+		else if (expected.emplace(key, value).second)
+			EXPECT_TRUE(dsFlatHashMap_insert(&hashMap, &key, &value));
+		else
+			EXPECT_FALSE(dsFlatHashMap_insert(&hashMap, &key, &value));
+	}
+
+	EXPECT_EQ(expected.size(), hashMap.length);
+	for (uint32_t key = 0; key < 2000; ++key)
+	{
+		auto value = reinterpret_cast<uint32_t*>(dsFlatHashMap_find(&hashMap, &key));
+		auto it = expected.find(key);
+		if (it == expected.end())
+			EXPECT_EQ(nullptr, value);
+		else
+		{
+			ASSERT_NE(nullptr, value);
+			EXPECT_EQ(it->second, *value);
+		}
+	}
+
+	dsFlatHashMap_shutdown(&hashMap);
+}
+
+TEST_F(FlatHashMapTest, UInt64Keys)
+{
+	// 64-bit keys without hash or equality functions use the specialized inline path.
+	dsFlatHashMap hashMap;
+	ASSERT_TRUE(dsFlatHashMap_initialize(&hashMap, (dsAllocator*)&allocator, sizeof(uint64_t),
+		sizeof(uint32_t), nullptr, nullptr));
+
+	std::mt19937_64 random(456);
+	std::unordered_map<uint64_t, uint32_t> expected;
+	for (unsigned int i = 0; i < 20000; ++i)
+	{
+		// Use the high bits to make sure they contribute to the hash.
+		uint64_t key = (random() % 2000) << 40;
+		uint32_t value = (uint32_t)random();
+		if (random() % 3 == 0)
+			EXPECT_EQ(expected.erase(key) != 0, dsFlatHashMap_remove(&hashMap, &key));
+		else if (expected.emplace(key, value).second)
+			EXPECT_TRUE(dsFlatHashMap_insert(&hashMap, &key, &value));
+		else
+			EXPECT_FALSE_ERRNO(EPERM, dsFlatHashMap_insert(&hashMap, &key, &value));
+	}
+
+	EXPECT_EQ(expected.size(), hashMap.length);
+	for (uint64_t i = 0; i < 2000; ++i)
+	{
+		uint64_t key = i << 40;
+		auto value = reinterpret_cast<uint32_t*>(dsFlatHashMap_find(&hashMap, &key));
+		auto it = expected.find(key);
+		if (it == expected.end())
+			EXPECT_EQ(nullptr, value);
+		else
+		{
+			ASSERT_NE(nullptr, value);
+			EXPECT_EQ(it->second, *value);
+		}
+	}
+
+	dsFlatHashMap_shutdown(&hashMap);
+}
+
+static void benchmarkFlatHashMap(double& outInsertTime, double& outFindTime, uint64_t& outSum,
+	dsAllocator* allocator, const std::vector<uint64_t>& keys,
+	const std::vector<uint64_t>& findKeys, dsHashFunction hashFunc,
+	dsKeysEqualFunction keysEqualFunc)
+{
+	dsTimer timer = dsTimer_create();
+	dsFlatHashMap hashMap;
+	ASSERT_TRUE(dsFlatHashMap_initialize(&hashMap, allocator, sizeof(uint64_t), sizeof(uint64_t),
+		hashFunc, keysEqualFunc));
+	ASSERT_TRUE(dsFlatHashMap_reserve(&hashMap, (uint32_t)keys.size()));
+
+	double start = dsTimer_time(timer);
+	for (uint32_t i = 0; i < keys.size(); ++i)
+	{
+		uint64_t value = i;
+		dsFlatHashMap_insert(&hashMap, &keys[i], &value);
+	}
+	outInsertTime = dsTimer_time(timer) - start;
+
+	start = dsTimer_time(timer);
+	outSum = 0;
+	for (uint64_t key : findKeys)
+		outSum += *(uint64_t*)dsFlatHashMap_find(&hashMap, &key);
+	outFindTime = dsTimer_time(timer) - start;
+	dsFlatHashMap_shutdown(&hashMap);
+}
+
+// Compares against dsHashTable. Disabled by default since it's a benchmark; run with
+// --gtest_also_run_disabled_tests and --gtest_output=xml to see the recorded times.
+TEST_F(FlatHashMapTest, DISABLED_HashTableBenchmark)
+{
+	dsTimer timer = dsTimer_create();
+	std::mt19937_64 random(1234);
+	for (uint32_t count = 1000; count <= 1000000; count *= 10)
+	{
+		std::vector<uint64_t> keys(count);
+		for (uint64_t& key : keys)
+			key = random();
+
+		// Look up in a different order than inserted so node accesses aren't sequential.
+		std::vector<uint64_t> findKeys(keys);
+		std::shuffle(findKeys.begin(), findKeys.end(), random);
+
+		// Chained hash table with externally allocated nodes.
+		uint32_t tableSize = dsHashTable_getTableSize(count);
+		dsHashTable* hashTable = reinterpret_cast<dsHashTable*>(dsAllocator_alloc(
+			(dsAllocator*)&allocator, dsHashTable_sizeof(tableSize)));
+		ASSERT_TRUE(hashTable);
+		ASSERT_TRUE(dsHashTable_initialize(hashTable, tableSize, &dsHash64, &dsHash64Equal));
+		std::vector<HashTableNode> nodes(count);
+
+		double start = dsTimer_time(timer);
+		for (uint32_t i = 0; i < count; ++i)
+		{
+			nodes[i].key = keys[i];
+			nodes[i].value = i;
+			dsHashTable_insert(hashTable, &nodes[i].key, (dsHashTableNode*)(nodes.data() + i),
+				nullptr);
+		}
+		double tableInsertTime = dsTimer_time(timer) - start;
+
+		start = dsTimer_time(timer);
+		uint64_t tableSum = 0;
+		for (uint64_t key : findKeys)
+			tableSum += ((HashTableNode*)dsHashTable_find(hashTable, &key))->value;
+		double tableFindTime = dsTimer_time(timer) - start;
+		EXPECT_TRUE(dsAllocator_free((dsAllocator*)&allocator, hashTable));
+
+		// Flat hash map with the same hash and equality functions as the hash table.
+		double callbackInsertTime, callbackFindTime;
+		uint64_t callbackSum;
+		benchmarkFlatHashMap(callbackInsertTime, callbackFindTime, callbackSum,
+			(dsAllocator*)&allocator, keys, findKeys, &dsHash64, &dsHash64Equal);
+		EXPECT_EQ(tableSum, callbackSum);
+
+		// Flat hash map with inline hashing and comparison of the keys.
+		double inlineInsertTime, inlineFindTime;
+		uint64_t inlineSum;
+		benchmarkFlatHashMap(inlineInsertTime, inlineFindTime, inlineSum,
+			(dsAllocator*)&allocator, keys, findKeys, nullptr, nullptr);
+		EXPECT_EQ(tableSum, inlineSum);
+
+		// Times in microseconds.
+		std::string prefix = std::to_string(count);
+		RecordProperty(prefix + "HashTableInsert", (int)(tableInsertTime*1000000.0));
+		RecordProperty(prefix + "HashTableFind", (int)(tableFindTime*1000000.0));
+		RecordProperty(prefix + "CallbackFlatHashMapInsert",
+			(int)(callbackInsertTime*1000000.0));
+		RecordProperty(prefix + "CallbackFlatHashMapFind", (int)(callbackFindTime*1000000.0));
+		RecordProperty(prefix + "InlineFlatHashMapInsert", (int)(inlineInsertTime*1000000.0));
+		RecordProperty(prefix + "InlineFlatHashMapFind", (int)(inlineFindTime*1000000.0));
+	}
+}
@@ -0,0 +1,181 @@
+/*
+ * Copyright 2020 Aaron Barany
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "Helpers.h"
+#include <DeepSea/Core/Memory/Allocator.h>
+#include <DeepSea/Core/Memory/FrameAllocator.h>
+#include <DeepSea/Core/Memory/Memory.h>
+#include <DeepSea/Core/Memory/SystemAllocator.h>
+#include <DeepSea/Core/Thread/Thread.h>
+#include <gtest/gtest.h>
+#include <cstring>
+
+namespace
+{
+
+dsThreadReturnType allocThreadFunc(void* data)
+{
+	auto allocator = reinterpret_cast<dsAllocator*>(data);
+	for (unsigned int i = 0; i < 1000; ++i)
+	{
+		void* ptr = dsAllocator_alloc(allocator, 100);
+		EXPECT_NE(nullptr, ptr);
+		EXPECT_EQ(0U, (uintptr_t)ptr % DS_ALLOC_ALIGNMENT);
+		std::memset(ptr, 0xFF, 100);
+	}
+	return 0;
+}
+
+} // namespace
+
+class FrameAllocatorTest : public testing::Test
+{
+public:
+	void SetUp() override
+	{
+		ASSERT_TRUE(dsSystemAllocator_initialize(&systemAllocator, DS_ALLOCATOR_NO_LIMIT));
+	}
+
+	void TearDown() override
+	{
+		EXPECT_EQ(0U, ((dsAllocator*)&systemAllocator)->size);
+	}
+
+	dsSystemAllocator systemAllocator;
+};
+
+TEST_F(FrameAllocatorTest, Create)
+{
+	dsAllocator* parentAllocator = (dsAllocator*)&systemAllocator;
+	EXPECT_NULL_ERRNO(EINVAL, dsFrameAllocator_create(nullptr, 3, 0));
+	EXPECT_NULL_ERRNO(EINVAL, dsFrameAllocator_create(parentAllocator, 0, 0));
+	EXPECT_NULL_ERRNO(EINVAL, dsFrameAllocator_create(parentAllocator,
+		DS_MAX_FRAME_ALLOCATOR_FRAMES + 1, 0));
+
+	dsFrameAllocator* allocator = dsFrameAllocator_create(parentAllocator, 3, 0);
+	ASSERT_TRUE(allocator);
+	EXPECT_EQ(0U, dsFrameAllocator_getFrameNumber(allocator));
+	dsFrameAllocator_destroy(allocator);
+}
+
+TEST_F(FrameAllocatorTest, Allocate)
+{
+	dsFrameAllocator* allocator = dsFrameAllocator_create((dsAllocator*)&systemAllocator, 1, 256);
+	ASSERT_TRUE(allocator);
+	dsAllocator* baseAllocator = (dsAllocator*)allocator;
+
+	auto ptr1 = reinterpret_cast<uint8_t*>(dsAllocator_alloc(baseAllocator, 10));
+	ASSERT_NE(nullptr, ptr1);
+	EXPECT_EQ(0U, (uintptr_t)ptr1 % DS_ALLOC_ALIGNMENT);
+	size_t chunkSize = baseAllocator->size;
+	EXPECT_LT(256U, chunkSize);
+
+	// Allocations are sequential within a chunk.
+	auto ptr2 = reinterpret_cast<uint8_t*>(dsAllocator_alloc(baseAllocator, 20));
+	EXPECT_EQ(ptr1 + 16, ptr2);
+	EXPECT_EQ(chunkSize, baseAllocator->size);
+
+	auto ptr3 = reinterpret_cast<uint8_t*>(dsFrameAllocator_alloc(allocator, 10, 64));
+	ASSERT_NE(nullptr, ptr3);
+	EXPECT_EQ(0U, (uintptr_t)ptr3 % 64);
+
+	// Large allocations get their own chunk, but don't replace the current chunk.
+	void* ptr4 = dsAllocator_alloc(baseAllocator, 1000);
+	ASSERT_NE(nullptr, ptr4);
+	std::memset(ptr4, 0, 1000);
+	EXPECT_LT(chunkSize + 1000U, baseAllocator->size);
+
+	auto ptr5 = reinterpret_cast<uint8_t*>(dsAllocator_alloc(baseAllocator, 10));
+	EXPECT_EQ(ptr3 + 16, ptr5);
+
+	// Doesn't fit in the current chunk.
+	void* ptr6 = dsAllocator_alloc(baseAllocator, 200);
+	ASSERT_NE(nullptr, ptr6);
+	EXPECT_LT(chunkSize*2 + 1000U, baseAllocator->size);
+
+	// Chunks are recycled on the next frame with a single frame.
+	EXPECT_FALSE_ERRNO(EINVAL, dsFrameAllocator_beginFrame(allocator, 0));
+	EXPECT_TRUE(dsFrameAllocator_beginFrame(allocator, 1));
+	EXPECT_EQ(1U, dsFrameAllocator_getFrameNumber(allocator));
+	EXPECT_EQ(0U, baseAllocator->size);
+
+	void* ptr7 = dsAllocator_alloc(baseAllocator, 10);
+	EXPECT_TRUE(ptr7 == ptr1 || ptr7 == ptr6);
+	EXPECT_EQ(chunkSize, baseAllocator->size);
+
+	dsFrameAllocator_destroy(allocator);
+}
+
+TEST_F(FrameAllocatorTest, FrameDelay)
+{
+	dsFrameAllocator* allocator = dsFrameAllocator_create((dsAllocator*)&systemAllocator, 3, 256);
+	ASSERT_TRUE(allocator);
+	dsAllocator* baseAllocator = (dsAllocator*)allocator;
+
+	void* ptr1 = dsAllocator_alloc(baseAllocator, 200);
+	ASSERT_NE(nullptr, ptr1);
+	size_t chunkSize = baseAllocator->size;
+
+	EXPECT_TRUE(dsFrameAllocator_beginFrame(allocator, 1));
+	void* ptr2 = dsAllocator_alloc(baseAllocator, 200);
+	EXPECT_NE(ptr1, ptr2);
+	EXPECT_EQ(chunkSize*2, baseAllocator->size);
+
+	EXPECT_TRUE(dsFrameAllocator_beginFrame(allocator, 2));
+	void* ptr3 = dsAllocator_alloc(baseAllocator, 200);
+	EXPECT_NE(ptr1, ptr3);
+	EXPECT_NE(ptr2, ptr3);
+	EXPECT_EQ(chunkSize*3, baseAllocator->size);
+
+	// Frame 0 is recycled when starting frame 3.
+	EXPECT_TRUE(dsFrameAllocator_beginFrame(allocator, 3));
+	EXPECT_EQ(chunkSize*2, baseAllocator->size);
+	void* ptr4 = dsAllocator_alloc(baseAllocator, 200);
+	EXPECT_EQ(ptr1, ptr4);
+
+	// Skipping frames recycles all frames in between.
+	EXPECT_TRUE(dsFrameAllocator_beginFrame(allocator, 10));
+	EXPECT_EQ(0U, baseAllocator->size);
+
+	dsFrameAllocator_destroy(allocator);
+}
+
+TEST_F(FrameAllocatorTest, ThreadAlloc)
+{
+	const unsigned int threadCount = 10;
+	dsFrameAllocator* allocator = dsFrameAllocator_create((dsAllocator*)&systemAllocator, 2, 0);
+	ASSERT_TRUE(allocator);
+
+	for (uint64_t frame = 1; frame <= 3; ++frame)
+	{
+		dsThread threads[threadCount];
+		for (unsigned int i = 0; i < threadCount; ++i)
+		{
+			EXPECT_TRUE(dsThread_create(threads + i, &allocThreadFunc, allocator, 0,
+				nullptr));
+		}
+
+		for (unsigned int i = 0; i < threadCount; ++i)
+			EXPECT_TRUE(dsThread_join(threads + i, NULL));
+
+		// Each thread allocates from separate chunks.
+		EXPECT_LE(threadCount*DS_DEFAULT_FRAME_ALLOCATOR_CHUNK_SIZE,
+			((dsAllocator*)allocator)->size);
+		EXPECT_TRUE(dsFrameAllocator_beginFrame(allocator, frame));
+	}
+
+	dsFrameAllocator_destroy(allocator);
+}
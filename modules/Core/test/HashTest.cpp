@@ -15,7 +15,11 @@
  */
 
 #include <DeepSea/Core/Containers/Hash.h>
+#include <DeepSea/Core/Timer.h>
 #include <gtest/gtest.h>
+#include <cstring>
+#include <string>
+#include <vector>
 
 TEST(HashTest, HashCombineBytes)
 {
@@ -67,6 +71,44 @@ TEST(HashTest, HashCombineBytes128)
 #endif
 }
 
+TEST(HashTest, HashCombineBytes64)
+{
+	// Test vectors from the reference wyhash implementation.
+	// https://github.com/wangyi-fudan/wyhash/blob/master/test_vector.cpp
+	const char* messages[] =
+	{
+		"",
+		"a",
+		"abc",
+		"message digest"
+	};
+	const uint64_t expectedHashes[] =
+	{
+		0x0409638ee2bde459ULL,
+		0xa8412d091b5fe0a9ULL,
+		0x32dd92e4b2915153ULL,
+		0x8619124089a3a16bULL
+	};
+	static_assert(DS_ARRAY_SIZE(messages) == DS_ARRAY_SIZE(expectedHashes), "Array size mismatch.");
+	for (unsigned int i = 0; i < DS_ARRAY_SIZE(messages); ++i)
+	{
+		EXPECT_EQ(expectedHashes[i], dsHashCombineBytes64(i, messages[i], strlen(messages[i])));
+		EXPECT_EQ(expectedHashes[i], dsHashCombineString64(i, messages[i]));
+	}
+
+	// Alignment shouldn't affect the result.
+	uint8_t key[256];
+	uint8_t unalignedKey[sizeof(key) + 1];
+	for (unsigned int i = 0; i < DS_ARRAY_SIZE(key); ++i)
+		key[i] = (uint8_t)i;
+	memcpy(unalignedKey + 1, key, sizeof(key));
+	for (unsigned int i = 0; i < DS_ARRAY_SIZE(key); ++i)
+		EXPECT_EQ(dsHashCombineBytes64(i, key, i), dsHashCombineBytes64(i, unalignedKey + 1, i));
+
+	EXPECT_EQ(dsHashCombineBytes64(0, key, sizeof(key)), dsHashBytes64(key, sizeof(key)));
+	EXPECT_NE(dsHashCombineBytes64(1, key, sizeof(key)), dsHashBytes64(key, sizeof(key)));
+}
+
 TEST(HashTest, HashCombine)
 {
 	EXPECT_NE(dsHashCombine(1, 2), dsHashCombine(2, 1));
@@ -88,12 +130,33 @@ TEST(HashTest, HashString)
 	EXPECT_TRUE(dsHashStringEqual("test2", str2.c_str()));
 	EXPECT_FALSE(dsHashStringEqual(str1.c_str(), str2.c_str()));
 
+	EXPECT_EQ(dsHashString64("test1"), dsHashBytes64(str1.c_str(), str1.length()));
+	EXPECT_NE(dsHashString64("test1"), dsHashString64("test2"));
+
 	EXPECT_TRUE(dsHashStringEqual(nullptr, nullptr));
 	EXPECT_FALSE(dsHashStringEqual(str1.c_str(), nullptr));
 	EXPECT_FALSE(dsHashStringEqual(nullptr, str2.c_str()));
 	EXPECT_TRUE(dsHashStringEqual(str1.c_str(), str1.c_str()));
 }
 
+TEST(HashTest, HashStringLiteral)
+{
+	constexpr uint32_t emptyHash = DS_HASH_STRING_LITERAL("");
+	EXPECT_EQ(dsHashString(""), emptyHash);
+
+	constexpr uint32_t testHash = DS_HASH_STRING_LITERAL("test1");
+	EXPECT_EQ(dsHashString("test1"), testHash);
+
+	// Cover each tail length.
+	EXPECT_EQ(dsHashString("a"), DS_HASH_STRING_LITERAL("a"));
+	EXPECT_EQ(dsHashString("ab"), DS_HASH_STRING_LITERAL("ab"));
+	EXPECT_EQ(dsHashString("abc"), DS_HASH_STRING_LITERAL("abc"));
+	EXPECT_EQ(dsHashString("abcd"), DS_HASH_STRING_LITERAL("abcd"));
+	EXPECT_EQ(dsHashString("IndirectModelInstances"),
+		DS_HASH_STRING_LITERAL("IndirectModelInstances"));
+	EXPECT_EQ(dsHashString("\xff\xfe\x80"), DS_HASH_STRING_LITERAL("\xff\xfe\x80"));
+}
+
 TEST(HashTest, Hash8)
 {
 	uint8_t val1 = 123;
@@ -245,3 +308,47 @@ TEST(HashTest, HashDouble)
 	EXPECT_FALSE(dsHashDoubleEqual(nullptr, &val2));
 	EXPECT_TRUE(dsHashDoubleEqual(&val1, &val2));
 }
+
+TEST(HashTest, DISABLED_HashBytesBenchmark)
+{
+	dsTimer timer = dsTimer_create();
+	const size_t sizes[] = {16, 64, 256, 4096, 1024*1024};
+	const size_t totalBytes = 64*1024*1024;
+	std::vector<uint8_t> buffer(sizes[DS_ARRAY_SIZE(sizes) - 1]);
+	for (size_t i = 0; i < buffer.size(); ++i)
+		buffer[i] = (uint8_t)(i*31 + 7);
+
+	volatile uint32_t hashSink = 0;
+	for (size_t size : sizes)
+	{
+		size_t iterations = totalBytes/size;
+
+		// Accumulate the results so the calls can't be optimized out.
+		uint32_t hash32 = 0;
+		double start = dsTimer_time(timer);
+		for (size_t i = 0; i < iterations; ++i)
+			hash32 ^= dsHashCombineBytes((uint32_t)i, buffer.data(), size);
+		double time32 = dsTimer_time(timer) - start;
+
+		uint8_t hash128[16] = {};
+		start = dsTimer_time(timer);
+		for (size_t i = 0; i < iterations; ++i)
+			dsHashCombineBytes128(hash128, hash128, buffer.data(), size);
+		double time128 = dsTimer_time(timer) - start;
+
+		uint64_t hash64 = 0;
+		start = dsTimer_time(timer);
+		for (size_t i = 0; i < iterations; ++i)
+			hash64 ^= dsHashCombineBytes64(i, buffer.data(), size);
+		double time64 = dsTimer_time(timer) - start;
+
+		hashSink = hashSink ^ hash32 ^ hash128[0] ^ (uint32_t)hash64;
+
+		// Throughput in MB/s.
+		const double megabytes = (double)(iterations*size)/(1024.0*1024.0);
+		std::string prefix = std::to_string(size) + "Bytes";
+		testing::Test::RecordProperty(prefix + "Hash32", (int)(megabytes/time32));
+		testing::Test::RecordProperty(prefix + "Hash128", (int)(megabytes/time128));
+		testing::Test::RecordProperty(prefix + "Hash64", (int)(megabytes/time64));
+	}
+}
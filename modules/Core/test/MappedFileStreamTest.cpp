@@ -0,0 +1,131 @@
+/*
+ * Copyright 2020 Aaron Barany
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "Helpers.h"
+#include <DeepSea/Core/Streams/FileStream.h>
+#include <DeepSea/Core/Streams/MappedFileStream.h>
+#include <DeepSea/Core/Streams/Path.h>
+#include <DeepSea/Core/Streams/ResourceStream.h>
+#include <DeepSea/Core/Streams/Stream.h>
+#include <gtest/gtest.h>
+#include <stdio.h>
+
+TEST(MappedFileStream, Null)
+{
+	int32_t dummyData;
+	size_t size;
+	EXPECT_EQ_ERRNO(EINVAL, 0U, dsMappedFileStream_read(NULL, &dummyData, sizeof(dummyData)));
+	EXPECT_FALSE_ERRNO(EINVAL, dsMappedFileStream_seek(NULL, 0, dsStreamSeekWay_Beginning));
+	EXPECT_EQ_ERRNO(EINVAL, DS_STREAM_INVALID_POS, dsMappedFileStream_tell(NULL));
+	EXPECT_NULL_ERRNO(EINVAL, dsMappedFileStream_getContents(&size, NULL));
+	EXPECT_FALSE_ERRNO(EINVAL, dsMappedFileStream_close(NULL));
+}
+
+TEST(MappedFileStream, Empty)
+{
+	dsMappedFileStream stream = {};
+	int32_t dummyData;
+	size_t size;
+	EXPECT_EQ_ERRNO(EINVAL, 0U, dsMappedFileStream_read(&stream, &dummyData, sizeof(dummyData)));
+	EXPECT_FALSE_ERRNO(EINVAL, dsMappedFileStream_seek(&stream, 0, dsStreamSeekWay_Beginning));
+	EXPECT_EQ_ERRNO(EINVAL, DS_STREAM_INVALID_POS, dsMappedFileStream_tell(&stream));
+	EXPECT_NULL_ERRNO(EINVAL, dsMappedFileStream_getContents(&size, &stream));
+	EXPECT_FALSE_ERRNO(EINVAL, dsMappedFileStream_close(&stream));
+}
+
+TEST(MappedFileStream, InvalidOpen)
+{
+	dsMappedFileStream stream = {};
+	EXPECT_FALSE_ERRNO(EINVAL, dsMappedFileStream_openPath(NULL, "asdf"));
+	EXPECT_FALSE_ERRNO(EINVAL, dsMappedFileStream_openPath(&stream, NULL));
+
+	char path[DS_PATH_MAX];
+	ASSERT_TRUE(dsPath_combine(path, sizeof(path),
+		dsResourceStream_getDirectory(dsFileResourceType_Dynamic), "doesNotExist"));
+	EXPECT_FALSE_ERRNO(ENOENT, dsMappedFileStream_openPath(&stream, path));
+}
+
+TEST(MappedFileStream, ReadFile)
+{
+	char path[DS_PATH_MAX];
+	ASSERT_TRUE(dsPath_combine(path, sizeof(path),
+		dsResourceStream_getDirectory(dsFileResourceType_Dynamic), "mapped"));
+
+	dsFileStream fileStream;
+	ASSERT_TRUE(dsFileStream_openPath(&fileStream, path, "wb"));
+	const int32_t values[] = {1, 2, 3, 4};
+	EXPECT_EQ(sizeof(values), dsFileStream_write(&fileStream, values, sizeof(values)));
+	EXPECT_TRUE(dsFileStream_close(&fileStream));
+
+	dsMappedFileStream stream;
+	ASSERT_TRUE(dsMappedFileStream_openPath(&stream, path));
+	EXPECT_FALSE(((dsStream*)&stream)->writeFunc);
+
+	int32_t value;
+	EXPECT_EQ(sizeof(value), dsStream_read((dsStream*)&stream, &value, sizeof(value)));
+	EXPECT_EQ(1, value);
+	EXPECT_EQ(sizeof(value), dsStream_tell((dsStream*)&stream));
+
+	EXPECT_TRUE(dsStream_seek((dsStream*)&stream, sizeof(value), dsStreamSeekWay_Current));
+	EXPECT_EQ(sizeof(value), dsStream_read((dsStream*)&stream, &value, sizeof(value)));
+	EXPECT_EQ(3, value);
+
+	EXPECT_FALSE_ERRNO(EINVAL, dsStream_seek((dsStream*)&stream, -1, dsStreamSeekWay_Beginning));
+	EXPECT_FALSE_ERRNO(EINVAL, dsStream_seek((dsStream*)&stream, 1, dsStreamSeekWay_End));
+	EXPECT_TRUE(dsStream_seek((dsStream*)&stream, -(int64_t)sizeof(value), dsStreamSeekWay_End));
+
+	// Direct access from the current position.
+	size_t size;
+	const int32_t* contents = (const int32_t*)dsStream_getContents(&size, (dsStream*)&stream);
+	ASSERT_TRUE(contents);
+	EXPECT_EQ(sizeof(value), size);
+	EXPECT_EQ(4, contents[0]);
+	EXPECT_EQ(sizeof(values), dsStream_tell((dsStream*)&stream));
+	EXPECT_EQ(0U, dsStream_read((dsStream*)&stream, &value, sizeof(value)));
+
+	EXPECT_TRUE(dsStream_seek((dsStream*)&stream, 0, dsStreamSeekWay_Beginning));
+	contents = (const int32_t*)dsStream_getContents(&size, (dsStream*)&stream);
+	ASSERT_TRUE(contents);
+	ASSERT_EQ(sizeof(values), size);
+	for (unsigned int i = 0; i < DS_ARRAY_SIZE(values); ++i)
+		EXPECT_EQ(values[i], contents[i]);
+
+	EXPECT_TRUE(dsStream_close((dsStream*)&stream));
+	EXPECT_FALSE_ERRNO(EINVAL, dsMappedFileStream_close(&stream));
+	EXPECT_EQ(0, remove(path));
+}
+
+TEST(MappedFileStream, EmptyFile)
+{
+	char path[DS_PATH_MAX];
+	ASSERT_TRUE(dsPath_combine(path, sizeof(path),
+		dsResourceStream_getDirectory(dsFileResourceType_Dynamic), "mappedEmpty"));
+
+	dsFileStream fileStream;
+	ASSERT_TRUE(dsFileStream_openPath(&fileStream, path, "wb"));
+	EXPECT_TRUE(dsFileStream_close(&fileStream));
+
+	dsMappedFileStream stream;
+	ASSERT_TRUE(dsMappedFileStream_openPath(&stream, path));
+	size_t size = 1;
+	EXPECT_TRUE(dsStream_getContents(&size, (dsStream*)&stream));
+	EXPECT_EQ(0U, size);
+
+	int32_t value;
+	EXPECT_EQ(0U, dsStream_read((dsStream*)&stream, &value, sizeof(value)));
+	EXPECT_TRUE(dsStream_close((dsStream*)&stream));
+	EXPECT_EQ(0, remove(path));
+}
@@ -166,6 +166,25 @@ TEST(MemoryStream, ReadUntilEnd)
 	EXPECT_EQ(0U, ((dsAllocator*)&allocator)->size);
 }
 
+TEST(MemoryStream, GetContents)
+{
+	dsMemoryStream stream;
+	int32_t buffer[3] = {0, 1, 2};
+
+	EXPECT_TRUE(dsMemoryStream_open(&stream, buffer, sizeof(buffer)));
+	EXPECT_TRUE(dsMemoryStream_seek(&stream, sizeof(uint32_t), dsStreamSeekWay_Current));
+
+	size_t size;
+	EXPECT_NULL_ERRNO(EINVAL, dsStream_getContents(NULL, (dsStream*)&stream));
+	const int32_t* data = (const int32_t*)dsStream_getContents(&size, (dsStream*)&stream);
+	EXPECT_EQ(buffer + 1, data);
+	EXPECT_EQ(sizeof(uint32_t)*2, size);
+	EXPECT_EQ(sizeof(buffer), dsMemoryStream_tell(&stream));
+
+	EXPECT_TRUE(dsMemoryStream_close(&stream));
+	EXPECT_NULL_ERRNO(EINVAL, dsMemoryStream_getContents(&size, &stream));
+}
+
 TEST(MemoryStream, ReadUntilEndNoSeek)
 {
 	dsSystemAllocator allocator;
@@ -19,7 +19,10 @@
 #include <DeepSea/Core/Memory/PoolAllocator.h>
 #include <DeepSea/Core/Memory/Memory.h>
 #include <DeepSea/Core/Thread/Thread.h>
+#include <DeepSea/Core/Timer.h>
 #include <gtest/gtest.h>
+#include <string>
+#include <vector>
 
 namespace
 {
@@ -43,6 +46,54 @@ dsThreadReturnType pauseThreadFunc(void* data)
 	return 0;
 }
 
+dsThreadReturnType lockFreeThreadFunc(void* data)
+{
+	auto allocator = reinterpret_cast<dsPoolAllocator*>(data);
+	void* ptrs[10];
+	for (unsigned int i = 0; i < 100; ++i)
+	{
+		for (unsigned int j = 0; j < 10; ++j)
+		{
+			ptrs[j] = dsAllocator_alloc((dsAllocator*)allocator, 14);
+			EXPECT_NE(nullptr, ptrs[j]);
+		}
+
+		for (unsigned int j = 0; j < 10; ++j)
+			EXPECT_TRUE(dsAllocator_free((dsAllocator*)allocator, ptrs[j]));
+	}
+
+	EXPECT_TRUE(dsPoolAllocator_flushThread(allocator));
+	return 0;
+}
+
+dsThreadReturnType benchmarkThreadFunc(void* data)
+{
+	auto allocator = reinterpret_cast<dsPoolAllocator*>(data);
+	void* ptrs[16];
+	for (unsigned int i = 0; i < 20000; ++i)
+	{
+		for (unsigned int j = 0; j < 16; ++j)
+			ptrs[j] = dsAllocator_alloc((dsAllocator*)allocator, 16);
+		for (unsigned int j = 0; j < 16; ++j)
+			dsAllocator_free((dsAllocator*)allocator, ptrs[j]);
+	}
+
+	dsPoolAllocator_flushThread(allocator);
+	return 0;
+}
+
+double runBenchmark(dsPoolAllocator* allocator, unsigned int threadCount)
+{
+	dsThread threads[8];
+	dsTimer timer = dsTimer_create();
+	double start = dsTimer_time(timer);
+	for (unsigned int i = 0; i < threadCount; ++i)
+		EXPECT_TRUE(dsThread_create(threads + i, &benchmarkThreadFunc, allocator, 0, nullptr));
+	for (unsigned int i = 0; i < threadCount; ++i)
+		EXPECT_TRUE(dsThread_join(threads + i, NULL));
+	return dsTimer_time(timer) - start;
+}
+
 } // namespace
 
 TEST(PoolAllocator, Initialize)
@@ -409,3 +460,168 @@ TEST(PoolAllocator, ThreadAllocWithPause)
 	EXPECT_EQ(0U, ((dsAllocator*)&allocator)->currentAllocations);
 	dsPoolAllocator_shutdown(&allocator);
 }
+
+TEST(PoolAllocator, LockFreeAllocateFree)
+{
+	const unsigned int chunkSize = 24;
+	const unsigned int chunkCount = 4;
+	const unsigned int bufferSize = DS_ALIGNED_SIZE(chunkSize)*chunkCount;
+	DS_ALIGN(DS_ALLOC_ALIGNMENT) uint8_t buffer[bufferSize];
+
+	dsPoolAllocator allocator;
+	EXPECT_FALSE_ERRNO(EINVAL, dsPoolAllocator_initializeLockFree(&allocator, chunkSize,
+		chunkCount, buffer, bufferSize - 1, 0));
+	ASSERT_TRUE(dsPoolAllocator_initializeLockFree(&allocator, chunkSize, chunkCount, buffer,
+		bufferSize, 0));
+	EXPECT_TRUE(allocator.lockFree);
+	EXPECT_TRUE(dsPoolAllocator_validate(&allocator));
+
+	void* ptrs[chunkCount];
+	for (unsigned int i = 0; i < chunkCount; ++i)
+	{
+		ptrs[i] = dsAllocator_alloc((dsAllocator*)&allocator, 14);
+		EXPECT_EQ(buffer + i*DS_ALIGNED_SIZE(chunkSize), ptrs[i]);
+		EXPECT_TRUE(dsPoolAllocator_validate(&allocator));
+	}
+
+	EXPECT_NULL_ERRNO(ENOMEM, dsAllocator_alloc((dsAllocator*)&allocator, 14));
+	EXPECT_NULL_ERRNO(EINVAL, dsAllocator_alloc((dsAllocator*)&allocator,
+		DS_ALIGNED_SIZE(chunkSize) + 1));
+	EXPECT_EQ(DS_ALIGNED_SIZE(chunkSize)*chunkCount, ((dsAllocator*)&allocator)->size);
+	EXPECT_EQ(chunkCount, ((dsAllocator*)&allocator)->currentAllocations);
+	EXPECT_EQ(0U, allocator.freeCount);
+
+	EXPECT_FALSE_ERRNO(EINVAL, dsAllocator_free((dsAllocator*)&allocator, buffer + 1));
+	EXPECT_TRUE(dsAllocator_free((dsAllocator*)&allocator, ptrs[2]));
+	EXPECT_TRUE(dsAllocator_free((dsAllocator*)&allocator, ptrs[0]));
+	EXPECT_TRUE(dsPoolAllocator_validate(&allocator));
+	EXPECT_EQ(2U, allocator.freeCount);
+
+	EXPECT_EQ(ptrs[0], dsAllocator_alloc((dsAllocator*)&allocator, 14));
+	EXPECT_EQ(ptrs[2], dsAllocator_alloc((dsAllocator*)&allocator, 14));
+
+	for (unsigned int i = 0; i < chunkCount; ++i)
+		EXPECT_TRUE(dsAllocator_free((dsAllocator*)&allocator, ptrs[i]));
+	EXPECT_TRUE(dsPoolAllocator_validate(&allocator));
+	EXPECT_EQ(0U, ((dsAllocator*)&allocator)->size);
+	EXPECT_EQ(6U, ((dsAllocator*)&allocator)->totalAllocations);
+	EXPECT_EQ(0U, ((dsAllocator*)&allocator)->currentAllocations);
+	EXPECT_EQ(chunkCount, allocator.freeCount);
+
+	EXPECT_TRUE(dsPoolAllocator_reset(&allocator));
+	EXPECT_TRUE(dsPoolAllocator_validate(&allocator));
+	EXPECT_EQ(buffer, dsAllocator_alloc((dsAllocator*)&allocator, 14));
+
+	dsPoolAllocator_shutdown(&allocator);
+}
+
+TEST(PoolAllocator, LockFreeMagazine)
+{
+	const unsigned int chunkSize = 24;
+	const unsigned int chunkCount = 20;
+	const unsigned int magazineSize = 4;
+	const unsigned int bufferSize = DS_ALIGNED_SIZE(chunkSize)*chunkCount;
+	DS_ALIGN(DS_ALLOC_ALIGNMENT) uint8_t buffer[bufferSize];
+
+	dsPoolAllocator allocator;
+	ASSERT_TRUE(dsPoolAllocator_initializeLockFree(&allocator, chunkSize, chunkCount, buffer,
+		bufferSize, magazineSize));
+
+	// One chunk for the magazine and a batch for the magazine contents.
+	void* ptr = dsAllocator_alloc((dsAllocator*)&allocator, 14);
+	EXPECT_NE(nullptr, ptr);
+	EXPECT_EQ(chunkCount - magazineSize - 1, allocator.freeCount);
+	EXPECT_EQ(magazineSize + 1, ((dsAllocator*)&allocator)->currentAllocations);
+	EXPECT_TRUE(dsPoolAllocator_validate(&allocator));
+
+	// All chunks other than the magazine can be allocated.
+	std::vector<void*> ptrs;
+	ptrs.push_back(ptr);
+	while ((ptr = dsAllocator_alloc((dsAllocator*)&allocator, 14)))
+		ptrs.push_back(ptr);
+	EXPECT_EQ(ENOMEM, errno);
+	EXPECT_EQ(chunkCount - 1, ptrs.size());
+	EXPECT_EQ(0U, allocator.freeCount);
+
+	// Chunks are returned to the shared list in batches.
+	for (void* freePtr : ptrs)
+		EXPECT_TRUE(dsAllocator_free((dsAllocator*)&allocator, freePtr));
+	EXPECT_LT(0U, allocator.freeCount);
+	EXPECT_GE(magazineSize*2 + 1, ((dsAllocator*)&allocator)->currentAllocations);
+	EXPECT_TRUE(dsPoolAllocator_validate(&allocator));
+
+	EXPECT_TRUE(dsPoolAllocator_flushThread(&allocator));
+	EXPECT_EQ(chunkCount, allocator.freeCount);
+	EXPECT_EQ(0U, ((dsAllocator*)&allocator)->size);
+	EXPECT_EQ(0U, ((dsAllocator*)&allocator)->currentAllocations);
+	EXPECT_TRUE(dsPoolAllocator_validate(&allocator));
+
+	dsPoolAllocator_shutdown(&allocator);
+}
+
+TEST(PoolAllocator, LockFreeThreadAlloc)
+{
+	const unsigned int threadCount = 20;
+	const unsigned int chunkSize = 24;
+	const unsigned int chunkCount = threadCount*30;
+	const unsigned int bufferSize = DS_ALIGNED_SIZE(chunkSize)*chunkCount;
+	std::vector<uint8_t> buffer(bufferSize + DS_ALLOC_ALIGNMENT);
+	void* alignedBuffer = (void*)DS_ALIGNED_SIZE((uintptr_t)buffer.data());
+
+	for (uint32_t magazineSize = 0; magazineSize <= 8; magazineSize += 8)
+	{
+		dsPoolAllocator allocator;
+		ASSERT_TRUE(dsPoolAllocator_initializeLockFree(&allocator, chunkSize, chunkCount,
+			alignedBuffer, bufferSize, magazineSize));
+
+		dsThread threads[threadCount];
+		for (unsigned int i = 0; i < threadCount; ++i)
+		{
+			EXPECT_TRUE(dsThread_create(threads + i, &lockFreeThreadFunc, &allocator, 0,
+				nullptr));
+		}
+
+		for (unsigned int i = 0; i < threadCount; ++i)
+			EXPECT_TRUE(dsThread_join(threads + i, NULL));
+
+		EXPECT_TRUE(dsPoolAllocator_validate(&allocator));
+		EXPECT_EQ(0U, ((dsAllocator*)&allocator)->size);
+		EXPECT_EQ(0U, ((dsAllocator*)&allocator)->currentAllocations);
+		EXPECT_EQ(chunkCount, allocator.freeCount);
+		dsPoolAllocator_shutdown(&allocator);
+	}
+}
+
+TEST(PoolAllocator, DISABLED_ThreadBenchmark)
+{
+	const unsigned int chunkSize = 16;
+	const unsigned int chunkCount = 4096;
+	const unsigned int bufferSize = DS_ALIGNED_SIZE(chunkSize)*chunkCount;
+	std::vector<uint8_t> buffer(bufferSize + DS_ALLOC_ALIGNMENT);
+	void* alignedBuffer = (void*)DS_ALIGNED_SIZE((uintptr_t)buffer.data());
+
+	for (unsigned int threadCount = 1; threadCount <= 8; threadCount *= 2)
+	{
+		dsPoolAllocator allocator;
+		ASSERT_TRUE(dsPoolAllocator_initialize(&allocator, chunkSize, chunkCount, alignedBuffer,
+			bufferSize));
+		double lockTime = runBenchmark(&allocator, threadCount);
+		dsPoolAllocator_shutdown(&allocator);
+
+		ASSERT_TRUE(dsPoolAllocator_initializeLockFree(&allocator, chunkSize, chunkCount,
+			alignedBuffer, bufferSize, 0));
+		double lockFreeTime = runBenchmark(&allocator, threadCount);
+		dsPoolAllocator_shutdown(&allocator);
+
+		ASSERT_TRUE(dsPoolAllocator_initializeLockFree(&allocator, chunkSize, chunkCount,
+			alignedBuffer, bufferSize, 32));
+		double magazineTime = runBenchmark(&allocator, threadCount);
+		dsPoolAllocator_shutdown(&allocator);
+
+		// Times in microseconds.
+		std::string prefix = std::to_string(threadCount) + "Threads";
+		testing::Test::RecordProperty(prefix + "Spinlock", (int)(lockTime*1000000.0));
+		testing::Test::RecordProperty(prefix + "LockFree", (int)(lockFreeTime*1000000.0));
+		testing::Test::RecordProperty(prefix + "Magazines", (int)(magazineTime*1000000.0));
+	}
+}
@@ -0,0 +1,55 @@
+/*
+ * Copyright 2020 Aaron Barany
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <DeepSea/Core/SIMD.h>
+#include <gtest/gtest.h>
+
+TEST(SIMDTest, HostFeatures)
+{
+	dsSIMDFeatures features = dsSIMD_getHostFeatures();
+	EXPECT_EQ(features, dsSIMD_getHostFeatures());
+
+#if !DS_HAS_SIMD
+	EXPECT_EQ(dsSIMDFeatures_None, features);
+#endif
+
+#if DS_SIMD_ALWAYS_FLOAT4
+	EXPECT_TRUE(features & dsSIMDFeatures_Float4);
+#endif
+
+#if DS_SIMD_ALWAYS_HADD
+	EXPECT_TRUE(features & dsSIMDFeatures_HAdd);
+#endif
+
+#if DS_SIMD_ALWAYS_FMA
+	EXPECT_TRUE(features & dsSIMDFeatures_FMA);
+#endif
+
+#if DS_SIMD_ALWAYS_FLOAT8
+	EXPECT_TRUE(features & dsSIMDFeatures_Float8);
+#endif
+
+	// Wider instructions imply the narrower ones.
+	if (features & dsSIMDFeatures_Float8)
+	{
+		EXPECT_TRUE(features & dsSIMDFeatures_Float4);
+	}
+
+	if (features & dsSIMDFeatures_HAdd)
+	{
+		EXPECT_TRUE(features & dsSIMDFeatures_Float4);
+	}
+}
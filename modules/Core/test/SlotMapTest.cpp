@@ -0,0 +1,175 @@
+/*
+ * Copyright 2020 Aaron Barany
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <DeepSea/Core/Containers/SlotMap.h>
+#include <DeepSea/Core/Error.h>
+#include <DeepSea/Core/Memory/SystemAllocator.h>
+#include <gtest/gtest.h>
+#include <vector>
+
+namespace
+{
+
+// Keeps a parallel array of values in sync with the slot map the same way users of it would.
+struct SlotMapValues
+{
+	uint64_t add(int value)
+	{
+		uint64_t handle = dsSlotMap_add(&slotMap);
+		if (handle != DS_INVALID_SLOT_HANDLE)
+			values.push_back(value);
+		return handle;
+	}
+
+	bool remove(uint64_t handle)
+	{
+		uint32_t index = dsSlotMap_remove(&slotMap, handle);
+		if (index == DS_INVALID_SLOT_INDEX)
+			return false;
+
+		if (index < slotMap.elementCount)
+			values[index] = values[slotMap.elementCount];
+		values.pop_back();
+		return true;
+	}
+
+	int get(uint64_t handle) const
+	{
+		uint32_t index = dsSlotMap_getIndex(&slotMap, handle);
+		if (index == DS_INVALID_SLOT_INDEX)
+			return -1;
+		return values[index];
+	}
+
+	dsSlotMap slotMap;
+	std::vector<int> values;
+};
+
+} // namespace
+
+TEST(SlotMap, Initialize)
+{
+	dsSystemAllocator allocator;
+	ASSERT_TRUE(dsSystemAllocator_initialize(&allocator, DS_ALLOCATOR_NO_LIMIT));
+
+	dsSlotMap slotMap;
+	EXPECT_FALSE(dsSlotMap_initialize(NULL, (dsAllocator*)&allocator));
+	EXPECT_FALSE(dsSlotMap_initialize(&slotMap, NULL));
+	EXPECT_TRUE(dsSlotMap_initialize(&slotMap, (dsAllocator*)&allocator));
+	EXPECT_EQ(0U, slotMap.elementCount);
+	EXPECT_EQ(DS_INVALID_SLOT_INDEX, dsSlotMap_getIndex(&slotMap, 0));
+	EXPECT_EQ(DS_INVALID_SLOT_HANDLE, dsSlotMap_getHandle(&slotMap, 0));
+	dsSlotMap_shutdown(&slotMap);
+}
+
+TEST(SlotMap, AddRemove)
+{
+	dsSystemAllocator allocator;
+	ASSERT_TRUE(dsSystemAllocator_initialize(&allocator, DS_ALLOCATOR_NO_LIMIT));
+
+	SlotMapValues map;
+	ASSERT_TRUE(dsSlotMap_initialize(&map.slotMap, (dsAllocator*)&allocator));
+
+	uint64_t handle0 = map.add(0);
+	uint64_t handle1 = map.add(1);
+	uint64_t handle2 = map.add(2);
+	uint64_t handle3 = map.add(3);
+	ASSERT_NE(DS_INVALID_SLOT_HANDLE, handle0);
+	ASSERT_NE(DS_INVALID_SLOT_HANDLE, handle1);
+	ASSERT_NE(DS_INVALID_SLOT_HANDLE, handle2);
+	ASSERT_NE(DS_INVALID_SLOT_HANDLE, handle3);
+	EXPECT_EQ(4U, map.slotMap.elementCount);
+
+	EXPECT_EQ(0U, dsSlotMap_getIndex(&map.slotMap, handle0));
+	EXPECT_EQ(3U, dsSlotMap_getIndex(&map.slotMap, handle3));
+	EXPECT_EQ(handle2, dsSlotMap_getHandle(&map.slotMap, 2));
+
+	// Removing from the middle moves the last element.
+	EXPECT_TRUE(map.remove(handle1));
+	EXPECT_EQ(3U, map.slotMap.elementCount);
+	EXPECT_EQ(1U, dsSlotMap_getIndex(&map.slotMap, handle3));
+	EXPECT_EQ(handle3, dsSlotMap_getHandle(&map.slotMap, 1));
+	EXPECT_EQ(0, map.get(handle0));
+	EXPECT_EQ(-1, map.get(handle1));
+	EXPECT_EQ(2, map.get(handle2));
+	EXPECT_EQ(3, map.get(handle3));
+
+	EXPECT_FALSE(map.remove(handle1));
+	EXPECT_EQ(ENOTFOUND, errno);
+
+	// The slot is re-used, but the old handle stays invalid.
+	uint64_t handle4 = map.add(4);
+	EXPECT_NE(handle1, handle4);
+	EXPECT_EQ((uint32_t)handle1, (uint32_t)handle4);
+	EXPECT_EQ(-1, map.get(handle1));
+	EXPECT_EQ(4, map.get(handle4));
+
+	// Removing the last element doesn't move anything.
+	EXPECT_TRUE(map.remove(handle4));
+	EXPECT_EQ(0, map.get(handle0));
+	EXPECT_EQ(2, map.get(handle2));
+	EXPECT_EQ(3, map.get(handle3));
+
+	dsSlotMap_clear(&map.slotMap);
+	map.values.clear();
+	EXPECT_EQ(0U, map.slotMap.elementCount);
+	EXPECT_EQ(-1, map.get(handle0));
+	EXPECT_EQ(-1, map.get(handle2));
+	EXPECT_EQ(-1, map.get(handle3));
+
+	uint64_t handle5 = map.add(5);
+	EXPECT_EQ(5, map.get(handle5));
+	EXPECT_EQ(0U, dsSlotMap_getIndex(&map.slotMap, handle5));
+
+	dsSlotMap_shutdown(&map.slotMap);
+	EXPECT_EQ(0U, ((dsAllocator*)&allocator)->size);
+}
+
+TEST(SlotMap, ManyElements)
+{
+	dsSystemAllocator allocator;
+	ASSERT_TRUE(dsSystemAllocator_initialize(&allocator, DS_ALLOCATOR_NO_LIMIT));
+
+	SlotMapValues map;
+	ASSERT_TRUE(dsSlotMap_initialize(&map.slotMap, (dsAllocator*)&allocator));
+
+	const int count = 1000;
+	std::vector<uint64_t> handles;
+	for (int i = 0; i < count; ++i)
+		handles.push_back(map.add(i));
+
+	// Remove every other element in a different order than they were added.
+	for (int i = count - 2; i >= 0; i -= 2)
+		EXPECT_TRUE(map.remove(handles[i]));
+	EXPECT_EQ((uint32_t)count/2, map.slotMap.elementCount);
+
+	for (int i = 0; i < count; ++i)
+	{
+		if (i % 2 == 0)
+			EXPECT_EQ(-1, map.get(handles[i]));
+		else
+			EXPECT_EQ(i, map.get(handles[i]));
+	}
+
+	for (uint32_t i = 0; i < map.slotMap.elementCount; ++i)
+	{
+		uint64_t handle = dsSlotMap_getHandle(&map.slotMap, i);
+		EXPECT_EQ(i, dsSlotMap_getIndex(&map.slotMap, handle));
+	}
+
+	dsSlotMap_shutdown(&map.slotMap);
+	EXPECT_EQ(0U, ((dsAllocator*)&allocator)->size);
+}
@@ -14,8 +14,16 @@
  * limitations under the License.
  */
 
+#include "Helpers.h"
+#include <DeepSea/Core/Memory/SystemAllocator.h>
+#include <DeepSea/Core/Thread/Thread.h>
+#include <DeepSea/Core/Thread/ThreadPool.h>
 #include <DeepSea/Core/Sort.h>
+#include <DeepSea/Core/Timer.h>
+#include <DeepSea/Core/TypedSort.h>
 #include <gtest/gtest.h>
+#include <algorithm>
+#include <random>
 #include <vector>
 
 namespace
@@ -38,6 +46,34 @@ static int compareInt(const void* left, const void* right, void*)
 	return *(const int*)left - *(const int*)right;
 }
 
+struct KeyValue
+{
+	uint32_t key;
+	uint32_t value;
+};
+
+#define INT_LESS(left, right, context) (*(left) < *(right))
+DS_DEFINE_TYPED_SORT(sortInts, int, INT_LESS)
+
+static bool keyValueLess(const KeyValue* left, const KeyValue* right, void* context)
+{
+	// Context to reverse the order.
+	if (context)
+		return left->key > right->key;
+	return left->key < right->key;
+}
+
+DS_DEFINE_TYPED_SORT(sortKeyValues, KeyValue, keyValueLess)
+DS_DEFINE_TYPED_SORT(sortUInts, uint32_t, INT_LESS)
+
+static void checkTypedSort(std::vector<int> values)
+{
+	std::vector<int> expectedValues = values;
+	std::sort(expectedValues.begin(), expectedValues.end());
+	sortInts(values.data(), values.size(), nullptr);
+	EXPECT_EQ(expectedValues, values);
+}
+
 } // namespace
 
 TEST(SortTest, IndirectSort)
@@ -50,6 +86,289 @@ TEST(SortTest, IndirectSort)
 	EXPECT_EQ(std::vector<int>({4, 3, 2, 1, 0}), data.order);
 }
 
+TEST(SortTest, TypedSort)
+{
+	checkTypedSort({});
+	checkTypedSort({1});
+	checkTypedSort({2, 1});
+	checkTypedSort({5, 3, 1, 4, 2});
+
+	std::mt19937 random(1234);
+	for (size_t count : {17, 100, 1000, 10000})
+	{
+		std::vector<int> values(count);
+		for (int& value : values)
+			value = (int)(random() % 100000);
+		checkTypedSort(values);
+
+		// Many duplicates.
+		for (int& value : values)
+			value = (int)(random() % 4);
+		checkTypedSort(values);
+
+		// Already sorted and reverse sorted.
+		std::sort(values.begin(), values.end());
+		checkTypedSort(values);
+		std::reverse(values.begin(), values.end());
+		checkTypedSort(values);
+	}
+
+	// Force the heapsort fallback.
+	std::vector<int> values(1000);
+	for (int& value : values)
+		value = (int)(random() % 1000);
+	std::vector<int> expectedValues = values;
+	std::sort(expectedValues.begin(), expectedValues.end());
+	sortInts_introSort(values.data(), values.size(), 0, nullptr);
+	EXPECT_EQ(expectedValues, values);
+
+	std::vector<KeyValue> keyValues(500);
+	for (uint32_t i = 0; i < keyValues.size(); ++i)
+	{
+		keyValues[i].key = (uint32_t)(random() % 1000);
+		keyValues[i].value = keyValues[i].key*2;
+	}
+
+	int reverse = 1;
+	sortKeyValues(keyValues.data(), keyValues.size(), &reverse);
+	for (uint32_t i = 1; i < keyValues.size(); ++i)
+	{
+		EXPECT_GE(keyValues[i - 1].key, keyValues[i].key);
+		EXPECT_EQ(keyValues[i].key*2, keyValues[i].value);
+	}
+}
+
+TEST(SortTest, RadixSortValues)
+{
+	std::mt19937_64 random(1234);
+	const uint32_t valueCount = 1000;
+
+	std::vector<uint32_t> values32(valueCount);
+	for (uint32_t& value : values32)
+		value = (uint32_t)random();
+	std::vector<uint32_t> expectedValues32 = values32;
+	std::sort(expectedValues32.begin(), expectedValues32.end());
+	std::vector<uint32_t> tempValues32(valueCount);
+	EXPECT_FALSE(dsRadixSortUInt32(values32.data(), nullptr, valueCount));
+	const uint32_t* sortedValues32 = dsRadixSortUInt32(values32.data(), tempValues32.data(),
+		valueCount);
+	ASSERT_TRUE(sortedValues32);
+	EXPECT_EQ(expectedValues32, std::vector<uint32_t>(sortedValues32, sortedValues32 + valueCount));
+
+	std::vector<uint64_t> values64(valueCount);
+	for (uint64_t& value : values64)
+		value = random() >> (random() % 64);
+	std::vector<uint64_t> expectedValues64 = values64;
+	std::sort(expectedValues64.begin(), expectedValues64.end());
+	std::vector<uint64_t> tempValues64(valueCount);
+	const uint64_t* sortedValues64 = dsRadixSortUInt64(values64.data(), tempValues64.data(),
+		valueCount);
+	ASSERT_TRUE(sortedValues64);
+	EXPECT_EQ(expectedValues64, std::vector<uint64_t>(sortedValues64, sortedValues64 + valueCount));
+
+	std::uniform_real_distribution<float> distribution(-1000.0f, 1000.0f);
+	std::vector<float> floatValues(valueCount);
+	for (float& value : floatValues)
+		value = distribution(random);
+	std::vector<float> expectedFloatValues = floatValues;
+	std::sort(expectedFloatValues.begin(), expectedFloatValues.end());
+	std::vector<float> tempFloatValues(valueCount);
+	const float* sortedFloatValues = dsRadixSortFloat(floatValues.data(), tempFloatValues.data(),
+		valueCount);
+	ASSERT_TRUE(sortedFloatValues);
+	EXPECT_EQ(expectedFloatValues,
+		std::vector<float>(sortedFloatValues, sortedFloatValues + valueCount));
+}
+
+TEST(SortTest, ParallelSort)
+{
+	dsSystemAllocator allocator;
+	ASSERT_TRUE(dsSystemAllocator_initialize(&allocator, DS_ALLOCATOR_NO_LIMIT));
+	dsThreadPool* threadPool = dsThreadPool_create((dsAllocator*)&allocator, 3, 0);
+	ASSERT_TRUE(threadPool);
+
+	EXPECT_FALSE_ERRNO(EINVAL, dsParallelSort(nullptr, 10, sizeof(int), &compareInt, nullptr,
+		(dsAllocator*)&allocator, threadPool));
+
+	std::mt19937 random(1234);
+	for (size_t count : {0, 100, 5000, 12345, 100000})
+	{
+		std::vector<int> values(count);
+		for (int& value : values)
+			value = (int)(random() % 100000);
+		std::vector<int> expectedValues = values;
+		std::sort(expectedValues.begin(), expectedValues.end());
+
+		std::vector<int> parallelValues = values;
+		EXPECT_TRUE(dsParallelSort(parallelValues.data(), count, sizeof(int), &compareInt,
+			nullptr, (dsAllocator*)&allocator, threadPool));
+		EXPECT_EQ(expectedValues, parallelValues);
+
+		// No thread pool should still sort.
+		parallelValues = values;
+		EXPECT_TRUE(dsParallelSort(parallelValues.data(), count, sizeof(int), &compareInt,
+			nullptr, (dsAllocator*)&allocator, nullptr));
+		EXPECT_EQ(expectedValues, parallelValues);
+	}
+
+	dsThreadPool_destroy(threadPool);
+	EXPECT_EQ(0U, ((dsAllocator*)&allocator)->size);
+}
+
+TEST(SortTest, RadixSortKeys)
+{
+	std::mt19937_64 random(1234);
+	const uint32_t keyCount = 1000;
+	std::vector<dsSortKey> keys(keyCount);
+	for (uint32_t i = 0; i < keyCount; ++i)
+	{
+		// Use few enough values for duplicates to check stability.
+		keys[i].key = random() % 100;
+		if (i % 2 == 0)
+			keys[i].key <<= 40;
+		keys[i].index = i;
+	}
+
+	std::vector<dsSortKey> expectedKeys = keys;
+	std::stable_sort(expectedKeys.begin(), expectedKeys.end(),
+		[](const dsSortKey& left, const dsSortKey& right) {return left.key < right.key;});
+
+	std::vector<dsSortKey> tempKeys(keyCount);
+	EXPECT_FALSE(dsRadixSortKeys(nullptr, tempKeys.data(), keyCount));
+	const dsSortKey* sortedKeys = dsRadixSortKeys(keys.data(), tempKeys.data(), keyCount);
+	ASSERT_TRUE(sortedKeys == keys.data() || sortedKeys == tempKeys.data());
+	for (uint32_t i = 0; i < keyCount; ++i)
+	{
+		EXPECT_EQ(expectedKeys[i].key, sortedKeys[i].key);
+		EXPECT_EQ(expectedKeys[i].index, sortedKeys[i].index);
+	}
+
+	// All keys identical shouldn't need any passes.
+	dsSortKey sameKeys[3] = {{5, 0}, {5, 1}, {5, 2}};
+	dsSortKey sameTempKeys[3];
+	sortedKeys = dsRadixSortKeys(sameKeys, sameTempKeys, 3);
+	EXPECT_EQ(sameKeys, sortedKeys);
+	EXPECT_EQ(0U, sortedKeys[0].index);
+	EXPECT_EQ(1U, sortedKeys[1].index);
+	EXPECT_EQ(2U, sortedKeys[2].index);
+}
+
+TEST(SortTest, InsertionSortKeys)
+{
+	dsSortKey keys[] = {{1, 0}, {3, 1}, {2, 2}, {4, 3}, {3, 4}, {5, 5}};
+	const size_t keyCount = DS_ARRAY_SIZE(keys);
+	EXPECT_TRUE(dsInsertionSortKeys(keys, keyCount, 2));
+	EXPECT_EQ(1U, keys[0].key);
+	EXPECT_EQ(2U, keys[1].key);
+	EXPECT_EQ(3U, keys[2].key);
+	EXPECT_EQ(1U, keys[2].index);
+	EXPECT_EQ(3U, keys[3].key);
+	EXPECT_EQ(4U, keys[3].index);
+	EXPECT_EQ(4U, keys[4].key);
+	EXPECT_EQ(5U, keys[5].key);
+
+	dsSortKey reverseKeys[] = {{4, 0}, {3, 1}, {2, 2}, {1, 3}};
+	EXPECT_FALSE(dsInsertionSortKeys(reverseKeys, DS_ARRAY_SIZE(reverseKeys), 3));
+	std::vector<uint32_t> indices;
+	for (const dsSortKey& key : reverseKeys)
+		indices.push_back(key.index);
+	std::sort(indices.begin(), indices.end());
+	EXPECT_EQ(std::vector<uint32_t>({0, 1, 2, 3}), indices);
+
+	EXPECT_TRUE(dsInsertionSortKeys(reverseKeys, DS_ARRAY_SIZE(reverseKeys), 6));
+	for (uint32_t i = 0; i < DS_ARRAY_SIZE(reverseKeys); ++i)
+		EXPECT_EQ(i + 1, reverseKeys[i].key);
+}
+
+TEST(SortTest, SortKeyFromFloat)
+{
+	const float values[] = {-1e10f, -2.5f, -1.0f, -0.5f, 0.0f, 0.5f, 1.0f, 2.5f, 1e10f};
+	for (size_t i = 1; i < DS_ARRAY_SIZE(values); ++i)
+		EXPECT_LT(dsSortKeyFromFloat(values[i - 1]), dsSortKeyFromFloat(values[i])) << i;
+}
+
+TEST(SortTest, DISABLED_SortKeysBenchmark)
+{
+	// Similar to draw items, comparing by several fields.
+	struct Item
+	{
+		uint32_t first;
+		uint32_t second;
+		uint32_t third;
+		uint32_t index;
+		uint8_t padding[32];
+	};
+
+	const uint32_t itemCount = 50000;
+	std::mt19937 random(1234);
+	std::vector<Item> items(itemCount);
+	for (uint32_t i = 0; i < itemCount; ++i)
+	{
+		items[i].first = random() % 64;
+		items[i].second = random() % 1024;
+		items[i].third = random() % 1024;
+		items[i].index = i;
+	}
+
+	auto compareItems = [](const void* left, const void* right, void*) -> int
+	{
+		const Item* leftItem = (const Item*)left;
+		const Item* rightItem = (const Item*)right;
+		if (leftItem->first != rightItem->first)
+			return leftItem->first < rightItem->first ? -1 : 1;
+		if (leftItem->second != rightItem->second)
+			return leftItem->second < rightItem->second ? -1 : 1;
+		if (leftItem->third != rightItem->third)
+			return leftItem->third < rightItem->third ? -1 : 1;
+		return (int)leftItem->index - (int)rightItem->index;
+	};
+
+	const unsigned int iterations = 10;
+	dsTimer timer = dsTimer_create();
+	double compareTime = 0;
+	for (unsigned int i = 0; i < iterations; ++i)
+	{
+		std::vector<Item> sortItems = items;
+		double start = dsTimer_time(timer);
+		dsSort(sortItems.data(), itemCount, sizeof(Item), compareItems, nullptr);
+		compareTime += dsTimer_time(timer) - start;
+	}
+
+	std::vector<dsSortKey> keys(itemCount);
+	std::vector<dsSortKey> tempKeys(itemCount);
+	double radixTime = 0;
+	const dsSortKey* sortedKeys = nullptr;
+	for (unsigned int i = 0; i < iterations; ++i)
+	{
+		double start = dsTimer_time(timer);
+		for (uint32_t j = 0; j < itemCount; ++j)
+		{
+			const Item& item = items[j];
+			keys[j].key = ((uint64_t)item.first << 40) | ((uint64_t)item.second << 20) | item.third;
+			keys[j].index = j;
+		}
+		sortedKeys = dsRadixSortKeys(keys.data(), tempKeys.data(), itemCount);
+		radixTime += dsTimer_time(timer) - start;
+	}
+
+	// Re-sort starting from the sorted order.
+	double resortTime = 0;
+	std::vector<dsSortKey> resortKeys(sortedKeys, sortedKeys + itemCount);
+	for (unsigned int i = 0; i < iterations; ++i)
+	{
+		double start = dsTimer_time(timer);
+		EXPECT_TRUE(dsInsertionSortKeys(resortKeys.data(), itemCount, itemCount));
+		resortTime += dsTimer_time(timer) - start;
+	}
+
+	// Average times in microseconds.
+	testing::Test::RecordProperty("itemCount", (int)itemCount);
+	testing::Test::RecordProperty("dsSort", (int)(compareTime/iterations*1000000.0));
+	testing::Test::RecordProperty("dsRadixSortKeys", (int)(radixTime/iterations*1000000.0));
+	testing::Test::RecordProperty("dsInsertionSortKeysPreSorted",
+		(int)(resortTime/iterations*1000000.0));
+}
+
 TEST(SortTest, BinarySearch)
 {
 	std::vector<int> values = {1, 2, 3, 4, 5};
@@ -137,3 +456,60 @@ TEST(SortTest, BinarySearchUpperBound)
 	EXPECT_EQ(values.data() + 9, dsBinarySearchUpperBound(&key, values.data(), values.size(),
 		sizeof(int), &compareInt, NULL));
 }
+
+TEST(SortTest, DISABLED_SortValuesBenchmark)
+{
+	dsSystemAllocator allocator;
+	ASSERT_TRUE(dsSystemAllocator_initialize(&allocator, DS_ALLOCATOR_NO_LIMIT));
+	dsThreadPool* threadPool = dsThreadPool_create((dsAllocator*)&allocator,
+		dsThread_logicalCoreCount() - 1, 0);
+	ASSERT_TRUE(threadPool);
+
+	const uint32_t valueCount = 1000000;
+	std::mt19937 random(1234);
+	std::vector<uint32_t> values(valueCount);
+	for (uint32_t& value : values)
+		value = (uint32_t)random();
+
+	auto compareUInt = [](const void* left, const void* right, void*) -> int
+	{
+		uint32_t leftValue = *(const uint32_t*)left;
+		uint32_t rightValue = *(const uint32_t*)right;
+		return leftValue < rightValue ? -1 : leftValue > rightValue;
+	};
+
+	dsTimer timer = dsTimer_create();
+	std::vector<uint32_t> sortValues = values;
+	double start = dsTimer_time(timer);
+	dsSort(sortValues.data(), valueCount, sizeof(uint32_t), compareUInt, nullptr);
+	double compareTime = dsTimer_time(timer) - start;
+
+	sortValues = values;
+	start = dsTimer_time(timer);
+	sortUInts(sortValues.data(), valueCount, nullptr);
+	double typedTime = dsTimer_time(timer) - start;
+
+	sortValues = values;
+	std::vector<uint32_t> tempValues(valueCount);
+	start = dsTimer_time(timer);
+	EXPECT_TRUE(dsRadixSortUInt32(sortValues.data(), tempValues.data(), valueCount));
+	double radixTime = dsTimer_time(timer) - start;
+
+	sortValues = values;
+	start = dsTimer_time(timer);
+	EXPECT_TRUE(dsParallelSort(sortValues.data(), valueCount, sizeof(uint32_t), compareUInt,
+		nullptr, (dsAllocator*)&allocator, threadPool));
+	double parallelTime = dsTimer_time(timer) - start;
+
+	// Times in microseconds.
+	testing::Test::RecordProperty("valueCount", (int)valueCount);
+	testing::Test::RecordProperty("threadCount",
+		(int)dsThreadPool_getThreadCount(threadPool) + 1);
+	testing::Test::RecordProperty("dsSort", (int)(compareTime*1000000.0));
+	testing::Test::RecordProperty("typedSort", (int)(typedTime*1000000.0));
+	testing::Test::RecordProperty("dsRadixSortUInt32", (int)(radixTime*1000000.0));
+	testing::Test::RecordProperty("dsParallelSort", (int)(parallelTime*1000000.0));
+
+	dsThreadPool_destroy(threadPool);
+	EXPECT_EQ(0U, ((dsAllocator*)&allocator)->size);
+}
@@ -0,0 +1,442 @@
+/*
+ * Copyright 2020 Aaron Barany
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "Helpers.h"
+#include <DeepSea/Core/Memory/Allocator.h>
+#include <DeepSea/Core/Memory/Memory.h>
+#include <DeepSea/Core/Memory/SystemAllocator.h>
+#include <DeepSea/Core/Memory/TLSFAllocator.h>
+#include <DeepSea/Core/Memory/TLSFOffsetAllocator.h>
+#include <DeepSea/Core/Thread/Thread.h>
+#include <gtest/gtest.h>
+#include <cstring>
+#include <random>
+#include <vector>
+
+namespace
+{
+
+struct ThreadData
+{
+	dsAllocator* allocator;
+	unsigned int seed;
+};
+
+dsThreadReturnType allocThreadFunc(void* data)
+{
+	auto threadData = reinterpret_cast<ThreadData*>(data);
+	std::mt19937 random(threadData->seed);
+	std::uniform_int_distribution<size_t> sizeDist(1, 500);
+
+	void* ptrs[32] = {};
+	for (unsigned int i = 0; i < 2000; ++i)
+	{
+		void*& ptr = ptrs[random() % DS_ARRAY_SIZE(ptrs)];
+		EXPECT_TRUE(dsAllocator_free(threadData->allocator, ptr));
+		size_t size = sizeDist(random);
+		ptr = dsAllocator_alloc(threadData->allocator, size);
+		EXPECT_NE(nullptr, ptr);
+		if (ptr)
+			std::memset(ptr, 0xFF, size);
+	}
+
+	for (void* ptr : ptrs)
+		EXPECT_TRUE(dsAllocator_free(threadData->allocator, ptr));
+	return 0;
+}
+
+} // namespace
+
+TEST(TLSFAllocatorTest, Initialize)
+{
+	alignas(DS_ALLOC_ALIGNMENT) uint8_t buffer[1024];
+	dsTLSFAllocator allocator;
+	EXPECT_FALSE_ERRNO(EINVAL, dsTLSFAllocator_initialize(nullptr, buffer, sizeof(buffer)));
+	EXPECT_FALSE_ERRNO(EINVAL, dsTLSFAllocator_initialize(&allocator, nullptr, sizeof(buffer)));
+	EXPECT_FALSE_ERRNO(EINVAL, dsTLSFAllocator_initialize(&allocator, buffer,
+		DS_TLSF_MIN_BUFFER_SIZE - 1));
+	EXPECT_FALSE_ERRNO(EINVAL, dsTLSFAllocator_initialize(&allocator, buffer + 1,
+		sizeof(buffer) - 1));
+
+	EXPECT_TRUE(dsTLSFAllocator_initialize(&allocator, buffer, sizeof(buffer)));
+	EXPECT_TRUE(dsTLSFAllocator_validate(&allocator));
+
+	dsTLSFFreeStats stats;
+	EXPECT_TRUE(dsTLSFAllocator_getFreeStats(&stats, &allocator));
+	EXPECT_EQ(sizeof(buffer) - DS_TLSF_BLOCK_HEADER_SIZE*2, stats.freeSize);
+	EXPECT_EQ(stats.freeSize, stats.largestFreeBlock);
+	EXPECT_EQ(1U, stats.freeBlockCount);
+	EXPECT_EQ(0.0f, stats.fragmentation);
+
+	dsTLSFAllocator_shutdown(&allocator);
+}
+
+TEST(TLSFAllocatorTest, AllocateFree)
+{
+	alignas(DS_ALLOC_ALIGNMENT) uint8_t buffer[1024];
+	dsTLSFAllocator allocator;
+	ASSERT_TRUE(dsTLSFAllocator_initialize(&allocator, buffer, sizeof(buffer)));
+	dsAllocator* baseAllocator = (dsAllocator*)&allocator;
+
+	EXPECT_NULL_ERRNO(EINVAL, dsTLSFAllocator_alloc(&allocator, 0, DS_ALLOC_ALIGNMENT));
+	EXPECT_NULL_ERRNO(EINVAL, dsTLSFAllocator_alloc(&allocator, 10, 3));
+	EXPECT_NULL_ERRNO(ENOMEM, dsAllocator_alloc(baseAllocator, sizeof(buffer)));
+
+	auto ptr1 = reinterpret_cast<uint8_t*>(dsAllocator_alloc(baseAllocator, 10));
+	ASSERT_NE(nullptr, ptr1);
+	EXPECT_EQ(buffer + DS_TLSF_BLOCK_HEADER_SIZE, ptr1);
+	EXPECT_EQ(DS_TLSF_BLOCK_HEADER_SIZE + 16U, baseAllocator->size);
+	EXPECT_EQ(1U, baseAllocator->currentAllocations);
+
+	auto ptr2 = reinterpret_cast<uint8_t*>(dsAllocator_alloc(baseAllocator, 100));
+	ASSERT_NE(nullptr, ptr2);
+	EXPECT_EQ(ptr1 + 16 + DS_TLSF_BLOCK_HEADER_SIZE, ptr2);
+
+	auto ptr3 = reinterpret_cast<uint8_t*>(dsAllocator_alloc(baseAllocator, 50));
+	ASSERT_NE(nullptr, ptr3);
+	EXPECT_EQ(ptr2 + 112 + DS_TLSF_BLOCK_HEADER_SIZE, ptr3);
+	EXPECT_EQ(3U, baseAllocator->currentAllocations);
+	EXPECT_TRUE(dsTLSFAllocator_validate(&allocator));
+
+	EXPECT_FALSE_ERRNO(EINVAL, dsAllocator_free(baseAllocator, buffer + sizeof(buffer)));
+
+	// Freeing the middle allocation leaves a hole that's re-used for a smaller allocation.
+	EXPECT_TRUE(dsAllocator_free(baseAllocator, ptr2));
+	EXPECT_TRUE(dsTLSFAllocator_validate(&allocator));
+
+	dsTLSFFreeStats stats;
+	EXPECT_TRUE(dsTLSFAllocator_getFreeStats(&stats, &allocator));
+	EXPECT_EQ(2U, stats.freeBlockCount);
+	EXPECT_LT(0.0f, stats.fragmentation);
+
+	EXPECT_EQ(ptr2, dsAllocator_alloc(baseAllocator, 20));
+	EXPECT_TRUE(dsTLSFAllocator_validate(&allocator));
+
+	// Merges with the free blocks on both sides.
+	EXPECT_TRUE(dsAllocator_free(baseAllocator, ptr3));
+	EXPECT_TRUE(dsAllocator_free(baseAllocator, ptr1));
+	EXPECT_TRUE(dsAllocator_free(baseAllocator, ptr2));
+	EXPECT_TRUE(dsTLSFAllocator_validate(&allocator));
+	EXPECT_EQ(0U, baseAllocator->size);
+	EXPECT_EQ(0U, baseAllocator->currentAllocations);
+
+	EXPECT_TRUE(dsTLSFAllocator_getFreeStats(&stats, &allocator));
+	EXPECT_EQ(1U, stats.freeBlockCount);
+	EXPECT_EQ(sizeof(buffer) - DS_TLSF_BLOCK_HEADER_SIZE*2, stats.largestFreeBlock);
+
+	dsTLSFAllocator_shutdown(&allocator);
+}
+
+TEST(TLSFAllocatorTest, Alignment)
+{
+	alignas(256) uint8_t buffer[2048];
+	dsTLSFAllocator allocator;
+	ASSERT_TRUE(dsTLSFAllocator_initialize(&allocator, buffer, sizeof(buffer)));
+
+	void* ptr1 = dsTLSFAllocator_alloc(&allocator, 10, DS_ALLOC_ALIGNMENT);
+	ASSERT_NE(nullptr, ptr1);
+
+	void* ptr2 = dsTLSFAllocator_alloc(&allocator, 100, 256);
+	ASSERT_NE(nullptr, ptr2);
+	EXPECT_EQ(0U, (uintptr_t)ptr2 % 256);
+	EXPECT_TRUE(dsTLSFAllocator_validate(&allocator));
+
+	// The space before the aligned allocation is re-used.
+	void* ptr3 = dsTLSFAllocator_alloc(&allocator, 32, DS_ALLOC_ALIGNMENT);
+	ASSERT_NE(nullptr, ptr3);
+	EXPECT_LT(ptr3, ptr2);
+	EXPECT_TRUE(dsTLSFAllocator_validate(&allocator));
+
+	EXPECT_TRUE(dsTLSFAllocator_free(&allocator, ptr2));
+	EXPECT_TRUE(dsTLSFAllocator_free(&allocator, ptr3));
+	EXPECT_TRUE(dsTLSFAllocator_free(&allocator, ptr1));
+	EXPECT_TRUE(dsTLSFAllocator_validate(&allocator));
+	EXPECT_EQ(0U, ((dsAllocator*)&allocator)->size);
+
+	dsTLSFAllocator_shutdown(&allocator);
+}
+
+TEST(TLSFAllocatorTest, Reallocate)
+{
+	alignas(DS_ALLOC_ALIGNMENT) uint8_t buffer[1024];
+	dsTLSFAllocator allocator;
+	ASSERT_TRUE(dsTLSFAllocator_initialize(&allocator, buffer, sizeof(buffer)));
+	dsAllocator* baseAllocator = (dsAllocator*)&allocator;
+
+	auto ptr1 = reinterpret_cast<uint8_t*>(dsAllocator_realloc(baseAllocator, nullptr, 16));
+	ASSERT_NE(nullptr, ptr1);
+	for (uint8_t i = 0; i < 16; ++i)
+		ptr1[i] = i;
+
+	// Grows in place into the free space following it.
+	EXPECT_EQ(ptr1, dsAllocator_realloc(baseAllocator, ptr1, 200));
+	EXPECT_EQ(DS_TLSF_BLOCK_HEADER_SIZE + 208U, baseAllocator->size);
+	EXPECT_TRUE(dsTLSFAllocator_validate(&allocator));
+
+	// Shrinks in place.
+	EXPECT_EQ(ptr1, dsAllocator_realloc(baseAllocator, ptr1, 32));
+	EXPECT_EQ(DS_TLSF_BLOCK_HEADER_SIZE + 32U, baseAllocator->size);
+	EXPECT_TRUE(dsTLSFAllocator_validate(&allocator));
+
+	// Moves when blocked by another allocation.
+	void* ptr2 = dsAllocator_alloc(baseAllocator, 16);
+	ASSERT_NE(nullptr, ptr2);
+	auto ptr3 = reinterpret_cast<uint8_t*>(dsAllocator_realloc(baseAllocator, ptr1, 100));
+	ASSERT_NE(nullptr, ptr3);
+	EXPECT_NE(ptr1, ptr3);
+	for (uint8_t i = 0; i < 16; ++i)
+		EXPECT_EQ(i, ptr3[i]);
+	EXPECT_EQ(2U, baseAllocator->currentAllocations);
+	EXPECT_TRUE(dsTLSFAllocator_validate(&allocator));
+
+	EXPECT_NULL_ERRNO(ENOMEM, dsAllocator_realloc(baseAllocator, ptr3, sizeof(buffer)));
+	EXPECT_TRUE(dsTLSFAllocator_validate(&allocator));
+
+	EXPECT_EQ(nullptr, dsAllocator_realloc(baseAllocator, ptr3, 0));
+	EXPECT_TRUE(dsAllocator_free(baseAllocator, ptr2));
+	EXPECT_EQ(0U, baseAllocator->size);
+	EXPECT_TRUE(dsTLSFAllocator_validate(&allocator));
+
+	dsTLSFAllocator_shutdown(&allocator);
+}
+
+TEST(TLSFAllocatorTest, RandomAllocations)
+{
+	const size_t bufferSize = 1024*1024;
+	dsSystemAllocator systemAllocator;
+	ASSERT_TRUE(dsSystemAllocator_initialize(&systemAllocator, DS_ALLOCATOR_NO_LIMIT));
+	void* buffer = dsAllocator_alloc((dsAllocator*)&systemAllocator, bufferSize);
+	ASSERT_TRUE(buffer);
+
+	dsTLSFAllocator allocator;
+	ASSERT_TRUE(dsTLSFAllocator_initialize(&allocator, buffer, bufferSize));
+
+	std::mt19937 random(123);
+	std::uniform_int_distribution<size_t> sizeDist(1, 5000);
+	std::vector<void*> ptrs(200, nullptr);
+	for (unsigned int i = 0; i < 5000; ++i)
+	{
+		void*& ptr = ptrs[random() % ptrs.size()];
+		switch (random() % 3)
+		{
+			case 0:
+				EXPECT_TRUE(dsTLSFAllocator_free(&allocator, ptr));
+				ptr = dsTLSFAllocator_alloc(&allocator, sizeDist(random), 1U << (random() % 8));
+				break;
+			case 1:
+				ptr = dsTLSFAllocator_realloc(&allocator, ptr, sizeDist(random),
+					DS_ALLOC_ALIGNMENT);
+				break;
+			default:
+				EXPECT_TRUE(dsTLSFAllocator_free(&allocator, ptr));
+				ptr = nullptr;
+				break;
+		}
+		ASSERT_TRUE(dsTLSFAllocator_validate(&allocator));
+	}
+
+	for (void* ptr : ptrs)
+		EXPECT_TRUE(dsTLSFAllocator_free(&allocator, ptr));
+	EXPECT_TRUE(dsTLSFAllocator_validate(&allocator));
+	EXPECT_EQ(0U, ((dsAllocator*)&allocator)->size);
+
+	dsTLSFFreeStats stats;
+	EXPECT_TRUE(dsTLSFAllocator_getFreeStats(&stats, &allocator));
+	EXPECT_EQ(1U, stats.freeBlockCount);
+
+	dsTLSFAllocator_shutdown(&allocator);
+	EXPECT_TRUE(dsAllocator_free((dsAllocator*)&systemAllocator, buffer));
+}
+
+TEST(TLSFAllocatorTest, ThreadAlloc)
+{
+	const unsigned int threadCount = 8;
+	const size_t bufferSize = 1024*1024;
+	dsSystemAllocator systemAllocator;
+	ASSERT_TRUE(dsSystemAllocator_initialize(&systemAllocator, DS_ALLOCATOR_NO_LIMIT));
+	void* buffer = dsAllocator_alloc((dsAllocator*)&systemAllocator, bufferSize);
+	ASSERT_TRUE(buffer);
+
+	dsTLSFAllocator allocator;
+	ASSERT_TRUE(dsTLSFAllocator_initialize(&allocator, buffer, bufferSize));
+
+	dsThread threads[threadCount];
+	ThreadData threadData[threadCount];
+	for (unsigned int i = 0; i < threadCount; ++i)
+	{
+		threadData[i].allocator = (dsAllocator*)&allocator;
+		threadData[i].seed = i;
+		EXPECT_TRUE(dsThread_create(threads + i, &allocThreadFunc, threadData + i, 0, nullptr));
+	}
+
+	for (unsigned int i = 0; i < threadCount; ++i)
+		EXPECT_TRUE(dsThread_join(threads + i, nullptr));
+
+	EXPECT_TRUE(dsTLSFAllocator_validate(&allocator));
+	EXPECT_EQ(0U, ((dsAllocator*)&allocator)->size);
+	EXPECT_EQ(threadCount*2000, ((dsAllocator*)&allocator)->totalAllocations);
+
+	dsTLSFAllocator_shutdown(&allocator);
+	EXPECT_TRUE(dsAllocator_free((dsAllocator*)&systemAllocator, buffer));
+}
+
+TEST(TLSFOffsetAllocatorTest, AllocateFree)
+{
+	dsSystemAllocator systemAllocator;
+	ASSERT_TRUE(dsSystemAllocator_initialize(&systemAllocator, DS_ALLOCATOR_NO_LIMIT));
+	EXPECT_NULL_ERRNO(EINVAL, dsTLSFOffsetAllocator_create(nullptr, 1024, 4));
+	EXPECT_NULL_ERRNO(EINVAL, dsTLSFOffsetAllocator_create((dsAllocator*)&systemAllocator, 10,
+		4));
+	EXPECT_NULL_ERRNO(EINVAL, dsTLSFOffsetAllocator_create((dsAllocator*)&systemAllocator, 1024,
+		0));
+
+	dsTLSFOffsetAllocator* allocator =
+		dsTLSFOffsetAllocator_create((dsAllocator*)&systemAllocator, 1024, 4);
+	ASSERT_TRUE(allocator);
+
+	size_t offset;
+	EXPECT_EQ_ERRNO(EINVAL, DS_INVALID_TLSF_HANDLE,
+		dsTLSFOffsetAllocator_alloc(&offset, allocator, 0, 1));
+	EXPECT_EQ_ERRNO(ENOMEM, DS_INVALID_TLSF_HANDLE,
+		dsTLSFOffsetAllocator_alloc(&offset, allocator, 1025, 1));
+
+	uint32_t handle1 = dsTLSFOffsetAllocator_alloc(&offset, allocator, 10, 1);
+	ASSERT_NE(DS_INVALID_TLSF_HANDLE, handle1);
+	EXPECT_EQ(0U, offset);
+	EXPECT_EQ(16U, dsTLSFOffsetAllocator_getSize(allocator, handle1));
+
+	uint32_t handle2 = dsTLSFOffsetAllocator_alloc(&offset, allocator, 100, 256);
+	ASSERT_NE(DS_INVALID_TLSF_HANDLE, handle2);
+	EXPECT_EQ(256U, offset);
+	EXPECT_EQ(256U, dsTLSFOffsetAllocator_getOffset(allocator, handle2));
+	EXPECT_TRUE(dsTLSFOffsetAllocator_validate(allocator));
+
+	// Re-uses the space before the aligned allocation.
+	uint32_t handle3 = dsTLSFOffsetAllocator_alloc(&offset, allocator, 100, 1);
+	ASSERT_NE(DS_INVALID_TLSF_HANDLE, handle3);
+	EXPECT_EQ(16U, offset);
+
+	uint32_t handle4 = dsTLSFOffsetAllocator_alloc(&offset, allocator, 100, 1);
+	ASSERT_NE(DS_INVALID_TLSF_HANDLE, handle4);
+	EXPECT_EQ_ERRNO(ENOMEM, DS_INVALID_TLSF_HANDLE,
+		dsTLSFOffsetAllocator_alloc(&offset, allocator, 10, 1));
+	EXPECT_TRUE(dsTLSFOffsetAllocator_validate(allocator));
+
+	dsTLSFFreeStats stats;
+	EXPECT_TRUE(dsTLSFOffsetAllocator_getFreeStats(&stats, allocator));
+	EXPECT_EQ(1024U - 16U - 112U*3, stats.freeSize);
+
+	EXPECT_TRUE(dsTLSFOffsetAllocator_free(allocator, handle3));
+	EXPECT_FALSE_ERRNO(EINVAL, dsTLSFOffsetAllocator_free(allocator, handle3));
+	EXPECT_TRUE(dsTLSFOffsetAllocator_free(allocator, handle1));
+	EXPECT_TRUE(dsTLSFOffsetAllocator_free(allocator, handle4));
+	EXPECT_TRUE(dsTLSFOffsetAllocator_free(allocator, handle2));
+	EXPECT_TRUE(dsTLSFOffsetAllocator_validate(allocator));
+
+	EXPECT_TRUE(dsTLSFOffsetAllocator_getFreeStats(&stats, allocator));
+	EXPECT_EQ(1024U, stats.freeSize);
+	EXPECT_EQ(1024U, stats.largestFreeBlock);
+	EXPECT_EQ(1U, stats.freeBlockCount);
+
+	dsTLSFOffsetAllocator_destroy(allocator);
+	EXPECT_EQ(0U, ((dsAllocator*)&systemAllocator)->size);
+}
+
+TEST(TLSFOffsetAllocatorTest, Resize)
+{
+	dsSystemAllocator systemAllocator;
+	ASSERT_TRUE(dsSystemAllocator_initialize(&systemAllocator, DS_ALLOCATOR_NO_LIMIT));
+	dsTLSFOffsetAllocator* allocator =
+		dsTLSFOffsetAllocator_create((dsAllocator*)&systemAllocator, 1024, 4);
+	ASSERT_TRUE(allocator);
+
+	size_t offset;
+	uint32_t handle1 = dsTLSFOffsetAllocator_alloc(&offset, allocator, 100, 1);
+	ASSERT_NE(DS_INVALID_TLSF_HANDLE, handle1);
+
+	EXPECT_TRUE(dsTLSFOffsetAllocator_resize(allocator, handle1, 500));
+	EXPECT_EQ(512U, dsTLSFOffsetAllocator_getSize(allocator, handle1));
+	EXPECT_TRUE(dsTLSFOffsetAllocator_validate(allocator));
+
+	EXPECT_TRUE(dsTLSFOffsetAllocator_resize(allocator, handle1, 50));
+	EXPECT_EQ(64U, dsTLSFOffsetAllocator_getSize(allocator, handle1));
+	EXPECT_TRUE(dsTLSFOffsetAllocator_validate(allocator));
+
+	uint32_t handle2 = dsTLSFOffsetAllocator_alloc(&offset, allocator, 100, 1);
+	ASSERT_NE(DS_INVALID_TLSF_HANDLE, handle2);
+	EXPECT_EQ(64U, offset);
+	EXPECT_FALSE_ERRNO(ENOMEM, dsTLSFOffsetAllocator_resize(allocator, handle1, 100));
+	EXPECT_TRUE(dsTLSFOffsetAllocator_resize(allocator, handle2, 900));
+	EXPECT_TRUE(dsTLSFOffsetAllocator_validate(allocator));
+
+	dsTLSFOffsetAllocator_reset(allocator);
+	EXPECT_TRUE(dsTLSFOffsetAllocator_validate(allocator));
+	EXPECT_EQ(0U, dsTLSFOffsetAllocator_getSize(allocator, handle1));
+
+	dsTLSFOffsetAllocator_destroy(allocator);
+	EXPECT_EQ(0U, ((dsAllocator*)&systemAllocator)->size);
+}
+
+TEST(TLSFOffsetAllocatorTest, RandomAllocations)
+{
+	const uint32_t maxAllocations = 100;
+	dsSystemAllocator systemAllocator;
+	ASSERT_TRUE(dsSystemAllocator_initialize(&systemAllocator, DS_ALLOCATOR_NO_LIMIT));
+	dsTLSFOffsetAllocator* allocator =
+		dsTLSFOffsetAllocator_create((dsAllocator*)&systemAllocator, 1024*1024, maxAllocations);
+	ASSERT_TRUE(allocator);
+
+	std::mt19937 random(456);
+	std::uniform_int_distribution<size_t> sizeDist(1, 20000);
+	std::vector<uint32_t> handles(maxAllocations, DS_INVALID_TLSF_HANDLE);
+	for (unsigned int i = 0; i < 5000; ++i)
+	{
+		uint32_t& handle = handles[random() % handles.size()];
+		if (handle == DS_INVALID_TLSF_HANDLE)
+		{
+			size_t offset;
+			size_t alignment = (size_t)1 << (random() % 10);
+			handle = dsTLSFOffsetAllocator_alloc(&offset, allocator, sizeDist(random), alignment);
+			ASSERT_NE(DS_INVALID_TLSF_HANDLE, handle);
+			EXPECT_EQ(0U, offset % alignment);
+		}
+		else if (random() % 2)
+			dsTLSFOffsetAllocator_resize(allocator, handle, sizeDist(random));
+		else
+		{
+			EXPECT_TRUE(dsTLSFOffsetAllocator_free(allocator, handle));
+			handle = DS_INVALID_TLSF_HANDLE;
+		}
+		ASSERT_TRUE(dsTLSFOffsetAllocator_validate(allocator));
+	}
+
+	for (uint32_t handle : handles)
+	{
+		if (handle != DS_INVALID_TLSF_HANDLE)
+		{
+			EXPECT_TRUE(dsTLSFOffsetAllocator_free(allocator, handle));
+		}
+	}
+	EXPECT_TRUE(dsTLSFOffsetAllocator_validate(allocator));
+
+	dsTLSFFreeStats stats;
+	EXPECT_TRUE(dsTLSFOffsetAllocator_getFreeStats(&stats, allocator));
+	EXPECT_EQ(1024U*1024U, stats.freeSize);
+	EXPECT_EQ(1U, stats.freeBlockCount);
+
+	dsTLSFOffsetAllocator_destroy(allocator);
+	EXPECT_EQ(0U, ((dsAllocator*)&systemAllocator)->size);
+}
@@ -0,0 +1,291 @@
+/*
+ * Copyright 2020 Aaron Barany
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "Helpers.h"
+#include <DeepSea/Core/Memory/SystemAllocator.h>
+#include <DeepSea/Core/Thread/TaskGraph.h>
+#include <DeepSea/Core/Thread/Thread.h>
+#include <DeepSea/Core/Thread/ThreadPool.h>
+#include <DeepSea/Core/Atomic.h>
+#include <DeepSea/Core/Timer.h>
+#include <gtest/gtest.h>
+#include <vector>
+
+namespace
+{
+
+struct OrderData
+{
+	int32_t nextOrder;
+	std::vector<int32_t> order;
+};
+
+struct OrderTask
+{
+	OrderData* data;
+	uint32_t index;
+};
+
+struct NestedTask
+{
+	dsTaskGraph* taskGraph;
+	bool success;
+};
+
+void incrementTask(void* userData)
+{
+	DS_ATOMIC_FETCH_ADD32((int32_t*)userData, 1);
+}
+
+void orderTask(void* userData)
+{
+	OrderTask* task = (OrderTask*)userData;
+	task->data->order[task->index] = DS_ATOMIC_FETCH_ADD32(&task->data->nextOrder, 1);
+}
+
+void nestedTask(void* userData)
+{
+	NestedTask* task = (NestedTask*)userData;
+	task->success = dsTaskGraph_execute(task->taskGraph);
+}
+
+void emptyTask(void*)
+{
+}
+
+} // namespace
+
+class TaskGraphTest : public testing::Test
+{
+public:
+	void SetUp() override
+	{
+		ASSERT_TRUE(dsSystemAllocator_initialize(&allocator, DS_ALLOCATOR_NO_LIMIT));
+		threadPool = dsThreadPool_create((dsAllocator*)&allocator, 4, 0);
+		ASSERT_TRUE(threadPool);
+	}
+
+	void TearDown() override
+	{
+		dsThreadPool_destroy(threadPool);
+		EXPECT_EQ(0U, ((dsAllocator*)&allocator)->size);
+	}
+
+	dsSystemAllocator allocator;
+	dsThreadPool* threadPool;
+};
+
+TEST_F(TaskGraphTest, Create)
+{
+	EXPECT_NULL_ERRNO(EINVAL, dsTaskGraph_create(nullptr, threadPool));
+	EXPECT_NULL_ERRNO(EINVAL, dsTaskGraph_create((dsAllocator*)&allocator, nullptr));
+
+	dsTaskGraph* taskGraph = dsTaskGraph_create((dsAllocator*)&allocator, threadPool);
+	ASSERT_TRUE(taskGraph);
+	EXPECT_EQ(0U, dsTaskGraph_getTaskCount(taskGraph));
+	EXPECT_TRUE(dsTaskGraph_execute(taskGraph));
+	dsTaskGraph_destroy(taskGraph);
+}
+
+TEST_F(TaskGraphTest, IndependentTasks)
+{
+	dsTaskGraph* taskGraph = dsTaskGraph_create((dsAllocator*)&allocator, threadPool);
+	ASSERT_TRUE(taskGraph);
+
+	EXPECT_EQ_ERRNO(EINVAL, DS_NO_TASK, dsTaskGraph_addTask(taskGraph, nullptr, nullptr));
+
+	// More than a single worker queue can hold.
+	const uint32_t taskCount = DS_THREAD_POOL_MAX_WORKER_TASKS*3;
+	int32_t counter = 0;
+	for (uint32_t i = 0; i < taskCount; ++i)
+		EXPECT_EQ(i, dsTaskGraph_addTask(taskGraph, &incrementTask, &counter));
+	EXPECT_EQ(taskCount, dsTaskGraph_getTaskCount(taskGraph));
+
+	EXPECT_TRUE(dsTaskGraph_execute(taskGraph));
+	EXPECT_EQ((int32_t)taskCount, counter);
+
+	EXPECT_TRUE(dsTaskGraph_execute(taskGraph));
+	EXPECT_EQ((int32_t)taskCount*2, counter);
+
+	EXPECT_TRUE(dsTaskGraph_clear(taskGraph));
+	EXPECT_EQ(0U, dsTaskGraph_getTaskCount(taskGraph));
+	EXPECT_TRUE(dsTaskGraph_execute(taskGraph));
+	EXPECT_EQ((int32_t)taskCount*2, counter);
+
+	dsTaskGraph_destroy(taskGraph);
+}
+
+TEST_F(TaskGraphTest, Dependencies)
+{
+	dsTaskGraph* taskGraph = dsTaskGraph_create((dsAllocator*)&allocator, threadPool);
+	ASSERT_TRUE(taskGraph);
+
+	// Fan out from a single root to many tasks, each with a chain of continuations, then join to a
+	// single final task.
+	const uint32_t branchCount = 64;
+	const uint32_t chainLength = 8;
+	const uint32_t taskCount = branchCount*chainLength + 2;
+	OrderData data;
+	data.nextOrder = 0;
+	data.order.resize(taskCount);
+	std::vector<OrderTask> tasks(taskCount);
+	for (uint32_t i = 0; i < taskCount; ++i)
+	{
+		tasks[i].data = &data;
+		tasks[i].index = i;
+		EXPECT_EQ(i, dsTaskGraph_addTask(taskGraph, &orderTask, &tasks[i]));
+	}
+
+	const uint32_t root = 0;
+	const uint32_t final = taskCount - 1;
+	for (uint32_t i = 0; i < branchCount; ++i)
+	{
+		uint32_t prevTask = root;
+		for (uint32_t j = 0; j < chainLength; ++j)
+		{
+			uint32_t task = 1 + i*chainLength + j;
+			EXPECT_TRUE(dsTaskGraph_addDependency(taskGraph, task, prevTask));
+			prevTask = task;
+		}
+		EXPECT_TRUE(dsTaskGraph_addDependency(taskGraph, final, prevTask));
+	}
+
+	EXPECT_FALSE_ERRNO(EINVAL, dsTaskGraph_addDependency(taskGraph, root, root));
+	EXPECT_FALSE_ERRNO(EINVAL, dsTaskGraph_addDependency(taskGraph, root, taskCount));
+
+	for (unsigned int iteration = 0; iteration < 2; ++iteration)
+	{
+		data.nextOrder = 0;
+		EXPECT_TRUE(dsTaskGraph_execute(taskGraph));
+		EXPECT_EQ((int32_t)taskCount, data.nextOrder);
+
+		EXPECT_EQ(0, data.order[root]);
+		EXPECT_EQ((int32_t)taskCount - 1, data.order[final]);
+		for (uint32_t i = 0; i < branchCount; ++i)
+		{
+			for (uint32_t j = 1; j < chainLength; ++j)
+			{
+				uint32_t task = 1 + i*chainLength + j;
+				EXPECT_LT(data.order[task - 1], data.order[task]);
+			}
+		}
+	}
+
+	dsTaskGraph_destroy(taskGraph);
+}
+
+TEST_F(TaskGraphTest, Cycle)
+{
+	dsTaskGraph* taskGraph = dsTaskGraph_create((dsAllocator*)&allocator, threadPool);
+	ASSERT_TRUE(taskGraph);
+
+	int32_t counter = 0;
+	uint32_t task0 = dsTaskGraph_addTask(taskGraph, &incrementTask, &counter);
+	uint32_t task1 = dsTaskGraph_addTask(taskGraph, &incrementTask, &counter);
+	uint32_t task2 = dsTaskGraph_addTask(taskGraph, &incrementTask, &counter);
+	EXPECT_TRUE(dsTaskGraph_addDependency(taskGraph, task1, task0));
+	EXPECT_TRUE(dsTaskGraph_addDependency(taskGraph, task2, task1));
+	EXPECT_TRUE(dsTaskGraph_addDependency(taskGraph, task1, task2));
+
+	EXPECT_FALSE_ERRNO(EINVAL, dsTaskGraph_execute(taskGraph));
+	EXPECT_EQ(0, counter);
+
+	dsTaskGraph_destroy(taskGraph);
+}
+
+TEST_F(TaskGraphTest, Nested)
+{
+	const uint32_t outerTaskCount = 16;
+	const uint32_t innerTaskCount = 256;
+	int32_t counter = 0;
+
+	dsTaskGraph* taskGraph = dsTaskGraph_create((dsAllocator*)&allocator, threadPool);
+	ASSERT_TRUE(taskGraph);
+
+	std::vector<NestedTask> nestedTasks(outerTaskCount);
+	for (uint32_t i = 0; i < outerTaskCount; ++i)
+	{
+		nestedTasks[i].taskGraph = dsTaskGraph_create((dsAllocator*)&allocator, threadPool);
+		ASSERT_TRUE(nestedTasks[i].taskGraph);
+		nestedTasks[i].success = false;
+		for (uint32_t j = 0; j < innerTaskCount; ++j)
+		{
+			EXPECT_NE(DS_NO_TASK, dsTaskGraph_addTask(nestedTasks[i].taskGraph, &incrementTask,
+				&counter));
+		}
+
+		EXPECT_NE(DS_NO_TASK, dsTaskGraph_addTask(taskGraph, &nestedTask, &nestedTasks[i]));
+	}
+
+	EXPECT_TRUE(dsTaskGraph_execute(taskGraph));
+	EXPECT_EQ((int32_t)(outerTaskCount*innerTaskCount), counter);
+
+	for (uint32_t i = 0; i < outerTaskCount; ++i)
+	{
+		EXPECT_TRUE(nestedTasks[i].success);
+		dsTaskGraph_destroy(nestedTasks[i].taskGraph);
+	}
+	dsTaskGraph_destroy(taskGraph);
+}
+
+TEST(TaskGraph, DISABLED_ThroughputBenchmark)
+{
+	dsSystemAllocator allocator;
+	ASSERT_TRUE(dsSystemAllocator_initialize(&allocator, DS_ALLOCATOR_NO_LIMIT));
+
+	unsigned int coreCount = dsThread_logicalCoreCount();
+	unsigned int threadCount = coreCount > 1 ? coreCount - 1 : 0;
+	dsThreadPool* threadPool = dsThreadPool_create((dsAllocator*)&allocator, threadCount, 0);
+	ASSERT_TRUE(threadPool);
+	dsTaskGraph* taskGraph = dsTaskGraph_create((dsAllocator*)&allocator, threadPool);
+	ASSERT_TRUE(taskGraph);
+
+	// Independent tasks measure queue and steal overhead, chained tasks measure continuation
+	// overhead.
+	const uint32_t taskCount = 1 << 20;
+	const uint32_t chainLength = 16;
+	for (uint32_t i = 0; i < taskCount; ++i)
+		ASSERT_NE(DS_NO_TASK, dsTaskGraph_addTask(taskGraph, &emptyTask, nullptr));
+
+	EXPECT_TRUE(dsTaskGraph_execute(taskGraph));
+	dsTimer timer = dsTimer_create();
+	double start = dsTimer_time(timer);
+	EXPECT_TRUE(dsTaskGraph_execute(taskGraph));
+	double independentTime = dsTimer_time(timer) - start;
+
+	for (uint32_t i = 0; i < taskCount; ++i)
+	{
+		if (i % chainLength != 0)
+		{
+			ASSERT_TRUE(dsTaskGraph_addDependency(taskGraph, i, i - 1));
+		}
+	}
+
+	// First execution also validates the graph.
+	EXPECT_TRUE(dsTaskGraph_execute(taskGraph));
+	start = dsTimer_time(timer);
+	EXPECT_TRUE(dsTaskGraph_execute(taskGraph));
+	double chainedTime = dsTimer_time(timer) - start;
+
+	// Throughput in thousands of tasks per second.
+	testing::Test::RecordProperty("workerThreads", (int)threadCount);
+	testing::Test::RecordProperty("independentTasks", (int)(taskCount/independentTime/1000.0));
+	testing::Test::RecordProperty("chainedTasks", (int)(taskCount/chainedTime/1000.0));
+
+	dsTaskGraph_destroy(taskGraph);
+	dsThreadPool_destroy(threadPool);
+	EXPECT_EQ(0U, ((dsAllocator*)&allocator)->size);
+}
@@ -0,0 +1,305 @@
+/*
+ * Copyright 2020 Aaron Barany
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "Helpers.h"
+#include <DeepSea/Core/Memory/Allocator.h>
+#include <DeepSea/Core/Memory/Memory.h>
+#include <DeepSea/Core/Memory/SystemAllocator.h>
+#include <DeepSea/Core/Memory/ThreadCacheAllocator.h>
+#include <DeepSea/Core/Thread/Thread.h>
+#include <DeepSea/Core/Timer.h>
+#include <gtest/gtest.h>
+#include <cstring>
+
+namespace
+{
+
+struct BenchmarkData
+{
+	dsAllocator* allocator;
+	bool flush;
+};
+
+dsThreadReturnType allocThreadFunc(void* data)
+{
+	auto allocator = reinterpret_cast<dsThreadCacheAllocator*>(data);
+	void* ptrs[100];
+	for (unsigned int i = 0; i < 100; ++i)
+	{
+		ptrs[i] = dsAllocator_alloc((dsAllocator*)allocator, 16 + i*8);
+		EXPECT_NE(nullptr, ptrs[i]);
+		std::memset(ptrs[i], (int)i, 16 + i*8);
+	}
+
+	for (unsigned int i = 0; i < 100; ++i)
+	{
+		auto bytes = reinterpret_cast<uint8_t*>(ptrs[i]);
+		EXPECT_EQ(i, bytes[0]);
+		EXPECT_EQ(i, bytes[15 + i*8]);
+		EXPECT_TRUE(dsAllocator_free((dsAllocator*)allocator, ptrs[i]));
+	}
+
+	EXPECT_TRUE(dsThreadCacheAllocator_flushThread(allocator));
+	return 0;
+}
+
+dsThreadReturnType freeThreadFunc(void* data)
+{
+	auto ptrs = reinterpret_cast<void**>(data);
+	auto allocator = reinterpret_cast<dsThreadCacheAllocator*>(ptrs[0]);
+	for (unsigned int i = 1; i < 10; ++i)
+		EXPECT_TRUE(dsAllocator_free((dsAllocator*)allocator, ptrs[i]));
+	EXPECT_TRUE(dsThreadCacheAllocator_flushThread(allocator));
+	return 0;
+}
+
+dsThreadReturnType benchmarkThreadFunc(void* data)
+{
+	auto benchmarkData = reinterpret_cast<BenchmarkData*>(data);
+	void* ptrs[64];
+	for (unsigned int i = 0; i < 10000; ++i)
+	{
+		for (unsigned int j = 0; j < 64; ++j)
+			ptrs[j] = dsAllocator_alloc(benchmarkData->allocator, 16 + (j % 16)*16);
+		for (unsigned int j = 0; j < 64; ++j)
+			dsAllocator_free(benchmarkData->allocator, ptrs[j]);
+	}
+
+	if (benchmarkData->flush)
+	{
+		dsThreadCacheAllocator_flushThread(
+			reinterpret_cast<dsThreadCacheAllocator*>(benchmarkData->allocator));
+	}
+	return 0;
+}
+
+double runBenchmark(dsAllocator* allocator, bool flush, unsigned int threadCount)
+{
+	BenchmarkData data = {allocator, flush};
+	dsThread threads[16];
+	dsTimer timer = dsTimer_create();
+	double start = dsTimer_time(timer);
+	for (unsigned int i = 0; i < threadCount; ++i)
+		EXPECT_TRUE(dsThread_create(threads + i, &benchmarkThreadFunc, &data, 0, nullptr));
+	for (unsigned int i = 0; i < threadCount; ++i)
+		EXPECT_TRUE(dsThread_join(threads + i, NULL));
+	return dsTimer_time(timer) - start;
+}
+
+} // namespace
+
+TEST(ThreadCacheAllocator, Allocation)
+{
+	EXPECT_FALSE_ERRNO(EINVAL, dsThreadCacheAllocator_initialize(NULL, DS_ALLOCATOR_NO_LIMIT));
+
+	dsThreadCacheAllocator cacheAllocator;
+	ASSERT_FALSE(dsThreadCacheAllocator_initialize(&cacheAllocator, 0));
+	ASSERT_TRUE(dsThreadCacheAllocator_initialize(&cacheAllocator, DS_ALLOCATOR_NO_LIMIT));
+	dsAllocator* allocator = (dsAllocator*)&cacheAllocator;
+	EXPECT_EQ(0U, allocator->size);
+
+	void* ptr1 = dsAllocator_alloc(allocator, 11);
+	EXPECT_TRUE(dsThreadCacheAllocator_updateStats(&cacheAllocator));
+	size_t size1 = allocator->size;
+	EXPECT_NE(nullptr, ptr1);
+	EXPECT_EQ(0U, (uintptr_t)ptr1 % DS_ALLOC_ALIGNMENT);
+	EXPECT_LE(11U, size1);
+	EXPECT_EQ(1U, allocator->totalAllocations);
+	EXPECT_EQ(1U, allocator->currentAllocations);
+
+	void* ptr2 = dsAllocator_alloc(allocator, 1003);
+	EXPECT_TRUE(dsThreadCacheAllocator_updateStats(&cacheAllocator));
+	size_t size2 = allocator->size;
+	EXPECT_NE(nullptr, ptr2);
+	EXPECT_EQ(0U, (uintptr_t)ptr2 % DS_ALLOC_ALIGNMENT);
+	EXPECT_LE(1014U, size2);
+	EXPECT_EQ(2U, allocator->totalAllocations);
+	EXPECT_EQ(2U, allocator->currentAllocations);
+
+	void* ptr3 = dsAllocator_alloc(allocator, 100000);
+	EXPECT_TRUE(dsThreadCacheAllocator_updateStats(&cacheAllocator));
+	size_t size3 = allocator->size;
+	EXPECT_NE(nullptr, ptr3);
+	EXPECT_EQ(0U, (uintptr_t)ptr3 % DS_ALLOC_ALIGNMENT);
+	EXPECT_EQ(size2 + 100000U, size3);
+	EXPECT_EQ(3U, allocator->totalAllocations);
+	EXPECT_EQ(3U, allocator->currentAllocations);
+
+	void* ptr4 = dsThreadCacheAllocator_alloc(&cacheAllocator, 100, 64);
+	EXPECT_NE(nullptr, ptr4);
+	EXPECT_EQ(0U, (uintptr_t)ptr4 % 64);
+
+	std::memset(ptr1, 1, 11);
+	std::memset(ptr2, 2, 1003);
+	std::memset(ptr3, 3, 100000);
+	std::memset(ptr4, 4, 100);
+
+	EXPECT_TRUE(dsAllocator_free(allocator, ptr4));
+	EXPECT_TRUE(dsAllocator_free(allocator, ptr3));
+	EXPECT_TRUE(dsThreadCacheAllocator_updateStats(&cacheAllocator));
+	EXPECT_EQ(size2, allocator->size);
+	EXPECT_EQ(4U, allocator->totalAllocations);
+	EXPECT_EQ(2U, allocator->currentAllocations);
+
+	EXPECT_TRUE(dsAllocator_free(allocator, ptr1));
+	EXPECT_TRUE(dsThreadCacheAllocator_updateStats(&cacheAllocator));
+	EXPECT_EQ(size2 - size1, allocator->size);
+	EXPECT_EQ(1U, allocator->currentAllocations);
+
+	EXPECT_TRUE(dsAllocator_free(allocator, ptr2));
+	EXPECT_TRUE(dsThreadCacheAllocator_updateStats(&cacheAllocator));
+	EXPECT_EQ(0U, allocator->size);
+	EXPECT_EQ(4U, allocator->totalAllocations);
+	EXPECT_EQ(0U, allocator->currentAllocations);
+
+	// Freed memory should be re-used.
+	void* ptr5 = dsAllocator_alloc(allocator, 11);
+	EXPECT_EQ(ptr1, ptr5);
+	EXPECT_TRUE(dsAllocator_free(allocator, ptr5));
+
+	EXPECT_TRUE(dsThreadCacheAllocator_flushThread(&cacheAllocator));
+	dsThreadCacheAllocator_shutdown(&cacheAllocator);
+	EXPECT_EQ(0U, ((dsAllocator*)&cacheAllocator.systemAllocator)->size);
+}
+
+TEST(ThreadCacheAllocator, Reallocation)
+{
+	dsThreadCacheAllocator cacheAllocator;
+	ASSERT_TRUE(dsThreadCacheAllocator_initialize(&cacheAllocator, DS_ALLOCATOR_NO_LIMIT));
+	dsAllocator* allocator = (dsAllocator*)&cacheAllocator;
+
+	auto ptr = reinterpret_cast<uint8_t*>(dsAllocator_realloc(allocator, nullptr, 100));
+	ASSERT_NE(nullptr, ptr);
+	for (unsigned int i = 0; i < 100; ++i)
+		ptr[i] = (uint8_t)i;
+
+	// Same size class.
+	auto newPtr = reinterpret_cast<uint8_t*>(dsAllocator_realloc(allocator, ptr, 104));
+	EXPECT_EQ(ptr, newPtr);
+
+	ptr = reinterpret_cast<uint8_t*>(dsAllocator_realloc(allocator, newPtr, 200));
+	ASSERT_NE(nullptr, ptr);
+	for (unsigned int i = 0; i < 100; ++i)
+		EXPECT_EQ(i, ptr[i]);
+
+	ptr = reinterpret_cast<uint8_t*>(dsAllocator_realloc(allocator, ptr, 100000));
+	ASSERT_NE(nullptr, ptr);
+	for (unsigned int i = 0; i < 100; ++i)
+		EXPECT_EQ(i, ptr[i]);
+
+	ptr = reinterpret_cast<uint8_t*>(dsAllocator_realloc(allocator, ptr, 200000));
+	ASSERT_NE(nullptr, ptr);
+	for (unsigned int i = 0; i < 100; ++i)
+		EXPECT_EQ(i, ptr[i]);
+
+	ptr = reinterpret_cast<uint8_t*>(dsAllocator_realloc(allocator, ptr, 50));
+	ASSERT_NE(nullptr, ptr);
+	for (unsigned int i = 0; i < 50; ++i)
+		EXPECT_EQ(i, ptr[i]);
+
+	EXPECT_TRUE(dsThreadCacheAllocator_updateStats(&cacheAllocator));
+	EXPECT_LE(50U, allocator->size);
+	EXPECT_EQ(6U, allocator->totalAllocations);
+	EXPECT_EQ(1U, allocator->currentAllocations);
+
+	EXPECT_EQ(nullptr, dsAllocator_realloc(allocator, ptr, 0));
+	EXPECT_TRUE(dsThreadCacheAllocator_updateStats(&cacheAllocator));
+	EXPECT_EQ(0U, allocator->size);
+	EXPECT_EQ(0U, allocator->currentAllocations);
+
+	dsThreadCacheAllocator_shutdown(&cacheAllocator);
+}
+
+TEST(ThreadCacheAllocator, Limit)
+{
+	dsThreadCacheAllocator cacheAllocator;
+	ASSERT_TRUE(dsThreadCacheAllocator_initialize(&cacheAllocator, 256*1024));
+	dsAllocator* allocator = (dsAllocator*)&cacheAllocator;
+
+	void* ptr1 = dsAllocator_alloc(allocator, 128*1024);
+	EXPECT_NE(nullptr, ptr1);
+	EXPECT_NULL_ERRNO(ENOMEM, dsAllocator_alloc(allocator, 128*1024));
+	void* ptr2 = dsAllocator_alloc(allocator, 1024);
+	EXPECT_NE(nullptr, ptr2);
+
+	EXPECT_TRUE(dsAllocator_free(allocator, ptr1));
+	EXPECT_TRUE(dsAllocator_free(allocator, ptr2));
+	dsThreadCacheAllocator_shutdown(&cacheAllocator);
+}
+
+TEST(ThreadCacheAllocator, ThreadAlloc)
+{
+	const unsigned int threadCount = 20;
+	dsThreadCacheAllocator allocator;
+	ASSERT_TRUE(dsThreadCacheAllocator_initialize(&allocator, DS_ALLOCATOR_NO_LIMIT));
+
+	dsThread threads[threadCount];
+	for (unsigned int i = 0; i < threadCount; ++i)
+		EXPECT_TRUE(dsThread_create(threads + i, &allocThreadFunc, &allocator, 0, nullptr));
+
+	for (unsigned int i = 0; i < threadCount; ++i)
+		EXPECT_TRUE(dsThread_join(threads + i, NULL));
+
+	EXPECT_TRUE(dsThreadCacheAllocator_updateStats(&allocator));
+	EXPECT_EQ(0U, ((dsAllocator*)&allocator)->size);
+	EXPECT_EQ(threadCount*100, ((dsAllocator*)&allocator)->totalAllocations);
+	EXPECT_EQ(0U, ((dsAllocator*)&allocator)->currentAllocations);
+
+	dsThreadCacheAllocator_shutdown(&allocator);
+}
+
+TEST(ThreadCacheAllocator, CrossThreadFree)
+{
+	dsThreadCacheAllocator allocator;
+	ASSERT_TRUE(dsThreadCacheAllocator_initialize(&allocator, DS_ALLOCATOR_NO_LIMIT));
+
+	void* ptrs[10];
+	ptrs[0] = &allocator;
+	for (unsigned int i = 1; i < 10; ++i)
+	{
+		ptrs[i] = dsAllocator_alloc((dsAllocator*)&allocator, i*1000);
+		EXPECT_NE(nullptr, ptrs[i]);
+	}
+
+	dsThread thread;
+	ASSERT_TRUE(dsThread_create(&thread, &freeThreadFunc, ptrs, 0, nullptr));
+	EXPECT_TRUE(dsThread_join(&thread, NULL));
+
+	EXPECT_TRUE(dsThreadCacheAllocator_updateStats(&allocator));
+	EXPECT_EQ(0U, ((dsAllocator*)&allocator)->size);
+	EXPECT_EQ(9U, ((dsAllocator*)&allocator)->totalAllocations);
+	EXPECT_EQ(0U, ((dsAllocator*)&allocator)->currentAllocations);
+
+	dsThreadCacheAllocator_shutdown(&allocator);
+}
+
+TEST(ThreadCacheAllocator, DISABLED_ContentionBenchmark)
+{
+	const unsigned int threadCount = 8;
+	dsSystemAllocator systemAllocator;
+	ASSERT_TRUE(dsSystemAllocator_initialize(&systemAllocator, DS_ALLOCATOR_NO_LIMIT));
+	double systemTime = runBenchmark((dsAllocator*)&systemAllocator, false, threadCount);
+
+	dsThreadCacheAllocator cacheAllocator;
+	ASSERT_TRUE(dsThreadCacheAllocator_initialize(&cacheAllocator, DS_ALLOCATOR_NO_LIMIT));
+	double cacheTime = runBenchmark((dsAllocator*)&cacheAllocator, true, threadCount);
+	dsThreadCacheAllocator_shutdown(&cacheAllocator);
+
+	// Times in microseconds.
+	testing::Test::RecordProperty("threadCount", (int)threadCount);
+	testing::Test::RecordProperty("systemAllocator", (int)(systemTime*1000000.0));
+	testing::Test::RecordProperty("threadCacheAllocator", (int)(cacheTime*1000000.0));
+}
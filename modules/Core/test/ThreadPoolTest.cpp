@@ -0,0 +1,91 @@
+/*
+ * Copyright 2020 Aaron Barany
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "Helpers.h"
+#include <DeepSea/Core/Memory/SystemAllocator.h>
+#include <DeepSea/Core/Memory/BufferAllocator.h>
+#include <DeepSea/Core/Thread/TaskGraph.h>
+#include <DeepSea/Core/Thread/ThreadPool.h>
+#include <DeepSea/Core/Atomic.h>
+#include <gtest/gtest.h>
+
+namespace
+{
+
+struct WorkerCheckData
+{
+	dsThreadPool* threadPool;
+	int32_t workerCount;
+};
+
+void checkWorkerThread(void* userData)
+{
+	WorkerCheckData* data = (WorkerCheckData*)userData;
+	if (dsThreadPool_isWorkerThread(data->threadPool))
+		DS_ATOMIC_FETCH_ADD32(&data->workerCount, 1);
+}
+
+} // namespace
+
+TEST(ThreadPool, Create)
+{
+	dsSystemAllocator allocator;
+	ASSERT_TRUE(dsSystemAllocator_initialize(&allocator, DS_ALLOCATOR_NO_LIMIT));
+
+	EXPECT_NULL_ERRNO(EINVAL, dsThreadPool_create(nullptr, 4, 0));
+
+	uint8_t buffer[1024];
+	dsBufferAllocator bufferAlloc;
+	ASSERT_TRUE(dsBufferAllocator_initialize(&bufferAlloc, buffer, sizeof(buffer)));
+	EXPECT_NULL_ERRNO(EINVAL, dsThreadPool_create((dsAllocator*)&bufferAlloc, 4, 0));
+
+	dsThreadPool* threadPool = dsThreadPool_create((dsAllocator*)&allocator, 4, 0);
+	ASSERT_TRUE(threadPool);
+	EXPECT_EQ(4U, dsThreadPool_getThreadCount(threadPool));
+	EXPECT_FALSE(dsThreadPool_isWorkerThread(threadPool));
+	EXPECT_FALSE(dsThreadPool_executeTask(threadPool));
+	dsThreadPool_destroy(threadPool);
+
+	threadPool = dsThreadPool_create((dsAllocator*)&allocator, 0, 0);
+	ASSERT_TRUE(threadPool);
+	EXPECT_EQ(0U, dsThreadPool_getThreadCount(threadPool));
+	dsThreadPool_destroy(threadPool);
+
+	EXPECT_EQ(0U, ((dsAllocator*)&allocator)->size);
+}
+
+TEST(ThreadPool, WorkerThreads)
+{
+	dsSystemAllocator allocator;
+	ASSERT_TRUE(dsSystemAllocator_initialize(&allocator, DS_ALLOCATOR_NO_LIMIT));
+
+	// With no threads, all tasks are executed on the waiting thread.
+	dsThreadPool* threadPool = dsThreadPool_create((dsAllocator*)&allocator, 0, 0);
+	ASSERT_TRUE(threadPool);
+	dsTaskGraph* taskGraph = dsTaskGraph_create((dsAllocator*)&allocator, threadPool);
+	ASSERT_TRUE(taskGraph);
+
+	WorkerCheckData data = {threadPool, 0};
+	const uint32_t taskCount = 100;
+	for (uint32_t i = 0; i < taskCount; ++i)
+		EXPECT_EQ(i, dsTaskGraph_addTask(taskGraph, &checkWorkerThread, &data));
+	EXPECT_TRUE(dsTaskGraph_execute(taskGraph));
+	EXPECT_EQ(0, data.workerCount);
+
+	dsTaskGraph_destroy(taskGraph);
+	dsThreadPool_destroy(threadPool);
+	EXPECT_EQ(0U, ((dsAllocator*)&allocator)->size);
+}
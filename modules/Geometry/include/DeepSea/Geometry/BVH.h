@@ -18,6 +18,7 @@
 
 #include <DeepSea/Core/Config.h>
 #include <DeepSea/Core/Types.h>
+#include <DeepSea/Core/Thread/Types.h>
 #include <DeepSea/Geometry/Export.h>
 #include <DeepSea/Geometry/Types.h>
 
@@ -40,6 +41,21 @@ extern "C"
  * lookup performance to degrade to O(n), in which case the extra time spent balancing may be
  * quickly made up with better lookup times.
  *
+ * dsBVH_buildSAH() builds the tree using a binned surface area heuristic, which typically gives the
+ * best lookup times. It is O(n*log(n)) to build, and large trees may be built with multiple threads
+ * through a thread pool.
+ *
+ * Nodes are stored depth-first in a single array, and are traversed without recursion or a stack.
+ * BVHs with float bounds may optionally use wide nodes with dsBVH_setUseWideNodes(), which group
+ * 4 children together to test them at once with SIMD instructions when intersecting with bounds.
+ *
+ * Ray and nearest object queries with dsBVH_intersectRay() and dsBVH_nearest() visit the closest
+ * nodes first to prune subtrees that can't contain a closer result.
+ *
+ * Dynamic objects may be inserted, removed, and updated individually without re-building the full
+ * BVH. These changes are batched and applied together with dsBVH_updateDirty(), which also re-builds
+ * subtrees in place that degrade as objects move.
+ *
  * @see dsBVH
  */
 
@@ -83,6 +99,32 @@ DS_GEOMETRY_EXPORT void* dsBVH_getUserData(const dsBVH* bvh);
  */
 DS_GEOMETRY_EXPORT void dsBVH_setUserData(dsBVH* bvh, void* userData);
 
+/**
+ * @brief Gets whether or not wide nodes are used.
+ * @param bvh The BVH.
+ * @return True if wide nodes are used.
+ */
+DS_GEOMETRY_EXPORT bool dsBVH_getUseWideNodes(const dsBVH* bvh);
+
+/**
+ * @brief Sets whether or not to use wide nodes.
+ *
+ * Wide nodes collapse the binary tree so each node has 4 children, storing the child bounds as a
+ * structure of arrays. This allows dsBVH_intersect() to test all 4 children at once with SSE or
+ * NEON instructions, which is typically much faster for large BVHs. The wide nodes are created
+ * when the BVH is built and kept up to date with dsBVH_update(), requiring extra memory.
+ *
+ * Wide nodes are only supported for float bounds, and will only be used when SIMD instructions are
+ * available on the current CPU.
+ *
+ * @remark errno will be set on failure.
+ * @param bvh The BVH.
+ * @param useWideNodes True to use wide nodes.
+ * @return False if the wide nodes couldn't be created. errno will be set to EPERM if the BVH
+ *     doesn't use float bounds.
+ */
+DS_GEOMETRY_EXPORT bool dsBVH_setUseWideNodes(dsBVH* bvh, bool useWideNodes);
+
 /**
  * @brief Builds the hierarchy for a BVH.
  *
@@ -111,6 +153,31 @@ DS_GEOMETRY_EXPORT void dsBVH_setUserData(dsBVH* bvh, void* userData);
 DS_GEOMETRY_EXPORT bool dsBVH_build(dsBVH* bvh, const void* objects, uint32_t objectCount,
 	size_t objectSize, dsBVHObjectBoundsFunction objectBoundsFunc, bool balance);
 
+/**
+ * @brief Builds the BVH using the surface area heuristic.
+ *
+ * Each split is chosen by binning the object centroids along each axis and choosing the split that
+ * minimizes the surface area (or perimeter for 2D) of the child bounds weighted by the number of
+ * objects. This typically gives faster lookups than dsBVH_build() with balancing while being much
+ * faster to build.
+ *
+ * This will replace the contents of the BVH.
+ *
+ * @remark errno will be set on failure.
+ * @param bvh The BVH to build.
+ * @param objects An array of objects to build the BVH for. See dsBVH_build() for details.
+ * @param objectCount The number of objects in the array.
+ * @param objectSize The size of each object inside of the object array. See dsBVH_build() for
+ *     the special values that may be used.
+ * @param objectBoundsFunc The function to query the bounds from each object. This is always called
+ *     on the current thread.
+ * @param threadPool The thread pool to build independent subtrees with. This may be NULL to build
+ *     on the current thread. Only large BVHs will use the thread pool.
+ * @return False if an error occurred. The current contents will be cleared on error.
+ */
+DS_GEOMETRY_EXPORT bool dsBVH_buildSAH(dsBVH* bvh, const void* objects, uint32_t objectCount,
+	size_t objectSize, dsBVHObjectBoundsFunction objectBoundsFunc, dsThreadPool* threadPool);
+
 /**
  * @brief Updates a BVH, querying updated bounds from the objects and updating the bounds
  * accordingly.
@@ -118,7 +185,8 @@ DS_GEOMETRY_EXPORT bool dsBVH_build(dsBVH* bvh, const void* objects, uint32_t ob
  * This will keep the topology of the BVH the same while updating the internal bounds. If the
  * objects move around enough, the tree may become unbalanced, causing lookups to become unbalanced.
  * Consider re-building the BVH if the objects move significantly with respect to each-other if you
- * want to maintain a balanced tree.
+ * want to maintain a balanced tree, or use dsBVH_markDirty() and dsBVH_updateDirty() when only
+ * some objects move.
  *
  * @remark errno will be set on failure.
  * @param bvh The BVH to balance.
@@ -126,6 +194,73 @@ DS_GEOMETRY_EXPORT bool dsBVH_build(dsBVH* bvh, const void* objects, uint32_t ob
  */
 DS_GEOMETRY_EXPORT bool dsBVH_update(dsBVH* bvh);
 
+/**
+ * @brief Inserts a single object into a BVH.
+ *
+ * The object is added with the next call to dsBVH_updateDirty(), and won't be returned from
+ * queries until then. This is O(1), while applying all insertions and removals together is O(n)
+ * to make space for the new nodes. Each object is paired with the existing node that least
+ * increases the surface area of the tree, and nodes paired with multiple objects are re-built.
+ * Inserting many objects at once may re-build the full tree.
+ *
+ * @remark errno will be set on failure.
+ * @param bvh The BVH to insert into. This must have previously been built, even if it was with no
+ *     objects, to provide the function to query the object bounds.
+ * @param object The object to insert. This is the same value passed to the visitor functions,
+ *     and should be cast from size_t when DS_GEOMETRY_OBJECT_INDICES is used. This must not
+ *     already be in the BVH.
+ * @return False if the object couldn't be inserted.
+ */
+DS_GEOMETRY_EXPORT bool dsBVH_insert(dsBVH* bvh, const void* object);
+
+/**
+ * @brief Removes a single object from a BVH.
+ *
+ * The object is removed with the next call to dsBVH_updateDirty(), and may be returned from
+ * queries until then. This is O(1), while applying all insertions and removals together is O(n)
+ * to remove the nodes.
+ *
+ * @remark errno will be set on failure.
+ * @param bvh The BVH to remove from.
+ * @param object The object to remove. This is the same value passed to the visitor functions.
+ * @return False if the object couldn't be removed. errno will be set to ENOTFOUND if the object
+ *     isn't in the BVH.
+ */
+DS_GEOMETRY_EXPORT bool dsBVH_remove(dsBVH* bvh, const void* object);
+
+/**
+ * @brief Marks an object as dirty to have its bounds updated with dsBVH_updateDirty().
+ *
+ * The first call to this, dsBVH_insert(), or dsBVH_remove() after building the BVH will create
+ * the data to find the objects and track the changes, which is O(n). Objects must be unique within
+ * the BVH to use these functions. Building or clearing the BVH discards any changes that haven't
+ * been applied.
+ *
+ * @remark errno will be set on failure.
+ * @param bvh The BVH the object is in.
+ * @param object The object that changed. This is the same value passed to the visitor functions.
+ * @return False if the object couldn't be marked as dirty. errno will be set to ENOTFOUND if the
+ *     object isn't in the BVH.
+ */
+DS_GEOMETRY_EXPORT bool dsBVH_markDirty(dsBVH* bvh, const void* object);
+
+/**
+ * @brief Applies pending insertions and removals and updates the bounds for the dirty objects.
+ *
+ * Only the bounds of the dirty and inserted objects are queried, and only their ancestors are
+ * updated. The cost of each updated subtree is compared to the cost when it was built, and subtrees
+ * that have degraded past the threshold are re-built in place.
+ *
+ * @remark errno will be set on failure.
+ * @param bvh The BVH to update.
+ * @param rebuildThreshold The amount the cost of a subtree may increase by before it's re-built.
+ *     For example, 1.5 will re-build subtrees once they are 50% more expensive to traverse than
+ *     when they were built. Set to 0 to only re-build the nodes paired with multiple inserted
+ *     objects, or the full tree if it becomes too deep.
+ * @return False if an error occurred.
+ */
+DS_GEOMETRY_EXPORT bool dsBVH_updateDirty(dsBVH* bvh, float rebuildThreshold);
+
 /**
  * @brief Intersects a bounding box with the BVH.
  * @param bvh The BVH to intersect.
@@ -139,6 +274,70 @@ DS_GEOMETRY_EXPORT bool dsBVH_update(dsBVH* bvh);
 DS_GEOMETRY_EXPORT uint32_t dsBVH_intersect(const dsBVH* bvh, const void* bounds,
 	dsBVHVisitFunction visitor, void* userData);
 
+/**
+ * @brief Intersects a frustum with the BVH.
+ *
+ * Subtrees that are fully inside the frustum are visited without testing the nodes within them,
+ * and subtrees that are fully outside are skipped. This is only supported for BVHs with 3 axes and
+ * float or double elements.
+ *
+ * @param bvh The BVH to intersect.
+ * @param frustum The frustum to intersect. This should be a dsFrustum3f or dsFrustum3d depending on
+ *     the precision of the BVH.
+ * @param visitor A visitor function to call for each intersecting object. The bounds passed to the
+ *     visitor will be the frustum. This may be NULL if you only want to know how many objects
+ *     intersect.
+ * @param userData User data to pass to the visitor function.
+ * @return The number of objects that intersected.
+ */
+DS_GEOMETRY_EXPORT uint32_t dsBVH_intersectFrustum(const dsBVH* bvh, const void* frustum,
+	dsBVHVisitFunction visitor, void* userData);
+
+/**
+ * @brief Intersects a ray with the BVH.
+ *
+ * Nodes are visited front to back along the ray, and subtrees further than the current closest hit
+ * are skipped.
+ *
+ * @param[out] outObject The intersected object. This may be NULL if not needed.
+ * @param[out] outT The distance along the ray of the intersection, as a multiple of the ray
+ *     direction. This may be NULL if not needed.
+ * @param bvh The BVH to intersect.
+ * @param ray The ray to intersect. This should be a dsRay* type appropriate for the axis count and
+ *     precision. BVHs with int elements use double rays.
+ * @param maxT The maximum distance along the ray to consider.
+ * @param anyHit True to stop at the first intersection found rather than the closest. This is
+ *     useful for occlusion tests.
+ * @param intersectFunc Function to intersect the ray with an object. This may be NULL to use the
+ *     bounds of the objects.
+ * @param userData User data to pass to the intersect function.
+ * @return True if an object was intersected.
+ */
+DS_GEOMETRY_EXPORT bool dsBVH_intersectRay(const void** outObject, double* outT, const dsBVH* bvh,
+	const void* ray, double maxT, bool anyHit, dsBVHRayIntersectFunction intersectFunc,
+	void* userData);
+
+/**
+ * @brief Finds the nearest object to a point.
+ *
+ * Nodes are visited closest first, and subtrees further than the current nearest object are
+ * skipped.
+ *
+ * @param[out] outObject The nearest object. This may be NULL if not needed.
+ * @param[out] outDistance The distance to the nearest object. This may be NULL if not needed.
+ * @param bvh The BVH to search.
+ * @param point The point to search from. This should be a dsVector* type appropriate for the axis
+ *     count and precision.
+ * @param maxDistance The maximum distance to consider.
+ * @param distanceFunc Function to get the distance to an object. This may be NULL to use the
+ *     distance to the bounds of the objects.
+ * @param userData User data to pass to the distance function.
+ * @return True if an object was found within the maximum distance.
+ */
+DS_GEOMETRY_EXPORT bool dsBVH_nearest(const void** outObject, double* outDistance,
+	const dsBVH* bvh, const void* point, double maxDistance, dsBVHNearestFunction distanceFunc,
+	void* userData);
+
 /**
  * @brief Gets the bounds of the BVH.
  * @param outBounds The bounds. The type should be a dsAlignedBox* type appropriate for the axis
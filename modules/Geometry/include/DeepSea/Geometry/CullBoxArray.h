@@ -0,0 +1,168 @@
+/*
+ * Copyright 2020 Aaron Barany
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <DeepSea/Core/Config.h>
+#include <DeepSea/Core/Types.h>
+#include <DeepSea/Geometry/Export.h>
+#include <DeepSea/Geometry/Types.h>
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+/**
+ * @file
+ * @brief Functions for creating and using arrays of boxes for frustum culling.
+ *
+ * Each box is stored in world space as its center and three half-extent axes, with each component
+ * in a separate array. This allows boxes to be tested against the frustum planes several at a time
+ * with SIMD instructions, using AVX, SSE, or NEON based on what the host CPU supports, with a
+ * scalar fallback otherwise.
+ *
+ * The boxes are intended to be kept up to date as they move rather than re-created each time they
+ * are culled.
+ *
+ * @see dsCullBoxArray
+ */
+
+/**
+ * @brief The number of boxes stored in each visibility mask element.
+ *
+ * The first box for a range of boxes to cull must be a multiple of this value.
+ */
+#define DS_CULL_BOX_MASK_BITS 32
+
+/**
+ * @brief Gets the number of uint32_t elements required for a visibility mask.
+ * @param boxCount The number of boxes.
+ * @return The number of mask elements.
+ */
+#define DS_CULL_BOX_MASK_COUNT(boxCount) \
+	(((boxCount) + DS_CULL_BOX_MASK_BITS - 1)/DS_CULL_BOX_MASK_BITS)
+
+/**
+ * @brief Creates a cull box array.
+ * @remark errno will be set on failure.
+ * @param allocator The allocator to create the array with. This must support freeing memory.
+ * @param boxCount The initial number of boxes. The initial boxes will be infinite.
+ * @return The cull box array or NULL if it couldn't be created.
+ */
+DS_GEOMETRY_EXPORT dsCullBoxArray* dsCullBoxArray_create(dsAllocator* allocator,
+	uint32_t boxCount);
+
+/**
+ * @brief Gets the number of boxes in a cull box array.
+ * @param boxes The cull box array.
+ * @return The number of boxes.
+ */
+DS_GEOMETRY_EXPORT uint32_t dsCullBoxArray_getBoxCount(const dsCullBoxArray* boxes);
+
+/**
+ * @brief Sets the number of boxes in a cull box array.
+ *
+ * Existing boxes will be preserved, while any new boxes will be infinite.
+ *
+ * @remark errno will be set on failure.
+ * @param boxes The cull box array.
+ * @param boxCount The new number of boxes.
+ * @return False if the boxes couldn't be resized.
+ */
+DS_GEOMETRY_EXPORT bool dsCullBoxArray_setBoxCount(dsCullBoxArray* boxes, uint32_t boxCount);
+
+/**
+ * @brief Sets a box from an oriented box.
+ * @remark errno will be set on failure.
+ * @param boxes The cull box array.
+ * @param index The index of the box to set.
+ * @param box The oriented box. This must be valid.
+ * @param transform The transform to apply to the box. This may be NULL to use the box as-is.
+ * @return False if the parameters are invalid.
+ */
+DS_GEOMETRY_EXPORT bool dsCullBoxArray_setOrientedBox(dsCullBoxArray* boxes, uint32_t index,
+	const dsOrientedBox3f* box, const dsMatrix44f* transform);
+
+/**
+ * @brief Sets a box from an aligned box.
+ * @remark errno will be set on failure.
+ * @param boxes The cull box array.
+ * @param index The index of the box to set.
+ * @param box The aligned box. This must be valid.
+ * @param transform The transform to apply to the box. This may be NULL to use the box as-is.
+ * @return False if the parameters are invalid.
+ */
+DS_GEOMETRY_EXPORT bool dsCullBoxArray_setAlignedBox(dsCullBoxArray* boxes, uint32_t index,
+	const dsAlignedBox3f* box, const dsMatrix44f* transform);
+
+/**
+ * @brief Sets a box to be infinite so it will never be culled.
+ * @remark errno will be set on failure.
+ * @param boxes The cull box array.
+ * @param index The index of the box to set.
+ * @return False if the parameters are invalid.
+ */
+DS_GEOMETRY_EXPORT bool dsCullBoxArray_setInfinite(dsCullBoxArray* boxes, uint32_t index);
+
+/**
+ * @brief Copies a box from one index to another.
+ *
+ * This is useful to fill gaps when removing boxes.
+ *
+ * @remark errno will be set on failure.
+ * @param boxes The cull box array.
+ * @param dstIndex The index of the box to set.
+ * @param srcIndex The index of the box to copy.
+ * @return False if the parameters are invalid.
+ */
+DS_GEOMETRY_EXPORT bool dsCullBoxArray_copyBox(dsCullBoxArray* boxes, uint32_t dstIndex,
+	uint32_t srcIndex);
+
+/**
+ * @brief Intersects a range of boxes with a frustum.
+ *
+ * Boxes are considered visible unless they are fully outside of one of the frustum planes, the
+ * same as dsFrustum3f_intersectOrientedBox() returning anything other than
+ * dsIntersectResult_Outside. Planes with a zero normal are ignored.
+ *
+ * Different ranges of the same array may be intersected concurrently on different threads.
+ *
+ * @remark errno will be set on failure.
+ * @param[out] outVisible The visibility mask, with a bit set for each visible box. Box i is
+ *     stored in bit i % DS_CULL_BOX_MASK_BITS of element i/DS_CULL_BOX_MASK_BITS. Only the
+ *     elements that contain the range of boxes will be written to, and bits past the last box in
+ *     the range will be cleared. This must have at least
+ *     DS_CULL_BOX_MASK_COUNT(firstBox + boxCount) elements.
+ * @param boxes The cull box array.
+ * @param frustum The frustum to intersect with.
+ * @param firstBox The first box to intersect. This must be a multiple of DS_CULL_BOX_MASK_BITS.
+ * @param boxCount The number of boxes to intersect.
+ * @return The number of visible boxes, or 0 if the parameters are invalid.
+ */
+DS_GEOMETRY_EXPORT uint32_t dsCullBoxArray_intersectFrustum(uint32_t* outVisible,
+	const dsCullBoxArray* boxes, const dsFrustum3f* frustum, uint32_t firstBox,
+	uint32_t boxCount);
+
+/**
+ * @brief Destroys a cull box array.
+ * @param boxes The cull box array to destroy.
+ */
+DS_GEOMETRY_EXPORT void dsCullBoxArray_destroy(dsCullBoxArray* boxes);
+
+#ifdef __cplusplus
+}
+#endif
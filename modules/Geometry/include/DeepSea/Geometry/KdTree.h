@@ -34,6 +34,10 @@ extern "C"
  * or 3 dimensional points of float, double, or int. (i.e. dsVector[23][fdi]) This allows a spacial
  * lookup of objects in O(log(n)) time in the average case.
  *
+ * Building the tree is O(n*log(n)) by partitioning the points around the median of each level
+ * rather than sorting them. Nearest neighbor and radius queries are provided in addition to
+ * traversing the tree with custom logic.
+ *
  * @see dsKdTree
  */
 
@@ -115,6 +119,46 @@ DS_GEOMETRY_EXPORT bool dsKdTree_build(dsKdTree* kdTree, const void* objects, ui
 DS_GEOMETRY_EXPORT bool dsKdTree_traverse(const dsKdTree* kdTree,
 	dsKdTreeTraverseFunction traverseFunc, void* userData);
 
+/**
+ * @brief Finds the nearest neighbors to a point.
+ *
+ * The closest neighbors found so far are kept in a bounded max heap so that subtrees further than
+ * the current furthest neighbor can be skipped.
+ *
+ * @remark errno will be set on failure.
+ * @param[out] outNeighbors The array to hold the neighbors. This will be sorted from closest to
+ *     furthest.
+ * @param maxNeighbors The maximum number of neighbors to find. outNeighbors must be large enough to
+ *     hold this many neighbors.
+ * @param kdTree The Kd tree to query.
+ * @param point The point to find the neighbors for. This should be the appropriate dsVector* type
+ *     for the axis count and element of the Kd tree.
+ * @param maxDistance The maximum distance of a neighbor from the point.
+ * @param epsilon The error allowed for approximate queries. Subtrees are skipped if they can't
+ *     contain a neighbor closer than the furthest neighbor divided by 1 + epsilon, so each
+ *     neighbor is within a factor of 1 + epsilon of the true distance. Use 0 for exact queries.
+ * @return The number of neighbors that were found.
+ */
+DS_GEOMETRY_EXPORT uint32_t dsKdTree_nearestNeighbors(dsKdTreeNeighbor* outNeighbors,
+	uint32_t maxNeighbors, const dsKdTree* kdTree, const void* point, double maxDistance,
+	double epsilon);
+
+/**
+ * @brief Finds all objects within a radius of a point.
+ * @remark errno will be set on failure.
+ * @param kdTree The Kd tree to query.
+ * @param point The point to search around. This should be the appropriate dsVector* type for the
+ *     axis count and element of the Kd tree.
+ * @param radius The radius to search within.
+ * @param visitor A visitor function to call for each object found. Objects aren't visited in any
+ *     particular order. This may be NULL if you only want to know how many objects are within the
+ *     radius.
+ * @param userData User data to pass to the visitor function.
+ * @return The number of objects that were found.
+ */
+DS_GEOMETRY_EXPORT uint32_t dsKdTree_withinRadius(const dsKdTree* kdTree, const void* point,
+	double radius, dsKdTreeVisitFunction visitor, void* userData);
+
 /**
  * @brief Clears the contents of the Kd tree.
  *
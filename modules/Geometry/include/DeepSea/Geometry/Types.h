@@ -388,6 +388,76 @@ typedef struct dsFrustum3d
 	dsPlane3d planes[dsFrustumPlanes_Count];
 } dsFrustum3d;
 
+/**
+ * @brief Structure for a 2D ray using floats.
+ *
+ * Points along the ray are origin + direction*t for t >= 0. The direction doesn't need to be
+ * normalized, in which case distances along the ray are in units of the direction length.
+ */
+typedef struct dsRay2f
+{
+	/**
+	 * @brief The origin of the ray.
+	 */
+	dsVector2f origin;
+
+	/**
+	 * @brief The direction of the ray.
+	 */
+	dsVector2f direction;
+} dsRay2f;
+
+/**
+ * @brief Structure for a 2D ray using doubles.
+ * @see dsRay2f
+ */
+typedef struct dsRay2d
+{
+	/**
+	 * @brief The origin of the ray.
+	 */
+	dsVector2d origin;
+
+	/**
+	 * @brief The direction of the ray.
+	 */
+	dsVector2d direction;
+} dsRay2d;
+
+/**
+ * @brief Structure for a 3D ray using floats.
+ * @see dsRay2f
+ */
+typedef struct dsRay3f
+{
+	/**
+	 * @brief The origin of the ray.
+	 */
+	dsVector3f origin;
+
+	/**
+	 * @brief The direction of the ray.
+	 */
+	dsVector3f direction;
+} dsRay3f;
+
+/**
+ * @brief Structure for a 3D ray using doubles.
+ * @see dsRay2f
+ */
+typedef struct dsRay3d
+{
+	/**
+	 * @brief The origin of the ray.
+	 */
+	dsVector3d origin;
+
+	/**
+	 * @brief The direction of the ray.
+	 */
+	dsVector3d direction;
+} dsRay3d;
+
 /**
  * @brief Callback function for adding a sample when tessellating a curve.
  * @remark errno should be set on failure.
@@ -421,6 +491,12 @@ typedef struct dsBezierCurve
 	dsVector4d controlPoints[3];
 } dsBezierCurve;
 
+/**
+ * @brief Structure holding bounding boxes laid out for culling many boxes at once.
+ * @see CullBoxArray.h
+ */
+typedef struct dsCullBoxArray dsCullBoxArray;
+
 /**
  * @brief Structure for a bounding volume hierarchy spacial data structure.
  * @see BVH.h
@@ -453,6 +529,37 @@ typedef bool (*dsBVHObjectBoundsFunction)(void* outBounds, const dsBVH* bvh, con
 typedef bool (*dsBVHVisitFunction)(void* userData, const dsBVH* bvh, const void* object,
 	const void* bounds);
 
+/**
+ * @brief Function called to intersect a ray with an object in a BVH.
+ * @param userData User data forwarded for the function.
+ * @param bvh The BVH that the intersection is performed with.
+ * @param object The object to intersect with. This should be cast to size_t when
+ *     DS_GEOMETRY_OBJECT_INDICES is used.
+ * @param ray The ray to intersect with. This should be cast to the appropriate dsRay* type based
+ *     on the axis count and precision queried from bvh, using double for int BVHs.
+ * @param[out] outT The distance along the ray for the intersection, in units of the ray direction.
+ * @return True if the ray intersects with the object.
+ * @see BVH.h
+ */
+typedef bool (*dsBVHRayIntersectFunction)(void* userData, const dsBVH* bvh, const void* object,
+	const void* ray, double* outT);
+
+/**
+ * @brief Function called to get the distance from a point to an object in a BVH.
+ * @param userData User data forwarded for the function.
+ * @param bvh The BVH that the query is performed with.
+ * @param object The object to get the distance to. This should be cast to size_t when
+ *     DS_GEOMETRY_OBJECT_INDICES is used.
+ * @param point The point to get the distance from. This should be cast to the appropriate
+ *     dsVector* type based on the axis count and precision queried from bvh.
+ * @param[out] outDistance The distance from the point to the object. This must not be less than
+ *     the distance to the bounds of the object.
+ * @return True if the object should be considered, false to ignore it.
+ * @see BVH.h
+ */
+typedef bool (*dsBVHNearestFunction)(void* userData, const dsBVH* bvh, const void* object,
+	const void* point, double* outDistance);
+
 /**
  * @brief Structure for a Kd tree spacial data structure.
  * @see KdTree.h
@@ -507,6 +614,39 @@ typedef enum dsKdTreeSide
 typedef unsigned int (*dsKdTreeTraverseFunction)(void* userData, const dsKdTree* kdTree,
 	const void* object, const void* point, uint8_t axis);
 
+/**
+ * @brief Function called for each object found when querying a Kd tree.
+ * @param userData User data forwarded for the function.
+ * @param kdTree The Kd tree being queried.
+ * @param object The object that was found. This should be cast to size_t when
+ *     DS_GEOMETRY_OBJECT_INDICES is used.
+ * @param point The point for the object. This should be cast to the appropriate dsVector* type.
+ * @param distance The distance from the query point to the object.
+ * @return False to stop the query.
+ * @see KdTree.h
+ */
+typedef bool (*dsKdTreeVisitFunction)(void* userData, const dsKdTree* kdTree, const void* object,
+	const void* point, double distance);
+
+/**
+ * @brief Structure for a neighbor found when querying a Kd tree.
+ * @see KdTree.h
+ */
+typedef struct dsKdTreeNeighbor
+{
+	/**
+	 * @brief The object for the neighbor.
+	 *
+	 * This should be cast to size_t when DS_GEOMETRY_OBJECT_INDICES is used.
+	 */
+	const void* object;
+
+	/**
+	 * @brief The distance from the query point to the neighbor.
+	 */
+	double distance;
+} dsKdTreeNeighbor;
+
 /**
  * @brief Enum for the winding order when triangulating geometry.
  */
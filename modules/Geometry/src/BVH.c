@@ -17,27 +17,94 @@
 #include <DeepSea/Geometry/BVH.h>
 
 #include "SpatialStructureShared.h"
+#include <DeepSea/Core/Containers/FlatHashMap.h>
+#include <DeepSea/Core/Containers/Hash.h>
 #include <DeepSea/Core/Containers/ResizeableArray.h>
 #include <DeepSea/Core/Memory/Allocator.h>
+#include <DeepSea/Core/Memory/BufferAllocator.h>
 #include <DeepSea/Core/Assert.h>
 #include <DeepSea/Core/Error.h>
 #include <DeepSea/Core/Log.h>
+#include <DeepSea/Core/SIMD.h>
 #include <DeepSea/Core/Sort.h>
+#include <DeepSea/Core/Thread/TaskGraph.h>
+#include <DeepSea/Core/Thread/ThreadPool.h>
 #include <DeepSea/Geometry/AlignedBox2.h>
 #include <DeepSea/Geometry/AlignedBox3.h>
+#include <DeepSea/Geometry/Frustum3.h>
+#include <DeepSea/Math/Core.h>
+#include <DeepSea/Math/Vector3.h>
+#include <float.h>
+#include <math.h>
 #include <string.h>
 
 #define INVALID_NODE (uint32_t)-1
 
+// Number of bins to evaluate split candidates for the surface area heuristic.
+#define SAH_BIN_COUNT 16
+// Past this depth, splits are forced to the middle to guarantee the recursion terminates in a
+// reasonable depth for pathological distributions.
+#define SAH_MAX_DEPTH 64
+// Minimum number of objects in a subtree to build it as a separate task.
+#define SAH_MIN_TASK_OBJECTS 4096
+
+// Maximum depth of the tree. The builders stay well within this, and dynamic updates re-build the
+// tree if they would exceed it, allowing ordered traversals to use a fixed size stack.
+#define MAX_DEPTH 128
+// Temporarily marks objects while their insertion is being applied.
+#define PENDING_NODE (INVALID_NODE - 1)
+
+#define WIDE_NODE_CHILDREN 4
+#define WIDE_LEAF_FLAG 0x80000000U
+// Each level of wide nodes adds at most 3 entries to the traversal stack. Trees too deep for the
+// stack will fall back to the binary nodes.
+#define WIDE_STACK_SIZE 256
+#define WIDE_MAX_DEPTH ((WIDE_STACK_SIZE - 1)/(WIDE_NODE_CHILDREN - 1))
+
+// Nodes are stored depth-first, so the left node is always the next node. The skip node is the
+// first node after the subtree, which allows the tree to be traversed without a stack.
 typedef struct dsBVHNode
 {
-	uint32_t leftNode;
+	uint32_t skipNode;
 	uint32_t rightNode;
 	const void* object;
 	// Double for worst-case alignment.
 	double bounds[];
 } dsBVHNode;
 
+// Collapsed form of the binary nodes with 4 children each. The child bounds are stored as a
+// structure of arrays so that all children can be tested at once with SIMD instructions.
+// Data to incrementally update the BVH. This is created the first time it's needed.
+typedef struct DynamicNode
+{
+	uint32_t parentNode;
+	// Maximum depth of the leaves below this node.
+	uint32_t height;
+	// Sum of the surface area costs for the internal nodes of the subtree.
+	float cost;
+	// Ratio of the cost to the surface area cost of the node when the subtree was last built.
+	float buildCostRatio;
+	bool dirty;
+	// Leaf that will be removed with the next dsBVH_updateDirty().
+	bool removed;
+	// Subtree for inserted objects that will be re-built with the next dsBVH_updateDirty().
+	bool needsRebuild;
+} DynamicNode;
+
+typedef struct WideNode
+{
+	float minX[WIDE_NODE_CHILDREN];
+	float minY[WIDE_NODE_CHILDREN];
+	float minZ[WIDE_NODE_CHILDREN];
+	float maxX[WIDE_NODE_CHILDREN];
+	float maxY[WIDE_NODE_CHILDREN];
+	float maxZ[WIDE_NODE_CHILDREN];
+	// Index of the child wide node, or the binary leaf node with WIDE_LEAF_FLAG set.
+	uint32_t children[WIDE_NODE_CHILDREN];
+	// Binary node for each child to update the bounds from.
+	uint32_t binaryNodes[WIDE_NODE_CHILDREN];
+} WideNode;
+
 struct dsBVH
 {
 	dsAllocator* allocator;
@@ -53,9 +120,37 @@ struct dsBVH
 	dsBVHNode* nodes;
 	uint32_t nodeCount;
 	uint32_t maxNodes;
+	// Maximum depth of a leaf node, used to size the stack for ordered traversals.
+	uint32_t maxDepth;
 
 	dsBVHNode* tempNodes;
 	size_t maxTempNodes;
+
+	void* buildBuffer;
+	size_t buildBufferSize;
+
+	WideNode* wideNodes;
+	uint32_t wideNodeCount;
+	uint32_t maxWideNodes;
+	bool useWideNodes;
+
+	DynamicNode* dynamicNodes;
+	uint32_t dynamicNodeCount;
+	uint32_t maxDynamicNodes;
+	bool dynamicValid;
+
+	// Maps from each object to its leaf node, or INVALID_NODE if waiting to be inserted.
+	dsFlatHashMap objectNodes;
+
+	// Insertions and removals are applied together with dsBVH_updateDirty().
+	const void** pendingInserts;
+	uint32_t pendingInsertCount;
+	uint32_t maxPendingInserts;
+	uint32_t pendingRemoveCount;
+
+	uint32_t* dirtyNodes;
+	uint32_t dirtyNodeCount;
+	uint32_t maxDirtyNodes;
 };
 
 typedef struct SortContext
@@ -67,12 +162,170 @@ typedef struct SortContext
 
 typedef void (*AddBoxFunction)(void* bounds, const void* otherBounds);
 typedef bool (*IntersectFunction)(const void* bounds, const void* otherBounds);
+typedef dsIntersectResult (*IntersectFrustumFunction)(const void* frustum, const void* bounds);
+
+typedef struct SAHBuildContext
+{
+	dsBVH* bvh;
+	AddBoxFunction addBoxFunc;
+	// Object bounds converted to doubles, indexed by the object index.
+	const dsAlignedBox3d* objectBounds;
+	uint32_t* objectIndices;
+} SAHBuildContext;
+
+typedef struct SAHBuildTask
+{
+	const SAHBuildContext* context;
+	uint32_t start;
+	uint32_t count;
+	uint32_t node;
+	uint32_t depth;
+	uint32_t maxDepth;
+} SAHBuildTask;
+
+typedef struct SAHSplitNode
+{
+	uint32_t node;
+	uint32_t leftNode;
+	uint32_t rightNode;
+} SAHSplitNode;
+
+typedef struct RayInfo
+{
+	double origin[3];
+	double direction[3];
+	double invDirection[3];
+} RayInfo;
+
+// Entry for traversals that visit the closest nodes first.
+typedef struct OrderedEntry
+{
+	uint32_t node;
+	double distance;
+} OrderedEntry;
+
+// Object to insert next to a sibling node. The sibling is first to sort with compareNodeIndex().
+typedef struct InsertEntry
+{
+	uint32_t sibling;
+	uint32_t leaf;
+} InsertEntry;
+
+typedef struct InsertContext
+{
+	dsBVH* bvh;
+	dsBVHNode* newNodes;
+	DynamicNode* newDynamicNodes;
+	// Maps from the node index before inserting to after.
+	uint32_t* nodeMap;
+	const dsBVHNode* leafNodes;
+	InsertEntry* entries;
+	uint32_t entryCount;
+	uint32_t nextEntry;
+	uint32_t nextNode;
+} InsertContext;
+
+typedef struct SAHBin
+{
+	dsAlignedBox3d bounds;
+	uint32_t count;
+} SAHBin;
 
 inline static dsBVHNode* getNode(dsBVHNode* nodes, uint8_t nodeSize, uint32_t index)
 {
 	return (dsBVHNode*)(((uint8_t*)nodes) + index*nodeSize);
 }
 
+static AddBoxFunction getAddBoxFunction(const dsBVH* bvh)
+{
+	switch (bvh->element)
+	{
+		case dsGeometryElement_Float:
+			if (bvh->axisCount == 2)
+				return (AddBoxFunction)&dsAlignedBox2f_addBox;
+			DS_ASSERT(bvh->axisCount == 3);
+			return (AddBoxFunction)&dsAlignedBox3f_addBox;
+		case dsGeometryElement_Double:
+			if (bvh->axisCount == 2)
+				return (AddBoxFunction)&dsAlignedBox2d_addBox;
+			DS_ASSERT(bvh->axisCount == 3);
+			return (AddBoxFunction)&dsAlignedBox3d_addBox;
+		case dsGeometryElement_Int:
+			if (bvh->axisCount == 2)
+				return (AddBoxFunction)&dsAlignedBox2i_addBox;
+			DS_ASSERT(bvh->axisCount == 3);
+			return (AddBoxFunction)&dsAlignedBox3i_addBox;
+		default:
+			DS_ASSERT(false);
+			return NULL;
+	}
+}
+
+static void setInternalNode(dsBVH* bvh, uint32_t node, uint32_t leftNode, uint32_t rightNode,
+	AddBoxFunction addBoxFunc)
+{
+	DS_ASSERT(leftNode == node + 1);
+	DS_UNUSED(leftNode);
+	dsBVHNode* bvhNode = getNode(bvh->nodes, bvh->nodeSize, node);
+	const dsBVHNode* rightBVHNode = getNode(bvh->nodes, bvh->nodeSize, rightNode);
+	bvhNode->skipNode = rightBVHNode->skipNode;
+	bvhNode->rightNode = rightNode;
+	bvhNode->object = NULL;
+	memcpy(bvhNode->bounds, getNode(bvh->nodes, bvh->nodeSize, node + 1)->bounds,
+		bvh->boundsSize);
+	addBoxFunc(bvhNode->bounds, rightBVHNode->bounds);
+}
+
+static bool reserveTempNodes(dsBVH* bvh, uint32_t objectCount)
+{
+	if (bvh->tempNodes && objectCount <= bvh->maxTempNodes)
+		return true;
+
+	DS_VERIFY(dsAllocator_free(bvh->allocator, bvh->tempNodes));
+	bvh->tempNodes = (dsBVHNode*)dsAllocator_alloc(bvh->allocator, bvh->nodeSize*objectCount);
+	if (!bvh->tempNodes)
+	{
+		bvh->maxTempNodes = 0;
+		return false;
+	}
+
+	bvh->maxTempNodes = objectCount;
+	return true;
+}
+
+static bool fillTempNodes(dsBVH* bvh, const void* objects, uint32_t objectCount,
+	size_t objectSize)
+{
+	for (uint32_t i = 0; i < objectCount; ++i)
+	{
+		dsBVHNode* node = getNode(bvh->tempNodes, bvh->nodeSize, i);
+		node->object = dsSpatialStructure_getObject(objects, objectSize, i);
+		if (!bvh->objectBoundsFunc(node->bounds, bvh, node->object))
+			return false;
+
+		node->skipNode = node->rightNode = INVALID_NODE;
+	}
+
+	return true;
+}
+
+static bool reserveBuildBuffer(dsBVH* bvh, size_t size)
+{
+	if (size <= bvh->buildBufferSize)
+		return true;
+
+	DS_VERIFY(dsAllocator_free(bvh->allocator, bvh->buildBuffer));
+	bvh->buildBuffer = dsAllocator_alloc(bvh->allocator, size);
+	if (!bvh->buildBuffer)
+	{
+		bvh->buildBufferSize = 0;
+		return false;
+	}
+
+	bvh->buildBufferSize = size;
+	return true;
+}
+
 static int compareBoundsf(const void* left, const void* right, void* context)
 {
 	const SortContext* sortContext = (const SortContext*)context;
@@ -123,7 +376,7 @@ static int compareBoundsi(const void* left, const void* right, void* context)
 	return leftAverage - rightAverage;
 }
 
-static uint32_t buildBVHBalancedRec(dsBVH* bvh, uint32_t start, uint32_t count,
+static uint32_t buildBVHBalancedRec(dsBVH* bvh, uint32_t start, uint32_t count, uint32_t depth,
 	AddBoxFunction addBoxFunc, MaxAxisFunction maxAxisFunc, dsSortCompareFunction compareFunc)
 {
 	uint32_t node = bvh->nodeCount++;
@@ -134,6 +387,9 @@ static uint32_t buildBVHBalancedRec(dsBVH* bvh, uint32_t start, uint32_t count,
 	if (count == 1)
 	{
 		memcpy(bvhNode, getNode(bvh->tempNodes, bvh->nodeSize, start), bvh->nodeSize);
+		bvhNode->skipNode = node + 1;
+		if (depth > bvh->maxDepth)
+			bvh->maxDepth = depth;
 		return node;
 	}
 
@@ -151,19 +407,20 @@ static uint32_t buildBVHBalancedRec(dsBVH* bvh, uint32_t start, uint32_t count,
 
 	// Recursively add the nodes.
 	uint32_t middle = (uint32_t)count/2;
-	uint32_t leftNode = buildBVHBalancedRec(bvh, start, middle, addBoxFunc, maxAxisFunc,
+	uint32_t leftNode = buildBVHBalancedRec(bvh, start, middle, depth + 1, addBoxFunc, maxAxisFunc,
 		compareFunc);
 	if (leftNode == INVALID_NODE)
 		return INVALID_NODE;
 
-	uint32_t rightNode = buildBVHBalancedRec(bvh, start + middle, count - middle, addBoxFunc,
-		maxAxisFunc, compareFunc);
+	uint32_t rightNode = buildBVHBalancedRec(bvh, start + middle, count - middle, depth + 1,
+		addBoxFunc, maxAxisFunc, compareFunc);
 	if (rightNode == INVALID_NODE)
 		return INVALID_NODE;
 
 	// Reset pointer due to possible re-allocations of the array.
+	DS_ASSERT(leftNode == node + 1);
 	bvhNode = getNode(bvh->nodes, bvh->nodeSize, node);
-	bvhNode->leftNode = leftNode;
+	bvhNode->skipNode = getNode(bvh->nodes, bvh->nodeSize, rightNode)->skipNode;
 	bvhNode->rightNode = rightNode;
 	bvhNode->object = NULL;
 	memcpy(bvhNode->bounds, &bounds, bvh->boundsSize);
@@ -171,7 +428,7 @@ static uint32_t buildBVHBalancedRec(dsBVH* bvh, uint32_t start, uint32_t count,
 }
 
 static uint32_t buildBVHRec(dsBVH* bvh, const void* objects, uint32_t start, uint32_t count,
-	size_t objectSize, AddBoxFunction addBoxFunc)
+	uint32_t depth, size_t objectSize, AddBoxFunction addBoxFunc)
 {
 	uint32_t node = bvh->nodeCount++;
 	// Should be guaranteed that reserved nodes is sufficient.
@@ -180,8 +437,10 @@ static uint32_t buildBVHRec(dsBVH* bvh, const void* objects, uint32_t start, uin
 	dsBVHNode* bvhNode = getNode(bvh->nodes, bvh->nodeSize, node);
 	if (count == 1)
 	{
-		bvhNode->leftNode = INVALID_NODE;
+		bvhNode->skipNode = node + 1;
 		bvhNode->rightNode = INVALID_NODE;
+		if (depth > bvh->maxDepth)
+			bvh->maxDepth = depth;
 		bvhNode->object = dsSpatialStructure_getObject(objects, objectSize, start);
 		if (!bvh->objectBoundsFunc(bvhNode->bounds, bvh, bvhNode->object))
 			return INVALID_NODE;
@@ -207,259 +466,1699 @@ static uint32_t buildBVHRec(dsBVH* bvh, const void* objects, uint32_t start, uin
 
 	// Recursively add the nodes.
 	uint32_t middle = (uint32_t)count/2;
-	uint32_t leftNode = buildBVHRec(bvh, objects, start, middle, objectSize, addBoxFunc);
+	uint32_t leftNode = buildBVHRec(bvh, objects, start, middle, depth + 1, objectSize,
+		addBoxFunc);
 	if (leftNode == INVALID_NODE)
 		return INVALID_NODE;
 
-	uint32_t rightNode = buildBVHRec(bvh, objects, start + middle, count - middle, objectSize,
-		addBoxFunc);
+	uint32_t rightNode = buildBVHRec(bvh, objects, start + middle, count - middle, depth + 1,
+		objectSize, addBoxFunc);
 	if (rightNode == INVALID_NODE)
 		return INVALID_NODE;
 
 	// Reset pointer due to possible re-allocations of the array.
+	DS_ASSERT(leftNode == node + 1);
 	bvhNode = getNode(bvh->nodes, bvh->nodeSize, node);
-	bvhNode->leftNode = leftNode;
+	bvhNode->skipNode = getNode(bvh->nodes, bvh->nodeSize, rightNode)->skipNode;
 	bvhNode->rightNode = rightNode;
 	bvhNode->object = NULL;
 	memcpy(bvhNode->bounds, &bounds, bvh->boundsSize);
 	return node;
 }
 
-static bool updateBVHRec(dsBVH* bvh, dsBVHNode* node, AddBoxFunction addBoxFunc)
+static void boundsToDouble(dsAlignedBox3d* result, const void* bounds, dsGeometryElement element,
+	uint8_t axisCount)
 {
-	if (node->leftNode == INVALID_NODE && node->rightNode == INVALID_NODE)
+	// Initialize all values so the result is always defined, even for an invalid element.
+	dsAlignedBox3d_makeInvalid(result);
+	result->min.z = result->max.z = 0.0;
+	for (uint8_t i = 0; i < axisCount; ++i)
 	{
-		DS_ASSERT(node->leftNode == INVALID_NODE && node->rightNode == INVALID_NODE);
-		return bvh->objectBoundsFunc(node->bounds, bvh, node->object);
+		switch (element)
+		{
+			case dsGeometryElement_Float:
+				result->min.values[i] = ((const float*)bounds)[i];
+				result->max.values[i] = ((const float*)bounds)[axisCount + i];
+				break;
+			case dsGeometryElement_Double:
+				result->min.values[i] = ((const double*)bounds)[i];
+				result->max.values[i] = ((const double*)bounds)[axisCount + i];
+				break;
+			case dsGeometryElement_Int:
+				result->min.values[i] = ((const int*)bounds)[i];
+				result->max.values[i] = ((const int*)bounds)[axisCount + i];
+				break;
+			default:
+				DS_ASSERT(false);
+				break;
+		}
 	}
+}
 
-	DS_ASSERT(!node->object);
-	dsBVHNode* left = getNode(bvh->nodes, bvh->nodeSize, node->leftNode);
-	dsBVHNode* right = getNode(bvh->nodes, bvh->nodeSize, node->rightNode);
-	if (!updateBVHRec(bvh, left, addBoxFunc) || !updateBVHRec(bvh, right, addBoxFunc))
-		return false;
+static double surfaceAreaCost(const dsAlignedBox3d* bounds, uint8_t axisCount)
+{
+	// Proportional to the surface area (3D) or perimeter (2D), which is all that matters for
+	// comparing costs.
+	double x = bounds->max.x - bounds->min.x;
+	double y = bounds->max.y - bounds->min.y;
+	if (axisCount == 2)
+		return x + y;
+
+	double z = bounds->max.z - bounds->min.z;
+	return x*y + y*z + z*x;
+}
 
-	memcpy(node->bounds, left->bounds, bvh->boundsSize);
-	addBoxFunc(node->bounds, right->bounds);
-	return true;
+static uint32_t getSAHBin(const dsAlignedBox3d* bounds, uint8_t axis, double minCentroid,
+	double scale)
+{
+	double centroid = (bounds->min.values[axis] + bounds->max.values[axis])*0.5;
+	uint32_t bin = (uint32_t)((centroid - minCentroid)*scale);
+	return bin < SAH_BIN_COUNT ? bin : SAH_BIN_COUNT - 1;
 }
 
-// NOTE: bool return value is whether or not to continue traversing
-static bool intersectBVHRec(const dsBVH* bvh, uint32_t* count, const dsBVHNode* node,
-	const void* bounds, dsBVHVisitFunction visitor, void* userData, IntersectFunction intersectFunc)
+// Partitions the objects and returns the number of objects for the left side.
+static uint32_t partitionSAH(const SAHBuildContext* context, uint32_t start, uint32_t count,
+	uint32_t depth)
 {
-	if (!intersectFunc(bounds, node->bounds))
-		return true;
+	if (count == 2 || depth >= SAH_MAX_DEPTH)
+		return count/2;
 
-	if (node->leftNode == INVALID_NODE && node->rightNode == INVALID_NODE)
+	uint8_t axisCount = context->bvh->axisCount;
+	uint32_t* indices = context->objectIndices + start;
+	const dsAlignedBox3d* objectBounds = context->objectBounds;
+
+	dsAlignedBox3d centroidBounds;
+	dsAlignedBox3d_makeInvalid(&centroidBounds);
+	for (uint32_t i = 0; i < count; ++i)
 	{
-		DS_ASSERT(node->leftNode == INVALID_NODE && node->rightNode == INVALID_NODE);
-		++*count;
-		if (visitor)
-			return visitor(userData, bvh, node->object, bounds);
-		return true;
+		const dsAlignedBox3d* bounds = objectBounds + indices[i];
+		dsVector3d centroid;
+		dsVector3_add(centroid, bounds->min, bounds->max);
+		dsVector3_scale(centroid, centroid, 0.5);
+		dsAlignedBox3_addPoint(centroidBounds, centroid);
 	}
 
-	DS_ASSERT(!node->object);
-	dsBVHNode* left = getNode(bvh->nodes, bvh->nodeSize, node->leftNode);
-	dsBVHNode* right = getNode(bvh->nodes, bvh->nodeSize, node->rightNode);
-	if (!intersectBVHRec(bvh, count, left, bounds, visitor, userData, intersectFunc))
-		return false;
-	return intersectBVHRec(bvh, count, right, bounds, visitor, userData, intersectFunc);
-}
-
-dsBVH* dsBVH_create(dsAllocator* allocator, uint8_t axisCount, dsGeometryElement element,
-	void* userData)
-{
-	if (!allocator || axisCount < 2 || axisCount > 3 || element < dsGeometryElement_Float ||
-		element > dsGeometryElement_Int)
+	double bestCost = DBL_MAX;
+	uint8_t bestAxis = 0;
+	uint32_t bestBin = 0;
+	double bestScale = 0.0;
+	for (uint8_t axis = 0; axis < axisCount; ++axis)
 	{
-		errno = EINVAL;
-		return NULL;
+		double minCentroid = centroidBounds.min.values[axis];
+		double extent = centroidBounds.max.values[axis] - minCentroid;
+		if (extent <= 0.0)
+			continue;
+
+		SAHBin bins[SAH_BIN_COUNT];
+		for (uint32_t i = 0; i < SAH_BIN_COUNT; ++i)
+		{
+			dsAlignedBox3d_makeInvalid(&bins[i].bounds);
+			bins[i].count = 0;
+		}
+
+		double scale = SAH_BIN_COUNT/extent;
+		for (uint32_t i = 0; i < count; ++i)
+		{
+			const dsAlignedBox3d* bounds = objectBounds + indices[i];
+			SAHBin* bin = bins + getSAHBin(bounds, axis, minCentroid, scale);
+			dsAlignedBox3d_addBox(&bin->bounds, bounds);
+			++bin->count;
+		}
+
+		// Sweep from the right to get the cost of the right side for each split.
+		double rightCosts[SAH_BIN_COUNT - 1];
+		dsAlignedBox3d sideBounds;
+		dsAlignedBox3d_makeInvalid(&sideBounds);
+		uint32_t sideCount = 0;
+		for (uint32_t i = SAH_BIN_COUNT - 1; i > 0; --i)
+		{
+			dsAlignedBox3d_addBox(&sideBounds, &bins[i].bounds);
+			sideCount += bins[i].count;
+			rightCosts[i - 1] = sideCount > 0 ?
+				surfaceAreaCost(&sideBounds, axisCount)*sideCount : -1.0;
+		}
+
+		// Then sweep from the left, splitting after bin i.
+		dsAlignedBox3d_makeInvalid(&sideBounds);
+		sideCount = 0;
+		for (uint32_t i = 0; i < SAH_BIN_COUNT - 1; ++i)
+		{
+			dsAlignedBox3d_addBox(&sideBounds, &bins[i].bounds);
+			sideCount += bins[i].count;
+			if (sideCount == 0 || rightCosts[i] < 0.0)
+				continue;
+
+			double cost = surfaceAreaCost(&sideBounds, axisCount)*sideCount + rightCosts[i];
+			if (cost < bestCost)
+			{
+				bestCost = cost;
+				bestAxis = axis;
+				bestBin = i;
+				bestScale = scale;
+			}
+		}
 	}
 
-	if (!allocator->freeFunc)
+	// All centroids are in the same location.
+	if (bestCost == DBL_MAX)
+		return count/2;
+
+	uint32_t left = 0;
+	uint32_t right = count;
+	double minCentroid = centroidBounds.min.values[bestAxis];
+	while (left < right)
 	{
-		errno = EINVAL;
-		DS_LOG_ERROR(DS_GEOMETRY_LOG_TAG, "BVH allocator must support freeing memory.");
-		return NULL;
+		if (getSAHBin(objectBounds + indices[left], bestAxis, minCentroid, bestScale) <= bestBin)
+			++left;
+		else
+		{
+			--right;
+			uint32_t temp = indices[left];
+			indices[left] = indices[right];
+			indices[right] = temp;
+		}
 	}
 
-	dsBVH* bvh = DS_ALLOCATE_OBJECT(allocator, dsBVH);
-	if (!bvh)
-		return NULL;
+	DS_ASSERT(left > 0 && left < count);
+	return left;
+}
 
-	memset(bvh, 0, sizeof(dsBVH));
-	bvh->allocator = dsAllocator_keepPointer(allocator);
-	bvh->userData = userData;
-	bvh->axisCount = axisCount;
-	bvh->element = element;
-	switch (element)
+// Subtrees are laid out depth-first, where a subtree for n objects always has 2*n - 1 nodes. This
+// allows the node indices to be known ahead of time so subtrees may be built independently.
+// Returns the maximum depth of the leaf nodes.
+static uint32_t buildSAHRec(const SAHBuildContext* context, uint32_t start, uint32_t count,
+	uint32_t node, uint32_t depth)
+{
+	dsBVH* bvh = context->bvh;
+	if (count == 1)
 	{
-		case dsGeometryElement_Float:
-			bvh->boundsSize = (uint8_t)(sizeof(float)*axisCount*2);
-			break;
-		case dsGeometryElement_Double:
-			bvh->boundsSize = (uint8_t)(sizeof(double)*axisCount*2);
-			break;
-		case dsGeometryElement_Int:
-			bvh->boundsSize = (uint8_t)(sizeof(int)*axisCount*2);
-			break;
-		default:
-			DS_ASSERT(false);
-			break;
+		dsBVHNode* bvhNode = getNode(bvh->nodes, bvh->nodeSize, node);
+		memcpy(bvhNode, getNode(bvh->tempNodes, bvh->nodeSize, context->objectIndices[start]),
+			bvh->nodeSize);
+		bvhNode->skipNode = node + 1;
+		return depth;
 	}
 
-	size_t nodeSize = sizeof(dsBVHNode) + bvh->boundsSize;
-	DS_ASSERT(nodeSize <= UINT8_MAX);
-	bvh->nodeSize = (uint8_t)nodeSize;
-
-	return bvh;
+	uint32_t leftCount = partitionSAH(context, start, count, depth);
+	uint32_t leftNode = node + 1;
+	uint32_t rightNode = node + leftCount*2;
+	uint32_t leftDepth = buildSAHRec(context, start, leftCount, leftNode, depth + 1);
+	uint32_t rightDepth = buildSAHRec(context, start + leftCount, count - leftCount, rightNode,
+		depth + 1);
+	setInternalNode(bvh, node, leftNode, rightNode, context->addBoxFunc);
+	return dsMax(leftDepth, rightDepth);
 }
 
-uint8_t dsBVH_getAxisCount(const dsBVH* bvh)
+static void buildSAHTask(void* userData)
 {
-	if (!bvh)
-		return 0;
-
-	return bvh->axisCount;
+	SAHBuildTask* task = (SAHBuildTask*)userData;
+	task->maxDepth = buildSAHRec(task->context, task->start, task->count, task->node,
+		task->depth);
 }
 
-dsGeometryElement dsBVH_getElement(const dsBVH* bvh)
+// Splits the top of the tree until subtrees are small enough to build as separate tasks. The
+// internal nodes that were split are recorded in order so their bounds may be set afterward. Once
+// the maximum number of split nodes is reached the remaining subtrees become tasks regardless of
+// their size, since a binary tree always has one more leaf than internal node.
+static void splitSAHTasks(const SAHBuildContext* context, uint32_t start, uint32_t count,
+	uint32_t node, uint32_t depth, uint32_t taskObjects, SAHBuildTask* tasks, uint32_t* taskCount,
+	SAHSplitNode* splitNodes, uint32_t* splitNodeCount, uint32_t maxSplitNodes)
 {
-	if (!bvh)
-		return dsGeometryElement_Float;
+	if (count <= taskObjects || *splitNodeCount >= maxSplitNodes)
+	{
+		SAHBuildTask* task = tasks + (*taskCount)++;
+		task->context = context;
+		task->start = start;
+		task->count = count;
+		task->node = node;
+		task->depth = depth;
+		task->maxDepth = depth;
+		return;
+	}
 
-	return bvh->element;
+	uint32_t leftCount = partitionSAH(context, start, count, depth);
+	SAHSplitNode* splitNode = splitNodes + (*splitNodeCount)++;
+	splitNode->node = node;
+	splitNode->leftNode = node + 1;
+	splitNode->rightNode = node + leftCount*2;
+	splitSAHTasks(context, start, leftCount, splitNode->leftNode, depth + 1, taskObjects, tasks,
+		taskCount, splitNodes, splitNodeCount, maxSplitNodes);
+	splitSAHTasks(context, start + leftCount, count - leftCount, splitNode->rightNode, depth + 1,
+		taskObjects, tasks, taskCount, splitNodes, splitNodeCount, maxSplitNodes);
 }
 
-void* dsBVH_getUserData(const dsBVH* bvh)
+static uint32_t getSAHTaskObjects(uint32_t objectCount, dsThreadPool* threadPool)
 {
-	if (!bvh)
-		return NULL;
-
-	return bvh->userData;
+	// The current thread also executes tasks, so include it in the thread count.
+	uint32_t taskObjects = objectCount/((dsThreadPool_getThreadCount(threadPool) + 1)*8);
+	return taskObjects < SAH_MIN_TASK_OBJECTS ? SAH_MIN_TASK_OBJECTS : taskObjects;
 }
 
-void dsBVH_setUserData(dsBVH* bvh, void* userData)
+static uint32_t getMaxSAHSplitNodes(uint32_t objectCount, uint32_t taskObjects)
 {
-	if (bvh)
-		bvh->userData = userData;
+	// Enough split nodes for a reasonably balanced tree. Highly unbalanced trees will have larger
+	// tasks.
+	return objectCount/taskObjects*2 + 1;
 }
 
-bool dsBVH_build(dsBVH* bvh, const void* objects, uint32_t objectCount, size_t objectSize,
-	dsBVHObjectBoundsFunction objectBoundsFunc, bool balance)
+static void buildSAHParallel(const SAHBuildContext* context, uint32_t objectCount,
+	dsThreadPool* threadPool, uint32_t taskObjects, SAHSplitNode* splitNodes,
+	uint32_t maxSplitNodes, SAHBuildTask* tasks)
 {
-	dsBVH_clear(bvh);
-	if (!bvh || (!objects && objectCount > 0 && objectSize != DS_GEOMETRY_OBJECT_INDICES) ||
-		!objectBoundsFunc)
+	dsBVH* bvh = context->bvh;
+	uint32_t taskCount = 0, splitNodeCount = 0;
+	splitSAHTasks(context, 0, objectCount, 0, 0, taskObjects, tasks, &taskCount, splitNodes,
+		&splitNodeCount, maxSplitNodes);
+	DS_ASSERT(splitNodeCount <= maxSplitNodes && taskCount == splitNodeCount + 1);
+
+	dsTaskGraph* taskGraph = NULL;
+	if (taskCount > 1)
+		taskGraph = dsTaskGraph_create(bvh->allocator, threadPool);
+
+	bool executed = false;
+	if (taskGraph)
 	{
-		errno = EINVAL;
-		return false;
+		bool added = true;
+		for (uint32_t i = 0; i < taskCount && added; ++i)
+			added = dsTaskGraph_addTask(taskGraph, &buildSAHTask, tasks + i) != DS_NO_TASK;
+		executed = added && dsTaskGraph_execute(taskGraph);
+		dsTaskGraph_destroy(taskGraph);
 	}
 
-	if (objectCount == 0)
-		return true;
-
-	AddBoxFunction addBoxFunc;
-	MaxAxisFunction maxAxisFunc;
-	dsSortCompareFunction compareFunc;
-	switch (bvh->element)
+	// Fall back to building on the current thread, such as if the task graph couldn't be created.
+	if (!executed)
 	{
-		case dsGeometryElement_Float:
-			if (bvh->axisCount == 2)
-			{
-				addBoxFunc = (AddBoxFunction)&dsAlignedBox2f_addBox;
-				maxAxisFunc = &dsSpatialStructure_maxAxis2f;
-			}
-			else
-			{
-				DS_ASSERT(bvh->axisCount == 3);
-				addBoxFunc = (AddBoxFunction)&dsAlignedBox3f_addBox;
-				maxAxisFunc = &dsSpatialStructure_maxAxis3f;
-			}
-			compareFunc = &compareBoundsf;
-			break;
-		case dsGeometryElement_Double:
-			if (bvh->axisCount == 2)
-			{
-				addBoxFunc = (AddBoxFunction)&dsAlignedBox2d_addBox;
-				maxAxisFunc = &dsSpatialStructure_maxAxis2d;
-			}
-			else
-			{
-				DS_ASSERT(bvh->axisCount == 3);
-				addBoxFunc = (AddBoxFunction)&dsAlignedBox3d_addBox;
-				maxAxisFunc = &dsSpatialStructure_maxAxis3d;
-			}
-			compareFunc = &compareBoundsd;
-			break;
-		case dsGeometryElement_Int:
-			if (bvh->axisCount == 2)
-			{
-				addBoxFunc = (AddBoxFunction)&dsAlignedBox2i_addBox;
-				maxAxisFunc = &dsSpatialStructure_maxAxis2i;
-			}
-			else
-			{
-				DS_ASSERT(bvh->axisCount == 3);
-				addBoxFunc = (AddBoxFunction)&dsAlignedBox3i_addBox;
-				maxAxisFunc = &dsSpatialStructure_maxAxis3i;
-			}
-			compareFunc = &compareBoundsi;
-			break;
-		default:
-			DS_ASSERT(false);
-			return false;
+		for (uint32_t i = 0; i < taskCount; ++i)
+			buildSAHTask(tasks + i);
 	}
 
-	// Reserve space for BVH. Perfect binary tree, so n = 2*l + 1
-	// (where n is number of nodes, l is number of leaves)
-	uint32_t nodeCount = objectCount*2 - 1;
-	if (!dsResizeableArray_add(bvh->allocator, (void**)&bvh->nodes, &bvh->nodeCount,
-		&bvh->maxNodes, bvh->nodeSize, nodeCount))
+	for (uint32_t i = 0; i < taskCount; ++i)
+		bvh->maxDepth = dsMax(bvh->maxDepth, tasks[i].maxDepth);
+
+	// Children are always after their parents, so set the bounds in reverse order.
+	for (uint32_t i = splitNodeCount; i-- > 0;)
 	{
-		return false;
+		const SAHSplitNode* splitNode = splitNodes + i;
+		setInternalNode(bvh, splitNode->node, splitNode->leftNode, splitNode->rightNode,
+			context->addBoxFunc);
 	}
-	bvh->nodeCount = 0;
+}
 
-	bvh->objectBoundsFunc = objectBoundsFunc;
-	uint32_t rootNode;
-	if (balance)
-	{
-		if (!bvh->tempNodes || objectCount > bvh->maxTempNodes)
-		{
-			dsAllocator_free(bvh->allocator, bvh->tempNodes);
-			bvh->tempNodes = (dsBVHNode*)dsAllocator_alloc(bvh->allocator,
-				bvh->nodeSize*objectCount);
-			if (!bvh)
-				return false;
-			bvh->maxTempNodes = objectCount;
-		}
+inline static bool isLeaf(const dsBVHNode* node)
+{
+	return node->rightNode == INVALID_NODE;
+}
 
-		for (uint32_t i = 0; i < objectCount; ++i)
+static bool updateBVHNodes(dsBVH* bvh, AddBoxFunction addBoxFunc)
+{
+	// Children are always after their parents, so updating in reverse order guarantees the
+	// children are updated first.
+	for (uint32_t i = bvh->nodeCount; i-- > 0;)
+	{
+		dsBVHNode* node = getNode(bvh->nodes, bvh->nodeSize, i);
+		if (isLeaf(node))
 		{
-			dsBVHNode* node = getNode(bvh->tempNodes, bvh->nodeSize, i);
-			node->object = dsSpatialStructure_getObject(objects, objectSize, i);
 			if (!bvh->objectBoundsFunc(node->bounds, bvh, node->object))
 				return false;
-
-			node->leftNode = node->rightNode = INVALID_NODE;
+			continue;
 		}
 
-		rootNode = buildBVHBalancedRec(bvh, 0, objectCount, addBoxFunc, maxAxisFunc, compareFunc);
+		DS_ASSERT(!node->object);
+		memcpy(node->bounds, getNode(bvh->nodes, bvh->nodeSize, i + 1)->bounds, bvh->boundsSize);
+		addBoxFunc(node->bounds, getNode(bvh->nodes, bvh->nodeSize, node->rightNode)->bounds);
 	}
-	else
-		rootNode = buildBVHRec(bvh, objects, 0, objectCount, objectSize, addBoxFunc);
 
-	if (rootNode == INVALID_NODE)
+	return true;
+}
+
+// NOTE: bool return value is whether or not to continue traversing
+static bool visitBVHNodes(const dsBVH* bvh, uint32_t* count, uint32_t start, uint32_t end,
+	const void* bounds, dsBVHVisitFunction visitor, void* userData)
+{
+	for (uint32_t i = start; i < end; ++i)
+	{
+		const dsBVHNode* node = getNode(bvh->nodes, bvh->nodeSize, i);
+		if (!isLeaf(node))
+			continue;
+
+		++*count;
+		if (visitor && !visitor(userData, bvh, node->object, bounds))
+			return false;
+	}
+
+	return true;
+}
+
+static uint32_t intersectBVHNodes(const dsBVH* bvh, const void* bounds,
+	dsBVHVisitFunction visitor, void* userData, IntersectFunction intersectFunc)
+{
+	uint32_t count = 0;
+	uint32_t i = 0;
+	while (i < bvh->nodeCount)
+	{
+		const dsBVHNode* node = getNode(bvh->nodes, bvh->nodeSize, i);
+		if (!intersectFunc(bounds, node->bounds))
+		{
+			i = node->skipNode;
+			continue;
+		}
+
+		if (isLeaf(node))
+		{
+			++count;
+			if (visitor && !visitor(userData, bvh, node->object, bounds))
+				break;
+		}
+
+		// Either the left child or the next node after the leaf.
+		++i;
+	}
+
+	return count;
+}
+
+static uint32_t intersectFrustumBVHNodes(const dsBVH* bvh, const void* frustum,
+	dsBVHVisitFunction visitor, void* userData, IntersectFrustumFunction intersectFunc)
+{
+	uint32_t count = 0;
+	uint32_t i = 0;
+	while (i < bvh->nodeCount)
+	{
+		const dsBVHNode* node = getNode(bvh->nodes, bvh->nodeSize, i);
+		switch (intersectFunc(frustum, node->bounds))
+		{
+			case dsIntersectResult_Outside:
+				i = node->skipNode;
+				continue;
+			case dsIntersectResult_Inside:
+				// Everything below is also inside, so no need to test further.
+				if (!visitBVHNodes(bvh, &count, i, node->skipNode, frustum, visitor, userData))
+					return count;
+				i = node->skipNode;
+				continue;
+			default:
+				break;
+		}
+
+		if (isLeaf(node))
+		{
+			++count;
+			if (visitor && !visitor(userData, bvh, node->object, frustum))
+				break;
+		}
+
+		++i;
+	}
+
+	return count;
+}
+
+static float wideChildCost(const dsBVH* bvh, uint32_t node)
+{
+	const float* bounds = (const float*)getNode(bvh->nodes, bvh->nodeSize, node)->bounds;
+	const float* maxBounds = bounds + bvh->axisCount;
+	float x = maxBounds[0] - bounds[0];
+	float y = maxBounds[1] - bounds[1];
+	if (bvh->axisCount == 2)
+		return x + y;
+
+	float z = maxBounds[2] - bounds[2];
+	return x*y + y*z + z*x;
+}
+
+static void setWideChildBounds(WideNode* wideNode, uint32_t child, const dsBVH* bvh,
+	uint32_t node)
+{
+	const float* bounds = (const float*)getNode(bvh->nodes, bvh->nodeSize, node)->bounds;
+	const float* maxBounds = bounds + bvh->axisCount;
+	wideNode->minX[child] = bounds[0];
+	wideNode->minY[child] = bounds[1];
+	wideNode->maxX[child] = maxBounds[0];
+	wideNode->maxY[child] = maxBounds[1];
+	if (bvh->axisCount == 3)
+	{
+		wideNode->minZ[child] = bounds[2];
+		wideNode->maxZ[child] = maxBounds[2];
+	}
+	else
+		wideNode->minZ[child] = wideNode->maxZ[child] = 0.0f;
+}
+
+static uint32_t addWideNodeRec(dsBVH* bvh, uint32_t node, uint32_t depth, uint32_t* maxDepth)
+{
+	if (depth > *maxDepth)
+		*maxDepth = depth;
+
+	uint32_t wideIndex = bvh->wideNodeCount;
+	if (!dsResizeableArray_add(bvh->allocator, (void**)&bvh->wideNodes, &bvh->wideNodeCount,
+			&bvh->maxWideNodes, sizeof(WideNode), 1))
+	{
+		return INVALID_NODE;
+	}
+
+	// Expand the child with the largest bounds until there are enough children.
+	const dsBVHNode* bvhNode = getNode(bvh->nodes, bvh->nodeSize, node);
+	uint32_t binaryNodes[WIDE_NODE_CHILDREN] = {node + 1, bvhNode->rightNode};
+	uint32_t childCount = 2;
+	while (childCount < WIDE_NODE_CHILDREN)
+	{
+		uint32_t expandChild = INVALID_NODE;
+		float maxCost = -1.0f;
+		for (uint32_t i = 0; i < childCount; ++i)
+		{
+			if (isLeaf(getNode(bvh->nodes, bvh->nodeSize, binaryNodes[i])))
+				continue;
+
+			float cost = wideChildCost(bvh, binaryNodes[i]);
+			if (cost > maxCost)
+			{
+				maxCost = cost;
+				expandChild = i;
+			}
+		}
+
+		if (expandChild == INVALID_NODE)
+			break;
+
+		uint32_t expandNode = binaryNodes[expandChild];
+		binaryNodes[expandChild] = expandNode + 1;
+		binaryNodes[childCount++] = getNode(bvh->nodes, bvh->nodeSize, expandNode)->rightNode;
+	}
+
+	// Build on the stack since the array may be re-allocated when adding children.
+	WideNode wideNode;
+	for (uint32_t i = 0; i < WIDE_NODE_CHILDREN; ++i)
+	{
+		if (i >= childCount)
+		{
+			wideNode.minX[i] = wideNode.minY[i] = wideNode.minZ[i] = FLT_MAX;
+			wideNode.maxX[i] = wideNode.maxY[i] = wideNode.maxZ[i] = -FLT_MAX;
+			wideNode.children[i] = INVALID_NODE;
+			wideNode.binaryNodes[i] = INVALID_NODE;
+			continue;
+		}
+
+		uint32_t childNode = binaryNodes[i];
+		setWideChildBounds(&wideNode, i, bvh, childNode);
+		wideNode.binaryNodes[i] = childNode;
+		if (isLeaf(getNode(bvh->nodes, bvh->nodeSize, childNode)))
+			wideNode.children[i] = childNode | WIDE_LEAF_FLAG;
+		else
+		{
+			wideNode.children[i] = addWideNodeRec(bvh, childNode, depth + 1, maxDepth);
+			if (wideNode.children[i] == INVALID_NODE)
+				return INVALID_NODE;
+		}
+	}
+
+	bvh->wideNodes[wideIndex] = wideNode;
+	return wideIndex;
+}
+
+static bool buildWideNodes(dsBVH* bvh)
+{
+	bvh->wideNodeCount = 0;
+	if (!bvh->useWideNodes || bvh->nodeCount < 3)
+		return true;
+
+	// Only used with SIMD instructions.
+#if DS_HAS_SIMD
+	if (!(dsSIMD_getHostFeatures() & dsSIMDFeatures_Float4))
+		return true;
+#else
+	return true;
+#endif
+
+	uint32_t maxDepth = 0;
+	if (addWideNodeRec(bvh, 0, 0, &maxDepth) == INVALID_NODE)
+	{
+		bvh->wideNodeCount = 0;
+		return false;
+	}
+
+	if (maxDepth > WIDE_MAX_DEPTH)
+		bvh->wideNodeCount = 0;
+	return true;
+}
+
+static void updateWideNodes(dsBVH* bvh)
+{
+	for (uint32_t i = 0; i < bvh->wideNodeCount; ++i)
+	{
+		WideNode* wideNode = bvh->wideNodes + i;
+		for (uint32_t j = 0; j < WIDE_NODE_CHILDREN; ++j)
+		{
+			if (wideNode->binaryNodes[j] != INVALID_NODE)
+				setWideChildBounds(wideNode, j, bvh, wideNode->binaryNodes[j]);
+		}
+	}
+}
+
+#if DS_HAS_SIMD
+
+// NOTE: bool return value is whether or not to continue traversing
+static bool visitWideChildren(const dsBVH* bvh, const WideNode* wideNode, uint32_t hitMask,
+	uint32_t* stack, uint32_t* stackSize, uint32_t* count, const void* bounds,
+	dsBVHVisitFunction visitor, void* userData)
+{
+	for (uint32_t i = 0; i < WIDE_NODE_CHILDREN; ++i)
+	{
+		uint32_t child = wideNode->children[i];
+		if (!(hitMask & (1U << i)) || child == INVALID_NODE)
+			continue;
+
+		if (child & WIDE_LEAF_FLAG)
+		{
+			++*count;
+			const dsBVHNode* node = getNode(bvh->nodes, bvh->nodeSize, child & ~WIDE_LEAF_FLAG);
+			if (visitor && !visitor(userData, bvh, node->object, bounds))
+				return false;
+		}
+		else
+		{
+			DS_ASSERT(*stackSize < WIDE_STACK_SIZE);
+			stack[(*stackSize)++] = child;
+		}
+	}
+
+	return true;
+}
+
+#if DS_X86_32 || DS_X86_64
+
+DS_SIMD_FUNC_FLOAT4
+static uint32_t intersectWideNodes(const dsBVH* bvh, const void* bounds,
+	dsBVHVisitFunction visitor, void* userData)
+{
+	const float* queryBounds = (const float*)bounds;
+	const float* queryMax = queryBounds + bvh->axisCount;
+	bool is3D = bvh->axisCount == 3;
+	__m128 minX = _mm_set1_ps(queryBounds[0]);
+	__m128 minY = _mm_set1_ps(queryBounds[1]);
+	__m128 minZ = _mm_set1_ps(is3D ? queryBounds[2] : 0.0f);
+	__m128 maxX = _mm_set1_ps(queryMax[0]);
+	__m128 maxY = _mm_set1_ps(queryMax[1]);
+	__m128 maxZ = _mm_set1_ps(is3D ? queryMax[2] : 0.0f);
+
+	uint32_t count = 0;
+	uint32_t stack[WIDE_STACK_SIZE];
+	uint32_t stackSize = 1;
+	stack[0] = 0;
+	while (stackSize > 0)
+	{
+		const WideNode* wideNode = bvh->wideNodes + stack[--stackSize];
+		__m128 hit = _mm_and_ps(_mm_cmple_ps(_mm_load_ps(wideNode->minX), maxX),
+			_mm_cmpge_ps(_mm_load_ps(wideNode->maxX), minX));
+		hit = _mm_and_ps(hit, _mm_and_ps(_mm_cmple_ps(_mm_load_ps(wideNode->minY), maxY),
+			_mm_cmpge_ps(_mm_load_ps(wideNode->maxY), minY)));
+		hit = _mm_and_ps(hit, _mm_and_ps(_mm_cmple_ps(_mm_load_ps(wideNode->minZ), maxZ),
+			_mm_cmpge_ps(_mm_load_ps(wideNode->maxZ), minZ)));
+
+		uint32_t hitMask = (uint32_t)_mm_movemask_ps(hit);
+		if (hitMask && !visitWideChildren(bvh, wideNode, hitMask, stack, &stackSize, &count,
+				bounds, visitor, userData))
+		{
+			break;
+		}
+	}
+
+	return count;
+}
+
+#else
+
+static inline uint32_t neonMoveMask(uint32x4_t value)
+{
+	const uint32_t bitValues[4] = {1, 2, 4, 8};
+	uint32x4_t bits = vandq_u32(value, vld1q_u32(bitValues));
+#if DS_ARM_64
+	return vaddvq_u32(bits);
+#else
+	uint32x2_t sum = vpadd_u32(vget_low_u32(bits), vget_high_u32(bits));
+	return vget_lane_u32(vpadd_u32(sum, sum), 0);
+#endif
+}
+
+static uint32_t intersectWideNodes(const dsBVH* bvh, const void* bounds,
+	dsBVHVisitFunction visitor, void* userData)
+{
+	const float* queryBounds = (const float*)bounds;
+	const float* queryMax = queryBounds + bvh->axisCount;
+	bool is3D = bvh->axisCount == 3;
+	float32x4_t minX = vdupq_n_f32(queryBounds[0]);
+	float32x4_t minY = vdupq_n_f32(queryBounds[1]);
+	float32x4_t minZ = vdupq_n_f32(is3D ? queryBounds[2] : 0.0f);
+	float32x4_t maxX = vdupq_n_f32(queryMax[0]);
+	float32x4_t maxY = vdupq_n_f32(queryMax[1]);
+	float32x4_t maxZ = vdupq_n_f32(is3D ? queryMax[2] : 0.0f);
+
+	uint32_t count = 0;
+	uint32_t stack[WIDE_STACK_SIZE];
+	uint32_t stackSize = 1;
+	stack[0] = 0;
+	while (stackSize > 0)
+	{
+		const WideNode* wideNode = bvh->wideNodes + stack[--stackSize];
+		uint32x4_t hit = vandq_u32(vcleq_f32(vld1q_f32(wideNode->minX), maxX),
+			vcgeq_f32(vld1q_f32(wideNode->maxX), minX));
+		hit = vandq_u32(hit, vandq_u32(vcleq_f32(vld1q_f32(wideNode->minY), maxY),
+			vcgeq_f32(vld1q_f32(wideNode->maxY), minY)));
+		hit = vandq_u32(hit, vandq_u32(vcleq_f32(vld1q_f32(wideNode->minZ), maxZ),
+			vcgeq_f32(vld1q_f32(wideNode->maxZ), minZ)));
+
+		uint32_t hitMask = neonMoveMask(hit);
+		if (hitMask && !visitWideChildren(bvh, wideNode, hitMask, stack, &stackSize, &count,
+				bounds, visitor, userData))
+		{
+			break;
+		}
+	}
+
+	return count;
+}
+
+#endif
+
+#endif
+
+static void getDoubleValues(double* outValues, const void* values, dsGeometryElement element,
+	uint8_t count)
+{
+	for (uint8_t i = 0; i < count; ++i)
+	{
+		switch (element)
+		{
+			case dsGeometryElement_Float:
+				outValues[i] = ((const float*)values)[i];
+				break;
+			case dsGeometryElement_Double:
+				outValues[i] = ((const double*)values)[i];
+				break;
+			case dsGeometryElement_Int:
+				outValues[i] = ((const int*)values)[i];
+				break;
+			default:
+				DS_ASSERT(false);
+				break;
+		}
+	}
+}
+
+static void getRayInfo(RayInfo* outRay, const dsBVH* bvh, const void* ray)
+{
+	// Int BVHs use double rays.
+	dsGeometryElement element = bvh->element == dsGeometryElement_Float ?
+		dsGeometryElement_Float : dsGeometryElement_Double;
+	double values[6];
+	getDoubleValues(values, ray, element, (uint8_t)(bvh->axisCount*2));
+	for (uint8_t i = 0; i < bvh->axisCount; ++i)
+	{
+		outRay->origin[i] = values[i];
+		outRay->direction[i] = values[bvh->axisCount + i];
+		outRay->invDirection[i] = 1.0/outRay->direction[i];
+	}
+}
+
+static bool intersectRayNode(double* outT, const dsBVH* bvh, const RayInfo* ray, uint32_t node,
+	double maxT)
+{
+	dsAlignedBox3d bounds;
+	boundsToDouble(&bounds, getNode(bvh->nodes, bvh->nodeSize, node)->bounds, bvh->element,
+		bvh->axisCount);
+
+	double minT = 0.0;
+	for (uint8_t i = 0; i < bvh->axisCount; ++i)
+	{
+		double origin = ray->origin[i];
+		if (ray->direction[i] == 0.0)
+		{
+			if (origin < bounds.min.values[i] || origin > bounds.max.values[i])
+				return false;
+			continue;
+		}
+
+		double t0 = (bounds.min.values[i] - origin)*ray->invDirection[i];
+		double t1 = (bounds.max.values[i] - origin)*ray->invDirection[i];
+		if (t0 > t1)
+		{
+			double temp = t0;
+			t0 = t1;
+			t1 = temp;
+		}
+
+		minT = dsMax(minT, t0);
+		maxT = dsMin(maxT, t1);
+		if (minT > maxT)
+			return false;
+	}
+
+	*outT = minT;
+	return true;
+}
+
+static double nodeDistance2(const dsBVH* bvh, const double* point, uint32_t node)
+{
+	dsAlignedBox3d bounds;
+	boundsToDouble(&bounds, getNode(bvh->nodes, bvh->nodeSize, node)->bounds, bvh->element,
+		bvh->axisCount);
+
+	double distance2 = 0.0;
+	for (uint8_t i = 0; i < bvh->axisCount; ++i)
+	{
+		double offset = dsMax(bounds.min.values[i] - point[i], point[i] - bounds.max.values[i]);
+		if (offset > 0.0)
+			distance2 += offset*offset;
+	}
+
+	return distance2;
+}
+
+inline static void pushOrderedEntry(OrderedEntry* stack, uint32_t* stackSize, uint32_t node,
+	double distance)
+{
+	OrderedEntry* entry = stack + (*stackSize)++;
+	entry->node = node;
+	entry->distance = distance;
+}
+
+// Pushes the farther child first so the closer child is visited first.
+static void pushOrderedChildren(OrderedEntry* stack, uint32_t* stackSize, uint32_t leftNode,
+	bool hitLeft, double leftDistance, uint32_t rightNode, bool hitRight, double rightDistance)
+{
+	if (hitLeft && hitRight)
+	{
+		if (leftDistance <= rightDistance)
+		{
+			pushOrderedEntry(stack, stackSize, rightNode, rightDistance);
+			pushOrderedEntry(stack, stackSize, leftNode, leftDistance);
+		}
+		else
+		{
+			pushOrderedEntry(stack, stackSize, leftNode, leftDistance);
+			pushOrderedEntry(stack, stackSize, rightNode, rightDistance);
+		}
+	}
+	else if (hitLeft)
+		pushOrderedEntry(stack, stackSize, leftNode, leftDistance);
+	else if (hitRight)
+		pushOrderedEntry(stack, stackSize, rightNode, rightDistance);
+}
+
+static double nodeSurfaceAreaCost(const dsBVH* bvh, uint32_t node)
+{
+	dsAlignedBox3d bounds;
+	boundsToDouble(&bounds, getNode(bvh->nodes, bvh->nodeSize, node)->bounds, bvh->element,
+		bvh->axisCount);
+	return surfaceAreaCost(&bounds, bvh->axisCount);
+}
+
+static int compareNodeIndex(const void* left, const void* right, void* context)
+{
+	DS_UNUSED(context);
+	uint32_t leftNode = *(const uint32_t*)left;
+	uint32_t rightNode = *(const uint32_t*)right;
+	return (leftNode > rightNode) - (leftNode < rightNode);
+}
+
+inline static uint32_t* findObjectNode(const dsBVH* bvh, const void* object)
+{
+	return (uint32_t*)dsFlatHashMap_find(&bvh->objectNodes, object);
+}
+
+// Whether an object is in the BVH, including pending insertions but not pending removals.
+static bool hasObjectNode(const dsBVH* bvh, const uint32_t* objectNode)
+{
+	return objectNode &&
+		(*objectNode == INVALID_NODE || !bvh->dynamicNodes[*objectNode].removed);
+}
+
+// Updates the bounds of an internal node from its children along with the dynamic data.
+static void refitNode(dsBVH* bvh, uint32_t node, AddBoxFunction addBoxFunc)
+{
+	dsBVHNode* bvhNode = getNode(bvh->nodes, bvh->nodeSize, node);
+	DynamicNode* dynamicNode = bvh->dynamicNodes + node;
+	if (isLeaf(bvhNode))
+	{
+		dynamicNode->height = 0;
+		dynamicNode->cost = 0.0f;
+		return;
+	}
+
+	uint32_t rightNode = bvhNode->rightNode;
+	memcpy(bvhNode->bounds, getNode(bvh->nodes, bvh->nodeSize, node + 1)->bounds,
+		bvh->boundsSize);
+	addBoxFunc(bvhNode->bounds, getNode(bvh->nodes, bvh->nodeSize, rightNode)->bounds);
+
+	const DynamicNode* leftDynamic = bvh->dynamicNodes + node + 1;
+	const DynamicNode* rightDynamic = bvh->dynamicNodes + rightNode;
+	dynamicNode->height = dsMax(leftDynamic->height, rightDynamic->height) + 1;
+	dynamicNode->cost = (float)nodeSurfaceAreaCost(bvh, node) + leftDynamic->cost +
+		rightDynamic->cost;
+}
+
+static void refitAncestors(dsBVH* bvh, uint32_t node, AddBoxFunction addBoxFunc)
+{
+	for (; node != INVALID_NODE; node = bvh->dynamicNodes[node].parentNode)
+		refitNode(bvh, node, addBoxFunc);
+	bvh->maxDepth = bvh->dynamicNodes[0].height;
+}
+
+static void resetBuildCost(dsBVH* bvh, uint32_t node)
+{
+	DynamicNode* dynamicNode = bvh->dynamicNodes + node;
+	float surfaceArea = (float)nodeSurfaceAreaCost(bvh, node);
+	// Subtrees built without any area will be re-built once they have some area.
+	dynamicNode->buildCostRatio = surfaceArea > 0.0f ? dynamicNode->cost/surfaceArea : 1.0f;
+}
+
+// Initializes the dynamic data for a subtree. The parent of the subtree must already be set.
+static void initDynamicNodes(dsBVH* bvh, uint32_t node, AddBoxFunction addBoxFunc)
+{
+	uint32_t end = getNode(bvh->nodes, bvh->nodeSize, node)->skipNode;
+	for (uint32_t i = node; i < end; ++i)
+	{
+		const dsBVHNode* bvhNode = getNode(bvh->nodes, bvh->nodeSize, i);
+		DynamicNode* dynamicNode = bvh->dynamicNodes + i;
+		dynamicNode->dirty = false;
+		dynamicNode->removed = false;
+		dynamicNode->needsRebuild = false;
+		if (!isLeaf(bvhNode))
+		{
+			bvh->dynamicNodes[i + 1].parentNode = i;
+			bvh->dynamicNodes[bvhNode->rightNode].parentNode = i;
+		}
+	}
+
+	for (uint32_t i = end; i-- > node;)
+	{
+		refitNode(bvh, i, addBoxFunc);
+		resetBuildCost(bvh, i);
+	}
+}
+
+static bool prepareDynamicData(dsBVH* bvh, AddBoxFunction addBoxFunc)
+{
+	if (bvh->dynamicValid)
+		return true;
+
+	bvh->dynamicNodeCount = 0;
+	bvh->dirtyNodeCount = 0;
+	bvh->pendingInsertCount = 0;
+	bvh->pendingRemoveCount = 0;
+	dsFlatHashMap_clear(&bvh->objectNodes);
+	if (bvh->nodeCount > 0)
+	{
+		uint32_t leafCount = (bvh->nodeCount + 1)/2;
+		if (!DS_RESIZEABLE_ARRAY_ADD(bvh->allocator, bvh->dynamicNodes, bvh->dynamicNodeCount,
+				bvh->maxDynamicNodes, bvh->nodeCount) ||
+			!dsFlatHashMap_reserve(&bvh->objectNodes, leafCount))
+		{
+			bvh->dynamicNodeCount = 0;
+			return false;
+		}
+
+		for (uint32_t i = 0; i < bvh->nodeCount; ++i)
+		{
+			const dsBVHNode* node = getNode(bvh->nodes, bvh->nodeSize, i);
+			if (isLeaf(node) && !dsFlatHashMap_insert(&bvh->objectNodes, node->object, &i))
+			{
+				DS_LOG_ERROR(DS_GEOMETRY_LOG_TAG,
+					"Objects must be unique to dynamically update a BVH.");
+				dsFlatHashMap_clear(&bvh->objectNodes);
+				bvh->dynamicNodeCount = 0;
+				return false;
+			}
+		}
+
+		bvh->dynamicNodes[0].parentNode = INVALID_NODE;
+		initDynamicNodes(bvh, 0, addBoxFunc);
+		bvh->maxDepth = bvh->dynamicNodes[0].height;
+	}
+
+	bvh->dynamicValid = true;
+	return true;
+}
+
+// Reserves space for a total number of elements without changing the element count.
+static bool reserveArray(dsAllocator* allocator, void** buffer, uint32_t elementCount,
+	uint32_t* maxElements, size_t elementSize, uint32_t reserveCount)
+{
+	if (reserveCount <= *maxElements)
+		return true;
+
+	return dsResizeableArray_add(allocator, buffer, &elementCount, maxElements, elementSize,
+		reserveCount - elementCount);
+}
+
+static bool reserveDirtyNodes(dsBVH* bvh, uint32_t count)
+{
+	return reserveArray(bvh->allocator, (void**)&bvh->dirtyNodes, bvh->dirtyNodeCount,
+		&bvh->maxDirtyNodes, sizeof(uint32_t), count);
+}
+
+static bool markNodeDirty(dsBVH* bvh, uint32_t node)
+{
+	DynamicNode* dynamicNode = bvh->dynamicNodes + node;
+	if (dynamicNode->dirty)
+		return true;
+
+	if (!reserveDirtyNodes(bvh, bvh->dirtyNodeCount + 1))
+		return false;
+
+	bvh->dirtyNodes[bvh->dirtyNodeCount++] = node;
+	dynamicNode->dirty = true;
+	return true;
+}
+
+// Re-builds a subtree in place using the surface area heuristic. A subtree always has the same
+// number of nodes for the same number of leaves, so the rest of the tree is unaffected.
+static bool rebuildSubtree(dsBVH* bvh, uint32_t node, AddBoxFunction addBoxFunc)
+{
+	uint32_t end = getNode(bvh->nodes, bvh->nodeSize, node)->skipNode;
+	uint32_t leafCount = (end - node + 1)/2;
+	size_t bufferSize = DS_ALIGNED_SIZE(sizeof(dsAlignedBox3d)*leafCount) +
+		DS_ALIGNED_SIZE(sizeof(uint32_t)*leafCount);
+	if (!reserveTempNodes(bvh, leafCount) || !reserveBuildBuffer(bvh, bufferSize))
+		return false;
+
+	dsBufferAllocator bufferAlloc;
+	DS_VERIFY(dsBufferAllocator_initialize(&bufferAlloc, bvh->buildBuffer, bufferSize));
+	dsAlignedBox3d* objectBounds = DS_ALLOCATE_OBJECT_ARRAY(&bufferAlloc, dsAlignedBox3d,
+		leafCount);
+	uint32_t* objectIndices = DS_ALLOCATE_OBJECT_ARRAY(&bufferAlloc, uint32_t, leafCount);
+	DS_ASSERT(objectBounds && objectIndices);
+
+	uint32_t leafIndex = 0;
+	for (uint32_t i = node; i < end; ++i)
+	{
+		const dsBVHNode* bvhNode = getNode(bvh->nodes, bvh->nodeSize, i);
+		if (!isLeaf(bvhNode))
+			continue;
+
+		memcpy(getNode(bvh->tempNodes, bvh->nodeSize, leafIndex), bvhNode, bvh->nodeSize);
+		boundsToDouble(objectBounds + leafIndex, bvhNode->bounds, bvh->element, bvh->axisCount);
+		objectIndices[leafIndex] = leafIndex;
+		++leafIndex;
+	}
+	DS_ASSERT(leafIndex == leafCount);
+
+	uint32_t depth = 0;
+	for (uint32_t i = bvh->dynamicNodes[node].parentNode; i != INVALID_NODE;
+		i = bvh->dynamicNodes[i].parentNode)
+	{
+		++depth;
+	}
+
+	SAHBuildContext context = {bvh, addBoxFunc, objectBounds, objectIndices};
+	buildSAHRec(&context, 0, leafCount, node, depth);
+	DS_ASSERT(getNode(bvh->nodes, bvh->nodeSize, node)->skipNode == end);
+
+	for (uint32_t i = node; i < end; ++i)
+	{
+		const dsBVHNode* bvhNode = getNode(bvh->nodes, bvh->nodeSize, i);
+		if (!isLeaf(bvhNode))
+			continue;
+
+		uint32_t* objectNode = findObjectNode(bvh, bvhNode->object);
+		DS_ASSERT(objectNode);
+		*objectNode = i;
+	}
+
+	initDynamicNodes(bvh, node, addBoxFunc);
+	refitAncestors(bvh, node, addBoxFunc);
+	return true;
+}
+
+static double insertCost(const dsBVH* bvh, uint32_t node, const dsAlignedBox3d* leafBounds)
+{
+	const dsBVHNode* bvhNode = getNode(bvh->nodes, bvh->nodeSize, node);
+	dsAlignedBox3d bounds;
+	boundsToDouble(&bounds, bvhNode->bounds, bvh->element, bvh->axisCount);
+	double area = surfaceAreaCost(&bounds, bvh->axisCount);
+	dsAlignedBox3d_addBox(&bounds, leafBounds);
+	double combinedArea = surfaceAreaCost(&bounds, bvh->axisCount);
+	// Internal nodes only grow when inserting further down.
+	return isLeaf(bvhNode) ? combinedArea : combinedArea - area;
+}
+
+// Finds the node to pair with a new leaf, descending the tree while it's cheaper than adding the
+// leaf next to the current node.
+static uint32_t findInsertSibling(const dsBVH* bvh, const dsAlignedBox3d* leafBounds)
+{
+	uint32_t node = 0;
+	double inheritedCost = 0.0;
+	while (true)
+	{
+		const dsBVHNode* bvhNode = getNode(bvh->nodes, bvh->nodeSize, node);
+		if (isLeaf(bvhNode))
+			return node;
+
+		dsAlignedBox3d bounds;
+		boundsToDouble(&bounds, bvhNode->bounds, bvh->element, bvh->axisCount);
+		double area = surfaceAreaCost(&bounds, bvh->axisCount);
+		dsAlignedBox3d_addBox(&bounds, leafBounds);
+		double combinedArea = surfaceAreaCost(&bounds, bvh->axisCount);
+
+		double cost = combinedArea + inheritedCost;
+		inheritedCost += combinedArea - area;
+		double leftCost = insertCost(bvh, node + 1, leafBounds) + inheritedCost;
+		double rightCost = insertCost(bvh, bvhNode->rightNode, leafBounds) + inheritedCost;
+		if (cost < leftCost && cost < rightCost)
+			return node;
+
+		node = leftCost <= rightCost ? node + 1 : bvhNode->rightNode;
+	}
+}
+
+// Removes the leaves marked as removed, replacing their parents with their siblings. This only
+// removes nodes while keeping the depth-first order, so the nodes are compacted in place with a
+// single pass.
+static bool applyRemovals(dsBVH* bvh)
+{
+	uint32_t nodeCount = bvh->nodeCount;
+	if (!reserveBuildBuffer(bvh, sizeof(uint32_t)*nodeCount) ||
+		!reserveDirtyNodes(bvh, nodeCount))
+	{
+		return false;
+	}
+
+	// Children are always after their parents, so count the remaining leaves in reverse order.
+	uint32_t* leafCounts = (uint32_t*)bvh->buildBuffer;
+	for (uint32_t i = nodeCount; i-- > 0;)
+	{
+		const dsBVHNode* bvhNode = getNode(bvh->nodes, bvh->nodeSize, i);
+		if (!isLeaf(bvhNode))
+		{
+			leafCounts[i] = leafCounts[i + 1] + leafCounts[bvhNode->rightNode];
+			continue;
+		}
+
+		if (bvh->dynamicNodes[i].removed)
+		{
+			DS_VERIFY(dsFlatHashMap_remove(&bvh->objectNodes, bvhNode->object));
+			leafCounts[i] = 0;
+		}
+		else
+			leafCounts[i] = 1;
+	}
+
+	// The new index is never after the original index, and the counts are only read at or after
+	// the original index, so everything can be moved in place.
+	uint32_t newCount = 0;
+	bvh->dirtyNodeCount = 0;
+	for (uint32_t i = 0; i < nodeCount;)
+	{
+		const dsBVHNode* bvhNode = getNode(bvh->nodes, bvh->nodeSize, i);
+		uint32_t leafCount = leafCounts[i];
+		if (leafCount == 0)
+		{
+			i = bvhNode->skipNode;
+			continue;
+		}
+
+		// Remove parents that only have one remaining child.
+		if (!isLeaf(bvhNode) && (leafCounts[i + 1] == 0 || leafCounts[bvhNode->rightNode] == 0))
+		{
+			++i;
+			continue;
+		}
+
+		if (newCount != i)
+		{
+			memcpy(getNode(bvh->nodes, bvh->nodeSize, newCount), bvhNode, bvh->nodeSize);
+			bvh->dynamicNodes[newCount] = bvh->dynamicNodes[i];
+		}
+
+		// Subtrees that lost leaves need to be re-fit.
+		DynamicNode* dynamicNode = bvh->dynamicNodes + newCount;
+		dynamicNode->dirty |= leafCount != (bvhNode->skipNode - i + 1)/2;
+		if (dynamicNode->dirty)
+			bvh->dirtyNodes[bvh->dirtyNodeCount++] = newCount;
+
+		leafCounts[newCount++] = leafCount;
+		++i;
+	}
+
+	bvh->nodeCount = newCount;
+	bvh->dynamicNodeCount = newCount;
+	bvh->pendingRemoveCount = 0;
+	if (newCount == 0)
+		return true;
+
+	// A subtree with n leaves always has 2*n - 1 nodes, which is enough to re-create the links.
+	bvh->dynamicNodes[0].parentNode = INVALID_NODE;
+	for (uint32_t i = 0; i < newCount; ++i)
+	{
+		dsBVHNode* bvhNode = getNode(bvh->nodes, bvh->nodeSize, i);
+		bvhNode->skipNode = i + leafCounts[i]*2 - 1;
+		if (leafCounts[i] == 1)
+		{
+			DS_ASSERT(isLeaf(bvhNode));
+			uint32_t* objectNode = findObjectNode(bvh, bvhNode->object);
+			DS_ASSERT(objectNode);
+			*objectNode = i;
+			continue;
+		}
+
+		uint32_t rightNode = i + leafCounts[i + 1]*2;
+		bvhNode->rightNode = rightNode;
+		bvh->dynamicNodes[i + 1].parentNode = i;
+		bvh->dynamicNodes[rightNode].parentNode = i;
+	}
+
+	return true;
+}
+
+// Copies a subtree to the new nodes, adding a parent for each new leaf paired with it. The
+// new parents come first, followed by the original subtree and the new leaves.
+static void insertLeavesRec(InsertContext* context, uint32_t node)
+{
+	dsBVH* bvh = context->bvh;
+	uint8_t nodeSize = bvh->nodeSize;
+
+	// Nodes are visited in order, so the entries sorted by sibling are consumed in order.
+	uint32_t firstEntry = context->nextEntry;
+	while (context->nextEntry < context->entryCount &&
+		context->entries[context->nextEntry].sibling == node)
+	{
+		++context->nextEntry;
+	}
+	uint32_t entryCount = context->nextEntry - firstEntry;
+
+	uint32_t firstParent = context->nextNode;
+	context->nextNode += entryCount;
+	uint32_t newNode = context->nextNode++;
+	context->nodeMap[node] = newNode;
+
+	const dsBVHNode* bvhNode = getNode(bvh->nodes, nodeSize, node);
+	dsBVHNode* newBVHNode = getNode(context->newNodes, nodeSize, newNode);
+	memcpy(newBVHNode, bvhNode, nodeSize);
+	context->newDynamicNodes[newNode] = bvh->dynamicNodes[node];
+	if (!isLeaf(bvhNode))
+	{
+		uint32_t leftNode = context->nextNode;
+		insertLeavesRec(context, node + 1);
+		uint32_t rightNode = context->nextNode;
+		insertLeavesRec(context, bvhNode->rightNode);
+
+		newBVHNode->rightNode = rightNode;
+		context->newDynamicNodes[leftNode].parentNode = newNode;
+		context->newDynamicNodes[rightNode].parentNode = newNode;
+	}
+	else if (newNode != node)
+		*findObjectNode(bvh, bvhNode->object) = newNode;
+	newBVHNode->skipNode = context->nextNode;
+
+	// The first parent is the outermost, so pair the leaves from the inside out.
+	uint32_t child = newNode;
+	for (uint32_t i = 0; i < entryCount; ++i)
+	{
+		InsertEntry* entry = context->entries + firstEntry + i;
+		uint32_t parent = firstParent + entryCount - 1 - i;
+		uint32_t leaf = context->nextNode++;
+
+		dsBVHNode* leafNode = getNode(context->newNodes, nodeSize, leaf);
+		memcpy(leafNode, getNode((dsBVHNode*)context->leafNodes, nodeSize, entry->leaf),
+			nodeSize);
+		leafNode->skipNode = leaf + 1;
+		leafNode->rightNode = INVALID_NODE;
+		*findObjectNode(bvh, leafNode->object) = leaf;
+		entry->leaf = leaf;
+
+		DynamicNode* leafDynamic = context->newDynamicNodes + leaf;
+		memset(leafDynamic, 0, sizeof(DynamicNode));
+		leafDynamic->parentNode = parent;
+		leafDynamic->buildCostRatio = 1.0f;
+
+		// The bounds and costs are set once all nodes are in place.
+		dsBVHNode* parentNode = getNode(context->newNodes, nodeSize, parent);
+		parentNode->skipNode = leaf + 1;
+		parentNode->rightNode = leaf;
+		parentNode->object = NULL;
+
+		DynamicNode* parentDynamic = context->newDynamicNodes + parent;
+		memset(parentDynamic, 0, sizeof(DynamicNode));
+		context->newDynamicNodes[child].parentNode = parent;
+		child = parent;
+	}
+}
+
+// Inserts all pending objects with a single pass over the tree. Each object is paired with the
+// node that least increases the surface area, and any node paired with multiple objects is
+// re-built.
+static bool applyInsertions(dsBVH* bvh, AddBoxFunction addBoxFunc)
+{
+	uint32_t maxInsertCount = bvh->pendingInsertCount;
+	uint32_t prevNodeCount = bvh->nodeCount;
+	uint32_t maxNodeCount = prevNodeCount + maxInsertCount*2;
+	size_t bufferSize = DS_ALIGNED_SIZE(sizeof(DynamicNode)*maxNodeCount) +
+		DS_ALIGNED_SIZE(sizeof(uint32_t)*(prevNodeCount + 1)) +
+		DS_ALIGNED_SIZE(sizeof(InsertEntry)*maxInsertCount);
+	if (!reserveArray(bvh->allocator, (void**)&bvh->nodes, bvh->nodeCount, &bvh->maxNodes,
+			bvh->nodeSize, maxNodeCount) ||
+		!reserveArray(bvh->allocator, (void**)&bvh->dynamicNodes, bvh->dynamicNodeCount,
+			&bvh->maxDynamicNodes, sizeof(DynamicNode), maxNodeCount) ||
+		!reserveDirtyNodes(bvh, bvh->dirtyNodeCount + maxInsertCount) ||
+		!reserveTempNodes(bvh, maxNodeCount + maxInsertCount) ||
+		!reserveBuildBuffer(bvh, bufferSize))
+	{
+		return false;
+	}
+
+	dsBufferAllocator bufferAlloc;
+	DS_VERIFY(dsBufferAllocator_initialize(&bufferAlloc, bvh->buildBuffer, bufferSize));
+	DynamicNode* newDynamicNodes = DS_ALLOCATE_OBJECT_ARRAY(&bufferAlloc, DynamicNode,
+		maxNodeCount);
+	// Extra space for the root when inserting into an empty tree.
+	uint32_t* nodeMap = DS_ALLOCATE_OBJECT_ARRAY(&bufferAlloc, uint32_t, prevNodeCount + 1);
+	InsertEntry* entries = DS_ALLOCATE_OBJECT_ARRAY(&bufferAlloc, InsertEntry, maxInsertCount);
+	DS_ASSERT(newDynamicNodes && nodeMap && entries);
+
+	// Skip objects that were removed or inserted multiple times before being applied.
+	dsBVHNode* leafNodes = getNode(bvh->tempNodes, bvh->nodeSize, maxNodeCount);
+	uint32_t insertCount = 0;
+	for (uint32_t i = 0; i < maxInsertCount; ++i)
+	{
+		const void* object = bvh->pendingInserts[i];
+		uint32_t* objectNode = findObjectNode(bvh, object);
+		if (!objectNode || *objectNode != INVALID_NODE)
+			continue;
+
+		dsBVHNode* leafNode = getNode(leafNodes, bvh->nodeSize, insertCount);
+		if (!bvh->objectBoundsFunc(leafNode->bounds, bvh, object))
+		{
+			for (uint32_t j = 0; j < insertCount; ++j)
+			{
+				const void* prevObject = getNode(leafNodes, bvh->nodeSize, j)->object;
+				*findObjectNode(bvh, prevObject) = INVALID_NODE;
+			}
+			return false;
+		}
+
+		leafNode->object = object;
+		*objectNode = PENDING_NODE;
+		entries[insertCount].leaf = insertCount;
+		++insertCount;
+	}
+
+	bvh->pendingInsertCount = 0;
+	if (insertCount == 0)
+		return true;
+
+	// The first object becomes the root of an empty tree.
+	uint32_t firstEntry = 0;
+	if (prevNodeCount == 0)
+	{
+		dsBVHNode* rootNode = getNode(bvh->nodes, bvh->nodeSize, 0);
+		memcpy(rootNode, leafNodes, bvh->nodeSize);
+		rootNode->skipNode = 1;
+		rootNode->rightNode = INVALID_NODE;
+		*findObjectNode(bvh, rootNode->object) = 0;
+
+		DynamicNode* rootDynamic = bvh->dynamicNodes;
+		memset(rootDynamic, 0, sizeof(DynamicNode));
+		rootDynamic->parentNode = INVALID_NODE;
+		rootDynamic->buildCostRatio = 1.0f;
+
+		bvh->nodeCount = bvh->dynamicNodeCount = 1;
+		bvh->maxDepth = 0;
+		if (insertCount == 1)
+			return true;
+
+		prevNodeCount = 1;
+		firstEntry = 1;
+	}
+
+	// Large batches are faster to re-build than to pair individually.
+	entries += firstEntry;
+	insertCount -= firstEntry;
+	if (insertCount > (prevNodeCount + 1)/2)
+	{
+		for (uint32_t i = 0; i < insertCount; ++i)
+			entries[i].sibling = 0;
+	}
+	else
+	{
+		for (uint32_t i = 0; i < insertCount; ++i)
+		{
+			dsAlignedBox3d leafBounds;
+			boundsToDouble(&leafBounds, getNode(leafNodes, bvh->nodeSize, entries[i].leaf)->bounds,
+				bvh->element, bvh->axisCount);
+			entries[i].sibling = findInsertSibling(bvh, &leafBounds);
+		}
+		dsSort(entries, insertCount, sizeof(InsertEntry), &compareNodeIndex, NULL);
+	}
+
+	InsertContext context = {bvh, bvh->tempNodes, newDynamicNodes, nodeMap, leafNodes,
+		entries, insertCount, 0, 0};
+	insertLeavesRec(&context, 0);
+	DS_ASSERT(context.nextEntry == insertCount);
+	DS_ASSERT(context.nextNode == prevNodeCount + insertCount*2);
+	newDynamicNodes[0].parentNode = INVALID_NODE;
+
+	bvh->nodeCount = bvh->dynamicNodeCount = context.nextNode;
+	memcpy(bvh->nodes, bvh->tempNodes, bvh->nodeSize*bvh->nodeCount);
+	memcpy(bvh->dynamicNodes, newDynamicNodes, sizeof(DynamicNode)*bvh->nodeCount);
+	for (uint32_t i = 0; i < bvh->dirtyNodeCount; ++i)
+		bvh->dirtyNodes[i] = nodeMap[bvh->dirtyNodes[i]];
+
+	// Fit the new parents from the inside out, starting with the last sibling since siblings
+	// may contain later siblings.
+	for (uint32_t end = insertCount; end > 0;)
+	{
+		uint32_t start = end - 1;
+		while (start > 0 && entries[start - 1].sibling == entries[end - 1].sibling)
+			--start;
+
+		uint32_t parent = INVALID_NODE;
+		for (uint32_t i = start; i < end; ++i)
+		{
+			parent = bvh->dynamicNodes[entries[i].leaf].parentNode;
+			refitNode(bvh, parent, addBoxFunc);
+			resetBuildCost(bvh, parent);
+			DS_VERIFY(markNodeDirty(bvh, parent));
+		}
+
+		bvh->dynamicNodes[parent].needsRebuild = end - start > 1;
+		end = start;
+	}
+
+	return true;
+}
+
+dsBVH* dsBVH_create(dsAllocator* allocator, uint8_t axisCount, dsGeometryElement element,
+	void* userData)
+{
+	if (!allocator || axisCount < 2 || axisCount > 3 || element < dsGeometryElement_Float ||
+		element > dsGeometryElement_Int)
+	{
+		errno = EINVAL;
+		return NULL;
+	}
+
+	if (!allocator->freeFunc)
+	{
+		errno = EINVAL;
+		DS_LOG_ERROR(DS_GEOMETRY_LOG_TAG, "BVH allocator must support freeing memory.");
+		return NULL;
+	}
+
+	dsBVH* bvh = DS_ALLOCATE_OBJECT(allocator, dsBVH);
+	if (!bvh)
+		return NULL;
+
+	memset(bvh, 0, sizeof(dsBVH));
+	bvh->allocator = dsAllocator_keepPointer(allocator);
+	DS_VERIFY(dsFlatHashMap_initialize(&bvh->objectNodes, bvh->allocator, 0, sizeof(uint32_t),
+		&dsHashPointer, &dsHashPointerEqual));
+	bvh->userData = userData;
+	bvh->axisCount = axisCount;
+	bvh->element = element;
+	switch (element)
+	{
+		case dsGeometryElement_Float:
+			bvh->boundsSize = (uint8_t)(sizeof(float)*axisCount*2);
+			break;
+		case dsGeometryElement_Double:
+			bvh->boundsSize = (uint8_t)(sizeof(double)*axisCount*2);
+			break;
+		case dsGeometryElement_Int:
+			bvh->boundsSize = (uint8_t)(sizeof(int)*axisCount*2);
+			break;
+		default:
+			DS_ASSERT(false);
+			break;
+	}
+
+	size_t nodeSize = sizeof(dsBVHNode) + bvh->boundsSize;
+	DS_ASSERT(nodeSize <= UINT8_MAX);
+	bvh->nodeSize = (uint8_t)nodeSize;
+
+	return bvh;
+}
+
+uint8_t dsBVH_getAxisCount(const dsBVH* bvh)
+{
+	if (!bvh)
+		return 0;
+
+	return bvh->axisCount;
+}
+
+dsGeometryElement dsBVH_getElement(const dsBVH* bvh)
+{
+	if (!bvh)
+		return dsGeometryElement_Float;
+
+	return bvh->element;
+}
+
+void* dsBVH_getUserData(const dsBVH* bvh)
+{
+	if (!bvh)
+		return NULL;
+
+	return bvh->userData;
+}
+
+void dsBVH_setUserData(dsBVH* bvh, void* userData)
+{
+	if (bvh)
+		bvh->userData = userData;
+}
+
+bool dsBVH_getUseWideNodes(const dsBVH* bvh)
+{
+	return bvh && bvh->useWideNodes;
+}
+
+bool dsBVH_setUseWideNodes(dsBVH* bvh, bool useWideNodes)
+{
+	if (!bvh)
+	{
+		errno = EINVAL;
+		return false;
+	}
+
+	if (useWideNodes && bvh->element != dsGeometryElement_Float)
+	{
+		errno = EPERM;
+		DS_LOG_ERROR(DS_GEOMETRY_LOG_TAG, "Wide BVH nodes are only supported for float bounds.");
+		return false;
+	}
+
+	if (bvh->useWideNodes == useWideNodes)
+		return true;
+
+	bvh->useWideNodes = useWideNodes;
+	if (!buildWideNodes(bvh))
+	{
+		bvh->useWideNodes = false;
+		return false;
+	}
+
+	return true;
+}
+
+bool dsBVH_build(dsBVH* bvh, const void* objects, uint32_t objectCount, size_t objectSize,
+	dsBVHObjectBoundsFunction objectBoundsFunc, bool balance)
+{
+	dsBVH_clear(bvh);
+	if (!bvh || (!objects && objectCount > 0 && objectSize != DS_GEOMETRY_OBJECT_INDICES) ||
+		!objectBoundsFunc)
+	{
+		errno = EINVAL;
+		return false;
+	}
+
+	bvh->objectBoundsFunc = objectBoundsFunc;
+	if (objectCount == 0)
+		return true;
+
+	AddBoxFunction addBoxFunc;
+	MaxAxisFunction maxAxisFunc;
+	dsSortCompareFunction compareFunc;
+	switch (bvh->element)
+	{
+		case dsGeometryElement_Float:
+			if (bvh->axisCount == 2)
+			{
+				addBoxFunc = (AddBoxFunction)&dsAlignedBox2f_addBox;
+				maxAxisFunc = &dsSpatialStructure_maxAxis2f;
+			}
+			else
+			{
+				DS_ASSERT(bvh->axisCount == 3);
+				addBoxFunc = (AddBoxFunction)&dsAlignedBox3f_addBox;
+				maxAxisFunc = &dsSpatialStructure_maxAxis3f;
+			}
+			compareFunc = &compareBoundsf;
+			break;
+		case dsGeometryElement_Double:
+			if (bvh->axisCount == 2)
+			{
+				addBoxFunc = (AddBoxFunction)&dsAlignedBox2d_addBox;
+				maxAxisFunc = &dsSpatialStructure_maxAxis2d;
+			}
+			else
+			{
+				DS_ASSERT(bvh->axisCount == 3);
+				addBoxFunc = (AddBoxFunction)&dsAlignedBox3d_addBox;
+				maxAxisFunc = &dsSpatialStructure_maxAxis3d;
+			}
+			compareFunc = &compareBoundsd;
+			break;
+		case dsGeometryElement_Int:
+			if (bvh->axisCount == 2)
+			{
+				addBoxFunc = (AddBoxFunction)&dsAlignedBox2i_addBox;
+				maxAxisFunc = &dsSpatialStructure_maxAxis2i;
+			}
+			else
+			{
+				DS_ASSERT(bvh->axisCount == 3);
+				addBoxFunc = (AddBoxFunction)&dsAlignedBox3i_addBox;
+				maxAxisFunc = &dsSpatialStructure_maxAxis3i;
+			}
+			compareFunc = &compareBoundsi;
+			break;
+		default:
+			DS_ASSERT(false);
+			return false;
+	}
+
+	// Reserve space for BVH. Perfect binary tree, so n = 2*l + 1
+	// (where n is number of nodes, l is number of leaves)
+	uint32_t nodeCount = objectCount*2 - 1;
+	if (!dsResizeableArray_add(bvh->allocator, (void**)&bvh->nodes, &bvh->nodeCount,
+		&bvh->maxNodes, bvh->nodeSize, nodeCount))
+	{
+		return false;
+	}
+	bvh->nodeCount = 0;
+
+	uint32_t rootNode;
+	if (balance)
+	{
+		if (!reserveTempNodes(bvh, objectCount) ||
+			!fillTempNodes(bvh, objects, objectCount, objectSize))
+		{
+			dsBVH_clear(bvh);
+			return false;
+		}
+
+		rootNode = buildBVHBalancedRec(bvh, 0, objectCount, 0, addBoxFunc, maxAxisFunc,
+			compareFunc);
+	}
+	else
+		rootNode = buildBVHRec(bvh, objects, 0, objectCount, 0, objectSize, addBoxFunc);
+
+	if (rootNode == INVALID_NODE)
+	{
+		dsBVH_clear(bvh);
+		return false;
+	}
+
+	DS_ASSERT(rootNode == 0);
+	DS_ASSERT(bvh->nodeCount == nodeCount);
+	if (!buildWideNodes(bvh))
+	{
+		dsBVH_clear(bvh);
+		return false;
+	}
+
+	return true;
+}
+
+bool dsBVH_buildSAH(dsBVH* bvh, const void* objects, uint32_t objectCount, size_t objectSize,
+	dsBVHObjectBoundsFunction objectBoundsFunc, dsThreadPool* threadPool)
+{
+	dsBVH_clear(bvh);
+	if (!bvh || (!objects && objectCount > 0 && objectSize != DS_GEOMETRY_OBJECT_INDICES) ||
+		!objectBoundsFunc)
+	{
+		errno = EINVAL;
+		return false;
+	}
+
+	bvh->objectBoundsFunc = objectBoundsFunc;
+	if (objectCount == 0)
+		return true;
+
+	AddBoxFunction addBoxFunc = getAddBoxFunction(bvh);
+	if (!addBoxFunc)
+		return false;
+
+	// Reserve space for BVH. Perfect binary tree, so n = 2*l + 1
+	// (where n is number of nodes, l is number of leaves)
+	uint32_t nodeCount = objectCount*2 - 1;
+	if (!dsResizeableArray_add(bvh->allocator, (void**)&bvh->nodes, &bvh->nodeCount,
+		&bvh->maxNodes, bvh->nodeSize, nodeCount))
+	{
+		return false;
+	}
+
+	if (!reserveTempNodes(bvh, objectCount) ||
+		!fillTempNodes(bvh, objects, objectCount, objectSize))
 	{
 		dsBVH_clear(bvh);
 		return false;
 	}
 
-	DS_ASSERT(rootNode == 0);
+	// Build using double-precision bounds with indices to the objects to avoid moving the full
+	// nodes around while partitioning. The buffer is kept to re-use for future builds.
+	bool parallel = threadPool && objectCount > SAH_MIN_TASK_OBJECTS;
+	uint32_t taskObjects = 0, maxSplitNodes = 0;
+	size_t bufferSize = DS_ALIGNED_SIZE(sizeof(dsAlignedBox3d)*objectCount) +
+		DS_ALIGNED_SIZE(sizeof(uint32_t)*objectCount);
+	if (parallel)
+	{
+		taskObjects = getSAHTaskObjects(objectCount, threadPool);
+		maxSplitNodes = getMaxSAHSplitNodes(objectCount, taskObjects);
+		bufferSize += DS_ALIGNED_SIZE(sizeof(SAHSplitNode)*maxSplitNodes) +
+			DS_ALIGNED_SIZE(sizeof(SAHBuildTask)*(maxSplitNodes + 1));
+	}
+
+	if (!reserveBuildBuffer(bvh, bufferSize))
+	{
+		dsBVH_clear(bvh);
+		return false;
+	}
+
+	dsBufferAllocator bufferAlloc;
+	DS_VERIFY(dsBufferAllocator_initialize(&bufferAlloc, bvh->buildBuffer, bufferSize));
+	dsAlignedBox3d* objectBounds = DS_ALLOCATE_OBJECT_ARRAY(&bufferAlloc, dsAlignedBox3d,
+		objectCount);
+	uint32_t* objectIndices = DS_ALLOCATE_OBJECT_ARRAY(&bufferAlloc, uint32_t, objectCount);
+	DS_ASSERT(objectBounds && objectIndices);
+	for (uint32_t i = 0; i < objectCount; ++i)
+	{
+		boundsToDouble(objectBounds + i, getNode(bvh->tempNodes, bvh->nodeSize, i)->bounds,
+			bvh->element, bvh->axisCount);
+		objectIndices[i] = i;
+	}
+
+	SAHBuildContext context = {bvh, addBoxFunc, objectBounds, objectIndices};
+	if (parallel)
+	{
+		SAHSplitNode* splitNodes = DS_ALLOCATE_OBJECT_ARRAY(&bufferAlloc, SAHSplitNode,
+			maxSplitNodes);
+		SAHBuildTask* tasks = DS_ALLOCATE_OBJECT_ARRAY(&bufferAlloc, SAHBuildTask,
+			maxSplitNodes + 1);
+		DS_ASSERT(splitNodes && tasks);
+		buildSAHParallel(&context, objectCount, threadPool, taskObjects, splitNodes, maxSplitNodes,
+			tasks);
+	}
+	else
+		bvh->maxDepth = buildSAHRec(&context, 0, objectCount, 0, 0);
+
 	DS_ASSERT(bvh->nodeCount == nodeCount);
+	if (!buildWideNodes(bvh))
+	{
+		dsBVH_clear(bvh);
+		return false;
+	}
+
 	return true;
 }
 
@@ -474,42 +2173,249 @@ bool dsBVH_update(dsBVH* bvh)
 	if (bvh->nodeCount == 0)
 		return true;
 
-	AddBoxFunction addBoxFunc;
-	switch (bvh->element)
+	AddBoxFunction addBoxFunc = getAddBoxFunction(bvh);
+	if (!addBoxFunc)
+		return false;
+
+	if (!updateBVHNodes(bvh, addBoxFunc))
+		return false;
+
+	if (bvh->dynamicValid)
 	{
-		case dsGeometryElement_Float:
-			if (bvh->axisCount == 2)
-				addBoxFunc = (AddBoxFunction)&dsAlignedBox2f_addBox;
-			else
-			{
-				DS_ASSERT(bvh->axisCount == 3);
-				addBoxFunc = (AddBoxFunction)&dsAlignedBox3f_addBox;
-			}
-			break;
-		case dsGeometryElement_Double:
-			if (bvh->axisCount == 2)
-				addBoxFunc = (AddBoxFunction)&dsAlignedBox2d_addBox;
-			else
-			{
-				DS_ASSERT(bvh->axisCount == 3);
-				addBoxFunc = (AddBoxFunction)&dsAlignedBox3d_addBox;
-			}
-			break;
-		case dsGeometryElement_Int:
-			if (bvh->axisCount == 2)
-				addBoxFunc = (AddBoxFunction)&dsAlignedBox2i_addBox;
-			else
+		// Keep the costs from the last build to detect when the tree has degraded.
+		for (uint32_t i = bvh->nodeCount; i-- > 0;)
+		{
+			refitNode(bvh, i, addBoxFunc);
+			bvh->dynamicNodes[i].dirty = false;
+		}
+		bvh->dirtyNodeCount = 0;
+	}
+
+	updateWideNodes(bvh);
+	return true;
+}
+
+bool dsBVH_insert(dsBVH* bvh, const void* object)
+{
+	if (!bvh)
+	{
+		errno = EINVAL;
+		return false;
+	}
+
+	if (!bvh->objectBoundsFunc)
+	{
+		errno = EPERM;
+		DS_LOG_ERROR(DS_GEOMETRY_LOG_TAG, "BVH must be built before inserting objects.");
+		return false;
+	}
+
+	AddBoxFunction addBoxFunc = getAddBoxFunction(bvh);
+	if (!addBoxFunc || !prepareDynamicData(bvh, addBoxFunc))
+		return false;
+
+	uint32_t* objectNode = findObjectNode(bvh, object);
+	if (hasObjectNode(bvh, objectNode))
+	{
+		errno = EPERM;
+		DS_LOG_ERROR(DS_GEOMETRY_LOG_TAG, "Object is already in the BVH.");
+		return false;
+	}
+
+	// Objects waiting to be removed keep their leaf, only needing to update the bounds.
+	if (objectNode)
+	{
+		if (!markNodeDirty(bvh, *objectNode))
+			return false;
+
+		bvh->dynamicNodes[*objectNode].removed = false;
+		--bvh->pendingRemoveCount;
+		return true;
+	}
+
+	if (!reserveArray(bvh->allocator, (void**)&bvh->pendingInserts, bvh->pendingInsertCount,
+			&bvh->maxPendingInserts, sizeof(const void*), bvh->pendingInsertCount + 1))
+	{
+		return false;
+	}
+
+	uint32_t node = INVALID_NODE;
+	if (!dsFlatHashMap_insert(&bvh->objectNodes, object, &node))
+		return false;
+
+	bvh->pendingInserts[bvh->pendingInsertCount++] = object;
+	return true;
+}
+
+bool dsBVH_remove(dsBVH* bvh, const void* object)
+{
+	if (!bvh)
+	{
+		errno = EINVAL;
+		return false;
+	}
+
+	AddBoxFunction addBoxFunc = getAddBoxFunction(bvh);
+	if (!addBoxFunc || !prepareDynamicData(bvh, addBoxFunc))
+		return false;
+
+	uint32_t* objectNode = findObjectNode(bvh, object);
+	if (!hasObjectNode(bvh, objectNode))
+	{
+		errno = ENOTFOUND;
+		return false;
+	}
+
+	// Objects that haven't been inserted yet will be skipped when applying the insertions.
+	if (*objectNode == INVALID_NODE)
+	{
+		DS_VERIFY(dsFlatHashMap_remove(&bvh->objectNodes, object));
+		return true;
+	}
+
+	bvh->dynamicNodes[*objectNode].removed = true;
+	++bvh->pendingRemoveCount;
+	return true;
+}
+
+bool dsBVH_markDirty(dsBVH* bvh, const void* object)
+{
+	if (!bvh)
+	{
+		errno = EINVAL;
+		return false;
+	}
+
+	AddBoxFunction addBoxFunc = getAddBoxFunction(bvh);
+	if (!addBoxFunc || !prepareDynamicData(bvh, addBoxFunc))
+		return false;
+
+	const uint32_t* objectNode = findObjectNode(bvh, object);
+	if (!hasObjectNode(bvh, objectNode))
+	{
+		errno = ENOTFOUND;
+		return false;
+	}
+
+	// The bounds for pending insertions will be queried when they're inserted.
+	if (*objectNode == INVALID_NODE)
+		return true;
+
+	return markNodeDirty(bvh, *objectNode);
+}
+
+bool dsBVH_updateDirty(dsBVH* bvh, float rebuildThreshold)
+{
+	if (!bvh)
+	{
+		errno = EINVAL;
+		return false;
+	}
+
+	if (!bvh->dynamicValid || (bvh->dirtyNodeCount == 0 && bvh->pendingRemoveCount == 0 &&
+			bvh->pendingInsertCount == 0))
+	{
+		return true;
+	}
+
+	AddBoxFunction addBoxFunc = getAddBoxFunction(bvh);
+	if (!addBoxFunc)
+		return false;
+
+	// Removals are applied first so the inserted objects aren't paired with removed nodes.
+	bool topologyChanged = bvh->pendingRemoveCount > 0 || bvh->pendingInsertCount > 0;
+	if (bvh->pendingRemoveCount > 0 && !applyRemovals(bvh))
+		return false;
+
+	if (bvh->pendingInsertCount > 0 && !applyInsertions(bvh, addBoxFunc))
+		return false;
+
+	if (bvh->nodeCount == 0)
+	{
+		bvh->maxDepth = 0;
+		bvh->wideNodeCount = 0;
+		return true;
+	}
+
+	uint32_t dirtyLeafCount = bvh->dirtyNodeCount;
+	for (uint32_t i = 0; i < dirtyLeafCount; ++i)
+	{
+		dsBVHNode* bvhNode = getNode(bvh->nodes, bvh->nodeSize, bvh->dirtyNodes[i]);
+		if (isLeaf(bvhNode) && !bvh->objectBoundsFunc(bvhNode->bounds, bvh, bvhNode->object))
+			return false;
+	}
+
+	// Add the ancestors, stopping once reaching a node that's already dirty since its ancestors
+	// will also be added.
+	for (uint32_t i = 0; i < dirtyLeafCount; ++i)
+	{
+		for (uint32_t node = bvh->dynamicNodes[bvh->dirtyNodes[i]].parentNode;
+			node != INVALID_NODE && !bvh->dynamicNodes[node].dirty;
+			node = bvh->dynamicNodes[node].parentNode)
+		{
+			if (!markNodeDirty(bvh, node))
+				return false;
+		}
+	}
+
+	// Children are always after their parents, so refit in reverse order.
+	dsSort(bvh->dirtyNodes, bvh->dirtyNodeCount, sizeof(uint32_t), &compareNodeIndex, NULL);
+	for (uint32_t i = bvh->dirtyNodeCount; i-- > 0;)
+		refitNode(bvh, bvh->dirtyNodes[i], addBoxFunc);
+	bvh->maxDepth = bvh->dynamicNodes[0].height;
+
+	// Check from the top down so the largest degraded subtree is re-built. Nodes paired with
+	// multiple inserted objects are always re-built.
+	bool rebuilt = false;
+	bool result = true;
+	uint32_t rebuiltEnd = 0;
+	for (uint32_t i = 0; i < bvh->dirtyNodeCount; ++i)
+	{
+		uint32_t node = bvh->dirtyNodes[i];
+		const dsBVHNode* bvhNode = getNode(bvh->nodes, bvh->nodeSize, node);
+		if (node < rebuiltEnd || isLeaf(bvhNode))
+			continue;
+
+		const DynamicNode* dynamicNode = bvh->dynamicNodes + node;
+		if (!dynamicNode->needsRebuild)
+		{
+			if (rebuildThreshold <= 0.0f)
+				continue;
+
+			float surfaceArea = (float)nodeSurfaceAreaCost(bvh, node);
+			if (surfaceArea <= 0.0f ||
+				dynamicNode->cost <= surfaceArea*dynamicNode->buildCostRatio*rebuildThreshold)
 			{
-				DS_ASSERT(bvh->axisCount == 3);
-				addBoxFunc = (AddBoxFunction)&dsAlignedBox3i_addBox;
+				continue;
 			}
+		}
+
+		if (!rebuildSubtree(bvh, node, addBoxFunc))
+		{
+			result = false;
 			break;
-		default:
-			DS_ASSERT(false);
-			return false;
+		}
+
+		rebuiltEnd = bvhNode->skipNode;
+		rebuilt = true;
+	}
+
+	// Keep the depth bounded for ordered traversals.
+	if (result && bvh->maxDepth > MAX_DEPTH)
+	{
+		result = rebuildSubtree(bvh, 0, addBoxFunc);
+		rebuilt |= result;
 	}
 
-	return updateBVHRec(bvh, bvh->nodes, addBoxFunc);
+	for (uint32_t i = 0; i < bvh->dirtyNodeCount; ++i)
+		bvh->dynamicNodes[bvh->dirtyNodes[i]].dirty = false;
+	bvh->dirtyNodeCount = 0;
+
+	if (rebuilt || topologyChanged)
+		buildWideNodes(bvh);
+	else
+		updateWideNodes(bvh);
+	return result;
 }
 
 uint32_t dsBVH_intersect(const dsBVH* bvh, const void* bounds, dsBVHVisitFunction visitor,
@@ -553,9 +2459,162 @@ uint32_t dsBVH_intersect(const dsBVH* bvh, const void* bounds, dsBVHVisitFunctio
 			return 0;
 	}
 
-	uint32_t count = 0;
-	intersectBVHRec(bvh, &count, bvh->nodes, bounds, visitor, userData, intersectFunc);
-	return count;
+#if DS_HAS_SIMD
+	if (bvh->wideNodeCount > 0)
+		return intersectWideNodes(bvh, bounds, visitor, userData);
+#endif
+
+	return intersectBVHNodes(bvh, bounds, visitor, userData, intersectFunc);
+}
+
+uint32_t dsBVH_intersectFrustum(const dsBVH* bvh, const void* frustum,
+	dsBVHVisitFunction visitor, void* userData)
+{
+	if (!bvh || bvh->nodeCount == 0 || !frustum || bvh->axisCount != 3)
+		return 0;
+
+	IntersectFrustumFunction intersectFunc;
+	switch (bvh->element)
+	{
+		case dsGeometryElement_Float:
+			intersectFunc = (IntersectFrustumFunction)&dsFrustum3f_intersectAlignedBox;
+			break;
+		case dsGeometryElement_Double:
+			intersectFunc = (IntersectFrustumFunction)&dsFrustum3d_intersectAlignedBox;
+			break;
+		default:
+			return 0;
+	}
+
+	return intersectFrustumBVHNodes(bvh, frustum, visitor, userData, intersectFunc);
+}
+
+bool dsBVH_intersectRay(const void** outObject, double* outT, const dsBVH* bvh, const void* ray,
+	double maxT, bool anyHit, dsBVHRayIntersectFunction intersectFunc, void* userData)
+{
+	if (!bvh || bvh->nodeCount == 0 || !ray)
+		return false;
+
+	RayInfo rayInfo;
+	getRayInfo(&rayInfo, bvh, ray);
+
+	double rootT;
+	if (!intersectRayNode(&rootT, bvh, &rayInfo, 0, maxT))
+		return false;
+
+	// Each level adds at most one entry that remains on the stack.
+	DS_ASSERT(bvh->maxDepth <= MAX_DEPTH);
+	OrderedEntry stack[MAX_DEPTH + 2];
+	uint32_t stackSize = 0;
+	pushOrderedEntry(stack, &stackSize, 0, rootT);
+
+	const void* hitObject = NULL;
+	double hitT = maxT;
+	bool hit = false;
+	while (stackSize > 0)
+	{
+		OrderedEntry entry = stack[--stackSize];
+		if (entry.distance > hitT)
+			continue;
+
+		const dsBVHNode* node = getNode(bvh->nodes, bvh->nodeSize, entry.node);
+		if (isLeaf(node))
+		{
+			double t = entry.distance;
+			if (intersectFunc && !intersectFunc(userData, bvh, node->object, ray, &t))
+				continue;
+
+			if (t < 0.0 || t > hitT || (hit && t == hitT))
+				continue;
+
+			hitObject = node->object;
+			hitT = t;
+			hit = true;
+			if (anyHit)
+				break;
+			continue;
+		}
+
+		double leftT, rightT;
+		bool hitLeft = intersectRayNode(&leftT, bvh, &rayInfo, entry.node + 1, hitT);
+		bool hitRight = intersectRayNode(&rightT, bvh, &rayInfo, node->rightNode, hitT);
+		DS_ASSERT(stackSize + 2 <= DS_ARRAY_SIZE(stack));
+		pushOrderedChildren(stack, &stackSize, entry.node + 1, hitLeft, leftT, node->rightNode,
+			hitRight, rightT);
+	}
+
+	if (!hit)
+		return false;
+
+	if (outObject)
+		*outObject = hitObject;
+	if (outT)
+		*outT = hitT;
+	return true;
+}
+
+bool dsBVH_nearest(const void** outObject, double* outDistance, const dsBVH* bvh,
+	const void* point, double maxDistance, dsBVHNearestFunction distanceFunc, void* userData)
+{
+	if (!bvh || bvh->nodeCount == 0 || !point)
+		return false;
+
+	double pointValues[3];
+	getDoubleValues(pointValues, point, bvh->element, bvh->axisCount);
+
+	double rootDistance2 = nodeDistance2(bvh, pointValues, 0);
+	double nearestDistance = maxDistance;
+	double nearestDistance2 = maxDistance*maxDistance;
+	if (rootDistance2 > nearestDistance2)
+		return false;
+
+	// Each level adds at most one entry that remains on the stack.
+	DS_ASSERT(bvh->maxDepth <= MAX_DEPTH);
+	OrderedEntry stack[MAX_DEPTH + 2];
+	uint32_t stackSize = 0;
+	pushOrderedEntry(stack, &stackSize, 0, rootDistance2);
+
+	const void* nearestObject = NULL;
+	bool found = false;
+	while (stackSize > 0)
+	{
+		OrderedEntry entry = stack[--stackSize];
+		if (entry.distance > nearestDistance2)
+			continue;
+
+		const dsBVHNode* node = getNode(bvh->nodes, bvh->nodeSize, entry.node);
+		if (isLeaf(node))
+		{
+			double distance = sqrt(entry.distance);
+			if (distanceFunc && !distanceFunc(userData, bvh, node->object, point, &distance))
+				continue;
+
+			if (distance > nearestDistance || (found && distance == nearestDistance))
+				continue;
+
+			nearestObject = node->object;
+			nearestDistance = distance;
+			nearestDistance2 = distance*distance;
+			found = true;
+			continue;
+		}
+
+		double leftDistance2 = nodeDistance2(bvh, pointValues, entry.node + 1);
+		double rightDistance2 = nodeDistance2(bvh, pointValues, node->rightNode);
+		DS_ASSERT(stackSize + 2 <= DS_ARRAY_SIZE(stack));
+		pushOrderedChildren(stack, &stackSize, entry.node + 1,
+			leftDistance2 <= nearestDistance2, leftDistance2, node->rightNode,
+			rightDistance2 <= nearestDistance2, rightDistance2);
+	}
+
+	if (!found)
+		return false;
+
+	if (outObject)
+		*outObject = nearestObject;
+	if (outDistance)
+		*outDistance = nearestDistance;
+	return true;
 }
 
 void dsBVH_clear(dsBVH* bvh)
@@ -564,6 +2623,13 @@ void dsBVH_clear(dsBVH* bvh)
 		return;
 
 	bvh->nodeCount = 0;
+	bvh->maxDepth = 0;
+	bvh->wideNodeCount = 0;
+	bvh->dynamicValid = false;
+	bvh->dirtyNodeCount = 0;
+	bvh->pendingInsertCount = 0;
+	bvh->pendingRemoveCount = 0;
+	dsFlatHashMap_clear(&bvh->objectNodes);
 	bvh->objectBoundsFunc = NULL;
 }
 
@@ -583,5 +2649,11 @@ void dsBVH_destroy(dsBVH* bvh)
 
 	DS_VERIFY(dsAllocator_free(bvh->allocator, bvh->nodes));
 	DS_VERIFY(dsAllocator_free(bvh->allocator, bvh->tempNodes));
+	DS_VERIFY(dsAllocator_free(bvh->allocator, bvh->buildBuffer));
+	DS_VERIFY(dsAllocator_free(bvh->allocator, bvh->wideNodes));
+	DS_VERIFY(dsAllocator_free(bvh->allocator, bvh->dynamicNodes));
+	dsFlatHashMap_shutdown(&bvh->objectNodes);
+	DS_VERIFY(dsAllocator_free(bvh->allocator, bvh->pendingInserts));
+	DS_VERIFY(dsAllocator_free(bvh->allocator, bvh->dirtyNodes));
 	DS_VERIFY(dsAllocator_free(bvh->allocator, bvh));
 }
@@ -291,8 +291,8 @@ bool dsBasePolygon_buildEdgeBVH(dsBasePolygon* polygon)
 
 	// Use indices since the edge array may be re-allocated, invalidating the pointers into
 	// the array.
-	if (!dsBVH_build(polygon->edgeBVH, NULL, polygon->edgeCount, DS_GEOMETRY_OBJECT_INDICES,
-		&getEdgeBounds, false))
+	if (!dsBVH_buildSAH(polygon->edgeBVH, NULL, polygon->edgeCount, DS_GEOMETRY_OBJECT_INDICES,
+		&getEdgeBounds, NULL))
 	{
 		return false;
 	}
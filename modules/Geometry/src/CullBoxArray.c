@@ -0,0 +1,603 @@
+/*
+ * Copyright 2020 Aaron Barany
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <DeepSea/Geometry/CullBoxArray.h>
+
+#include <DeepSea/Core/Containers/ResizeableArray.h>
+#include <DeepSea/Core/Memory/Allocator.h>
+#include <DeepSea/Core/Assert.h>
+#include <DeepSea/Core/Bits.h>
+#include <DeepSea/Core/Error.h>
+#include <DeepSea/Core/Log.h>
+#include <DeepSea/Core/Profile.h>
+#include <DeepSea/Core/SIMD.h>
+#include <DeepSea/Geometry/AlignedBox3.h>
+#include <DeepSea/Geometry/OrientedBox3.h>
+#include <DeepSea/Math/Matrix33.h>
+#include <DeepSea/Math/Matrix44.h>
+#include <DeepSea/Math/Vector3.h>
+#include <float.h>
+#include <math.h>
+#include <string.h>
+
+// Boxes are stored in blocks of 8, which is the widest SIMD width used. Each component is stored
+// contiguously for all boxes in the block.
+#define BLOCK_SIZE 8
+#define BLOCKS_PER_MASK (DS_CULL_BOX_MASK_BITS/BLOCK_SIZE)
+#define BLOCK_MASK ((1U << BLOCK_SIZE) - 1)
+
+typedef enum Component
+{
+	Component_CenterX,
+	Component_CenterY,
+	Component_CenterZ,
+	Component_Axis0X,
+	Component_Axis0Y,
+	Component_Axis0Z,
+	Component_Axis1X,
+	Component_Axis1Y,
+	Component_Axis1Z,
+	Component_Axis2X,
+	Component_Axis2Y,
+	Component_Axis2Z,
+	Component_Count
+} Component;
+
+typedef struct BoxBlock
+{
+	float values[Component_Count][BLOCK_SIZE];
+} BoxBlock;
+
+struct dsCullBoxArray
+{
+	dsAllocator* allocator;
+	BoxBlock* blocks;
+	uint32_t boxCount;
+	uint32_t blockCount;
+	uint32_t maxBlocks;
+};
+
+typedef void (*IntersectBlocksFunction)(uint32_t* outVisible, const BoxBlock* blocks,
+	uint32_t blockCount, const dsPlane3f* planes, uint32_t planeCount);
+
+static void setBox(dsCullBoxArray* boxes, uint32_t index, const dsVector3f* center,
+	const dsVector3f* axis0, const dsVector3f* axis1, const dsVector3f* axis2)
+{
+	BoxBlock* block = boxes->blocks + index/BLOCK_SIZE;
+	uint32_t lane = index % BLOCK_SIZE;
+	block->values[Component_CenterX][lane] = center->x;
+	block->values[Component_CenterY][lane] = center->y;
+	block->values[Component_CenterZ][lane] = center->z;
+	block->values[Component_Axis0X][lane] = axis0->x;
+	block->values[Component_Axis0Y][lane] = axis0->y;
+	block->values[Component_Axis0Z][lane] = axis0->z;
+	block->values[Component_Axis1X][lane] = axis1->x;
+	block->values[Component_Axis1Y][lane] = axis1->y;
+	block->values[Component_Axis1Z][lane] = axis1->z;
+	block->values[Component_Axis2X][lane] = axis2->x;
+	block->values[Component_Axis2Y][lane] = axis2->y;
+	block->values[Component_Axis2Z][lane] = axis2->z;
+}
+
+static void setInfinite(dsCullBoxArray* boxes, uint32_t index)
+{
+	// The projected radius will always be large enough to never be outside a plane.
+	dsVector3f center = {{0.0f, 0.0f, 0.0f}};
+	dsVector3f axis0 = {{FLT_MAX, 0.0f, 0.0f}};
+	dsVector3f axis1 = {{0.0f, FLT_MAX, 0.0f}};
+	dsVector3f axis2 = {{0.0f, 0.0f, FLT_MAX}};
+	setBox(boxes, index, &center, &axis0, &axis1, &axis2);
+}
+
+static void setTransformedBox(dsCullBoxArray* boxes, uint32_t index, const dsVector3f* center,
+	const dsMatrix33f* axes, const dsMatrix44f* transform)
+{
+	if (!transform)
+	{
+		setBox(boxes, index, center, axes->columns, axes->columns + 1, axes->columns + 2);
+		return;
+	}
+
+	dsVector4f localCenter = {{center->x, center->y, center->z, 1.0f}};
+	dsVector4f worldCenter;
+	dsMatrix44_transform(worldCenter, *transform, localCenter);
+
+	// Macro will work correctly for treating a 4x4 matrix as a 3x3 matrix.
+	dsMatrix33f worldAxes;
+	dsMatrix33_mul(worldAxes, *transform, *axes);
+	setBox(boxes, index, (const dsVector3f*)&worldCenter, worldAxes.columns,
+		worldAxes.columns + 1, worldAxes.columns + 2);
+}
+
+// Each function computes the signed distance from the center to each plane and the projected
+// radius of the box along the plane normal. A box is outside if the distance is further than the
+// radius on the negative side of any plane.
+static void intersectBlocksScalar(uint32_t* outVisible, const BoxBlock* blocks,
+	uint32_t blockCount, const dsPlane3f* planes, uint32_t planeCount)
+{
+	uint32_t mask = 0;
+	for (uint32_t i = 0; i < blockCount; ++i)
+	{
+		const BoxBlock* block = blocks + i;
+		uint32_t blockMask = 0;
+		for (uint32_t j = 0; j < BLOCK_SIZE; ++j)
+		{
+			bool outside = false;
+			for (uint32_t k = 0; k < planeCount; ++k)
+			{
+				const dsPlane3f* plane = planes + k;
+				float distance = plane->n.x*block->values[Component_CenterX][j] +
+					plane->n.y*block->values[Component_CenterY][j] +
+					plane->n.z*block->values[Component_CenterZ][j] - plane->d;
+				float radius = fabsf(plane->n.x*block->values[Component_Axis0X][j] +
+						plane->n.y*block->values[Component_Axis0Y][j] +
+						plane->n.z*block->values[Component_Axis0Z][j]) +
+					fabsf(plane->n.x*block->values[Component_Axis1X][j] +
+						plane->n.y*block->values[Component_Axis1Y][j] +
+						plane->n.z*block->values[Component_Axis1Z][j]) +
+					fabsf(plane->n.x*block->values[Component_Axis2X][j] +
+						plane->n.y*block->values[Component_Axis2Y][j] +
+						plane->n.z*block->values[Component_Axis2Z][j]);
+				if (distance + radius < 0.0f)
+				{
+					outside = true;
+					break;
+				}
+			}
+
+			if (!outside)
+				blockMask |= 1U << j;
+		}
+
+		mask |= blockMask << ((i % BLOCKS_PER_MASK)*BLOCK_SIZE);
+		if (i % BLOCKS_PER_MASK == BLOCKS_PER_MASK - 1 || i == blockCount - 1)
+		{
+			outVisible[i/BLOCKS_PER_MASK] = mask;
+			mask = 0;
+		}
+	}
+}
+
+#if DS_HAS_SIMD
+
+#if DS_X86_32 || DS_X86_64
+
+DS_SIMD_FUNC_FLOAT4
+static void intersectBlocksSSE(uint32_t* outVisible, const BoxBlock* blocks,
+	uint32_t blockCount, const dsPlane3f* planes, uint32_t planeCount)
+{
+	__m128 signMask = _mm_set1_ps(-0.0f);
+	__m128 zero = _mm_setzero_ps();
+	uint32_t mask = 0;
+	for (uint32_t i = 0; i < blockCount; ++i)
+	{
+		const BoxBlock* block = blocks + i;
+		uint32_t blockMask = 0;
+		for (uint32_t j = 0; j < BLOCK_SIZE; j += 4)
+		{
+			__m128 outside = zero;
+			for (uint32_t k = 0; k < planeCount; ++k)
+			{
+				const dsPlane3f* plane = planes + k;
+				__m128 nx = _mm_set1_ps(plane->n.x);
+				__m128 ny = _mm_set1_ps(plane->n.y);
+				__m128 nz = _mm_set1_ps(plane->n.z);
+
+				__m128 distance = _mm_sub_ps(_mm_add_ps(_mm_add_ps(
+					_mm_mul_ps(nx, _mm_load_ps(block->values[Component_CenterX] + j)),
+					_mm_mul_ps(ny, _mm_load_ps(block->values[Component_CenterY] + j))),
+					_mm_mul_ps(nz, _mm_load_ps(block->values[Component_CenterZ] + j))),
+					_mm_set1_ps(plane->d));
+
+				__m128 radius0 = _mm_add_ps(_mm_add_ps(
+					_mm_mul_ps(nx, _mm_load_ps(block->values[Component_Axis0X] + j)),
+					_mm_mul_ps(ny, _mm_load_ps(block->values[Component_Axis0Y] + j))),
+					_mm_mul_ps(nz, _mm_load_ps(block->values[Component_Axis0Z] + j)));
+				__m128 radius1 = _mm_add_ps(_mm_add_ps(
+					_mm_mul_ps(nx, _mm_load_ps(block->values[Component_Axis1X] + j)),
+					_mm_mul_ps(ny, _mm_load_ps(block->values[Component_Axis1Y] + j))),
+					_mm_mul_ps(nz, _mm_load_ps(block->values[Component_Axis1Z] + j)));
+				__m128 radius2 = _mm_add_ps(_mm_add_ps(
+					_mm_mul_ps(nx, _mm_load_ps(block->values[Component_Axis2X] + j)),
+					_mm_mul_ps(ny, _mm_load_ps(block->values[Component_Axis2Y] + j))),
+					_mm_mul_ps(nz, _mm_load_ps(block->values[Component_Axis2Z] + j)));
+				__m128 radius = _mm_add_ps(_mm_add_ps(_mm_andnot_ps(signMask, radius0),
+					_mm_andnot_ps(signMask, radius1)), _mm_andnot_ps(signMask, radius2));
+
+				outside = _mm_or_ps(outside, _mm_cmplt_ps(_mm_add_ps(distance, radius), zero));
+				if (_mm_movemask_ps(outside) == 0xF)
+					break;
+			}
+
+			blockMask |= (~_mm_movemask_ps(outside) & 0xFU) << j;
+		}
+
+		mask |= blockMask << ((i % BLOCKS_PER_MASK)*BLOCK_SIZE);
+		if (i % BLOCKS_PER_MASK == BLOCKS_PER_MASK - 1 || i == blockCount - 1)
+		{
+			outVisible[i/BLOCKS_PER_MASK] = mask;
+			mask = 0;
+		}
+	}
+}
+
+DS_SIMD_FUNC_FLOAT8
+static void intersectBlocksAVX(uint32_t* outVisible, const BoxBlock* blocks,
+	uint32_t blockCount, const dsPlane3f* planes, uint32_t planeCount)
+{
+	__m256 signMask = _mm256_set1_ps(-0.0f);
+	__m256 zero = _mm256_setzero_ps();
+	uint32_t mask = 0;
+	for (uint32_t i = 0; i < blockCount; ++i)
+	{
+		const BoxBlock* block = blocks + i;
+		__m256 outside = zero;
+		for (uint32_t k = 0; k < planeCount; ++k)
+		{
+			const dsPlane3f* plane = planes + k;
+			__m256 nx = _mm256_set1_ps(plane->n.x);
+			__m256 ny = _mm256_set1_ps(plane->n.y);
+			__m256 nz = _mm256_set1_ps(plane->n.z);
+
+			__m256 distance = _mm256_sub_ps(_mm256_add_ps(_mm256_add_ps(
+				_mm256_mul_ps(nx, _mm256_loadu_ps(block->values[Component_CenterX])),
+				_mm256_mul_ps(ny, _mm256_loadu_ps(block->values[Component_CenterY]))),
+				_mm256_mul_ps(nz, _mm256_loadu_ps(block->values[Component_CenterZ]))),
+				_mm256_set1_ps(plane->d));
+
+			__m256 radius0 = _mm256_add_ps(_mm256_add_ps(
+				_mm256_mul_ps(nx, _mm256_loadu_ps(block->values[Component_Axis0X])),
+				_mm256_mul_ps(ny, _mm256_loadu_ps(block->values[Component_Axis0Y]))),
+				_mm256_mul_ps(nz, _mm256_loadu_ps(block->values[Component_Axis0Z])));
+			__m256 radius1 = _mm256_add_ps(_mm256_add_ps(
+				_mm256_mul_ps(nx, _mm256_loadu_ps(block->values[Component_Axis1X])),
+				_mm256_mul_ps(ny, _mm256_loadu_ps(block->values[Component_Axis1Y]))),
+				_mm256_mul_ps(nz, _mm256_loadu_ps(block->values[Component_Axis1Z])));
+			__m256 radius2 = _mm256_add_ps(_mm256_add_ps(
+				_mm256_mul_ps(nx, _mm256_loadu_ps(block->values[Component_Axis2X])),
+				_mm256_mul_ps(ny, _mm256_loadu_ps(block->values[Component_Axis2Y]))),
+				_mm256_mul_ps(nz, _mm256_loadu_ps(block->values[Component_Axis2Z])));
+			__m256 radius = _mm256_add_ps(_mm256_add_ps(_mm256_andnot_ps(signMask, radius0),
+				_mm256_andnot_ps(signMask, radius1)), _mm256_andnot_ps(signMask, radius2));
+
+			outside = _mm256_or_ps(outside,
+				_mm256_cmp_ps(_mm256_add_ps(distance, radius), zero, _CMP_LT_OQ));
+			if (_mm256_movemask_ps(outside) == BLOCK_MASK)
+				break;
+		}
+
+		uint32_t blockMask = ~_mm256_movemask_ps(outside) & BLOCK_MASK;
+		mask |= blockMask << ((i % BLOCKS_PER_MASK)*BLOCK_SIZE);
+		if (i % BLOCKS_PER_MASK == BLOCKS_PER_MASK - 1 || i == blockCount - 1)
+		{
+			outVisible[i/BLOCKS_PER_MASK] = mask;
+			mask = 0;
+		}
+	}
+}
+
+#else
+
+static inline uint32_t neonMoveMask(uint32x4_t value)
+{
+	const uint32_t bitValues[4] = {1, 2, 4, 8};
+	uint32x4_t bits = vandq_u32(value, vld1q_u32(bitValues));
+#if DS_ARM_64
+	return vaddvq_u32(bits);
+#else
+	uint32x2_t sum = vpadd_u32(vget_low_u32(bits), vget_high_u32(bits));
+	return vget_lane_u32(vpadd_u32(sum, sum), 0);
+#endif
+}
+
+static void intersectBlocksNEON(uint32_t* outVisible, const BoxBlock* blocks,
+	uint32_t blockCount, const dsPlane3f* planes, uint32_t planeCount)
+{
+	float32x4_t zero = vdupq_n_f32(0.0f);
+	uint32_t mask = 0;
+	for (uint32_t i = 0; i < blockCount; ++i)
+	{
+		const BoxBlock* block = blocks + i;
+		uint32_t blockMask = 0;
+		for (uint32_t j = 0; j < BLOCK_SIZE; j += 4)
+		{
+			uint32x4_t outside = vdupq_n_u32(0);
+			for (uint32_t k = 0; k < planeCount; ++k)
+			{
+				const dsPlane3f* plane = planes + k;
+				float32x4_t distance = vmlaq_n_f32(vmlaq_n_f32(
+					vmulq_n_f32(vld1q_f32(block->values[Component_CenterX] + j), plane->n.x),
+					vld1q_f32(block->values[Component_CenterY] + j), plane->n.y),
+					vld1q_f32(block->values[Component_CenterZ] + j), plane->n.z);
+				distance = vsubq_f32(distance, vdupq_n_f32(plane->d));
+
+				float32x4_t radius0 = vmlaq_n_f32(vmlaq_n_f32(
+					vmulq_n_f32(vld1q_f32(block->values[Component_Axis0X] + j), plane->n.x),
+					vld1q_f32(block->values[Component_Axis0Y] + j), plane->n.y),
+					vld1q_f32(block->values[Component_Axis0Z] + j), plane->n.z);
+				float32x4_t radius1 = vmlaq_n_f32(vmlaq_n_f32(
+					vmulq_n_f32(vld1q_f32(block->values[Component_Axis1X] + j), plane->n.x),
+					vld1q_f32(block->values[Component_Axis1Y] + j), plane->n.y),
+					vld1q_f32(block->values[Component_Axis1Z] + j), plane->n.z);
+				float32x4_t radius2 = vmlaq_n_f32(vmlaq_n_f32(
+					vmulq_n_f32(vld1q_f32(block->values[Component_Axis2X] + j), plane->n.x),
+					vld1q_f32(block->values[Component_Axis2Y] + j), plane->n.y),
+					vld1q_f32(block->values[Component_Axis2Z] + j), plane->n.z);
+				float32x4_t radius = vaddq_f32(vaddq_f32(vabsq_f32(radius0), vabsq_f32(radius1)),
+					vabsq_f32(radius2));
+
+				outside = vorrq_u32(outside, vcltq_f32(vaddq_f32(distance, radius), zero));
+				if (neonMoveMask(outside) == 0xF)
+					break;
+			}
+
+			blockMask |= (~neonMoveMask(outside) & 0xFU) << j;
+		}
+
+		mask |= blockMask << ((i % BLOCKS_PER_MASK)*BLOCK_SIZE);
+		if (i % BLOCKS_PER_MASK == BLOCKS_PER_MASK - 1 || i == blockCount - 1)
+		{
+			outVisible[i/BLOCKS_PER_MASK] = mask;
+			mask = 0;
+		}
+	}
+}
+
+#endif
+
+#endif
+
+static IntersectBlocksFunction getIntersectBlocksFunction(void)
+{
+#if DS_HAS_SIMD
+	dsSIMDFeatures features = dsSIMD_getHostFeatures();
+#if DS_X86_32 || DS_X86_64
+	if (features & dsSIMDFeatures_Float8)
+		return &intersectBlocksAVX;
+	else if (features & dsSIMDFeatures_Float4)
+		return &intersectBlocksSSE;
+#else
+	if (features & dsSIMDFeatures_Float4)
+		return &intersectBlocksNEON;
+#endif
+#endif
+
+	return &intersectBlocksScalar;
+}
+
+dsCullBoxArray* dsCullBoxArray_create(dsAllocator* allocator, uint32_t boxCount)
+{
+	if (!allocator)
+	{
+		errno = EINVAL;
+		return NULL;
+	}
+
+	if (!allocator->freeFunc)
+	{
+		errno = EINVAL;
+		DS_LOG_ERROR(DS_GEOMETRY_LOG_TAG, "Cull box array allocator must support freeing memory.");
+		return NULL;
+	}
+
+	dsCullBoxArray* boxes = DS_ALLOCATE_OBJECT(allocator, dsCullBoxArray);
+	if (!boxes)
+		return NULL;
+
+	boxes->allocator = dsAllocator_keepPointer(allocator);
+	boxes->blocks = NULL;
+	boxes->boxCount = 0;
+	boxes->blockCount = 0;
+	boxes->maxBlocks = 0;
+
+	if (!dsCullBoxArray_setBoxCount(boxes, boxCount))
+	{
+		dsCullBoxArray_destroy(boxes);
+		return NULL;
+	}
+
+	return boxes;
+}
+
+uint32_t dsCullBoxArray_getBoxCount(const dsCullBoxArray* boxes)
+{
+	if (!boxes)
+		return 0;
+
+	return boxes->boxCount;
+}
+
+bool dsCullBoxArray_setBoxCount(dsCullBoxArray* boxes, uint32_t boxCount)
+{
+	if (!boxes)
+	{
+		errno = EINVAL;
+		return false;
+	}
+
+	uint32_t blockCount = (boxCount + BLOCK_SIZE - 1)/BLOCK_SIZE;
+	if (blockCount > boxes->blockCount)
+	{
+		uint32_t firstBlock = boxes->blockCount;
+		if (!DS_RESIZEABLE_ARRAY_ADD(boxes->allocator, boxes->blocks, boxes->blockCount,
+				boxes->maxBlocks, blockCount - firstBlock))
+		{
+			return false;
+		}
+
+		// Make sure the padding at the end of the last block is always valid.
+		for (uint32_t i = firstBlock*BLOCK_SIZE; i < blockCount*BLOCK_SIZE; ++i)
+			setInfinite(boxes, i);
+	}
+	else
+		boxes->blockCount = blockCount;
+
+	for (uint32_t i = boxes->boxCount; i < boxCount; ++i)
+		setInfinite(boxes, i);
+	boxes->boxCount = boxCount;
+	return true;
+}
+
+bool dsCullBoxArray_setOrientedBox(dsCullBoxArray* boxes, uint32_t index,
+	const dsOrientedBox3f* box, const dsMatrix44f* transform)
+{
+	if (!boxes || !box || !dsOrientedBox3_isValid(*box))
+	{
+		errno = EINVAL;
+		return false;
+	}
+
+	if (index >= boxes->boxCount)
+	{
+		errno = EINDEX;
+		return false;
+	}
+
+	dsMatrix33f axes;
+	dsVector3_scale(axes.columns[0], box->orientation.columns[0], box->halfExtents.x);
+	dsVector3_scale(axes.columns[1], box->orientation.columns[1], box->halfExtents.y);
+	dsVector3_scale(axes.columns[2], box->orientation.columns[2], box->halfExtents.z);
+	setTransformedBox(boxes, index, &box->center, &axes, transform);
+	return true;
+}
+
+bool dsCullBoxArray_setAlignedBox(dsCullBoxArray* boxes, uint32_t index,
+	const dsAlignedBox3f* box, const dsMatrix44f* transform)
+{
+	if (!boxes || !box || !dsAlignedBox3_isValid(*box))
+	{
+		errno = EINVAL;
+		return false;
+	}
+
+	if (index >= boxes->boxCount)
+	{
+		errno = EINDEX;
+		return false;
+	}
+
+	dsVector3f center, halfExtents;
+	dsAlignedBox3_center(center, *box);
+	dsAlignedBox3_extents(halfExtents, *box);
+	dsVector3_scale(halfExtents, halfExtents, 0.5f);
+
+	dsMatrix33f axes =
+	{{
+		{halfExtents.x, 0.0f, 0.0f},
+		{0.0f, halfExtents.y, 0.0f},
+		{0.0f, 0.0f, halfExtents.z}
+	}};
+	setTransformedBox(boxes, index, &center, &axes, transform);
+	return true;
+}
+
+bool dsCullBoxArray_setInfinite(dsCullBoxArray* boxes, uint32_t index)
+{
+	if (!boxes)
+	{
+		errno = EINVAL;
+		return false;
+	}
+
+	if (index >= boxes->boxCount)
+	{
+		errno = EINDEX;
+		return false;
+	}
+
+	setInfinite(boxes, index);
+	return true;
+}
+
+bool dsCullBoxArray_copyBox(dsCullBoxArray* boxes, uint32_t dstIndex, uint32_t srcIndex)
+{
+	if (!boxes)
+	{
+		errno = EINVAL;
+		return false;
+	}
+
+	if (dstIndex >= boxes->boxCount || srcIndex >= boxes->boxCount)
+	{
+		errno = EINDEX;
+		return false;
+	}
+
+	BoxBlock* dstBlock = boxes->blocks + dstIndex/BLOCK_SIZE;
+	const BoxBlock* srcBlock = boxes->blocks + srcIndex/BLOCK_SIZE;
+	uint32_t dstLane = dstIndex % BLOCK_SIZE;
+	uint32_t srcLane = srcIndex % BLOCK_SIZE;
+	for (int i = 0; i < Component_Count; ++i)
+		dstBlock->values[i][dstLane] = srcBlock->values[i][srcLane];
+	return true;
+}
+
+uint32_t dsCullBoxArray_intersectFrustum(uint32_t* outVisible, const dsCullBoxArray* boxes,
+	const dsFrustum3f* frustum, uint32_t firstBox, uint32_t boxCount)
+{
+	if (!outVisible || !boxes || !frustum || firstBox % DS_CULL_BOX_MASK_BITS != 0)
+	{
+		errno = EINVAL;
+		return 0;
+	}
+
+	if (!DS_IS_BUFFER_RANGE_VALID(firstBox, boxCount, boxes->boxCount))
+	{
+		errno = EINDEX;
+		return 0;
+	}
+
+	if (boxCount == 0)
+		return 0;
+
+	DS_PROFILE_FUNC_START();
+
+	dsPlane3f planes[dsFrustumPlanes_Count];
+	uint32_t planeCount = 0;
+	for (int i = 0; i < dsFrustumPlanes_Count; ++i)
+	{
+		const dsPlane3f* plane = frustum->planes + i;
+		if (plane->n.x != 0.0f || plane->n.y != 0.0f || plane->n.z != 0.0f)
+			planes[planeCount++] = *plane;
+	}
+
+	uint32_t endBox = firstBox + boxCount;
+	uint32_t firstBlock = firstBox/BLOCK_SIZE;
+	uint32_t blockCount = (endBox + BLOCK_SIZE - 1)/BLOCK_SIZE - firstBlock;
+	uint32_t* visible = outVisible + firstBox/DS_CULL_BOX_MASK_BITS;
+	IntersectBlocksFunction intersectBlocks = getIntersectBlocksFunction();
+	intersectBlocks(visible, boxes->blocks + firstBlock, blockCount, planes, planeCount);
+
+	// Clear out any bits past the end of the range.
+	uint32_t maskCount = DS_CULL_BOX_MASK_COUNT(boxCount);
+	uint32_t lastBits = endBox % DS_CULL_BOX_MASK_BITS;
+	if (lastBits != 0)
+		visible[maskCount - 1] &= (1U << lastBits) - 1;
+
+	uint32_t visibleCount = 0;
+	for (uint32_t i = 0; i < maskCount; ++i)
+		visibleCount += dsCountBits(visible[i]);
+	DS_PROFILE_FUNC_RETURN(visibleCount);
+}
+
+void dsCullBoxArray_destroy(dsCullBoxArray* boxes)
+{
+	if (!boxes)
+		return;
+
+	DS_VERIFY(dsAllocator_free(boxes->allocator, boxes->blocks));
+	DS_VERIFY(dsAllocator_free(boxes->allocator, boxes));
+}
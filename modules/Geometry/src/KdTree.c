@@ -22,11 +22,11 @@
 #include <DeepSea/Core/Assert.h>
 #include <DeepSea/Core/Error.h>
 #include <DeepSea/Core/Log.h>
-#include <DeepSea/Core/Sort.h>
 #include <DeepSea/Geometry/AlignedBox2.h>
 #include <DeepSea/Geometry/AlignedBox3.h>
 #include <DeepSea/Math/Vector2.h>
 #include <DeepSea/Math/Vector3.h>
+#include <math.h>
 #include <string.h>
 
 typedef struct dsKdTreeNode
@@ -55,64 +55,144 @@ struct dsKdTree
 	uint32_t maxNodes;
 };
 
-typedef struct SortContext
-{
-	uint8_t axis;
-	uint8_t pointOffset;
-} SortContext;
+#define MAX_NODE_SIZE (sizeof(dsKdTreeNode) + sizeof(dsVector3d))
 
 typedef void (*AddPointFunction)(void* bounds, const void* point);
 typedef void (*MakeInvalidFunction)(void* bounds);
 
+typedef struct NeighborContext
+{
+	const dsKdTree* kdTree;
+	double point[3];
+	// Max heap of the closest neighbors, using the squared distance until the end.
+	dsKdTreeNeighbor* neighbors;
+	uint32_t neighborCount;
+	uint32_t maxNeighbors;
+	double maxDistance2;
+	// Scale applied to the squared distance when pruning for approximate queries.
+	double pruneScale2;
+} NeighborContext;
+
+typedef struct RadiusContext
+{
+	const dsKdTree* kdTree;
+	double point[3];
+	double radius;
+	double radius2;
+	dsKdTreeVisitFunction visitor;
+	void* userData;
+	uint32_t count;
+} RadiusContext;
+
 inline static dsKdTreeNode* getNode(dsKdTreeNode* nodes, uint8_t nodeSize, uint32_t index)
 {
 	return (dsKdTreeNode*)(((uint8_t*)nodes) + index*nodeSize);
 }
 
-static int comparePointf(const void* left, const void* right, void* context)
+static double getPointValue(const dsKdTree* kdTree, const void* point, uint8_t axis)
+{
+	switch (kdTree->element)
+	{
+		case dsGeometryElement_Float:
+			return ((const float*)point)[axis];
+		case dsGeometryElement_Double:
+			return ((const double*)point)[axis];
+		case dsGeometryElement_Int:
+			return ((const int*)point)[axis];
+		default:
+			DS_ASSERT(false);
+			return 0.0;
+	}
+}
+
+static void getPointValues(double* outValues, const dsKdTree* kdTree, const void* point)
+{
+	for (uint8_t i = 0; i < kdTree->axisCount; ++i)
+		outValues[i] = getPointValue(kdTree, point, i);
+}
+
+static double pointDistance2(const dsKdTree* kdTree, const double* point,
+	const dsKdTreeNode* node)
 {
-	const SortContext* sortContext = (const SortContext*)context;
-	const float* leftPoint = (const float*)((const uint8_t*)left + sortContext->pointOffset);
-	const float* rightPoint = (const float*)((const uint8_t*)right + sortContext->pointOffset);
-
-	float leftVal = leftPoint[sortContext->axis];
-	float rightVal = rightPoint[sortContext->axis];
-
-	if (leftVal < rightVal)
-		return -1;
-	else if (leftVal > rightVal)
-		return 1;
-	return 0;
+	double distance2 = 0.0;
+	for (uint8_t i = 0; i < kdTree->axisCount; ++i)
+	{
+		double offset = getPointValue(kdTree, node->point, i) - point[i];
+		distance2 += offset*offset;
+	}
+
+	return distance2;
 }
 
-static int comparePointd(const void* left, const void* right, void* context)
+// Indices are signed for selectNode().
+static void swapNodes(dsKdTree* kdTree, int64_t left, int64_t right)
 {
-	const SortContext* sortContext = (const SortContext*)context;
-	const double* leftPoint = (const double*)((const uint8_t*)left + sortContext->pointOffset);
-	const double* rightPoint = (const double*)((const uint8_t*)right + sortContext->pointOffset);
-
-	double leftVal = leftPoint[sortContext->axis];
-	double rightVal = rightPoint[sortContext->axis];
-
-	if (leftVal < rightVal)
-		return -1;
-	else if (leftVal > rightVal)
-		return 1;
-	return 0;
+	double temp[MAX_NODE_SIZE/sizeof(double)];
+	dsKdTreeNode* leftNode = getNode(kdTree->nodes, kdTree->nodeSize, (uint32_t)left);
+	dsKdTreeNode* rightNode = getNode(kdTree->nodes, kdTree->nodeSize, (uint32_t)right);
+	memcpy(temp, leftNode, kdTree->nodeSize);
+	memcpy(leftNode, rightNode, kdTree->nodeSize);
+	memcpy(rightNode, temp, kdTree->nodeSize);
 }
 
-static int comparePointi(const void* left, const void* right, void* context)
+inline static double getNodeValue(const dsKdTree* kdTree, int64_t node, uint8_t axis)
 {
-	const SortContext* sortContext = (const SortContext*)context;
-	const int* leftPoint = (const int*)((const uint8_t*)left + sortContext->pointOffset);
-	const int* rightPoint = (const int*)((const uint8_t*)right + sortContext->pointOffset);
+	return getPointValue(kdTree, getNode(kdTree->nodes, kdTree->nodeSize, (uint32_t)node)->point,
+		axis);
+}
+
+// Partially orders the nodes so the node at index is in its sorted position along the axis, with
+// smaller or equal values before it and larger or equal values after it. This is expected O(n) as
+// opposed to O(n*log(n)) for a full sort, similar to std::nth_element().
+static void selectNode(dsKdTree* kdTree, uint32_t start, uint32_t count, uint32_t index,
+	uint8_t axis)
+{
+	int64_t left = start;
+	int64_t right = start + count - 1;
+	int64_t target = start + index;
+	while (left < right)
+	{
+		// Median of three to choose the pivot, which also guarantees the scans below stay within
+		// the range.
+		int64_t middle = left + (right - left)/2;
+		if (getNodeValue(kdTree, middle, axis) < getNodeValue(kdTree, left, axis))
+			swapNodes(kdTree, middle, left);
+		if (getNodeValue(kdTree, right, axis) < getNodeValue(kdTree, left, axis))
+			swapNodes(kdTree, right, left);
+		if (getNodeValue(kdTree, right, axis) < getNodeValue(kdTree, middle, axis))
+			swapNodes(kdTree, right, middle);
+
+		double pivot = getNodeValue(kdTree, middle, axis);
+		int64_t i = left;
+		int64_t j = right;
+		while (i <= j)
+		{
+			while (getNodeValue(kdTree, i, axis) < pivot)
+				++i;
+			while (getNodeValue(kdTree, j, axis) > pivot)
+				--j;
+
+			if (i <= j)
+			{
+				swapNodes(kdTree, i, j);
+				++i;
+				--j;
+			}
+		}
 
-	return leftPoint[sortContext->axis] - rightPoint[sortContext->axis];
+		// Everything between j and i is equal to the pivot.
+		if (target <= j)
+			right = j;
+		else if (target >= i)
+			left = i;
+		else
+			break;
+	}
 }
 
 static void buildKdTreeRec(dsKdTree* kdTree, uint32_t start, uint32_t count,
 	MakeInvalidFunction makeInvalidFunc, AddPointFunction addPointFunc,
-	MaxAxisFunction maxAxisFunc, dsSortCompareFunction compareFunc)
+	MaxAxisFunction maxAxisFunc)
 {
 	if (count == 0)
 	{
@@ -127,16 +207,14 @@ static void buildKdTreeRec(dsKdTree* kdTree, uint32_t start, uint32_t count,
 	dsAlignedBox3d bounds;
 	makeInvalidFunc(&bounds);
 	for (uint32_t i = 0; i < count; ++i)
-		addPointFunc(&bounds, getNode(kdTree->nodes, kdTree->nodeSize, i)->point);
+		addPointFunc(&bounds, getNode(kdTree->nodes, kdTree->nodeSize, start + i)->point);
 
-	// Sort based on the maximum dimension.
+	// Partition around the middle of the maximum dimension.
 	uint8_t maxAxis = maxAxisFunc(&bounds);
-	SortContext context = {maxAxis, (uint8_t)(kdTree->nodeSize - kdTree->pointSize)};
-	dsSort(getNode(kdTree->nodes, kdTree->nodeSize, start), count, kdTree->nodeSize, compareFunc,
-		&context);
+	uint32_t middle = count/2;
+	selectNode(kdTree, start, count, middle, maxAxis);
 
 	// Recurse down the middle.
-	uint32_t middle = count/2;
 	dsKdTreeNode* middleNode = getNode(kdTree->nodes, kdTree->nodeSize, start + middle);
 	middleNode->leftCount = middle;
 	middleNode->rightCount = middle == count - 1 ? 0 : count - middle - 1;
@@ -145,14 +223,148 @@ static void buildKdTreeRec(dsKdTree* kdTree, uint32_t start, uint32_t count,
 	if (middleNode->leftCount > 0)
 	{
 		buildKdTreeRec(kdTree, start, middleNode->leftCount, makeInvalidFunc, addPointFunc,
-			maxAxisFunc, compareFunc);
+			maxAxisFunc);
 	}
 
 	if (middleNode->rightCount > 0)
 	{
 		buildKdTreeRec(kdTree, start + middle + 1, middleNode->rightCount, makeInvalidFunc,
-			addPointFunc, maxAxisFunc, compareFunc);
+			addPointFunc, maxAxisFunc);
+	}
+}
+
+static void pushNeighborHeap(dsKdTreeNeighbor* heap, uint32_t* heapSize, const void* object,
+	double distance2)
+{
+	uint32_t i = (*heapSize)++;
+	while (i > 0)
+	{
+		uint32_t parent = (i - 1)/2;
+		if (heap[parent].distance >= distance2)
+			break;
+
+		heap[i] = heap[parent];
+		i = parent;
+	}
+
+	heap[i].object = object;
+	heap[i].distance = distance2;
+}
+
+static void siftDownNeighborHeap(dsKdTreeNeighbor* heap, uint32_t heapSize, uint32_t i)
+{
+	dsKdTreeNeighbor neighbor = heap[i];
+	while (true)
+	{
+		uint32_t child = i*2 + 1;
+		if (child >= heapSize)
+			break;
+
+		if (child + 1 < heapSize && heap[child + 1].distance > heap[child].distance)
+			++child;
+		if (heap[child].distance <= neighbor.distance)
+			break;
+
+		heap[i] = heap[child];
+		i = child;
+	}
+
+	heap[i] = neighbor;
+}
+
+static void addNeighbor(NeighborContext* context, const void* object, double distance2)
+{
+	if (context->neighborCount < context->maxNeighbors)
+	{
+		pushNeighborHeap(context->neighbors, &context->neighborCount, object, distance2);
+		return;
 	}
+
+	// Replace the furthest neighbor.
+	if (distance2 >= context->neighbors[0].distance)
+		return;
+
+	context->neighbors[0].object = object;
+	context->neighbors[0].distance = distance2;
+	siftDownNeighborHeap(context->neighbors, context->neighborCount, 0);
+}
+
+inline static double maxNeighborDistance2(const NeighborContext* context)
+{
+	if (context->neighborCount < context->maxNeighbors)
+		return context->maxDistance2;
+	return context->neighbors[0].distance;
+}
+
+static void nearestNeighborsRec(NeighborContext* context, uint32_t start, uint32_t count)
+{
+	const dsKdTree* kdTree = context->kdTree;
+	uint32_t middle = start + count/2;
+	const dsKdTreeNode* node = getNode(kdTree->nodes, kdTree->nodeSize, middle);
+
+	double distance2 = pointDistance2(kdTree, context->point, node);
+	if (distance2 <= context->maxDistance2)
+		addNeighbor(context, node->object, distance2);
+
+	// Visit the side containing the point first to find close neighbors early, allowing the
+	// other side to be pruned.
+	double offset = context->point[node->axis] - getPointValue(kdTree, node->point, node->axis);
+	uint32_t leftStart = start;
+	uint32_t rightStart = middle + 1;
+	if (offset < 0.0)
+	{
+		if (node->leftCount > 0)
+			nearestNeighborsRec(context, leftStart, node->leftCount);
+		if (node->rightCount > 0 &&
+			offset*offset*context->pruneScale2 <= maxNeighborDistance2(context))
+		{
+			nearestNeighborsRec(context, rightStart, node->rightCount);
+		}
+	}
+	else
+	{
+		if (node->rightCount > 0)
+			nearestNeighborsRec(context, rightStart, node->rightCount);
+		if (node->leftCount > 0 &&
+			offset*offset*context->pruneScale2 <= maxNeighborDistance2(context))
+		{
+			nearestNeighborsRec(context, leftStart, node->leftCount);
+		}
+	}
+}
+
+// NOTE: bool return value is whether or not to continue traversing
+static bool withinRadiusRec(RadiusContext* context, uint32_t start, uint32_t count)
+{
+	const dsKdTree* kdTree = context->kdTree;
+	uint32_t middle = start + count/2;
+	const dsKdTreeNode* node = getNode(kdTree->nodes, kdTree->nodeSize, middle);
+
+	double distance2 = pointDistance2(kdTree, context->point, node);
+	if (distance2 <= context->radius2)
+	{
+		++context->count;
+		if (context->visitor && !context->visitor(context->userData, kdTree, node->object,
+				node->point, sqrt(distance2)))
+		{
+			return false;
+		}
+	}
+
+	double offset = context->point[node->axis] - getPointValue(kdTree, node->point, node->axis);
+	if (node->leftCount > 0 && offset <= context->radius &&
+		!withinRadiusRec(context, start, node->leftCount))
+	{
+		return false;
+	}
+
+	if (node->rightCount > 0 && -offset <= context->radius &&
+		!withinRadiusRec(context, middle + 1, node->rightCount))
+	{
+		return false;
+	}
+
+	return true;
 }
 
 static void traverseKdTreeRec(const dsKdTree* kdTree, uint32_t curNode,
@@ -269,7 +481,6 @@ bool dsKdTree_build(dsKdTree* kdTree, const void* objects, uint32_t objectCount,
 	MakeInvalidFunction makeInvalidFunc;
 	AddPointFunction addPointFunc;
 	MaxAxisFunction maxAxisFunc;
-	dsSortCompareFunction compareFunc;
 	switch (kdTree->element)
 	{
 		case dsGeometryElement_Float:
@@ -286,7 +497,6 @@ bool dsKdTree_build(dsKdTree* kdTree, const void* objects, uint32_t objectCount,
 				addPointFunc = (AddPointFunction)&dsAlignedBox3f_addPoint;
 				maxAxisFunc = &dsSpatialStructure_maxAxis3f;
 			}
-			compareFunc = &comparePointf;
 			break;
 		case dsGeometryElement_Double:
 			if (kdTree->axisCount == 2)
@@ -302,7 +512,6 @@ bool dsKdTree_build(dsKdTree* kdTree, const void* objects, uint32_t objectCount,
 				addPointFunc = (AddPointFunction)&dsAlignedBox3d_addPoint;
 				maxAxisFunc = &dsSpatialStructure_maxAxis3d;
 			}
-			compareFunc = &comparePointd;
 			break;
 		case dsGeometryElement_Int:
 			if (kdTree->axisCount == 2)
@@ -314,11 +523,10 @@ bool dsKdTree_build(dsKdTree* kdTree, const void* objects, uint32_t objectCount,
 			else
 			{
 				DS_ASSERT(kdTree->axisCount == 3);
-				makeInvalidFunc = (MakeInvalidFunction)&dsAlignedBox2d_makeInvalid;
+				makeInvalidFunc = (MakeInvalidFunction)&dsAlignedBox3i_makeInvalid;
 				addPointFunc = (AddPointFunction)&dsAlignedBox3i_addPoint;
 				maxAxisFunc = &dsSpatialStructure_maxAxis3i;
 			}
-			compareFunc = &comparePointi;
 			break;
 		default:
 			DS_ASSERT(false);
@@ -344,7 +552,7 @@ bool dsKdTree_build(dsKdTree* kdTree, const void* objects, uint32_t objectCount,
 		node->object = object;
 	}
 
-	buildKdTreeRec(kdTree, 0, objectCount, makeInvalidFunc, addPointFunc, maxAxisFunc, compareFunc);
+	buildKdTreeRec(kdTree, 0, objectCount, makeInvalidFunc, addPointFunc, maxAxisFunc);
 	return true;
 }
 
@@ -362,6 +570,66 @@ bool dsKdTree_traverse(const dsKdTree* kdTree, dsKdTreeTraverseFunction traverse
 	return true;
 }
 
+uint32_t dsKdTree_nearestNeighbors(dsKdTreeNeighbor* outNeighbors, uint32_t maxNeighbors,
+	const dsKdTree* kdTree, const void* point, double maxDistance, double epsilon)
+{
+	if (!outNeighbors || !kdTree || !point || epsilon < 0.0)
+	{
+		errno = EINVAL;
+		return 0;
+	}
+
+	if (kdTree->nodeCount == 0 || maxNeighbors == 0)
+		return 0;
+
+	NeighborContext context;
+	context.kdTree = kdTree;
+	getPointValues(context.point, kdTree, point);
+	context.neighbors = outNeighbors;
+	context.neighborCount = 0;
+	context.maxNeighbors = maxNeighbors;
+	context.maxDistance2 = maxDistance*maxDistance;
+	context.pruneScale2 = (1.0 + epsilon)*(1.0 + epsilon);
+	nearestNeighborsRec(&context, 0, kdTree->nodeCount);
+
+	// Sort the heap in place so the closest neighbors are first.
+	for (uint32_t i = context.neighborCount; i-- > 1;)
+	{
+		dsKdTreeNeighbor temp = outNeighbors[0];
+		outNeighbors[0] = outNeighbors[i];
+		outNeighbors[i] = temp;
+		siftDownNeighborHeap(outNeighbors, i, 0);
+	}
+
+	for (uint32_t i = 0; i < context.neighborCount; ++i)
+		outNeighbors[i].distance = sqrt(outNeighbors[i].distance);
+	return context.neighborCount;
+}
+
+uint32_t dsKdTree_withinRadius(const dsKdTree* kdTree, const void* point, double radius,
+	dsKdTreeVisitFunction visitor, void* userData)
+{
+	if (!kdTree || !point)
+	{
+		errno = EINVAL;
+		return 0;
+	}
+
+	if (kdTree->nodeCount == 0 || radius < 0.0)
+		return 0;
+
+	RadiusContext context;
+	context.kdTree = kdTree;
+	getPointValues(context.point, kdTree, point);
+	context.radius = radius;
+	context.radius2 = radius*radius;
+	context.visitor = visitor;
+	context.userData = userData;
+	context.count = 0;
+	withinRadiusRec(&context, 0, kdTree->nodeCount);
+	return context.count;
+}
+
 void dsKdTree_clear(dsKdTree* kdTree)
 {
 	if (!kdTree)
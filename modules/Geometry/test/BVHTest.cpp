@@ -14,12 +14,23 @@
  * limitations under the License.
  */
 
+#include <DeepSea/Core/Error.h>
 #include <DeepSea/Core/Memory/SystemAllocator.h>
+#include <DeepSea/Core/Thread/Thread.h>
+#include <DeepSea/Core/Thread/ThreadPool.h>
+#include <DeepSea/Core/Timer.h>
 #include <DeepSea/Geometry/AlignedBox2.h>
 #include <DeepSea/Geometry/AlignedBox3.h>
 #include <DeepSea/Geometry/BVH.h>
+#include <DeepSea/Geometry/Frustum3.h>
+#include <DeepSea/Math/Matrix44.h>
+#include <DeepSea/Math/Vector3.h>
 #include <gtest/gtest.h>
+#include <algorithm>
+#include <cfloat>
 #include <cmath>
+#include <random>
+#include <vector>
 
 // Handle older versions of gtest.
 #ifndef TYPED_TEST_SUITE
@@ -73,18 +84,34 @@ template <>
 struct BVHSelector<2, float> : public BVHParamSelector<2, float>
 {
 	typedef dsAlignedBox2f AlignedBoxType;
+	typedef dsRay2f RayType;
+	typedef dsVector2f VectorType;
 
 	static AlignedBoxType createBounds(int minX, int minY, int, int maxX, int maxY, int)
 	{
 		AlignedBoxType alignedBox = {{{(float)minX, (float)minY}}, {{(float)maxX, (float)maxY}}};
 		return alignedBox;
 	}
+
+	static RayType createRay(double x, double y, double, double dirX, double dirY, double)
+	{
+		RayType ray = {{{(float)x, (float)y}}, {{(float)dirX, (float)dirY}}};
+		return ray;
+	}
+
+	static VectorType createPoint(int x, int y, int)
+	{
+		VectorType point = {{(float)x, (float)y}};
+		return point;
+	}
 };
 
 template <>
 struct BVHSelector<2, double> : public BVHParamSelector<2, double>
 {
 	typedef dsAlignedBox2d AlignedBoxType;
+	typedef dsRay2d RayType;
+	typedef dsVector2d VectorType;
 
 	static AlignedBoxType createBounds(int minX, int minY, int, int maxX, int maxY, int)
 	{
@@ -92,24 +119,52 @@ struct BVHSelector<2, double> : public BVHParamSelector<2, double>
 			{{(double)maxX, (double)maxY}}};
 		return alignedBox;
 	}
+
+	static RayType createRay(double x, double y, double, double dirX, double dirY, double)
+	{
+		RayType ray = {{{(double)x, (double)y}}, {{(double)dirX, (double)dirY}}};
+		return ray;
+	}
+
+	static VectorType createPoint(int x, int y, int)
+	{
+		VectorType point = {{(double)x, (double)y}};
+		return point;
+	}
 };
 
 template <>
 struct BVHSelector<2, int> : public BVHParamSelector<2, int>
 {
 	typedef dsAlignedBox2i AlignedBoxType;
+	typedef dsRay2d RayType;
+	typedef dsVector2i VectorType;
 
 	static AlignedBoxType createBounds(int minX, int minY, int, int maxX, int maxY, int)
 	{
 		AlignedBoxType alignedBox = {{{minX, minY}}, {{maxX, maxY}}};
 		return alignedBox;
 	}
+
+	static RayType createRay(double x, double y, double, double dirX, double dirY, double)
+	{
+		RayType ray = {{{(double)x, (double)y}}, {{(double)dirX, (double)dirY}}};
+		return ray;
+	}
+
+	static VectorType createPoint(int x, int y, int)
+	{
+		VectorType point = {{(int)x, (int)y}};
+		return point;
+	}
 };
 
 template <>
 struct BVHSelector<3, float> : public BVHParamSelector<3, float>
 {
 	typedef dsAlignedBox3f AlignedBoxType;
+	typedef dsRay3f RayType;
+	typedef dsVector3f VectorType;
 
 	static AlignedBoxType createBounds(int minX, int minY, int minZ, int maxX, int maxY, int maxZ)
 	{
@@ -117,12 +172,27 @@ struct BVHSelector<3, float> : public BVHParamSelector<3, float>
 			{{(float)maxX, (float)maxY, (float)maxZ}}};
 		return alignedBox;
 	}
+
+	static RayType createRay(double x, double y, double z, double dirX, double dirY,
+		double dirZ)
+	{
+		RayType ray = {{{(float)x, (float)y, (float)z}}, {{(float)dirX, (float)dirY, (float)dirZ}}};
+		return ray;
+	}
+
+	static VectorType createPoint(int x, int y, int z)
+	{
+		VectorType point = {{(float)x, (float)y, (float)z}};
+		return point;
+	}
 };
 
 template <>
 struct BVHSelector<3, double> : public BVHParamSelector<3, double>
 {
 	typedef dsAlignedBox3d AlignedBoxType;
+	typedef dsRay3d RayType;
+	typedef dsVector3d VectorType;
 
 	static AlignedBoxType createBounds(int minX, int minY, int minZ, int maxX, int maxY, int maxZ)
 	{
@@ -130,18 +200,46 @@ struct BVHSelector<3, double> : public BVHParamSelector<3, double>
 			{{(double)maxX, (double)maxY, (double)maxZ}}};
 		return alignedBox;
 	}
+
+	static RayType createRay(double x, double y, double z, double dirX, double dirY,
+		double dirZ)
+	{
+		RayType ray = {{{(double)x, (double)y, (double)z}}, {{(double)dirX, (double)dirY, (double)dirZ}}};
+		return ray;
+	}
+
+	static VectorType createPoint(int x, int y, int z)
+	{
+		VectorType point = {{(double)x, (double)y, (double)z}};
+		return point;
+	}
 };
 
 template <>
 struct BVHSelector<3, int> : public BVHParamSelector<3, int>
 {
 	typedef dsAlignedBox3i AlignedBoxType;
+	typedef dsRay3d RayType;
+	typedef dsVector3i VectorType;
 
 	static AlignedBoxType createBounds(int minX, int minY, int minZ, int maxX, int maxY, int maxZ)
 	{
 		AlignedBoxType alignedBox = {{{minX, minY, minZ}}, {{maxX, maxY, maxZ}}};
 		return alignedBox;
 	}
+
+	static RayType createRay(double x, double y, double z, double dirX, double dirY,
+		double dirZ)
+	{
+		RayType ray = {{{(double)x, (double)y, (double)z}}, {{(double)dirX, (double)dirY, (double)dirZ}}};
+		return ray;
+	}
+
+	static VectorType createPoint(int x, int y, int z)
+	{
+		VectorType point = {{(int)x, (int)y, (int)z}};
+		return point;
+	}
 };
 
 } // namespace
@@ -151,6 +249,8 @@ class BVHTest : public testing::Test
 {
 public:
 	using AlignedBoxType = typename SelectorT::AlignedBoxType;
+	using RayType = typename SelectorT::RayType;
+	using VectorType = typename SelectorT::VectorType;
 
 	struct TestObject
 	{
@@ -183,6 +283,16 @@ public:
 		return SelectorT::createBounds(minX, minY, minZ, maxX, maxY, maxZ);
 	}
 
+	static RayType createRay(double x, double y, double z, double dirX, double dirY, double dirZ)
+	{
+		return SelectorT::createRay(x, y, z, dirX, dirY, dirZ);
+	}
+
+	static VectorType createPoint(int x, int y, int z)
+	{
+		return SelectorT::createPoint(x, y, z);
+	}
+
 	static bool getBounds(void* outBounds, const dsBVH* bvh, const void* object)
 	{
 		if (dsBVH_getAxisCount(bvh) != axisCount() || dsBVH_getElement(bvh) != element())
@@ -423,6 +533,90 @@ TYPED_TEST(BVHTest, SeparateBoxesBalanced)
 	dsBVH_destroy(bvh);
 }
 
+TYPED_TEST(BVHTest, SeparateBoxesSAH)
+{
+	using TestObject = typename TestFixture::TestObject;
+	using AlignedBoxType = typename TestFixture::AlignedBoxType;
+
+	TestFixture* fixture = this;
+	dsBVH* bvh = dsBVH_create((dsAllocator*)&fixture->allocator, TestFixture::axisCount(),
+		TestFixture::element(), NULL);
+	ASSERT_TRUE(bvh);
+
+	TestObject data[] =
+	{
+		{TestFixture::createBounds(-2, -2, 0, -1, -1, 0), 0},
+		{TestFixture::createBounds( 1, -2, 0,  2, -1, 0), 1},
+		{TestFixture::createBounds(-2,  1, 0, -1,  2, 0), 2},
+		{TestFixture::createBounds( 1,  1, 0,  2,  2, 0), 3}
+	};
+
+	EXPECT_TRUE(dsBVH_buildSAH(bvh, data, DS_ARRAY_SIZE(data), sizeof(TestObject),
+		&TestFixture::getBounds, nullptr));
+
+	AlignedBoxType testBounds = TestFixture::createBounds(0, 0, 0, 0, 0, 0);
+	EXPECT_EQ(0U, dsBVH_intersect(bvh, &testBounds, nullptr, nullptr));
+
+	{
+		auto testFunc = [](const TestObject& object)
+		{
+			EXPECT_EQ(0, object.data);
+		};
+		testBounds = TestFixture::createBounds(-2, -2, 0, 0, 0, 0);
+		EXPECT_EQ(1U, dsBVH_intersect(bvh, &testBounds, fixture->lambdaAdapter(testFunc),
+			&testFunc));
+	}
+
+	{
+		auto testFunc = [](const TestObject& object)
+		{
+			EXPECT_EQ(1, object.data);
+		};
+		testBounds = TestFixture::createBounds(0, -2, 0, 2, 0, 0);
+		EXPECT_EQ(1U, dsBVH_intersect(bvh, &testBounds, fixture->lambdaAdapter(testFunc),
+			&testFunc));
+	}
+
+	{
+		auto testFunc = [](const TestObject& object)
+		{
+			EXPECT_EQ(2, object.data);
+		};
+		testBounds = TestFixture::createBounds(-2, 0, 0, 0, 2, 0);
+		EXPECT_EQ(1U, dsBVH_intersect(bvh, &testBounds, fixture->lambdaAdapter(testFunc),
+			&testFunc));
+	}
+
+	{
+		auto testFunc = [](const TestObject& object)
+		{
+			EXPECT_EQ(3, object.data);
+		};
+		testBounds = TestFixture::createBounds(0, 0, 0, 2, 2, 0);
+		EXPECT_EQ(1U, dsBVH_intersect(bvh, &testBounds, fixture->lambdaAdapter(testFunc),
+			&testFunc));
+	}
+
+	testBounds = TestFixture::createBounds(-1, -1, 0, 1, 1, 0);
+	EXPECT_EQ(4U, dsBVH_intersect(bvh, &testBounds, nullptr, nullptr));
+
+	std::pair<int, int> visitCounts = {0, 1};
+	EXPECT_EQ(1U, dsBVH_intersect(bvh, &testBounds, &TestFixture::limitedVisits, &visitCounts));
+
+	visitCounts = {0, 2};
+	EXPECT_EQ(2U, dsBVH_intersect(bvh, &testBounds, &TestFixture::limitedVisits, &visitCounts));
+
+	visitCounts = {0, 3};
+	EXPECT_EQ(3U, dsBVH_intersect(bvh, &testBounds, &TestFixture::limitedVisits, &visitCounts));
+
+	AlignedBoxType bounds;
+	EXPECT_TRUE(dsBVH_getBounds(&bounds, bvh));
+	AlignedBoxType fullBounds = TestFixture::createBounds(-2, -2, 0, 2, 2, 0);
+	EXPECT_EQ(0, memcmp(&fullBounds, &bounds, sizeof(AlignedBoxType)));
+
+	dsBVH_destroy(bvh);
+}
+
 TYPED_TEST(BVHTest, OverlappingBoxes)
 {
 	using TestObject = typename TestFixture::TestObject;
@@ -615,6 +809,102 @@ TYPED_TEST(BVHTest, OverlappingBoxesBalanced)
 	dsBVH_destroy(bvh);
 }
 
+TYPED_TEST(BVHTest, OverlappingBoxesSAH)
+{
+	using TestObject = typename TestFixture::TestObject;
+	using AlignedBoxType = typename TestFixture::AlignedBoxType;
+
+	TestFixture* fixture = this;
+	dsBVH* bvh = dsBVH_create((dsAllocator*)&fixture->allocator, TestFixture::axisCount(),
+		TestFixture::element(), NULL);
+	ASSERT_TRUE(bvh);
+
+	TestObject data[] =
+	{
+		{TestFixture::createBounds(-3, -3, 0, -1, -1, 0), 0},
+		{TestFixture::createBounds( 1, -3, 0,  3, -1, 0), 1},
+		{TestFixture::createBounds(-3,  1, 0, -1,  3, 0), 2},
+		{TestFixture::createBounds( 1,  1, 0,  3,  3, 0), 3},
+		{TestFixture::createBounds(-2, -2, 0,  2,  2, 0), 4}
+	};
+
+	EXPECT_TRUE(dsBVH_buildSAH(bvh, data, DS_ARRAY_SIZE(data), sizeof(TestObject),
+		&TestFixture::getBounds, nullptr));
+
+	AlignedBoxType testBounds;
+	{
+		auto testFunc = [](const TestObject& object)
+		{
+			EXPECT_EQ(4, object.data);
+		};
+		testBounds = TestFixture::createBounds(0, 0, 0, 0, 0, 0);
+		EXPECT_EQ(1U, dsBVH_intersect(bvh, &testBounds, fixture->lambdaAdapter(testFunc),
+			&testFunc));
+	}
+
+	{
+		auto testFunc = [](const TestObject& object)
+		{
+			EXPECT_TRUE(object.data == 0 || object.data == 4);
+		};
+		testBounds = TestFixture::createBounds(-2, -2, 0, 0, 0, 0);
+		EXPECT_EQ(2U, dsBVH_intersect(bvh, &testBounds, fixture->lambdaAdapter(testFunc),
+			&testFunc));
+	}
+
+	{
+		auto testFunc = [](const TestObject& object)
+		{
+			EXPECT_TRUE(object.data == 1 || object.data == 4);
+		};
+		testBounds = TestFixture::createBounds(0, -2, 0, 2, 0, 0);
+		EXPECT_EQ(2U, dsBVH_intersect(bvh, &testBounds, fixture->lambdaAdapter(testFunc),
+			&testFunc));
+	}
+
+	{
+		auto testFunc = [](const TestObject& object)
+		{
+			EXPECT_TRUE(object.data == 2 || object.data == 4);
+		};
+		testBounds = TestFixture::createBounds(-2, 0, 0, 0, 2, 0);
+		EXPECT_EQ(2U, dsBVH_intersect(bvh, &testBounds, fixture->lambdaAdapter(testFunc),
+			&testFunc));
+	}
+
+	{
+		auto testFunc = [](const TestObject& object)
+		{
+			EXPECT_TRUE(object.data == 3 || object.data == 4);
+		};
+		testBounds = TestFixture::createBounds(0, 0, 0, 2, 2, 0);
+		EXPECT_EQ(2U, dsBVH_intersect(bvh, &testBounds, fixture->lambdaAdapter(testFunc),
+			&testFunc));
+	}
+
+	testBounds = TestFixture::createBounds(-1, -1, 0, 1, 1, 0);
+	EXPECT_EQ(5U, dsBVH_intersect(bvh, &testBounds, nullptr, nullptr));
+
+	std::pair<int, int> visitCounts = {0, 1};
+	EXPECT_EQ(1U, dsBVH_intersect(bvh, &testBounds, &TestFixture::limitedVisits, &visitCounts));
+
+	visitCounts = {0, 2};
+	EXPECT_EQ(2U, dsBVH_intersect(bvh, &testBounds, &TestFixture::limitedVisits, &visitCounts));
+
+	visitCounts = {0, 3};
+	EXPECT_EQ(3U, dsBVH_intersect(bvh, &testBounds, &TestFixture::limitedVisits, &visitCounts));
+
+	visitCounts = {0, 4};
+	EXPECT_EQ(4U, dsBVH_intersect(bvh, &testBounds, &TestFixture::limitedVisits, &visitCounts));
+
+	AlignedBoxType bounds;
+	EXPECT_TRUE(dsBVH_getBounds(&bounds, bvh));
+	AlignedBoxType fullBounds = TestFixture::createBounds(-3, -3, 0, 3, 3, 0);
+	EXPECT_EQ(0, memcmp(&fullBounds, &bounds, sizeof(AlignedBoxType)));
+
+	dsBVH_destroy(bvh);
+}
+
 TYPED_TEST(BVHTest, ObjectPointer)
 {
 	using TestObject = typename TestFixture::TestObject;
@@ -758,16 +1048,20 @@ TYPED_TEST(BVHTest, ObjectIndex)
 	dsBVH_destroy(bvh);
 }
 
-TYPED_TEST(BVHTest, Update)
+TYPED_TEST(BVHTest, IntersectRay)
 {
 	using TestObject = typename TestFixture::TestObject;
-	using AlignedBoxType = typename TestFixture::AlignedBoxType;
+	using RayType = typename TestFixture::RayType;
 
 	TestFixture* fixture = this;
 	dsBVH* bvh = dsBVH_create((dsAllocator*)&fixture->allocator, TestFixture::axisCount(),
 		TestFixture::element(), NULL);
 	ASSERT_TRUE(bvh);
 
+	RayType ray = TestFixture::createRay(-3.0, -1.5, 0.0, 1.0, 0.0, 0.0);
+	EXPECT_FALSE(dsBVH_intersectRay(nullptr, nullptr, bvh, &ray, DBL_MAX, false, nullptr,
+		nullptr));
+
 	TestObject data[] =
 	{
 		{TestFixture::createBounds(-2, -2, 0, -1, -1, 0), 0},
@@ -779,48 +1073,146 @@ TYPED_TEST(BVHTest, Update)
 	EXPECT_TRUE(dsBVH_build(bvh, data, DS_ARRAY_SIZE(data), sizeof(TestObject),
 		&TestFixture::getBounds, false));
 
-	std::swap(data[0].bounds, data[1].bounds);
-	std::swap(data[2].bounds, data[3].bounds);
-	EXPECT_TRUE(dsBVH_update(bvh));
+	const void* object = nullptr;
+	double t = 0.0;
+	EXPECT_TRUE(dsBVH_intersectRay(&object, &t, bvh, &ray, DBL_MAX, false, nullptr, nullptr));
+	EXPECT_EQ(data + 0, object);
+	EXPECT_EQ(1.0, t);
 
-	AlignedBoxType testBounds = TestFixture::createBounds(0, 0, 0, 0, 0, 0);
-	EXPECT_EQ(0U, dsBVH_intersect(bvh, &testBounds, nullptr, nullptr));
+	EXPECT_TRUE(dsBVH_intersectRay(&object, &t, bvh, &ray, DBL_MAX, true, nullptr, nullptr));
+	EXPECT_TRUE(object == data + 0 || object == data + 1);
 
-	{
-		auto testFunc = [](const TestObject& object)
-		{
-			EXPECT_EQ(1, object.data);
-		};
-		testBounds = TestFixture::createBounds(-2, -2, 0, 0, 0, 0);
-		EXPECT_EQ(1U, dsBVH_intersect(bvh, &testBounds, fixture->lambdaAdapter(testFunc),
-			&testFunc));
-	}
+	EXPECT_FALSE(dsBVH_intersectRay(&object, &t, bvh, &ray, 0.5, false, nullptr, nullptr));
 
-	{
-		auto testFunc = [](const TestObject& object)
-		{
-			EXPECT_EQ(0, object.data);
-		};
-		testBounds = TestFixture::createBounds(0, -2, 0, 2, 0, 0);
-		EXPECT_EQ(1U, dsBVH_intersect(bvh, &testBounds, fixture->lambdaAdapter(testFunc),
-			&testFunc));
-	}
+	ray = TestFixture::createRay(3.0, -1.5, 0.0, -2.0, 0.0, 0.0);
+	EXPECT_TRUE(dsBVH_intersectRay(&object, &t, bvh, &ray, DBL_MAX, false, nullptr, nullptr));
+	EXPECT_EQ(data + 1, object);
+	EXPECT_EQ(0.5, t);
 
-	{
-		auto testFunc = [](const TestObject& object)
-		{
-			EXPECT_EQ(3, object.data);
-		};
-		testBounds = TestFixture::createBounds(-2, 0, 0, 0, 2, 0);
-		EXPECT_EQ(1U, dsBVH_intersect(bvh, &testBounds, fixture->lambdaAdapter(testFunc),
-			&testFunc));
-	}
+	ray = TestFixture::createRay(1.5, 1.5, 0.0, 0.0, -1.0, 0.0);
+	EXPECT_TRUE(dsBVH_intersectRay(&object, &t, bvh, &ray, DBL_MAX, false, nullptr, nullptr));
+	EXPECT_EQ(data + 3, object);
+	EXPECT_EQ(0.0, t);
 
-	{
-		auto testFunc = [](const TestObject& object)
-		{
-			EXPECT_EQ(2, object.data);
-		};
+	ray = TestFixture::createRay(0.0, 0.0, 0.0, 1.0, 1.0, 0.0);
+	EXPECT_TRUE(dsBVH_intersectRay(&object, &t, bvh, &ray, DBL_MAX, false, nullptr, nullptr));
+	EXPECT_EQ(data + 3, object);
+	EXPECT_EQ(1.0, t);
+
+	ray = TestFixture::createRay(0.0, 0.0, 0.0, 1.0, 0.0, 0.0);
+	EXPECT_FALSE(dsBVH_intersectRay(&object, &t, bvh, &ray, DBL_MAX, false, nullptr, nullptr));
+
+	dsBVH_destroy(bvh);
+}
+
+TYPED_TEST(BVHTest, Nearest)
+{
+	using TestObject = typename TestFixture::TestObject;
+	using VectorType = typename TestFixture::VectorType;
+
+	TestFixture* fixture = this;
+	dsBVH* bvh = dsBVH_create((dsAllocator*)&fixture->allocator, TestFixture::axisCount(),
+		TestFixture::element(), NULL);
+	ASSERT_TRUE(bvh);
+
+	VectorType point = TestFixture::createPoint(3, 3, 0);
+	EXPECT_FALSE(dsBVH_nearest(nullptr, nullptr, bvh, &point, DBL_MAX, nullptr, nullptr));
+
+	TestObject data[] =
+	{
+		{TestFixture::createBounds(-2, -2, 0, -1, -1, 0), 0},
+		{TestFixture::createBounds( 1, -2, 0,  2, -1, 0), 1},
+		{TestFixture::createBounds(-2,  1, 0, -1,  2, 0), 2},
+		{TestFixture::createBounds( 1,  1, 0,  2,  2, 0), 3}
+	};
+
+	EXPECT_TRUE(dsBVH_build(bvh, data, DS_ARRAY_SIZE(data), sizeof(TestObject),
+		&TestFixture::getBounds, false));
+
+	const void* object = nullptr;
+	double distance = 0.0;
+	EXPECT_TRUE(dsBVH_nearest(&object, &distance, bvh, &point, DBL_MAX, nullptr, nullptr));
+	EXPECT_EQ(data + 3, object);
+	EXPECT_DOUBLE_EQ(std::sqrt(2.0), distance);
+
+	EXPECT_FALSE(dsBVH_nearest(&object, &distance, bvh, &point, 1.0, nullptr, nullptr));
+
+	point = TestFixture::createPoint(-4, -1, 0);
+	EXPECT_TRUE(dsBVH_nearest(&object, &distance, bvh, &point, DBL_MAX, nullptr, nullptr));
+	EXPECT_EQ(data + 0, object);
+	EXPECT_EQ(2.0, distance);
+
+	point = TestFixture::createPoint(-1, 2, 0);
+	EXPECT_TRUE(dsBVH_nearest(&object, &distance, bvh, &point, DBL_MAX, nullptr, nullptr));
+	EXPECT_EQ(data + 2, object);
+	EXPECT_EQ(0.0, distance);
+
+	dsBVH_destroy(bvh);
+}
+
+TYPED_TEST(BVHTest, Update)
+{
+	using TestObject = typename TestFixture::TestObject;
+	using AlignedBoxType = typename TestFixture::AlignedBoxType;
+
+	TestFixture* fixture = this;
+	dsBVH* bvh = dsBVH_create((dsAllocator*)&fixture->allocator, TestFixture::axisCount(),
+		TestFixture::element(), NULL);
+	ASSERT_TRUE(bvh);
+
+	TestObject data[] =
+	{
+		{TestFixture::createBounds(-2, -2, 0, -1, -1, 0), 0},
+		{TestFixture::createBounds( 1, -2, 0,  2, -1, 0), 1},
+		{TestFixture::createBounds(-2,  1, 0, -1,  2, 0), 2},
+		{TestFixture::createBounds( 1,  1, 0,  2,  2, 0), 3}
+	};
+
+	EXPECT_TRUE(dsBVH_build(bvh, data, DS_ARRAY_SIZE(data), sizeof(TestObject),
+		&TestFixture::getBounds, false));
+
+	std::swap(data[0].bounds, data[1].bounds);
+	std::swap(data[2].bounds, data[3].bounds);
+	EXPECT_TRUE(dsBVH_update(bvh));
+
+	AlignedBoxType testBounds = TestFixture::createBounds(0, 0, 0, 0, 0, 0);
+	EXPECT_EQ(0U, dsBVH_intersect(bvh, &testBounds, nullptr, nullptr));
+
+	{
+		auto testFunc = [](const TestObject& object)
+		{
+			EXPECT_EQ(1, object.data);
+		};
+		testBounds = TestFixture::createBounds(-2, -2, 0, 0, 0, 0);
+		EXPECT_EQ(1U, dsBVH_intersect(bvh, &testBounds, fixture->lambdaAdapter(testFunc),
+			&testFunc));
+	}
+
+	{
+		auto testFunc = [](const TestObject& object)
+		{
+			EXPECT_EQ(0, object.data);
+		};
+		testBounds = TestFixture::createBounds(0, -2, 0, 2, 0, 0);
+		EXPECT_EQ(1U, dsBVH_intersect(bvh, &testBounds, fixture->lambdaAdapter(testFunc),
+			&testFunc));
+	}
+
+	{
+		auto testFunc = [](const TestObject& object)
+		{
+			EXPECT_EQ(3, object.data);
+		};
+		testBounds = TestFixture::createBounds(-2, 0, 0, 0, 2, 0);
+		EXPECT_EQ(1U, dsBVH_intersect(bvh, &testBounds, fixture->lambdaAdapter(testFunc),
+			&testFunc));
+	}
+
+	{
+		auto testFunc = [](const TestObject& object)
+		{
+			EXPECT_EQ(2, object.data);
+		};
 		testBounds = TestFixture::createBounds(0, 0, 0, 2, 2, 0);
 		EXPECT_EQ(1U, dsBVH_intersect(bvh, &testBounds, fixture->lambdaAdapter(testFunc),
 			&testFunc));
@@ -840,3 +1232,932 @@ TYPED_TEST(BVHTest, Update)
 
 	dsBVH_destroy(bvh);
 }
+
+class BVHFrustumTest : public testing::Test
+{
+public:
+	void SetUp() override
+	{
+		ASSERT_TRUE(dsSystemAllocator_initialize(&allocator, DS_ALLOCATOR_NO_LIMIT));
+	}
+
+	void TearDown() override
+	{
+		EXPECT_EQ(0U, ((dsAllocator*)&allocator)->size);
+	}
+
+	static bool getBounds(void* outBounds, const dsBVH* bvh, const void* object)
+	{
+		auto boxes = (const dsAlignedBox3f*)dsBVH_getUserData(bvh);
+		*((dsAlignedBox3f*)outBounds) = boxes[(size_t)object];
+		return true;
+	}
+
+	static bool markVisible(void* userData, const dsBVH*, const void* object, const void*)
+	{
+		auto visible = (std::vector<bool>*)userData;
+		EXPECT_FALSE((*visible)[(size_t)object]);
+		(*visible)[(size_t)object] = true;
+		return true;
+	}
+
+	static bool limitedVisits(void* userData, const dsBVH*, const void*, const void*)
+	{
+		auto* counts = reinterpret_cast<std::pair<int, int>*>(userData);
+		return ++counts->first < counts->second;
+	}
+
+	dsSystemAllocator allocator;
+};
+
+TEST_F(BVHFrustumTest, IntersectFrustum)
+{
+	const unsigned int gridSize = 16;
+	std::vector<dsAlignedBox3f> boxes;
+	for (unsigned int y = 0; y < gridSize; ++y)
+	{
+		for (unsigned int x = 0; x < gridSize; ++x)
+		{
+			dsAlignedBox3f box = {{{(float)x, (float)y, -2.0f}},
+				{{(float)x + 0.5f, (float)y + 0.5f, -1.0f}}};
+			boxes.push_back(box);
+		}
+	}
+
+	dsBVH* bvh = dsBVH_create((dsAllocator*)&allocator, 3, dsGeometryElement_Float,
+		boxes.data());
+	ASSERT_TRUE(bvh);
+	ASSERT_TRUE(dsBVH_build(bvh, NULL, (uint32_t)boxes.size(), DS_GEOMETRY_OBJECT_INDICES,
+		&getBounds, true));
+
+	dsMatrix44f projection;
+	dsMatrix44f_makeOrtho(&projection, 2.75f, 9.25f, 3.75f, 7.25f, 0.0f, 10.0f, false, false);
+	dsFrustum3f frustum;
+	dsFrustum3_fromMatrix(frustum, projection, false, false);
+
+	std::vector<bool> visible(boxes.size());
+	uint32_t expectedCount = 0;
+	for (const dsAlignedBox3f& box : boxes)
+	{
+		if (dsFrustum3f_intersectAlignedBox(&frustum, &box) != dsIntersectResult_Outside)
+			++expectedCount;
+	}
+
+	// Columns 3-9 and rows 4-7.
+	EXPECT_EQ(28U, expectedCount);
+	EXPECT_EQ(expectedCount, dsBVH_intersectFrustum(bvh, &frustum, &markVisible, &visible));
+	for (uint32_t i = 0; i < boxes.size(); ++i)
+	{
+		EXPECT_EQ(dsFrustum3f_intersectAlignedBox(&frustum, &boxes[i]) !=
+			dsIntersectResult_Outside, visible[i]) << i;
+	}
+
+	std::pair<int, int> visitCounts = {0, 5};
+	EXPECT_EQ(5U, dsBVH_intersectFrustum(bvh, &frustum, &limitedVisits, &visitCounts));
+
+	// Frustum containing everything should visit everything.
+	dsMatrix44f_makeOrtho(&projection, -1.0f, 17.0f, -1.0f, 17.0f, 0.0f, 10.0f, false, false);
+	dsFrustum3_fromMatrix(frustum, projection, false, false);
+	EXPECT_EQ(boxes.size(), dsBVH_intersectFrustum(bvh, &frustum, nullptr, nullptr));
+
+	dsBVH_destroy(bvh);
+
+	bvh = dsBVH_create((dsAllocator*)&allocator, 2, dsGeometryElement_Float, nullptr);
+	ASSERT_TRUE(bvh);
+	EXPECT_EQ(0U, dsBVH_intersectFrustum(bvh, &frustum, nullptr, nullptr));
+	dsBVH_destroy(bvh);
+}
+
+class BVHSAHTest : public testing::Test
+{
+public:
+	void SetUp() override
+	{
+		ASSERT_TRUE(dsSystemAllocator_initialize(&allocator, DS_ALLOCATOR_NO_LIMIT));
+	}
+
+	void TearDown() override
+	{
+		EXPECT_EQ(0U, ((dsAllocator*)&allocator)->size);
+	}
+
+	static bool getBounds(void* outBounds, const dsBVH* bvh, const void* object)
+	{
+		auto boxes = (const dsAlignedBox3f*)dsBVH_getUserData(bvh);
+		*((dsAlignedBox3f*)outBounds) = boxes[(size_t)object];
+		return true;
+	}
+
+	static bool markVisited(void* userData, const dsBVH*, const void* object, const void*)
+	{
+		auto visited = (std::vector<bool>*)userData;
+		EXPECT_FALSE((*visited)[(size_t)object]);
+		(*visited)[(size_t)object] = true;
+		return true;
+	}
+
+	static std::vector<dsAlignedBox3f> createRandomBoxes(uint32_t count, float extent,
+		float maxSize)
+	{
+		std::mt19937 random(1234);
+		std::uniform_real_distribution<float> positionDist(-extent, extent);
+		std::uniform_real_distribution<float> sizeDist(0.0f, maxSize);
+		std::vector<dsAlignedBox3f> boxes(count);
+		for (dsAlignedBox3f& box : boxes)
+		{
+			box.min.x = positionDist(random);
+			box.min.y = positionDist(random);
+			box.min.z = positionDist(random);
+			box.max.x = box.min.x + sizeDist(random);
+			box.max.y = box.min.y + sizeDist(random);
+			box.max.z = box.min.z + sizeDist(random);
+		}
+
+		return boxes;
+	}
+
+	void checkQueries(const dsBVH* bvh, const std::vector<dsAlignedBox3f>& boxes,
+		const std::vector<bool>* present = nullptr)
+	{
+		std::mt19937 random(5678);
+		std::uniform_real_distribution<float> positionDist(-100.0f, 100.0f);
+		for (unsigned int i = 0; i < 16; ++i)
+		{
+			dsAlignedBox3f testBounds;
+			testBounds.min.x = positionDist(random);
+			testBounds.min.y = positionDist(random);
+			testBounds.min.z = positionDist(random);
+			testBounds.max.x = testBounds.min.x + 20.0f;
+			testBounds.max.y = testBounds.min.y + 20.0f;
+			testBounds.max.z = testBounds.min.z + 20.0f;
+
+			std::vector<bool> visited(boxes.size());
+			uint32_t count = dsBVH_intersect(bvh, &testBounds, &markVisited, &visited);
+			uint32_t expectedCount = 0;
+			for (uint32_t j = 0; j < boxes.size(); ++j)
+			{
+				bool intersects = dsAlignedBox3_intersects(testBounds, boxes[j]) &&
+					(!present || (*present)[j]);
+				if (intersects)
+					++expectedCount;
+				EXPECT_EQ(intersects, visited[j]) << j;
+			}
+			EXPECT_EQ(expectedCount, count);
+		}
+	}
+
+	static bool limitedVisits(void* userData, const dsBVH*, const void*, const void*)
+	{
+		auto* counts = reinterpret_cast<std::pair<int, int>*>(userData);
+		return ++counts->first < counts->second;
+	}
+
+	static bool intersectRayBox(double& outT, const dsRay3f& ray, const dsAlignedBox3f& box,
+		double maxT)
+	{
+		double minT = 0.0;
+		for (unsigned int i = 0; i < 3; ++i)
+		{
+			double origin = ray.origin.values[i];
+			double direction = ray.direction.values[i];
+			if (direction == 0.0)
+			{
+				if (origin < box.min.values[i] || origin > box.max.values[i])
+					return false;
+				continue;
+			}
+
+			double t0 = (box.min.values[i] - origin)/direction;
+			double t1 = (box.max.values[i] - origin)/direction;
+			minT = std::max(minT, std::min(t0, t1));
+			maxT = std::min(maxT, std::max(t0, t1));
+			if (minT > maxT)
+				return false;
+		}
+
+		outT = minT;
+		return true;
+	}
+
+	static double boxDistance(const dsVector3f& point, const dsAlignedBox3f& box)
+	{
+		double distance2 = 0.0;
+		for (unsigned int i = 0; i < 3; ++i)
+		{
+			double offset = std::max(box.min.values[i] - point.values[i],
+				point.values[i] - box.max.values[i]);
+			if (offset > 0.0)
+				distance2 += offset*offset;
+		}
+		return std::sqrt(distance2);
+	}
+
+	// Only accepts odd objects to check that the callbacks are respected.
+	static bool intersectOddObjects(void* userData, const dsBVH*, const void* object,
+		const void* ray, double* outT)
+	{
+		if (((size_t)object & 1) == 0)
+			return false;
+
+		auto boxes = (const std::vector<dsAlignedBox3f>*)userData;
+		return intersectRayBox(*outT, *(const dsRay3f*)ray, (*boxes)[(size_t)object], DBL_MAX);
+	}
+
+	static bool oddObjectDistance(void* userData, const dsBVH*, const void* object,
+		const void* point, double* outDistance)
+	{
+		if (((size_t)object & 1) == 0)
+			return false;
+
+		auto boxes = (const std::vector<dsAlignedBox3f>*)userData;
+		*outDistance = boxDistance(*(const dsVector3f*)point, (*boxes)[(size_t)object]);
+		return true;
+	}
+
+	static std::vector<dsRay3f> createRandomRays(uint32_t count, float extent)
+	{
+		std::mt19937 random(9012);
+		std::uniform_real_distribution<float> positionDist(-extent, extent);
+		std::uniform_real_distribution<float> directionDist(-1.0f, 1.0f);
+		std::vector<dsRay3f> rays(count);
+		for (dsRay3f& ray : rays)
+		{
+			ray.origin.x = positionDist(random);
+			ray.origin.y = positionDist(random);
+			ray.origin.z = positionDist(random);
+			ray.direction.x = directionDist(random);
+			ray.direction.y = directionDist(random);
+			ray.direction.z = directionDist(random);
+		}
+
+		// Include axis-aligned rays to check the parallel cases.
+		rays[0].direction.x = 0.0f;
+		rays[1].direction.x = rays[1].direction.y = 0.0f;
+		return rays;
+	}
+
+	void checkRayQueries(const dsBVH* bvh, const std::vector<dsAlignedBox3f>& boxes)
+	{
+		for (const dsRay3f& ray : createRandomRays(64, 120.0f))
+		{
+			double expectedT = DBL_MAX;
+			double expectedOddT = DBL_MAX;
+			for (size_t i = 0; i < boxes.size(); ++i)
+			{
+				double t;
+				if (!intersectRayBox(t, ray, boxes[i], DBL_MAX))
+					continue;
+
+				expectedT = std::min(expectedT, t);
+				if (i & 1)
+					expectedOddT = std::min(expectedOddT, t);
+			}
+
+			const void* object = nullptr;
+			double t = 0.0;
+			bool hit = dsBVH_intersectRay(&object, &t, bvh, &ray, DBL_MAX, false, nullptr,
+				nullptr);
+			EXPECT_EQ(expectedT != DBL_MAX, hit);
+			if (hit)
+			{
+				EXPECT_DOUBLE_EQ(expectedT, t);
+				double objectT;
+				EXPECT_TRUE(intersectRayBox(objectT, ray, boxes[(size_t)object], DBL_MAX));
+				EXPECT_DOUBLE_EQ(expectedT, objectT);
+			}
+
+			EXPECT_EQ(hit, dsBVH_intersectRay(&object, &t, bvh, &ray, DBL_MAX, true, nullptr,
+				nullptr));
+
+			hit = dsBVH_intersectRay(&object, &t, bvh, &ray, DBL_MAX, false,
+				&intersectOddObjects, const_cast<std::vector<dsAlignedBox3f>*>(&boxes));
+			EXPECT_EQ(expectedOddT != DBL_MAX, hit);
+			if (hit)
+			{
+				EXPECT_DOUBLE_EQ(expectedOddT, t);
+				EXPECT_EQ(1U, (size_t)object & 1);
+			}
+		}
+	}
+
+	void checkNearestQueries(const dsBVH* bvh, const std::vector<dsAlignedBox3f>& boxes)
+	{
+		std::mt19937 random(3456);
+		std::uniform_real_distribution<float> positionDist(-120.0f, 120.0f);
+		for (unsigned int i = 0; i < 64; ++i)
+		{
+			dsVector3f point = {{positionDist(random), positionDist(random),
+				positionDist(random)}};
+
+			double expectedDistance = DBL_MAX;
+			double expectedOddDistance = DBL_MAX;
+			for (size_t j = 0; j < boxes.size(); ++j)
+			{
+				double distance = boxDistance(point, boxes[j]);
+				expectedDistance = std::min(expectedDistance, distance);
+				if (j & 1)
+					expectedOddDistance = std::min(expectedOddDistance, distance);
+			}
+
+			const void* object = nullptr;
+			double distance = 0.0;
+			ASSERT_TRUE(dsBVH_nearest(&object, &distance, bvh, &point, DBL_MAX, nullptr,
+				nullptr));
+			EXPECT_DOUBLE_EQ(expectedDistance, distance);
+			EXPECT_DOUBLE_EQ(expectedDistance, boxDistance(point, boxes[(size_t)object]));
+
+			ASSERT_TRUE(dsBVH_nearest(&object, &distance, bvh, &point, DBL_MAX,
+				&oddObjectDistance, const_cast<std::vector<dsAlignedBox3f>*>(&boxes)));
+			EXPECT_DOUBLE_EQ(expectedOddDistance, distance);
+			EXPECT_EQ(1U, (size_t)object & 1);
+
+			EXPECT_EQ(expectedDistance <= 1.0, dsBVH_nearest(&object, &distance, bvh, &point,
+				1.0, nullptr, nullptr));
+		}
+	}
+
+	dsSystemAllocator allocator;
+};
+
+TEST_F(BVHSAHTest, InvalidArguments)
+{
+	dsBVH* bvh = dsBVH_create((dsAllocator*)&allocator, 3, dsGeometryElement_Float, nullptr);
+	ASSERT_TRUE(bvh);
+
+	errno = 0;
+	EXPECT_FALSE(dsBVH_buildSAH(nullptr, nullptr, 0, DS_GEOMETRY_OBJECT_INDICES, &getBounds,
+		nullptr));
+	EXPECT_EQ(EINVAL, errno);
+
+	errno = 0;
+	EXPECT_FALSE(dsBVH_buildSAH(bvh, nullptr, 1, sizeof(dsAlignedBox3f), &getBounds, nullptr));
+	EXPECT_EQ(EINVAL, errno);
+
+	errno = 0;
+	EXPECT_FALSE(dsBVH_buildSAH(bvh, nullptr, 1, DS_GEOMETRY_OBJECT_INDICES, nullptr, nullptr));
+	EXPECT_EQ(EINVAL, errno);
+
+	EXPECT_TRUE(dsBVH_buildSAH(bvh, nullptr, 0, DS_GEOMETRY_OBJECT_INDICES, &getBounds, nullptr));
+	dsAlignedBox3f bounds;
+	EXPECT_FALSE(dsBVH_getBounds(&bounds, bvh));
+
+	dsBVH_destroy(bvh);
+}
+
+TEST_F(BVHSAHTest, RandomBoxes)
+{
+	std::vector<dsAlignedBox3f> boxes = createRandomBoxes(20000, 100.0f, 5.0f);
+	dsBVH* bvh = dsBVH_create((dsAllocator*)&allocator, 3, dsGeometryElement_Float,
+		boxes.data());
+	ASSERT_TRUE(bvh);
+
+	ASSERT_TRUE(dsBVH_buildSAH(bvh, nullptr, (uint32_t)boxes.size(), DS_GEOMETRY_OBJECT_INDICES,
+		&getBounds, nullptr));
+	checkQueries(bvh, boxes);
+
+	dsAlignedBox3f bounds;
+	ASSERT_TRUE(dsBVH_getBounds(&bounds, bvh));
+	dsAlignedBox3f expectedBounds;
+	dsAlignedBox3f_makeInvalid(&expectedBounds);
+	for (const dsAlignedBox3f& box : boxes)
+		dsAlignedBox3f_addBox(&expectedBounds, &box);
+	EXPECT_EQ(0, memcmp(&expectedBounds, &bounds, sizeof(dsAlignedBox3f)));
+
+	dsThreadPool* threadPool = dsThreadPool_create((dsAllocator*)&allocator, 3, 0);
+	ASSERT_TRUE(threadPool);
+	ASSERT_TRUE(dsBVH_buildSAH(bvh, nullptr, (uint32_t)boxes.size(), DS_GEOMETRY_OBJECT_INDICES,
+		&getBounds, threadPool));
+	checkQueries(bvh, boxes);
+
+	ASSERT_TRUE(dsBVH_getBounds(&bounds, bvh));
+	EXPECT_EQ(0, memcmp(&expectedBounds, &bounds, sizeof(dsAlignedBox3f)));
+
+	// Update should work the same as with the other build functions.
+	for (dsAlignedBox3f& box : boxes)
+	{
+		box.min.x += 1.0f;
+		box.max.x += 1.0f;
+	}
+	EXPECT_TRUE(dsBVH_update(bvh));
+	checkQueries(bvh, boxes);
+
+	dsThreadPool_destroy(threadPool);
+	dsBVH_destroy(bvh);
+}
+
+TEST_F(BVHSAHTest, CoincidentBoxes)
+{
+	// All centroids are the same, so no split will be found.
+	std::vector<dsAlignedBox3f> boxes(100);
+	for (dsAlignedBox3f& box : boxes)
+	{
+		box.min.x = box.min.y = box.min.z = 0.0f;
+		box.max.x = box.max.y = box.max.z = 1.0f;
+	}
+
+	dsBVH* bvh = dsBVH_create((dsAllocator*)&allocator, 3, dsGeometryElement_Float,
+		boxes.data());
+	ASSERT_TRUE(bvh);
+	ASSERT_TRUE(dsBVH_buildSAH(bvh, nullptr, (uint32_t)boxes.size(), DS_GEOMETRY_OBJECT_INDICES,
+		&getBounds, nullptr));
+
+	dsAlignedBox3f testBounds = {{{0.5f, 0.5f, 0.5f}}, {{0.5f, 0.5f, 0.5f}}};
+	std::vector<bool> visited(boxes.size());
+	EXPECT_EQ(boxes.size(), dsBVH_intersect(bvh, &testBounds, &markVisited, &visited));
+
+	dsBVH_destroy(bvh);
+}
+
+TEST_F(BVHSAHTest, RayQueries)
+{
+	std::vector<dsAlignedBox3f> boxes = createRandomBoxes(5000, 100.0f, 5.0f);
+	dsBVH* bvh = dsBVH_create((dsAllocator*)&allocator, 3, dsGeometryElement_Float,
+		boxes.data());
+	ASSERT_TRUE(bvh);
+
+	ASSERT_TRUE(dsBVH_buildSAH(bvh, nullptr, (uint32_t)boxes.size(), DS_GEOMETRY_OBJECT_INDICES,
+		&getBounds, nullptr));
+	checkRayQueries(bvh, boxes);
+
+	// Unbalanced trees are much deeper.
+	ASSERT_TRUE(dsBVH_build(bvh, nullptr, (uint32_t)boxes.size(), DS_GEOMETRY_OBJECT_INDICES,
+		&getBounds, false));
+	checkRayQueries(bvh, boxes);
+
+	dsBVH_destroy(bvh);
+}
+
+TEST_F(BVHSAHTest, NearestQueries)
+{
+	std::vector<dsAlignedBox3f> boxes = createRandomBoxes(5000, 100.0f, 5.0f);
+	dsBVH* bvh = dsBVH_create((dsAllocator*)&allocator, 3, dsGeometryElement_Float,
+		boxes.data());
+	ASSERT_TRUE(bvh);
+
+	ASSERT_TRUE(dsBVH_buildSAH(bvh, nullptr, (uint32_t)boxes.size(), DS_GEOMETRY_OBJECT_INDICES,
+		&getBounds, nullptr));
+	checkNearestQueries(bvh, boxes);
+
+	ASSERT_TRUE(dsBVH_build(bvh, nullptr, (uint32_t)boxes.size(), DS_GEOMETRY_OBJECT_INDICES,
+		&getBounds, false));
+	checkNearestQueries(bvh, boxes);
+
+	dsBVH_destroy(bvh);
+}
+
+TEST_F(BVHSAHTest, DynamicInvalidArguments)
+{
+	std::vector<dsAlignedBox3f> boxes = createRandomBoxes(10, 100.0f, 5.0f);
+	dsBVH* bvh = dsBVH_create((dsAllocator*)&allocator, 3, dsGeometryElement_Float,
+		boxes.data());
+	ASSERT_TRUE(bvh);
+
+	errno = 0;
+	EXPECT_FALSE(dsBVH_insert(nullptr, (void*)(size_t)0));
+	EXPECT_EQ(EINVAL, errno);
+
+	errno = 0;
+	EXPECT_FALSE(dsBVH_insert(bvh, (void*)(size_t)0));
+	EXPECT_EQ(EPERM, errno);
+
+	ASSERT_TRUE(dsBVH_buildSAH(bvh, nullptr, 5, DS_GEOMETRY_OBJECT_INDICES, &getBounds, nullptr));
+
+	errno = 0;
+	EXPECT_FALSE(dsBVH_insert(bvh, (void*)(size_t)2));
+	EXPECT_EQ(EPERM, errno);
+
+	errno = 0;
+	EXPECT_FALSE(dsBVH_remove(bvh, (void*)(size_t)7));
+	EXPECT_EQ(ENOTFOUND, errno);
+
+	errno = 0;
+	EXPECT_FALSE(dsBVH_markDirty(bvh, (void*)(size_t)7));
+	EXPECT_EQ(ENOTFOUND, errno);
+
+	errno = 0;
+	EXPECT_FALSE(dsBVH_updateDirty(nullptr, 1.5f));
+	EXPECT_EQ(EINVAL, errno);
+
+	EXPECT_TRUE(dsBVH_updateDirty(bvh, 1.5f));
+	dsBVH_destroy(bvh);
+}
+
+TEST_F(BVHSAHTest, UpdateDirty)
+{
+	std::vector<dsAlignedBox3f> boxes = createRandomBoxes(5000, 100.0f, 5.0f);
+	dsBVH* bvh = dsBVH_create((dsAllocator*)&allocator, 3, dsGeometryElement_Float,
+		boxes.data());
+	ASSERT_TRUE(bvh);
+	EXPECT_TRUE(dsBVH_setUseWideNodes(bvh, true));
+
+	ASSERT_TRUE(dsBVH_buildSAH(bvh, nullptr, (uint32_t)boxes.size(), DS_GEOMETRY_OBJECT_INDICES,
+		&getBounds, nullptr));
+
+	// Move a subset of the objects far enough to degrade the tree.
+	std::mt19937 random(7890);
+	std::uniform_real_distribution<float> offsetDist(-50.0f, 50.0f);
+	for (unsigned int frame = 0; frame < 8; ++frame)
+	{
+		for (size_t i = frame; i < boxes.size(); i += 8)
+		{
+			dsVector3f offset = {{offsetDist(random), offsetDist(random), offsetDist(random)}};
+			dsVector3_add(boxes[i].min, boxes[i].min, offset);
+			dsVector3_add(boxes[i].max, boxes[i].max, offset);
+			ASSERT_TRUE(dsBVH_markDirty(bvh, (void*)i));
+		}
+
+		// Marking twice is fine.
+		ASSERT_TRUE(dsBVH_markDirty(bvh, (void*)(size_t)frame));
+		ASSERT_TRUE(dsBVH_updateDirty(bvh, frame & 1 ? 1.5f : 0.0f));
+		checkQueries(bvh, boxes);
+		checkRayQueries(bvh, boxes);
+
+		dsAlignedBox3f bounds;
+		ASSERT_TRUE(dsBVH_getBounds(&bounds, bvh));
+		dsAlignedBox3f expectedBounds;
+		dsAlignedBox3f_makeInvalid(&expectedBounds);
+		for (const dsAlignedBox3f& box : boxes)
+			dsAlignedBox3f_addBox(&expectedBounds, &box);
+		EXPECT_EQ(0, memcmp(&expectedBounds, &bounds, sizeof(dsAlignedBox3f)));
+	}
+
+	// Full updates should keep the incremental data in sync.
+	for (dsAlignedBox3f& box : boxes)
+	{
+		box.min.x += 1.0f;
+		box.max.x += 1.0f;
+	}
+	EXPECT_TRUE(dsBVH_update(bvh));
+	ASSERT_TRUE(dsBVH_markDirty(bvh, (void*)(size_t)0));
+	EXPECT_TRUE(dsBVH_updateDirty(bvh, 1.5f));
+	checkQueries(bvh, boxes);
+
+	dsBVH_destroy(bvh);
+}
+
+TEST_F(BVHSAHTest, InsertRemove)
+{
+	std::vector<dsAlignedBox3f> boxes = createRandomBoxes(4000, 100.0f, 5.0f);
+	dsBVH* bvh = dsBVH_create((dsAllocator*)&allocator, 3, dsGeometryElement_Float,
+		boxes.data());
+	ASSERT_TRUE(bvh);
+	EXPECT_TRUE(dsBVH_setUseWideNodes(bvh, true));
+
+	// Start from an empty BVH.
+	ASSERT_TRUE(dsBVH_buildSAH(bvh, nullptr, 0, DS_GEOMETRY_OBJECT_INDICES, &getBounds, nullptr));
+	std::vector<bool> present(boxes.size());
+	for (size_t i = 0; i < boxes.size()/2; ++i)
+		ASSERT_TRUE(dsBVH_insert(bvh, (void*)i));
+
+	// Insertions aren't applied until updating.
+	checkQueries(bvh, boxes, &present);
+
+	ASSERT_TRUE(dsBVH_updateDirty(bvh, 1.5f));
+	for (size_t i = 0; i < boxes.size()/2; ++i)
+		present[i] = true;
+	checkQueries(bvh, boxes, &present);
+
+	// Insert the rest while removing some of the existing objects, with some objects moving.
+	for (size_t i = boxes.size()/2; i < boxes.size(); ++i)
+	{
+		ASSERT_TRUE(dsBVH_insert(bvh, (void*)i));
+		present[i] = true;
+
+		size_t removeIndex = i - boxes.size()/2;
+		if (removeIndex % 3 == 0)
+		{
+			ASSERT_TRUE(dsBVH_remove(bvh, (void*)removeIndex));
+			present[removeIndex] = false;
+		}
+		else if (removeIndex % 3 == 1)
+		{
+			boxes[removeIndex].min.y += 10.0f;
+			boxes[removeIndex].max.y += 10.0f;
+			ASSERT_TRUE(dsBVH_markDirty(bvh, (void*)removeIndex));
+		}
+
+		if (i % 500 == 0)
+		{
+			ASSERT_TRUE(dsBVH_updateDirty(bvh, 1.5f));
+			checkQueries(bvh, boxes, &present);
+		}
+	}
+
+	ASSERT_TRUE(dsBVH_updateDirty(bvh, 1.5f));
+	checkQueries(bvh, boxes, &present);
+
+	errno = 0;
+	EXPECT_FALSE(dsBVH_remove(bvh, (void*)(size_t)0));
+	EXPECT_EQ(ENOTFOUND, errno);
+
+	// Pending changes to the same object cancel out.
+	ASSERT_TRUE(dsBVH_remove(bvh, (void*)(size_t)1));
+	errno = 0;
+	EXPECT_FALSE(dsBVH_markDirty(bvh, (void*)(size_t)1));
+	EXPECT_EQ(ENOTFOUND, errno);
+	ASSERT_TRUE(dsBVH_insert(bvh, (void*)(size_t)1));
+	errno = 0;
+	EXPECT_FALSE(dsBVH_insert(bvh, (void*)(size_t)1));
+	EXPECT_EQ(EPERM, errno);
+
+	ASSERT_TRUE(dsBVH_insert(bvh, (void*)(size_t)0));
+	errno = 0;
+	EXPECT_FALSE(dsBVH_insert(bvh, (void*)(size_t)0));
+	EXPECT_EQ(EPERM, errno);
+	EXPECT_TRUE(dsBVH_markDirty(bvh, (void*)(size_t)0));
+	ASSERT_TRUE(dsBVH_remove(bvh, (void*)(size_t)0));
+	ASSERT_TRUE(dsBVH_insert(bvh, (void*)(size_t)0));
+	ASSERT_TRUE(dsBVH_remove(bvh, (void*)(size_t)0));
+
+	ASSERT_TRUE(dsBVH_updateDirty(bvh, 1.5f));
+	checkQueries(bvh, boxes, &present);
+
+	// Remove everything that's left.
+	for (size_t i = 0; i < boxes.size(); ++i)
+	{
+		if (!present[i])
+			continue;
+
+		ASSERT_TRUE(dsBVH_remove(bvh, (void*)i));
+		present[i] = false;
+		if (i % 700 == 0)
+		{
+			ASSERT_TRUE(dsBVH_updateDirty(bvh, 0.0f));
+			checkQueries(bvh, boxes, &present);
+		}
+	}
+
+	dsAlignedBox3f bounds;
+	EXPECT_TRUE(dsBVH_getBounds(&bounds, bvh));
+	EXPECT_TRUE(dsBVH_updateDirty(bvh, 1.5f));
+	EXPECT_FALSE(dsBVH_getBounds(&bounds, bvh));
+
+	ASSERT_TRUE(dsBVH_insert(bvh, (void*)(size_t)0));
+	EXPECT_FALSE(dsBVH_getBounds(&bounds, bvh));
+	EXPECT_TRUE(dsBVH_updateDirty(bvh, 1.5f));
+	ASSERT_TRUE(dsBVH_getBounds(&bounds, bvh));
+	EXPECT_EQ(0, memcmp(boxes.data(), &bounds, sizeof(dsAlignedBox3f)));
+
+	dsBVH_destroy(bvh);
+}
+
+TEST_F(BVHSAHTest, InsertSortedWithoutRebuild)
+{
+	// Inserting objects in order along a line one at a time pairs each with the root, which
+	// would create a tree as deep as the number of objects without limiting the depth.
+	std::vector<dsAlignedBox3f> boxes(1000);
+	for (size_t i = 0; i < boxes.size(); ++i)
+	{
+		float x = -100.0f + (float)i*0.2f;
+		boxes[i].min = {{x, -1.0f, -1.0f}};
+		boxes[i].max = {{x + 0.1f, 1.0f, 1.0f}};
+	}
+
+	dsBVH* bvh = dsBVH_create((dsAllocator*)&allocator, 3, dsGeometryElement_Float,
+		boxes.data());
+	ASSERT_TRUE(bvh);
+
+	ASSERT_TRUE(dsBVH_buildSAH(bvh, nullptr, 0, DS_GEOMETRY_OBJECT_INDICES, &getBounds, nullptr));
+	for (size_t i = 0; i < boxes.size(); ++i)
+	{
+		ASSERT_TRUE(dsBVH_insert(bvh, (void*)i));
+		ASSERT_TRUE(dsBVH_updateDirty(bvh, 0.0f));
+	}
+
+	checkQueries(bvh, boxes);
+	checkRayQueries(bvh, boxes);
+	checkNearestQueries(bvh, boxes);
+
+	dsBVH_destroy(bvh);
+}
+
+TEST_F(BVHSAHTest, WideNodes)
+{
+	std::vector<dsAlignedBox3f> boxes = createRandomBoxes(20000, 100.0f, 5.0f);
+	dsBVH* bvh = dsBVH_create((dsAllocator*)&allocator, 3, dsGeometryElement_Float,
+		boxes.data());
+	ASSERT_TRUE(bvh);
+
+	EXPECT_FALSE(dsBVH_getUseWideNodes(bvh));
+	EXPECT_TRUE(dsBVH_setUseWideNodes(bvh, true));
+	EXPECT_TRUE(dsBVH_getUseWideNodes(bvh));
+
+	ASSERT_TRUE(dsBVH_buildSAH(bvh, nullptr, (uint32_t)boxes.size(), DS_GEOMETRY_OBJECT_INDICES,
+		&getBounds, nullptr));
+	checkQueries(bvh, boxes);
+
+	dsAlignedBox3f testBounds = {{{-20.0f, -20.0f, -20.0f}}, {{20.0f, 20.0f, 20.0f}}};
+	std::pair<int, int> visitCounts = {0, 5};
+	EXPECT_EQ(5U, dsBVH_intersect(bvh, &testBounds, &limitedVisits, &visitCounts));
+
+	for (dsAlignedBox3f& box : boxes)
+	{
+		box.min.y -= 2.0f;
+		box.max.y -= 2.0f;
+	}
+	EXPECT_TRUE(dsBVH_update(bvh));
+	checkQueries(bvh, boxes);
+
+	// Other build functions should also create the wide nodes.
+	ASSERT_TRUE(dsBVH_build(bvh, nullptr, (uint32_t)boxes.size(), DS_GEOMETRY_OBJECT_INDICES,
+		&getBounds, true));
+	checkQueries(bvh, boxes);
+
+	// Enabling after building should create them from the current nodes.
+	EXPECT_TRUE(dsBVH_setUseWideNodes(bvh, false));
+	ASSERT_TRUE(dsBVH_build(bvh, nullptr, (uint32_t)boxes.size(), DS_GEOMETRY_OBJECT_INDICES,
+		&getBounds, false));
+	EXPECT_TRUE(dsBVH_setUseWideNodes(bvh, true));
+	checkQueries(bvh, boxes);
+
+	dsBVH_destroy(bvh);
+
+	bvh = dsBVH_create((dsAllocator*)&allocator, 3, dsGeometryElement_Double, nullptr);
+	ASSERT_TRUE(bvh);
+	errno = 0;
+	EXPECT_FALSE(dsBVH_setUseWideNodes(bvh, true));
+	EXPECT_EQ(EPERM, errno);
+	EXPECT_FALSE(dsBVH_getUseWideNodes(bvh));
+	dsBVH_destroy(bvh);
+}
+
+TEST_F(BVHSAHTest, WideNodes2D)
+{
+	std::mt19937 random(1234);
+	std::uniform_real_distribution<float> positionDist(-100.0f, 100.0f);
+	std::uniform_real_distribution<float> sizeDist(0.0f, 5.0f);
+	std::vector<dsAlignedBox2f> boxes(5000);
+	for (dsAlignedBox2f& box : boxes)
+	{
+		box.min.x = positionDist(random);
+		box.min.y = positionDist(random);
+		box.max.x = box.min.x + sizeDist(random);
+		box.max.y = box.min.y + sizeDist(random);
+	}
+
+	auto getBounds2D = [](void* outBounds, const dsBVH* bvh, const void* object) -> bool
+	{
+		auto boxes = (const dsAlignedBox2f*)dsBVH_getUserData(bvh);
+		*((dsAlignedBox2f*)outBounds) = boxes[(size_t)object];
+		return true;
+	};
+
+	dsBVH* bvh = dsBVH_create((dsAllocator*)&allocator, 2, dsGeometryElement_Float,
+		boxes.data());
+	ASSERT_TRUE(bvh);
+	EXPECT_TRUE(dsBVH_setUseWideNodes(bvh, true));
+	ASSERT_TRUE(dsBVH_buildSAH(bvh, nullptr, (uint32_t)boxes.size(), DS_GEOMETRY_OBJECT_INDICES,
+		getBounds2D, nullptr));
+
+	for (unsigned int i = 0; i < 16; ++i)
+	{
+		dsAlignedBox2f testBounds;
+		testBounds.min.x = positionDist(random);
+		testBounds.min.y = positionDist(random);
+		testBounds.max.x = testBounds.min.x + 20.0f;
+		testBounds.max.y = testBounds.min.y + 20.0f;
+
+		std::vector<bool> visited(boxes.size());
+		uint32_t count = dsBVH_intersect(bvh, &testBounds, &markVisited, &visited);
+		uint32_t expectedCount = 0;
+		for (uint32_t j = 0; j < boxes.size(); ++j)
+		{
+			bool intersects = dsAlignedBox2_intersects(testBounds, boxes[j]);
+			if (intersects)
+				++expectedCount;
+			EXPECT_EQ(intersects, visited[j]) << j;
+		}
+		EXPECT_EQ(expectedCount, count);
+	}
+
+	dsBVH_destroy(bvh);
+}
+
+TEST_F(BVHSAHTest, DISABLED_BVHIntersectBenchmark)
+{
+	dsThreadPool* threadPool = dsThreadPool_create((dsAllocator*)&allocator,
+		dsThread_logicalCoreCount() - 1, 0);
+	ASSERT_TRUE(threadPool);
+
+	const uint32_t boxCount = 1000000;
+	std::vector<dsAlignedBox3f> boxes = createRandomBoxes(boxCount, 1000.0f, 5.0f);
+	dsBVH* bvh = dsBVH_create((dsAllocator*)&allocator, 3, dsGeometryElement_Float,
+		boxes.data());
+	ASSERT_TRUE(bvh);
+	ASSERT_TRUE(dsBVH_buildSAH(bvh, nullptr, boxCount, DS_GEOMETRY_OBJECT_INDICES, &getBounds,
+		threadPool));
+
+	std::mt19937 random(5678);
+	std::uniform_real_distribution<float> positionDist(-1000.0f, 1000.0f);
+	const unsigned int queryCount = 100000;
+	std::vector<dsAlignedBox3f> queries(queryCount);
+	for (dsAlignedBox3f& query : queries)
+	{
+		query.min.x = positionDist(random);
+		query.min.y = positionDist(random);
+		query.min.z = positionDist(random);
+		query.max.x = query.min.x + 20.0f;
+		query.max.y = query.min.y + 20.0f;
+		query.max.z = query.min.z + 20.0f;
+	}
+
+	dsTimer timer = dsTimer_create();
+	auto queryTime = [&](uint32_t& hitCount) -> double
+	{
+		hitCount = 0;
+		double start = dsTimer_time(timer);
+		for (const dsAlignedBox3f& query : queries)
+			hitCount += dsBVH_intersect(bvh, &query, nullptr, nullptr);
+		return dsTimer_time(timer) - start;
+	};
+
+	uint32_t binaryHits;
+	double binaryTime = queryTime(binaryHits);
+
+	double start = dsTimer_time(timer);
+	EXPECT_TRUE(dsBVH_setUseWideNodes(bvh, true));
+	double wideBuildTime = dsTimer_time(timer) - start;
+	uint32_t wideHits;
+	double wideTime = queryTime(wideHits);
+	EXPECT_EQ(binaryHits, wideHits);
+
+	// Times in microseconds.
+	RecordProperty("boxCount", (int)boxCount);
+	RecordProperty("queryCount", (int)queryCount);
+	RecordProperty("hitCount", (int)binaryHits);
+	RecordProperty("binaryNodeQuery", (int)(binaryTime*1000000.0));
+	RecordProperty("wideNodeQuery", (int)(wideTime*1000000.0));
+	RecordProperty("wideNodeCreate", (int)(wideBuildTime*1000000.0));
+
+	dsBVH_destroy(bvh);
+	dsThreadPool_destroy(threadPool);
+}
+
+TEST_F(BVHSAHTest, DISABLED_BVHBuildBenchmark)
+{
+	dsThreadPool* threadPool = dsThreadPool_create((dsAllocator*)&allocator,
+		dsThread_logicalCoreCount() - 1, 0);
+	ASSERT_TRUE(threadPool);
+
+	const uint32_t boxCount = 200000;
+	std::vector<dsAlignedBox3f> boxes = createRandomBoxes(boxCount, 1000.0f, 10.0f);
+	dsBVH* bvh = dsBVH_create((dsAllocator*)&allocator, 3, dsGeometryElement_Float,
+		boxes.data());
+	ASSERT_TRUE(bvh);
+
+	std::mt19937 random(5678);
+	std::uniform_real_distribution<float> positionDist(-1000.0f, 1000.0f);
+	const unsigned int queryCount = 10000;
+	std::vector<dsAlignedBox3f> queries(queryCount);
+	for (dsAlignedBox3f& query : queries)
+	{
+		query.min.x = positionDist(random);
+		query.min.y = positionDist(random);
+		query.min.z = positionDist(random);
+		query.max.x = query.min.x + 50.0f;
+		query.max.y = query.min.y + 50.0f;
+		query.max.z = query.min.z + 50.0f;
+	}
+
+	dsTimer timer = dsTimer_create();
+	auto queryTime = [&]() -> double
+	{
+		double start = dsTimer_time(timer);
+		for (const dsAlignedBox3f& query : queries)
+			dsBVH_intersect(bvh, &query, nullptr, nullptr);
+		return dsTimer_time(timer) - start;
+	};
+
+	// Unbalanced builds are excluded since queries are too slow with this many objects.
+	double start = dsTimer_time(timer);
+	ASSERT_TRUE(dsBVH_build(bvh, nullptr, boxCount, DS_GEOMETRY_OBJECT_INDICES, &getBounds,
+		true));
+	double balancedBuildTime = dsTimer_time(timer) - start;
+	double balancedQueryTime = queryTime();
+
+	start = dsTimer_time(timer);
+	ASSERT_TRUE(dsBVH_buildSAH(bvh, nullptr, boxCount, DS_GEOMETRY_OBJECT_INDICES, &getBounds,
+		nullptr));
+	double sahBuildTime = dsTimer_time(timer) - start;
+	double sahQueryTime = queryTime();
+
+	start = dsTimer_time(timer);
+	ASSERT_TRUE(dsBVH_buildSAH(bvh, nullptr, boxCount, DS_GEOMETRY_OBJECT_INDICES, &getBounds,
+		threadPool));
+	double parallelBuildTime = dsTimer_time(timer) - start;
+	double parallelQueryTime = queryTime();
+
+	// Times in microseconds.
+	RecordProperty("boxCount", (int)boxCount);
+	RecordProperty("queryCount", (int)queryCount);
+	RecordProperty("threadCount", (int)dsThreadPool_getThreadCount(threadPool) + 1);
+	RecordProperty("balancedBuild", (int)(balancedBuildTime*1000000.0));
+	RecordProperty("balancedQuery", (int)(balancedQueryTime*1000000.0));
+	RecordProperty("sahBuild", (int)(sahBuildTime*1000000.0));
+	RecordProperty("sahQuery", (int)(sahQueryTime*1000000.0));
+	RecordProperty("parallelSAHBuild", (int)(parallelBuildTime*1000000.0));
+	RecordProperty("parallelSAHQuery", (int)(parallelQueryTime*1000000.0));
+
+	dsBVH_destroy(bvh);
+	dsThreadPool_destroy(threadPool);
+}
@@ -0,0 +1,260 @@
+/*
+ * Copyright 2020 Aaron Barany
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <DeepSea/Core/Memory/SystemAllocator.h>
+#include <DeepSea/Core/Timer.h>
+#include <DeepSea/Geometry/AlignedBox3.h>
+#include <DeepSea/Geometry/CullBoxArray.h>
+#include <DeepSea/Geometry/Frustum3.h>
+#include <DeepSea/Geometry/OrientedBox3.h>
+#include <DeepSea/Math/Core.h>
+#include <DeepSea/Math/Matrix44.h>
+#include <gtest/gtest.h>
+#include <random>
+#include <vector>
+
+namespace
+{
+
+struct TestBox
+{
+	dsOrientedBox3f box;
+	dsMatrix44f transform;
+};
+
+std::vector<TestBox> createRandomBoxes(uint32_t count)
+{
+	std::mt19937 random(1234);
+	std::uniform_real_distribution<float> position(-20.0f, 20.0f);
+	std::uniform_real_distribution<float> extent(0.1f, 3.0f);
+	std::uniform_real_distribution<float> angle(0.0f, (float)M_PI*2);
+	std::uniform_real_distribution<float> scale(0.5f, 2.0f);
+
+	std::vector<TestBox> boxes(count);
+	for (TestBox& testBox : boxes)
+	{
+		dsMatrix44f rotate;
+		dsMatrix44f_makeRotate(&rotate, angle(random), angle(random), angle(random));
+		for (int i = 0; i < 3; ++i)
+		{
+			for (int j = 0; j < 3; ++j)
+				testBox.box.orientation.values[i][j] = rotate.values[i][j];
+		}
+		testBox.box.center.x = position(random);
+		testBox.box.center.y = position(random);
+		testBox.box.center.z = position(random);
+		testBox.box.halfExtents.x = extent(random);
+		testBox.box.halfExtents.y = extent(random);
+		testBox.box.halfExtents.z = extent(random);
+
+		dsMatrix44f transformRotate, transformScale, transformTranslate, temp;
+		dsMatrix44f_makeRotate(&transformRotate, angle(random), angle(random), angle(random));
+		dsMatrix44f_makeScale(&transformScale, scale(random), scale(random), scale(random));
+		dsMatrix44f_makeTranslate(&transformTranslate, position(random), position(random),
+			position(random));
+		dsMatrix44_affineMul(temp, transformRotate, transformScale);
+		dsMatrix44_affineMul(testBox.transform, transformTranslate, temp);
+	}
+
+	return boxes;
+}
+
+dsFrustum3f createFrustum()
+{
+	dsMatrix44f projection;
+	dsMatrix44f_makePerspective(&projection, (float)dsDegreesToRadians(60.0f), 1.5f, 0.1f, 30.0f,
+		false, false);
+
+	dsFrustum3f frustum;
+	dsFrustum3_fromMatrix(frustum, projection, false, false);
+	dsFrustum3f_normalize(&frustum);
+	return frustum;
+}
+
+bool isVisible(const uint32_t* mask, uint32_t index)
+{
+	return (mask[index/DS_CULL_BOX_MASK_BITS] & (1U << (index % DS_CULL_BOX_MASK_BITS))) != 0;
+}
+
+} // namespace
+
+class CullBoxArrayTest : public testing::Test
+{
+public:
+	void SetUp() override
+	{
+		ASSERT_TRUE(dsSystemAllocator_initialize(&allocator, DS_ALLOCATOR_NO_LIMIT));
+	}
+
+	void TearDown() override
+	{
+		EXPECT_EQ(0U, ((dsAllocator*)&allocator)->size);
+	}
+
+	dsSystemAllocator allocator;
+};
+
+TEST_F(CullBoxArrayTest, Create)
+{
+	EXPECT_FALSE(dsCullBoxArray_create(nullptr, 10));
+
+	dsCullBoxArray* boxes = dsCullBoxArray_create((dsAllocator*)&allocator, 10);
+	ASSERT_TRUE(boxes);
+	EXPECT_EQ(10U, dsCullBoxArray_getBoxCount(boxes));
+
+	EXPECT_TRUE(dsCullBoxArray_setBoxCount(boxes, 100));
+	EXPECT_EQ(100U, dsCullBoxArray_getBoxCount(boxes));
+	EXPECT_TRUE(dsCullBoxArray_setBoxCount(boxes, 5));
+	EXPECT_EQ(5U, dsCullBoxArray_getBoxCount(boxes));
+
+	dsAlignedBox3f box = {{{-1.0f, -1.0f, -1.0f}}, {{1.0f, 1.0f, 1.0f}}};
+	EXPECT_TRUE(dsCullBoxArray_setAlignedBox(boxes, 4, &box, nullptr));
+	EXPECT_FALSE(dsCullBoxArray_setAlignedBox(boxes, 5, &box, nullptr));
+	EXPECT_FALSE(dsCullBoxArray_copyBox(boxes, 5, 4));
+	EXPECT_TRUE(dsCullBoxArray_copyBox(boxes, 0, 4));
+
+	dsAlignedBox3f invalidBox;
+	dsAlignedBox3f_makeInvalid(&invalidBox);
+	EXPECT_FALSE(dsCullBoxArray_setAlignedBox(boxes, 0, &invalidBox, nullptr));
+
+	dsCullBoxArray_destroy(boxes);
+}
+
+TEST_F(CullBoxArrayTest, IntersectFrustum)
+{
+	const uint32_t boxCount = 1000;
+	std::vector<TestBox> testBoxes = createRandomBoxes(boxCount);
+	dsFrustum3f frustum = createFrustum();
+
+	dsCullBoxArray* boxes = dsCullBoxArray_create((dsAllocator*)&allocator, boxCount);
+	ASSERT_TRUE(boxes);
+	for (uint32_t i = 0; i < boxCount; ++i)
+	{
+		EXPECT_TRUE(dsCullBoxArray_setOrientedBox(boxes, i, &testBoxes[i].box,
+			&testBoxes[i].transform));
+	}
+
+	std::vector<uint32_t> mask(DS_CULL_BOX_MASK_COUNT(boxCount));
+	uint32_t visibleCount = dsCullBoxArray_intersectFrustum(mask.data(), boxes, &frustum, 0,
+		boxCount);
+
+	uint32_t expectedVisibleCount = 0;
+	for (uint32_t i = 0; i < boxCount; ++i)
+	{
+		dsOrientedBox3f transformedBox = testBoxes[i].box;
+		ASSERT_TRUE(dsOrientedBox3f_transform(&transformedBox, &testBoxes[i].transform));
+		bool expectedVisible = dsFrustum3f_intersectOrientedBox(&frustum, &transformedBox) !=
+			dsIntersectResult_Outside;
+		EXPECT_EQ(expectedVisible, isVisible(mask.data(), i)) << i;
+		if (expectedVisible)
+			++expectedVisibleCount;
+	}
+
+	// Make sure the test is meaningful.
+	EXPECT_LT(0U, expectedVisibleCount);
+	EXPECT_GT(boxCount, expectedVisibleCount);
+	EXPECT_EQ(expectedVisibleCount, visibleCount);
+
+	dsCullBoxArray_destroy(boxes);
+}
+
+TEST_F(CullBoxArrayTest, IntersectFrustumRange)
+{
+	const uint32_t boxCount = 100;
+	dsFrustum3f frustum = createFrustum();
+	dsCullBoxArray* boxes = dsCullBoxArray_create((dsAllocator*)&allocator, boxCount);
+	ASSERT_TRUE(boxes);
+
+	// Alternate between in front of and behind the camera.
+	for (uint32_t i = 0; i < boxCount; ++i)
+	{
+		float z = i % 2 == 0 ? -5.0f : 5.0f;
+		dsAlignedBox3f box = {{{-1.0f, -1.0f, z - 1.0f}}, {{1.0f, 1.0f, z + 1.0f}}};
+		EXPECT_TRUE(dsCullBoxArray_setAlignedBox(boxes, i, &box, nullptr));
+	}
+
+	const uint32_t unchanged = 0xDEADBEEF;
+	uint32_t mask[DS_CULL_BOX_MASK_COUNT(boxCount)] = {unchanged, unchanged, unchanged,
+		unchanged};
+	EXPECT_FALSE(dsCullBoxArray_intersectFrustum(mask, boxes, &frustum, 1, 10));
+	EXPECT_FALSE(dsCullBoxArray_intersectFrustum(mask, boxes, &frustum, 64, 37));
+	EXPECT_EQ(unchanged, mask[2]);
+
+	EXPECT_EQ(18U, dsCullBoxArray_intersectFrustum(mask, boxes, &frustum, 64, 36));
+	EXPECT_EQ(unchanged, mask[0]);
+	EXPECT_EQ(unchanged, mask[1]);
+	EXPECT_EQ(0x55555555U, mask[2]);
+	EXPECT_EQ(0x5U, mask[3]);
+
+	EXPECT_TRUE(dsCullBoxArray_setInfinite(boxes, 65));
+	EXPECT_TRUE(dsCullBoxArray_copyBox(boxes, 98, 99));
+	EXPECT_EQ(18U, dsCullBoxArray_intersectFrustum(mask, boxes, &frustum, 64, 36));
+	EXPECT_EQ(0x55555557U, mask[2]);
+	EXPECT_EQ(0x1U, mask[3]);
+
+	dsCullBoxArray_destroy(boxes);
+}
+
+TEST_F(CullBoxArrayTest, DISABLED_IntersectFrustumBenchmark)
+{
+	const uint32_t boxCount = 1 << 20;
+	std::vector<TestBox> testBoxes = createRandomBoxes(boxCount);
+	dsFrustum3f frustum = createFrustum();
+
+	dsCullBoxArray* boxes = dsCullBoxArray_create((dsAllocator*)&allocator, boxCount);
+	ASSERT_TRUE(boxes);
+	std::vector<dsOrientedBox3f> transformedBoxes(boxCount);
+	for (uint32_t i = 0; i < boxCount; ++i)
+	{
+		EXPECT_TRUE(dsCullBoxArray_setOrientedBox(boxes, i, &testBoxes[i].box,
+			&testBoxes[i].transform));
+		transformedBoxes[i] = testBoxes[i].box;
+		dsOrientedBox3f_transform(&transformedBoxes[i], &testBoxes[i].transform);
+	}
+
+	std::vector<uint32_t> mask(DS_CULL_BOX_MASK_COUNT(boxCount));
+	std::vector<bool> culled(boxCount);
+	const unsigned int iterations = 10;
+	dsTimer timer = dsTimer_create();
+
+	uint32_t visibleCount = 0;
+	double start = dsTimer_time(timer);
+	for (unsigned int i = 0; i < iterations; ++i)
+	{
+		visibleCount = dsCullBoxArray_intersectFrustum(mask.data(), boxes, &frustum, 0,
+			boxCount);
+	}
+	double arrayTime = (dsTimer_time(timer) - start)/iterations;
+
+	start = dsTimer_time(timer);
+	for (unsigned int i = 0; i < iterations; ++i)
+	{
+		for (uint32_t j = 0; j < boxCount; ++j)
+		{
+			culled[j] = dsFrustum3f_intersectOrientedBox(&frustum, &transformedBoxes[j]) ==
+				dsIntersectResult_Outside;
+		}
+	}
+	double scalarTime = (dsTimer_time(timer) - start)/iterations;
+
+	// Average times in microseconds.
+	RecordProperty("boxCount", (int)boxCount);
+	RecordProperty("visibleCount", (int)visibleCount);
+	RecordProperty("cullBoxArray", (int)(arrayTime*1000000.0));
+	RecordProperty("dsFrustum3f_intersectOrientedBox", (int)(scalarTime*1000000.0));
+
+	dsCullBoxArray_destroy(boxes);
+}
@@ -14,12 +14,17 @@
  * limitations under the License.
  */
 
+#include <DeepSea/Core/Error.h>
 #include <DeepSea/Core/Memory/SystemAllocator.h>
 #include <DeepSea/Geometry/KdTree.h>
 #include <DeepSea/Math/Vector2.h>
 #include <DeepSea/Math/Vector3.h>
 #include <gtest/gtest.h>
+#include <algorithm>
+#include <cfloat>
 #include <cmath>
+#include <random>
+#include <vector>
 
 // Handle older versions of gtest.
 #ifndef TYPED_TEST_SUITE
@@ -236,6 +241,33 @@ public:
 		return &indexLambdaAdapterImpl<T>;
 	}
 
+	template <typename T>
+	static bool indexVisitAdapterImpl(void* userData, const dsKdTree* kdTree, const void* object,
+		const void* point, double distance)
+	{
+		auto objects = (const TestObject*)dsKdTree_getUserData(kdTree);
+		const auto& objectRef = objects[(size_t)object];
+		EXPECT_TRUE(dsVector2_equal(objectRef.point, *(const VectorType*)point));
+		return (*(T*)userData)(objectRef, distance);
+	}
+
+	template <typename T>
+	static dsKdTreeVisitFunction indexVisitAdapter(const T&)
+	{
+		return &indexVisitAdapterImpl<T>;
+	}
+
+	static double distance(const VectorType& left, const VectorType& right)
+	{
+		double distance2 = 0.0;
+		for (uint8_t i = 0; i < axisCount(); ++i)
+		{
+			double offset = (double)left.values[i] - (double)right.values[i];
+			distance2 += offset*offset;
+		}
+		return std::sqrt(distance2);
+	}
+
 	static uint32_t countElements(const dsKdTree* kdTree)
 	{
 		uint32_t elementCount = 0;
@@ -434,3 +466,236 @@ TYPED_TEST(KdTreeTest, ObjectIndices)
 
 	dsKdTree_destroy(kdTree);
 }
+
+TYPED_TEST(KdTreeTest, NearestNeighbors)
+{
+	using TestObject = typename TestFixture::TestObject;
+	using VectorType = typename TestFixture::VectorType;
+
+	TestFixture* fixture = this;
+	dsKdTree* kdTree = dsKdTree_create((dsAllocator*)&fixture->allocator, TestFixture::axisCount(),
+		TestFixture::element(), NULL);
+	ASSERT_TRUE(kdTree);
+
+	TestObject data[] =
+	{
+		{TestFixture::createPoint(-2, -2, -2), 0},
+		{TestFixture::createPoint(1, -2, 3), 1},
+		{TestFixture::createPoint(-1, 2, -3), 2},
+		{TestFixture::createPoint(1, 3, 3), 3},
+		{TestFixture::createPoint(-1, -2, 3), 4},
+		{TestFixture::createPoint(1, -3, -3), 5},
+		{TestFixture::createPoint(1, 2, -3), 6},
+		{TestFixture::createPoint(3, -2, 1), 7},
+		{TestFixture::createPoint(-3, 2, -1), 8},
+		{TestFixture::createPoint(2, -3, 1), 9},
+		{TestFixture::createPoint(-2, 3, -1), 10}
+	};
+
+	VectorType point = TestFixture::createPoint(0, 0, 0);
+	dsKdTreeNeighbor neighbors[DS_ARRAY_SIZE(data)];
+	errno = 0;
+	EXPECT_EQ(0U, dsKdTree_nearestNeighbors(NULL, 1, kdTree, &point, DBL_MAX, 0.0));
+	EXPECT_EQ(EINVAL, errno);
+	errno = 0;
+	EXPECT_EQ(0U, dsKdTree_nearestNeighbors(neighbors, 1, NULL, &point, DBL_MAX, 0.0));
+	EXPECT_EQ(EINVAL, errno);
+	errno = 0;
+	EXPECT_EQ(0U, dsKdTree_nearestNeighbors(neighbors, 1, kdTree, NULL, DBL_MAX, 0.0));
+	EXPECT_EQ(EINVAL, errno);
+	errno = 0;
+	EXPECT_EQ(0U, dsKdTree_nearestNeighbors(neighbors, 1, kdTree, &point, DBL_MAX, -1.0));
+	EXPECT_EQ(EINVAL, errno);
+
+	EXPECT_EQ(0U, dsKdTree_nearestNeighbors(neighbors, 1, kdTree, &point, DBL_MAX, 0.0));
+
+	EXPECT_TRUE(dsKdTree_build(kdTree, data, DS_ARRAY_SIZE(data), sizeof(TestObject),
+		&TestFixture::getPoint));
+
+	const int queryPoints[][3] =
+	{
+		{0, 0, 0}, {-2, -2, -2}, {3, 3, 3}, {-4, 1, 2}, {2, -1, -1}
+	};
+	const uint32_t neighborCounts[] = {1, 3, DS_ARRAY_SIZE(data)};
+	for (const int* queryPoint : queryPoints)
+	{
+		point = TestFixture::createPoint(queryPoint[0], queryPoint[1], queryPoint[2]);
+		std::vector<double> distances;
+		for (const TestObject& object : data)
+			distances.push_back(TestFixture::distance(point, object.point));
+		std::sort(distances.begin(), distances.end());
+
+		for (uint32_t neighborCount : neighborCounts)
+		{
+			ASSERT_EQ(neighborCount, dsKdTree_nearestNeighbors(neighbors, neighborCount, kdTree,
+				&point, DBL_MAX, 0.0));
+			for (uint32_t i = 0; i < neighborCount; ++i)
+			{
+				const TestObject* object = (const TestObject*)neighbors[i].object;
+				EXPECT_DOUBLE_EQ(distances[i], neighbors[i].distance);
+				EXPECT_DOUBLE_EQ(TestFixture::distance(point, object->point),
+					neighbors[i].distance);
+			}
+		}
+
+		// Limit the distance.
+		double maxDistance = 2.5;
+		uint32_t expectedCount = (uint32_t)(std::upper_bound(distances.begin(), distances.end(),
+			maxDistance) - distances.begin());
+		EXPECT_EQ(expectedCount, dsKdTree_nearestNeighbors(neighbors, DS_ARRAY_SIZE(data), kdTree,
+			&point, maxDistance, 0.0));
+		for (uint32_t i = 0; i < expectedCount; ++i)
+			EXPECT_DOUBLE_EQ(distances[i], neighbors[i].distance);
+
+		// Approximate results should be within the error bounds.
+		const double epsilon = 0.5;
+		ASSERT_EQ(3U, dsKdTree_nearestNeighbors(neighbors, 3, kdTree, &point, DBL_MAX, epsilon));
+		for (uint32_t i = 0; i < 3; ++i)
+			EXPECT_GE(distances[i]*(1.0 + epsilon) + 1e-9, neighbors[i].distance);
+	}
+
+	dsKdTree_destroy(kdTree);
+}
+
+TYPED_TEST(KdTreeTest, WithinRadius)
+{
+	using TestObject = typename TestFixture::TestObject;
+	using VectorType = typename TestFixture::VectorType;
+
+	TestObject data[] =
+	{
+		{TestFixture::createPoint(-2, -2, -2), 0},
+		{TestFixture::createPoint(1, -2, 3), 1},
+		{TestFixture::createPoint(-1, 2, -3), 2},
+		{TestFixture::createPoint(1, 3, 3), 3},
+		{TestFixture::createPoint(-1, -2, 3), 4},
+		{TestFixture::createPoint(1, -3, -3), 5},
+		{TestFixture::createPoint(1, 2, -3), 6},
+		{TestFixture::createPoint(3, -2, 1), 7},
+		{TestFixture::createPoint(-3, 2, -1), 8},
+		{TestFixture::createPoint(2, -3, 1), 9},
+		{TestFixture::createPoint(-2, 3, -1), 10}
+	};
+
+	TestFixture* fixture = this;
+	dsKdTree* kdTree = dsKdTree_create((dsAllocator*)&fixture->allocator, TestFixture::axisCount(),
+		TestFixture::element(), data);
+	ASSERT_TRUE(kdTree);
+
+	VectorType point = TestFixture::createPoint(0, 0, 0);
+	errno = 0;
+	EXPECT_EQ(0U, dsKdTree_withinRadius(NULL, &point, 2.0, NULL, NULL));
+	EXPECT_EQ(EINVAL, errno);
+	errno = 0;
+	EXPECT_EQ(0U, dsKdTree_withinRadius(kdTree, NULL, 2.0, NULL, NULL));
+	EXPECT_EQ(EINVAL, errno);
+
+	EXPECT_EQ(0U, dsKdTree_withinRadius(kdTree, &point, 2.0, NULL, NULL));
+
+	EXPECT_TRUE(dsKdTree_build(kdTree, NULL, DS_ARRAY_SIZE(data), DS_GEOMETRY_OBJECT_INDICES,
+		&TestFixture::getPointIndex));
+
+	const int queryPoints[][3] =
+	{
+		{0, 0, 0}, {-2, -2, -2}, {3, 3, 3}, {-4, 1, 2}, {2, -1, -1}
+	};
+	const double radii[] = {0.0, 1.0, 2.0, 3.5, 10.0};
+	for (const int* queryPoint : queryPoints)
+	{
+		point = TestFixture::createPoint(queryPoint[0], queryPoint[1], queryPoint[2]);
+		for (double radius : radii)
+		{
+			std::vector<int> expectedObjects;
+			for (const TestObject& object : data)
+			{
+				if (TestFixture::distance(point, object.point) <= radius)
+					expectedObjects.push_back(object.data);
+			}
+
+			std::vector<int> foundObjects;
+			auto visitFunc = [&](const TestObject& object, double distance)
+			{
+				EXPECT_DOUBLE_EQ(TestFixture::distance(point, object.point), distance);
+				foundObjects.push_back(object.data);
+				return true;
+			};
+			EXPECT_EQ(expectedObjects.size(), dsKdTree_withinRadius(kdTree, &point, radius,
+				TestFixture::indexVisitAdapter(visitFunc), &visitFunc));
+			std::sort(foundObjects.begin(), foundObjects.end());
+			EXPECT_EQ(expectedObjects, foundObjects);
+		}
+	}
+
+	// Stop early.
+	point = TestFixture::createPoint(0, 0, 0);
+	uint32_t visitCount = 0;
+	auto stopFunc = [&visitCount](const TestObject&, double)
+	{
+		++visitCount;
+		return false;
+	};
+	EXPECT_EQ(1U, dsKdTree_withinRadius(kdTree, &point, 10.0,
+		TestFixture::indexVisitAdapter(stopFunc), &stopFunc));
+	EXPECT_EQ(1U, visitCount);
+
+	dsKdTree_destroy(kdTree);
+}
+
+TYPED_TEST(KdTreeTest, RandomNearestNeighbors)
+{
+	using TestObject = typename TestFixture::TestObject;
+	using VectorType = typename TestFixture::VectorType;
+
+	TestFixture* fixture = this;
+	dsKdTree* kdTree = dsKdTree_create((dsAllocator*)&fixture->allocator, TestFixture::axisCount(),
+		TestFixture::element(), NULL);
+	ASSERT_TRUE(kdTree);
+
+	std::mt19937 random(42);
+	std::uniform_int_distribution<int> distribution(-100, 100);
+	std::vector<TestObject> data(1000);
+	for (size_t i = 0; i < data.size(); ++i)
+	{
+		data[i].point = TestFixture::createPoint(distribution(random), distribution(random),
+			distribution(random));
+		data[i].data = (int)i;
+	}
+
+	EXPECT_TRUE(dsKdTree_build(kdTree, data.data(), (uint32_t)data.size(), sizeof(TestObject),
+		&TestFixture::getPoint));
+	EXPECT_EQ(data.size(), TestFixture::countElements(kdTree));
+
+	const uint32_t neighborCount = 8;
+	const double epsilon = 0.25;
+	dsKdTreeNeighbor neighbors[neighborCount];
+	for (unsigned int i = 0; i < 50; ++i)
+	{
+		VectorType point = TestFixture::createPoint(distribution(random), distribution(random),
+			distribution(random));
+		std::vector<double> distances;
+		for (const TestObject& object : data)
+			distances.push_back(TestFixture::distance(point, object.point));
+		std::sort(distances.begin(), distances.end());
+
+		ASSERT_EQ(neighborCount, dsKdTree_nearestNeighbors(neighbors, neighborCount, kdTree,
+			&point, DBL_MAX, 0.0));
+		for (uint32_t j = 0; j < neighborCount; ++j)
+			EXPECT_DOUBLE_EQ(distances[j], neighbors[j].distance);
+
+		ASSERT_EQ(neighborCount, dsKdTree_nearestNeighbors(neighbors, neighborCount, kdTree,
+			&point, DBL_MAX, epsilon));
+		for (uint32_t j = 0; j < neighborCount; ++j)
+		{
+			EXPECT_LE(distances[j], neighbors[j].distance);
+			EXPECT_GE(distances[j]*(1.0 + epsilon) + 1e-9, neighbors[j].distance);
+		}
+
+		// Pad the radius to avoid rounding differences for points exactly on the boundary.
+		double radius = distances[neighborCount - 1]*(1.0 + 1e-9);
+		uint32_t expectedCount = (uint32_t)(std::upper_bound(distances.begin(), distances.end(),
+			radius) - distances.begin());
+		EXPECT_EQ(expectedCount, dsKdTree_withinRadius(kdTree, &point, radius, NULL, NULL));
+	}
+
+	dsKdTree_destroy(kdTree);
+}
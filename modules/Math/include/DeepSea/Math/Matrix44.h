@@ -20,6 +20,7 @@
 #include <DeepSea/Core/Assert.h>
 #include <DeepSea/Math/Export.h>
 #include <DeepSea/Math/Matrix33.h>
+#include <DeepSea/Math/SIMD.h>
 #include <DeepSea/Math/Types.h>
 
 #ifdef __cplusplus
@@ -43,6 +44,14 @@ extern "C"
  * When using affine transforms (combinations of rotate, scale, and translate), it is faster to use
  * the affine functions and macros.
  *
+ * When SIMD is available, the float functions with the SIMD and FMA suffixes use SIMD instructions
+ * and may be used after checking the features with dsSIMD_getHostFeatures(). The float inline
+ * functions without a suffix will use the SIMD versions automatically when the features are always
+ * available based on the compiler flags. The SIMD versions give the same results as the scalar
+ * versions, while the FMA versions may have small differences due to fewer rounding steps. The
+ * functions without a suffix never use FMA so they always give the same results, and the FMA
+ * versions must be called explicitly when the differences are acceptable.
+ *
  * @see dsMatrix44f dsMatrix44d
  */
 
@@ -510,6 +519,132 @@ DS_MATH_EXPORT void dsMatrix44f_makePerspective(dsMatrix44f* result, float fovy,
 DS_MATH_EXPORT void dsMatrix44d_makePerspective(dsMatrix44d* result, double fovy, double aspect,
 	double near, double far, bool halfDepth, bool invertY);
 
+#if DS_HAS_SIMD
+
+/**
+ * @brief Multiplies two matrices using SIMD instructions.
+ *
+ * This requires dsSIMDFeatures_Float4.
+ *
+ * @param[out] result The result of a*b. This may be the same as a or b.
+ * @param a The first matrix.
+ * @param b The second matrix.
+ */
+DS_SIMD_FUNC_FLOAT4 DS_MATH_EXPORT inline void dsMatrix44f_mulSIMD(dsMatrix44f* result,
+	const dsMatrix44f* a, const dsMatrix44f* b);
+
+/**
+ * @brief Multiplies two affine matrices using SIMD instructions.
+ *
+ * This assumes that the last row of both matrices is [0, 0, 0, 1]. This requires
+ * dsSIMDFeatures_Float4.
+ *
+ * @param[out] result The result of a*b. This may be the same as a or b.
+ * @param a The first matrix.
+ * @param b The second matrix.
+ */
+DS_SIMD_FUNC_FLOAT4 DS_MATH_EXPORT inline void dsMatrix44f_affineMulSIMD(dsMatrix44f* result,
+	const dsMatrix44f* a, const dsMatrix44f* b);
+
+/**
+ * @brief Transforms a vector with a matrix using SIMD instructions.
+ *
+ * This requires dsSIMDFeatures_Float4.
+ *
+ * @param[out] result The result of mat*vec. This may be the same as vec.
+ * @param mat The matrix to transform with.
+ * @param vec The vector to transform.
+ */
+DS_SIMD_FUNC_FLOAT4 DS_MATH_EXPORT inline void dsMatrix44f_transformSIMD(dsVector4f* result,
+	const dsMatrix44f* mat, const dsVector4f* vec);
+
+/**
+ * @brief Transposes a matrix using SIMD instructions.
+ *
+ * This requires dsSIMDFeatures_Float4.
+ *
+ * @param[out] result The transposed matrix. This may be the same as a.
+ * @param a The matrix to transpose.
+ */
+DS_SIMD_FUNC_FLOAT4 DS_MATH_EXPORT inline void dsMatrix44f_transposeSIMD(dsMatrix44f* result,
+	const dsMatrix44f* a);
+
+/**
+ * @brief Inverts an affine matrix using SIMD instructions.
+ *
+ * This requires dsSIMDFeatures_Float4.
+ *
+ * @param[out] result The inverted matrix. This may NOT be the same as a.
+ * @param a The matrix to invert.
+ */
+DS_SIMD_FUNC_FLOAT4 DS_MATH_EXPORT void dsMatrix44f_affineInvertSIMD(dsMatrix44f* result,
+	const dsMatrix44f* a);
+
+/**
+ * @brief Inverts a matrix using SIMD instructions.
+ *
+ * This requires dsSIMDFeatures_Float4.
+ *
+ * @param[out] result The inverted matrix. This may NOT be the same as a.
+ * @param a The matrix to invert.
+ */
+DS_SIMD_FUNC_FLOAT4 DS_MATH_EXPORT void dsMatrix44f_invertSIMD(dsMatrix44f* result,
+	const dsMatrix44f* a);
+
+/**
+ * @brief Calculates the inverse-transpose transformation matrix using SIMD instructions.
+ *
+ * This requires dsSIMDFeatures_Float4.
+ *
+ * @param[out] result The inverse-transposed matrix. This may NOT be the same as a.
+ * @param a The matrix to inverse-transpose.
+ */
+DS_SIMD_FUNC_FLOAT4 DS_MATH_EXPORT void dsMatrix44f_inverseTransposeSIMD(dsMatrix44f* result,
+	const dsMatrix44f* a);
+
+#if DS_SIMD_HAS_FMA
+
+/**
+ * @brief Multiplies two matrices using fused multiply-add instructions.
+ *
+ * This requires dsSIMDFeatures_FMA.
+ *
+ * @param[out] result The result of a*b. This may be the same as a or b.
+ * @param a The first matrix.
+ * @param b The second matrix.
+ */
+DS_SIMD_FUNC_FMA DS_MATH_EXPORT inline void dsMatrix44f_mulFMA(dsMatrix44f* result,
+	const dsMatrix44f* a, const dsMatrix44f* b);
+
+/**
+ * @brief Multiplies two affine matrices using fused multiply-add instructions.
+ *
+ * This assumes that the last row of both matrices is [0, 0, 0, 1]. This requires
+ * dsSIMDFeatures_FMA.
+ *
+ * @param[out] result The result of a*b. This may be the same as a or b.
+ * @param a The first matrix.
+ * @param b The second matrix.
+ */
+DS_SIMD_FUNC_FMA DS_MATH_EXPORT inline void dsMatrix44f_affineMulFMA(dsMatrix44f* result,
+	const dsMatrix44f* a, const dsMatrix44f* b);
+
+/**
+ * @brief Transforms a vector with a matrix using fused multiply-add instructions.
+ *
+ * This requires dsSIMDFeatures_FMA.
+ *
+ * @param[out] result The result of mat*vec. This may be the same as vec.
+ * @param mat The matrix to transform with.
+ * @param vec The vector to transform.
+ */
+DS_SIMD_FUNC_FMA DS_MATH_EXPORT inline void dsMatrix44f_transformFMA(dsVector4f* result,
+	const dsMatrix44f* mat, const dsVector4f* vec);
+
+#endif
+
+#endif
+
 /** @copydoc dsMatrix44_identity() */
 DS_MATH_EXPORT inline void dsMatrix44f_identity(dsMatrix44f* result)
 {
@@ -531,7 +666,11 @@ DS_MATH_EXPORT inline void dsMatrix44f_mul(dsMatrix44f* result, const dsMatrix44
 	DS_ASSERT(result);
 	DS_ASSERT(a);
 	DS_ASSERT(b);
+#if DS_SIMD_ALWAYS_FLOAT4
+	dsMatrix44f_mulSIMD(result, a, b);
+#else
 	dsMatrix44_mul(*result, *a, *b);
+#endif
 }
 
 /** @copydoc dsMatrix44_mul() */
@@ -551,7 +690,11 @@ DS_MATH_EXPORT inline void dsMatrix44f_affineMul(dsMatrix44f* result, const dsMa
 	DS_ASSERT(result);
 	DS_ASSERT(a);
 	DS_ASSERT(b);
+#if DS_SIMD_ALWAYS_FLOAT4
+	dsMatrix44f_affineMulSIMD(result, a, b);
+#else
 	dsMatrix44_affineMul(*result, *a, *b);
+#endif
 }
 
 /** @copydoc dsMatrix44_affineMul() */
@@ -571,7 +714,11 @@ DS_MATH_EXPORT inline void dsMatrix44f_transform(dsVector4f* result, const dsMat
 	DS_ASSERT(result);
 	DS_ASSERT(mat);
 	DS_ASSERT(vec);
+#if DS_SIMD_ALWAYS_FLOAT4
+	dsMatrix44f_transformSIMD(result, mat, vec);
+#else
 	dsMatrix44_transform(*result, *mat, *vec);
+#endif
 }
 
 /** @copydoc dsMatrix44_transform() */
@@ -609,7 +756,11 @@ DS_MATH_EXPORT inline void dsMatrix44f_transpose(dsMatrix44f* result, const dsMa
 {
 	DS_ASSERT(result);
 	DS_ASSERT(a);
+#if DS_SIMD_ALWAYS_FLOAT4
+	dsMatrix44f_transposeSIMD(result, a);
+#else
 	dsMatrix44_transpose(*result, *a);
+#endif
 }
 
 /** @copydoc dsMatrix44_transpose() */
@@ -650,6 +801,194 @@ DS_MATH_EXPORT inline void dsMatrix44d_fastInvert(dsMatrix44d* result, const dsM
 	dsMatrix44_fastInvert(*result, *a);
 }
 
+#if DS_HAS_SIMD
+
+DS_SIMD_FUNC_FLOAT4 DS_MATH_EXPORT inline void dsMatrix44f_mulSIMD(dsMatrix44f* result,
+	const dsMatrix44f* a, const dsMatrix44f* b)
+{
+	DS_ASSERT(result);
+	DS_ASSERT(a);
+	DS_ASSERT(b);
+
+	dsSIMD4f a0 = dsSIMD4f_loadUnaligned(a->columns);
+	dsSIMD4f a1 = dsSIMD4f_loadUnaligned(a->columns + 1);
+	dsSIMD4f a2 = dsSIMD4f_loadUnaligned(a->columns + 2);
+	dsSIMD4f a3 = dsSIMD4f_loadUnaligned(a->columns + 3);
+
+	// Load all values before storing in case result is the same as b.
+	dsSIMD4f b00 = dsSIMD4f_set1(b->values[0][0]), b01 = dsSIMD4f_set1(b->values[0][1]),
+		b02 = dsSIMD4f_set1(b->values[0][2]), b03 = dsSIMD4f_set1(b->values[0][3]);
+	dsSIMD4f b10 = dsSIMD4f_set1(b->values[1][0]), b11 = dsSIMD4f_set1(b->values[1][1]),
+		b12 = dsSIMD4f_set1(b->values[1][2]), b13 = dsSIMD4f_set1(b->values[1][3]);
+	dsSIMD4f b20 = dsSIMD4f_set1(b->values[2][0]), b21 = dsSIMD4f_set1(b->values[2][1]),
+		b22 = dsSIMD4f_set1(b->values[2][2]), b23 = dsSIMD4f_set1(b->values[2][3]);
+	dsSIMD4f b30 = dsSIMD4f_set1(b->values[3][0]), b31 = dsSIMD4f_set1(b->values[3][1]),
+		b32 = dsSIMD4f_set1(b->values[3][2]), b33 = dsSIMD4f_set1(b->values[3][3]);
+
+	// Same order of operations as dsMatrix44_mul() so the results are identical.
+	dsSIMD4f_storeUnaligned(result->columns, dsSIMD4f_add(dsSIMD4f_add(dsSIMD4f_add(
+		dsSIMD4f_mul(a0, b00), dsSIMD4f_mul(a1, b01)), dsSIMD4f_mul(a2, b02)),
+		dsSIMD4f_mul(a3, b03)));
+	dsSIMD4f_storeUnaligned(result->columns + 1, dsSIMD4f_add(dsSIMD4f_add(dsSIMD4f_add(
+		dsSIMD4f_mul(a0, b10), dsSIMD4f_mul(a1, b11)), dsSIMD4f_mul(a2, b12)),
+		dsSIMD4f_mul(a3, b13)));
+	dsSIMD4f_storeUnaligned(result->columns + 2, dsSIMD4f_add(dsSIMD4f_add(dsSIMD4f_add(
+		dsSIMD4f_mul(a0, b20), dsSIMD4f_mul(a1, b21)), dsSIMD4f_mul(a2, b22)),
+		dsSIMD4f_mul(a3, b23)));
+	dsSIMD4f_storeUnaligned(result->columns + 3, dsSIMD4f_add(dsSIMD4f_add(dsSIMD4f_add(
+		dsSIMD4f_mul(a0, b30), dsSIMD4f_mul(a1, b31)), dsSIMD4f_mul(a2, b32)),
+		dsSIMD4f_mul(a3, b33)));
+}
+
+DS_SIMD_FUNC_FLOAT4 DS_MATH_EXPORT inline void dsMatrix44f_affineMulSIMD(dsMatrix44f* result,
+	const dsMatrix44f* a, const dsMatrix44f* b)
+{
+	DS_ASSERT(result);
+	DS_ASSERT(a);
+	DS_ASSERT(b);
+
+	dsSIMD4f a0 = dsSIMD4f_loadUnaligned(a->columns);
+	dsSIMD4f a1 = dsSIMD4f_loadUnaligned(a->columns + 1);
+	dsSIMD4f a2 = dsSIMD4f_loadUnaligned(a->columns + 2);
+	dsSIMD4f a3 = dsSIMD4f_loadUnaligned(a->columns + 3);
+
+	dsSIMD4f b00 = dsSIMD4f_set1(b->values[0][0]), b01 = dsSIMD4f_set1(b->values[0][1]),
+		b02 = dsSIMD4f_set1(b->values[0][2]);
+	dsSIMD4f b10 = dsSIMD4f_set1(b->values[1][0]), b11 = dsSIMD4f_set1(b->values[1][1]),
+		b12 = dsSIMD4f_set1(b->values[1][2]);
+	dsSIMD4f b20 = dsSIMD4f_set1(b->values[2][0]), b21 = dsSIMD4f_set1(b->values[2][1]),
+		b22 = dsSIMD4f_set1(b->values[2][2]);
+	dsSIMD4f b30 = dsSIMD4f_set1(b->values[3][0]), b31 = dsSIMD4f_set1(b->values[3][1]),
+		b32 = dsSIMD4f_set1(b->values[3][2]);
+
+	// The last row of a is [0, 0, 0, 1], so the last row of the result is set as part of the
+	// multiply.
+	dsSIMD4f_storeUnaligned(result->columns, dsSIMD4f_add(dsSIMD4f_add(
+		dsSIMD4f_mul(a0, b00), dsSIMD4f_mul(a1, b01)), dsSIMD4f_mul(a2, b02)));
+	dsSIMD4f_storeUnaligned(result->columns + 1, dsSIMD4f_add(dsSIMD4f_add(
+		dsSIMD4f_mul(a0, b10), dsSIMD4f_mul(a1, b11)), dsSIMD4f_mul(a2, b12)));
+	dsSIMD4f_storeUnaligned(result->columns + 2, dsSIMD4f_add(dsSIMD4f_add(
+		dsSIMD4f_mul(a0, b20), dsSIMD4f_mul(a1, b21)), dsSIMD4f_mul(a2, b22)));
+	dsSIMD4f_storeUnaligned(result->columns + 3, dsSIMD4f_add(dsSIMD4f_add(dsSIMD4f_add(
+		dsSIMD4f_mul(a0, b30), dsSIMD4f_mul(a1, b31)), dsSIMD4f_mul(a2, b32)), a3));
+}
+
+DS_SIMD_FUNC_FLOAT4 DS_MATH_EXPORT inline void dsMatrix44f_transformSIMD(dsVector4f* result,
+	const dsMatrix44f* mat, const dsVector4f* vec)
+{
+	DS_ASSERT(result);
+	DS_ASSERT(mat);
+	DS_ASSERT(vec);
+
+	dsSIMD4f x = dsSIMD4f_set1(vec->x), y = dsSIMD4f_set1(vec->y), z = dsSIMD4f_set1(vec->z),
+		w = dsSIMD4f_set1(vec->w);
+	dsSIMD4f_storeUnaligned(result, dsSIMD4f_add(dsSIMD4f_add(dsSIMD4f_add(
+		dsSIMD4f_mul(dsSIMD4f_loadUnaligned(mat->columns), x),
+		dsSIMD4f_mul(dsSIMD4f_loadUnaligned(mat->columns + 1), y)),
+		dsSIMD4f_mul(dsSIMD4f_loadUnaligned(mat->columns + 2), z)),
+		dsSIMD4f_mul(dsSIMD4f_loadUnaligned(mat->columns + 3), w)));
+}
+
+DS_SIMD_FUNC_FLOAT4 DS_MATH_EXPORT inline void dsMatrix44f_transposeSIMD(dsMatrix44f* result,
+	const dsMatrix44f* a)
+{
+	DS_ASSERT(result);
+	DS_ASSERT(a);
+
+	dsSIMD4f c0 = dsSIMD4f_loadUnaligned(a->columns);
+	dsSIMD4f c1 = dsSIMD4f_loadUnaligned(a->columns + 1);
+	dsSIMD4f c2 = dsSIMD4f_loadUnaligned(a->columns + 2);
+	dsSIMD4f c3 = dsSIMD4f_loadUnaligned(a->columns + 3);
+	dsSIMD4f_transpose(c0, c1, c2, c3);
+	dsSIMD4f_storeUnaligned(result->columns, c0);
+	dsSIMD4f_storeUnaligned(result->columns + 1, c1);
+	dsSIMD4f_storeUnaligned(result->columns + 2, c2);
+	dsSIMD4f_storeUnaligned(result->columns + 3, c3);
+}
+
+#if DS_SIMD_HAS_FMA
+
+DS_SIMD_FUNC_FMA DS_MATH_EXPORT inline void dsMatrix44f_mulFMA(dsMatrix44f* result,
+	const dsMatrix44f* a, const dsMatrix44f* b)
+{
+	DS_ASSERT(result);
+	DS_ASSERT(a);
+	DS_ASSERT(b);
+
+	dsSIMD4f a0 = dsSIMD4f_loadUnaligned(a->columns);
+	dsSIMD4f a1 = dsSIMD4f_loadUnaligned(a->columns + 1);
+	dsSIMD4f a2 = dsSIMD4f_loadUnaligned(a->columns + 2);
+	dsSIMD4f a3 = dsSIMD4f_loadUnaligned(a->columns + 3);
+
+	dsSIMD4f b00 = dsSIMD4f_set1(b->values[0][0]), b01 = dsSIMD4f_set1(b->values[0][1]),
+		b02 = dsSIMD4f_set1(b->values[0][2]), b03 = dsSIMD4f_set1(b->values[0][3]);
+	dsSIMD4f b10 = dsSIMD4f_set1(b->values[1][0]), b11 = dsSIMD4f_set1(b->values[1][1]),
+		b12 = dsSIMD4f_set1(b->values[1][2]), b13 = dsSIMD4f_set1(b->values[1][3]);
+	dsSIMD4f b20 = dsSIMD4f_set1(b->values[2][0]), b21 = dsSIMD4f_set1(b->values[2][1]),
+		b22 = dsSIMD4f_set1(b->values[2][2]), b23 = dsSIMD4f_set1(b->values[2][3]);
+	dsSIMD4f b30 = dsSIMD4f_set1(b->values[3][0]), b31 = dsSIMD4f_set1(b->values[3][1]),
+		b32 = dsSIMD4f_set1(b->values[3][2]), b33 = dsSIMD4f_set1(b->values[3][3]);
+
+	dsSIMD4f_storeUnaligned(result->columns, dsSIMD4f_fmadd(a3, b03, dsSIMD4f_fmadd(a2, b02,
+		dsSIMD4f_fmadd(a1, b01, dsSIMD4f_mul(a0, b00)))));
+	dsSIMD4f_storeUnaligned(result->columns + 1, dsSIMD4f_fmadd(a3, b13, dsSIMD4f_fmadd(a2, b12,
+		dsSIMD4f_fmadd(a1, b11, dsSIMD4f_mul(a0, b10)))));
+	dsSIMD4f_storeUnaligned(result->columns + 2, dsSIMD4f_fmadd(a3, b23, dsSIMD4f_fmadd(a2, b22,
+		dsSIMD4f_fmadd(a1, b21, dsSIMD4f_mul(a0, b20)))));
+	dsSIMD4f_storeUnaligned(result->columns + 3, dsSIMD4f_fmadd(a3, b33, dsSIMD4f_fmadd(a2, b32,
+		dsSIMD4f_fmadd(a1, b31, dsSIMD4f_mul(a0, b30)))));
+}
+
+DS_SIMD_FUNC_FMA DS_MATH_EXPORT inline void dsMatrix44f_affineMulFMA(dsMatrix44f* result,
+	const dsMatrix44f* a, const dsMatrix44f* b)
+{
+	DS_ASSERT(result);
+	DS_ASSERT(a);
+	DS_ASSERT(b);
+
+	dsSIMD4f a0 = dsSIMD4f_loadUnaligned(a->columns);
+	dsSIMD4f a1 = dsSIMD4f_loadUnaligned(a->columns + 1);
+	dsSIMD4f a2 = dsSIMD4f_loadUnaligned(a->columns + 2);
+	dsSIMD4f a3 = dsSIMD4f_loadUnaligned(a->columns + 3);
+
+	dsSIMD4f b00 = dsSIMD4f_set1(b->values[0][0]), b01 = dsSIMD4f_set1(b->values[0][1]),
+		b02 = dsSIMD4f_set1(b->values[0][2]);
+	dsSIMD4f b10 = dsSIMD4f_set1(b->values[1][0]), b11 = dsSIMD4f_set1(b->values[1][1]),
+		b12 = dsSIMD4f_set1(b->values[1][2]);
+	dsSIMD4f b20 = dsSIMD4f_set1(b->values[2][0]), b21 = dsSIMD4f_set1(b->values[2][1]),
+		b22 = dsSIMD4f_set1(b->values[2][2]);
+	dsSIMD4f b30 = dsSIMD4f_set1(b->values[3][0]), b31 = dsSIMD4f_set1(b->values[3][1]),
+		b32 = dsSIMD4f_set1(b->values[3][2]);
+
+	dsSIMD4f_storeUnaligned(result->columns, dsSIMD4f_fmadd(a2, b02,
+		dsSIMD4f_fmadd(a1, b01, dsSIMD4f_mul(a0, b00))));
+	dsSIMD4f_storeUnaligned(result->columns + 1, dsSIMD4f_fmadd(a2, b12,
+		dsSIMD4f_fmadd(a1, b11, dsSIMD4f_mul(a0, b10))));
+	dsSIMD4f_storeUnaligned(result->columns + 2, dsSIMD4f_fmadd(a2, b22,
+		dsSIMD4f_fmadd(a1, b21, dsSIMD4f_mul(a0, b20))));
+	dsSIMD4f_storeUnaligned(result->columns + 3, dsSIMD4f_fmadd(a2, b32,
+		dsSIMD4f_fmadd(a1, b31, dsSIMD4f_fmadd(a0, b30, a3))));
+}
+
+DS_SIMD_FUNC_FMA DS_MATH_EXPORT inline void dsMatrix44f_transformFMA(dsVector4f* result,
+	const dsMatrix44f* mat, const dsVector4f* vec)
+{
+	DS_ASSERT(result);
+	DS_ASSERT(mat);
+	DS_ASSERT(vec);
+
+	dsSIMD4f x = dsSIMD4f_set1(vec->x), y = dsSIMD4f_set1(vec->y), z = dsSIMD4f_set1(vec->z),
+		w = dsSIMD4f_set1(vec->w);
+	dsSIMD4f_storeUnaligned(result, dsSIMD4f_fmadd(dsSIMD4f_loadUnaligned(mat->columns + 3), w,
+		dsSIMD4f_fmadd(dsSIMD4f_loadUnaligned(mat->columns + 2), z,
+		dsSIMD4f_fmadd(dsSIMD4f_loadUnaligned(mat->columns + 1), y,
+		dsSIMD4f_mul(dsSIMD4f_loadUnaligned(mat->columns), x)))));
+}
+
+#endif
+
+#endif
+
 #ifdef __cplusplus
 }
 #endif
@@ -20,6 +20,7 @@
 #include <DeepSea/Core/Assert.h>
 #include <DeepSea/Math/Core.h>
 #include <DeepSea/Math/Export.h>
+#include <DeepSea/Math/SIMD.h>
 #include <DeepSea/Math/Types.h>
 #include <DeepSea/Math/Vector3.h>
 
@@ -41,6 +42,10 @@ extern "C"
  * provided to accompany the macro to use when desired. The inline functions may also be addressed
  * in order to interface with other languages.
  *
+ * When SIMD is available, the float functions with the SIMD and FMA suffixes use SIMD instructions
+ * and may be used after checking the features with dsSIMD_getHostFeatures(). These may have small
+ * differences from the scalar versions due to a different order of operations.
+ *
  * @see dsQuaternion4f dsQuaternion4d
  */
 
@@ -277,6 +282,77 @@ DS_MATH_EXPORT inline void dsQuaternion4d_invert(dsQuaternion4d* result, const d
 	dsQuaternion4_invert(*result, *a);
 }
 
+#if DS_HAS_SIMD
+
+/**
+ * @brief Multiplies two quaternions using SIMD instructions.
+ *
+ * This requires dsSIMDFeatures_Float4.
+ *
+ * @param[out] result The result of a*b. This may be the same as a or b.
+ * @param a The first quaternion.
+ * @param b The second quaternion.
+ */
+DS_SIMD_FUNC_FLOAT4 DS_MATH_EXPORT inline void dsQuaternion4f_mulSIMD(dsQuaternion4f* result,
+	const dsQuaternion4f* a, const dsQuaternion4f* b)
+{
+	DS_ASSERT(result);
+	DS_ASSERT(a);
+	DS_ASSERT(b);
+
+	// Each element of a is multiplied by a permutation of b with sign changes.
+	dsSIMD4f bRIJK = dsSIMD4f_loadUnaligned(b->values);
+	dsSIMD4f bIRKJ = dsSIMD4f_swapPairs(bRIJK);
+	dsSIMD4f bJKRI = dsSIMD4f_swapHalves(bRIJK);
+	dsSIMD4f bKJIR = dsSIMD4f_swapPairs(bJKRI);
+
+	dsSIMD4f result4 = dsSIMD4f_mul(dsSIMD4f_set1(a->r), bRIJK);
+	result4 = dsSIMD4f_add(result4, dsSIMD4f_mul(dsSIMD4f_set1(a->i),
+		dsSIMD4f_mul(bIRKJ, dsSIMD4f_set4(-1.0f, 1.0f, -1.0f, 1.0f))));
+	result4 = dsSIMD4f_add(result4, dsSIMD4f_mul(dsSIMD4f_set1(a->j),
+		dsSIMD4f_mul(bJKRI, dsSIMD4f_set4(-1.0f, 1.0f, 1.0f, -1.0f))));
+	result4 = dsSIMD4f_add(result4, dsSIMD4f_mul(dsSIMD4f_set1(a->k),
+		dsSIMD4f_mul(bKJIR, dsSIMD4f_set4(-1.0f, -1.0f, 1.0f, 1.0f))));
+	dsSIMD4f_storeUnaligned(result->values, result4);
+}
+
+#if DS_SIMD_HAS_FMA
+
+/**
+ * @brief Multiplies two quaternions using fused multiply-add instructions.
+ *
+ * This requires dsSIMDFeatures_FMA.
+ *
+ * @param[out] result The result of a*b. This may be the same as a or b.
+ * @param a The first quaternion.
+ * @param b The second quaternion.
+ */
+DS_SIMD_FUNC_FMA DS_MATH_EXPORT inline void dsQuaternion4f_mulFMA(dsQuaternion4f* result,
+	const dsQuaternion4f* a, const dsQuaternion4f* b)
+{
+	DS_ASSERT(result);
+	DS_ASSERT(a);
+	DS_ASSERT(b);
+
+	dsSIMD4f bRIJK = dsSIMD4f_loadUnaligned(b->values);
+	dsSIMD4f bIRKJ = dsSIMD4f_swapPairs(bRIJK);
+	dsSIMD4f bJKRI = dsSIMD4f_swapHalves(bRIJK);
+	dsSIMD4f bKJIR = dsSIMD4f_swapPairs(bJKRI);
+
+	dsSIMD4f result4 = dsSIMD4f_mul(dsSIMD4f_set1(a->r), bRIJK);
+	result4 = dsSIMD4f_fmadd(dsSIMD4f_set1(a->i),
+		dsSIMD4f_mul(bIRKJ, dsSIMD4f_set4(-1.0f, 1.0f, -1.0f, 1.0f)), result4);
+	result4 = dsSIMD4f_fmadd(dsSIMD4f_set1(a->j),
+		dsSIMD4f_mul(bJKRI, dsSIMD4f_set4(-1.0f, 1.0f, 1.0f, -1.0f)), result4);
+	result4 = dsSIMD4f_fmadd(dsSIMD4f_set1(a->k),
+		dsSIMD4f_mul(bKJIR, dsSIMD4f_set4(-1.0f, -1.0f, 1.0f, 1.0f)), result4);
+	dsSIMD4f_storeUnaligned(result->values, result4);
+}
+
+#endif
+
+#endif
+
 /// @cond
 #define dsQuaternion4_mulToVector(result, a, b) \
 	do \
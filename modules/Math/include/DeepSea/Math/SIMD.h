@@ -0,0 +1,256 @@
+/*
+ * Copyright 2020 Aaron Barany
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <DeepSea/Core/Config.h>
+#include <DeepSea/Core/SIMD.h>
+
+/**
+ * @file
+ * @brief Macros for operating on 4 floats at a time with SIMD instructions.
+ *
+ * These are thin wrappers around the SSE or NEON intrinsics for the current platform, and are
+ * only available when DS_HAS_SIMD is set. Functions that use these macros must be declared with
+ * DS_SIMD_FUNC_FLOAT4, or DS_SIMD_FUNC_FMA when using the FMA macros, and must only be called when
+ * the features are available. (either DS_SIMD_ALWAYS_* is set or dsSIMD_getHostFeatures() reports
+ * them as available)
+ *
+ * Parameters may be evaluated multiple times, so they should be simple values.
+ *
+ * @see dsSIMD4f
+ */
+
+/**
+ * @brief Define for whether or not the FMA macros are available on the current platform.
+ *
+ * dsSIMDFeatures_FMA must still be checked before using them.
+ */
+#if DS_X86_32 || DS_X86_64 || DS_ARM_64
+#define DS_SIMD_HAS_FMA 1
+#else
+#define DS_SIMD_HAS_FMA 0
+#endif
+
+#if DS_HAS_SIMD || defined(DOXYGEN)
+
+#if DS_X86_32 || DS_X86_64 || defined(DOXYGEN)
+
+/**
+ * @brief Type for a SIMD vector of 4 floats.
+ */
+typedef __m128 dsSIMD4f;
+
+/**
+ * @brief Loads a SIMD vector from 16-byte aligned memory.
+ * @param fp A pointer to the 4 floats to load.
+ * @return The loaded vector.
+ */
+#define dsSIMD4f_load(fp) _mm_load_ps((const float*)(fp))
+
+/**
+ * @brief Loads a SIMD vector from unaligned memory.
+ * @param fp A pointer to the 4 floats to load.
+ * @return The loaded vector.
+ */
+#define dsSIMD4f_loadUnaligned(fp) _mm_loadu_ps((const float*)(fp))
+
+/**
+ * @brief Sets all elements of a SIMD vector to the same value.
+ * @param f The value to set.
+ * @return The vector.
+ */
+#define dsSIMD4f_set1(f) _mm_set1_ps(f)
+
+/**
+ * @brief Sets the elements of a SIMD vector.
+ * @param x The first element.
+ * @param y The second element.
+ * @param z The third element.
+ * @param w The fourth element.
+ * @return The vector.
+ */
+#define dsSIMD4f_set4(x, y, z, w) _mm_set_ps(w, z, y, x)
+
+/**
+ * @brief Stores a SIMD vector to 16-byte aligned memory.
+ * @param[out] fp A pointer to the 4 floats to store to.
+ * @param a The vector to store.
+ */
+#define dsSIMD4f_store(fp, a) _mm_store_ps((float*)(fp), a)
+
+/**
+ * @brief Stores a SIMD vector to unaligned memory.
+ * @param[out] fp A pointer to the 4 floats to store to.
+ * @param a The vector to store.
+ */
+#define dsSIMD4f_storeUnaligned(fp, a) _mm_storeu_ps((float*)(fp), a)
+
+/**
+ * @brief Adds two SIMD vectors.
+ * @param a The first vector.
+ * @param b The second vector.
+ * @return The result of a + b.
+ */
+#define dsSIMD4f_add(a, b) _mm_add_ps(a, b)
+
+/**
+ * @brief Subtracts two SIMD vectors.
+ * @param a The first vector.
+ * @param b The second vector.
+ * @return The result of a - b.
+ */
+#define dsSIMD4f_sub(a, b) _mm_sub_ps(a, b)
+
+/**
+ * @brief Multiplies two SIMD vectors.
+ * @param a The first vector.
+ * @param b The second vector.
+ * @return The result of a*b.
+ */
+#define dsSIMD4f_mul(a, b) _mm_mul_ps(a, b)
+
+/**
+ * @brief Negates a SIMD vector.
+ * @param a The vector to negate.
+ * @return The result of -a.
+ */
+#define dsSIMD4f_neg(a) _mm_xor_ps(a, _mm_set1_ps(-0.0f))
+
+/**
+ * @brief Takes the absolute value of a SIMD vector.
+ * @param a The vector.
+ * @return The absolute value of each element.
+ */
+#define dsSIMD4f_abs(a) _mm_andnot_ps(_mm_set1_ps(-0.0f), a)
+
+/**
+ * @brief Takes the minimum of two SIMD vectors.
+ * @param a The first vector.
+ * @param b The second vector.
+ * @return The minimum of each element.
+ */
+#define dsSIMD4f_min(a, b) _mm_min_ps(a, b)
+
+/**
+ * @brief Takes the maximum of two SIMD vectors.
+ * @param a The first vector.
+ * @param b The second vector.
+ * @return The maximum of each element.
+ */
+#define dsSIMD4f_max(a, b) _mm_max_ps(a, b)
+
+/**
+ * @brief Swaps adjacent pairs of elements.
+ * @param a The vector.
+ * @return The vector (a.y, a.x, a.w, a.z).
+ */
+#define dsSIMD4f_swapPairs(a) _mm_shuffle_ps(a, a, _MM_SHUFFLE(2, 3, 0, 1))
+
+/**
+ * @brief Swaps the upper and lower halves of a SIMD vector.
+ * @param a The vector.
+ * @return The vector (a.z, a.w, a.x, a.y).
+ */
+#define dsSIMD4f_swapHalves(a) _mm_shuffle_ps(a, a, _MM_SHUFFLE(1, 0, 3, 2))
+
+/**
+ * @brief Transposes four SIMD vectors in place, treating them as the rows of a 4x4 matrix.
+ * @param[inout] a The first vector.
+ * @param[inout] b The second vector.
+ * @param[inout] c The third vector.
+ * @param[inout] d The fourth vector.
+ */
+#define dsSIMD4f_transpose(a, b, c, d) _MM_TRANSPOSE4_PS(a, b, c, d)
+
+/**
+ * @brief Performs a fused multiply-add.
+ *
+ * This requires dsSIMDFeatures_FMA.
+ *
+ * @param a The first vector to multiply.
+ * @param b The second vector to multiply.
+ * @param c The vector to add.
+ * @return The result of a*b + c.
+ */
+#define dsSIMD4f_fmadd(a, b, c) _mm_fmadd_ps(a, b, c)
+
+/**
+ * @brief Performs a fused multiply-subtract.
+ *
+ * This requires dsSIMDFeatures_FMA.
+ *
+ * @param a The first vector to multiply.
+ * @param b The second vector to multiply.
+ * @param c The vector to subtract.
+ * @return The result of a*b - c.
+ */
+#define dsSIMD4f_fmsub(a, b, c) _mm_fmsub_ps(a, b, c)
+
+/**
+ * @brief Performs a fused negative multiply-add.
+ *
+ * This requires dsSIMDFeatures_FMA.
+ *
+ * @param a The first vector to multiply.
+ * @param b The second vector to multiply.
+ * @param c The vector to add.
+ * @return The result of c - a*b.
+ */
+#define dsSIMD4f_fnmadd(a, b, c) _mm_fnmadd_ps(a, b, c)
+
+#else
+
+typedef float32x4_t dsSIMD4f;
+
+#define dsSIMD4f_load(fp) vld1q_f32((const float*)(fp))
+#define dsSIMD4f_loadUnaligned(fp) vld1q_f32((const float*)(fp))
+#define dsSIMD4f_set1(f) vdupq_n_f32(f)
+#define dsSIMD4f_set4(x, y, z, w) ((float32x4_t){x, y, z, w})
+#define dsSIMD4f_store(fp, a) vst1q_f32((float*)(fp), a)
+#define dsSIMD4f_storeUnaligned(fp, a) vst1q_f32((float*)(fp), a)
+
+#define dsSIMD4f_add(a, b) vaddq_f32(a, b)
+#define dsSIMD4f_sub(a, b) vsubq_f32(a, b)
+#define dsSIMD4f_mul(a, b) vmulq_f32(a, b)
+#define dsSIMD4f_neg(a) vnegq_f32(a)
+#define dsSIMD4f_abs(a) vabsq_f32(a)
+#define dsSIMD4f_min(a, b) vminq_f32(a, b)
+#define dsSIMD4f_max(a, b) vmaxq_f32(a, b)
+
+#define dsSIMD4f_swapPairs(a) vrev64q_f32(a)
+#define dsSIMD4f_swapHalves(a) vextq_f32(a, a, 2)
+
+#define dsSIMD4f_transpose(a, b, c, d) \
+	do \
+	{ \
+		float32x4x2_t _ab = vtrnq_f32(a, b); \
+		float32x4x2_t _cd = vtrnq_f32(c, d); \
+		(a) = vcombine_f32(vget_low_f32(_ab.val[0]), vget_low_f32(_cd.val[0])); \
+		(b) = vcombine_f32(vget_low_f32(_ab.val[1]), vget_low_f32(_cd.val[1])); \
+		(c) = vcombine_f32(vget_high_f32(_ab.val[0]), vget_high_f32(_cd.val[0])); \
+		(d) = vcombine_f32(vget_high_f32(_ab.val[1]), vget_high_f32(_cd.val[1])); \
+	} while (0)
+
+#if DS_ARM_64
+#define dsSIMD4f_fmadd(a, b, c) vfmaq_f32(c, a, b)
+#define dsSIMD4f_fmsub(a, b, c) vfmaq_f32(vnegq_f32(c), a, b)
+#define dsSIMD4f_fnmadd(a, b, c) vfmsq_f32(c, a, b)
+#endif
+
+#endif
+
+#endif
@@ -178,6 +178,56 @@
 		(result).values[3][3] = 1; \
 	} while (0)
 
+#if DS_HAS_SIMD
+
+#if DS_X86_32 || DS_X86_64
+
+DS_SIMD_FUNC_FLOAT4
+static inline dsSIMD4f cross3SIMD(dsSIMD4f a, dsSIMD4f b)
+{
+	dsSIMD4f aYZX = _mm_shuffle_ps(a, a, _MM_SHUFFLE(3, 0, 2, 1));
+	dsSIMD4f aZXY = _mm_shuffle_ps(a, a, _MM_SHUFFLE(3, 1, 0, 2));
+	dsSIMD4f bYZX = _mm_shuffle_ps(b, b, _MM_SHUFFLE(3, 0, 2, 1));
+	dsSIMD4f bZXY = _mm_shuffle_ps(b, b, _MM_SHUFFLE(3, 1, 0, 2));
+	return dsSIMD4f_sub(dsSIMD4f_mul(aYZX, bZXY), dsSIMD4f_mul(aZXY, bYZX));
+}
+
+#else
+
+static inline dsSIMD4f shuffleYZXW(dsSIMD4f a)
+{
+	float32x2_t low = vget_low_f32(a);
+	float32x2_t high = vget_high_f32(a);
+	return vcombine_f32(vext_f32(low, high, 1), vrev64_f32(vext_f32(high, low, 1)));
+}
+
+static inline dsSIMD4f shuffleZXYW(dsSIMD4f a)
+{
+	float32x2_t low = vget_low_f32(a);
+	float32x2_t high = vget_high_f32(a);
+	return vcombine_f32(vzip_f32(high, low).val[0], vtrn_f32(low, high).val[1]);
+}
+
+static inline dsSIMD4f cross3SIMD(dsSIMD4f a, dsSIMD4f b)
+{
+	return dsSIMD4f_sub(dsSIMD4f_mul(shuffleYZXW(a), shuffleZXYW(b)),
+		dsSIMD4f_mul(shuffleZXYW(a), shuffleYZXW(b)));
+}
+
+#endif
+
+DS_SIMD_FUNC_FLOAT4
+static inline float horizontalAddSIMD(dsSIMD4f a)
+{
+	a = dsSIMD4f_add(a, dsSIMD4f_swapHalves(a));
+	a = dsSIMD4f_add(a, dsSIMD4f_swapPairs(a));
+	float values[4];
+	dsSIMD4f_storeUnaligned(values, a);
+	return values[0];
+}
+
+#endif
+
 void dsMatrix44f_affineInvert(dsMatrix44f* result, const dsMatrix44f* a)
 {
 	// Macros for 3x3 matrix will work on the upper 3x3 for a 4x4 matrix.
@@ -278,6 +328,131 @@ void dsMatrix44d_inverseTranspose(dsMatrix44d* result, const dsMatrix44d* a)
 	dsMatrix44_transpose(*result, inverse);
 }
 
+#if DS_HAS_SIMD
+
+DS_SIMD_FUNC_FLOAT4
+void dsMatrix44f_affineInvertSIMD(dsMatrix44f* result, const dsMatrix44f* a)
+{
+	DS_ASSERT(result);
+	DS_ASSERT(a);
+	DS_ASSERT(result != a);
+
+	dsSIMD4f c0 = dsSIMD4f_loadUnaligned(a->columns);
+	dsSIMD4f c1 = dsSIMD4f_loadUnaligned(a->columns + 1);
+	dsSIMD4f c2 = dsSIMD4f_loadUnaligned(a->columns + 2);
+
+	// The rows of the inverted upper 3x3 are the cross products of the columns divided by the
+	// determinant. The last element of each cross product will be 0.
+	dsSIMD4f r0 = cross3SIMD(c1, c2);
+	dsSIMD4f r1 = cross3SIMD(c2, c0);
+	dsSIMD4f r2 = cross3SIMD(c0, c1);
+	float upperDet = horizontalAddSIMD(dsSIMD4f_mul(c0, r0));
+	DS_ASSERT(upperDet != 0);
+	dsSIMD4f invUpperDet = dsSIMD4f_set1(1/upperDet);
+
+	r0 = dsSIMD4f_mul(r0, invUpperDet);
+	r1 = dsSIMD4f_mul(r1, invUpperDet);
+	r2 = dsSIMD4f_mul(r2, invUpperDet);
+	dsSIMD4f r3 = dsSIMD4f_set1(0.0f);
+	dsSIMD4f_transpose(r0, r1, r2, r3);
+
+	dsSIMD4f translate = dsSIMD4f_sub(dsSIMD4f_sub(
+		dsSIMD4f_neg(dsSIMD4f_mul(r0, dsSIMD4f_set1(a->values[3][0]))),
+		dsSIMD4f_mul(r1, dsSIMD4f_set1(a->values[3][1]))),
+		dsSIMD4f_mul(r2, dsSIMD4f_set1(a->values[3][2])));
+	translate = dsSIMD4f_add(translate, dsSIMD4f_set4(0.0f, 0.0f, 0.0f, 1.0f));
+
+	dsSIMD4f_storeUnaligned(result->columns, r0);
+	dsSIMD4f_storeUnaligned(result->columns + 1, r1);
+	dsSIMD4f_storeUnaligned(result->columns + 2, r2);
+	dsSIMD4f_storeUnaligned(result->columns + 3, translate);
+}
+
+DS_SIMD_FUNC_FLOAT4
+void dsMatrix44f_invertSIMD(dsMatrix44f* result, const dsMatrix44f* a)
+{
+	DS_ASSERT(result);
+	DS_ASSERT(a);
+	DS_ASSERT(result != a);
+
+	// Cramer's rule, computing the cofactors with 2x2 determinants on the transposed matrix. The
+	// second and fourth rows have their halves swapped so the permutations only need to swap
+	// pairs or halves.
+	dsSIMD4f row0 = dsSIMD4f_loadUnaligned(a->columns);
+	dsSIMD4f row1 = dsSIMD4f_loadUnaligned(a->columns + 1);
+	dsSIMD4f row2 = dsSIMD4f_loadUnaligned(a->columns + 2);
+	dsSIMD4f row3 = dsSIMD4f_loadUnaligned(a->columns + 3);
+	dsSIMD4f_transpose(row0, row1, row2, row3);
+	row1 = dsSIMD4f_swapHalves(row1);
+	row3 = dsSIMD4f_swapHalves(row3);
+
+	dsSIMD4f temp = dsSIMD4f_swapPairs(dsSIMD4f_mul(row2, row3));
+	dsSIMD4f minor0 = dsSIMD4f_mul(row1, temp);
+	dsSIMD4f minor1 = dsSIMD4f_mul(row0, temp);
+	temp = dsSIMD4f_swapHalves(temp);
+	minor0 = dsSIMD4f_sub(dsSIMD4f_mul(row1, temp), minor0);
+	minor1 = dsSIMD4f_swapHalves(dsSIMD4f_sub(dsSIMD4f_mul(row0, temp), minor1));
+
+	temp = dsSIMD4f_swapPairs(dsSIMD4f_mul(row1, row2));
+	minor0 = dsSIMD4f_add(dsSIMD4f_mul(row3, temp), minor0);
+	dsSIMD4f minor3 = dsSIMD4f_mul(row0, temp);
+	temp = dsSIMD4f_swapHalves(temp);
+	minor0 = dsSIMD4f_sub(minor0, dsSIMD4f_mul(row3, temp));
+	minor3 = dsSIMD4f_swapHalves(dsSIMD4f_sub(dsSIMD4f_mul(row0, temp), minor3));
+
+	temp = dsSIMD4f_swapPairs(dsSIMD4f_mul(dsSIMD4f_swapHalves(row1), row3));
+	row2 = dsSIMD4f_swapHalves(row2);
+	minor0 = dsSIMD4f_add(dsSIMD4f_mul(row2, temp), minor0);
+	dsSIMD4f minor2 = dsSIMD4f_mul(row0, temp);
+	temp = dsSIMD4f_swapHalves(temp);
+	minor0 = dsSIMD4f_sub(minor0, dsSIMD4f_mul(row2, temp));
+	minor2 = dsSIMD4f_swapHalves(dsSIMD4f_sub(dsSIMD4f_mul(row0, temp), minor2));
+
+	temp = dsSIMD4f_swapPairs(dsSIMD4f_mul(row0, row1));
+	minor2 = dsSIMD4f_add(dsSIMD4f_mul(row3, temp), minor2);
+	minor3 = dsSIMD4f_sub(dsSIMD4f_mul(row2, temp), minor3);
+	temp = dsSIMD4f_swapHalves(temp);
+	minor2 = dsSIMD4f_sub(dsSIMD4f_mul(row3, temp), minor2);
+	minor3 = dsSIMD4f_sub(minor3, dsSIMD4f_mul(row2, temp));
+
+	temp = dsSIMD4f_swapPairs(dsSIMD4f_mul(row0, row3));
+	minor1 = dsSIMD4f_sub(minor1, dsSIMD4f_mul(row2, temp));
+	minor2 = dsSIMD4f_add(dsSIMD4f_mul(row1, temp), minor2);
+	temp = dsSIMD4f_swapHalves(temp);
+	minor1 = dsSIMD4f_add(dsSIMD4f_mul(row2, temp), minor1);
+	minor2 = dsSIMD4f_sub(minor2, dsSIMD4f_mul(row1, temp));
+
+	temp = dsSIMD4f_swapPairs(dsSIMD4f_mul(row0, row2));
+	minor1 = dsSIMD4f_add(dsSIMD4f_mul(row3, temp), minor1);
+	minor3 = dsSIMD4f_sub(minor3, dsSIMD4f_mul(row1, temp));
+	temp = dsSIMD4f_swapHalves(temp);
+	minor1 = dsSIMD4f_sub(minor1, dsSIMD4f_mul(row3, temp));
+	minor3 = dsSIMD4f_add(dsSIMD4f_mul(row1, temp), minor3);
+
+	float det = horizontalAddSIMD(dsSIMD4f_mul(row0, minor0));
+	DS_ASSERT(det != 0);
+	dsSIMD4f invDet = dsSIMD4f_set1(1/det);
+
+	dsSIMD4f_storeUnaligned(result->columns, dsSIMD4f_mul(minor0, invDet));
+	dsSIMD4f_storeUnaligned(result->columns + 1, dsSIMD4f_mul(minor1, invDet));
+	dsSIMD4f_storeUnaligned(result->columns + 2, dsSIMD4f_mul(minor2, invDet));
+	dsSIMD4f_storeUnaligned(result->columns + 3, dsSIMD4f_mul(minor3, invDet));
+}
+
+DS_SIMD_FUNC_FLOAT4
+void dsMatrix44f_inverseTransposeSIMD(dsMatrix44f* result, const dsMatrix44f* a)
+{
+	DS_ASSERT(result);
+	DS_ASSERT(a);
+	DS_ASSERT(result != a);
+
+	dsMatrix44f inverse;
+	dsMatrix44f_affineInvertSIMD(&inverse, a);
+	dsMatrix44f_transposeSIMD(result, &inverse);
+}
+
+#endif
+
 void dsMatrix44f_makeRotate(dsMatrix44f* result, float x, float y, float z)
 {
 	DS_ASSERT(result);
@@ -811,3 +986,16 @@ double dsMatrix44d_determinant(dsMatrix44d* a);
 
 void dsMatrix44f_fastInvert(dsMatrix44f* result, const dsMatrix44f* a);
 void dsMatrix44d_fastInvert(dsMatrix44d* result, const dsMatrix44d* a);
+
+#if DS_HAS_SIMD
+void dsMatrix44f_mulSIMD(dsMatrix44f* result, const dsMatrix44f* a, const dsMatrix44f* b);
+void dsMatrix44f_affineMulSIMD(dsMatrix44f* result, const dsMatrix44f* a, const dsMatrix44f* b);
+void dsMatrix44f_transformSIMD(dsVector4f* result, const dsMatrix44f* mat, const dsVector4f* vec);
+void dsMatrix44f_transposeSIMD(dsMatrix44f* result, const dsMatrix44f* a);
+
+#if DS_SIMD_HAS_FMA
+void dsMatrix44f_mulFMA(dsMatrix44f* result, const dsMatrix44f* a, const dsMatrix44f* b);
+void dsMatrix44f_affineMulFMA(dsMatrix44f* result, const dsMatrix44f* a, const dsMatrix44f* b);
+void dsMatrix44f_transformFMA(dsVector4f* result, const dsMatrix44f* mat, const dsVector4f* vec);
+#endif
+#endif
@@ -306,3 +306,12 @@ void dsQuaternion4d_mul(dsQuaternion4d* result, const dsQuaternion4d* a, const d
 
 void dsQuaternion4f_invert(dsQuaternion4f* result, const dsQuaternion4f* a);
 void dsQuaternion4d_invert(dsQuaternion4d* result, const dsQuaternion4d* a);
+
+#if DS_HAS_SIMD
+void dsQuaternion4f_mulSIMD(dsQuaternion4f* result, const dsQuaternion4f* a,
+	const dsQuaternion4f* b);
+#if DS_SIMD_HAS_FMA
+void dsQuaternion4f_mulFMA(dsQuaternion4f* result, const dsQuaternion4f* a,
+	const dsQuaternion4f* b);
+#endif
+#endif
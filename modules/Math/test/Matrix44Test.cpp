@@ -14,11 +14,14 @@
  * limitations under the License.
  */
 
+#include <DeepSea/Core/Timer.h>
 #include <DeepSea/Math/Matrix44.h>
 #include <DeepSea/Math/Vector3.h>
 #include <DeepSea/Math/Vector4.h>
 #include <gtest/gtest.h>
 #include <cmath>
+#include <string>
+#include <vector>
 
 // Handle older versions of gtest.
 #ifndef TYPED_TEST_SUITE
@@ -1146,3 +1149,258 @@ TEST(Matrix44, ConvertDoubleToFloat)
 	EXPECT_FLOAT_EQ((float)matrixd.values[2][2], matrixf.values[2][2]);
 	EXPECT_FLOAT_EQ((float)matrixd.values[2][3], matrixf.values[2][3]);
 }
+
+#if DS_HAS_SIMD
+
+namespace
+{
+
+dsMatrix44f createAffineMatrix(float angle, float offset)
+{
+	dsMatrix44f rotate, scale, translate, temp, result;
+	dsMatrix44f_makeRotate(&rotate, angle, -angle*0.5f, angle*2.0f);
+	dsMatrix44f_makeScale(&scale, 1.5f, 0.75f, -2.0f);
+	dsMatrix44f_makeTranslate(&translate, offset, -offset*2.0f, offset*3.0f);
+	dsMatrix44_affineMul(temp, scale, rotate);
+	dsMatrix44_affineMul(result, translate, temp);
+	return result;
+}
+
+const dsMatrix44f testMatrix1 =
+{{
+	{-0.1f, 2.3f, -4.5f, 6.7f},
+	{8.9f, -1.0f, 3.2f, -5.4f},
+	{-7.6f, 9.8f, 0.1f, -2.3f},
+	{4.5f, -6.7f, -8.9f, 1.0f}
+}};
+
+const dsMatrix44f testMatrix2 =
+{{
+	{1.0f, -3.2f, -5.4f, 7.6f},
+	{-9.8f, 1.0f, -3.2f, 5.4f},
+	{7.6f, -9.8f, 1.0f, -3.2f},
+	{-5.4f, 7.6f, 9.8f, -1.0f}
+}};
+
+} // namespace
+
+TEST(Matrix44, MultiplySIMD)
+{
+	if (!(dsSIMD_getHostFeatures() & dsSIMDFeatures_Float4))
+		return;
+
+	dsMatrix44f expected, result;
+	dsMatrix44_mul(expected, testMatrix1, testMatrix2);
+	dsMatrix44f_mulSIMD(&result, &testMatrix1, &testMatrix2);
+	for (int i = 0; i < 4; ++i)
+	{
+		for (int j = 0; j < 4; ++j)
+			EXPECT_EQ(expected.values[i][j], result.values[i][j]);
+	}
+
+	// Result may be the same as the inputs.
+	result = testMatrix2;
+	dsMatrix44f_mulSIMD(&result, &testMatrix1, &result);
+	for (int i = 0; i < 4; ++i)
+	{
+		for (int j = 0; j < 4; ++j)
+			EXPECT_EQ(expected.values[i][j], result.values[i][j]);
+	}
+
+	// The function without a suffix must never use FMA, even when it's always available.
+	dsMatrix44f noSuffixResult;
+	dsMatrix44f_mulSIMD(&result, &testMatrix1, &testMatrix2);
+	dsMatrix44f_mul(&noSuffixResult, &testMatrix1, &testMatrix2);
+	for (int i = 0; i < 4; ++i)
+	{
+		for (int j = 0; j < 4; ++j)
+			EXPECT_EQ(result.values[i][j], noSuffixResult.values[i][j]);
+	}
+
+#if DS_SIMD_HAS_FMA
+	if (dsSIMD_getHostFeatures() & dsSIMDFeatures_FMA)
+	{
+		dsMatrix44f_mulFMA(&result, &testMatrix1, &testMatrix2);
+		for (int i = 0; i < 4; ++i)
+		{
+			for (int j = 0; j < 4; ++j)
+				EXPECT_NEAR(expected.values[i][j], result.values[i][j], 1e-5f);
+		}
+	}
+#endif
+}
+
+TEST(Matrix44, AffineMultiplySIMD)
+{
+	if (!(dsSIMD_getHostFeatures() & dsSIMDFeatures_Float4))
+		return;
+
+	dsMatrix44f a = createAffineMatrix(0.3f, 1.2f);
+	dsMatrix44f b = createAffineMatrix(-1.1f, -4.5f);
+
+	dsMatrix44f expected, result;
+	dsMatrix44_affineMul(expected, a, b);
+	dsMatrix44f_affineMulSIMD(&result, &a, &b);
+	for (int i = 0; i < 4; ++i)
+	{
+		for (int j = 0; j < 4; ++j)
+			EXPECT_EQ(expected.values[i][j], result.values[i][j]);
+	}
+
+	dsMatrix44f noSuffixResult;
+	dsMatrix44f_affineMul(&noSuffixResult, &a, &b);
+	for (int i = 0; i < 4; ++i)
+	{
+		for (int j = 0; j < 4; ++j)
+			EXPECT_EQ(result.values[i][j], noSuffixResult.values[i][j]);
+	}
+
+#if DS_SIMD_HAS_FMA
+	if (dsSIMD_getHostFeatures() & dsSIMDFeatures_FMA)
+	{
+		dsMatrix44f_affineMulFMA(&result, &a, &b);
+		for (int i = 0; i < 4; ++i)
+		{
+			for (int j = 0; j < 4; ++j)
+				EXPECT_NEAR(expected.values[i][j], result.values[i][j], 1e-5f);
+		}
+	}
+#endif
+}
+
+TEST(Matrix44, TransformSIMD)
+{
+	if (!(dsSIMD_getHostFeatures() & dsSIMDFeatures_Float4))
+		return;
+
+	dsVector4f vector = {{-1.0f, 3.2f, -5.4f, 7.6f}};
+	dsVector4f expected, result;
+	dsMatrix44_transform(expected, testMatrix1, vector);
+	dsMatrix44f_transformSIMD(&result, &testMatrix1, &vector);
+	for (int i = 0; i < 4; ++i)
+		EXPECT_EQ(expected.values[i], result.values[i]);
+
+	dsVector4f noSuffixResult;
+	dsMatrix44f_transform(&noSuffixResult, &testMatrix1, &vector);
+	for (int i = 0; i < 4; ++i)
+		EXPECT_EQ(result.values[i], noSuffixResult.values[i]);
+
+#if DS_SIMD_HAS_FMA
+	if (dsSIMD_getHostFeatures() & dsSIMDFeatures_FMA)
+	{
+		dsMatrix44f_transformFMA(&result, &testMatrix1, &vector);
+		for (int i = 0; i < 4; ++i)
+			EXPECT_NEAR(expected.values[i], result.values[i], 1e-5f);
+	}
+#endif
+}
+
+TEST(Matrix44, TransposeSIMD)
+{
+	if (!(dsSIMD_getHostFeatures() & dsSIMDFeatures_Float4))
+		return;
+
+	dsMatrix44f expected, result;
+	dsMatrix44_transpose(expected, testMatrix1);
+	dsMatrix44f_transposeSIMD(&result, &testMatrix1);
+	for (int i = 0; i < 4; ++i)
+	{
+		for (int j = 0; j < 4; ++j)
+			EXPECT_EQ(expected.values[i][j], result.values[i][j]);
+	}
+}
+
+TEST(Matrix44, InvertSIMD)
+{
+	if (!(dsSIMD_getHostFeatures() & dsSIMDFeatures_Float4))
+		return;
+
+	const float epsilon = 1e-5f;
+	dsMatrix44f expected, result;
+	dsMatrix44f_invert(&expected, &testMatrix1);
+	dsMatrix44f_invertSIMD(&result, &testMatrix1);
+	for (int i = 0; i < 4; ++i)
+	{
+		for (int j = 0; j < 4; ++j)
+			EXPECT_NEAR(expected.values[i][j], result.values[i][j], epsilon);
+	}
+
+	dsMatrix44f affine = createAffineMatrix(0.7f, -2.3f);
+	dsMatrix44f_affineInvert(&expected, &affine);
+	dsMatrix44f_affineInvertSIMD(&result, &affine);
+	for (int i = 0; i < 4; ++i)
+	{
+		for (int j = 0; j < 4; ++j)
+			EXPECT_NEAR(expected.values[i][j], result.values[i][j], epsilon);
+	}
+
+	dsMatrix44f_invertSIMD(&result, &affine);
+	for (int i = 0; i < 4; ++i)
+	{
+		for (int j = 0; j < 4; ++j)
+			EXPECT_NEAR(expected.values[i][j], result.values[i][j], epsilon);
+	}
+
+	dsMatrix44f_inverseTranspose(&expected, &affine);
+	dsMatrix44f_inverseTransposeSIMD(&result, &affine);
+	for (int i = 0; i < 4; ++i)
+	{
+		for (int j = 0; j < 4; ++j)
+			EXPECT_NEAR(expected.values[i][j], result.values[i][j], epsilon);
+	}
+}
+
+TEST(Matrix44, DISABLED_SIMDBenchmark)
+{
+	dsSIMDFeatures features = dsSIMD_getHostFeatures();
+	if (!(features & dsSIMDFeatures_Float4))
+		return;
+
+	const unsigned int matrixCount = 1024;
+	const unsigned int iterations = 1000;
+	std::vector<dsMatrix44f> matrices(matrixCount);
+	for (unsigned int i = 0; i < matrixCount; ++i)
+		matrices[i] = createAffineMatrix((float)i*0.01f, (float)i*0.1f);
+	std::vector<dsMatrix44f> results(matrixCount);
+	dsTimer timer = dsTimer_create();
+
+	// Average time of each operation in nanoseconds.
+#define BENCHMARK(name, op) \
+	do \
+	{ \
+		double start = dsTimer_time(timer); \
+		for (unsigned int i = 0; i < iterations; ++i) \
+		{ \
+			for (unsigned int j = 0; j < matrixCount; ++j) \
+			{ \
+				const dsMatrix44f* a = &matrices[j]; \
+				const dsMatrix44f* b = &matrices[(j + i) % matrixCount]; \
+				dsMatrix44f* result = &results[j]; \
+				op; \
+			} \
+		} \
+		double time = dsTimer_time(timer) - start; \
+		testing::Test::RecordProperty(name, std::to_string(time*1e9/(iterations*matrixCount))); \
+	} while (0)
+
+	BENCHMARK("dsMatrix44_mul", dsMatrix44_mul(*result, *a, *b));
+	BENCHMARK("dsMatrix44f_mulSIMD", dsMatrix44f_mulSIMD(result, a, b));
+	BENCHMARK("dsMatrix44_affineMul", dsMatrix44_affineMul(*result, *a, *b));
+	BENCHMARK("dsMatrix44f_affineMulSIMD", dsMatrix44f_affineMulSIMD(result, a, b));
+	BENCHMARK("dsMatrix44f_affineInvert", DS_UNUSED(b); dsMatrix44f_affineInvert(result, a));
+	BENCHMARK("dsMatrix44f_affineInvertSIMD",
+		DS_UNUSED(b); dsMatrix44f_affineInvertSIMD(result, a));
+	BENCHMARK("dsMatrix44f_invert", DS_UNUSED(b); dsMatrix44f_invert(result, a));
+	BENCHMARK("dsMatrix44f_invertSIMD", DS_UNUSED(b); dsMatrix44f_invertSIMD(result, a));
+#if DS_SIMD_HAS_FMA
+	if (features & dsSIMDFeatures_FMA)
+	{
+		BENCHMARK("dsMatrix44f_mulFMA", dsMatrix44f_mulFMA(result, a, b));
+		BENCHMARK("dsMatrix44f_affineMulFMA", dsMatrix44f_affineMulFMA(result, a, b));
+	}
+#endif
+
+#undef BENCHMARK
+}
+
+#endif
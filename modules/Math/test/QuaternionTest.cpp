@@ -456,3 +456,39 @@ TYPED_TEST(QuaternionTest, Slerp)
 	EXPECT_NEAR(q01.j, sq01.j, epsilon);
 	EXPECT_NEAR(q01.k, sq01.k, epsilon);
 }
+
+#if DS_HAS_SIMD
+
+TEST(Quaternion, MultiplySIMD)
+{
+	if (!(dsSIMD_getHostFeatures() & dsSIMDFeatures_Float4))
+		return;
+
+	const float epsilon = 1e-6f;
+	dsVector3f axis = {{1.2f, -3.4f, 2.1f}};
+	dsVector3_normalize(&axis, &axis);
+
+	dsQuaternion4f qa, qb, expected, result;
+	dsQuaternion4f_fromEulerAngles(&qa, (float)M_PI*3/4, (float)-M_PI/3, (float)-M_PI/5);
+	dsQuaternion4f_fromAxisAngle(&qb, &axis, (float)M_PI/3);
+	dsQuaternion4_mul(expected, qa, qb);
+
+	dsQuaternion4f_mulSIMD(&result, &qa, &qb);
+	EXPECT_NEAR(expected.r, result.r, epsilon);
+	EXPECT_NEAR(expected.i, result.i, epsilon);
+	EXPECT_NEAR(expected.j, result.j, epsilon);
+	EXPECT_NEAR(expected.k, result.k, epsilon);
+
+#if DS_SIMD_HAS_FMA
+	if (dsSIMD_getHostFeatures() & dsSIMDFeatures_FMA)
+	{
+		dsQuaternion4f_mulFMA(&result, &qa, &qb);
+		EXPECT_NEAR(expected.r, result.r, epsilon);
+		EXPECT_NEAR(expected.i, result.i, epsilon);
+		EXPECT_NEAR(expected.j, result.j, epsilon);
+		EXPECT_NEAR(expected.k, result.k, epsilon);
+	}
+#endif
+}
+
+#endif
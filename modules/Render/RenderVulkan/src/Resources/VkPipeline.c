@@ -55,7 +55,8 @@ void dsVkPipeline_initializeKey(dsVkPipelineKey* outKey, uint32_t samples, float
 
 uint32_t dsVkPipeline_hash(const dsVkPipelineKey* key)
 {
-	return dsHashBytes(key, sizeof(*key));
+	uint64_t hash = dsHashBytes64(key, sizeof(*key));
+	return (uint32_t)(hash ^ (hash >> 32));
 }
 
 dsVkPipeline* dsVkPipeline_create(dsAllocator* allocator, dsShader* shader,
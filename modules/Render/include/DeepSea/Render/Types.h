@@ -17,6 +17,7 @@
 #pragma once
 
 #include <DeepSea/Core/Config.h>
+#include <DeepSea/Core/Memory/Types.h>
 #include <DeepSea/Core/Thread/Types.h>
 #include <DeepSea/Geometry/Types.h>
 #include <DeepSea/Math/Types.h>
@@ -72,6 +73,13 @@ extern "C"
  */
 #define DS_MAX_ATTACHMENTS 16
 
+/**
+ * @brief The number of frames memory allocated from the renderer frame allocator remains valid.
+ *
+ * This covers the frames that may be in flight on the GPU.
+ */
+#define DS_RENDERER_FRAME_ALLOCATOR_FRAMES 3
+
 /**
  * @brief The size of the UUID that uniquely identifies a device.
  */
@@ -1838,6 +1846,15 @@ struct dsRenderer
 	 */
 	uint64_t frameNumber;
 
+	/**
+	 * @brief Allocator for transient memory used during a frame.
+	 *
+	 * This may be allocated from any thread. Memory allocated from it remains valid until
+	 * dsRenderer_beginFrame() is called DS_RENDERER_FRAME_ALLOCATOR_FRAMES more times, and is
+	 * recycled automatically afterward.
+	 */
+	dsFrameAllocator* frameAllocator;
+
 	// --------------------------------- Renderer capabilities -------------------------------------
 
 	/**
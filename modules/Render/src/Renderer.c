@@ -17,6 +17,7 @@
 #include <DeepSea/Render/Renderer.h>
 
 #include "GPUProfileContext.h"
+#include <DeepSea/Core/Memory/FrameAllocator.h>
 #include <DeepSea/Core/Thread/Thread.h>
 #include <DeepSea/Core/Assert.h>
 #include <DeepSea/Core/Error.h>
@@ -521,6 +522,7 @@ bool dsRenderer_beginFrame(dsRenderer* renderer)
 
 	++renderer->frameNumber;
 	renderer->mainCommandBuffer->frameActive = true;
+	DS_VERIFY(dsFrameAllocator_beginFrame(renderer->frameAllocator, renderer->frameNumber));
 
 	// Gurarantee that errors in one frame won't carry over into the next.
 	renderer->mainCommandBuffer->boundSurface = NULL;
@@ -1474,6 +1476,11 @@ bool dsRenderer_initializeResources(dsRenderer* renderer)
 		return false;
 	}
 
+	renderer->frameAllocator = dsFrameAllocator_create(renderer->allocator,
+		DS_RENDERER_FRAME_ALLOCATOR_FRAMES, 0);
+	if (!renderer->frameAllocator)
+		return false;
+
 	renderer->_profileContext = dsGPUProfileContext_create(renderer->resourceManager,
 		renderer->allocator);
 	return true;
@@ -1488,6 +1495,8 @@ bool dsRenderer_shutdownResources(dsRenderer* renderer)
 	}
 
 	dsGPUProfileContext_destroy(renderer->_profileContext);
+	dsFrameAllocator_destroy(renderer->frameAllocator);
+	renderer->frameAllocator = NULL;
 	return true;
 }
 
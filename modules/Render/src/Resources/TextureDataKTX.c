@@ -16,6 +16,7 @@
 
 #include <DeepSea/Render/Resources/TextureData.h>
 
+#include <DeepSea/Core/Streams/BufferedStream.h>
 #include <DeepSea/Core/Streams/FileStream.h>
 #include <DeepSea/Core/Streams/ResourceStream.h>
 #include <DeepSea/Core/Streams/Stream.h>
@@ -187,6 +188,9 @@
 #define GL_COMPRESSED_SRGB_ALPHA_PVRTC_2BPPV2_IMG 0x93F0
 #define GL_COMPRESSED_SRGB_ALPHA_PVRTC_4BPPV2_IMG 0x93F1
 
+// Maximum number of rows to read in a single vectored read.
+#define KTX_ROW_BATCH_SIZE 32U
+
 static char ktxHeader[12] =
 {
 	'\xAB', 'K', 'T', 'X', ' ', '1', '1', '\xBB', '\r', '\n', '\x1A', '\n'
@@ -889,17 +893,9 @@ static dsGfxFormat getTextureFormat(uint32_t glType, uint32_t glFormat, uint32_t
 	return dsGfxFormat_Unknown;
 }
 
-dsTextureData* dsTextureData_loadKTX(bool* isKTX, dsAllocator* allocator, dsStream* stream,
+static dsTextureData* loadKTXImpl(bool* isKTX, dsAllocator* allocator, dsStream* stream,
 	const char* filePath)
 {
-	if (isKTX)
-		*isKTX = false;
-	if (!allocator || !stream)
-	{
-		errno = EINVAL;
-		return NULL;
-	}
-
 	char header[sizeof(ktxHeader)];
 	if (dsStream_read(stream, header, sizeof(header)) != sizeof(header))
 	{
@@ -997,6 +993,7 @@ dsTextureData* dsTextureData_loadKTX(bool* isKTX, dsAllocator* allocator, dsStre
 	bool compressed = dsGfxFormat_compressedIndex(format) > 0;
 
 	size_t curOffset = 0;
+	uint8_t paddingData[3];
 	for (uint32_t mip = 0; mip < mipLevels; ++mip)
 	{
 		uint32_t imageSize;
@@ -1037,24 +1034,29 @@ dsTextureData* dsTextureData_loadKTX(bool* isKTX, dsAllocator* allocator, dsStre
 					if (padding != 0)
 						padding = 4 - padding;
 
-					for (uint32_t h = 0; h < curHeight; ++h)
+					// Read batches of rows at once, discarding the padding after each row.
+					for (uint32_t h = 0; h < curHeight;)
 					{
-						if (dsStream_read(stream, textureData->data + curOffset, rowSize) !=
-							rowSize)
+						uint32_t rowCount = dsMin(curHeight - h, KTX_ROW_BATCH_SIZE);
+						dsStreamBuffer buffers[KTX_ROW_BATCH_SIZE*2];
+						for (uint32_t r = 0; r < rowCount; ++r)
 						{
-							ktxSizeError(filePath);
-							dsTextureData_destroy(textureData);
-							return NULL;
+							buffers[r*2].data = textureData->data + curOffset + r*rowSize;
+							buffers[r*2].size = rowSize;
+							buffers[r*2 + 1].data = paddingData;
+							buffers[r*2 + 1].size = padding;
 						}
 
-						if (!skipBytes(stream, padding, filePath))
+						size_t readSize = (size_t)(rowSize + padding)*rowCount;
+						if (dsStream_readv(stream, buffers, rowCount*2) != readSize)
 						{
 							ktxSizeError(filePath);
 							dsTextureData_destroy(textureData);
 							return NULL;
 						}
 
-						curOffset += rowSize;
+						h += rowCount;
+						curOffset += rowSize*rowCount;
 					}
 				}
 			}
@@ -1066,6 +1068,30 @@ dsTextureData* dsTextureData_loadKTX(bool* isKTX, dsAllocator* allocator, dsStre
 	return textureData;
 }
 
+dsTextureData* dsTextureData_loadKTX(bool* isKTX, dsAllocator* allocator, dsStream* stream,
+	const char* filePath)
+{
+	if (isKTX)
+		*isKTX = false;
+	if (!allocator || !stream)
+	{
+		errno = EINVAL;
+		return NULL;
+	}
+
+	// Buffer the many small reads for the header fields and rows. Closing the buffered stream
+	// restores the position of the original stream for any data read ahead.
+	uint8_t buffer[DS_DEFAULT_STREAM_BUFFER_SIZE];
+	dsBufferedStream bufferedStream;
+	if (!dsBufferedStream_open(&bufferedStream, stream, buffer, sizeof(buffer)))
+		return NULL;
+
+	dsTextureData* textureData = loadKTXImpl(isKTX, allocator, (dsStream*)&bufferedStream,
+		filePath);
+	dsBufferedStream_close(&bufferedStream);
+	return textureData;
+}
+
 dsTextureData* dsTextureData_loadKTXFile(dsAllocator* allocator, const char* filePath)
 {
 	DS_PROFILE_FUNC_START();
@@ -16,6 +16,7 @@
 
 #include <DeepSea/Render/Resources/TextureData.h>
 
+#include <DeepSea/Core/Streams/BufferedStream.h>
 #include <DeepSea/Core/Streams/FileStream.h>
 #include <DeepSea/Core/Streams/ResourceStream.h>
 #include <DeepSea/Core/Streams/Stream.h>
@@ -303,17 +304,9 @@ static bool readMetadata(dsStream* stream, dsGfxFormat* format, uint32_t* depth,
 	return true;
 }
 
-dsTextureData* dsTextureData_loadPVR(bool* isPVR, dsAllocator* allocator, dsStream* stream,
+static dsTextureData* loadPVRImpl(bool* isPVR, dsAllocator* allocator, dsStream* stream,
 	const char* filePath)
 {
-	if (isPVR)
-		*isPVR = true;
-	if (!allocator || !stream)
-	{
-		errno = EINVAL;
-		return NULL;
-	}
-
 	uint32_t version;
 	if (!readUInt32(stream, &version, filePath))
 		return NULL;
@@ -509,6 +502,30 @@ dsTextureData* dsTextureData_loadPVR(bool* isPVR, dsAllocator* allocator, dsStre
 	return textureData;
 }
 
+dsTextureData* dsTextureData_loadPVR(bool* isPVR, dsAllocator* allocator, dsStream* stream,
+	const char* filePath)
+{
+	if (isPVR)
+		*isPVR = true;
+	if (!allocator || !stream)
+	{
+		errno = EINVAL;
+		return NULL;
+	}
+
+	// Buffer the small reads for the header and metadata. The texture data itself is large enough
+	// to bypass the buffer.
+	uint8_t buffer[DS_DEFAULT_STREAM_BUFFER_SIZE];
+	dsBufferedStream bufferedStream;
+	if (!dsBufferedStream_open(&bufferedStream, stream, buffer, sizeof(buffer)))
+		return NULL;
+
+	dsTextureData* textureData = loadPVRImpl(isPVR, allocator, (dsStream*)&bufferedStream,
+		filePath);
+	dsBufferedStream_close(&bufferedStream);
+	return textureData;
+}
+
 dsTextureData* dsTextureData_loadPVRFile(dsAllocator* allocator, const char* filePath)
 {
 	DS_PROFILE_FUNC_START();
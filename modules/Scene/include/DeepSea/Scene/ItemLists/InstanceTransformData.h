@@ -29,11 +29,20 @@ extern "C"
  * @file
  * @brief Functions for creating dsSceneInstanceData instances that manage instance tansforms.
  *
- * This populates the uniforms found in DeepSea/Scene/Shaders/InstanceTransform.mslh
+ * This populates the uniforms found in DeepSea/Scene/Shaders/InstanceTransform.mslh, or
+ * DeepSea/Scene/Shaders/InstanceTransformArray.mslh when drawing with instancing.
  *
  * @see dsSceneInstanceData
  */
 
+/**
+ * @brief The number of instance transforms in the array when drawing with instancing.
+ *
+ * This must match DS_INSTANCE_TRANSFORM_ARRAY_SIZE in
+ * DeepSea/Scene/Shaders/InstanceTransformArray.mslh.
+ */
+#define DS_INSTANCE_TRANSFORM_ARRAY_SIZE 64
+
 /**
  * @brief The instance transform data type name.
  */
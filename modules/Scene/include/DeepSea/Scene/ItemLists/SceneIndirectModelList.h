@@ -0,0 +1,132 @@
+/*
+ * Copyright 2020 Aaron Barany
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <DeepSea/Core/Config.h>
+#include <DeepSea/Scene/Export.h>
+#include <DeepSea/Scene/Types.h>
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+/**
+ * @file
+ * @brief Functions for creating and manipulating indirect model lists.
+ *
+ * Indirect model lists keep the models for each node in GPU buffers, only uploading the data
+ * again when nodes are added, removed, or moved. Each model has an indirect draw command, and the
+ * commands are grouped into batches with the same shader, material, geometry, and primitive type
+ * that are each drawn with a single indirect draw. This keeps the CPU cost of drawing dependent
+ * on the number of batches rather than the number of models.
+ *
+ * Culling and LOD selection based on the model distance ranges are performed with a compute
+ * shader on the GPU, which sets the instance count of each draw command to 0 or 1. This is done
+ * by a separate cull item list created with dsSceneIndirectModelList_createCullList(). The cull
+ * list also rebuilds the batches and uploads any changed data to the GPU, so it's required even if
+ * the cull shader does nothing.
+ *
+ * The cull list must be placed in the shared items of the scene. Shared items are committed and
+ * synchronized before the scene pipeline, so the cull list finishes modifying the data before the
+ * model list draws with it, even when the scene is drawn with multiple threads. Placing the cull
+ * list in the scene pipeline instead may cause it to modify the data while it's being drawn.
+ *
+ * The buffers and the functions to perform the culling in the shaders are declared in
+ * DeepSea/Scene/Shaders/IndirectModel.mslh. The first instance of each draw is set to the index of
+ * its model, so the vertex shader can access the model data with the instance index. This
+ * requires the renderer to support the start instance for draws.
+ *
+ * @see dsSceneIndirectModelList
+ */
+
+/**
+ * @brief The scene indirect model list type name.
+ */
+DS_SCENE_EXPORT extern const char* const dsSceneIndirectModelList_typeName;
+
+/**
+ * @brief The scene indirect model cull list type name.
+ */
+DS_SCENE_EXPORT extern const char* const dsSceneIndirectModelList_cullTypeName;
+
+/**
+ * @brief The number of models processed by each work group of the cull compute shader.
+ *
+ * This must match DS_INDIRECT_MODEL_CULL_GROUP_SIZE in DeepSea/Scene/Shaders/IndirectModel.mslh.
+ */
+#define DS_INDIRECT_MODEL_CULL_GROUP_SIZE 64
+
+/**
+ * @brief Creates a scene indirect model list.
+ * @remark errno will be set on failure.
+ * @param allocator The allocator to create the list with. This must support freeing memory.
+ * @param name The name of the model list. This will be copied.
+ * @param resourceManager The resource manager to create the GPU buffers with. This must support
+ *     indirect draws, uniform buffers, and the start instance for draws.
+ * @param renderStates The render states to use, or NULL if no special render states are needed.
+ * @return The model list or NULL if an error occurred.
+ */
+DS_SCENE_EXPORT dsSceneIndirectModelList* dsSceneIndirectModelList_create(dsAllocator* allocator,
+	const char* name, dsResourceManager* resourceManager,
+	const dsDynamicRenderStates* renderStates);
+
+/**
+ * @brief Creates the item list to upload the model data and cull the models for an indirect
+ *     model list.
+ *
+ * The shader should use dsIndirectModelCull() from DeepSea/Scene/Shaders/IndirectModel.mslh,
+ * with a work group size of DS_INDIRECT_MODEL_CULL_GROUP_SIZE. The cull list must be placed in
+ * the shared items of the scene.
+ *
+ * @remark errno will be set on failure.
+ * @param allocator The allocator to create the list with. This must support freeing memory.
+ * @param name The name of the cull list. This will be copied.
+ * @param modelList The model list to cull. This must remain alive at least as long as the cull
+ *     list.
+ * @param shader The compute shader to cull with.
+ * @param material The material to use with the shader.
+ * @return The cull list or NULL if an error occurred.
+ */
+DS_SCENE_EXPORT dsSceneItemList* dsSceneIndirectModelList_createCullList(dsAllocator* allocator,
+	const char* name, dsSceneIndirectModelList* modelList, dsShader* shader, dsMaterial* material);
+
+/**
+ * @brief Gets the render states for an indirect model list.
+ * @param modelList The model list.
+ * @return The render states or NULL if no special render states are used.
+ */
+DS_SCENE_EXPORT const dsDynamicRenderStates* dsSceneIndirectModelList_getRenderStates(
+	const dsSceneIndirectModelList* modelList);
+
+/**
+ * @brief Sets the render states for an indirect model list.
+ * @param modelList The model list.
+ * @param renderStates The render states or NULL if no special render states are needed.
+ */
+DS_SCENE_EXPORT void dsSceneIndirectModelList_setRenderStates(dsSceneIndirectModelList* modelList,
+	const dsDynamicRenderStates* renderStates);
+
+/**
+ * @brief Destroys an indirect model list.
+ * @param modelList The model list.
+ */
+DS_SCENE_EXPORT void dsSceneIndirectModelList_destroy(dsSceneIndirectModelList* modelList);
+
+#ifdef __cplusplus
+}
+#endif
@@ -77,6 +77,22 @@ DS_SCENE_EXPORT bool dsSceneInstanceData_populateData(dsSceneInstanceData* insta
 DS_SCENE_EXPORT bool dsSceneInstanceData_bindInstance(dsSceneInstanceData* instanceData,
 	uint32_t index, dsSharedMaterialValues* values);
 
+/**
+ * @brief Binds the data for a range of instances to draw with a single instanced draw.
+ *
+ * Instance firstIndex + i will be accessed with the instance ID i in the shader. This requires
+ * maxInstanceRange on the instance data to be non-zero.
+ *
+ * @remark errno will be set on failure.
+ * @param instanceData The instance data.
+ * @param firstIndex The index of the first instance to bind.
+ * @param count The number of instances to bind. This must not be larger than maxInstanceRange.
+ * @param values The values to bind to.
+ * @return False if an error occurred.
+ */
+DS_SCENE_EXPORT bool dsSceneInstanceData_bindInstanceRange(dsSceneInstanceData* instanceData,
+	uint32_t firstIndex, uint32_t count, dsSharedMaterialValues* values);
+
 /**
  * @brief Finishes the current set of instance data.
  *
@@ -51,6 +51,36 @@ DS_SCENE_EXPORT dsSceneInstanceData* dsSceneInstanceVariables_create(dsAllocator
 	dsPopulateSceneInstanceVariablesFunction populateDataFunc, void* userData,
 	dsDestroySceneUserDataFunction destroyUserDataFunc);
 
+/**
+ * @brief Creates a scene instance variables object that may bind ranges of instances.
+ *
+ * When maxInstanceRange is greater than 1, ranges of instances may be bound to be drawn with a
+ * single instanced draw. The shader is expected to declare the uniform block as an array of
+ * maxInstanceRange elements, indexed by the instance ID. This is only supported when the data is
+ * stored in uniform blocks without any padding between instances, otherwise maxInstanceRange on the
+ * returned object will be 0.
+ *
+ * @remark errno will be set on failure.
+ * @param allocator The allocator to create the data with. This must support freeing memory.
+ * @param resourceManager The resource manager to create any resources with.
+ * @param dataDesc The description for the data held for each instance. This must remain alive at
+ *     least as long as the instance data object.
+ * @param nameID The name ID to use when setting the buffer data on the dsSharedMaterialValues
+ *     instance.
+ * @param populateDataFunc Function to populate the instance data.
+ * @param userData The user data that will be provided to populateDataFunc. This may be NULL.
+ * @param destroyUserDataFunc Function to destroy the user data. This may be NULL. This will be
+ *     called if creation fails.
+ * @param maxInstanceRange The maximum number of instances to bind at once. Use 0 or 1 to only bind
+ *     individual instances.
+ * @return The instance data or NULL if an error occurred.
+ */
+DS_SCENE_EXPORT dsSceneInstanceData* dsSceneInstanceVariables_createRanged(
+	dsAllocator* allocator, dsResourceManager* resourceManager,
+	const dsShaderVariableGroupDesc* dataDesc, uint32_t nameID,
+	dsPopulateSceneInstanceVariablesFunction populateDataFunc, void* userData,
+	dsDestroySceneUserDataFunction destroyUserDataFunc, uint32_t maxInstanceRange);
+
 #ifdef __cplusplus
 }
 #endif
@@ -70,6 +70,54 @@ DS_SCENE_EXPORT dsModelSortType dsSceneModelList_getSortType(const dsSceneModelL
 DS_SCENE_EXPORT void dsSceneModelList_setSortType(dsSceneModelList* modelList,
 	dsModelSortType sortType);
 
+/**
+ * @brief Gets whether or not the sorted order from the previous commit is re-used.
+ * @param modelList The model list.
+ * @return True if the previous sorted order is re-used.
+ */
+DS_SCENE_EXPORT bool dsSceneModelList_getReuseSortOrder(const dsSceneModelList* modelList);
+
+/**
+ * @brief Sets whether or not the sorted order from the previous commit is re-used.
+ *
+ * When enabled, which is the default, the draw items will start from the previous sorted order
+ * when the number of draw items is unchanged. This is faster when the order only changes slightly
+ * between commits, falling back to a full sort when the items are too far out of order.
+ *
+ * @param modelList The model list.
+ * @param reuse True to re-use the previous sorted order.
+ */
+DS_SCENE_EXPORT void dsSceneModelList_setReuseSortOrder(dsSceneModelList* modelList, bool reuse);
+
+/**
+ * @brief Gets whether or not instancing is enabled for a model list.
+ * @param modelList The model list.
+ * @return True if instancing is enabled.
+ */
+DS_SCENE_EXPORT bool dsSceneModelList_getInstancing(const dsSceneModelList* modelList);
+
+/**
+ * @brief Sets whether or not instancing is enabled for a model list.
+ *
+ * When enabled, consecutive draw items after sorting with the same shader, material, geometry, and
+ * draw range will be merged into a single instanced draw. This requires all instance data to
+ * support binding ranges of instances, such as dsInstanceTransformData, and the shaders to access
+ * the instance data as arrays indexed by the instance ID, such as with
+ * DeepSea/Scene/Shaders/InstanceTransformArray.mslh. Each instance will be bound through
+ * dsSceneInstanceData_bindInstanceRange(), even when not merged with other draws. Instancing will
+ * be ignored if any of the instance data doesn't support ranges or there is no instance data.
+ *
+ * Models that draw multiple instances by themselves are never merged. Their instance data is
+ * repeated for each of their instance IDs, so the first instance plus the instance count must not
+ * exceed the maximum instance range, such as DS_INSTANCE_TRANSFORM_ARRAY_SIZE.
+ *
+ * This is disabled by default.
+ *
+ * @param modelList The model list.
+ * @param instancing True to enable instancing.
+ */
+DS_SCENE_EXPORT void dsSceneModelList_setInstancing(dsSceneModelList* modelList, bool instancing);
+
 /**
  * @brief Gets the render states for a model list.
  * @param modelList The model list.
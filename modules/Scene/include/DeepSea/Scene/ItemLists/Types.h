@@ -106,6 +106,21 @@ typedef bool (*dsPopulateSceneInstanceDataFunction)(dsSceneInstanceData* instanc
 typedef bool (*dsBindSceneInstanceDataFunction)(dsSceneInstanceData* instanceData, uint32_t index,
 	dsSharedMaterialValues* values);
 
+/**
+ * @brief Function for binding scene instance data for a range of instances to draw at once.
+ *
+ * Instance firstIndex + i should be accessed with the instance ID i in the shader.
+ *
+ * @remark errno should be set on failure.
+ * @param instanceData The instance data.
+ * @param firstIndex The index of the first instance to set.
+ * @param count The number of instances to set.
+ * @param values The material values to bind to.
+ * @return False if an error occurred.
+ */
+typedef bool (*dsBindSceneInstanceRangeFunction)(dsSceneInstanceData* instanceData,
+	uint32_t firstIndex, uint32_t count, dsSharedMaterialValues* values);
+
 /**
  * @brief Function for finishing the current set of instance data.
  * @remark errno should be set on failure.
@@ -135,6 +150,13 @@ struct dsSceneInstanceData
 	 */
 	uint32_t valueCount;
 
+	/**
+	 * @brief The maximum number of instances that may be bound at once with bindInstanceRangeFunc.
+	 *
+	 * This will be 0 if ranges of instances aren't supported.
+	 */
+	uint32_t maxInstanceRange;
+
 	/**
 	 * @brief Data populate function.
 	 */
@@ -145,6 +167,13 @@ struct dsSceneInstanceData
 	 */
 	dsBindSceneInstanceDataFunction bindInstanceFunc;
 
+	/**
+	 * @brief Bind instance range function.
+	 *
+	 * This may be NULL if ranges of instances aren't supported.
+	 */
+	dsBindSceneInstanceRangeFunction bindInstanceRangeFunc;
+
 	/**
 	 * @brief Finish function.
 	 */
@@ -211,6 +240,35 @@ typedef void (*dsRemoveSceneItemListNodeFunction)(dsSceneItemList* itemList, uin
 typedef void (*dsCommitSceneItemListFunction)(dsSceneItemList* itemList, const dsView* view,
 	dsCommandBuffer* commandBuffer);
 
+/**
+ * @brief Function for preparing to commit a scene item list across multiple threads.
+ *
+ * This is called on the main thread before any ranges are committed. The implementation should
+ * split its items into index ranges and reserve any memory that will be written to by
+ * dsCommitSceneItemListRangeFunction, since the ranges will be processed concurrently.
+ *
+ * @param itemList The scene item list to prepare.
+ * @param view The view to draw to.
+ * @param maxRanges The maximum number of ranges to split into.
+ * @return The number of ranges that were created. If 0 no ranges will be committed, and the
+ *     commit function will process all of the items as normal.
+ */
+typedef uint32_t (*dsPrepareSceneItemListRangesFunction)(dsSceneItemList* itemList,
+	const dsView* view, uint32_t maxRanges);
+
+/**
+ * @brief Function for committing a range of a scene item list.
+ *
+ * Different ranges may be committed concurrently on different threads. Once all ranges have
+ * finished, dsCommitSceneItemListFunction will be called to merge the results.
+ *
+ * @param itemList The scene item list to commit.
+ * @param view The view to draw to.
+ * @param range The index of the range to commit.
+ */
+typedef void (*dsCommitSceneItemListRangeFunction)(dsSceneItemList* itemList,
+	const dsView* view, uint32_t range);
+
 /**
  * @brief Function for destroying a scene item list.
  * @param itemList The scene item list to destroy.
@@ -257,8 +315,24 @@ struct dsSceneItemList
 	 */
 	dsRemoveSceneItemListNodeFunction removeNodeFunc;
 
+	/**
+	 * @brief Function for preparing to commit the scene item list in ranges.
+	 *
+	 * This may be NULL if the item list can't be split across threads.
+	 */
+	dsPrepareSceneItemListRangesFunction prepareRangesFunc;
+
+	/**
+	 * @brief Function for committing a range of the scene item list.
+	 *
+	 * This must be set if prepareRangesFunc is set.
+	 */
+	dsCommitSceneItemListRangeFunction commitRangeFunc;
+
 	/**
 	 * @brief Function for committing the scene item list.
+	 *
+	 * When ranges were committed, this will be called after all ranges have finished.
 	 */
 	dsCommitSceneItemListFunction commitFunc;
 
@@ -277,6 +351,16 @@ struct dsSceneItemList
  */
 typedef struct dsSceneModelList dsSceneModelList;
 
+/**
+ * @brief Scene item list implementation for drawing models with culling and draw calls generated
+ *     on the GPU.
+ *
+ * This will hold information from dsSceneModelNode node types.
+ *
+ * @see SceneIndirectModelList.h
+ */
+typedef struct dsSceneIndirectModelList dsSceneIndirectModelList;
+
 #ifdef __cplusplus
 }
 #endif
@@ -0,0 +1,58 @@
+/*
+ * Copyright 2020 Aaron Barany
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <DeepSea/Core/Config.h>
+#include <DeepSea/Scene/Export.h>
+#include <DeepSea/Scene/Types.h>
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+/**
+ * @file
+ * @brief Functions for creating and manipulating cull lists that use a bounding volume hierarchy.
+ *
+ * This is a drop-in replacement for a view cull list, where the item data is treated as a bool
+ * value for whether or not the item is out of view. In other words, check if the void* value is
+ * zero if it's in view or non-zero for out of view.
+ *
+ * The world-space bounds of the nodes are kept in a BVH, which is updated incrementally when nodes
+ * are added, removed, or have their transforms or bounds changed. Only the changed nodes and their
+ * ancestors are refit, and subtrees are re-built once they become too expensive to traverse.
+ * Culling traverses the BVH, rejecting and accepting entire subtrees at once, so the cost is
+ * proportional to the number of visible nodes rather than the total number of nodes. This is best
+ * suited for large scenes where only a small portion of the nodes are in view.
+ *
+ * @see ViewCullList.h
+ */
+
+/**
+ * @brief Creates a view BVH cull list.
+ * @remark errno will be set on failure.
+ * @param allocator The allocator to create the list with. This must support freeing memory.
+ * @param name The name of the cull list. This will be copied.
+ * @return The cull list or NULL if an error occurred.
+ */
+DS_SCENE_EXPORT dsSceneItemList* dsViewBVHCullList_create(dsAllocator* allocator,
+	const char* name);
+
+#ifdef __cplusplus
+}
+#endif
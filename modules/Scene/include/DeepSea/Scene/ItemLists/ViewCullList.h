@@ -31,6 +31,9 @@ extern "C"
  *
  * The item data is treated as a bool value for whether or not the item is out of view. In other
  * words, check if the void* value is zero if it's in view or non-zero for out of view.
+ *
+ * The world-space bounds are cached and only updated when a node's transform changes or its bounds
+ * are set with dsSceneModelNode_setBounds().
  */
 
 /**
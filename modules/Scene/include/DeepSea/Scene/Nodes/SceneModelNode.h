@@ -91,6 +91,24 @@ DS_SCENE_EXPORT dsSceneModelNode* dsSceneModelNode_createBase(dsAllocator* alloc
 	const char** extraItemLists, uint32_t extraItemListCount,  dsSceneResources** resources,
 	uint32_t resourceCount, const dsOrientedBox3f* bounds);
 
+/**
+ * @brief Sets the bounds for a model node.
+ *
+ * Item lists such as cull lists may cache the world-space bounds, so this should be used rather
+ * than modifying the bounds member directly. The node will be updated with the next call to
+ * dsScene_update().
+ *
+ * Item lists that skip nodes without bounds when they're added, such as dsViewBVHCullList, won't
+ * start culling a node that was created without bounds.
+ *
+ * @remark errno will be set on failure.
+ * @param node The model node.
+ * @param bounds The new bounding box for the model. This must be valid.
+ * @return False if the parameters are invalid.
+ */
+DS_SCENE_EXPORT bool dsSceneModelNode_setBounds(dsSceneModelNode* node,
+	const dsOrientedBox3f* bounds);
+
 /**
  * @brief Destroys a model node.
  * @remark This should only be called as part of a subclass' destroy function, never to explicitly
@@ -348,6 +348,9 @@ typedef struct dsSceneModelNode
 
 	/**
 	 * @brief The bounding box for the model.
+	 *
+	 * Use dsSceneModelNode_setBounds() to change the bounds so cached bounds in item lists are
+	 * updated.
 	 */
 	dsOrientedBox3f bounds;
 } dsSceneModelNode;
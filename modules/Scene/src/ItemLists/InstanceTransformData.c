@@ -57,11 +57,67 @@ dsShaderVariableGroupDesc* dsInstanceTransformData_createShaderVariableGroupDesc
 		DS_ARRAY_SIZE(elements));
 }
 
+#if DS_HAS_SIMD
+DS_SIMD_FUNC_FLOAT4
+static void populateDataSIMD(const dsView* view, const dsSceneInstanceInfo* instances,
+	uint32_t instanceCount, uint8_t* data, uint32_t stride)
+{
+	for (uint32_t i = 0, offset = 0; i < instanceCount; ++i, offset += stride)
+	{
+		const dsSceneInstanceInfo* instance = instances + i;
+		InstanceTransform transform;
+		transform.world = instance->transform;
+		dsMatrix44f_inverseTransposeSIMD(&transform.worldInvTrans, &transform.world);
+		dsMatrix44f_affineMulSIMD(&transform.worldView, &view->viewMatrix, &instance->transform);
+		dsMatrix44f_mulSIMD(&transform.worldViewProj, &view->projectionMatrix,
+			&transform.worldView);
+
+		*(InstanceTransform*)(data + offset) = transform;
+	}
+}
+
+#if DS_SIMD_HAS_FMA
+DS_SIMD_FUNC_FMA
+static void populateDataFMA(const dsView* view, const dsSceneInstanceInfo* instances,
+	uint32_t instanceCount, uint8_t* data, uint32_t stride)
+{
+	for (uint32_t i = 0, offset = 0; i < instanceCount; ++i, offset += stride)
+	{
+		const dsSceneInstanceInfo* instance = instances + i;
+		InstanceTransform transform;
+		transform.world = instance->transform;
+		dsMatrix44f_inverseTransposeSIMD(&transform.worldInvTrans, &transform.world);
+		dsMatrix44f_affineMulFMA(&transform.worldView, &view->viewMatrix, &instance->transform);
+		dsMatrix44f_mulFMA(&transform.worldViewProj, &view->projectionMatrix,
+			&transform.worldView);
+
+		*(InstanceTransform*)(data + offset) = transform;
+	}
+}
+#endif
+#endif
+
 void dsInstanceTransformData_populateData(void* userData, const dsView* view,
 	const dsSceneInstanceInfo* instances, uint32_t instanceCount, uint8_t* data, uint32_t stride)
 {
 	DS_UNUSED(userData);
 	DS_ASSERT(stride >= sizeof(InstanceTransform));
+#if DS_HAS_SIMD
+	dsSIMDFeatures features = dsSIMD_getHostFeatures();
+#if DS_SIMD_HAS_FMA
+	if (features & dsSIMDFeatures_FMA)
+	{
+		populateDataFMA(view, instances, instanceCount, data, stride);
+		return;
+	}
+#endif
+	if (features & dsSIMDFeatures_Float4)
+	{
+		populateDataSIMD(view, instances, instanceCount, data, stride);
+		return;
+	}
+#endif
+
 	for (uint32_t i = 0, offset = 0; i < instanceCount; ++i, offset += stride)
 	{
 		const dsSceneInstanceInfo* instance = instances + i;
@@ -98,7 +154,7 @@ dsSceneInstanceData* dsInstanceTransformData_create(dsAllocator* allocator,
 		return NULL;
 	}
 
-	return dsSceneInstanceVariables_create(allocator, resourceManager, transformDesc,
+	return dsSceneInstanceVariables_createRanged(allocator, resourceManager, transformDesc,
 		dsHashString(dsInstanceTransformData_typeName),
-		&dsInstanceTransformData_populateData, NULL, NULL);
+		&dsInstanceTransformData_populateData, NULL, NULL, DS_INSTANCE_TRANSFORM_ARRAY_SIZE);
 }
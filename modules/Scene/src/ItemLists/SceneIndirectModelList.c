@@ -0,0 +1,866 @@
+/*
+ * Copyright 2020 Aaron Barany
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <DeepSea/Scene/ItemLists/SceneIndirectModelList.h>
+
+#include <DeepSea/Core/Containers/Hash.h>
+#include <DeepSea/Core/Containers/ResizeableArray.h>
+#include <DeepSea/Core/Containers/SlotMap.h>
+#include <DeepSea/Core/Memory/Allocator.h>
+#include <DeepSea/Core/Memory/BufferAllocator.h>
+#include <DeepSea/Core/Assert.h>
+#include <DeepSea/Core/Error.h>
+#include <DeepSea/Core/Log.h>
+#include <DeepSea/Core/Profile.h>
+#include <DeepSea/Core/TypedSort.h>
+#include <DeepSea/Geometry/AlignedBox3.h>
+#include <DeepSea/Geometry/OrientedBox3.h>
+#include <DeepSea/Render/Resources/GfxBuffer.h>
+#include <DeepSea/Render/Resources/Shader.h>
+#include <DeepSea/Render/Resources/SharedMaterialValues.h>
+#include <DeepSea/Render/Renderer.h>
+#include <DeepSea/Scene/Nodes/SceneModelNode.h>
+#include <DeepSea/Scene/Nodes/SceneNode.h>
+
+#include <string.h>
+
+// Names for the buffers in IndirectModel.mslh.
+#define INSTANCES_NAME "IndirectModelInstances"
+#define COMMANDS_NAME "IndirectModelCommands"
+
+// Upload all instances rather than individual instances when more than this fraction change.
+#define FULL_UPLOAD_DIVISOR 4
+
+// Must match dsIndirectModelInstance in IndirectModel.mslh.
+typedef struct GPUInstance
+{
+	dsMatrix44f world;
+	// The w component is 0 if the bounds are invalid, in which case the model is never culled.
+	dsVector4f boundsCenter;
+	dsVector4f boundsExtents;
+	dsVector2f distanceRange;
+	uint32_t commandIndex;
+	uint32_t padding;
+} GPUInstance;
+
+_Static_assert(sizeof(GPUInstance) == 112, "Unexpected GPUInstance size.");
+
+// Both indexed and non-indexed draws use the same stride so the instance count is always the
+// second element.
+typedef union IndirectCommand
+{
+	dsDrawIndexedRange drawIndexedRange;
+	dsDrawRange drawRange;
+} IndirectCommand;
+
+typedef struct Entry
+{
+	const dsSceneModelNode* node;
+	const dsMatrix44f* transform;
+	// Range within entryInstances.
+	uint32_t firstInstance;
+	uint32_t instanceCount;
+	bool dirty;
+} Entry;
+
+typedef struct DrawRef
+{
+	const dsSceneModelInfo* model;
+	uint32_t entry;
+} DrawRef;
+
+typedef struct Batch
+{
+	dsShader* shader;
+	dsMaterial* material;
+	dsDrawGeometry* geometry;
+	dsPrimitiveType primitiveType;
+	uint32_t firstCommand;
+	uint32_t commandCount;
+} Batch;
+
+struct dsSceneIndirectModelList
+{
+	dsSceneItemList itemList;
+	dsResourceManager* resourceManager;
+
+	dsDynamicRenderStates renderStates;
+	bool hasRenderStates;
+
+	uint32_t instancesNameID;
+	dsSharedMaterialValues* instanceValues;
+
+	// Node IDs are slot map handles for the entries.
+	dsSlotMap entrySlots;
+	Entry* entries;
+	uint32_t entryCount;
+	uint32_t maxEntries;
+
+	uint32_t* dirtyEntries;
+	uint32_t dirtyEntryCount;
+	uint32_t maxDirtyEntries;
+
+	DrawRef* drawRefs;
+	uint32_t maxDrawRefs;
+
+	// Instances and commands have the same count, with each instance drawn by the command at the
+	// same index.
+	GPUInstance* instances;
+	IndirectCommand* commands;
+	uint32_t instanceCount;
+	uint32_t maxInstances;
+	uint32_t maxCommands;
+
+	// Indices of the instances for each entry, grouped by entry.
+	uint32_t* entryInstances;
+	uint32_t maxEntryInstances;
+
+	Batch* batches;
+	uint32_t batchCount;
+	uint32_t maxBatches;
+
+	dsGfxBuffer* instanceBuffer;
+	dsGfxBuffer* indirectBuffer;
+	uint32_t bufferCapacity;
+
+	bool needsRebuild;
+	bool needsUpload;
+};
+
+typedef struct dsSceneIndirectCullList
+{
+	dsSceneItemList itemList;
+	dsSceneIndirectModelList* modelList;
+	dsShader* shader;
+	dsMaterial* material;
+	uint32_t commandsNameID;
+	dsSharedMaterialValues* instanceValues;
+} dsSceneIndirectCullList;
+
+static void updateInstance(GPUInstance* instance, const Entry* entry)
+{
+	instance->world = *entry->transform;
+
+	const dsOrientedBox3f* bounds = &entry->node->bounds;
+	if (!dsOrientedBox3_isValid(*bounds))
+	{
+		instance->boundsCenter.w = 0.0f;
+		return;
+	}
+
+	dsOrientedBox3f worldBounds = *bounds;
+	DS_VERIFY(dsOrientedBox3f_transform(&worldBounds, entry->transform));
+
+	dsVector3f corners[DS_BOX3_CORNER_COUNT];
+	DS_VERIFY(dsOrientedBox3f_corners(corners, &worldBounds));
+	dsAlignedBox3f alignedBounds;
+	dsAlignedBox3f_makeInvalid(&alignedBounds);
+	for (unsigned int i = 0; i < DS_BOX3_CORNER_COUNT; ++i)
+		dsAlignedBox3_addPoint(alignedBounds, corners[i]);
+
+	dsVector3f center, extents;
+	dsAlignedBox3_center(center, alignedBounds);
+	dsAlignedBox3_extents(extents, alignedBounds);
+	instance->boundsCenter.x = center.x;
+	instance->boundsCenter.y = center.y;
+	instance->boundsCenter.z = center.z;
+	instance->boundsCenter.w = 1.0f;
+	instance->boundsExtents.x = extents.x*0.5f;
+	instance->boundsExtents.y = extents.y*0.5f;
+	instance->boundsExtents.z = extents.z*0.5f;
+	instance->boundsExtents.w = 0.0f;
+}
+
+static inline bool drawRefLess(const DrawRef* left, const DrawRef* right, void* context)
+{
+	DS_UNUSED(context);
+	const dsSceneModelInfo* leftModel = left->model;
+	const dsSceneModelInfo* rightModel = right->model;
+	if (leftModel->shader != rightModel->shader)
+		return leftModel->shader < rightModel->shader;
+	if (leftModel->material != rightModel->material)
+		return leftModel->material < rightModel->material;
+	if (leftModel->geometry != rightModel->geometry)
+		return leftModel->geometry < rightModel->geometry;
+	if (leftModel->primitiveType != rightModel->primitiveType)
+		return leftModel->primitiveType < rightModel->primitiveType;
+	if (left->entry != right->entry)
+		return left->entry < right->entry;
+	return leftModel < rightModel;
+}
+
+DS_DEFINE_TYPED_SORT(sortDrawRefs, DrawRef, drawRefLess)
+
+static bool rebuild(dsSceneIndirectModelList* modelList)
+{
+	DS_PROFILE_FUNC_START();
+
+	dsSceneItemList* itemList = (dsSceneItemList*)modelList;
+	dsAllocator* allocator = itemList->allocator;
+
+	uint32_t drawCount = 0;
+	for (uint32_t i = 0; i < modelList->entryCount; ++i)
+	{
+		const dsSceneModelNode* modelNode = modelList->entries[i].node;
+		for (uint32_t j = 0; j < modelNode->modelCount; ++j)
+		{
+			if (modelNode->models[j].listNameID == itemList->nameID)
+				++drawCount;
+		}
+	}
+
+	uint32_t dummyCount = 0;
+	if (!DS_RESIZEABLE_ARRAY_ADD(allocator, modelList->drawRefs, dummyCount,
+			modelList->maxDrawRefs, drawCount))
+	{
+		DS_PROFILE_FUNC_RETURN(false);
+	}
+
+	dummyCount = 0;
+	if (!DS_RESIZEABLE_ARRAY_ADD(allocator, modelList->instances, dummyCount,
+			modelList->maxInstances, drawCount))
+	{
+		DS_PROFILE_FUNC_RETURN(false);
+	}
+
+	dummyCount = 0;
+	if (!DS_RESIZEABLE_ARRAY_ADD(allocator, modelList->commands, dummyCount,
+			modelList->maxCommands, drawCount))
+	{
+		DS_PROFILE_FUNC_RETURN(false);
+	}
+
+	dummyCount = 0;
+	if (!DS_RESIZEABLE_ARRAY_ADD(allocator, modelList->entryInstances, dummyCount,
+			modelList->maxEntryInstances, drawCount))
+	{
+		DS_PROFILE_FUNC_RETURN(false);
+	}
+
+	// Group the draws by batch.
+	uint32_t drawIndex = 0;
+	for (uint32_t i = 0; i < modelList->entryCount; ++i)
+	{
+		Entry* entry = modelList->entries + i;
+		entry->instanceCount = 0;
+		entry->dirty = false;
+
+		const dsSceneModelNode* modelNode = entry->node;
+		for (uint32_t j = 0; j < modelNode->modelCount; ++j)
+		{
+			const dsSceneModelInfo* model = modelNode->models + j;
+			if (model->listNameID != itemList->nameID)
+				continue;
+
+			DrawRef* drawRef = modelList->drawRefs + drawIndex++;
+			drawRef->model = model;
+			drawRef->entry = i;
+		}
+	}
+	DS_ASSERT(drawIndex == drawCount);
+	sortDrawRefs(modelList->drawRefs, drawCount, NULL);
+
+	modelList->batchCount = 0;
+	Batch* batch = NULL;
+	for (uint32_t i = 0; i < drawCount; ++i)
+	{
+		const DrawRef* drawRef = modelList->drawRefs + i;
+		const dsSceneModelInfo* model = drawRef->model;
+		if (!batch || batch->shader != model->shader || batch->material != model->material ||
+			batch->geometry != model->geometry || batch->primitiveType != model->primitiveType)
+		{
+			uint32_t batchIndex = modelList->batchCount;
+			if (!DS_RESIZEABLE_ARRAY_ADD(allocator, modelList->batches, modelList->batchCount,
+					modelList->maxBatches, 1))
+			{
+				modelList->batchCount = 0;
+				DS_PROFILE_FUNC_RETURN(false);
+			}
+
+			batch = modelList->batches + batchIndex;
+			batch->shader = model->shader;
+			batch->material = model->material;
+			batch->geometry = model->geometry;
+			batch->primitiveType = model->primitiveType;
+			batch->firstCommand = i;
+			batch->commandCount = 0;
+		}
+		++batch->commandCount;
+
+		Entry* entry = modelList->entries + drawRef->entry;
+		++entry->instanceCount;
+
+		GPUInstance* instance = modelList->instances + i;
+		updateInstance(instance, entry);
+		instance->distanceRange = model->distanceRange;
+		instance->commandIndex = i;
+		instance->padding = 0;
+
+		// The instance count is set by the cull shader. Start visible in case it doesn't run.
+		IndirectCommand* command = modelList->commands + i;
+		if (model->geometry->indexBuffer.buffer)
+			command->drawIndexedRange = model->drawIndexedRange;
+		else
+		{
+			memset(command, 0, sizeof(IndirectCommand));
+			command->drawRange = model->drawRange;
+		}
+		command->drawRange.instanceCount = 1;
+		if (model->geometry->indexBuffer.buffer)
+			command->drawIndexedRange.firstInstance = i;
+		else
+			command->drawRange.firstInstance = i;
+	}
+
+	// Find the instances for each entry to update them when the transforms change.
+	uint32_t firstInstance = 0;
+	for (uint32_t i = 0; i < modelList->entryCount; ++i)
+	{
+		Entry* entry = modelList->entries + i;
+		entry->firstInstance = firstInstance;
+		firstInstance += entry->instanceCount;
+		entry->instanceCount = 0;
+	}
+	DS_ASSERT(firstInstance == drawCount);
+
+	for (uint32_t i = 0; i < drawCount; ++i)
+	{
+		Entry* entry = modelList->entries + modelList->drawRefs[i].entry;
+		modelList->entryInstances[entry->firstInstance + entry->instanceCount++] = i;
+	}
+
+	modelList->instanceCount = drawCount;
+	modelList->dirtyEntryCount = 0;
+	modelList->needsUpload = true;
+	DS_PROFILE_FUNC_RETURN(true);
+}
+
+static bool reserveBuffers(dsSceneIndirectModelList* modelList)
+{
+	if (modelList->instanceCount <= modelList->bufferCapacity)
+		return true;
+
+	if (!dsGfxBuffer_destroy(modelList->instanceBuffer) ||
+		!dsGfxBuffer_destroy(modelList->indirectBuffer))
+	{
+		return false;
+	}
+	modelList->instanceBuffer = NULL;
+	modelList->indirectBuffer = NULL;
+	modelList->bufferCapacity = 0;
+
+	// Use the full capacity of the CPU arrays to avoid re-creating the buffers when adding a few
+	// nodes at a time.
+	uint32_t capacity = modelList->maxInstances;
+	dsAllocator* allocator = ((dsSceneItemList*)modelList)->allocator;
+	modelList->instanceBuffer = dsGfxBuffer_create(modelList->resourceManager, allocator,
+		dsGfxBufferUsage_UniformBuffer | dsGfxBufferUsage_CopyTo, dsGfxMemory_GPUOnly, NULL,
+		sizeof(GPUInstance)*capacity);
+	if (!modelList->instanceBuffer)
+		return false;
+
+	modelList->indirectBuffer = dsGfxBuffer_create(modelList->resourceManager, allocator,
+		dsGfxBufferUsage_IndirectDraw | dsGfxBufferUsage_UniformBuffer | dsGfxBufferUsage_CopyTo,
+		dsGfxMemory_GPUOnly, NULL, sizeof(IndirectCommand)*capacity);
+	if (!modelList->indirectBuffer)
+	{
+		DS_VERIFY(dsGfxBuffer_destroy(modelList->instanceBuffer));
+		modelList->instanceBuffer = NULL;
+		return false;
+	}
+
+	modelList->bufferCapacity = capacity;
+	modelList->needsUpload = true;
+	return true;
+}
+
+static bool uploadData(dsSceneIndirectModelList* modelList, dsCommandBuffer* commandBuffer)
+{
+	DS_PROFILE_FUNC_START();
+
+	if (modelList->needsRebuild)
+	{
+		if (!rebuild(modelList))
+			DS_PROFILE_FUNC_RETURN(false);
+		modelList->needsRebuild = false;
+	}
+
+	if (modelList->instanceCount == 0)
+		DS_PROFILE_FUNC_RETURN(true);
+
+	if (!reserveBuffers(modelList))
+		DS_PROFILE_FUNC_RETURN(false);
+
+	for (uint32_t i = 0; i < modelList->dirtyEntryCount; ++i)
+	{
+		Entry* entry = modelList->entries + modelList->dirtyEntries[i];
+		for (uint32_t j = 0; j < entry->instanceCount; ++j)
+		{
+			uint32_t instanceIndex = modelList->entryInstances[entry->firstInstance + j];
+			updateInstance(modelList->instances + instanceIndex, entry);
+		}
+	}
+
+	bool fullUpload = modelList->needsUpload ||
+		modelList->dirtyEntryCount > modelList->entryCount/FULL_UPLOAD_DIVISOR;
+	if (fullUpload)
+	{
+		if (!dsGfxBuffer_copyData(modelList->instanceBuffer, commandBuffer, 0,
+				modelList->instances, sizeof(GPUInstance)*modelList->instanceCount))
+		{
+			DS_PROFILE_FUNC_RETURN(false);
+		}
+	}
+	else
+	{
+		for (uint32_t i = 0; i < modelList->dirtyEntryCount; ++i)
+		{
+			const Entry* entry = modelList->entries + modelList->dirtyEntries[i];
+			for (uint32_t j = 0; j < entry->instanceCount; ++j)
+			{
+				uint32_t instanceIndex = modelList->entryInstances[entry->firstInstance + j];
+				if (!dsGfxBuffer_copyData(modelList->instanceBuffer, commandBuffer,
+						sizeof(GPUInstance)*instanceIndex, modelList->instances + instanceIndex,
+						sizeof(GPUInstance)))
+				{
+					DS_PROFILE_FUNC_RETURN(false);
+				}
+			}
+		}
+	}
+
+	// Commands only need to be uploaded after a rebuild, otherwise only the cull shader modifies
+	// them.
+	if (modelList->needsUpload && !dsGfxBuffer_copyData(modelList->indirectBuffer, commandBuffer,
+			0, modelList->commands, sizeof(IndirectCommand)*modelList->instanceCount))
+	{
+		DS_PROFILE_FUNC_RETURN(false);
+	}
+
+	for (uint32_t i = 0; i < modelList->dirtyEntryCount; ++i)
+		modelList->entries[modelList->dirtyEntries[i]].dirty = false;
+	modelList->dirtyEntryCount = 0;
+	modelList->needsUpload = false;
+
+	dsGfxMemoryBarrier barrier = {dsGfxAccess_CopyWrite,
+		dsGfxAccess_UniformBufferRead | dsGfxAccess_UniformBufferWrite |
+			dsGfxAccess_IndirectCommandRead};
+	bool result = dsRenderer_memoryBarrier(commandBuffer->renderer, commandBuffer,
+		dsGfxPipelineStage_Copy, dsGfxPipelineStage_ComputeShader |
+			dsGfxPipelineStage_DrawIndirect | dsGfxPipelineStage_VertexShader, &barrier, 1);
+	DS_PROFILE_FUNC_RETURN(result);
+}
+
+static void destroyBuffers(dsSceneIndirectModelList* modelList)
+{
+	DS_CHECK(DS_SCENE_LOG_TAG, dsGfxBuffer_destroy(modelList->instanceBuffer));
+	DS_CHECK(DS_SCENE_LOG_TAG, dsGfxBuffer_destroy(modelList->indirectBuffer));
+}
+
+const char* const dsSceneIndirectModelList_typeName = "IndirectModelList";
+const char* const dsSceneIndirectModelList_cullTypeName = "IndirectModelCullList";
+
+uint64_t dsSceneIndirectModelList_addNode(dsSceneItemList* itemList, dsSceneNode* node,
+	const dsMatrix44f* transform, dsSceneNodeItemData* itemData, void** thisItemData)
+{
+	DS_UNUSED(itemData);
+	DS_UNUSED(thisItemData);
+	if (!dsSceneNode_isOfType(node, dsSceneModelNode_type()))
+		return DS_NO_SCENE_NODE;
+
+	dsSceneIndirectModelList* modelList = (dsSceneIndirectModelList*)itemList;
+	uint32_t index = modelList->entryCount;
+	if (!DS_RESIZEABLE_ARRAY_ADD(itemList->allocator, modelList->entries, modelList->entryCount,
+			modelList->maxEntries, 1))
+	{
+		return DS_NO_SCENE_NODE;
+	}
+
+	uint64_t nodeID = dsSlotMap_add(&modelList->entrySlots);
+	if (nodeID == DS_INVALID_SLOT_HANDLE)
+	{
+		--modelList->entryCount;
+		return DS_NO_SCENE_NODE;
+	}
+
+	Entry* entry = modelList->entries + index;
+	entry->node = (dsSceneModelNode*)node;
+	entry->transform = transform;
+	entry->firstInstance = 0;
+	entry->instanceCount = 0;
+	entry->dirty = false;
+	modelList->needsRebuild = true;
+	return nodeID;
+}
+
+void dsSceneIndirectModelList_updateNode(dsSceneItemList* itemList, uint64_t nodeID)
+{
+	dsSceneIndirectModelList* modelList = (dsSceneIndirectModelList*)itemList;
+	uint32_t index = dsSlotMap_getIndex(&modelList->entrySlots, nodeID);
+	DS_ASSERT(index != DS_INVALID_SLOT_INDEX);
+	// All data will be re-computed when rebuilding.
+	if (index == DS_INVALID_SLOT_INDEX || modelList->needsRebuild)
+		return;
+
+	Entry* entry = modelList->entries + index;
+	if (entry->dirty)
+		return;
+
+	uint32_t dirtyIndex = modelList->dirtyEntryCount;
+	if (!DS_RESIZEABLE_ARRAY_ADD(itemList->allocator, modelList->dirtyEntries,
+			modelList->dirtyEntryCount, modelList->maxDirtyEntries, 1))
+	{
+		// Fall back to rebuilding everything.
+		modelList->needsRebuild = true;
+		return;
+	}
+
+	modelList->dirtyEntries[dirtyIndex] = index;
+	entry->dirty = true;
+}
+
+void dsSceneIndirectModelList_removeNode(dsSceneItemList* itemList, uint64_t nodeID)
+{
+	// Order shouldn't matter since the draws will be rebuilt, so use constant-time removal.
+	dsSceneIndirectModelList* modelList = (dsSceneIndirectModelList*)itemList;
+	uint32_t index = dsSlotMap_remove(&modelList->entrySlots, nodeID);
+	DS_ASSERT(index != DS_INVALID_SLOT_INDEX);
+	if (index == DS_INVALID_SLOT_INDEX)
+		return;
+
+	--modelList->entryCount;
+	DS_ASSERT(modelList->entryCount == modelList->entrySlots.elementCount);
+	if (index < modelList->entryCount)
+		modelList->entries[index] = modelList->entries[modelList->entryCount];
+	modelList->needsRebuild = true;
+}
+
+void dsSceneIndirectModelList_commit(dsSceneItemList* itemList, const dsView* view,
+	dsCommandBuffer* commandBuffer)
+{
+	// The cull list is a shared item, so it has finished modifying the data before any draw
+	// lists are committed. Nothing to draw if the data hasn't been uploaded by the cull list.
+	dsSceneIndirectModelList* modelList = (dsSceneIndirectModelList*)itemList;
+	if (!modelList->instanceBuffer || modelList->needsRebuild || modelList->batchCount == 0)
+		return;
+
+	DS_PROFILE_DYNAMIC_SCOPE_START(itemList->name);
+	dsRenderer* renderer = commandBuffer->renderer;
+	dsRenderer_pushDebugGroup(renderer, commandBuffer, itemList->name);
+
+	DS_VERIFY(dsSharedMaterialValues_setBufferID(modelList->instanceValues,
+		modelList->instancesNameID, modelList->instanceBuffer, 0,
+		sizeof(GPUInstance)*modelList->instanceCount));
+
+	dsShader* lastShader = NULL;
+	dsMaterial* lastMaterial = NULL;
+	dsDynamicRenderStates* renderStates =
+		modelList->hasRenderStates ? &modelList->renderStates : NULL;
+	for (uint32_t i = 0; i < modelList->batchCount; ++i)
+	{
+		const Batch* batch = modelList->batches + i;
+		if (batch->shader != lastShader || batch->material != lastMaterial)
+		{
+			if (lastShader)
+				dsShader_unbind(lastShader, commandBuffer);
+
+			lastShader = NULL;
+			lastMaterial = NULL;
+			if (!DS_CHECK(DS_SCENE_LOG_TAG, dsShader_bind(batch->shader, commandBuffer,
+					batch->material, view->globalValues, renderStates)))
+			{
+				continue;
+			}
+
+			lastShader = batch->shader;
+			lastMaterial = batch->material;
+			DS_CHECK(DS_SCENE_LOG_TAG, dsShader_updateInstanceValues(batch->shader,
+				commandBuffer, modelList->instanceValues));
+		}
+
+		size_t offset = sizeof(IndirectCommand)*batch->firstCommand;
+		if (batch->geometry->indexBuffer.buffer)
+		{
+			DS_CHECK(DS_SCENE_LOG_TAG, dsRenderer_drawIndexedIndirect(renderer, commandBuffer,
+				batch->geometry, modelList->indirectBuffer, offset, batch->commandCount,
+				sizeof(IndirectCommand), batch->primitiveType));
+		}
+		else
+		{
+			DS_CHECK(DS_SCENE_LOG_TAG, dsRenderer_drawIndirect(renderer, commandBuffer,
+				batch->geometry, modelList->indirectBuffer, offset, batch->commandCount,
+				sizeof(IndirectCommand), batch->primitiveType));
+		}
+	}
+
+	if (lastShader)
+		dsShader_unbind(lastShader, commandBuffer);
+
+	dsRenderer_popDebugGroup(renderer, commandBuffer);
+	DS_PROFILE_SCOPE_END();
+}
+
+uint64_t dsSceneIndirectCullList_addNode(dsSceneItemList* itemList, dsSceneNode* node,
+	const dsMatrix44f* transform, dsSceneNodeItemData* itemData, void** thisItemData)
+{
+	DS_UNUSED(itemList);
+	DS_UNUSED(node);
+	DS_UNUSED(transform);
+	DS_UNUSED(itemData);
+	DS_UNUSED(thisItemData);
+	// The nodes are tracked by the model list.
+	return DS_NO_SCENE_NODE;
+}
+
+void dsSceneIndirectCullList_commit(dsSceneItemList* itemList, const dsView* view,
+	dsCommandBuffer* commandBuffer)
+{
+	DS_PROFILE_DYNAMIC_SCOPE_START(itemList->name);
+
+	// Shared items are committed before the scene pipeline, so this can modify the data shared with
+	// the model list without racing with its commit.
+	dsSceneIndirectCullList* cullList = (dsSceneIndirectCullList*)itemList;
+	dsSceneIndirectModelList* modelList = cullList->modelList;
+	if (!DS_CHECK(DS_SCENE_LOG_TAG, uploadData(modelList, commandBuffer)) ||
+		modelList->instanceCount == 0)
+	{
+		DS_PROFILE_SCOPE_END();
+		return;
+	}
+
+	dsRenderer* renderer = commandBuffer->renderer;
+	dsRenderer_pushDebugGroup(renderer, commandBuffer, itemList->name);
+
+	DS_VERIFY(dsSharedMaterialValues_setBufferID(cullList->instanceValues,
+		modelList->instancesNameID, modelList->instanceBuffer, 0,
+		sizeof(GPUInstance)*modelList->instanceCount));
+	DS_VERIFY(dsSharedMaterialValues_setBufferID(cullList->instanceValues,
+		cullList->commandsNameID, modelList->indirectBuffer, 0,
+		sizeof(IndirectCommand)*modelList->instanceCount));
+
+	if (DS_CHECK(DS_SCENE_LOG_TAG, dsShader_bindCompute(cullList->shader, commandBuffer,
+			cullList->material, view->globalValues)))
+	{
+		DS_CHECK(DS_SCENE_LOG_TAG, dsShader_updateComputeInstanceValues(cullList->shader,
+			commandBuffer, cullList->instanceValues));
+		uint32_t groupCount = (modelList->instanceCount + DS_INDIRECT_MODEL_CULL_GROUP_SIZE - 1)/
+			DS_INDIRECT_MODEL_CULL_GROUP_SIZE;
+		DS_CHECK(DS_SCENE_LOG_TAG, dsRenderer_dispatchCompute(renderer, commandBuffer,
+			groupCount, 1, 1));
+		DS_CHECK(DS_SCENE_LOG_TAG, dsShader_unbindCompute(cullList->shader, commandBuffer));
+
+		dsGfxMemoryBarrier barrier = {dsGfxAccess_UniformBufferWrite,
+			dsGfxAccess_IndirectCommandRead};
+		DS_CHECK(DS_SCENE_LOG_TAG, dsRenderer_memoryBarrier(renderer, commandBuffer,
+			dsGfxPipelineStage_ComputeShader, dsGfxPipelineStage_DrawIndirect, &barrier, 1));
+	}
+
+	dsRenderer_popDebugGroup(renderer, commandBuffer);
+	DS_PROFILE_SCOPE_END();
+}
+
+void dsSceneIndirectCullList_destroy(dsSceneItemList* itemList)
+{
+	DS_VERIFY(dsAllocator_free(itemList->allocator, itemList));
+}
+
+dsSceneIndirectModelList* dsSceneIndirectModelList_create(dsAllocator* allocator,
+	const char* name, dsResourceManager* resourceManager,
+	const dsDynamicRenderStates* renderStates)
+{
+	if (!allocator || !name || !resourceManager)
+	{
+		errno = EINVAL;
+		return NULL;
+	}
+
+	if (!allocator->freeFunc)
+	{
+		errno = EINVAL;
+		DS_LOG_ERROR(DS_SCENE_LOG_TAG,
+			"Scene indirect model list allocator must support freeing memory.");
+		return NULL;
+	}
+
+	dsGfxBufferUsage requiredBuffers = dsGfxBufferUsage_IndirectDraw |
+		dsGfxBufferUsage_UniformBuffer;
+	if ((resourceManager->supportedBuffers & requiredBuffers) != requiredBuffers ||
+		!resourceManager->renderer->hasStartInstance)
+	{
+		errno = EPERM;
+		DS_LOG_ERROR(DS_SCENE_LOG_TAG,
+			"Target doesn't support the features required for scene indirect model lists.");
+		return NULL;
+	}
+
+	size_t nameLen = strlen(name);
+	size_t fullSize = DS_ALIGNED_SIZE(sizeof(dsSceneIndirectModelList)) +
+		DS_ALIGNED_SIZE(nameLen + 1) + dsSharedMaterialValues_fullAllocSize(1);
+	void* buffer = dsAllocator_alloc(allocator, fullSize);
+	if (!buffer)
+		return NULL;
+
+	dsBufferAllocator bufferAlloc;
+	DS_VERIFY(dsBufferAllocator_initialize(&bufferAlloc, buffer, fullSize));
+	dsSceneIndirectModelList* modelList = DS_ALLOCATE_OBJECT(&bufferAlloc,
+		dsSceneIndirectModelList);
+	DS_ASSERT(modelList);
+
+	dsSceneItemList* itemList = (dsSceneItemList*)modelList;
+	itemList->allocator = allocator;
+	itemList->name = DS_ALLOCATE_OBJECT_ARRAY(&bufferAlloc, char, nameLen + 1);
+	memcpy((void*)itemList->name, name, nameLen + 1);
+	itemList->nameID = dsHashString(name);
+	itemList->needsCommandBuffer = true;
+	itemList->addNodeFunc = &dsSceneIndirectModelList_addNode;
+	itemList->updateNodeFunc = &dsSceneIndirectModelList_updateNode;
+	itemList->removeNodeFunc = &dsSceneIndirectModelList_removeNode;
+	itemList->prepareRangesFunc = NULL;
+	itemList->commitRangeFunc = NULL;
+	itemList->commitFunc = &dsSceneIndirectModelList_commit;
+	itemList->destroyFunc = (dsDestroySceneItemListFunction)&dsSceneIndirectModelList_destroy;
+
+	modelList->resourceManager = resourceManager;
+	if (renderStates)
+	{
+		modelList->renderStates = *renderStates;
+		modelList->hasRenderStates = true;
+	}
+	else
+		modelList->hasRenderStates = false;
+
+	modelList->instancesNameID = DS_HASH_STRING_LITERAL(INSTANCES_NAME);
+	modelList->instanceValues = dsSharedMaterialValues_create((dsAllocator*)&bufferAlloc, 1);
+	DS_ASSERT(modelList->instanceValues);
+
+	DS_VERIFY(dsSlotMap_initialize(&modelList->entrySlots, allocator));
+	modelList->entries = NULL;
+	modelList->entryCount = 0;
+	modelList->maxEntries = 0;
+	modelList->dirtyEntries = NULL;
+	modelList->dirtyEntryCount = 0;
+	modelList->maxDirtyEntries = 0;
+	modelList->drawRefs = NULL;
+	modelList->maxDrawRefs = 0;
+	modelList->instances = NULL;
+	modelList->commands = NULL;
+	modelList->instanceCount = 0;
+	modelList->maxInstances = 0;
+	modelList->maxCommands = 0;
+	modelList->entryInstances = NULL;
+	modelList->maxEntryInstances = 0;
+	modelList->batches = NULL;
+	modelList->batchCount = 0;
+	modelList->maxBatches = 0;
+	modelList->instanceBuffer = NULL;
+	modelList->indirectBuffer = NULL;
+	modelList->bufferCapacity = 0;
+	modelList->needsRebuild = false;
+	modelList->needsUpload = false;
+	return modelList;
+}
+
+dsSceneItemList* dsSceneIndirectModelList_createCullList(dsAllocator* allocator,
+	const char* name, dsSceneIndirectModelList* modelList, dsShader* shader, dsMaterial* material)
+{
+	if (!allocator || !name || !modelList || !shader || !material)
+	{
+		errno = EINVAL;
+		return NULL;
+	}
+
+	if (!allocator->freeFunc)
+	{
+		errno = EINVAL;
+		DS_LOG_ERROR(DS_SCENE_LOG_TAG,
+			"Scene indirect model cull list allocator must support freeing memory.");
+		return NULL;
+	}
+
+	size_t nameLen = strlen(name);
+	size_t fullSize = DS_ALIGNED_SIZE(sizeof(dsSceneIndirectCullList)) +
+		DS_ALIGNED_SIZE(nameLen + 1) + dsSharedMaterialValues_fullAllocSize(2);
+	void* buffer = dsAllocator_alloc(allocator, fullSize);
+	if (!buffer)
+		return NULL;
+
+	dsBufferAllocator bufferAlloc;
+	DS_VERIFY(dsBufferAllocator_initialize(&bufferAlloc, buffer, fullSize));
+	dsSceneIndirectCullList* cullList = DS_ALLOCATE_OBJECT(&bufferAlloc, dsSceneIndirectCullList);
+	DS_ASSERT(cullList);
+
+	dsSceneItemList* itemList = (dsSceneItemList*)cullList;
+	itemList->allocator = allocator;
+	itemList->name = DS_ALLOCATE_OBJECT_ARRAY(&bufferAlloc, char, nameLen + 1);
+	memcpy((void*)itemList->name, name, nameLen + 1);
+	itemList->nameID = dsHashString(name);
+	itemList->needsCommandBuffer = true;
+	itemList->addNodeFunc = &dsSceneIndirectCullList_addNode;
+	itemList->updateNodeFunc = NULL;
+	itemList->removeNodeFunc = NULL;
+	itemList->prepareRangesFunc = NULL;
+	itemList->commitRangeFunc = NULL;
+	itemList->commitFunc = &dsSceneIndirectCullList_commit;
+	itemList->destroyFunc = &dsSceneIndirectCullList_destroy;
+
+	cullList->modelList = modelList;
+	cullList->shader = shader;
+	cullList->material = material;
+	cullList->commandsNameID = DS_HASH_STRING_LITERAL(COMMANDS_NAME);
+	cullList->instanceValues = dsSharedMaterialValues_create((dsAllocator*)&bufferAlloc, 2);
+	DS_ASSERT(cullList->instanceValues);
+	return itemList;
+}
+
+const dsDynamicRenderStates* dsSceneIndirectModelList_getRenderStates(
+	const dsSceneIndirectModelList* modelList)
+{
+	return modelList && modelList->hasRenderStates ? &modelList->renderStates : NULL;
+}
+
+void dsSceneIndirectModelList_setRenderStates(dsSceneIndirectModelList* modelList,
+	const dsDynamicRenderStates* renderStates)
+{
+	if (!modelList)
+		return;
+
+	if (renderStates)
+	{
+		modelList->hasRenderStates = true;
+		modelList->renderStates = *renderStates;
+	}
+	else
+		modelList->hasRenderStates = false;
+}
+
+void dsSceneIndirectModelList_destroy(dsSceneIndirectModelList* modelList)
+{
+	if (!modelList)
+		return;
+
+	dsSceneItemList* itemList = (dsSceneItemList*)modelList;
+	destroyBuffers(modelList);
+	dsSharedMaterialValues_destroy(modelList->instanceValues);
+	dsSlotMap_shutdown(&modelList->entrySlots);
+	DS_VERIFY(dsAllocator_free(itemList->allocator, modelList->entries));
+	DS_VERIFY(dsAllocator_free(itemList->allocator, modelList->dirtyEntries));
+	DS_VERIFY(dsAllocator_free(itemList->allocator, modelList->drawRefs));
+	DS_VERIFY(dsAllocator_free(itemList->allocator, modelList->instances));
+	DS_VERIFY(dsAllocator_free(itemList->allocator, modelList->commands));
+	DS_VERIFY(dsAllocator_free(itemList->allocator, modelList->entryInstances));
+	DS_VERIFY(dsAllocator_free(itemList->allocator, modelList->batches));
+	DS_VERIFY(dsAllocator_free(itemList->allocator, modelList));
+}
@@ -16,6 +16,8 @@
 
 #include <DeepSea/Scene/ItemLists/SceneInstanceData.h>
 #include <DeepSea/Core/Error.h>
+#include <DeepSea/Core/Log.h>
+#include <DeepSea/Scene/Types.h>
 
 bool dsSceneInstanceData_populateData(dsSceneInstanceData* instanceData,
 	const dsView* view, const dsSceneInstanceInfo* instances, uint32_t instanceCount)
@@ -43,6 +45,26 @@ bool dsSceneInstanceData_bindInstance(dsSceneInstanceData* instanceData, uint32_
 	return instanceData->bindInstanceFunc(instanceData, index, values);
 }
 
+bool dsSceneInstanceData_bindInstanceRange(dsSceneInstanceData* instanceData,
+	uint32_t firstIndex, uint32_t count, dsSharedMaterialValues* values)
+{
+	if (!instanceData || !instanceData->bindInstanceRangeFunc ||
+		(!values && instanceData->valueCount > 0))
+	{
+		errno = EINVAL;
+		return false;
+	}
+
+	if (count == 0 || count > instanceData->maxInstanceRange)
+	{
+		errno = EINVAL;
+		DS_LOG_ERROR(DS_SCENE_LOG_TAG, "Invalid number of scene instances to bind.");
+		return false;
+	}
+
+	return instanceData->bindInstanceRangeFunc(instanceData, firstIndex, count, values);
+}
+
 bool dsSceneInstanceData_finish(dsSceneInstanceData* instanceData)
 {
 	if (!instanceData || !instanceData->finishFunc)
@@ -100,7 +100,12 @@ static bool reserveSpace(dsSceneInstanceVariables* variables, uint32_t maxInstan
 		return variables->curBufferData != NULL;
 	}
 
+	// Ranges of instances always bind the full array declared in the shader, so pad the end of the
+	// buffer for the last range.
 	size_t requiredSize = (size_t)variables->instanceSize*maxInstances;
+	uint32_t maxInstanceRange = ((dsSceneInstanceData*)variables)->maxInstanceRange;
+	if (maxInstanceRange > 1)
+		requiredSize += (size_t)variables->instanceSize*(maxInstanceRange - 1);
 	dsResourceManager* resourceManager = variables->resourceManager;
 	uint64_t frameNumber = resourceManager->renderer->frameNumber;
 
@@ -251,6 +256,31 @@ bool dsSceneInstanceVariables_bindInstance(dsSceneInstanceData* instanceData, ui
 	return dsSharedMaterialValues_setVariableGroupID(values, variables->nameID, group);
 }
 
+bool dsSceneInstanceVariables_bindInstanceRange(dsSceneInstanceData* instanceData,
+	uint32_t firstIndex, uint32_t count, dsSharedMaterialValues* values)
+{
+	dsSceneInstanceVariables* variables = (dsSceneInstanceVariables*)instanceData;
+	DS_ASSERT(variables);
+	DS_ASSERT(values);
+	DS_ASSERT(count <= instanceData->maxInstanceRange);
+
+	if (firstIndex >= variables->curInstanceCount ||
+		count > variables->curInstanceCount - firstIndex)
+	{
+		errno = EINDEX;
+		return false;
+	}
+
+	// Ranges are only supported when using buffers, so should have a buffer if instances are
+	// available.
+	BufferInfo* curBuffer = variables->curBuffer;
+	DS_ASSERT(curBuffer);
+	DS_ASSERT(variables->stride == variables->instanceSize);
+	return dsSharedMaterialValues_setBufferID(values, variables->nameID, curBuffer->buffer,
+		firstIndex*variables->stride,
+		(size_t)variables->instanceSize*instanceData->maxInstanceRange);
+}
+
 bool dsSceneInstanceVariables_finish(dsSceneInstanceData* instanceData)
 {
 	dsSceneInstanceVariables* variables = (dsSceneInstanceVariables*)instanceData;
@@ -292,6 +322,15 @@ dsSceneInstanceData* dsSceneInstanceVariables_create(dsAllocator* allocator,
 	dsResourceManager* resourceManager, const dsShaderVariableGroupDesc* dataDesc, uint32_t nameID,
 	dsPopulateSceneInstanceVariablesFunction populateDataFunc, void* userData,
 	dsDestroySceneUserDataFunction destroyUserDataFunc)
+{
+	return dsSceneInstanceVariables_createRanged(allocator, resourceManager, dataDesc, nameID,
+		populateDataFunc, userData, destroyUserDataFunc, 0);
+}
+
+dsSceneInstanceData* dsSceneInstanceVariables_createRanged(dsAllocator* allocator,
+	dsResourceManager* resourceManager, const dsShaderVariableGroupDesc* dataDesc, uint32_t nameID,
+	dsPopulateSceneInstanceVariablesFunction populateDataFunc, void* userData,
+	dsDestroySceneUserDataFunction destroyUserDataFunc, uint32_t maxInstanceRange)
 {
 	if (!allocator || !resourceManager || !dataDesc || !populateDataFunc)
 	{
@@ -336,6 +375,8 @@ dsSceneInstanceData* dsSceneInstanceVariables_create(dsAllocator* allocator,
 	instanceData->valueCount = 1;
 	instanceData->populateDataFunc = &dsSceneInstanceVariables_populateData;
 	instanceData->bindInstanceFunc = &dsSceneInstanceVariables_bindInstance;
+	instanceData->bindInstanceRangeFunc = NULL;
+	instanceData->maxInstanceRange = 0;
 	instanceData->finishFunc = &dsSceneInstanceVariables_finish;
 	instanceData->destroyFunc = &dsSceneInstanceVariables_destroy;
 
@@ -358,6 +399,15 @@ dsSceneInstanceData* dsSceneInstanceVariables_create(dsAllocator* allocator,
 	DS_ASSERT(stride <= UINT_MAX);
 	variables->stride = (uint32_t)stride;
 
+	// The array for a range is declared as tightly packed elements in the shader, so the stride
+	// must be the same as the instance size.
+	if (maxInstanceRange > 1 && !needsFallback && stride == instanceSize &&
+		instanceSize*maxInstanceRange <= resourceManager->maxUniformBlockSize)
+	{
+		instanceData->bindInstanceRangeFunc = &dsSceneInstanceVariables_bindInstanceRange;
+		instanceData->maxInstanceRange = maxInstanceRange;
+	}
+
 	variables->populateDataFunc = populateDataFunc;
 	variables->userData = userData;
 	variables->destroyUserDataFunc = destroyUserDataFunc;
@@ -18,12 +18,14 @@
 
 #include <DeepSea/Core/Containers/Hash.h>
 #include <DeepSea/Core/Containers/ResizeableArray.h>
+#include <DeepSea/Core/Containers/SlotMap.h>
 #include <DeepSea/Core/Memory/Allocator.h>
 #include <DeepSea/Core/Memory/BufferAllocator.h>
 #include <DeepSea/Core/Assert.h>
 #include <DeepSea/Core/Error.h>
 #include <DeepSea/Core/Log.h>
 #include <DeepSea/Core/Profile.h>
+#include <DeepSea/Core/Sort.h>
 #include <DeepSea/Geometry/OrientedBox3.h>
 #include <DeepSea/Geometry/Frustum3.h>
 #include <DeepSea/Math/Matrix44.h>
@@ -36,15 +38,32 @@
 #include <DeepSea/Scene/Nodes/SceneNode.h>
 #include <DeepSea/Scene/Nodes/SceneNodeItemData.h>
 
-#include <stdlib.h>
 #include <string.h>
 
+// Minimum number of entries to process in a single range when committing across threads.
+#define MIN_RANGE_SIZE 128
+
+// Number of bits for each resource ID in the sort keys when sorting by material. Resources past
+// the maximum ID will share IDs, which only reduces the effectiveness of the sort.
+#define MATERIAL_SORT_SHADER_BITS 16
+#define MATERIAL_SORT_MATERIAL_BITS 24
+#define MATERIAL_SORT_GEOMETRY_BITS 24
+
+// When sorting by distance, the upper 32 bits are used for the distance.
+#define DISTANCE_SORT_SHADER_BITS 10
+#define DISTANCE_SORT_MATERIAL_BITS 12
+#define DISTANCE_SORT_GEOMETRY_BITS 10
+
+// Limit to the number of IDs for a resource type before they are re-assigned.
+#define MAX_RESOURCE_IDS (1U << 24)
+
 typedef struct Entry
 {
 	const dsSceneModelNode* node;
 	const dsMatrix44f* transform;
 	dsSceneNodeItemData* itemData;
-	uint64_t nodeID;
+	// Number of models drawn with this list.
+	uint32_t modelCount;
 } Entry;
 
 typedef struct DrawItem
@@ -63,6 +82,26 @@ typedef struct DrawItem
 	dsPrimitiveType primitiveType;
 } DrawItem;
 
+// Maps resource pointers to small IDs to use in sort keys. IDs are assigned in the order the
+// resources are first seen, so the order will be consistent between runs.
+typedef struct ResourceIDs
+{
+	const void** resources;
+	uint32_t* ids;
+	uint32_t tableSize;
+	uint32_t count;
+} ResourceIDs;
+
+// Each range writes its instances and draw items to its own section of the arrays, which are
+// compacted once all ranges have finished.
+typedef struct RangeInfo
+{
+	uint32_t firstInstance;
+	uint32_t instanceCount;
+	uint32_t firstDrawItem;
+	uint32_t drawItemCount;
+} RangeInfo;
+
 struct dsSceneModelList
 {
 	dsSceneItemList itemList;
@@ -71,32 +110,71 @@ struct dsSceneModelList
 	bool hasRenderStates;
 	dsModelSortType sortType;
 	uint32_t cullNameID;
+	bool instancing;
 
 	dsSharedMaterialValues* instanceValues;
 	dsSceneInstanceData** instanceData;
 	uint32_t instanceDataCount;
 
+	// Node IDs are slot map handles for the entries.
+	dsSlotMap entrySlots;
 	Entry* entries;
 	uint32_t entryCount;
 	uint32_t maxEntries;
-	uint64_t nextNodeID;
+	// Total number of models for all entries, which is the maximum number of draw items.
+	uint32_t totalModelCount;
 
 	dsSceneInstanceInfo* instances;
 	DrawItem* drawItems;
 	uint32_t maxInstances;
 	uint32_t maxDrawItems;
+
+	// Instances for each draw item in sorted order when drawing with instancing.
+	dsSceneInstanceInfo* drawInstances;
+	uint32_t maxDrawInstances;
+
+	ResourceIDs shaderIDs;
+	ResourceIDs materialIDs;
+	ResourceIDs geometryIDs;
+
+	// Sorted keys may be in either array, with sortedKeys pointing to the last sorted result.
+	dsSortKey* sortKeys;
+	dsSortKey* tempSortKeys;
+	dsSortKey* sortedKeys;
+	uint32_t maxSortKeys;
+	uint32_t lastSortedCount;
+	bool reuseSortOrder;
+
+	RangeInfo* ranges;
+	uint32_t rangeCount;
+	uint32_t maxRanges;
 };
 
-static void addInstances(dsSceneItemList* itemList, const dsView* view, uint32_t* instanceCount,
-	uint32_t* drawItemCount)
+static bool reserveInstances(dsSceneModelList* modelList)
 {
-	DS_PROFILE_FUNC_START();
+	// Reserve for the worst case so ranges can be processed without re-allocating.
+	dsAllocator* allocator = ((dsSceneItemList*)modelList)->allocator;
+	uint32_t instanceCount = 0;
+	if (!DS_RESIZEABLE_ARRAY_ADD(allocator, modelList->instances, instanceCount,
+			modelList->maxInstances, modelList->entryCount))
+	{
+		return false;
+	}
 
-	dsSceneModelList* modelList = (dsSceneModelList*)itemList;
+	uint32_t drawItemCount = 0;
+	return DS_RESIZEABLE_ARRAY_ADD(allocator, modelList->drawItems, drawItemCount,
+		modelList->maxDrawItems, modelList->totalModelCount);
+}
 
-	for (uint32_t i = 0; i < modelList->entryCount; ++i)
+static void addInstances(dsSceneModelList* modelList, const dsView* view, RangeInfo* range,
+	uint32_t firstEntry, uint32_t entryCount)
+{
+	DS_PROFILE_FUNC_START();
+
+	dsSceneItemList* itemList = (dsSceneItemList*)modelList;
+	for (uint32_t i = 0; i < entryCount; ++i)
 	{
-		const Entry* entry = modelList->entries + i;
+		const Entry* entry = modelList->entries + firstEntry + i;
 		const dsSceneModelNode* modelNode = entry->node;
 		// Non-zero cull result means out of view.
 		if (modelList->cullNameID &&
@@ -113,7 +191,7 @@ static void addInstances(dsSceneItemList* itemList, const dsView* view, uint32_t
 		float flatDistance = -dsVector3_dot(direction, view->cameraMatrix.columns[2]);
 
 		bool hasAny = false;
-		uint32_t instanceIndex = *instanceCount;
+		uint32_t instanceIndex = range->firstInstance + range->instanceCount;
 		for (uint32_t j = 0; j < modelNode->modelCount; ++j)
 		{
 			dsSceneModelInfo* model = modelNode->models + j;
@@ -127,15 +205,9 @@ static void addInstances(dsSceneItemList* itemList, const dsView* view, uint32_t
 				continue;
 			}
 
-			uint32_t itemIndex = *drawItemCount;
-			if (!DS_RESIZEABLE_ARRAY_ADD(itemList->allocator, modelList->drawItems, *drawItemCount,
-					modelList->maxDrawItems, 1))
-			{
-				continue;
-			}
-
 			hasAny = true;
-			DrawItem* item = modelList->drawItems + itemIndex;
+			DrawItem* item = modelList->drawItems + range->firstDrawItem + range->drawItemCount++;
+			DS_ASSERT(item < modelList->drawItems + modelList->maxDrawItems);
 			item->shader = model->shader;
 			item->material = model->material;
 			item->flatDistance = flatDistance;
@@ -152,88 +224,339 @@ static void addInstances(dsSceneItemList* itemList, const dsView* view, uint32_t
 		if (!hasAny)
 			continue;
 
-		if (!DS_RESIZEABLE_ARRAY_ADD(itemList->allocator, modelList->instances, *instanceCount,
-				modelList->maxInstances, 1))
-		{
-			continue;
-		}
-
+		DS_ASSERT(instanceIndex < modelList->maxInstances);
 		dsSceneInstanceInfo* instance = modelList->instances + instanceIndex;
 		instance->node = (dsSceneNode*)modelNode;
 		instance->transform = *entry->transform;
+		++range->instanceCount;
 	}
 
 	DS_PROFILE_FUNC_RETURN_VOID();
 }
 
-static void setupInstances(dsSceneModelList* modelList, const dsView* view, uint32_t instanceCount)
+static void mergeRanges(dsSceneModelList* modelList, uint32_t* instanceCount,
+	uint32_t* drawItemCount)
+{
+	DS_PROFILE_FUNC_START();
+
+	for (uint32_t i = 0; i < modelList->rangeCount; ++i)
+	{
+		// Ranges are in order, so the data will only ever be moved towards the front.
+		const RangeInfo* range = modelList->ranges + i;
+		DS_ASSERT(range->firstInstance >= *instanceCount);
+		DS_ASSERT(range->firstDrawItem >= *drawItemCount);
+		uint32_t instanceOffset = range->firstInstance - *instanceCount;
+		if (instanceOffset > 0)
+		{
+			memmove(modelList->instances + *instanceCount,
+				modelList->instances + range->firstInstance,
+				sizeof(dsSceneInstanceInfo)*range->instanceCount);
+		}
+
+		DrawItem* drawItems = modelList->drawItems + *drawItemCount;
+		if (range->firstDrawItem != *drawItemCount)
+		{
+			memmove(drawItems, modelList->drawItems + range->firstDrawItem,
+				sizeof(DrawItem)*range->drawItemCount);
+		}
+
+		if (instanceOffset > 0)
+		{
+			for (uint32_t j = 0; j < range->drawItemCount; ++j)
+				drawItems[j].instance -= instanceOffset;
+		}
+
+		*instanceCount += range->instanceCount;
+		*drawItemCount += range->drawItemCount;
+	}
+
+	DS_PROFILE_FUNC_RETURN_VOID();
+}
+
+static void setupInstances(dsSceneModelList* modelList, const dsView* view,
+	const dsSceneInstanceInfo* instances, uint32_t instanceCount)
 {
 	DS_PROFILE_FUNC_START();
 
 	for (uint32_t i = 0; i < modelList->instanceDataCount; ++i)
 	{
-		dsSceneInstanceData_populateData(modelList->instanceData[i], view, modelList->instances,
+		dsSceneInstanceData_populateData(modelList->instanceData[i], view, instances,
 			instanceCount);
 	}
 
 	DS_PROFILE_FUNC_RETURN_VOID();
 }
 
-static int sortByMaterial(const void* left, const void* right)
+static uint32_t getMaxInstanceRange(const dsSceneModelList* modelList)
 {
-	const DrawItem* leftInfo = (const DrawItem*)left;
-	const DrawItem* rightInfo = (const DrawItem*)right;
-	if (leftInfo->shader != rightInfo->shader)
-		return leftInfo->shader < rightInfo->shader ? -1 : 1;
-	if (leftInfo->material != rightInfo->material)
-		return leftInfo->material < rightInfo->material ? -1 : 1;
-	if (leftInfo->geometry != rightInfo->geometry)
-		return leftInfo->geometry < rightInfo->geometry ? -1 : 1;
-	return leftInfo->instance - rightInfo->instance;
+	// Merging draws is only meaningful when there's per-instance data to differentiate them.
+	if (!modelList->instancing || modelList->instanceDataCount == 0)
+		return 0;
+
+	uint32_t maxInstanceRange = UINT32_MAX;
+	for (uint32_t i = 0; i < modelList->instanceDataCount; ++i)
+	{
+		uint32_t instanceRange = modelList->instanceData[i]->maxInstanceRange;
+		if (instanceRange < maxInstanceRange)
+			maxInstanceRange = instanceRange;
+	}
+
+	return maxInstanceRange;
 }
 
-static int sortBackToFront(const void* left, const void* right)
+static bool isSingleInstance(const DrawItem* drawItem)
 {
-	const DrawItem* leftInfo = (const DrawItem*)left;
-	const DrawItem* rightInfo = (const DrawItem*)right;
-	if (leftInfo->flatDistance != rightInfo->flatDistance)
-		return leftInfo->flatDistance > rightInfo->flatDistance ? -1 : 1;
-	return sortByMaterial(left, right);
+	if (drawItem->geometry->indexBuffer.buffer)
+	{
+		return drawItem->drawIndexedRange.instanceCount == 1 &&
+			drawItem->drawIndexedRange.firstInstance == 0;
+	}
+
+	return drawItem->drawRange.instanceCount == 1 && drawItem->drawRange.firstInstance == 0;
 }
 
-static int sortFrontToBack(const void* left, const void* right)
+// Gets the number of elements in the instance array a draw item reads from. Draw items that draw
+// multiple instances by themselves index the array by their own instance IDs, so they need a copy
+// of their instance for each of them. Returns 0 if the instance IDs don't fit in the array.
+static uint32_t getInstanceSlotCount(const DrawItem* drawItem, uint32_t maxInstanceRange)
 {
-	const DrawItem* leftInfo = (const DrawItem*)left;
-	const DrawItem* rightInfo = (const DrawItem*)right;
-	if (leftInfo->flatDistance != rightInfo->flatDistance)
-		return leftInfo->flatDistance < rightInfo->flatDistance ? -1 : 1;
-	return sortByMaterial(left, right);
+	if (isSingleInstance(drawItem))
+		return 1;
+
+	uint32_t slotCount;
+	if (drawItem->geometry->indexBuffer.buffer)
+	{
+		slotCount = drawItem->drawIndexedRange.firstInstance +
+			drawItem->drawIndexedRange.instanceCount;
+	}
+	else
+		slotCount = drawItem->drawRange.firstInstance + drawItem->drawRange.instanceCount;
+	return slotCount <= maxInstanceRange ? slotCount : 0;
 }
 
-static void sortGeometry(dsSceneModelList* modelList, uint32_t drawItemCount)
+static bool setupDrawInstances(uint32_t* outSlotCount, dsSceneModelList* modelList,
+	const dsSortKey* sortKeys, uint32_t drawItemCount, uint32_t maxInstanceRange)
 {
 	DS_PROFILE_FUNC_START();
 
+	uint32_t slotCount = 0;
+	for (uint32_t i = 0; i < drawItemCount; ++i)
+	{
+		const DrawItem* drawItem = modelList->drawItems + (sortKeys ? sortKeys[i].index : i);
+		slotCount += getInstanceSlotCount(drawItem, maxInstanceRange);
+	}
+
+	uint32_t dummyCount = 0;
+	if (!DS_RESIZEABLE_ARRAY_ADD(((dsSceneItemList*)modelList)->allocator,
+			modelList->drawInstances, dummyCount, modelList->maxDrawInstances, slotCount))
+	{
+		DS_PROFILE_FUNC_RETURN(false);
+	}
+
+	// Each draw item gets its own copy of the instance so instances for consecutive draw items
+	// are next to each other.
+	uint32_t slot = 0;
+	for (uint32_t i = 0; i < drawItemCount; ++i)
+	{
+		const DrawItem* drawItem = modelList->drawItems + (sortKeys ? sortKeys[i].index : i);
+		const dsSceneInstanceInfo* instance = modelList->instances + drawItem->instance;
+		uint32_t drawSlotCount = getInstanceSlotCount(drawItem, maxInstanceRange);
+		for (uint32_t j = 0; j < drawSlotCount; ++j)
+			modelList->drawInstances[slot++] = *instance;
+	}
+	DS_ASSERT(slot == slotCount);
+
+	*outSlotCount = slotCount;
+	DS_PROFILE_FUNC_RETURN(true);
+}
+
+static bool canMergeDrawItems(const DrawItem* first, const DrawItem* second)
+{
+	if (first->shader != second->shader || first->material != second->material ||
+		first->geometry != second->geometry || first->primitiveType != second->primitiveType)
+	{
+		return false;
+	}
+
+	if (first->geometry->indexBuffer.buffer)
+	{
+		return memcmp(&first->drawIndexedRange, &second->drawIndexedRange,
+			sizeof(dsDrawIndexedRange)) == 0;
+	}
+
+	return memcmp(&first->drawRange, &second->drawRange, sizeof(dsDrawRange)) == 0;
+}
+
+static void clearResourceIDs(ResourceIDs* ids)
+{
+	if (ids->count == 0)
+		return;
+
+	memset(ids->resources, 0, sizeof(const void*)*ids->tableSize);
+	ids->count = 0;
+}
+
+static bool growResourceIDs(ResourceIDs* ids, dsAllocator* allocator)
+{
+	uint32_t tableSize = ids->tableSize ? ids->tableSize*2 : 64;
+	size_t bufferSize = (sizeof(const void*) + sizeof(uint32_t))*tableSize;
+	const void** resources = (const void**)dsAllocator_alloc(allocator, bufferSize);
+	if (!resources)
+		return false;
+
+	memset(resources, 0, sizeof(const void*)*tableSize);
+	uint32_t* newIDs = (uint32_t*)(resources + tableSize);
+	for (uint32_t i = 0; i < ids->tableSize; ++i)
+	{
+		const void* resource = ids->resources[i];
+		if (!resource)
+			continue;
+
+		uint32_t index = dsHashPointer(resource) & (tableSize - 1);
+		while (resources[index])
+			index = (index + 1) & (tableSize - 1);
+		resources[index] = resource;
+		newIDs[index] = ids->ids[i];
+	}
+
+	// The IDs are allocated in the same buffer as the resources.
+	DS_VERIFY(dsAllocator_free(allocator, ids->resources));
+	ids->resources = resources;
+	ids->ids = newIDs;
+	ids->tableSize = tableSize;
+	return true;
+}
+
+static uint32_t getResourceID(ResourceIDs* ids, dsAllocator* allocator, const void* resource)
+{
+	// Keep the load factor at or below 1/2.
+	if (ids->count >= ids->tableSize/2)
+	{
+		if (ids->count >= MAX_RESOURCE_IDS)
+			clearResourceIDs(ids);
+		else if (!growResourceIDs(ids, allocator) && ids->count == ids->tableSize)
+			return 0;
+	}
+
+	uint32_t mask = ids->tableSize - 1;
+	uint32_t index = dsHashPointer(resource) & mask;
+	while (ids->resources[index])
+	{
+		if (ids->resources[index] == resource)
+			return ids->ids[index];
+		index = (index + 1) & mask;
+	}
+
+	ids->resources[index] = resource;
+	ids->ids[index] = ids->count++;
+	return ids->ids[index];
+}
+
+static void destroyResourceIDs(ResourceIDs* ids, dsAllocator* allocator)
+{
+	DS_VERIFY(dsAllocator_free(allocator, ids->resources));
+}
+
+static uint64_t getMaterialSortKey(dsSceneModelList* modelList, const DrawItem* drawItem,
+	unsigned int shaderBits, unsigned int materialBits, unsigned int geometryBits)
+{
+	dsAllocator* allocator = ((dsSceneItemList*)modelList)->allocator;
+	uint64_t shaderID = getResourceID(&modelList->shaderIDs, allocator, drawItem->shader) &
+		((1U << shaderBits) - 1);
+	uint64_t materialID = getResourceID(&modelList->materialIDs, allocator, drawItem->material) &
+		((1U << materialBits) - 1);
+	uint64_t geometryID = getResourceID(&modelList->geometryIDs, allocator, drawItem->geometry) &
+		((1U << geometryBits) - 1);
+	return (shaderID << (materialBits + geometryBits)) | (materialID << geometryBits) | geometryID;
+}
+
+static uint64_t getSortKey(dsSceneModelList* modelList, const DrawItem* drawItem)
+{
 	switch (modelList->sortType)
 	{
 		case dsModelSortType_Material:
-			qsort(modelList->drawItems, drawItemCount, sizeof(DrawItem), &sortByMaterial);
-			break;
+			return getMaterialSortKey(modelList, drawItem, MATERIAL_SORT_SHADER_BITS,
+				MATERIAL_SORT_MATERIAL_BITS, MATERIAL_SORT_GEOMETRY_BITS);
 		case dsModelSortType_BackToFront:
-			qsort(modelList->drawItems, drawItemCount, sizeof(DrawItem), &sortBackToFront);
-			break;
+			return ((uint64_t)~dsSortKeyFromFloat(drawItem->flatDistance) << 32) |
+				getMaterialSortKey(modelList, drawItem, DISTANCE_SORT_SHADER_BITS,
+					DISTANCE_SORT_MATERIAL_BITS, DISTANCE_SORT_GEOMETRY_BITS);
 		case dsModelSortType_FrontToBack:
-			qsort(modelList->drawItems, drawItemCount, sizeof(DrawItem), &sortFrontToBack);
-			break;
+			return ((uint64_t)dsSortKeyFromFloat(drawItem->flatDistance) << 32) |
+				getMaterialSortKey(modelList, drawItem, DISTANCE_SORT_SHADER_BITS,
+					DISTANCE_SORT_MATERIAL_BITS, DISTANCE_SORT_GEOMETRY_BITS);
 		default:
-			break;
+			DS_ASSERT(false);
+			return 0;
 	}
+}
 
-	DS_PROFILE_FUNC_RETURN_VOID();
+static const dsSortKey* sortGeometry(dsSceneModelList* modelList, uint32_t drawItemCount)
+{
+	DS_PROFILE_FUNC_START();
+
+	if (modelList->sortType == dsModelSortType_None)
+	{
+		modelList->lastSortedCount = 0;
+		DS_PROFILE_FUNC_RETURN(NULL);
+	}
+
+	dsAllocator* allocator = ((dsSceneItemList*)modelList)->allocator;
+	if (drawItemCount > modelList->maxSortKeys)
+	{
+		// Previous keys don't need to be preserved since the draw item count changed.
+		DS_VERIFY(dsAllocator_free(allocator, modelList->sortKeys));
+		DS_VERIFY(dsAllocator_free(allocator, modelList->tempSortKeys));
+		modelList->sortKeys = DS_ALLOCATE_OBJECT_ARRAY(allocator, dsSortKey, drawItemCount);
+		modelList->tempSortKeys = DS_ALLOCATE_OBJECT_ARRAY(allocator, dsSortKey, drawItemCount);
+		modelList->sortedKeys = NULL;
+		modelList->lastSortedCount = 0;
+		if (!modelList->sortKeys || !modelList->tempSortKeys)
+		{
+			// Draw unsorted rather than failing.
+			DS_VERIFY(dsAllocator_free(allocator, modelList->sortKeys));
+			DS_VERIFY(dsAllocator_free(allocator, modelList->tempSortKeys));
+			modelList->sortKeys = NULL;
+			modelList->tempSortKeys = NULL;
+			modelList->maxSortKeys = 0;
+			DS_PROFILE_FUNC_RETURN(NULL);
+		}
+		modelList->maxSortKeys = drawItemCount;
+	}
+
+	// When the number of draw items is unchanged, the items are likely the same as the previous
+	// sort and their order will only change slightly as the camera and models move. Start from the
+	// previous order and use an insertion sort, falling back to a full sort if too far out of
+	// order.
+	const DrawItem* drawItems = modelList->drawItems;
+	dsSortKey* keys = modelList->sortedKeys;
+	if (modelList->reuseSortOrder && keys && drawItemCount == modelList->lastSortedCount)
+	{
+		for (uint32_t i = 0; i < drawItemCount; ++i)
+			keys[i].key = getSortKey(modelList, drawItems + keys[i].index);
+
+		if (dsInsertionSortKeys(keys, drawItemCount, drawItemCount))
+			DS_PROFILE_FUNC_RETURN(keys);
+	}
+	else
+	{
+		keys = modelList->sortKeys;
+		for (uint32_t i = 0; i < drawItemCount; ++i)
+		{
+			keys[i].key = getSortKey(modelList, drawItems + i);
+			keys[i].index = i;
+		}
+	}
+
+	dsSortKey* tempKeys =
+		keys == modelList->sortKeys ? modelList->tempSortKeys : modelList->sortKeys;
+	modelList->sortedKeys = dsRadixSortKeys(keys, tempKeys, drawItemCount);
+	modelList->lastSortedCount = drawItemCount;
+	DS_PROFILE_FUNC_RETURN(modelList->sortedKeys);
 }
 
-static void drawGeometry(dsSceneModelList* modelList, uint32_t drawItemCount, const dsView* view,
-	dsCommandBuffer* commandBuffer)
+static void drawGeometry(dsSceneModelList* modelList, const dsSortKey* sortKeys,
+	uint32_t drawItemCount, const dsView* view, dsCommandBuffer* commandBuffer)
 {
 	DS_PROFILE_FUNC_START();
 
@@ -246,7 +569,7 @@ static void drawGeometry(dsSceneModelList* modelList, uint32_t drawItemCount, co
 	bool hasInstances = modelList->instanceDataCount > 0;
 	for (uint32_t i = 0; i < drawItemCount; ++i)
 	{
-		const DrawItem* drawItem = modelList->drawItems + i;
+		const DrawItem* drawItem = modelList->drawItems + (sortKeys ? sortKeys[i].index : i);
 		bool updateInstances = false;
 		if (drawItem->shader != lastShader || drawItem->material != lastMaterial)
 		{
@@ -300,6 +623,110 @@ static void drawGeometry(dsSceneModelList* modelList, uint32_t drawItemCount, co
 	DS_PROFILE_FUNC_RETURN_VOID();
 }
 
+static void drawInstancedGeometry(dsSceneModelList* modelList, const dsSortKey* sortKeys,
+	uint32_t drawItemCount, uint32_t maxInstanceRange, const dsView* view,
+	dsCommandBuffer* commandBuffer)
+{
+	DS_PROFILE_FUNC_START();
+
+	dsRenderer* renderer = commandBuffer->renderer;
+	dsShader* lastShader = NULL;
+	dsMaterial* lastMaterial = NULL;
+	dsDynamicRenderStates* renderStates =
+		modelList->hasRenderStates ? &modelList->renderStates : NULL;
+	// Instance data was populated in draw order, with a copy for each instance a draw item reads.
+	uint32_t slot = 0;
+	for (uint32_t i = 0; i < drawItemCount;)
+	{
+		const DrawItem* drawItem = modelList->drawItems + (sortKeys ? sortKeys[i].index : i);
+		uint32_t firstInstance = slot;
+		uint32_t instanceCount = 1;
+		if (isSingleInstance(drawItem))
+		{
+			// Merge with the following draw items that are identical.
+			uint32_t mergeCount = 1;
+			while (mergeCount < maxInstanceRange && i + mergeCount < drawItemCount)
+			{
+				uint32_t nextIndex = i + mergeCount;
+				const DrawItem* nextDrawItem =
+					modelList->drawItems + (sortKeys ? sortKeys[nextIndex].index : nextIndex);
+				if (!canMergeDrawItems(drawItem, nextDrawItem))
+					break;
+				++mergeCount;
+			}
+
+			i += mergeCount;
+			slot += mergeCount;
+			instanceCount = mergeCount;
+		}
+		else
+		{
+			// Draw items with their own instances are never merged. They read the array with their
+			// own instance IDs, which must fit within the array.
+			++i;
+			instanceCount = getInstanceSlotCount(drawItem, maxInstanceRange);
+			if (instanceCount == 0)
+			{
+				DS_LOG_ERROR_F(DS_SCENE_LOG_TAG, "Model instances exceed the maximum instance "
+					"range %u for instancing in model list '%s'.", maxInstanceRange,
+					((dsSceneItemList*)modelList)->name);
+				continue;
+			}
+			slot += instanceCount;
+		}
+
+		if (drawItem->shader != lastShader || drawItem->material != lastMaterial)
+		{
+			if (lastShader)
+				dsShader_unbind(lastShader, commandBuffer);
+
+			lastShader = NULL;
+			lastMaterial = NULL;
+			if (!DS_CHECK(DS_SCENE_LOG_TAG, dsShader_bind(drawItem->shader, commandBuffer,
+					drawItem->material, view->globalValues, renderStates)))
+			{
+				continue;
+			}
+
+			lastShader = drawItem->shader;
+			lastMaterial = drawItem->material;
+		}
+
+		for (uint32_t j = 0; j < modelList->instanceDataCount; ++j)
+		{
+			DS_CHECK(DS_SCENE_LOG_TAG, dsSceneInstanceData_bindInstanceRange(
+				modelList->instanceData[j], firstInstance, instanceCount,
+				modelList->instanceValues));
+		}
+
+		DS_CHECK(DS_SCENE_LOG_TAG, dsShader_updateInstanceValues(drawItem->shader,
+			commandBuffer, modelList->instanceValues));
+
+		bool merged = instanceCount > 1 && isSingleInstance(drawItem);
+		if (drawItem->geometry->indexBuffer.buffer)
+		{
+			dsDrawIndexedRange drawRange = drawItem->drawIndexedRange;
+			if (merged)
+				drawRange.instanceCount = instanceCount;
+			DS_CHECK(DS_SCENE_LOG_TAG, dsRenderer_drawIndexed(renderer, commandBuffer,
+				drawItem->geometry, &drawRange, drawItem->primitiveType));
+		}
+		else
+		{
+			dsDrawRange drawRange = drawItem->drawRange;
+			if (merged)
+				drawRange.instanceCount = instanceCount;
+			DS_CHECK(DS_SCENE_LOG_TAG, dsRenderer_draw(renderer, commandBuffer,
+				drawItem->geometry, &drawRange, drawItem->primitiveType));
+		}
+	}
+
+	if (lastShader)
+		dsShader_unbind(lastShader, commandBuffer);
+
+	DS_PROFILE_FUNC_RETURN_VOID();
+}
+
 static void cleanup(dsSceneModelList* modelList)
 {
 	for (uint32_t i = 0; i < modelList->instanceDataCount; ++i)
@@ -323,6 +750,13 @@ uint64_t dsSceneModelList_addNode(dsSceneItemList* itemList, dsSceneNode* node,
 		return DS_NO_SCENE_NODE;
 
 	dsSceneModelList* modelList = (dsSceneModelList*)itemList;
+	const dsSceneModelNode* modelNode = (const dsSceneModelNode*)node;
+	uint32_t modelCount = 0;
+	for (uint32_t i = 0; i < modelNode->modelCount; ++i)
+	{
+		if (modelNode->models[i].listNameID == itemList->nameID)
+			++modelCount;
+	}
 
 	uint32_t index = modelList->entryCount;
 	if (!DS_RESIZEABLE_ARRAY_ADD(itemList->allocator, modelList->entries, modelList->entryCount,
@@ -331,27 +765,96 @@ uint64_t dsSceneModelList_addNode(dsSceneItemList* itemList, dsSceneNode* node,
 		return DS_NO_SCENE_NODE;
 	}
 
+	uint64_t nodeID = dsSlotMap_add(&modelList->entrySlots);
+	if (nodeID == DS_INVALID_SLOT_HANDLE)
+	{
+		--modelList->entryCount;
+		return DS_NO_SCENE_NODE;
+	}
+
 	Entry* entry = modelList->entries + index;
 	entry->node = (dsSceneModelNode*)node;
 	entry->transform = transform;
 	entry->itemData = itemData;
-	entry->nodeID = modelList->nextNodeID++;
-	return entry->nodeID;
+	entry->modelCount = modelCount;
+	modelList->totalModelCount += modelCount;
+	return nodeID;
 }
 
 void dsSceneModelList_removeNode(dsSceneItemList* itemList, uint64_t nodeID)
 {
+	// Order shouldn't matter, so use constant-time removal.
+	dsSceneModelList* modelList = (dsSceneModelList*)itemList;
+	uint32_t index = dsSlotMap_remove(&modelList->entrySlots, nodeID);
+	DS_ASSERT(index != DS_INVALID_SLOT_INDEX);
+	if (index == DS_INVALID_SLOT_INDEX)
+		return;
+
+	DS_ASSERT(modelList->totalModelCount >= modelList->entries[index].modelCount);
+	modelList->totalModelCount -= modelList->entries[index].modelCount;
+
+	--modelList->entryCount;
+	DS_ASSERT(modelList->entryCount == modelList->entrySlots.elementCount);
+	if (index < modelList->entryCount)
+		modelList->entries[index] = modelList->entries[modelList->entryCount];
+}
+
+uint32_t dsSceneModelList_prepareRanges(dsSceneItemList* itemList, const dsView* view,
+	uint32_t maxRanges)
+{
+	DS_UNUSED(view);
 	dsSceneModelList* modelList = (dsSceneModelList*)itemList;
-	for (uint32_t i = 0; i < modelList->entryCount; ++i)
+	uint32_t rangeCount = (modelList->entryCount + MIN_RANGE_SIZE - 1)/MIN_RANGE_SIZE;
+	if (rangeCount > maxRanges)
+		rangeCount = maxRanges;
+
+	// Not worth the overhead of splitting when there's only a single range. Fall back to
+	// processing on a single thread if memory couldn't be reserved.
+	modelList->rangeCount = 0;
+	if (rangeCount <= 1 || !reserveInstances(modelList))
+		return 0;
+
+	uint32_t dummyRangeCount = 0;
+	if (!DS_RESIZEABLE_ARRAY_ADD(itemList->allocator, modelList->ranges, dummyRangeCount,
+			modelList->maxRanges, rangeCount))
 	{
-		if (modelList->entries[i].nodeID != nodeID)
-			continue;
+		return 0;
+	}
 
-		// Order shouldn't matter, so use constant-time removal.
-		modelList->entries[i] = modelList->entries[modelList->entryCount - 1];
-		--modelList->entryCount;
-		break;
+	// Each range starts its draw items after the models for the entries in the previous ranges.
+	uint64_t entryCount = modelList->entryCount;
+	uint32_t entryIndex = 0;
+	uint32_t modelCount = 0;
+	for (uint32_t i = 0; i < rangeCount; ++i)
+	{
+		RangeInfo* range = modelList->ranges + i;
+		uint32_t firstEntry = (uint32_t)(entryCount*i/rangeCount);
+		for (; entryIndex < firstEntry; ++entryIndex)
+			modelCount += modelList->entries[entryIndex].modelCount;
+
+		range->firstInstance = firstEntry;
+		range->instanceCount = 0;
+		range->firstDrawItem = modelCount;
+		range->drawItemCount = 0;
 	}
+	DS_ASSERT(modelCount <= modelList->totalModelCount);
+
+	modelList->rangeCount = rangeCount;
+	return rangeCount;
+}
+
+void dsSceneModelList_commitRange(dsSceneItemList* itemList, const dsView* view, uint32_t range)
+{
+	DS_PROFILE_DYNAMIC_SCOPE_START(itemList->name);
+
+	dsSceneModelList* modelList = (dsSceneModelList*)itemList;
+	DS_ASSERT(range < modelList->rangeCount);
+	uint64_t entryCount = modelList->entryCount;
+	uint32_t firstEntry = (uint32_t)(entryCount*range/modelList->rangeCount);
+	uint32_t endEntry = (uint32_t)(entryCount*(range + 1)/modelList->rangeCount);
+	addInstances(modelList, view, modelList->ranges + range, firstEntry, endEntry - firstEntry);
+
+	DS_PROFILE_SCOPE_END();
 }
 
 void dsSceneModelList_commit(dsSceneItemList* itemList, const dsView* view,
@@ -363,10 +866,35 @@ void dsSceneModelList_commit(dsSceneItemList* itemList, const dsView* view,
 	dsSceneModelList* modelList = (dsSceneModelList*)itemList;
 	uint32_t instanceCount = 0;
 	uint32_t drawItemCount = 0;
-	addInstances(itemList, view, &instanceCount, &drawItemCount);
-	setupInstances(modelList, view, instanceCount);
-	sortGeometry(modelList, drawItemCount);
-	drawGeometry(modelList, drawItemCount, view, commandBuffer);
+	if (modelList->rangeCount > 0)
+	{
+		mergeRanges(modelList, &instanceCount, &drawItemCount);
+		modelList->rangeCount = 0;
+	}
+	else if (reserveInstances(modelList))
+	{
+		RangeInfo range = {0, 0, 0, 0};
+		addInstances(modelList, view, &range, 0, modelList->entryCount);
+		instanceCount = range.instanceCount;
+		drawItemCount = range.drawItemCount;
+	}
+
+	const dsSortKey* sortKeys = sortGeometry(modelList, drawItemCount);
+	uint32_t maxInstanceRange = getMaxInstanceRange(modelList);
+	uint32_t drawInstanceCount = 0;
+	if (maxInstanceRange > 0 &&
+		setupDrawInstances(&drawInstanceCount, modelList, sortKeys, drawItemCount,
+			maxInstanceRange))
+	{
+		setupInstances(modelList, view, modelList->drawInstances, drawInstanceCount);
+		drawInstancedGeometry(modelList, sortKeys, drawItemCount, maxInstanceRange, view,
+			commandBuffer);
+	}
+	else
+	{
+		setupInstances(modelList, view, modelList->instances, instanceCount);
+		drawGeometry(modelList, sortKeys, drawItemCount, view, commandBuffer);
+	}
 	cleanup(modelList);
 
 	dsRenderer_popDebugGroup(commandBuffer->renderer, commandBuffer);
@@ -430,6 +958,8 @@ dsSceneModelList* dsSceneModelList_create(dsAllocator* allocator, const char* na
 	itemList->addNodeFunc = &dsSceneModelList_addNode;
 	itemList->updateNodeFunc = NULL;
 	itemList->removeNodeFunc = &dsSceneModelList_removeNode;
+	itemList->prepareRangesFunc = &dsSceneModelList_prepareRanges;
+	itemList->commitRangeFunc = &dsSceneModelList_commitRange;
 	itemList->commitFunc = &dsSceneModelList_commit;
 	itemList->destroyFunc = (dsDestroySceneItemListFunction)&dsSceneModelList_destroy;
 
@@ -442,6 +972,7 @@ dsSceneModelList* dsSceneModelList_create(dsAllocator* allocator, const char* na
 		modelList->hasRenderStates = false;
 	modelList->sortType = sortType;
 	modelList->cullNameID = cullName ? dsHashString(cullName) : 0;
+	modelList->instancing = false;
 
 	if (instanceDataCount > 0)
 	{
@@ -466,14 +997,29 @@ dsSceneModelList* dsSceneModelList_create(dsAllocator* allocator, const char* na
 	}
 	modelList->instanceDataCount = instanceDataCount;
 
+	DS_VERIFY(dsSlotMap_initialize(&modelList->entrySlots, allocator));
 	modelList->entries = NULL;
 	modelList->entryCount = 0;
 	modelList->maxEntries = 0;
-	modelList->nextNodeID = 0;
+	modelList->totalModelCount = 0;
 	modelList->instances = NULL;
 	modelList->drawItems = NULL;
 	modelList->maxInstances = 0;
 	modelList->maxDrawItems = 0;
+	modelList->drawInstances = NULL;
+	modelList->maxDrawInstances = 0;
+	memset(&modelList->shaderIDs, 0, sizeof(ResourceIDs));
+	memset(&modelList->materialIDs, 0, sizeof(ResourceIDs));
+	memset(&modelList->geometryIDs, 0, sizeof(ResourceIDs));
+	modelList->sortKeys = NULL;
+	modelList->tempSortKeys = NULL;
+	modelList->sortedKeys = NULL;
+	modelList->maxSortKeys = 0;
+	modelList->lastSortedCount = 0;
+	modelList->reuseSortOrder = true;
+	modelList->ranges = NULL;
+	modelList->rangeCount = 0;
+	modelList->maxRanges = 0;
 	return modelList;
 }
 
@@ -483,9 +1029,35 @@ dsModelSortType dsSceneModelList_getSortType(const dsSceneModelList* modelList)
 }
 
 void dsSceneModelList_setSortType(dsSceneModelList* modelList, dsModelSortType sortType)
+{
+	if (!modelList || modelList->sortType == sortType)
+		return;
+
+	modelList->sortType = sortType;
+	// The previous order is meaningless with a different sort.
+	modelList->lastSortedCount = 0;
+}
+
+bool dsSceneModelList_getReuseSortOrder(const dsSceneModelList* modelList)
+{
+	return modelList && modelList->reuseSortOrder;
+}
+
+void dsSceneModelList_setReuseSortOrder(dsSceneModelList* modelList, bool reuse)
+{
+	if (modelList)
+		modelList->reuseSortOrder = reuse;
+}
+
+bool dsSceneModelList_getInstancing(const dsSceneModelList* modelList)
+{
+	return modelList && modelList->instancing;
+}
+
+void dsSceneModelList_setInstancing(dsSceneModelList* modelList, bool instancing)
 {
 	if (modelList)
-		modelList->sortType = sortType;
+		modelList->instancing = instancing;
 }
 
 const dsDynamicRenderStates* dsSceneModelList_getRenderStates(const dsSceneModelList* modelList)
@@ -517,8 +1089,16 @@ void dsSceneModelList_destroy(dsSceneModelList* modelList)
 
 	destroyInstanceData(modelList->instanceData, modelList->instanceDataCount);
 	dsSharedMaterialValues_destroy(modelList->instanceValues);
+	dsSlotMap_shutdown(&modelList->entrySlots);
 	DS_VERIFY(dsAllocator_free(itemList->allocator, modelList->entries));
 	DS_VERIFY(dsAllocator_free(itemList->allocator, modelList->instances));
 	DS_VERIFY(dsAllocator_free(itemList->allocator, modelList->drawItems));
+	DS_VERIFY(dsAllocator_free(itemList->allocator, modelList->drawInstances));
+	destroyResourceIDs(&modelList->shaderIDs, itemList->allocator);
+	destroyResourceIDs(&modelList->materialIDs, itemList->allocator);
+	destroyResourceIDs(&modelList->geometryIDs, itemList->allocator);
+	DS_VERIFY(dsAllocator_free(itemList->allocator, modelList->sortKeys));
+	DS_VERIFY(dsAllocator_free(itemList->allocator, modelList->tempSortKeys));
+	DS_VERIFY(dsAllocator_free(itemList->allocator, modelList->ranges));
 	DS_VERIFY(dsAllocator_free(itemList->allocator, modelList));
 }
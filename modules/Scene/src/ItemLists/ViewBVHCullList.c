@@ -0,0 +1,338 @@
+/*
+ * Copyright 2020 Aaron Barany
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <DeepSea/Scene/ItemLists/ViewBVHCullList.h>
+
+#include <DeepSea/Core/Containers/Hash.h>
+#include <DeepSea/Core/Containers/ResizeableArray.h>
+#include <DeepSea/Core/Containers/SlotMap.h>
+#include <DeepSea/Core/Memory/Allocator.h>
+#include <DeepSea/Core/Memory/BufferAllocator.h>
+#include <DeepSea/Core/Assert.h>
+#include <DeepSea/Core/Error.h>
+#include <DeepSea/Core/Log.h>
+#include <DeepSea/Core/Profile.h>
+#include <DeepSea/Geometry/AlignedBox3.h>
+#include <DeepSea/Geometry/BVH.h>
+#include <DeepSea/Geometry/OrientedBox3.h>
+#include <DeepSea/Scene/Nodes/SceneModelNode.h>
+#include <DeepSea/Scene/Nodes/SceneNode.h>
+#include <DeepSea/Scene/View.h>
+
+#include <string.h>
+
+// Subtrees are re-built once they are 50% more expensive to traverse than when they were built.
+#define REBUILD_THRESHOLD 1.5f
+
+typedef struct Entry
+{
+	dsSceneModelNode* node;
+	const dsMatrix44f* transform;
+	bool* result;
+	dsAlignedBox3f bounds;
+} Entry;
+
+typedef struct dsViewBVHCullList
+{
+	dsSceneItemList itemList;
+
+	// The BVH objects are indices into the entries. Changes are applied incrementally, only
+	// re-building the full BVH if an incremental update fails.
+	dsBVH* bvh;
+	bool needsRebuild;
+	bool resetAllResults;
+
+	// Node IDs are slot map handles for the entries.
+	dsSlotMap entrySlots;
+	Entry* entries;
+	uint32_t entryCount;
+	uint32_t maxEntries;
+
+	// Entries that were visible for the last commit, so only they need to be reset.
+	uint32_t* visibleEntries;
+	uint32_t visibleEntryCount;
+	uint32_t maxVisibleEntries;
+} dsViewBVHCullList;
+
+static void updateBounds(Entry* entry)
+{
+	dsOrientedBox3f worldBounds = entry->node->bounds;
+	DS_VERIFY(dsOrientedBox3f_transform(&worldBounds, entry->transform));
+
+	dsVector3f corners[DS_BOX3_CORNER_COUNT];
+	DS_VERIFY(dsOrientedBox3f_corners(corners, &worldBounds));
+	dsAlignedBox3f_makeInvalid(&entry->bounds);
+	for (unsigned int i = 0; i < DS_BOX3_CORNER_COUNT; ++i)
+		dsAlignedBox3_addPoint(entry->bounds, corners[i]);
+}
+
+static bool getEntryBounds(void* outBounds, const dsBVH* bvh, const void* object)
+{
+	const dsViewBVHCullList* cullList = (const dsViewBVHCullList*)dsBVH_getUserData(bvh);
+	size_t index = (size_t)object;
+	DS_ASSERT(index < cullList->entryCount);
+	*(dsAlignedBox3f*)outBounds = cullList->entries[index].bounds;
+	return true;
+}
+
+static bool markVisible(void* userData, const dsBVH* bvh, const void* object,
+	const void* frustum)
+{
+	DS_UNUSED(bvh);
+	DS_UNUSED(frustum);
+	dsViewBVHCullList* cullList = (dsViewBVHCullList*)userData;
+	uint32_t index = (uint32_t)(size_t)object;
+	*cullList->entries[index].result = false;
+
+	// Reserved before intersecting the BVH.
+	DS_ASSERT(cullList->visibleEntryCount < cullList->maxVisibleEntries);
+	cullList->visibleEntries[cullList->visibleEntryCount++] = index;
+	return true;
+}
+
+static bool rebuildBVH(dsViewBVHCullList* cullList)
+{
+	if (!dsBVH_buildSAH(cullList->bvh, NULL, cullList->entryCount, DS_GEOMETRY_OBJECT_INDICES,
+			&getEntryBounds, NULL))
+	{
+		return false;
+	}
+
+	cullList->needsRebuild = false;
+	return true;
+}
+
+static bool reserveVisibleEntries(dsViewBVHCullList* cullList)
+{
+	DS_ASSERT(cullList->visibleEntryCount == 0);
+	if (!dsResizeableArray_add(cullList->itemList.allocator, (void**)&cullList->visibleEntries,
+			&cullList->visibleEntryCount, &cullList->maxVisibleEntries, sizeof(uint32_t),
+			cullList->entryCount))
+	{
+		return false;
+	}
+
+	cullList->visibleEntryCount = 0;
+	return true;
+}
+
+static void insertObject(dsViewBVHCullList* cullList, uint32_t index)
+{
+	// Fall back to re-building the full BVH if the change can't be tracked.
+	if (!cullList->needsRebuild && !dsBVH_insert(cullList->bvh, (const void*)(size_t)index))
+		cullList->needsRebuild = true;
+}
+
+static void removeObject(dsViewBVHCullList* cullList, uint32_t index)
+{
+	if (!cullList->needsRebuild && !dsBVH_remove(cullList->bvh, (const void*)(size_t)index))
+		cullList->needsRebuild = true;
+}
+
+uint64_t dsViewBVHCullList_addNode(dsSceneItemList* itemList, dsSceneNode* node,
+	const dsMatrix44f* transform, dsSceneNodeItemData* itemData, void** thisItemData)
+{
+	DS_UNUSED(itemData);
+	if (!dsSceneNode_isOfType(node, dsSceneModelNode_type()))
+		return DS_NO_SCENE_NODE;
+
+	// Nodes without bounds are never culled, which is the default when not part of the list.
+	dsSceneModelNode* modelNode = (dsSceneModelNode*)node;
+	if (!dsOrientedBox3_isValid(modelNode->bounds))
+		return DS_NO_SCENE_NODE;
+
+	dsViewBVHCullList* cullList = (dsViewBVHCullList*)itemList;
+
+	uint32_t index = cullList->entryCount;
+	if (!DS_RESIZEABLE_ARRAY_ADD(itemList->allocator, cullList->entries, cullList->entryCount,
+			cullList->maxEntries, 1))
+	{
+		return DS_NO_SCENE_NODE;
+	}
+
+	uint64_t nodeID = dsSlotMap_add(&cullList->entrySlots);
+	if (nodeID == DS_INVALID_SLOT_HANDLE)
+	{
+		--cullList->entryCount;
+		return DS_NO_SCENE_NODE;
+	}
+
+	Entry* entry = cullList->entries + index;
+	entry->node = modelNode;
+	entry->transform = transform;
+	entry->result = (bool*)thisItemData;
+	updateBounds(entry);
+
+	// Out of view until the next commit finds it visible.
+	*entry->result = true;
+	insertObject(cullList, index);
+	return nodeID;
+}
+
+void dsViewBVHCullList_updateNode(dsSceneItemList* itemList, uint64_t nodeID)
+{
+	dsViewBVHCullList* cullList = (dsViewBVHCullList*)itemList;
+	uint32_t index = dsSlotMap_getIndex(&cullList->entrySlots, nodeID);
+	DS_ASSERT(index != DS_INVALID_SLOT_INDEX);
+	if (index == DS_INVALID_SLOT_INDEX)
+		return;
+
+	updateBounds(cullList->entries + index);
+	if (!cullList->needsRebuild &&
+		!dsBVH_markDirty(cullList->bvh, (const void*)(size_t)index))
+	{
+		cullList->needsRebuild = true;
+	}
+}
+
+void dsViewBVHCullList_removeNode(dsSceneItemList* itemList, uint64_t nodeID)
+{
+	// Use constant-time removal. When the last entry is moved into the removed slot, its object
+	// is removed from the BVH and the removed object's leaf is kept to hold the moved entry,
+	// which only requires updating the bounds.
+	dsViewBVHCullList* cullList = (dsViewBVHCullList*)itemList;
+	uint32_t index = dsSlotMap_remove(&cullList->entrySlots, nodeID);
+	DS_ASSERT(index != DS_INVALID_SLOT_INDEX);
+	if (index == DS_INVALID_SLOT_INDEX)
+		return;
+
+	--cullList->entryCount;
+	DS_ASSERT(cullList->entryCount == cullList->entrySlots.elementCount);
+	removeObject(cullList, index);
+	if (index < cullList->entryCount)
+	{
+		cullList->entries[index] = cullList->entries[cullList->entryCount];
+		removeObject(cullList, cullList->entryCount);
+		insertObject(cullList, index);
+	}
+
+	// The visible entries may have moved, so all results need to be reset.
+	cullList->resetAllResults = true;
+}
+
+void dsViewBVHCullList_commit(dsSceneItemList* itemList, const dsView* view,
+	dsCommandBuffer* commandBuffer)
+{
+	DS_UNUSED(commandBuffer);
+	DS_PROFILE_DYNAMIC_SCOPE_START(itemList->name);
+
+	dsViewBVHCullList* cullList = (dsViewBVHCullList*)itemList;
+	if (cullList->resetAllResults)
+	{
+		for (uint32_t i = 0; i < cullList->entryCount; ++i)
+			*cullList->entries[i].result = true;
+		cullList->resetAllResults = false;
+	}
+	else
+	{
+		for (uint32_t i = 0; i < cullList->visibleEntryCount; ++i)
+			*cullList->entries[cullList->visibleEntries[i]].result = true;
+	}
+	cullList->visibleEntryCount = 0;
+
+	// Only re-build the full BVH if the incremental update fails.
+	bool updated = !cullList->needsRebuild &&
+		dsBVH_updateDirty(cullList->bvh, REBUILD_THRESHOLD);
+	if ((!updated && !rebuildBVH(cullList)) || !reserveVisibleEntries(cullList))
+	{
+		// Keep everything in view until the BVH can be built.
+		DS_LOG_ERROR_F(DS_SCENE_LOG_TAG, "Couldn't build BVH for cull list '%s'.",
+			itemList->name);
+		for (uint32_t i = 0; i < cullList->entryCount; ++i)
+			*cullList->entries[i].result = false;
+		cullList->resetAllResults = true;
+		DS_PROFILE_SCOPE_END();
+		return;
+	}
+
+	dsBVH_intersectFrustum(cullList->bvh, &view->viewFrustum, &markVisible, cullList);
+	DS_PROFILE_SCOPE_END();
+}
+
+void dsViewBVHCullList_destroy(dsSceneItemList* itemList)
+{
+	dsViewBVHCullList* cullList = (dsViewBVHCullList*)itemList;
+	dsBVH_destroy(cullList->bvh);
+	dsSlotMap_shutdown(&cullList->entrySlots);
+	DS_VERIFY(dsAllocator_free(itemList->allocator, cullList->entries));
+	DS_VERIFY(dsAllocator_free(itemList->allocator, cullList->visibleEntries));
+	DS_VERIFY(dsAllocator_free(itemList->allocator, itemList));
+}
+
+dsSceneItemList* dsViewBVHCullList_create(dsAllocator* allocator, const char* name)
+{
+	if (!allocator || !name)
+	{
+		errno = EINVAL;
+		return NULL;
+	}
+
+	if (!allocator->freeFunc)
+	{
+		errno = EINVAL;
+		DS_LOG_ERROR(DS_SCENE_LOG_TAG,
+			"View BVH cull list allocator must support freeing memory.");
+		return NULL;
+	}
+
+	size_t nameLen = strlen(name);
+	size_t fullSize = DS_ALIGNED_SIZE(sizeof(dsViewBVHCullList)) + DS_ALIGNED_SIZE(nameLen + 1);
+	void* buffer = dsAllocator_alloc(allocator, fullSize);
+	if (!buffer)
+		return NULL;
+
+	dsBufferAllocator bufferAlloc;
+	DS_VERIFY(dsBufferAllocator_initialize(&bufferAlloc, buffer, fullSize));
+	dsViewBVHCullList* cullList = DS_ALLOCATE_OBJECT(&bufferAlloc, dsViewBVHCullList);
+	DS_ASSERT(cullList);
+
+	cullList->bvh = dsBVH_create(allocator, 3, dsGeometryElement_Float, cullList);
+	if (!cullList->bvh)
+	{
+		DS_VERIFY(dsAllocator_free(allocator, buffer));
+		return NULL;
+	}
+
+	// Build the empty BVH to allow inserting the entries as they're added.
+	DS_VERIFY(dsBVH_buildSAH(cullList->bvh, NULL, 0, DS_GEOMETRY_OBJECT_INDICES, &getEntryBounds,
+		NULL));
+
+	dsSceneItemList* itemList = (dsSceneItemList*)cullList;
+	itemList->allocator = allocator;
+	itemList->name = DS_ALLOCATE_OBJECT_ARRAY(&bufferAlloc, char, nameLen + 1);
+	memcpy((void*)itemList->name, name, nameLen + 1);
+	itemList->nameID = dsHashString(name);
+	itemList->needsCommandBuffer = false;
+	itemList->addNodeFunc = &dsViewBVHCullList_addNode;
+	itemList->updateNodeFunc = &dsViewBVHCullList_updateNode;
+	itemList->removeNodeFunc = &dsViewBVHCullList_removeNode;
+	itemList->prepareRangesFunc = NULL;
+	itemList->commitRangeFunc = NULL;
+	itemList->commitFunc = &dsViewBVHCullList_commit;
+	itemList->destroyFunc = &dsViewBVHCullList_destroy;
+
+	cullList->needsRebuild = false;
+	cullList->resetAllResults = false;
+	DS_VERIFY(dsSlotMap_initialize(&cullList->entrySlots, allocator));
+	cullList->entries = NULL;
+	cullList->entryCount = 0;
+	cullList->maxEntries = 0;
+	cullList->visibleEntries = NULL;
+	cullList->visibleEntryCount = 0;
+	cullList->maxVisibleEntries = 0;
+
+	return itemList;
+}
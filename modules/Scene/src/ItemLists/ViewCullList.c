@@ -18,37 +18,72 @@
 
 #include <DeepSea/Core/Containers/Hash.h>
 #include <DeepSea/Core/Containers/ResizeableArray.h>
+#include <DeepSea/Core/Containers/SlotMap.h>
 #include <DeepSea/Core/Memory/Allocator.h>
 #include <DeepSea/Core/Memory/BufferAllocator.h>
 #include <DeepSea/Core/Assert.h>
 #include <DeepSea/Core/Error.h>
 #include <DeepSea/Core/Profile.h>
+#include <DeepSea/Geometry/CullBoxArray.h>
 #include <DeepSea/Geometry/OrientedBox3.h>
-#include <DeepSea/Geometry/Frustum3.h>
 #include <DeepSea/Scene/Nodes/SceneModelNode.h>
 #include <DeepSea/Scene/Nodes/SceneNode.h>
 #include <DeepSea/Scene/View.h>
 
 #include <string.h>
 
+// Minimum number of entries to cull in a single range when committing across threads. This must
+// be a multiple of DS_CULL_BOX_MASK_BITS.
+#define MIN_RANGE_SIZE 256
+
 typedef struct Entry
 {
 	dsSceneModelNode* node;
 	const dsMatrix44f* transform;
 	bool* result;
-	uint64_t nodeID;
 } Entry;
 
 typedef struct dsViewCullList
 {
 	dsSceneItemList itemList;
 
+	// Node IDs are slot map handles for the entries. World-space bounds for each entry are kept
+	// in the same order as the entries.
+	dsSlotMap entrySlots;
+	dsCullBoxArray* boxes;
 	Entry* entries;
 	uint32_t entryCount;
 	uint32_t maxEntries;
-	uint64_t nextNodeID;
+
+	uint32_t* visibleMask;
+	uint32_t visibleMaskCount;
+	uint32_t maxVisibleMasks;
+
+	uint32_t rangeCount;
 } dsViewCullList;
 
+static void updateBox(dsViewCullList* cullList, uint32_t index)
+{
+	const Entry* entry = cullList->entries + index;
+	const dsOrientedBox3f* bounds = &entry->node->bounds;
+	if (dsOrientedBox3_isValid(*bounds))
+		DS_VERIFY(dsCullBoxArray_setOrientedBox(cullList->boxes, index, bounds, entry->transform));
+	else
+		DS_VERIFY(dsCullBoxArray_setInfinite(cullList->boxes, index));
+}
+
+static void cullEntries(dsViewCullList* cullList, const dsView* view, uint32_t start,
+	uint32_t end)
+{
+	dsCullBoxArray_intersectFrustum(cullList->visibleMask, cullList->boxes, &view->viewFrustum,
+		start, end - start);
+	for (uint32_t i = start; i < end; ++i)
+	{
+		uint32_t mask = cullList->visibleMask[i/DS_CULL_BOX_MASK_BITS];
+		*cullList->entries[i].result = (mask & (1U << (i % DS_CULL_BOX_MASK_BITS))) == 0;
+	}
+}
+
 uint64_t dsViewCullList_addNode(dsSceneItemList* itemList, dsSceneNode* node,
 	const dsMatrix44f* transform, dsSceneNodeItemData* itemData, void** thisItemData)
 {
@@ -65,59 +100,130 @@ uint64_t dsViewCullList_addNode(dsSceneItemList* itemList, dsSceneNode* node,
 		return DS_NO_SCENE_NODE;
 	}
 
+	// Keep the mask large enough for all entries so it never needs to be allocated when culling.
+	uint32_t maskCount = DS_CULL_BOX_MASK_COUNT(cullList->entryCount);
+	if (maskCount > cullList->visibleMaskCount &&
+		!DS_RESIZEABLE_ARRAY_ADD(itemList->allocator, cullList->visibleMask,
+			cullList->visibleMaskCount, cullList->maxVisibleMasks,
+			maskCount - cullList->visibleMaskCount))
+	{
+		--cullList->entryCount;
+		return DS_NO_SCENE_NODE;
+	}
+
+	if (!dsCullBoxArray_setBoxCount(cullList->boxes, cullList->entryCount))
+	{
+		--cullList->entryCount;
+		return DS_NO_SCENE_NODE;
+	}
+
+	uint64_t nodeID = dsSlotMap_add(&cullList->entrySlots);
+	if (nodeID == DS_INVALID_SLOT_HANDLE)
+	{
+		--cullList->entryCount;
+		DS_VERIFY(dsCullBoxArray_setBoxCount(cullList->boxes, cullList->entryCount));
+		return DS_NO_SCENE_NODE;
+	}
+
 	Entry* entry = cullList->entries + index;
 	entry->node = (dsSceneModelNode*)node;
 	entry->transform = transform;
 	entry->result = (bool*)thisItemData;
-	entry->nodeID = cullList->nextNodeID++;
-	return entry->nodeID;
+	updateBox(cullList, index);
+	return nodeID;
+}
+
+void dsViewCullList_updateNode(dsSceneItemList* itemList, uint64_t nodeID)
+{
+	dsViewCullList* cullList = (dsViewCullList*)itemList;
+	uint32_t index = dsSlotMap_getIndex(&cullList->entrySlots, nodeID);
+	DS_ASSERT(index != DS_INVALID_SLOT_INDEX);
+	if (index != DS_INVALID_SLOT_INDEX)
+		updateBox(cullList, index);
 }
 
 void dsViewCullList_removeNode(dsSceneItemList* itemList, uint64_t nodeID)
 {
+	// Order shouldn't matter, so use constant-time removal.
 	dsViewCullList* cullList = (dsViewCullList*)itemList;
-	for (uint32_t i = 0; i < cullList->entryCount; ++i)
+	uint32_t index = dsSlotMap_remove(&cullList->entrySlots, nodeID);
+	DS_ASSERT(index != DS_INVALID_SLOT_INDEX);
+	if (index == DS_INVALID_SLOT_INDEX)
+		return;
+
+	--cullList->entryCount;
+	DS_ASSERT(cullList->entryCount == cullList->entrySlots.elementCount);
+	if (index < cullList->entryCount)
 	{
-		if (cullList->entries[i].nodeID != nodeID)
-			continue;
+		cullList->entries[index] = cullList->entries[cullList->entryCount];
+		DS_VERIFY(dsCullBoxArray_copyBox(cullList->boxes, index, cullList->entryCount));
+	}
+	DS_VERIFY(dsCullBoxArray_setBoxCount(cullList->boxes, cullList->entryCount));
+}
 
-		// Order shouldn't matter, so use constant-time removal.
-		cullList->entries[i] = cullList->entries[cullList->entryCount - 1];
-		--cullList->entryCount;
-		break;
+uint32_t dsViewCullList_prepareRanges(dsSceneItemList* itemList, const dsView* view,
+	uint32_t maxRanges)
+{
+	DS_UNUSED(view);
+	dsViewCullList* cullList = (dsViewCullList*)itemList;
+	uint32_t rangeCount = (cullList->entryCount + MIN_RANGE_SIZE - 1)/MIN_RANGE_SIZE;
+	if (rangeCount > maxRanges)
+		rangeCount = maxRanges;
+
+	// Not worth the overhead of splitting when there's only a single range.
+	if (rangeCount <= 1)
+		rangeCount = 0;
+	cullList->rangeCount = rangeCount;
+	return rangeCount;
+}
+
+void dsViewCullList_commitRange(dsSceneItemList* itemList, const dsView* view, uint32_t range)
+{
+	DS_PROFILE_DYNAMIC_SCOPE_START(itemList->name);
+
+	// Ranges start on a mask element boundary so each range writes to separate mask elements.
+	dsViewCullList* cullList = (dsViewCullList*)itemList;
+	DS_ASSERT(range < cullList->rangeCount);
+	uint64_t entryCount = cullList->entryCount;
+	uint32_t start = (uint32_t)(entryCount*range/cullList->rangeCount);
+	start -= start % DS_CULL_BOX_MASK_BITS;
+	uint32_t end;
+	if (range == cullList->rangeCount - 1)
+		end = cullList->entryCount;
+	else
+	{
+		end = (uint32_t)(entryCount*(range + 1)/cullList->rangeCount);
+		end -= end % DS_CULL_BOX_MASK_BITS;
 	}
+	cullEntries(cullList, view, start, end);
+
+	DS_PROFILE_SCOPE_END();
 }
 
 void dsViewCullList_commit(dsSceneItemList* itemList, const dsView* view,
 	dsCommandBuffer* commandBuffer)
 {
 	DS_UNUSED(commandBuffer);
-	DS_PROFILE_DYNAMIC_SCOPE_START(itemList->name);
-
 	dsViewCullList* cullList = (dsViewCullList*)itemList;
-	for (uint32_t i = 0; i < cullList->entryCount; ++i)
+	if (cullList->rangeCount > 0)
 	{
-		const Entry* entry = cullList->entries + i;
-		dsSceneModelNode* modelNode = entry->node;
-		if (dsOrientedBox3_isValid(modelNode->bounds))
-		{
-			dsOrientedBox3f transformedBounds = modelNode->bounds;
-			DS_VERIFY(dsOrientedBox3f_transform(&transformedBounds, entry->transform));
-			*entry->result =
-				dsFrustum3f_intersectOrientedBox(&view->viewFrustum, &transformedBounds) ==
-					dsIntersectResult_Outside;
-		}
-		else
-			*entry->result = false;
+		// Already culled by the ranges.
+		cullList->rangeCount = 0;
+		return;
 	}
 
+	DS_PROFILE_DYNAMIC_SCOPE_START(itemList->name);
+	cullEntries(cullList, view, 0, cullList->entryCount);
 	DS_PROFILE_SCOPE_END();
 }
 
 void dsViewCullList_destroy(dsSceneItemList* itemList)
 {
 	dsViewCullList* cullList = (dsViewCullList*)itemList;
+	dsSlotMap_shutdown(&cullList->entrySlots);
+	dsCullBoxArray_destroy(cullList->boxes);
 	DS_VERIFY(dsAllocator_free(itemList->allocator, cullList->entries));
+	DS_VERIFY(dsAllocator_free(itemList->allocator, cullList->visibleMask));
 	DS_VERIFY(dsAllocator_free(itemList->allocator, itemList));
 }
 
@@ -147,6 +253,13 @@ dsSceneItemList* dsViewCullList_create(dsAllocator* allocator, const char* name)
 	dsViewCullList* cullList = DS_ALLOCATE_OBJECT(&bufferAlloc, dsViewCullList);
 	DS_ASSERT(cullList);
 
+	cullList->boxes = dsCullBoxArray_create(allocator, 0);
+	if (!cullList->boxes)
+	{
+		DS_VERIFY(dsAllocator_free(allocator, buffer));
+		return NULL;
+	}
+
 	dsSceneItemList* itemList = (dsSceneItemList*)cullList;
 	itemList->allocator = allocator;
 	itemList->name = DS_ALLOCATE_OBJECT_ARRAY(&bufferAlloc, char, nameLen + 1);
@@ -154,15 +267,21 @@ dsSceneItemList* dsViewCullList_create(dsAllocator* allocator, const char* name)
 	itemList->nameID = dsHashString(name);
 	itemList->needsCommandBuffer = false;
 	itemList->addNodeFunc = &dsViewCullList_addNode;
-	itemList->updateNodeFunc = NULL;
+	itemList->updateNodeFunc = &dsViewCullList_updateNode;
 	itemList->removeNodeFunc = &dsViewCullList_removeNode;
+	itemList->prepareRangesFunc = &dsViewCullList_prepareRanges;
+	itemList->commitRangeFunc = &dsViewCullList_commitRange;
 	itemList->commitFunc = &dsViewCullList_commit;
 	itemList->destroyFunc = &dsViewCullList_destroy;
 
+	DS_VERIFY(dsSlotMap_initialize(&cullList->entrySlots, allocator));
 	cullList->entries = NULL;
 	cullList->entryCount = 0;
 	cullList->maxEntries = 0;
-	cullList->nextNodeID = 0;
+	cullList->visibleMask = NULL;
+	cullList->visibleMaskCount = 0;
+	cullList->maxVisibleMasks = 0;
+	cullList->rangeCount = 0;
 
 	return itemList;
 }
@@ -16,6 +16,7 @@
 
 #include <DeepSea/Scene/Nodes/SceneModelNode.h>
 
+#include "Nodes/SceneTreeNode.h"
 #include <DeepSea/Core/Containers/Hash.h>
 #include <DeepSea/Core/Memory/Allocator.h>
 #include <DeepSea/Core/Memory/BufferAllocator.h>
@@ -248,6 +249,23 @@ dsSceneModelNode* dsSceneModelNode_createBase(dsAllocator* allocator, size_t str
 	return node;
 }
 
+bool dsSceneModelNode_setBounds(dsSceneModelNode* node, const dsOrientedBox3f* bounds)
+{
+	if (!node || !bounds || !dsOrientedBox3_isValid(*bounds))
+	{
+		errno = EINVAL;
+		return false;
+	}
+
+	node->bounds = *bounds;
+
+	// Mark the tree nodes as dirty so the item lists are updated with the new bounds.
+	dsSceneNode* baseNode = (dsSceneNode*)node;
+	for (uint32_t i = 0; i < baseNode->treeNodeCount; ++i)
+		dsSceneTreeNode_markDirty(baseNode->treeNodes[i]);
+	return true;
+}
+
 void dsSceneModelNode_destroy(dsSceneNode* node)
 {
 	dsSceneModelNode* modelNode = (dsSceneModelNode*)node;
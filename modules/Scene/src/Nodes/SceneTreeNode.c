@@ -34,8 +34,8 @@ static void updateTransform(dsSceneTreeNode* node)
 		dsSceneTransformNode* transformNode = (dsSceneTransformNode*)node->node;
 		if (node->parent)
 		{
-			dsMatrix44_affineMul(node->transform, node->parent->transform,
-				transformNode->transform);
+			dsMatrix44f_affineMul(&node->transform, &node->parent->transform,
+				&transformNode->transform);
 		}
 		else
 			node->transform = transformNode->transform;
@@ -98,6 +98,8 @@ static dsSceneTreeNode* addNode(dsSceneTreeNode* node, dsSceneNode* child,
 	childTreeNode->children = NULL;
 	childTreeNode->childCount = 0;
 	childTreeNode->maxChildren = 0;
+	childTreeNode->treeNodeIndex = treeNodeIndex;
+	childTreeNode->dirtyIndex = 0;
 	childTreeNode->dirty = false;
 	updateTransform(childTreeNode);
 
@@ -150,31 +152,39 @@ static bool buildSubtreeRec(dsSceneTreeNode* node, dsSceneNode* child, dsScene*
 	return true;
 }
 
-static uint32_t findTreeNodeIndex(dsSceneTreeNode* treeNode)
-{
-	dsSceneNode* node = treeNode->node;
-	for (uint32_t i = 0; i < node->treeNodeCount; ++i)
-	{
-		if (node->treeNodes[i] == treeNode)
-			return i;
-	}
-
-	DS_ASSERT(false);
-	return 0;
-}
-
 static void removeSubtreeRec(dsSceneNode* child, uint32_t treeNodeIndex, dsScene* scene)
 {
 	dsSceneTreeNode* childTreeNode = child->treeNodes[treeNodeIndex];
+	DS_ASSERT(childTreeNode->treeNodeIndex == treeNodeIndex);
 	// Remove the reference in the main node.
-	child->treeNodes[treeNodeIndex] = child->treeNodes[child->treeNodeCount - 1];
 	--child->treeNodeCount;
+	if (treeNodeIndex < child->treeNodeCount)
+	{
+		dsSceneTreeNode* movedTreeNode = child->treeNodes[child->treeNodeCount];
+		child->treeNodes[treeNodeIndex] = movedTreeNode;
+		movedTreeNode->treeNodeIndex = treeNodeIndex;
+	}
+
+	// Remove the node from the scene dirty list. The dirty list may have been cleared without
+	// resetting the dirty flag when the scene is being destroyed.
+	uint32_t dirtyIndex = childTreeNode->dirtyIndex;
+	if (childTreeNode->dirty && dirtyIndex < scene->dirtyNodeCount &&
+		scene->dirtyNodes[dirtyIndex] == childTreeNode)
+	{
+		--scene->dirtyNodeCount;
+		if (dirtyIndex < scene->dirtyNodeCount)
+		{
+			dsSceneTreeNode* movedTreeNode = scene->dirtyNodes[scene->dirtyNodeCount];
+			scene->dirtyNodes[dirtyIndex] = movedTreeNode;
+			movedTreeNode->dirtyIndex = dirtyIndex;
+		}
+	}
 
 	// Recurse for the children.
 	for (uint32_t i = 0; i < childTreeNode->childCount; ++i)
 	{
 		dsSceneTreeNode* nextTreeNode = childTreeNode->children[i];
-		removeSubtreeRec(nextTreeNode->node, findTreeNodeIndex(nextTreeNode), scene);
+		removeSubtreeRec(nextTreeNode->node, nextTreeNode->treeNodeIndex, scene);
 	}
 
 	// Dispose of the node.
@@ -191,17 +201,6 @@ static void removeSubtreeRec(dsSceneNode* child, uint32_t treeNodeIndex, dsScene
 	dsSceneNode_freeRef(childTreeNode->node);
 	DS_VERIFY(dsAllocator_free(childTreeNode->allocator, childTreeNode->children));
 	DS_VERIFY(dsAllocator_free(childTreeNode->allocator, childTreeNode));
-
-	// Remove the node from the scene dirty list.
-	for (uint32_t i = 0; i < scene->dirtyNodeCount; ++i)
-	{
-		if (scene->dirtyNodes[i] != childTreeNode)
-			continue;
-
-		scene->dirtyNodes[i] = scene->dirtyNodes[scene->dirtyNodeCount - 1];
-		--scene->dirtyNodeCount;
-		break;
-	}
 }
 
 static void updateSubtreeRec(dsSceneTreeNode* node)
@@ -277,6 +276,27 @@ void dsSceneTreeNode_removeSubtree(dsSceneNode* node, dsSceneNode* child)
 	}
 }
 
+void dsSceneTreeNode_markDirty(dsSceneTreeNode* node)
+{
+	// Already on the dirty list.
+	if (node->dirty)
+		return;
+
+	dsScene* scene = dsSceneTreeNode_getScene(node);
+	DS_ASSERT(scene);
+
+	uint32_t index = scene->dirtyNodeCount;
+	if (!DS_RESIZEABLE_ARRAY_ADD(scene->allocator, scene->dirtyNodes, scene->dirtyNodeCount,
+			scene->maxDirtyNodes, 1))
+	{
+		return;
+	}
+
+	scene->dirtyNodes[index] = node;
+	node->dirtyIndex = index;
+	node->dirty = true;
+}
+
 void dsSceneTreeNode_updateSubtree(dsSceneTreeNode* node)
 {
 	// This may have already been updated by a different subtree.
@@ -22,4 +22,5 @@
 dsScene* dsSceneTreeNode_getScene(dsSceneTreeNode* node);
 bool dsSceneTreeNode_buildSubtree(dsSceneNode* node, dsSceneNode* child);
 void dsSceneTreeNode_removeSubtree(dsSceneNode* node, dsSceneNode* child);
+void dsSceneTreeNode_markDirty(dsSceneTreeNode* node);
 void dsSceneTreeNode_updateSubtree(dsSceneTreeNode* node);
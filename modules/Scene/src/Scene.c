@@ -23,7 +23,7 @@
 #include <DeepSea/Core/Containers/HashTable.h>
 #include <DeepSea/Core/Memory/Allocator.h>
 #include <DeepSea/Core/Memory/BufferAllocator.h>
-#include <DeepSea/Core/Streams/FileStream.h>
+#include <DeepSea/Core/Streams/MappedFileStream.h>
 #include <DeepSea/Core/Streams/ResourceStream.h>
 #include <DeepSea/Core/Streams/Stream.h>
 #include <DeepSea/Core/Assert.h>
@@ -231,6 +231,8 @@ dsScene* dsScene_create(dsAllocator* allocator, dsRenderer* renderer,
 	rootTreeNode->childCount = 0;
 	rootTreeNode->maxChildren = 0;
 	dsMatrix44_identity(rootTreeNode->transform);
+	rootTreeNode->treeNodeIndex = 0;
+	rootTreeNode->dirtyIndex = 0;
 	rootTreeNode->dirty = false;
 	scene->rootTreeNode.scene = scene;
 	scene->rootTreeNodePtr = (dsSceneTreeNode*)&scene->rootTreeNode;
@@ -362,22 +364,21 @@ dsScene* dsScene_loadFile(dsAllocator* allocator, dsAllocator* resourceAllocator
 	if (!resourceAllocator)
 		resourceAllocator = allocator;
 
-	dsFileStream stream;
-	if (!dsFileStream_openPath(&stream, filePath, "rb"))
+	// Parse directly from the mapped file to avoid reading it into the scratch buffer.
+	dsMappedFileStream stream;
+	if (!dsMappedFileStream_openPath(&stream, filePath))
 	{
 		DS_LOG_ERROR_F(DS_RENDER_LOG_TAG, "Couldn't open scene file '%s'.", filePath);
 		DS_PROFILE_FUNC_RETURN(NULL);
 	}
 
 	size_t size;
-	void* buffer = dsSceneLoadScratchData_readUntilEnd(&size, scratchData, (dsStream*)&stream);
-	dsFileStream_close(&stream);
-	if (!buffer)
-		DS_PROFILE_FUNC_RETURN(NULL);
+	const void* buffer = dsMappedFileStream_getContents(&size, &stream);
+	DS_ASSERT(buffer);
 
 	dsScene* scene = dsScene_loadImpl(allocator, resourceAllocator, loadContext, scratchData,
 		buffer, size, userData, destroyUserDataFunc, filePath);
-	DS_VERIFY(dsSceneLoadScratchData_freeReadBuffer(scratchData, buffer));
+	DS_VERIFY(dsMappedFileStream_close(&stream));
 	DS_PROFILE_FUNC_RETURN(scene);
 }
 
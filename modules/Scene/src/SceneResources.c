@@ -21,7 +21,7 @@
 #include <DeepSea/Core/Memory/Allocator.h>
 #include <DeepSea/Core/Memory/BufferAllocator.h>
 #include <DeepSea/Core/Memory/PoolAllocator.h>
-#include <DeepSea/Core/Streams/FileStream.h>
+#include <DeepSea/Core/Streams/MappedFileStream.h>
 #include <DeepSea/Core/Streams/ResourceStream.h>
 #include <DeepSea/Core/Streams/Stream.h>
 #include <DeepSea/Core/Assert.h>
@@ -160,22 +160,21 @@ dsSceneResources* dsSceneResources_loadFile(dsAllocator* allocator, dsAllocator*
 		DS_PROFILE_FUNC_RETURN(NULL);
 	}
 
-	dsFileStream stream;
-	if (!dsFileStream_openPath(&stream, filePath, "rb"))
+	// Parse directly from the mapped file to avoid reading it into the scratch buffer.
+	dsMappedFileStream stream;
+	if (!dsMappedFileStream_openPath(&stream, filePath))
 	{
 		DS_LOG_ERROR_F(DS_RENDER_LOG_TAG, "Couldn't open scene resources file '%s'.", filePath);
 		DS_PROFILE_FUNC_RETURN(NULL);
 	}
 
 	size_t size;
-	void* buffer = dsSceneLoadScratchData_readUntilEnd(&size, scratchData, (dsStream*)&stream);
-	dsFileStream_close(&stream);
-	if (!buffer)
-		DS_PROFILE_FUNC_RETURN(NULL);
+	const void* buffer = dsMappedFileStream_getContents(&size, &stream);
+	DS_ASSERT(buffer);
 
 	dsSceneResources* resources = dsSceneResources_loadImpl(allocator, resourceAllocator,
 		loadContext, scratchData, buffer, size, filePath);
-	DS_VERIFY(dsSceneLoadScratchData_freeReadBuffer(scratchData, buffer));
+	DS_VERIFY(dsMappedFileStream_close(&stream));
 	DS_PROFILE_FUNC_RETURN(resources);
 }
 
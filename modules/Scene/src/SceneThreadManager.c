@@ -24,10 +24,13 @@
 #include <DeepSea/Core/Memory/BufferAllocator.h>
 #include <DeepSea/Core/Thread/ConditionVariable.h>
 #include <DeepSea/Core/Thread/Mutex.h>
-#include <DeepSea/Core/Thread/Spinlock.h>
 #include <DeepSea/Core/Thread/Thread.h>
 #include <DeepSea/Core/Assert.h>
+#include <DeepSea/Core/Atomic.h>
 #include <DeepSea/Core/Log.h>
+#include <DeepSea/Core/Profile.h>
+#include <DeepSea/Core/Timer.h>
+#include <DeepSea/Math/Core.h>
 #include <DeepSea/Scene/SceneGlobalData.h>
 #include <DeepSea/Render/Resources/Framebuffer.h>
 #include <DeepSea/Render/Resources/GfxFormat.h>
@@ -43,12 +46,15 @@
 // 512 KB
 #define THREAD_STACK_SIZE 524288
 
+// Number of ranges to allow per thread when splitting item lists. Having more ranges than threads
+// helps balance the load when some ranges take longer than others.
+#define RANGES_PER_THREAD 4
+
 typedef enum ThreadState
 {
 	ThreadState_Initializing,
 	ThreadState_Waiting,
-	ThreadState_SharedItems,
-	ThreadState_Pipeline,
+	ThreadState_Processing,
 	ThreadState_Stop,
 	ThreadState_ThreadError,
 	ThreadState_ResourceContextError
@@ -59,15 +65,37 @@ typedef struct DrawThread
 	dsThread thread;
 	dsSceneThreadManager* threadManager;
 	ThreadState state;
-	uint32_t sharedItemsIndex;
+#if DS_PROFILING_ENABLED
+	double lastItemEnd;
+#endif
 } DrawThread;
 
+// Pre-computed work for a single item list. Threads claim these with an atomic increment rather
+// than taking a lock to walk the scene structure.
+typedef struct WorkItem
+{
+	dsSceneItemList* itemList;
+	dsCommandBuffer* commandBuffer;
+	const dsFramebuffer* framebuffer;
+	const dsRenderPass* renderPass;
+	dsAlignedBox3f viewport;
+	uint32_t subpass;
+	uint32_t range;
+	bool commitRange;
+} WorkItem;
+
+// Range of work items that must all finish before the next phase can start.
+typedef struct Phase
+{
+	uint32_t firstWorkItem;
+	uint32_t workItemCount;
+} Phase;
+
 struct dsSceneThreadManager
 {
 	dsAllocator* allocator;
 	dsRenderer* renderer;
 	dsMutex* stateMutex;
-	dsSpinlock itemLock;
 	dsConditionVariable* stateCondition;
 	DrawThread* threads;
 	uint32_t threadCount;
@@ -80,154 +108,102 @@ struct dsSceneThreadManager
 	uint32_t commandBufferPointerCount;
 	uint32_t maxCommandBufferPointers;
 
+	WorkItem* workItems;
+	uint32_t workItemCount;
+	uint32_t maxWorkItems;
+
+	Phase* phases;
+	uint32_t phaseCount;
+	uint32_t maxPhases;
+
 	const dsView* curView;
 	const dsViewFramebufferInfo* curFramebufferInfos;
 	const dsRotatedFramebuffer* curFramebuffers;
 	const uint32_t* curPipelineFramebuffers;
 
+	const WorkItem* curWorkItems;
+	uint32_t curWorkItemCount;
+	uint32_t nextWorkItem;
+
 	uint32_t nextComputeCommandBuffer;
 	uint32_t nextSubpassCommandBuffer;
-	uint32_t nextItem;
-	uint32_t nextSubpass;
-	uint32_t nextSubpassItem;
-	uint32_t nextCommandBuffer;
 	uint64_t lastFrame;
+
+#if DS_PROFILING_ENABLED
+	dsTimer timer;
+	double drawStartTime;
+	double mainLastItemEnd;
+#endif
 };
 
-static void processSharedItems(dsSceneThreadManager* threadManager, uint32_t index)
+static void processWorkItem(const dsView* view, const WorkItem* workItem)
 {
-	const dsView* view = threadManager->curView;
-	const dsScene* scene = view->scene;
-	do
+	dsSceneItemList* itemList = workItem->itemList;
+	if (workItem->commitRange)
 	{
-		dsSceneItemList* itemList = NULL;
-		dsCommandBuffer* commandBuffer = NULL;
-		DS_VERIFY(dsSpinlock_lock(&threadManager->itemLock));
-		const dsSceneItemLists* sharedItems = scene->sharedItems + index;
-		if (threadManager->nextItem < sharedItems->count)
-		{
-			itemList = sharedItems->itemLists[threadManager->nextItem++];
-			if (itemList->needsCommandBuffer)
-			{
-				commandBuffer =
-					threadManager->commandBufferPointers[threadManager->nextCommandBuffer++];
-				DS_ASSERT(threadManager->nextCommandBuffer <=
-					threadManager->commandBufferPointerCount);
-			}
-		}
-		DS_VERIFY(dsSpinlock_unlock(&threadManager->itemLock));
-
-		if (!itemList)
-			return;
+		itemList->commitRangeFunc(itemList, view, workItem->range);
+		return;
+	}
 
-		if (commandBuffer)
+	dsCommandBuffer* commandBuffer = workItem->commandBuffer;
+	if (workItem->renderPass)
+	{
+		if (!dsCommandBuffer_beginSecondary(commandBuffer, workItem->framebuffer,
+				workItem->renderPass, workItem->subpass, &workItem->viewport))
 		{
-			if (!dsCommandBuffer_begin(commandBuffer))
-				continue;
+			return;
 		}
+	}
+	else if (commandBuffer)
+	{
+		if (!dsCommandBuffer_begin(commandBuffer))
+			return;
+	}
 
-		itemList->commitFunc(itemList, threadManager->curView, commandBuffer);
+	itemList->commitFunc(itemList, view, commandBuffer);
 
-		if (commandBuffer)
-			DS_VERIFY(dsCommandBuffer_end(commandBuffer));
-	} while (true);
+	if (commandBuffer)
+		DS_VERIFY(dsCommandBuffer_end(commandBuffer));
 }
 
-static void processPipeline(dsSceneThreadManager* threadManager)
+static void processWorkItems(dsSceneThreadManager* threadManager, double* lastItemEnd)
 {
 	const dsView* view = threadManager->curView;
-	const dsScene* scene = view->scene;
+	const WorkItem* workItems = threadManager->curWorkItems;
+	uint32_t workItemCount = threadManager->curWorkItemCount;
+
+#if DS_PROFILING_ENABLED
+	// Wait time is measured from finishing the previous item, including the wait for the previous
+	// phase to finish, until the next item is claimed. The start of the draw is used if this
+	// thread hasn't finished an item since then.
+	uint32_t claimedItems = 0;
+	double waitTime = 0;
+	double waitStart = dsMax(*lastItemEnd, threadManager->drawStartTime);
+#else
+	DS_UNUSED(lastItemEnd);
+#endif
 	do
 	{
-		const dsScenePipelineItem* item = NULL;
-		uint32_t subpass = 0;
-		uint32_t subpassItem = 0;
-		const dsViewFramebufferInfo* framebufferInfo = NULL;
-		const dsRotatedFramebuffer* framebuffer = NULL;
-		dsCommandBuffer* commandBuffer = NULL;
-
-		DS_VERIFY(dsSpinlock_lock(&threadManager->itemLock));
-		if (threadManager->nextItem < scene->pipelineCount)
-		{
-			bool needsCommandBuffer;
-			item = scene->pipeline + threadManager->nextItem;
-			if (item->renderPass)
-			{
-				uint32_t framebufferIndex =
-					threadManager->curPipelineFramebuffers[threadManager->nextItem];
-				framebufferInfo = threadManager->curFramebufferInfos + framebufferIndex;
-				framebuffer = threadManager->curFramebuffers + framebufferIndex;
-
-				subpass = threadManager->nextSubpass;
-				subpassItem = threadManager->nextSubpassItem++;
-
-				if (threadManager->nextSubpassItem >= item->renderPass->drawLists[subpass].count)
-				{
-					++threadManager->nextSubpass;
-					threadManager->nextSubpassItem = 0;
-					if (threadManager->nextSubpass >= item->renderPass->renderPass->subpassCount)
-					{
-						++threadManager->nextItem;
-						threadManager->nextSubpass = 0;
-					}
-				}
-				needsCommandBuffer = true;
-			}
-			else
-			{
-				++threadManager->nextItem;
-				needsCommandBuffer = item->computeItems->needsCommandBuffer;
-			}
-
-			if (needsCommandBuffer)
-			{
-				commandBuffer =
-					threadManager->commandBufferPointers[threadManager->nextCommandBuffer++];
-				DS_ASSERT(threadManager->nextCommandBuffer <=
-					threadManager->commandBufferPointerCount);
-			}
-		}
-		DS_VERIFY(dsSpinlock_unlock(&threadManager->itemLock));
-
-		if (!item)
-			return;
-
-		if (item->renderPass)
-		{
-			dsAlignedBox3f viewport = framebufferInfo->viewport;
-			dsView_adjustViewport(&viewport, view, framebuffer->rotated);
-			viewport.min.x *= (float)framebuffer->framebuffer->width;
-			viewport.max.x *= (float)framebuffer->framebuffer->width;
-			viewport.min.y *= (float)framebuffer->framebuffer->height;
-			viewport.max.y *= (float)framebuffer->framebuffer->height;
-
-			dsRenderPass* renderPass = item->renderPass->renderPass;
-			if (!dsCommandBuffer_beginSecondary(commandBuffer, framebuffer->framebuffer, renderPass,
-					subpass, &viewport))
-			{
-				continue;
-			}
-
-			dsSceneItemList* itemList = item->renderPass->drawLists[subpass].itemLists[subpassItem];
-			itemList->commitFunc(itemList, threadManager->curView, commandBuffer);
-
-			DS_VERIFY(dsCommandBuffer_end(commandBuffer));
-		}
-		else
-		{
-			if (commandBuffer)
-			{
-				if (!dsCommandBuffer_begin(commandBuffer))
-					continue;
-			}
-
-			dsSceneItemList* itemList = item->computeItems;
-			itemList->commitFunc(itemList, threadManager->curView, commandBuffer);
-
-			if (commandBuffer)
-				DS_VERIFY(dsCommandBuffer_end(commandBuffer));
-		}
+		uint32_t index = DS_ATOMIC_FETCH_ADD32(&threadManager->nextWorkItem, 1);
+		if (index >= workItemCount)
+			break;
+
+#if DS_PROFILING_ENABLED
+		++claimedItems;
+		waitTime += dsTimer_time(threadManager->timer) - waitStart;
+#endif
+
+		processWorkItem(view, workItems + index);
+#if DS_PROFILING_ENABLED
+		waitStart = dsTimer_time(threadManager->timer);
+#endif
 	} while (true);
+
+#if DS_PROFILING_ENABLED
+	*lastItemEnd = waitStart;
+#endif
+	DS_PROFILE_STAT("SceneThreadManager", "Claimed items", claimedItems);
+	DS_PROFILE_STAT("SceneThreadManager", "Wait time (us)", waitTime*1000000.0);
 }
 
 static dsThreadReturnType threadFunc(void* userData)
@@ -263,11 +239,12 @@ static dsThreadReturnType threadFunc(void* userData)
 
 		switch (state)
 		{
-			case ThreadState_SharedItems:
-				processSharedItems(threadManager, drawThread->sharedItemsIndex);
-				break;
-			case ThreadState_Pipeline:
-				processPipeline(threadManager);
+			case ThreadState_Processing:
+#if DS_PROFILING_ENABLED
+				processWorkItems(threadManager, &drawThread->lastItemEnd);
+#else
+				processWorkItems(threadManager, NULL);
+#endif
 				break;
 			case ThreadState_Stop:
 				dsResourceManager_destroyResourceContext(resourceManager);
@@ -295,16 +272,19 @@ static void waitForThreads(dsSceneThreadManager* threadManager)
 	threadManager->finishedCount = 0;
 }
 
-static void triggerThreads(dsSceneThreadManager* threadManager, ThreadState state,
-	uint32_t sharedItemsIndex)
+static void triggerThreads(dsSceneThreadManager* threadManager, uint32_t firstWorkItem,
+	uint32_t workItemCount)
 {
 	DS_ASSERT(threadManager->finishedCount == 0);
+	DS_ASSERT(firstWorkItem + workItemCount <= threadManager->workItemCount);
+	threadManager->curWorkItems = threadManager->workItems + firstWorkItem;
+	threadManager->curWorkItemCount = workItemCount;
+	threadManager->nextWorkItem = 0;
+
+	// Mutex lock guarantees the work items are visible to the other threads.
 	DS_VERIFY(dsMutex_lock(threadManager->stateMutex));
 	for (uint32_t i = 0; i < threadManager->threadCount; ++i)
-	{
-		threadManager->threads[i].state = state;
-		threadManager->threads[i].sharedItemsIndex = sharedItemsIndex;
-	}
+		threadManager->threads[i].state = ThreadState_Processing;
 	DS_VERIFY(dsConditionVariable_notifyAll(threadManager->stateCondition));
 	DS_VERIFY(dsMutex_unlock(threadManager->stateMutex));
 }
@@ -360,30 +340,139 @@ static dsCommandBuffer** getSubpassCommandBuffers(dsSceneThreadManager* threadMa
 	return commandBuffers;
 }
 
+static WorkItem* addWorkItems(dsSceneThreadManager* threadManager, uint32_t count)
+{
+	uint32_t index = threadManager->workItemCount;
+	if (!DS_RESIZEABLE_ARRAY_ADD(threadManager->allocator, threadManager->workItems,
+			threadManager->workItemCount, threadManager->maxWorkItems, count))
+	{
+		return NULL;
+	}
+
+	WorkItem* workItems = threadManager->workItems + index;
+	memset(workItems, 0, sizeof(WorkItem)*count);
+	return workItems;
+}
+
+static dsCommandBuffer** addCommandBufferPointers(dsSceneThreadManager* threadManager,
+	uint32_t count)
+{
+	uint32_t index = threadManager->commandBufferPointerCount;
+	if (!DS_RESIZEABLE_ARRAY_ADD(threadManager->allocator, threadManager->commandBufferPointers,
+			threadManager->commandBufferPointerCount, threadManager->maxCommandBufferPointers,
+			count))
+	{
+		return NULL;
+	}
+
+	return threadManager->commandBufferPointers + index;
+}
+
+static bool addPhase(dsSceneThreadManager* threadManager, uint32_t firstWorkItem)
+{
+	DS_ASSERT(firstWorkItem <= threadManager->workItemCount);
+	uint32_t workItemCount = threadManager->workItemCount - firstWorkItem;
+	if (workItemCount == 0)
+		return true;
+
+	uint32_t index = threadManager->phaseCount;
+	if (!DS_RESIZEABLE_ARRAY_ADD(threadManager->allocator, threadManager->phases,
+			threadManager->phaseCount, threadManager->maxPhases, 1))
+	{
+		return false;
+	}
+
+	Phase* phase = threadManager->phases + index;
+	phase->firstWorkItem = firstWorkItem;
+	phase->workItemCount = workItemCount;
+	return true;
+}
+
+static bool setupRangeWorkItems(dsSceneThreadManager* threadManager, dsSceneItemList* itemList)
+{
+	if (!itemList->prepareRangesFunc)
+		return true;
+
+	DS_ASSERT(itemList->commitRangeFunc);
+
+	// Reserve the work items before preparing so the item list never expects ranges that won't
+	// be committed.
+	uint32_t maxRanges = (threadManager->threadCount + 1)*RANGES_PER_THREAD;
+	uint32_t firstWorkItem = threadManager->workItemCount;
+	WorkItem* workItems = addWorkItems(threadManager, maxRanges);
+	if (!workItems)
+		return false;
+
+	uint32_t rangeCount = itemList->prepareRangesFunc(itemList, threadManager->curView,
+		maxRanges);
+	DS_ASSERT(rangeCount <= maxRanges);
+	threadManager->workItemCount = firstWorkItem + rangeCount;
+	for (uint32_t i = 0; i < rangeCount; ++i)
+	{
+		WorkItem* workItem = workItems + i;
+		workItem->itemList = itemList;
+		workItem->range = i;
+		workItem->commitRange = true;
+	}
+
+	return true;
+}
+
+static bool setupComputeWorkItem(dsSceneThreadManager* threadManager, dsSceneItemList* itemList)
+{
+	WorkItem* workItem = addWorkItems(threadManager, 1);
+	if (!workItem)
+		return false;
+
+	workItem->itemList = itemList;
+	if (!itemList->needsCommandBuffer)
+		return true;
+
+	dsCommandBuffer** commandBuffer = addCommandBufferPointers(threadManager, 1);
+	if (!commandBuffer)
+		return false;
+
+	*commandBuffer = getComputeCommandBuffer(threadManager);
+	if (!*commandBuffer)
+		return false;
+
+	workItem->commandBuffer = *commandBuffer;
+	return true;
+}
+
 static bool setupForDraw(dsSceneThreadManager* threadManager, const dsScene* scene)
 {
+	threadManager->workItemCount = 0;
+	threadManager->commandBufferPointerCount = 0;
+	threadManager->phaseCount = 0;
+
+	// Ranges for item lists that can be split must be committed in a separate phase before the
+	// main commit for the list.
 	for (uint32_t i = 0; i < scene->sharedItemCount; ++i)
 	{
 		const dsSceneItemLists* sharedItems = scene->sharedItems + i;
+		uint32_t firstWorkItem = threadManager->workItemCount;
 		for (uint32_t j = 0; j < sharedItems->count; ++j)
 		{
-			if (!sharedItems->itemLists[j]->needsCommandBuffer)
-				continue;
-
-			uint32_t index = threadManager->commandBufferPointerCount;
-			if (!DS_RESIZEABLE_ARRAY_ADD(threadManager->allocator,
-					threadManager->commandBufferPointers, threadManager->commandBufferPointerCount,
-					threadManager->maxCommandBufferPointers, 1))
-			{
+			if (!setupRangeWorkItems(threadManager, sharedItems->itemLists[j]))
 				return false;
-			}
+		}
+
+		if (!addPhase(threadManager, firstWorkItem))
+			return false;
 
-			threadManager->commandBufferPointers[index] = getComputeCommandBuffer(threadManager);
-			if (!threadManager->commandBufferPointers[index])
+		firstWorkItem = threadManager->workItemCount;
+		for (uint32_t j = 0; j < sharedItems->count; ++j)
+		{
+			if (!setupComputeWorkItem(threadManager, sharedItems->itemLists[j]))
 				return false;
 		}
+
+		if (!addPhase(threadManager, firstWorkItem))
+			return false;
 	}
 
+	uint32_t firstWorkItem = threadManager->workItemCount;
 	for (uint32_t i = 0; i < scene->pipelineCount; ++i)
 	{
 		dsSceneRenderPass* sceneRenderPass = scene->pipeline[i].renderPass;
@@ -393,45 +482,87 @@ static bool setupForDraw(dsSceneThreadManager* threadManager, const dsScene* sce
 			for (uint32_t j = 0; j < renderPass->subpassCount; ++j)
 			{
 				const dsSceneItemLists* drawLists = sceneRenderPass->drawLists + j;
-				uint32_t index = threadManager->commandBufferPointerCount;
-				if (!DS_RESIZEABLE_ARRAY_ADD(threadManager->allocator,
-						threadManager->commandBufferPointers,
-						threadManager->commandBufferPointerCount,
-						threadManager->maxCommandBufferPointers, drawLists->count))
+				for (uint32_t k = 0; k < drawLists->count; ++k)
 				{
-					return false;
+					if (!setupRangeWorkItems(threadManager, drawLists->itemLists[k]))
+						return false;
 				}
+			}
+		}
+		else
+		{
+			DS_ASSERT(scene->pipeline[i].computeItems);
+			if (!setupRangeWorkItems(threadManager, scene->pipeline[i].computeItems))
+				return false;
+		}
+	}
+
+	if (!addPhase(threadManager, firstWorkItem))
+		return false;
+
+	firstWorkItem = threadManager->workItemCount;
+	for (uint32_t i = 0; i < scene->pipelineCount; ++i)
+	{
+		dsSceneRenderPass* sceneRenderPass = scene->pipeline[i].renderPass;
+		if (sceneRenderPass)
+		{
+			uint32_t framebufferIndex = threadManager->curPipelineFramebuffers[i];
+			const dsViewFramebufferInfo* framebufferInfo =
+				threadManager->curFramebufferInfos + framebufferIndex;
+			const dsRotatedFramebuffer* framebuffer = threadManager->curFramebuffers +
+				framebufferIndex;
+
+			dsAlignedBox3f viewport = framebufferInfo->viewport;
+			dsView_adjustViewport(&viewport, threadManager->curView, framebuffer->rotated);
+			viewport.min.x *= (float)framebuffer->framebuffer->width;
+			viewport.max.x *= (float)framebuffer->framebuffer->width;
+			viewport.min.y *= (float)framebuffer->framebuffer->height;
+			viewport.max.y *= (float)framebuffer->framebuffer->height;
+
+			dsRenderPass* renderPass = sceneRenderPass->renderPass;
+			for (uint32_t j = 0; j < renderPass->subpassCount; ++j)
+			{
+				const dsSceneItemLists* drawLists = sceneRenderPass->drawLists + j;
+				if (drawLists->count == 0)
+					continue;
+
+				WorkItem* workItems = addWorkItems(threadManager, drawLists->count);
+				if (!workItems)
+					return false;
+
+				dsCommandBuffer** commandBufferPointers = addCommandBufferPointers(threadManager,
+					drawLists->count);
+				if (!commandBufferPointers)
+					return false;
 
 				dsCommandBuffer** commandBuffers = getSubpassCommandBuffers(threadManager,
 					drawLists->count);
 				if (!commandBuffers)
 					return false;
 
-				memcpy(threadManager->commandBufferPointers + index, commandBuffers,
+				memcpy(commandBufferPointers, commandBuffers,
 					sizeof(dsCommandBuffer*)*drawLists->count);
+				for (uint32_t k = 0; k < drawLists->count; ++k)
+				{
+					WorkItem* workItem = workItems + k;
+					workItem->itemList = drawLists->itemLists[k];
+					workItem->commandBuffer = commandBuffers[k];
+					workItem->framebuffer = framebuffer->framebuffer;
+					workItem->renderPass = renderPass;
+					workItem->viewport = viewport;
+					workItem->subpass = j;
+				}
 			}
 		}
 		else
 		{
 			DS_ASSERT(scene->pipeline[i].computeItems);
-			if (!scene->pipeline[i].computeItems->needsCommandBuffer)
-				continue;
-
-			uint32_t index = threadManager->commandBufferPointerCount;
-			if (!DS_RESIZEABLE_ARRAY_ADD(threadManager->allocator,
-					threadManager->commandBufferPointers, threadManager->commandBufferPointerCount,
-					threadManager->maxCommandBufferPointers, 1))
-			{
-				return false;
-			}
-
-			threadManager->commandBufferPointers[index] = getComputeCommandBuffer(threadManager);
-			if (!threadManager->commandBufferPointers[index])
+			if (!setupComputeWorkItem(threadManager, scene->pipeline[i].computeItems))
 				return false;
 		}
 	}
 
-	return true;
+	return addPhase(threadManager, firstWorkItem);
 }
 
 static bool submitCommandBuffers(dsSceneThreadManager* threadManager,
@@ -548,7 +679,9 @@ dsSceneThreadManager* dsSceneThreadManager_create(dsAllocator* allocator,
 	threadManager->renderer = renderer;
 	threadManager->stateMutex = dsMutex_create((dsAllocator*)&bufferAlloc, "Scene Thread State");
 	DS_ASSERT(threadManager->stateMutex);
-	DS_VERIFY(dsSpinlock_initialize(&threadManager->itemLock));
+#if DS_PROFILING_ENABLED
+	threadManager->timer = dsTimer_create();
+#endif
 
 	threadManager->stateCondition = dsConditionVariable_create((dsAllocator*)&bufferAlloc,
 		"Scene Thread Condition");
@@ -563,6 +696,9 @@ dsSceneThreadManager* dsSceneThreadManager_create(dsAllocator* allocator,
 		DrawThread* thread = threadManager->threads + i;
 		thread->state = ThreadState_Initializing;
 		thread->threadManager = threadManager;
+#if DS_PROFILING_ENABLED
+		thread->lastItemEnd = 0;
+#endif
 		if (!dsThread_create(&thread->thread, &threadFunc, thread, THREAD_STACK_SIZE, "Scene Draw"))
 		{
 			// If the thread failed to create, manually set the state as if it did execute.
@@ -621,7 +757,6 @@ bool dsSceneThreadManager_draw(dsSceneThreadManager* threadManager, const dsView
 	threadManager->curFramebufferInfos = framebufferInfos;
 	threadManager->curFramebuffers = framebuffers;
 	threadManager->curPipelineFramebuffers = pipelineFramebuffers;
-	threadManager->commandBufferPointerCount = 0;
 
 	if (threadManager->lastFrame != renderer->frameNumber)
 	{
@@ -633,27 +768,24 @@ bool dsSceneThreadManager_draw(dsSceneThreadManager* threadManager, const dsView
 	if (!setupForDraw(threadManager, scene))
 		return false;
 
-	// Shared items first.
-	threadManager->nextItem = 0;
-	threadManager->nextCommandBuffer = 0;
-	for (uint32_t i = 0; i < scene->sharedItemCount; ++i)
-	{
-		if (scene->sharedItems[i].count == 0)
-			continue;
+#if DS_PROFILING_ENABLED
+	threadManager->drawStartTime = dsTimer_time(threadManager->timer);
+#endif
 
-		triggerThreads(threadManager, ThreadState_SharedItems, i);
-		processSharedItems(threadManager, i);
+	// Shared items first, then the main rendering pipeline. Each phase must finish before the next
+	// starts.
+	for (uint32_t i = 0; i < threadManager->phaseCount; ++i)
+	{
+		const Phase* phase = threadManager->phases + i;
+		triggerThreads(threadManager, phase->firstWorkItem, phase->workItemCount);
+#if DS_PROFILING_ENABLED
+		processWorkItems(threadManager, &threadManager->mainLastItemEnd);
+#else
+		processWorkItems(threadManager, NULL);
+#endif
 		waitForThreads(threadManager);
 	}
 
-	// Once finished, main rendering pipeline.
-	threadManager->nextItem = 0;
-	threadManager->nextSubpass = 0;
-	threadManager->nextSubpassItem = 0;
-	triggerThreads(threadManager, ThreadState_Pipeline, 0);
-	processPipeline(threadManager);
-	waitForThreads(threadManager);
-
 	return submitCommandBuffers(threadManager, commandBuffer);
 }
 
@@ -689,10 +821,11 @@ bool dsSceneThreadManager_destroy(dsSceneThreadManager* threadManager)
 	}
 
 	dsMutex_destroy(threadManager->stateMutex);
-	dsSpinlock_shutdown(&threadManager->itemLock);
 	dsConditionVariable_destroy(threadManager->stateCondition);
 
 	DS_VERIFY(dsAllocator_free(threadManager->allocator, threadManager->commandBufferPointers));
+	DS_VERIFY(dsAllocator_free(threadManager->allocator, threadManager->workItems));
+	DS_VERIFY(dsAllocator_free(threadManager->allocator, threadManager->phases));
 	DS_VERIFY(dsAllocator_free(threadManager->allocator, threadManager));
 	return true;
 }
@@ -41,6 +41,10 @@ struct dsSceneTreeNode
 	uint32_t maxChildren;
 	dsMatrix44f transform;
 	dsSceneNodeItemData itemData;
+	// Index within node->treeNodes.
+	uint32_t treeNodeIndex;
+	// Index within the scene's dirty nodes, valid when dirty is true.
+	uint32_t dirtyIndex;
 	bool dirty;
 };
 
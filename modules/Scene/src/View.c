@@ -24,7 +24,7 @@
 #include <DeepSea/Core/Containers/HashTable.h>
 #include <DeepSea/Core/Memory/Allocator.h>
 #include <DeepSea/Core/Memory/BufferAllocator.h>
-#include <DeepSea/Core/Streams/FileStream.h>
+#include <DeepSea/Core/Streams/MappedFileStream.h>
 #include <DeepSea/Core/Streams/ResourceStream.h>
 #include <DeepSea/Core/Streams/Stream.h>
 #include <DeepSea/Core/Assert.h>
@@ -505,22 +505,21 @@ dsView* dsView_loadFile(const dsScene* scene, dsAllocator* allocator,
 	if (!resourceAllocator)
 		resourceAllocator = allocator;
 
-	dsFileStream stream;
-	if (!dsFileStream_openPath(&stream, filePath, "rb"))
+	// Parse directly from the mapped file to avoid reading it into the scratch buffer.
+	dsMappedFileStream stream;
+	if (!dsMappedFileStream_openPath(&stream, filePath))
 	{
 		DS_LOG_ERROR_F(DS_RENDER_LOG_TAG, "Couldn't open view file '%s'.", filePath);
 		DS_PROFILE_FUNC_RETURN(NULL);
 	}
 
 	size_t size;
-	void* buffer = dsSceneLoadScratchData_readUntilEnd(&size, scratchData, (dsStream*)&stream);
-	dsFileStream_close(&stream);
-	if (!buffer)
-		DS_PROFILE_FUNC_RETURN(NULL);
+	const void* buffer = dsMappedFileStream_getContents(&size, &stream);
+	DS_ASSERT(buffer);
 
 	dsView* view = dsView_loadImpl(scene, allocator, resourceAllocator, scratchData, buffer, size,
 		surfaces, surfaceCount, width, height, rotation, userData, destroyUserDataFunc, filePath);
-	DS_VERIFY(dsSceneLoadScratchData_freeReadBuffer(scratchData, buffer));
+	DS_VERIFY(dsMappedFileStream_close(&stream));
 	DS_PROFILE_FUNC_RETURN(view);
 }
 
@@ -892,7 +891,7 @@ bool dsView_draw(dsView* view, dsCommandBuffer* commandBuffer, dsSceneThreadMana
 		dsSceneItemLists* sharedItems = scene->sharedItems + i;
 		for (uint32_t j = 0; j < sharedItems->count; ++j)
 		{
-			dsSceneItemList* itemList = sharedItems->itemLists[i];
+			dsSceneItemList* itemList = sharedItems->itemLists[j];
 			itemList->commitFunc(itemList, view, commandBuffer);
 		}
 	}
@@ -0,0 +1,376 @@
+/*
+ * Copyright 2020 Aaron Barany
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "FixtureBase.h"
+#include <DeepSea/Core/Streams/Path.h>
+#include <DeepSea/Core/Error.h>
+#include <DeepSea/Core/Log.h>
+#include <DeepSea/Geometry/OrientedBox3.h>
+#include <DeepSea/Math/Matrix44.h>
+#include <DeepSea/Render/Resources/DrawGeometry.h>
+#include <DeepSea/Render/Resources/Framebuffer.h>
+#include <DeepSea/Render/Resources/GfxBuffer.h>
+#include <DeepSea/Render/Resources/GfxFormat.h>
+#include <DeepSea/Render/Resources/Material.h>
+#include <DeepSea/Render/Resources/MaterialDesc.h>
+#include <DeepSea/Render/Resources/Shader.h>
+#include <DeepSea/Render/Resources/ShaderModule.h>
+#include <DeepSea/Render/Resources/ShaderVariableGroup.h>
+#include <DeepSea/Render/Resources/ShaderVariableGroupDesc.h>
+#include <DeepSea/Render/Resources/SharedMaterialValues.h>
+#include <DeepSea/Render/Resources/VertexFormat.h>
+#include <DeepSea/Render/RenderPass.h>
+#include <DeepSea/Render/RenderSurface.h>
+#include <DeepSea/Scene/ItemLists/SceneIndirectModelList.h>
+#include <DeepSea/Scene/Nodes/SceneModelNode.h>
+#include <DeepSea/Scene/Nodes/SceneNode.h>
+#include <DeepSea/Scene/Nodes/SceneTransformNode.h>
+#include <DeepSea/Scene/Scene.h>
+#include <gtest/gtest.h>
+
+extern char assetsDir[];
+
+namespace
+{
+
+const char* modelListName = "IndirectModels";
+const char* cullListName = "IndirectCull";
+
+void countErrors(void* userData, dsLogLevel level, const char*, const char*, unsigned int,
+	const char*, const char*)
+{
+	if (level >= dsLogLevel_Error)
+		++*(uint32_t*)userData;
+}
+
+} // namespace
+
+class SceneIndirectModelListTest : public FixtureBase
+{
+public:
+	void SetUp() override
+	{
+		FixtureBase::SetUp();
+
+		dsShaderVariableElement transformElements[] =
+		{
+			{"modelViewProjection", dsMaterialType_Mat4, 0},
+			{"normalMat", dsMaterialType_Mat3, 0}
+		};
+		transformDesc = dsShaderVariableGroupDesc_create(resourceManager, NULL, transformElements,
+			DS_ARRAY_SIZE(transformElements));
+		ASSERT_TRUE(transformDesc);
+
+		dsMaterialElement elements[] =
+		{
+			{"diffuseTexture", dsMaterialType_Texture, 0, NULL, dsMaterialBinding_Material, 0},
+			{"colorMultiplier", dsMaterialType_Vec4, 0, NULL, dsMaterialBinding_Material, 0},
+			{"textureScaleOffset", dsMaterialType_Vec2, 2, NULL, dsMaterialBinding_Material, 0},
+			{"Transform", dsMaterialType_VariableGroup, 0, transformDesc, dsMaterialBinding_Global,
+				0}
+		};
+		materialDesc = dsMaterialDesc_create(resourceManager, NULL, elements,
+			DS_ARRAY_SIZE(elements));
+		ASSERT_TRUE(materialDesc);
+
+		char path[DS_PATH_MAX];
+		ASSERT_TRUE(dsPath_combine(path, DS_PATH_MAX, assetsDir, "shaders"));
+		ASSERT_TRUE(dsPath_combine(path, DS_PATH_MAX, path, "test.mslb"));
+		shaderModule = dsShaderModule_loadResource(resourceManager, NULL,
+			dsFileResourceType_Embedded, path, "test");
+		ASSERT_TRUE(shaderModule);
+
+		shader = dsShader_createName(resourceManager, NULL, shaderModule, "Test", materialDesc);
+		ASSERT_TRUE(shader);
+
+		material = dsMaterial_create(resourceManager, (dsAllocator*)&allocator, materialDesc);
+		ASSERT_TRUE(material);
+
+		transformGroup = dsShaderVariableGroup_create(resourceManager, NULL, NULL, transformDesc);
+		ASSERT_TRUE(transformGroup);
+
+		globalValues = dsSharedMaterialValues_create((dsAllocator*)&allocator,
+			DS_DEFAULT_MAX_SHARED_MATERIAL_VALUES);
+		ASSERT_TRUE(globalValues);
+		ASSERT_TRUE(dsSharedMaterialValues_setVariableGroupName(globalValues, "Transform",
+			transformGroup));
+
+		vertexGfxBuffer = dsGfxBuffer_create(resourceManager, NULL, dsGfxBufferUsage_Vertex,
+			dsGfxMemory_Static | dsGfxMemory_Draw, NULL, 1024);
+		ASSERT_TRUE(vertexGfxBuffer);
+
+		dsVertexBuffer vertexBuffer = {};
+		ASSERT_TRUE(dsVertexFormat_setAttribEnabled(&vertexBuffer.format, dsVertexAttrib_Position,
+			true));
+		vertexBuffer.format.elements[dsVertexAttrib_Position].format =
+			dsGfxFormat_decorate(dsGfxFormat_X32Y32Z32, dsGfxFormat_Float);
+		ASSERT_TRUE(dsVertexFormat_computeOffsetsAndSize(&vertexBuffer.format));
+		vertexBuffer.buffer = vertexGfxBuffer;
+		vertexBuffer.offset = 0;
+		vertexBuffer.count = 10;
+
+		dsVertexBuffer* vertexBuffers[DS_MAX_GEOMETRY_VERTEX_BUFFERS] = {&vertexBuffer};
+		geometry = dsDrawGeometry_create(resourceManager, NULL, vertexBuffers, NULL);
+		ASSERT_TRUE(geometry);
+
+		dsAttachmentInfo attachments[] =
+		{
+			{dsAttachmentUsage_Standard, renderer->surfaceDepthStencilFormat,
+				DS_DEFAULT_ANTIALIAS_SAMPLES},
+			{dsAttachmentUsage_KeepAfter, renderer->surfaceColorFormat,
+				DS_DEFAULT_ANTIALIAS_SAMPLES}
+		};
+		dsAttachmentRef colorAttachments[] = {{1, true}};
+		dsRenderSubpassInfo subpasses[] =
+		{
+			{"test", NULL, colorAttachments, {0, false}, 0, DS_ARRAY_SIZE(colorAttachments)}
+		};
+		renderPass = dsRenderPass_create(renderer, NULL, attachments,
+			DS_ARRAY_SIZE(attachments), subpasses, DS_ARRAY_SIZE(subpasses), NULL, 0);
+		ASSERT_TRUE(renderPass);
+
+		renderSurface = dsRenderSurface_create(renderer, NULL, "test", NULL,
+			dsRenderSurfaceType_Direct, dsRenderSurfaceUsage_Standard);
+		ASSERT_TRUE(renderSurface);
+
+		dsFramebufferSurface surfaces[] =
+		{
+			{dsGfxSurfaceType_DepthRenderSurface, dsCubeFace_None, 0, 0, renderSurface},
+			{dsGfxSurfaceType_ColorRenderSurface, dsCubeFace_None, 0, 0, renderSurface},
+		};
+		framebuffer = dsFramebuffer_create(resourceManager, NULL, "test", surfaces,
+			DS_ARRAY_SIZE(surfaces), renderSurface->width, renderSurface->height, 1);
+		ASSERT_TRUE(framebuffer);
+
+		modelList = dsSceneIndirectModelList_create((dsAllocator*)&allocator, modelListName,
+			resourceManager, NULL);
+		ASSERT_TRUE(modelList);
+
+		cullList = dsSceneIndirectModelList_createCullList((dsAllocator*)&allocator,
+			cullListName, modelList, shader, material);
+		if (!cullList)
+			dsSceneIndirectModelList_destroy(modelList);
+		ASSERT_TRUE(cullList);
+
+		// The cull list modifies the data drawn by the model list, so it must be a shared item.
+		dsSceneItemLists sharedItems = {&cullList, 1};
+		dsScenePipelineItem pipelineItem = {NULL, (dsSceneItemList*)modelList};
+		scene = dsScene_create((dsAllocator*)&allocator, renderer, &sharedItems, 1,
+			&pipelineItem, 1, NULL, 0, NULL, NULL);
+		ASSERT_TRUE(scene);
+
+		view = {};
+		view.scene = scene;
+		view.globalValues = globalValues;
+
+		errorCount = 0;
+		dsLog_setFunction(&errorCount, &countErrors);
+	}
+
+	void TearDown() override
+	{
+		dsLog_clearFunction();
+		dsScene_destroy(scene);
+		EXPECT_TRUE(dsRenderPass_destroy(renderPass));
+		EXPECT_TRUE(dsFramebuffer_destroy(framebuffer));
+		EXPECT_TRUE(dsRenderSurface_destroy(renderSurface));
+		EXPECT_TRUE(dsDrawGeometry_destroy(geometry));
+		EXPECT_TRUE(dsGfxBuffer_destroy(vertexGfxBuffer));
+		dsSharedMaterialValues_destroy(globalValues);
+		EXPECT_TRUE(dsShaderVariableGroup_destroy(transformGroup));
+		dsMaterial_destroy(material);
+		EXPECT_TRUE(dsShader_destroy(shader));
+		EXPECT_TRUE(dsShaderModule_destroy(shaderModule));
+		EXPECT_TRUE(dsMaterialDesc_destroy(materialDesc));
+		EXPECT_TRUE(dsShaderVariableGroupDesc_destroy(transformDesc));
+		FixtureBase::TearDown();
+	}
+
+	dsSceneModelNode* createModelNode(const dsOrientedBox3f* bounds)
+	{
+		dsSceneModelInitInfo model = {};
+		model.shader = shader;
+		model.material = material;
+		model.geometry = geometry;
+		// Always draw.
+		model.distanceRange.x = 1.0f;
+		model.distanceRange.y = 0.0f;
+		model.drawRange.vertexCount = 10;
+		model.drawRange.instanceCount = 1;
+		model.primitiveType = dsPrimitiveType_TriangleList;
+		model.listName = modelListName;
+		return dsSceneModelNode_create((dsAllocator*)&allocator, &model, 1, NULL, 0, NULL, 0,
+			bounds);
+	}
+
+	// Commits the same way as the scene: the shared cull list before the model list is drawn
+	// within the render pass.
+	void commit()
+	{
+		dsCommandBuffer* commandBuffer = renderer->mainCommandBuffer;
+		cullList->commitFunc(cullList, &view, commandBuffer);
+
+		ASSERT_TRUE(dsRenderPass_begin(renderPass, commandBuffer, framebuffer, NULL, NULL, 0,
+			false));
+		dsSceneItemList* drawList = (dsSceneItemList*)modelList;
+		drawList->commitFunc(drawList, &view, commandBuffer);
+		EXPECT_TRUE(dsRenderPass_end(renderPass, commandBuffer));
+	}
+
+	dsShaderVariableGroupDesc* transformDesc;
+	dsMaterialDesc* materialDesc;
+	dsShaderModule* shaderModule;
+	dsShader* shader;
+	dsMaterial* material;
+	dsShaderVariableGroup* transformGroup;
+	dsSharedMaterialValues* globalValues;
+	dsGfxBuffer* vertexGfxBuffer;
+	dsDrawGeometry* geometry;
+	dsRenderPass* renderPass;
+	dsRenderSurface* renderSurface;
+	dsFramebuffer* framebuffer;
+
+	dsSceneIndirectModelList* modelList;
+	dsSceneItemList* cullList;
+	dsScene* scene;
+	dsView view;
+	uint32_t errorCount;
+};
+
+TEST_F(SceneIndirectModelListTest, Create)
+{
+	EXPECT_FALSE(dsSceneIndirectModelList_create(NULL, modelListName, resourceManager, NULL));
+	EXPECT_EQ(EINVAL, errno);
+	EXPECT_FALSE(dsSceneIndirectModelList_create((dsAllocator*)&allocator, NULL,
+		resourceManager, NULL));
+	EXPECT_EQ(EINVAL, errno);
+	EXPECT_FALSE(dsSceneIndirectModelList_create((dsAllocator*)&allocator, modelListName, NULL,
+		NULL));
+	EXPECT_EQ(EINVAL, errno);
+
+	EXPECT_FALSE(dsSceneIndirectModelList_createCullList(NULL, cullListName, modelList, shader,
+		material));
+	EXPECT_EQ(EINVAL, errno);
+	EXPECT_FALSE(dsSceneIndirectModelList_createCullList((dsAllocator*)&allocator, NULL,
+		modelList, shader, material));
+	EXPECT_EQ(EINVAL, errno);
+	EXPECT_FALSE(dsSceneIndirectModelList_createCullList((dsAllocator*)&allocator, cullListName,
+		NULL, shader, material));
+	EXPECT_EQ(EINVAL, errno);
+	EXPECT_FALSE(dsSceneIndirectModelList_createCullList((dsAllocator*)&allocator, cullListName,
+		modelList, NULL, material));
+	EXPECT_EQ(EINVAL, errno);
+	EXPECT_FALSE(dsSceneIndirectModelList_createCullList((dsAllocator*)&allocator, cullListName,
+		modelList, shader, NULL));
+	EXPECT_EQ(EINVAL, errno);
+
+	dsSceneItemList* itemList = (dsSceneItemList*)modelList;
+	EXPECT_STREQ(modelListName, itemList->name);
+	EXPECT_TRUE(itemList->needsCommandBuffer);
+	EXPECT_STREQ(cullListName, cullList->name);
+	EXPECT_TRUE(cullList->needsCommandBuffer);
+
+	EXPECT_FALSE(dsSceneIndirectModelList_getRenderStates(modelList));
+	dsDynamicRenderStates renderStates = {};
+	renderStates.depthBiasConstantFactor = 2.0f;
+	dsSceneIndirectModelList_setRenderStates(modelList, &renderStates);
+	const dsDynamicRenderStates* listRenderStates =
+		dsSceneIndirectModelList_getRenderStates(modelList);
+	ASSERT_TRUE(listRenderStates);
+	EXPECT_EQ(2.0f, listRenderStates->depthBiasConstantFactor);
+	dsSceneIndirectModelList_setRenderStates(modelList, NULL);
+	EXPECT_FALSE(dsSceneIndirectModelList_getRenderStates(modelList));
+}
+
+TEST_F(SceneIndirectModelListTest, AddRemoveCommit)
+{
+	// Nothing to upload or draw.
+	commit();
+	EXPECT_EQ(0U, errorCount);
+
+	dsOrientedBox3f bounds;
+	dsMatrix33_identity(bounds.orientation);
+	bounds.center.x = 0.0f;
+	bounds.center.y = 0.0f;
+	bounds.center.z = 0.0f;
+	bounds.halfExtents.x = 1.0f;
+	bounds.halfExtents.y = 2.0f;
+	bounds.halfExtents.z = 3.0f;
+
+	dsSceneModelNode* modelNode1 = createModelNode(&bounds);
+	ASSERT_TRUE(modelNode1);
+	dsSceneModelNode* modelNode2 = createModelNode(&bounds);
+	ASSERT_TRUE(modelNode2);
+	// Models without bounds are never culled.
+	dsSceneModelNode* modelNode3 = createModelNode(NULL);
+	ASSERT_TRUE(modelNode3);
+
+	dsMatrix44f matrix1, matrix2;
+	dsMatrix44f_makeTranslate(&matrix1, 3.2f, -5.3f, 1.3f);
+	dsMatrix44f_makeTranslate(&matrix2, -1.0f, 2.0f, -3.0f);
+	dsSceneTransformNode* transform1 =
+		dsSceneTransformNode_create((dsAllocator*)&allocator, &matrix1);
+	ASSERT_TRUE(transform1);
+	dsSceneTransformNode* transform2 =
+		dsSceneTransformNode_create((dsAllocator*)&allocator, &matrix2);
+	ASSERT_TRUE(transform2);
+
+	ASSERT_TRUE(dsSceneNode_addChild((dsSceneNode*)transform1, (dsSceneNode*)modelNode1));
+	ASSERT_TRUE(dsSceneNode_addChild((dsSceneNode*)transform1, (dsSceneNode*)transform2));
+	ASSERT_TRUE(dsSceneNode_addChild((dsSceneNode*)transform2, (dsSceneNode*)modelNode2));
+	ASSERT_TRUE(dsSceneNode_addChild((dsSceneNode*)transform2, (dsSceneNode*)modelNode3));
+	ASSERT_TRUE(dsScene_addNode(scene, (dsSceneNode*)transform1));
+
+	// Committing the model list before the cull list uploads the data skips drawing.
+	ASSERT_TRUE(dsRenderPass_begin(renderPass, renderer->mainCommandBuffer, framebuffer, NULL,
+		NULL, 0, false));
+	dsSceneItemList* drawList = (dsSceneItemList*)modelList;
+	drawList->commitFunc(drawList, &view, renderer->mainCommandBuffer);
+	EXPECT_TRUE(dsRenderPass_end(renderPass, renderer->mainCommandBuffer));
+	EXPECT_EQ(0U, errorCount);
+
+	commit();
+	EXPECT_EQ(0U, errorCount);
+
+	// Only the moved instances are updated.
+	dsMatrix44f_makeTranslate(&matrix2, 7.2f, 2.6f, -5.3f);
+	EXPECT_TRUE(dsSceneTransformNode_setTransform(transform2, &matrix2));
+	EXPECT_TRUE(dsScene_update(scene));
+	commit();
+	EXPECT_EQ(0U, errorCount);
+
+	// Commit again without changes.
+	commit();
+	EXPECT_EQ(0U, errorCount);
+
+	EXPECT_TRUE(dsSceneNode_removeChildNode((dsSceneNode*)transform1, (dsSceneNode*)transform2));
+	commit();
+	EXPECT_EQ(0U, errorCount);
+
+	EXPECT_TRUE(dsSceneNode_addChild((dsSceneNode*)transform1, (dsSceneNode*)transform2));
+	commit();
+	EXPECT_EQ(0U, errorCount);
+
+	dsScene_clearNodes(scene);
+	commit();
+	EXPECT_EQ(0U, errorCount);
+
+	dsSceneNode_freeRef((dsSceneNode*)modelNode1);
+	dsSceneNode_freeRef((dsSceneNode*)modelNode2);
+	dsSceneNode_freeRef((dsSceneNode*)modelNode3);
+	dsSceneNode_freeRef((dsSceneNode*)transform1);
+	dsSceneNode_freeRef((dsSceneNode*)transform2);
+}
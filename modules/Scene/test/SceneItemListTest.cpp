@@ -138,6 +138,8 @@ MockSceneItemList* createMockSceneItems(dsAllocator* allocator)
 	baseItems->addNodeFunc = &addMockSceneItem;
 	baseItems->removeNodeFunc = &removeMockSceneItem;
 	baseItems->updateNodeFunc = &updateMockSceneItem;
+	baseItems->prepareRangesFunc = NULL;
+	baseItems->commitRangeFunc = NULL;
 	baseItems->commitFunc = &commitMockSceneItems;
 	baseItems->destroyFunc = &destroyMockSceneItems;
 
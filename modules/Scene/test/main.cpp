@@ -0,0 +1,36 @@
+/*
+ * Copyright 2020 Aaron Barany
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <DeepSea/Core/Streams/Path.h>
+#include <DeepSea/Core/Streams/ResourceStream.h>
+#include <gtest/gtest.h>
+
+char testerDir[DS_PATH_MAX];
+char assetsDir[DS_PATH_MAX];
+
+int main(int argc, char** argv)
+{
+	testing::InitGoogleTest(&argc, argv);
+
+#if !DS_ANDROID
+	dsPath_getDirectoryName(testerDir, DS_PATH_MAX, argv[0]);
+	dsResourceStream_setContext(NULL, NULL, testerDir, NULL, NULL);
+#endif
+
+	strncpy(assetsDir, "Scene-assets", sizeof(assetsDir));
+
+	return RUN_ALL_TESTS();
+}
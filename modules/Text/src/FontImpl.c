@@ -28,7 +28,7 @@
 #include <DeepSea/Core/Error.h>
 #include <DeepSea/Core/Log.h>
 #include <DeepSea/Core/Profile.h>
-#include <DeepSea/Core/Sort.h>
+#include <DeepSea/Core/TypedSort.h>
 #include <DeepSea/Geometry/AlignedBox2.h>
 #include <DeepSea/Geometry/BezierCurve.h>
 #include <DeepSea/Math/Core.h>
@@ -274,21 +274,17 @@ static bool addGlyphLine(dsGlyphGeometry* geometry, const dsVector2f* end)
 	return addGlyphPoint(geometry, end);
 }
 
-static int compareGlyphEdge(const void* left, const void* right)
+static inline bool glyphEdgeLess(const dsOrderedGlyphEdge* left,
+	const dsOrderedGlyphEdge* right, void* context)
 {
-	const dsOrderedGlyphEdge* leftEdge = (const dsOrderedGlyphEdge*)left;
-	const dsOrderedGlyphEdge* rightEdge = (const dsOrderedGlyphEdge*)right;
-	if (leftEdge->minPoint.y < rightEdge->minPoint.y)
-		return -1;
-	else if (leftEdge->minPoint.y > rightEdge->minPoint.y)
-		return 1;
-	else if (leftEdge->minPoint.x < rightEdge->minPoint.y)
-		return -1;
-	else if (leftEdge->minPoint.x > rightEdge->minPoint.x)
-		return 1;
-	return 0;
+	DS_UNUSED(context);
+	if (left->minPoint.y != right->minPoint.y)
+		return left->minPoint.y < right->minPoint.y;
+	return left->minPoint.x < right->minPoint.x;
 }
 
+DS_DEFINE_TYPED_SORT(sortOrderedGlyphEdges, dsOrderedGlyphEdge, glyphEdgeLess)
+
 static bool sortGlyphEdges(dsGlyphGeometry* geometry)
 {
 	// Reserve space for sorted edges. It might be less for invalid loops.
@@ -329,8 +325,7 @@ static bool sortGlyphEdges(dsGlyphGeometry* geometry)
 
 	DS_ASSERT(edgeIndex <= geometry->pointCount);
 	geometry->edgeCount = edgeIndex;
-	qsort(geometry->sortedEdges, geometry->edgeCount, sizeof(dsOrderedGlyphEdge),
-		&compareGlyphEdge);
+	sortOrderedGlyphEdges(geometry->sortedEdges, geometry->edgeCount, NULL);
 	return true;
 }
 
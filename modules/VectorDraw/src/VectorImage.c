@@ -24,7 +24,7 @@
 #include "VectorText.h"
 #include <DeepSea/Core/Memory/Allocator.h>
 #include <DeepSea/Core/Memory/BufferAllocator.h>
-#include <DeepSea/Core/Streams/FileStream.h>
+#include <DeepSea/Core/Streams/MappedFileStream.h>
 #include <DeepSea/Core/Streams/ResourceStream.h>
 #include <DeepSea/Core/Streams/Stream.h>
 #include <DeepSea/Core/Assert.h>
@@ -1038,24 +1038,21 @@ dsVectorImage* dsVectorImage_loadFile(dsAllocator* allocator, dsAllocator* resou
 	if (!resourceAllocator)
 		resourceAllocator = allocator;
 
-	dsFileStream stream;
-	if (!dsFileStream_openPath(&stream, filePath, "rb"))
+	// Parse directly from the mapped file to avoid reading it into a temporary buffer.
+	dsMappedFileStream stream;
+	if (!dsMappedFileStream_openPath(&stream, filePath))
 	{
 		DS_LOG_ERROR_F(DS_RENDER_LOG_TAG, "Couldn't open vector image file '%s'.", filePath);
 		DS_PROFILE_FUNC_RETURN(NULL);
 	}
 
 	size_t size;
-	void* buffer = dsVectorScratchData_readUntilEnd(&size, initResources->scratchData,
-		(dsStream*)&stream, initResources->scratchData->allocator);
-	dsFileStream_close(&stream);
-	if (!buffer)
-	{
-		DS_PROFILE_FUNC_RETURN(NULL);
-	}
+	const void* buffer = dsMappedFileStream_getContents(&size, &stream);
+	DS_ASSERT(buffer);
 
 	dsVectorImage* image = dsVectorImage_loadImpl(allocator, resourceAllocator, initResources,
 		buffer, size, pixelSize, targetSize, filePath);
+	DS_VERIFY(dsMappedFileStream_close(&stream));
 	DS_PROFILE_FUNC_RETURN(image);
 }
 
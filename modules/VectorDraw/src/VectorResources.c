@@ -21,7 +21,7 @@
 #include <DeepSea/Core/Memory/Allocator.h>
 #include <DeepSea/Core/Memory/BufferAllocator.h>
 #include <DeepSea/Core/Memory/PoolAllocator.h>
-#include <DeepSea/Core/Streams/FileStream.h>
+#include <DeepSea/Core/Streams/MappedFileStream.h>
 #include <DeepSea/Core/Streams/Path.h>
 #include <DeepSea/Core/Streams/ResourceStream.h>
 #include <DeepSea/Core/Streams/Stream.h>
@@ -275,25 +275,22 @@ dsVectorResources* dsVectorResources_loadFile(dsAllocator* allocator, dsAllocato
 		}
 	}
 
-	dsFileStream stream;
-	if (!dsFileStream_openPath(&stream, filePath, "rb"))
+	// Parse directly from the mapped file to avoid reading it into a temporary buffer.
+	dsMappedFileStream stream;
+	if (!dsMappedFileStream_openPath(&stream, filePath))
 	{
 		DS_LOG_ERROR_F(DS_RENDER_LOG_TAG, "Couldn't open vector resources file '%s'.", filePath);
 		DS_PROFILE_FUNC_RETURN(NULL);
 	}
 
 	size_t size;
-	void* buffer = dsStream_readUntilEnd(&size, (dsStream*)&stream, scratchAllocator);
-	dsFileStream_close(&stream);
-	if (!buffer)
-	{
-		DS_PROFILE_FUNC_RETURN(NULL);
-	}
+	const void* buffer = dsMappedFileStream_getContents(&size, &stream);
+	DS_ASSERT(buffer);
 
 	dsVectorResources* resources = dsVectorResources_loadImpl(allocator, scratchAllocator,
 		resourceManager, buffer, size, baseDirectory, &loadTextureFile, &loadFontFaceFile,
 		qualityRemap, filePath);
-	DS_VERIFY(dsAllocator_free(scratchAllocator, buffer));
+	DS_VERIFY(dsMappedFileStream_close(&stream));
 	DS_PROFILE_FUNC_RETURN(resources);
 }
 
@@ -0,0 +1,126 @@
+/*
+ * Copyright 2020 Aaron Barany
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "FixtureBase.h"
+#include "Flatbuffers/VectorImage_generated.h"
+#include "VectorImageImpl.h"
+#include <DeepSea/Core/Streams/FileStream.h>
+#include <DeepSea/Core/Streams/Path.h>
+#include <DeepSea/Core/Streams/ResourceStream.h>
+#include <DeepSea/Render/Resources/GfxBuffer.h>
+#include <DeepSea/VectorDraw/VectorImage.h>
+#include <DeepSea/VectorDraw/VectorMaterial.h>
+#include <DeepSea/VectorDraw/VectorMaterialSet.h>
+#include <DeepSea/VectorDraw/VectorScratchData.h>
+#include <stdio.h>
+#include <vector>
+
+class VectorImageLoadTest : public FixtureBase
+{
+};
+
+static bool writeTriangleImage(const char* path)
+{
+	flatbuffers::FlatBufferBuilder builder;
+	std::vector<flatbuffers::Offset<DeepSeaVectorDraw::VectorCommand>> commands;
+
+	DeepSeaVectorDraw::Matrix33f transform(DeepSeaVectorDraw::Vector3f(1.0f, 0.0f, 0.0f),
+		DeepSeaVectorDraw::Vector3f(0.0f, 1.0f, 0.0f),
+		DeepSeaVectorDraw::Vector3f(0.0f, 0.0f, 1.0f));
+	commands.push_back(DeepSeaVectorDraw::CreateVectorCommand(builder,
+		DeepSeaVectorDraw::VectorCommandUnion::StartPathCommand,
+		DeepSeaVectorDraw::CreateStartPathCommand(builder, &transform, true).Union()));
+
+	DeepSeaVectorDraw::Vector2f position(0.0f, 0.0f);
+	commands.push_back(DeepSeaVectorDraw::CreateVectorCommand(builder,
+		DeepSeaVectorDraw::VectorCommandUnion::MoveCommand,
+		DeepSeaVectorDraw::CreateMoveCommand(builder, &position).Union()));
+
+	DeepSeaVectorDraw::Vector2f end(1.0f, 1.2f);
+	commands.push_back(DeepSeaVectorDraw::CreateVectorCommand(builder,
+		DeepSeaVectorDraw::VectorCommandUnion::LineCommand,
+		DeepSeaVectorDraw::CreateLineCommand(builder, &end).Union()));
+
+	end = DeepSeaVectorDraw::Vector2f(2.0f, 0.4f);
+	commands.push_back(DeepSeaVectorDraw::CreateVectorCommand(builder,
+		DeepSeaVectorDraw::VectorCommandUnion::LineCommand,
+		DeepSeaVectorDraw::CreateLineCommand(builder, &end).Union()));
+
+	commands.push_back(DeepSeaVectorDraw::CreateVectorCommand(builder,
+		DeepSeaVectorDraw::VectorCommandUnion::ClosePathCommand,
+		DeepSeaVectorDraw::CreateClosePathCommand(builder).Union()));
+
+	commands.push_back(DeepSeaVectorDraw::CreateVectorCommand(builder,
+		DeepSeaVectorDraw::VectorCommandUnion::FillPathCommand,
+		DeepSeaVectorDraw::CreateFillPathCommandDirect(builder, "fill", 1.0f).Union()));
+
+	DeepSeaVectorDraw::Vector2f size(2.0f, 2.0f);
+	DeepSeaVectorDraw::FinishVectorImageBuffer(builder,
+		DeepSeaVectorDraw::CreateVectorImageDirect(builder, nullptr, nullptr, nullptr, &commands,
+			&size));
+
+	dsFileStream stream;
+	if (!dsFileStream_openPath(&stream, path, "wb"))
+		return false;
+
+	size_t written = dsFileStream_write(&stream, builder.GetBufferPointer(), builder.GetSize());
+	return dsFileStream_close(&stream) && written == builder.GetSize();
+}
+
+TEST_F(VectorImageLoadTest, LoadFile)
+{
+	char path[DS_PATH_MAX];
+	ASSERT_TRUE(dsPath_combine(path, sizeof(path),
+		dsResourceStream_getDirectory(dsFileResourceType_Dynamic), "triangle.dsvi"));
+	ASSERT_TRUE(writeTriangleImage(path));
+
+	dsVectorMaterialSet* materialSet = dsVectorMaterialSet_create((dsAllocator*)&allocator,
+		resourceManager, NULL, 1, false);
+	ASSERT_TRUE(materialSet);
+	dsVectorMaterial material;
+	dsColor color = {{255, 255, 255, 255}};
+	ASSERT_TRUE(dsVectorMaterial_setColor(&material, color));
+	ASSERT_TRUE(dsVectorMaterialSet_addMaterial(materialSet, "fill", &material, true));
+
+	dsVectorScratchData* scratchData = dsVectorScratchData_create((dsAllocator*)&allocator);
+	ASSERT_TRUE(scratchData);
+	dsVectorImageInitResources initResources = {resourceManager, NULL, scratchData, materialSet,
+		NULL, NULL, NULL, 0, false};
+
+	char missingPath[DS_PATH_MAX];
+	ASSERT_TRUE(dsPath_combine(missingPath, sizeof(missingPath),
+		dsResourceStream_getDirectory(dsFileResourceType_Dynamic), "doesNotExist.dsvi"));
+	EXPECT_FALSE(dsVectorImage_loadFile((dsAllocator*)&allocator, NULL, &initResources,
+		missingPath, 0.1f, NULL));
+
+	dsVectorImage* image = dsVectorImage_loadFile((dsAllocator*)&allocator, NULL, &initResources,
+		path, 0.1f, NULL);
+	EXPECT_EQ(0, remove(path));
+	ASSERT_TRUE(image);
+
+	dsVector2f size;
+	ASSERT_TRUE(dsVectorImage_getSize(&size, image));
+	EXPECT_EQ(2.0f, size.x);
+	EXPECT_EQ(2.0f, size.y);
+
+	dsGfxBuffer* buffer = dsVectorImage_getBuffer(image);
+	ASSERT_TRUE(buffer);
+	EXPECT_LE(sizeof(ShapeVertex)*3 + sizeof(uint16_t)*3, buffer->size);
+
+	EXPECT_TRUE(dsVectorImage_destroy(image));
+	dsVectorScratchData_destroy(scratchData);
+	EXPECT_TRUE(dsVectorMaterialSet_destroy(materialSet));
+}